@@ -464,13 +464,9 @@ IOReturn UniversalReceiveCallback(UInt32 CycleDataCount, UniversalReceiveCycleDa
 					lastFmt = k61883Fmt_DV;
 				}
 				
-				for (sourcePacket=0;sourcePacket<parsedPacket.numSourcePackets;sourcePacket++)
-					result = dvFramer->nextDVSourcePacket(parsedPacket.pSourcePacket[sourcePacket], 
-																	parsedPacket.sourcePacketSize, 
-																	parsedPacket.dvMode, 
-																	parsedPacket.syt, 
-																	pCycleData[cycle].fireWireTimeStamp,
-																	pCycleData[cycle].nanoSecondsTimeStamp);
+				result = dvFramer->nextCIPPacket(&parsedPacket,
+												 pCycleData[cycle].fireWireTimeStamp,
+												 pCycleData[cycle].nanoSecondsTimeStamp);
 				if (result != kIOReturnSuccess)
 					printf("DataReceiveCallback: nextTSPacket failed. Result: 0x%08X\n",result);
 			}
@@ -59,6 +59,7 @@
 #include <mach/mach.h>
 #include <mach/vm_map.h>
 #include <mach/mach_time.h>
+#include <libkern/OSAtomic.h>
 
 // Include required STL Headers
 #include <deque>
@@ -222,6 +223,14 @@ enum
 #define kPALFramesPerSecond 25.000000
 #define kIsochCycleClocksPerPALSourcePacket 3276.8000
 
+// The same DV packet periods, exactly, in 1/625ths of a FireWire clock
+enum
+{
+	kDVScaledClockScale = 625,
+	kDVScaledClocksPerNTSCSourcePacket = 2050048,
+	kDVScaledClocksPerPALSourcePacket = 2048000
+};
+
 // Misc DV Constants
 enum
 {
@@ -265,16 +274,31 @@ typedef IOReturn (*AVCDeviceMessageNotification) (class AVCDevice *pAVCDevice,
 #include "AVSShared.h"
 #include "AVSCommon.h"
 #include "StringLogger.h"
+#include "FWCycleTime.h"
 #include "TSPacket.h"
 #include "PSITables.h"
 #include "MPEG2XmitCycle.h"
 #include "MPEG2Transmitter.h"
+#include "MPEG2MultiStreamTransmitter.h"
 #include "MPEG2Receiver.h"
+#include "MPEG2MultiChannelReceiver.h"
+#include "MPEG2RecordingSink.h"
 #include "TSDemuxer.h"
+#include "DVFrameValidator.h"
+#include "DVFrameMetadata.h"
+#include "DVFrameBufferPool.h"
 #include "DVFramer.h"
+#include "DVTransmitCadence.h"
 #include "DVXmitCycle.h"
 #include "DVTransmitter.h"
+#include "DVThumbnailer.h"
 #include "DVReceiver.h"
+#include "DVAudioExtractor.h"
+#include "DVFrameIndexRing.h"
+#include "DVFrameReader.h"
+#include "DVFileSource.h"
+#include "DVTimeline.h"
+#include "DVRecorder.h"
 #include "UniversalReceiver.h"
 #include "UniversalTransmitter.h"
 #include "FireWireDV.h"
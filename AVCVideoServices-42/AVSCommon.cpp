@@ -50,6 +50,9 @@
 namespace AVS
 {
 
+// Prototypes for static functions in this file
+static void RunLoopCommandSourcePerform_Helper(void *info);
+
 /////////////////////////////////////////////////////////////////////////////////////////
 //
 // GetFireWireLocalNodeInterface
@@ -355,4 +358,146 @@ void MakeCurrentThreadTimeContraintThread(void)
 	return;
 }
 
+//////////////////////////////////////////////////////////////////////
+// RunLoopCommandSource::RunLoopCommandSource
+//////////////////////////////////////////////////////////////////////
+RunLoopCommandSource::RunLoopCommandSource()
+{
+	runLoopRef = nil;
+	source = nil;
+	pendingCommand = nil;
+	pPendingCommandRefCon = nil;
+	commandDone = true;
+	pthread_mutex_init(&commandMutex,NULL);
+}
+
+//////////////////////////////////////////////////////////////////////
+// RunLoopCommandSource::~RunLoopCommandSource
+//////////////////////////////////////////////////////////////////////
+RunLoopCommandSource::~RunLoopCommandSource()
+{
+	if (source)
+	{
+		CFRunLoopSourceInvalidate(source);
+		CFRelease(source);
+	}
+	pthread_mutex_destroy(&commandMutex);
+}
+
+//////////////////////////////////////////////////////////////////////
+// RunLoopCommandSource::install
+//////////////////////////////////////////////////////////////////////
+IOReturn RunLoopCommandSource::install(void)
+{
+	CFRunLoopSourceContext context;
+
+	if (source)
+		return kIOReturnExclusiveAccess;
+
+	bzero(&context,sizeof(context));
+	context.version = 0;
+	context.info = this;
+	context.perform = RunLoopCommandSourcePerform_Helper;
+
+	source = CFRunLoopSourceCreate(NULL, 0, &context);
+	if (!source)
+		return kIOReturnError;
+
+	runLoopRef = CFRunLoopGetCurrent();
+	CFRunLoopAddSource(runLoopRef, source, kCFRunLoopDefaultMode);
+
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// RunLoopCommandSource::performCommand
+//////////////////////////////////////////////////////////////////////
+void RunLoopCommandSource::performCommand(RunLoopCommandProc command, void *pRefCon)
+{
+	if ((source == nil) || (CFRunLoopGetCurrent() == runLoopRef))
+	{
+		command(pRefCon);
+		return;
+	}
+
+	pthread_mutex_lock(&commandMutex);
+
+	pendingCommand = command;
+	pPendingCommandRefCon = pRefCon;
+	commandDone = false;
+	OSMemoryBarrier();
+
+	CFRunLoopSourceSignal(source);
+	CFRunLoopWakeUp(runLoopRef);
+
+	// Wait for the run loop's thread to run the command
+	while (commandDone == false) usleep(1000);
+
+	pthread_mutex_unlock(&commandMutex);
+}
+
+//////////////////////////////////////////////////////////////////////
+// RunLoopCommandSource::runPendingCommand
+//////////////////////////////////////////////////////////////////////
+void RunLoopCommandSource::runPendingCommand(void)
+{
+	if (commandDone == true)
+		return;
+	OSMemoryBarrier();
+
+	pendingCommand(pPendingCommandRefCon);
+
+	OSMemoryBarrier();
+	commandDone = true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// StatsSeqLock::StatsSeqLock
+//////////////////////////////////////////////////////////////////////
+StatsSeqLock::StatsSeqLock()
+{
+	sequence = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// StatsSeqLock::publish
+//////////////////////////////////////////////////////////////////////
+void StatsSeqLock::publish(void *pPublished, const void *pWorking, UInt32 length)
+{
+	sequence += 1;
+	OSMemoryBarrier();
+
+	memcpy(pPublished,pWorking,length);
+
+	OSMemoryBarrier();
+	sequence += 1;
+}
+
+//////////////////////////////////////////////////////////////////////
+// StatsSeqLock::read
+//////////////////////////////////////////////////////////////////////
+void StatsSeqLock::read(void *pDest, const void *pPublished, UInt32 length)
+{
+	UInt32 startSequence;
+
+	// Keep copying until we get a copy that no publish overlapped
+	do
+	{
+		while ((startSequence = sequence) & 1)
+			usleep(100);
+		OSMemoryBarrier();
+		memcpy(pDest,pPublished,length);
+		OSMemoryBarrier();
+	}while (startSequence != sequence);
+}
+
+//////////////////////////////////////////////////////////////////////
+// RunLoopCommandSourcePerform_Helper
+//////////////////////////////////////////////////////////////////////
+static void RunLoopCommandSourcePerform_Helper(void *info)
+{
+	RunLoopCommandSource *pCommandSource = (RunLoopCommandSource*) info;
+	pCommandSource->runPendingCommand();
+}
+
 } // namespace AVS
\ No newline at end of file
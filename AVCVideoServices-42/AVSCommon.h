@@ -67,6 +67,61 @@ namespace AVS
 	// Bump the priority of the current thread to real-time. For internal use only by stream object helper functions!
 	void MakeCurrentThreadTimeContraintThread(void);
 
+	// Function prototype for a command run on a run loop's thread by a RunLoopCommandSource
+	typedef void (*RunLoopCommandProc) (void *pRefCon);
+
+	//
+	// RunLoopCommandSource: For objects that host many stream objects on one run loop.
+	// It keeps the run loop running when no streams are installed on it, and runs
+	// commands on the run loop's thread, where they can't race with any of the streams'
+	// callbacks. For internal use only!
+	//
+	class RunLoopCommandSource
+	{
+	public:
+		RunLoopCommandSource();
+		~RunLoopCommandSource();
+
+		// Add the source to the current thread's run loop
+		IOReturn install(void);
+
+		// Run a command on the run loop's thread, and wait for it to finish. If the
+		// source isn't installed, or if this is the run loop's thread, the command is
+		// run right away, on this thread.
+		void performCommand(RunLoopCommandProc command, void *pRefCon);
+
+		// Called by the run loop source
+		void runPendingCommand(void);
+
+	private:
+		CFRunLoopRef runLoopRef;
+		CFRunLoopSourceRef source;
+		pthread_mutex_t commandMutex;	// One command at a time
+		RunLoopCommandProc pendingCommand;
+		void *pPendingCommandRefCon;
+		volatile bool commandDone;
+	};
+
+	//
+	// StatsSeqLock: Publishes a stream object's stats struct from the one thread that
+	// writes it, to readers on any thread, without blocking the writer. The writer keeps
+	// its own working copy, and publishes it between client callbacks. For internal use only!
+	//
+	class StatsSeqLock
+	{
+	public:
+		StatsSeqLock();
+
+		// Copy the writer's working stats into the published stats.
+		void publish(void *pPublished, const void *pWorking, UInt32 length);
+
+		// Copy out a version of the published stats that no publish overlapped.
+		void read(void *pDest, const void *pPublished, UInt32 length);
+
+	private:
+		volatile UInt32 sequence;	// Odd while a publish is in progress
+	};
+
 } // namespace AVS
 
 #endif // __AVCVIDEOSERVICES_AVSCOMMON__
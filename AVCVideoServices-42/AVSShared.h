@@ -136,6 +136,7 @@ enum
 	kFWAVCStreamPreparePacketFetcher = 5,	// Only for transmitters
 	kFWAVCStreamBadBufferRange = 6,			// Only for universal transmitter
 	kFWAVCStreamDCLOverrunAutoRestartFailed = 7,
+	kFWAVCStreamDVModeChanged = 8,			// Only for DV receiver
 	
 	// constants for supported DV modes
 	kFWAVCDVMode_SDL_625_50 = 0x84,
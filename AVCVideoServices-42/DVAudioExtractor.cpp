@@ -0,0 +1,407 @@
+/*
+	File:		DVAudioExtractor.cpp
+ 
+ Synopsis: Extracts the PCM audio from DV frames into interleaved sample buffers.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+namespace AVS
+{
+
+// Where the audio blocks are in a DIF sequence
+enum
+{
+	kDVAudioFirstBlock = 6,
+	kDVAudioBlockInterval = 16,
+	kDVAudioErrorCode16Bit = 0x8000,
+	kDVAudioErrorCode12Bit = 0x800
+};
+
+// Used to find the DIF blocks of a scatter-list frame. The audio blocks are
+// fetched in frame order, so we pick up the search where the last one left off.
+struct DVAudioFrameRangeCursor
+{
+	DVReceiveFrameRange *pRanges;
+	UInt32 rangeCount;
+	UInt32 range;
+	UInt32 rangeFrameOffset;	// Frame offset of the start of pRanges[range]
+};
+
+// Prototypes for static functions in this file
+static UInt8* ContiguousFrameDIFBlock_Helper(UInt32 frameOffset, void *pRefCon);
+static UInt8* FrameRangeCursorDIFBlock_Helper(UInt32 frameOffset, void *pRefCon);
+
+#define DIFBlockOffset(sequence,block) ((((sequence)*kDVDIFBlocksPerSequence)+(block))*kDVDIFBlockSize)
+
+/////////////////////////////////////////////////////////
+// DVAudioExtractor::DVAudioExtractor
+/////////////////////////////////////////////////////////
+DVAudioExtractor::DVAudioExtractor(UInt8 initialDVMode)
+{
+	SInt32 code;
+	SInt32 sample;
+	SInt32 shift;
+	
+	// Build the 12-bit to 16-bit expansion table (IEC 61834-2). The 12-bit
+	// samples are a piecewise-linear compression of a 16-bit sample.
+	for (code=0;code<4096;code++)
+	{
+		sample = (code > 2047) ? (code - 4096) : code;
+		shift = (code & 0xF00) >> 8;
+		if ((shift < 2) || (shift > 0xD))
+			expand12BitTable[code] = sample;
+		else if (shift < 8)
+		{
+			shift -= 1;
+			expand12BitTable[code] = (sample - (256*shift)) * (1 << shift);
+		}
+		else
+		{
+			shift = 0xE - shift;
+			expand12BitTable[code] = ((sample + (256*shift) + 1) * (1 << shift)) - 1;
+		}
+	}
+	expand12BitTable[kDVAudioErrorCode12Bit] = 0;
+	
+	currentDVMode = 0xFF;
+	pDVFormat = nil;
+	numSequences = 0;
+	sequencesPerChannel = 0;
+	sequencesPerHalf = 0;
+	
+	setDVMode(initialDVMode);
+}
+
+/////////////////////////////////////////////////////////
+// DVAudioExtractor::~DVAudioExtractor
+/////////////////////////////////////////////////////////
+DVAudioExtractor::~DVAudioExtractor()
+{
+}
+
+/////////////////////////////////////////////////////////
+// DVAudioExtractor::setDVMode
+/////////////////////////////////////////////////////////
+IOReturn DVAudioExtractor::setDVMode(UInt8 dvMode)
+{
+	UInt32 i = 0;
+	UInt32 sample;
+	UInt32 samplesPerPosition;
+	DVFormats *pFormat = nil;
+	
+	// Find the DVFormat table entry for this mode, disregarding the speed bits
+	while (dvFormats[i].frameSize != 0)
+	{
+		if ((dvMode & 0xFC) == dvFormats[i].mode)
+		{
+			pFormat = &dvFormats[i];
+			break;
+		}
+		i++;
+	}
+	
+	// SDL frames have a different audio layout, which we don't support. The
+	// current mode is left as it was, so a frame in it can still be extracted,
+	// and the next try at an unsupported mode fails the same way.
+	if ((pFormat == nil) || (DVstype(dvMode) == 0x01))
+		return kIOReturnUnsupported;
+	
+	pDVFormat = pFormat;
+	currentDVMode = dvMode;
+	numSequences = pDVFormat->frameSize / kDVDIFSequenceSize;
+	sequencesPerChannel = (DVstandard(dvMode) == kDVStandardPAL) ? 12 : 10;
+	sequencesPerHalf = sequencesPerChannel/2;
+	
+	// Sample n of a channel is in DIF sequence ((n/3)+(2*(n%3))) % sequencesPerHalf, of
+	// the channel's half of the DIF sequences, audio block (3*(n%3))+((n%(9*half))/(3*half)),
+	// at sample position n/(9*half) in the block (IEC 61834-2, SMPTE 314M). So the samples
+	// at position 0 of every block are the first 9*half samples of the frame, and each
+	// block's later samples follow every 9*half samples.
+	samplesPerPosition = sequencesPerHalf * kDVAudioBlocksPerSequence;
+	for (sample=0;sample<samplesPerPosition;sample++)
+		blockFirstSlot[((sample/3)+(2*(sample%3))) % sequencesPerHalf]
+			[(3*(sample%3))+(sample/(3*sequencesPerHalf))] = sample;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////
+// DVAudioExtractor::extractAudio
+/////////////////////////////////////////////////////////
+IOReturn DVAudioExtractor::extractAudio(UInt8 *pFrameData,
+										UInt32 frameLen,
+										UInt8 dvMode,
+										SInt16 *pSamples,
+										UInt32 bufferSamples,
+										DVAudioFrameInfo *pInfo)
+{
+	IOReturn result;
+	
+	if ((!pFrameData) || (!pSamples) || (!pInfo))
+		return kIOReturnBadArgument;
+	
+	result = extractAudioWithDIFBlockProc(ContiguousFrameDIFBlock_Helper, pFrameData, frameLen, dvMode, nil, pSamples, bufferSamples, pInfo);
+	pInfo->frameSYTTime = 0xFFFFFFFF;
+	pInfo->frameTimeStamp = 0xFFFFFFFF;
+	pInfo->frameU64TimeStamp = 0xFFFFFFFFFFFFFFFFLL;
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////
+// DVAudioExtractor::extractAudio
+/////////////////////////////////////////////////////////
+IOReturn DVAudioExtractor::extractAudio(DVFrame *pFrame, SInt16 *pSamples, UInt32 bufferSamples, DVAudioFrameInfo *pInfo)
+{
+	IOReturn result;
+	
+	if ((!pFrame) || (!pSamples) || (!pInfo))
+		return kIOReturnBadArgument;
+	
+	result = extractAudioWithDIFBlockProc(ContiguousFrameDIFBlock_Helper,
+										  pFrame->pFrameData,
+										  pFrame->frameLen,
+										  pFrame->frameMode,
+										  &pFrame->frameMetadata,
+										  pSamples,
+										  bufferSamples,
+										  pInfo);
+	pInfo->frameSYTTime = pFrame->frameSYTTime;
+	pInfo->frameTimeStamp = pFrame->packetStartTimeStamp;
+	pInfo->frameU64TimeStamp = pFrame->packetStartU64TimeStamp;
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////
+// DVAudioExtractor::extractAudio
+/////////////////////////////////////////////////////////
+IOReturn DVAudioExtractor::extractAudio(DVReceiveFrame *pFrame, SInt16 *pSamples, UInt32 bufferSamples, DVAudioFrameInfo *pInfo)
+{
+	IOReturn result;
+	DVAudioFrameRangeCursor rangeCursor;
+	
+	if ((!pFrame) || (!pSamples) || (!pInfo))
+		return kIOReturnBadArgument;
+	
+	if (pFrame->frameRangeCount > 0)
+	{
+		rangeCursor.pRanges = pFrame->pFrameRanges;
+		rangeCursor.rangeCount = pFrame->frameRangeCount;
+		rangeCursor.range = 0;
+		rangeCursor.rangeFrameOffset = 0;
+		result = extractAudioWithDIFBlockProc(FrameRangeCursorDIFBlock_Helper,
+											  &rangeCursor,
+											  pFrame->frameLen,
+											  pFrame->frameMode,
+											  &pFrame->frameMetadata,
+											  pSamples,
+											  bufferSamples,
+											  pInfo);
+	}
+	else
+		result = extractAudioWithDIFBlockProc(ContiguousFrameDIFBlock_Helper,
+											  pFrame->pFrameData,
+											  pFrame->frameLen,
+											  pFrame->frameMode,
+											  &pFrame->frameMetadata,
+											  pSamples,
+											  bufferSamples,
+											  pInfo);
+	pInfo->frameSYTTime = pFrame->frameSYTTime;
+	pInfo->frameTimeStamp = pFrame->frameReceivedTimeStamp;
+	pInfo->frameU64TimeStamp = 0xFFFFFFFFFFFFFFFFLL;
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////
+// DVAudioExtractor::extractAudioWithDIFBlockProc
+/////////////////////////////////////////////////////////
+IOReturn DVAudioExtractor::extractAudioWithDIFBlockProc(DVFrameDIFBlockProc difBlockProc,
+														 void *pRefCon,
+														 UInt32 frameLen,
+														 UInt8 dvMode,
+														 DVFrameMetadata *pMetadata,
+														 SInt16 *pSamples,
+														 UInt32 bufferSamples,
+														 DVAudioFrameInfo *pInfo)
+{
+	IOReturn result = kIOReturnSuccess;
+	DVFrameMetadata frameMetadata;
+	UInt32 sequence;
+	UInt32 sequenceInChannel;
+	UInt32 block;
+	UInt32 position;
+	UInt32 numChannels;
+	UInt32 firstChannel;
+	UInt32 outputStride;
+	UInt32 errorSamples = 0;
+	UInt8 *pBlock;
+	UInt8 *pData;
+	SInt16 *pOut;
+	SInt16 sample;
+	UInt32 sampleY;
+	UInt32 sampleZ;
+	bool twelveBit;
+	
+	bzero(pInfo, sizeof(DVAudioFrameInfo));
+	
+	if (dvMode != currentDVMode)
+		result = setDVMode(dvMode);
+	if (result != kIOReturnSuccess)
+		return result;
+	if ((!pDVFormat) || (frameLen != pDVFormat->frameSize))
+		return kIOReturnBadArgument;
+	
+	// Get the audio format from the AAUX source pack, unless it was already extracted
+	if ((!pMetadata) || (pMetadata->extracted == false))
+	{
+		GetDVFrameMetadataWithDIFBlockProc(difBlockProc, pRefCon, frameLen, dvMode, &frameMetadata);
+		pMetadata = &frameMetadata;
+	}
+	if (pMetadata->audioValid == false)
+		return kIOReturnNotFound;
+	if ((pMetadata->audioBitsPerSample != 16) && (pMetadata->audioBitsPerSample != 12))
+		return kIOReturnUnsupported;
+	
+	// Two channels per channel of DIF sequences, one for each half of its sequences.
+	// In 12-bit mode, each half carries a pair of channels.
+	twelveBit = (pMetadata->audioBitsPerSample == 12);
+	numChannels = 2 * (numSequences / sequencesPerChannel);
+	if (twelveBit == true)
+		numChannels *= 2;
+	if (bufferSamples < (numChannels*kDVAudioMaxSamplesPerFrame))
+		return kIOReturnNoSpace;
+	
+	pInfo->sampleRate = pMetadata->audioSampleRate;
+	pInfo->samplesPerFrame = pMetadata->audioSamplesPerFrame;
+	pInfo->numChannels = numChannels;
+	pInfo->bitsPerSample = pMetadata->audioBitsPerSample;
+	pInfo->locked = pMetadata->audioLocked;
+	
+	// Successive samples of an audio block are this far apart in the output
+	outputStride = sequencesPerHalf * kDVAudioBlocksPerSequence * numChannels;
+	
+	for (sequence=0;sequence<numSequences;sequence++)
+	{
+		sequenceInChannel = sequence % sequencesPerChannel;
+		firstChannel = ((sequence / sequencesPerChannel) * 2) + (sequenceInChannel / sequencesPerHalf);
+		if (twelveBit == true)
+			firstChannel *= 2;
+		
+		for (block=0;block<kDVAudioBlocksPerSequence;block++)
+		{
+			pBlock = difBlockProc(DIFBlockOffset(sequence,(kDVAudioFirstBlock+(block*kDVAudioBlockInterval))), pRefCon);
+			if (pBlock == nil)
+				return kIOReturnUnderrun;
+			pData = &pBlock[kDVAudioBlockDataOffset];
+			pOut = &pSamples[(blockFirstSlot[sequenceInChannel % sequencesPerHalf][block]*numChannels) + firstChannel];
+			
+			if (twelveBit == false)
+			{
+				// 36 big-endian 16-bit samples
+				for (position=0;position<(kDVAudioBlockDataSize/2);position++)
+				{
+					sample = (SInt16) ((pData[position*2] << 8) | pData[(position*2)+1]);
+					errorSamples += (sample == (SInt16) kDVAudioErrorCode16Bit);
+					pOut[position*outputStride] = (sample == (SInt16) kDVAudioErrorCode16Bit) ? 0 : sample;
+				}
+			}
+			else
+			{
+				// 24 pairs of 12-bit samples, one for each channel of the pair. The
+				// pair's most significant bytes come first, then their low nibbles.
+				for (position=0;position<(kDVAudioBlockDataSize/3);position++)
+				{
+					sampleY = (pData[position*3] << 4) | (pData[(position*3)+2] >> 4);
+					sampleZ = (pData[(position*3)+1] << 4) | (pData[(position*3)+2] & 0x0F);
+					errorSamples += (sampleY == kDVAudioErrorCode12Bit) + (sampleZ == kDVAudioErrorCode12Bit);
+					pOut[position*outputStride] = expand12BitTable[sampleY];
+					pOut[(position*outputStride)+1] = expand12BitTable[sampleZ];
+				}
+			}
+		}
+	}
+	
+	pInfo->errorSamples = errorSamples;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////
+// ContiguousFrameDIFBlock_Helper
+/////////////////////////////////////////////////////////
+static UInt8* ContiguousFrameDIFBlock_Helper(UInt32 frameOffset, void *pRefCon)
+{
+	return ((UInt8*) pRefCon) + frameOffset;
+}
+
+/////////////////////////////////////////////////////////
+// FrameRangeCursorDIFBlock_Helper
+/////////////////////////////////////////////////////////
+static UInt8* FrameRangeCursorDIFBlock_Helper(UInt32 frameOffset, void *pRefCon)
+{
+	DVAudioFrameRangeCursor *pCursor = (DVAudioFrameRangeCursor*) pRefCon;
+	
+	// Start over if this block is before the last one
+	if (frameOffset < pCursor->rangeFrameOffset)
+	{
+		pCursor->range = 0;
+		pCursor->rangeFrameOffset = 0;
+	}
+	
+	// Ranges are whole data blocks, so a DIF block is never split between two of them
+	while (pCursor->range < pCursor->rangeCount)
+	{
+		if (frameOffset < (pCursor->rangeFrameOffset + pCursor->pRanges[pCursor->range].length))
+			return &pCursor->pRanges[pCursor->range].pData[frameOffset - pCursor->rangeFrameOffset];
+		pCursor->rangeFrameOffset += pCursor->pRanges[pCursor->range].length;
+		pCursor->range += 1;
+	}
+	
+	return nil;
+}
+
+} // namespace AVS
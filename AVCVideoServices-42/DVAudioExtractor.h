@@ -0,0 +1,154 @@
+/*
+	File:		DVAudioExtractor.h
+ 
+ Synopsis: Extracts the PCM audio from DV frames into interleaved sample buffers.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVAUDIOEXTRACTOR__
+#define __AVCVIDEOSERVICES_DVAUDIOEXTRACTOR__
+
+namespace AVS
+{
+
+// DV audio layout constants
+enum
+{
+	kDVAudioBlocksPerSequence = 9,
+	kDVAudioBlockDataOffset = 8,		// After the block ID and the AAUX pack
+	kDVAudioBlockDataSize = 72,
+	kDVAudioMaxSequencesPerHalf = 6,	// 625-50: 12 DIF sequences per channel
+	
+	// The number of sample slots per channel in a 625-50 frame's audio DIF blocks
+	// (6 DIF sequences * 9 audio blocks * 36 samples). A frame never has more
+	// samples than this, in any mode.
+	kDVAudioMaxSamplesPerFrame = 1944,
+	
+	// DVCPro100: 4 channels of DIF sequences, with 2 audio channels each
+	kDVAudioMaxChannels = 8
+};
+
+// Information about the audio extracted from a DV frame
+struct DVAudioFrameInfo
+{
+	UInt32 sampleRate;			// In Hz
+	UInt32 samplesPerFrame;		// The number of valid samples per channel in the output buffer
+	UInt32 numChannels;			// The number of interleaved channels in the output buffer
+	UInt8 bitsPerSample;		// Of the DV audio (12 or 16). The output is always 16 bit.
+	bool locked;				// True if the audio is locked to the video
+	UInt32 errorSamples;		// Samples marked as errors in the frame. These are output as zero.
+	
+	// The timestamps of the frame the audio came from
+	UInt32 frameSYTTime;
+	UInt32 frameTimeStamp;
+	UInt64 frameU64TimeStamp;	// 0xFFFFFFFFFFFFFFFF if not known
+};
+
+//
+// The DVAudioExtractor Class Declaration
+//
+// De-shuffles the audio samples of a DV frame's audio DIF blocks into a buffer of
+// interleaved, native-endian, 16-bit PCM samples. The sample rate, quantization,
+// and samples per frame come from the AAUX source pack. 12-bit samples are expanded
+// to 16 bits. The location of each audio block's samples in the output comes from
+// a table built when the DV mode is set, so each block is copied with one loop over
+// its samples, with a fixed output stride.
+//
+// The output buffer must hold kDVAudioMaxSamplesPerFrame samples for every channel.
+// Only the first samplesPerFrame samples of each channel are valid; the rest of the
+// sample slots in the frame are filled with whatever the frame has in them.
+//
+class DVAudioExtractor
+{
+	
+public:
+	// Constructor
+	DVAudioExtractor(UInt8 initialDVMode = 0x00);
+	
+	// Destructor
+	~DVAudioExtractor();
+	
+	// Set the DV mode of the frames the audio will be extracted from
+	IOReturn setDVMode(UInt8 dvMode);
+	
+	// Extract the audio from a whole frame. Sets the DV mode first, if needed.
+	// bufferSamples is the size of pSamples, in samples (not bytes).
+	IOReturn extractAudio(UInt8 *pFrameData,
+						  UInt32 frameLen,
+						  UInt8 dvMode,
+						  SInt16 *pSamples,
+						  UInt32 bufferSamples,
+						  DVAudioFrameInfo *pInfo);
+	
+	// Same as above, for a DVFramer frame, or a DVReceiver frame (which may be a
+	// scatter-list frame). The frame's metadata is used if it was extracted.
+	IOReturn extractAudio(DVFrame *pFrame, SInt16 *pSamples, UInt32 bufferSamples, DVAudioFrameInfo *pInfo);
+	IOReturn extractAudio(DVReceiveFrame *pFrame, SInt16 *pSamples, UInt32 bufferSamples, DVAudioFrameInfo *pInfo);
+	
+private:
+	
+	IOReturn extractAudioWithDIFBlockProc(DVFrameDIFBlockProc difBlockProc,
+										  void *pRefCon,
+										  UInt32 frameLen,
+										  UInt8 dvMode,
+										  DVFrameMetadata *pMetadata,
+										  SInt16 *pSamples,
+										  UInt32 bufferSamples,
+										  DVAudioFrameInfo *pInfo);
+	
+	UInt8 currentDVMode;
+	DVFormats *pDVFormat;
+	UInt32 numSequences;			// DIF sequences in the frame, all channels
+	UInt32 sequencesPerChannel;
+	UInt32 sequencesPerHalf;		// Each half of a channel's DIF sequences carries different audio channels
+	
+	// The first sample slot of each audio block of the DIF sequences in each
+	// half of a channel. The block's other samples follow, every sequencesPerHalf*9 slots.
+	UInt32 blockFirstSlot[kDVAudioMaxSequencesPerHalf][kDVAudioBlocksPerSequence];
+	
+	// 12-bit non-linear samples to 16-bit linear samples
+	SInt16 expand12BitTable[4096];
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVAUDIOEXTRACTOR__
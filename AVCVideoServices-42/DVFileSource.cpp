@@ -0,0 +1,376 @@
+/*
+	File:		DVFileSource.cpp
+ 
+ Synopsis: Plays a DV file through a DVTransmitter, reading frames ahead on a separate thread.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace AVS
+{
+
+//////////////////////////////////////////////////////
+// Constructor
+//////////////////////////////////////////////////////
+DVFileSource::DVFileSource(StringLogger *stringLogger)
+{
+	if (stringLogger == nil)
+	{
+		logger = new StringLogger(nil);	// Throws away all log strings
+		noLogger = true;
+	}
+	else
+	{
+		logger = stringLogger;
+		noLogger = false;
+	}
+	
+	fileDescriptor = -1;
+	dvMode = 0xFF;
+	frameSize = 0;
+	numFileFrames = 0;
+	loopFile = false;
+	
+	nextReadFrame = 0;
+	readFailed = false;
+	loops = 0;
+	
+	frameReader.registerReaderCallbacks(ReaderNextRead, ReaderReadDone, ReaderRewind, nil, this);
+}
+
+//////////////////////////////////////////////////////
+// Destructor
+//////////////////////////////////////////////////////
+DVFileSource::~DVFileSource()
+{
+	if (fileDescriptor != -1)
+		closeFile();
+	
+	// If we created an internal logger, free it
+	if (noLogger == true)
+		delete logger;
+}
+
+//////////////////////////////////////////////////////
+// openFile
+//////////////////////////////////////////////////////
+IOReturn DVFileSource::openFile(const char *pFileName, bool loopMode)
+{
+	struct stat fileInfo;
+	UInt8 frameHeader[480];
+	UInt32 sourcePacketSize;
+	
+	if (!pFileName)
+		return kIOReturnBadArgument;
+	
+	// Make sure we are not already playing a file
+	if (fileDescriptor != -1)
+		return kIOReturnExclusiveAccess;
+	
+	fileDescriptor = open(pFileName, O_RDONLY);
+	if (fileDescriptor == -1)
+	{
+		logger->log("\nDVFileSource Error: Unable to open file: %s\n\n",pFileName);
+		return kIOReturnNotFound;
+	}
+	
+	// Determine the DV mode from the start of the first frame
+	if ((fstat(fileDescriptor, &fileInfo) != 0) ||
+		(pread(fileDescriptor, frameHeader, sizeof(frameHeader), 0) != (ssize_t) sizeof(frameHeader)) ||
+		(GetDVModeFromFrameData(frameHeader, &dvMode, &frameSize, &sourcePacketSize) != kIOReturnSuccess))
+	{
+		logger->log("\nDVFileSource Error: Unable to determine DV mode of file: %s\n\n",pFileName);
+		close(fileDescriptor);
+		fileDescriptor = -1;
+		return kIOReturnUnsupported;
+	}
+	
+	numFileFrames = (UInt32) (fileInfo.st_size / frameSize);
+	if (numFileFrames == 0)
+	{
+		logger->log("\nDVFileSource Error: File contains no complete DV frames: %s\n\n",pFileName);
+		close(fileDescriptor);
+		fileDescriptor = -1;
+		return kIOReturnUnderrun;
+	}
+	
+#ifdef F_RDAHEAD
+	// Our reads are strictly sequential (except for seeks), so let the file system read ahead of us
+	fcntl(fileDescriptor, F_RDAHEAD, 1);
+#endif
+	
+	loopFile = loopMode;
+	nextReadFrame = 0;
+	readFailed = false;
+	loops = 0;
+	
+	// Start the reader thread. It waits until it has frames to fill.
+	if (frameReader.startReaderThread() != kIOReturnSuccess)
+	{
+		logger->log("\nDVFileSource Error: Unable to create reader thread\n\n");
+		close(fileDescriptor);
+		fileDescriptor = -1;
+		return kIOReturnError;
+	}
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// closeFile
+//////////////////////////////////////////////////////
+IOReturn DVFileSource::closeFile(void)
+{
+	if (fileDescriptor == -1)
+		return kIOReturnNotOpen;
+	
+	frameReader.stopReaderThread();
+	
+	close(fileDescriptor);
+	fileDescriptor = -1;
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// getDVMode
+//////////////////////////////////////////////////////
+UInt8 DVFileSource::getDVMode(void)
+{
+	return dvMode;
+}
+
+//////////////////////////////////////////////////////
+// getNumFileFrames
+//////////////////////////////////////////////////////
+UInt32 DVFileSource::getNumFileFrames(void)
+{
+	return numFileFrames;
+}
+
+//////////////////////////////////////////////////////
+// prepareFrameQueue
+//////////////////////////////////////////////////////
+IOReturn DVFileSource::prepareFrameQueue(DVTransmitter *pTransmitter)
+{
+	DVTransmitFrame *pFrame;
+	
+	if (!pTransmitter)
+		return kIOReturnBadArgument;
+	
+	if (fileDescriptor == -1)
+		return kIOReturnNotOpen;
+	
+	// The transmitter's frame buffers must be the size of our frames
+	pFrame = pTransmitter->getFrame(0);
+	if ((!pFrame) || (pFrame->frameLen != frameSize))
+	{
+		logger->log("\nDVFileSource Error: Transmitter frame size doesn't match the file's DV mode\n\n");
+		return kIOReturnBadArgument;
+	}
+	
+	return frameReader.prepareFrameQueue(pTransmitter);
+}
+
+//////////////////////////////////////////////////////
+// seekToFrame
+//////////////////////////////////////////////////////
+IOReturn DVFileSource::seekToFrame(UInt32 frameNumber)
+{
+	if (fileDescriptor == -1)
+		return kIOReturnNotOpen;
+	
+	if (frameNumber >= numFileFrames)
+		return kIOReturnBadArgument;
+	
+	frameReader.lock();
+	nextReadFrame = frameNumber;
+	readFailed = false;
+	frameReader.discardReadFrames();
+	frameReader.unlock();
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// setLoopMode
+//////////////////////////////////////////////////////
+void DVFileSource::setLoopMode(bool loopMode)
+{
+	frameReader.lock();
+	loopFile = loopMode;
+	if (loopFile == true)
+	{
+		// If the reader stopped at the end of the file, get it going again
+		readFailed = false;
+		frameReader.dataAdded();
+	}
+	frameReader.unlock();
+}
+
+//////////////////////////////////////////////////////
+// isPlaybackComplete
+//////////////////////////////////////////////////////
+bool DVFileSource::isPlaybackComplete(void)
+{
+	return frameReader.isPlaybackComplete();
+}
+
+//////////////////////////////////////////////////////
+// getStats
+//////////////////////////////////////////////////////
+IOReturn DVFileSource::getStats(DVFileSourceStats *pStats)
+{
+	DVFrameReaderStats readerStats;
+	
+	if (!pStats)
+		return kIOReturnBadArgument;
+	
+	frameReader.getStats(&readerStats);
+	pStats->prefetchDepth = readerStats.prefetchDepth;
+	pStats->minPrefetchDepth = readerStats.minPrefetchDepth;
+	pStats->framesRead = readerStats.framesRead;
+	pStats->framesTransmitted = readerStats.framesTransmitted;
+	pStats->underruns = readerStats.underruns;
+	pStats->readErrors = readerStats.readErrors;
+	
+	// loops is written by the reader thread, under the reader's mutex
+	frameReader.lock();
+	pStats->loops = loops;
+	frameReader.unlock();
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// FramePull
+//////////////////////////////////////////////////////
+IOReturn DVFileSource::FramePull(UInt32 *pFrameIndex, void *pRefCon)
+{
+	DVFileSource *pSource = (DVFileSource*) pRefCon;
+	
+	// Called on the transmitter's DCL callback thread. The reader never blocks here.
+	return pSource->frameReader.pullFrame(pFrameIndex);
+}
+
+//////////////////////////////////////////////////////
+// FrameRelease
+//////////////////////////////////////////////////////
+IOReturn DVFileSource::FrameRelease(UInt32 frameIndex, void *pRefCon)
+{
+	DVFileSource *pSource = (DVFileSource*) pRefCon;
+	
+	// Called on the transmitter's DCL callback thread. The reader never blocks here.
+	return pSource->frameReader.releaseFrame(frameIndex);
+}
+
+//////////////////////////////////////////////////////
+// ReaderNextRead
+//////////////////////////////////////////////////////
+bool DVFileSource::ReaderNextRead(DVFrameReaderRead *pRead, void *pRefCon)
+{
+	DVFileSource *pSource = (DVFileSource*) pRefCon;
+	
+	// A failed read is treated like the end of the file, rather than retrying forever
+	if (pSource->readFailed == true)
+		return false;
+	
+	// Handle the end of the file
+	if (pSource->nextReadFrame >= pSource->numFileFrames)
+	{
+		if (pSource->loopFile == false)
+			return false;
+		pSource->nextReadFrame = 0;
+		pSource->loops += 1;
+	}
+	
+	pRead->fileDescriptor = pSource->fileDescriptor;
+	pRead->offset = ((off_t) pSource->nextReadFrame) * pSource->frameSize;
+	pRead->length = pSource->frameSize;
+	pRead->pClientItem = nil;
+	pRead->clientFrame = pSource->nextReadFrame;
+	
+	return true;
+}
+
+//////////////////////////////////////////////////////
+// ReaderReadDone
+//////////////////////////////////////////////////////
+bool DVFileSource::ReaderReadDone(DVFrameReaderRead *pRead, UInt32 frameIndex, bool readOK, void *pRefCon)
+{
+	DVFileSource *pSource = (DVFileSource*) pRefCon;
+	
+	if (readOK == false)
+	{
+		pSource->logger->log("\nDVFileSource Error: Read of frame %u failed\n\n",(unsigned int) pRead->clientFrame);
+		pSource->readFailed = true;
+		return false;
+	}
+	
+	pSource->nextReadFrame = pRead->clientFrame + 1;
+	return true;
+}
+
+//////////////////////////////////////////////////////
+// ReaderRewind
+//////////////////////////////////////////////////////
+IOReturn DVFileSource::ReaderRewind(UInt32 firstUnsentFrame, UInt32 numUnsentFrames, UInt32 numFrames, void *pRefCon)
+{
+	DVFileSource *pSource = (DVFileSource*) pRefCon;
+	UInt32 i;
+	
+	// The frames read for a previous run were never sent, so read them again
+	i = numUnsentFrames % pSource->numFileFrames;
+	if (pSource->nextReadFrame >= i)
+		pSource->nextReadFrame -= i;
+	else
+		pSource->nextReadFrame += (pSource->numFileFrames - i);
+	pSource->readFailed = false;
+	
+	return kIOReturnSuccess;
+}
+
+} // namespace AVS
@@ -0,0 +1,161 @@
+/*
+	File:		DVFileSource.h
+ 
+ Synopsis: Plays a DV file through a DVTransmitter, reading frames ahead on a separate thread.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVFILESOURCE__
+#define __AVCVIDEOSERVICES_DVFILESOURCE__
+
+namespace AVS
+{
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  DVFileSource: Supplies DV frames from a file to a DVTransmitter without doing any
+//  file i/o on the transmitter's DCL callback thread.
+//
+//  A dedicated reader thread (a DVFrameReader) reads frames from the file with pread(),
+//  directly into the DVTransmitter's own frame buffers, as soon as the transmitter
+//  releases them. The static FramePull and FrameRelease helpers, registered with the
+//  transmitter (passing the DVFileSource object as the refcon), only move frame indices
+//  through the reader's lock-free ready and free rings, so they never wait on the disk,
+//  or on a mutex the reader thread or the client could be holding. The prefetch
+//  depth is the number of transmitter frame buffers not currently being sent, so
+//  it is set by the numFrameBuffers parameter used when creating the transmitter.
+//
+//  If the reader thread falls behind, FramePull returns an error, which causes the
+//  transmitter to repeat the previous frame. These underruns are counted.
+//
+//  The client must call prepareFrameQueue() from its DVTransmitter message proc,
+//  when it receives the kDVTransmitterPreparePacketFetcher message.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+// Struct to hold the source's stats
+struct DVFileSourceStats
+{
+	UInt32 prefetchDepth;		// Frames read and waiting to be transmitted
+	UInt32 minPrefetchDepth;	// The low-water mark of prefetchDepth, since the last prepareFrameQueue
+	UInt32 framesRead;			// Frames read from the file by the reader thread
+	UInt32 framesTransmitted;	// Frames handed to the transmitter
+	UInt32 underruns;			// Frame pulls with no frame ready (the previous frame was repeated)
+	UInt32 loops;				// Number of times the reader wrapped to the start of the file
+	UInt32 readErrors;			// Number of failed (or short) reads
+};
+
+//
+// The DVFileSource Class Declaration
+//
+class DVFileSource
+{
+	
+public:
+	// Constructor
+	DVFileSource(StringLogger *stringLogger = nil);
+	
+	// Destructor
+	~DVFileSource();
+	
+	// Open the file, determine its DV mode, and start the reader thread
+	IOReturn openFile(const char *pFileName, bool loopMode = false);
+	
+	// Stop the reader thread, and close the file. The transmitter must be stopped first.
+	IOReturn closeFile(void);
+	
+	// The DV mode and number of frames in the open file
+	UInt8 getDVMode(void);
+	UInt32 getNumFileFrames(void);
+	
+	// Take ownership of all of the transmitter's frames, and wait for the reader
+	// thread to fill them. Call this from the DVTransmitter message proc, for the
+	// kDVTransmitterPreparePacketFetcher message.
+	IOReturn prepareFrameQueue(DVTransmitter *pTransmitter);
+	
+	// Discard the prefetched frames, and continue reading at the specified frame
+	IOReturn seekToFrame(UInt32 frameNumber);
+	
+	// Enable or disable wrapping to the start of the file at the end
+	void setLoopMode(bool loopMode);
+	
+	// True once the end of the file was reached (and not looping), and the
+	// transmitter has been given enough time to send out all of its frames
+	bool isPlaybackComplete(void);
+	
+	// Get a snapshot of the source's stats. Takes the reader's mutex,
+	// so don't call it from the transmitter's callbacks.
+	IOReturn getStats(DVFileSourceStats *pStats);
+	
+	// Helpers that can be registered as DVTransmitter frame callbacks (pRefCon is the DVFileSource)
+	static IOReturn FramePull(UInt32 *pFrameIndex, void *pRefCon);
+	static IOReturn FrameRelease(UInt32 frameIndex, void *pRefCon);
+	
+private:
+	
+	// DVFrameReader callbacks (pRefCon is the DVFileSource), called with the reader's mutex held
+	static bool ReaderNextRead(DVFrameReaderRead *pRead, void *pRefCon);
+	static bool ReaderReadDone(DVFrameReaderRead *pRead, UInt32 frameIndex, bool readOK, void *pRefCon);
+	static IOReturn ReaderRewind(UInt32 firstUnsentFrame, UInt32 numUnsentFrames, UInt32 numFrames, void *pRefCon);
+	
+	StringLogger *logger;
+	bool noLogger;
+	
+	int fileDescriptor;
+	UInt8 dvMode;
+	UInt32 frameSize;
+	UInt32 numFileFrames;
+	bool loopFile;
+	
+	// The reader thread, and the frame queues. nextReadFrame, readFailed,
+	// and loops are guarded by the reader's mutex.
+	DVFrameReader frameReader;
+	
+	// The next file frame the reader thread will read
+	UInt32 nextReadFrame;
+	bool readFailed;
+	UInt32 loops;
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVFILESOURCE__
@@ -0,0 +1,431 @@
+/*
+	File:		DVFrameBufferPool.cpp
+ 
+ Synopsis: This is the implementation file for the DVFrameBufferPool class.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+namespace AVS
+{
+
+// The pool used by DV objects created from now on
+static DVFrameBufferPool *pSharedDVFrameBufferPool = nil;
+
+/////////////////////////////////////////////////////////
+// Constructor
+/////////////////////////////////////////////////////////
+DVFrameBufferPool::DVFrameBufferPool(StringLogger *stringLogger, bool allowGrowth)
+{
+	UInt32 i,j;
+	UInt32 frameSize;
+	
+	logger = stringLogger;
+	growthAllowed = allowGrowth;
+	numSizeClasses = 0;
+	totalBytes = 0;
+	largePageBytes = 0;
+	
+	// Make a size class for each distinct frame size in the dvFormats table, smallest first
+	for (i=0;dvFormats[i].frameSize != 0;i++)
+	{
+		frameSize = dvFormats[i].frameSize;
+		for (j=0;j<numSizeClasses;j++)
+			if (sizeClassStats[j].bufferSize >= frameSize)
+				break;
+		if ((j < numSizeClasses) && (sizeClassStats[j].bufferSize == frameSize))
+			continue;
+		if (numSizeClasses == kDVFrameBufferPoolMaxSizeClasses)
+			break;
+		
+		memmove(&sizeClassStats[j+1],&sizeClassStats[j],(numSizeClasses-j)*sizeof(DVFrameBufferPoolSizeClassStats));
+		bzero(&sizeClassStats[j],sizeof(DVFrameBufferPoolSizeClassStats));
+		sizeClassStats[j].bufferSize = frameSize;
+		numSizeClasses += 1;
+	}
+	
+	// Each buffer, with its header, starts on its own page
+	for (i=0;i<numSizeClasses;i++)
+	{
+		bufferStride[i] = (kDVFrameBufferPoolBufferHeaderSize + sizeClassStats[i].bufferSize + vm_page_size - 1) & ~(vm_page_size - 1);
+		freeBuffers[i] = 0;
+		pFreeList[i] = nil;
+	}
+	
+	// Initialize the pool mutex
+	pthread_mutex_init(&poolMutex,NULL);
+}
+
+/////////////////////////////////////////////////////////
+// Destructor
+/////////////////////////////////////////////////////////
+DVFrameBufferPool::~DVFrameBufferPool()
+{
+	UInt32 i;
+	
+	for (i=0;i<numSizeClasses;i++)
+	{
+		if ((sizeClassStats[i].buffersInUse > 0) && (logger))
+			logger->log("DVFrameBufferPool Error: Deleting pool with %u buffers of size %u still in use\n",
+						(unsigned int) sizeClassStats[i].buffersInUse,
+						(unsigned int) sizeClassStats[i].bufferSize);
+	}
+	
+	// Free the slabs
+	while (!slabs.empty())
+	{
+		vm_deallocate(mach_task_self(), (vm_address_t) slabs.front().pMemory, slabs.front().size);
+		slabs.pop_front();
+	}
+	
+	// Release the pool mutex
+	pthread_mutex_destroy(&poolMutex);
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameBufferPool::reserveBuffers
+/////////////////////////////////////////////////////////
+IOReturn DVFrameBufferPool::reserveBuffers(UInt32 bufferSize, UInt32 numBuffers)
+{
+	IOReturn result = kIOReturnSuccess;
+	int sizeClass;
+	
+	sizeClass = findSizeClass(bufferSize);
+	if (sizeClass < 0)
+		return kIOReturnBadArgument;
+	
+	// Lock the pool mutex
+	pthread_mutex_lock(&poolMutex);
+	
+	if (freeBuffers[sizeClass] < numBuffers)
+		result = addSlab(sizeClass, (numBuffers - freeBuffers[sizeClass]));
+	
+	// Unlock the pool mutex
+	pthread_mutex_unlock(&poolMutex);
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameBufferPool::reserveBuffersForDVMode
+/////////////////////////////////////////////////////////
+IOReturn DVFrameBufferPool::reserveBuffersForDVMode(UInt8 dvMode, UInt32 numBuffers)
+{
+	UInt32 i;
+	
+	// Find the frame size for this mode, disregarding the speed bits
+	for (i=0;dvFormats[i].frameSize != 0;i++)
+	{
+		if ((dvMode & 0xFC) == dvFormats[i].mode)
+			return reserveBuffers(dvFormats[i].frameSize, numBuffers);
+	}
+	
+	return kIOReturnBadArgument;
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameBufferPool::allocateBuffer
+/////////////////////////////////////////////////////////
+UInt8* DVFrameBufferPool::allocateBuffer(UInt32 bufferSize)
+{
+	DVFrameBufferPoolBufferHeader *pBuffer = nil;
+	UInt32 growBuffers;
+	int sizeClass;
+	
+	sizeClass = findSizeClass(bufferSize);
+	if (sizeClass < 0)
+	{
+		if (logger)
+			logger->log("DVFrameBufferPool Error: No size class for buffer size %u\n",(unsigned int) bufferSize);
+		return nil;
+	}
+	
+	// Lock the pool mutex
+	pthread_mutex_lock(&poolMutex);
+	
+	// If we're out of buffers, and we're allowed to, double the size class,
+	// so a pool that wasn't reserved up front only grows a few times
+	if ((pFreeList[sizeClass] == nil) && (growthAllowed == true))
+	{
+		growBuffers = sizeClassStats[sizeClass].totalBuffers;
+		if (growBuffers > kDVFrameBufferPoolMaxGrowBuffers)
+			growBuffers = kDVFrameBufferPoolMaxGrowBuffers;
+		else if (growBuffers == 0)
+			growBuffers = 1;
+		
+		sizeClassStats[sizeClass].growAllocations += 1;
+		addSlab(sizeClass, growBuffers);
+	}
+	
+	pBuffer = pFreeList[sizeClass];
+	if (pBuffer)
+	{
+		pFreeList[sizeClass] = pBuffer->pNext;
+		freeBuffers[sizeClass] -= 1;
+		sizeClassStats[sizeClass].buffersInUse += 1;
+		if (sizeClassStats[sizeClass].buffersInUse > sizeClassStats[sizeClass].maxBuffersInUse)
+			sizeClassStats[sizeClass].maxBuffersInUse = sizeClassStats[sizeClass].buffersInUse;
+	}
+	else
+		sizeClassStats[sizeClass].failedAllocations += 1;
+	
+	// Unlock the pool mutex
+	pthread_mutex_unlock(&poolMutex);
+	
+	if (pBuffer)
+		return ((UInt8*) pBuffer) + kDVFrameBufferPoolBufferHeaderSize;
+	else
+		return nil;
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameBufferPool::releaseBuffer
+/////////////////////////////////////////////////////////
+void DVFrameBufferPool::releaseBuffer(UInt8 *pBuffer)
+{
+	DVFrameBufferPoolBufferHeader *pHeader;
+	DVFrameBufferPoolSlab *pSlab = nil;
+	
+	if (pBuffer == nil)
+		return;
+	
+	pHeader = (DVFrameBufferPoolBufferHeader*) (pBuffer - kDVFrameBufferPoolBufferHeaderSize);
+	
+	// Lock the pool mutex
+	pthread_mutex_lock(&poolMutex);
+	
+	// The header names the slab this buffer came from. Make sure it really did.
+	if (pHeader->slabIndex < slabs.size())
+	{
+		pSlab = &slabs[pHeader->slabIndex];
+		if ((((UInt8*) pHeader) < pSlab->pMemory) || (((UInt8*) pHeader) >= (pSlab->pMemory + pSlab->size)) ||
+			(((((UInt8*) pHeader) - pSlab->pMemory) % bufferStride[pSlab->sizeClass]) != 0))
+			pSlab = nil;
+	}
+	
+	if (pSlab)
+	{
+		pHeader->pNext = pFreeList[pSlab->sizeClass];
+		pFreeList[pSlab->sizeClass] = pHeader;
+		freeBuffers[pSlab->sizeClass] += 1;
+		sizeClassStats[pSlab->sizeClass].buffersInUse -= 1;
+	}
+	else if (logger)
+		logger->log("DVFrameBufferPool Error: Releasing buffer not allocated from this pool\n");
+	
+	// Unlock the pool mutex
+	pthread_mutex_unlock(&poolMutex);
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameBufferPool::getStats
+/////////////////////////////////////////////////////////
+IOReturn DVFrameBufferPool::getStats(DVFrameBufferPoolStats *pStats)
+{
+	if (!pStats)
+		return kIOReturnBadArgument;
+	
+	// Lock the pool mutex
+	pthread_mutex_lock(&poolMutex);
+	
+	bzero(pStats, sizeof(DVFrameBufferPoolStats));
+	pStats->numSizeClasses = numSizeClasses;
+	memcpy(pStats->sizeClass, sizeClassStats, numSizeClasses*sizeof(DVFrameBufferPoolSizeClassStats));
+	pStats->totalBytes = totalBytes;
+	pStats->largePageBytes = largePageBytes;
+	
+	// Unlock the pool mutex
+	pthread_mutex_unlock(&poolMutex);
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameBufferPool::logStats
+/////////////////////////////////////////////////////////
+void DVFrameBufferPool::logStats(void)
+{
+	DVFrameBufferPoolStats stats;
+	UInt32 i;
+	
+	if (!logger)
+		return;
+	
+	getStats(&stats);
+	
+	logger->log("DVFrameBufferPool Stats: totalBytes=%llu largePageBytes=%llu\n",stats.totalBytes,stats.largePageBytes);
+	for (i=0;i<stats.numSizeClasses;i++)
+	{
+		if (stats.sizeClass[i].totalBuffers == 0)
+			continue;
+		logger->log("DVFrameBufferPool Stats: size=%u total=%u inUse=%u maxInUse=%u grows=%u failures=%u\n",
+					(unsigned int) stats.sizeClass[i].bufferSize,
+					(unsigned int) stats.sizeClass[i].totalBuffers,
+					(unsigned int) stats.sizeClass[i].buffersInUse,
+					(unsigned int) stats.sizeClass[i].maxBuffersInUse,
+					(unsigned int) stats.sizeClass[i].growAllocations,
+					(unsigned int) stats.sizeClass[i].failedAllocations);
+	}
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameBufferPool::findSizeClass
+/////////////////////////////////////////////////////////
+int DVFrameBufferPool::findSizeClass(UInt32 bufferSize)
+{
+	UInt32 i;
+	
+	// The smallest class the buffer fits in
+	for (i=0;i<numSizeClasses;i++)
+	{
+		if (bufferSize <= sizeClassStats[i].bufferSize)
+			return i;
+	}
+	
+	return -1;
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameBufferPool::addSlab
+/////////////////////////////////////////////////////////
+IOReturn DVFrameBufferPool::addSlab(UInt32 sizeClass, UInt32 numBuffers)
+{
+	DVFrameBufferPoolSlab slab;
+	DVFrameBufferPoolBufferHeader *pHeader;
+	kern_return_t kr = KERN_FAILURE;
+	UInt32 offset;
+	UInt32 slabBuffers;
+	
+	slab.pMemory = nil;
+	slab.size = bufferStride[sizeClass] * numBuffers;
+	slab.sizeClass = sizeClass;
+	slab.largePages = false;
+	
+#ifdef VM_FLAGS_SUPERPAGE_SIZE_2MB
+	// Try large pages first, rounding up to a whole number of them. Any
+	// extra space just becomes more buffers.
+	slab.size = (slab.size + kDVFrameBufferPoolLargePageSize - 1) & ~(kDVFrameBufferPoolLargePageSize - 1);
+	kr = vm_allocate(mach_task_self(), (vm_address_t *)&slab.pMemory, slab.size, VM_FLAGS_ANYWHERE | VM_FLAGS_SUPERPAGE_SIZE_2MB);
+	if (kr == KERN_SUCCESS)
+		slab.largePages = true;
+	else
+		slab.size = bufferStride[sizeClass] * numBuffers;
+#endif
+	
+	if (kr != KERN_SUCCESS)
+	{
+		kr = vm_allocate(mach_task_self(), (vm_address_t *)&slab.pMemory, slab.size, VM_FLAGS_ANYWHERE);
+		if (kr != KERN_SUCCESS)
+		{
+			if (logger)
+				logger->log("DVFrameBufferPool Error: Unable to allocate %u bytes\n",(unsigned int) slab.size);
+			return kIOReturnNoMemory;
+		}
+	}
+	
+	// Touch every page now, so clients never take a page fault on a new buffer
+	for (offset=0;offset<slab.size;offset+=vm_page_size)
+		slab.pMemory[offset] = 0;
+	
+	// Carve the slab up into buffers
+	slabBuffers = slab.size / bufferStride[sizeClass];
+	for (offset=0;offset<(slabBuffers*bufferStride[sizeClass]);offset+=bufferStride[sizeClass])
+	{
+		pHeader = (DVFrameBufferPoolBufferHeader*) &slab.pMemory[offset];
+		pHeader->slabIndex = slabs.size();
+		pHeader->pNext = pFreeList[sizeClass];
+		pFreeList[sizeClass] = pHeader;
+	}
+	freeBuffers[sizeClass] += slabBuffers;
+	sizeClassStats[sizeClass].totalBuffers += slabBuffers;
+	
+	slabs.push_back(slab);
+	totalBytes += slab.size;
+	if (slab.largePages == true)
+		largePageBytes += slab.size;
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// SetDVFrameBufferPool
+//////////////////////////////////////////////////////
+void SetDVFrameBufferPool(DVFrameBufferPool *pPool)
+{
+	pSharedDVFrameBufferPool = pPool;
+}
+
+//////////////////////////////////////////////////////
+// GetDVFrameBufferPool
+//////////////////////////////////////////////////////
+DVFrameBufferPool *GetDVFrameBufferPool(void)
+{
+	return pSharedDVFrameBufferPool;
+}
+
+//////////////////////////////////////////////////////
+// AllocateDVFrameBuffer
+//////////////////////////////////////////////////////
+UInt8 *AllocateDVFrameBuffer(DVFrameBufferPool *pPool, UInt32 bufferSize)
+{
+	if (pPool)
+		return pPool->allocateBuffer(bufferSize);
+	else
+		return new UInt8[bufferSize];
+}
+
+//////////////////////////////////////////////////////
+// FreeDVFrameBuffer
+//////////////////////////////////////////////////////
+void FreeDVFrameBuffer(DVFrameBufferPool *pPool, UInt8 *pBuffer)
+{
+	if (pBuffer == nil)
+		return;
+	
+	if (pPool)
+		pPool->releaseBuffer(pBuffer);
+	else
+		delete [] pBuffer;
+}
+
+} // namespace AVS
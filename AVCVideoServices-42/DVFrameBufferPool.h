@@ -0,0 +1,169 @@
+/*
+	File:		DVFrameBufferPool.h
+ 
+ Synopsis: This is the header file for the DVFrameBufferPool class.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVFRAMEBUFFERPOOL__
+#define __AVCVIDEOSERVICES_DVFRAMEBUFFERPOOL__
+
+namespace AVS
+{
+
+// Misc constants
+enum
+{
+	kDVFrameBufferPoolMaxSizeClasses = 16,
+	kDVFrameBufferPoolLargePageSize = (2*1024*1024),
+	kDVFrameBufferPoolBufferHeaderSize = 64,	// Keeps the frame data cache line aligned
+	kDVFrameBufferPoolMaxGrowBuffers = 16		// The most buffers allocateBuffer adds at once
+};
+
+// Occupancy of one buffer size class of a DVFrameBufferPool
+struct DVFrameBufferPoolSizeClassStats
+{
+	UInt32 bufferSize;
+	UInt32 totalBuffers;
+	UInt32 buffersInUse;
+	UInt32 maxBuffersInUse;
+	UInt32 growAllocations;		// Times the pool had to allocate memory to satisfy allocateBuffer
+	UInt32 failedAllocations;	// Times allocateBuffer returned nil
+};
+
+// Occupancy of a DVFrameBufferPool
+struct DVFrameBufferPoolStats
+{
+	UInt32 numSizeClasses;
+	DVFrameBufferPoolSizeClassStats sizeClass[kDVFrameBufferPoolMaxSizeClasses];
+	UInt64 totalBytes;			// Memory allocated by the pool
+	UInt64 largePageBytes;		// How much of that is backed by large pages
+};
+
+// A block of memory the pool carves buffers out of
+struct DVFrameBufferPoolSlab
+{
+	UInt8 *pMemory;
+	UInt32 size;
+	UInt32 sizeClass;
+	bool largePages;
+};
+
+//
+// The DVFrameBufferPool Class Declaration
+//
+// A thread-safe allocator for DV frame buffers, with one size class per frame
+// size in the dvFormats table. Buffers are carved out of large vm_allocate'd slabs
+// (using large pages where the system supports them), which are touched when
+// allocated, so handing out a buffer never faults or allocates once the pool
+// has been warmed up with reserveBuffers. Each buffer has a small header in
+// front of it, naming the slab it came from, so releasing a buffer doesn't
+// depend on how many slabs the pool has. When a size class runs out, and growth
+// is allowed, it's doubled (up to kDVFrameBufferPoolMaxGrowBuffers more buffers).
+//
+class DVFrameBufferPool
+{
+	
+public:
+	// Constructor. If allowGrowth is false, allocateBuffer fails, rather than
+	// allocate more memory, when a size class has no free buffers.
+	DVFrameBufferPool(StringLogger *stringLogger = nil, bool allowGrowth = true);
+	
+	// Destructor. All buffers must have been released before this is called!
+	~DVFrameBufferPool();
+	
+	// Make sure the pool has at least numBuffers free buffers of at least bufferSize bytes
+	IOReturn reserveBuffers(UInt32 bufferSize, UInt32 numBuffers);
+	
+	// Same as above, for frames of the specified DV mode
+	IOReturn reserveBuffersForDVMode(UInt8 dvMode, UInt32 numBuffers);
+	
+	// Get a buffer of at least bufferSize bytes, or nil if none available
+	UInt8* allocateBuffer(UInt32 bufferSize);
+	
+	// Return a buffer to the pool
+	void releaseBuffer(UInt8 *pBuffer);
+	
+	// Get the pool's occupancy
+	IOReturn getStats(DVFrameBufferPoolStats *pStats);
+	
+	// Log the pool's occupancy
+	void logStats(void);
+	
+private:
+	
+	// Sits kDVFrameBufferPoolBufferHeaderSize bytes in front of each buffer
+	struct DVFrameBufferPoolBufferHeader
+	{
+		DVFrameBufferPoolBufferHeader *pNext;	// Next free buffer of the same size class
+		UInt32 slabIndex;
+	};
+	
+	int findSizeClass(UInt32 bufferSize);
+	IOReturn addSlab(UInt32 sizeClass, UInt32 numBuffers);
+	
+	StringLogger *logger;
+	bool growthAllowed;
+	pthread_mutex_t poolMutex;
+	UInt32 numSizeClasses;
+	UInt32 bufferStride[kDVFrameBufferPoolMaxSizeClasses];
+	UInt32 freeBuffers[kDVFrameBufferPoolMaxSizeClasses];
+	DVFrameBufferPoolBufferHeader *pFreeList[kDVFrameBufferPoolMaxSizeClasses];
+	DVFrameBufferPoolSizeClassStats sizeClassStats[kDVFrameBufferPoolMaxSizeClasses];
+	std::deque<DVFrameBufferPoolSlab> slabs;
+	UInt64 totalBytes;
+	UInt64 largePageBytes;
+};
+
+// Set the pool that DVFramer, DVReceiver, and DVTransmitter objects created after this call
+// get their frame buffers from. The default, nil, means each object allocates its own with new[].
+// The pool must not be deleted while any of those objects exist.
+void SetDVFrameBufferPool(DVFrameBufferPool *pPool);
+DVFrameBufferPool *GetDVFrameBufferPool(void);
+
+// Allocate/free a DV frame buffer from a pool, or with new[]/delete[] if the pool is nil
+UInt8 *AllocateDVFrameBuffer(DVFrameBufferPool *pPool, UInt32 bufferSize);
+void FreeDVFrameBuffer(DVFrameBufferPool *pPool, UInt8 *pBuffer);
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVFRAMEBUFFERPOOL__
@@ -0,0 +1,177 @@
+/*
+	File:		DVFrameIndexRing.cpp
+ 
+ Synopsis: A lock-free ring of frame indices, passed from one producer thread to one consumer thread.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+namespace AVS
+{
+
+//////////////////////////////////////////////////////
+// Constructor
+//////////////////////////////////////////////////////
+DVFrameIndexRing::DVFrameIndexRing()
+{
+	pValues = nil;
+	capacity = 0;
+	pushCount = 0;
+	popCount = 0;
+}
+
+//////////////////////////////////////////////////////
+// Destructor
+//////////////////////////////////////////////////////
+DVFrameIndexRing::~DVFrameIndexRing()
+{
+	if (pValues)
+		delete [] pValues;
+}
+
+//////////////////////////////////////////////////////
+// setup
+//////////////////////////////////////////////////////
+IOReturn DVFrameIndexRing::setup(UInt32 ringCapacity)
+{
+	if (ringCapacity == 0)
+		return kIOReturnBadArgument;
+	
+	if (ringCapacity != capacity)
+	{
+		if (pValues)
+			delete [] pValues;
+		capacity = 0;
+		
+		pValues = new UInt32[ringCapacity];
+		if (!pValues)
+			return kIOReturnNoMemory;
+		capacity = ringCapacity;
+	}
+	
+	reset();
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// reset
+//////////////////////////////////////////////////////
+void DVFrameIndexRing::reset(void)
+{
+	pushCount = 0;
+	popCount = 0;
+	OSMemoryBarrier();
+}
+
+//////////////////////////////////////////////////////
+// push
+//////////////////////////////////////////////////////
+bool DVFrameIndexRing::push(UInt32 value)
+{
+	UInt32 tail = pushCount;
+	
+	if (used(popCount,tail) >= capacity)
+		return false;
+	
+	pValues[tail % capacity] = value;
+	
+	// The value must be visible before the consumer can see the new count
+	OSMemoryBarrier();
+	pushCount = ((tail + 1) < (capacity * 2)) ? (tail + 1) : 0;
+	
+	return true;
+}
+
+//////////////////////////////////////////////////////
+// pop
+//////////////////////////////////////////////////////
+bool DVFrameIndexRing::pop(UInt32 *pValue)
+{
+	UInt32 head = popCount;
+	
+	if (pushCount == head)
+		return false;
+	
+	// Don't read the value until we've seen the producer's count
+	OSMemoryBarrier();
+	*pValue = pValues[head % capacity];
+	
+	// The value must be read before the producer can reuse its slot
+	OSMemoryBarrier();
+	popCount = ((head + 1) < (capacity * 2)) ? (head + 1) : 0;
+	
+	return true;
+}
+
+//////////////////////////////////////////////////////
+// count
+//////////////////////////////////////////////////////
+UInt32 DVFrameIndexRing::count(void)
+{
+	UInt32 head = popCount;
+	UInt32 tail = pushCount;
+	UInt32 numValues = used(head,tail);
+	
+	// Off the producer and consumer threads, the two counts may be
+	// read at different times, so keep the result within range
+	return (numValues <= capacity) ? numValues : capacity;
+}
+
+//////////////////////////////////////////////////////
+// used
+//////////////////////////////////////////////////////
+UInt32 DVFrameIndexRing::used(UInt32 head, UInt32 tail)
+{
+	return (tail >= head) ? (tail - head) : ((capacity * 2) + tail - head);
+}
+
+//////////////////////////////////////////////////////
+// getCapacity
+//////////////////////////////////////////////////////
+UInt32 DVFrameIndexRing::getCapacity(void)
+{
+	return capacity;
+}
+
+} // namespace AVS
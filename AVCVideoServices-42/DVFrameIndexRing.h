@@ -0,0 +1,109 @@
+/*
+	File:		DVFrameIndexRing.h
+ 
+ Synopsis: A lock-free ring of frame indices, passed from one producer thread to one consumer thread.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVFRAMEINDEXRING__
+#define __AVCVIDEOSERVICES_DVFRAMEINDEXRING__
+
+namespace AVS
+{
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  DVFrameIndexRing: A fixed-capacity fifo of UInt32 values (normally frame indices)
+//  for handing frames from exactly one producer thread to exactly one consumer thread,
+//  without locks. push() and pop() never block, and never make a system call, so they
+//  are safe to use on a DCL callback thread.
+//
+//  Only the producer may call push(), and only the consumer may call pop(). Either side,
+//  or any other thread, may call count(), which is exact on the producer and consumer
+//  threads, and a snapshot everywhere else. setup() and reset() may only be called while
+//  neither side is using the ring.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+class DVFrameIndexRing
+{
+	
+public:
+	// Constructor
+	DVFrameIndexRing();
+	
+	// Destructor
+	~DVFrameIndexRing();
+	
+	// Allocate room for capacity values, and empty the ring
+	IOReturn setup(UInt32 ringCapacity);
+	
+	// Empty the ring
+	void reset(void);
+	
+	// Add a value at the tail. Returns false if the ring is full.
+	bool push(UInt32 value);
+	
+	// Remove the value at the head. Returns false if the ring is empty.
+	bool pop(UInt32 *pValue);
+	
+	// The number of values in the ring
+	UInt32 count(void);
+	
+	UInt32 getCapacity(void);
+	
+private:
+	UInt32 *pValues;
+	UInt32 capacity;
+	
+	// Counts of pushed and popped values, modulo twice the capacity, so that a full
+	// ring can be told from an empty one. Each is written by one thread only.
+	volatile UInt32 pushCount;
+	volatile UInt32 popCount;
+	
+	// The number of values between popCount and pushCount
+	UInt32 used(UInt32 head, UInt32 tail);
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVFRAMEINDEXRING__
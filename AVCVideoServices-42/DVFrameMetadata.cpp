@@ -0,0 +1,323 @@
+/*
+	File:		DVFrameMetadata.cpp
+ 
+ Synopsis: This is the implementation file for the DV frame metadata extraction functions.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+namespace AVS
+{
+
+// Pack headers
+enum
+{
+	kDVPackTitleTimeCode = 0x13,
+	kDVPackAAUXSource = 0x50,
+	kDVPackVAUXSourceControl = 0x61,
+	kDVPackRecDate = 0x62,
+	kDVPackRecTime = 0x63,
+	kDVPackNoInfo = 0xFF
+};
+
+// Where the packs are in the DIF blocks
+enum
+{
+	kDVSubcodeFirstBlock = 1,
+	kDVSubcodeBlocks = 2,
+	kDVSubcodePacksPerBlock = 6,
+	kDVSubcodePackOffset = 6,		// After the block ID, and the first sync block's ID and parity
+	kDVSubcodeSyncBlockSize = 8,
+	kDVVAUXFirstBlock = 3,
+	kDVVAUXBlocks = 3,
+	kDVVAUXPacksPerBlock = 15,
+	kDVVAUXPackOffset = 3,
+	kDVFirstAudioBlock = 6,
+	kDVAudioBlockInterval = 16,
+	kDVAudioBlocks = 9,
+	kDVAAUXPackOffset = 3,
+	kDVPackSize = 5
+};
+
+// Prototypes for static functions in this file
+static UInt8* ContiguousFrameDIFBlock_Helper(UInt32 frameOffset, void *pRefCon);
+static UInt8* FindPackInSubcode(DVFrameDIFBlockProc difBlockProc, void *pRefCon, UInt32 sequence, UInt8 packHeader);
+static UInt8* FindPackInVAUX(DVFrameDIFBlockProc difBlockProc, void *pRefCon, UInt32 sequence, UInt8 packHeader);
+static UInt8* FindPackInAAUX(DVFrameDIFBlockProc difBlockProc, void *pRefCon, UInt32 sequence, UInt8 packHeader);
+static bool DecodeBCD(UInt8 tens, UInt8 units, UInt8 maxValue, UInt8 *pValue);
+
+#define DIFBlockOffset(sequence,block) ((((sequence)*kDVDIFBlocksPerSequence)+(block))*kDVDIFBlockSize)
+
+//////////////////////////////////////////////////////
+// GetDVFrameMetadata
+//////////////////////////////////////////////////////
+IOReturn GetDVFrameMetadata(UInt8 *pFrameData, UInt32 frameLen, UInt8 dvMode, DVFrameMetadata *pMetadata)
+{
+	return GetDVFrameMetadataWithDIFBlockProc(ContiguousFrameDIFBlock_Helper, pFrameData, frameLen, dvMode, pMetadata);
+}
+
+//////////////////////////////////////////////////////
+// GetDVFrameMetadataWithDIFBlockProc
+//////////////////////////////////////////////////////
+IOReturn GetDVFrameMetadataWithDIFBlockProc(DVFrameDIFBlockProc difBlockProc,
+											void *pRefCon,
+											UInt32 frameLen,
+											UInt8 dvMode,
+											DVFrameMetadata *pMetadata)
+{
+	UInt32 numSequences;
+	UInt32 sequencesPerChannel;
+	UInt32 sequence;
+	UInt8 *pPack;
+	UInt8 year;
+	UInt8 smp;
+	UInt8 qu;
+	static const UInt32 sampleRates[3] = { 48000, 44100, 32000 };
+	static const UInt32 minSamplesPerFrame[2][3] = { { 1580, 1452, 1053 },		// 525-60
+													 { 1896, 1742, 1264 } };	// 625-50
+	
+	bzero(pMetadata, sizeof(DVFrameMetadata));
+	pMetadata->extracted = true;
+	pMetadata->aspectRatio = kDVAspectRatioUnknown;
+	
+	numSequences = frameLen / kDVDIFSequenceSize;
+	if (numSequences < 2)
+		return kIOReturnBadArgument;
+	
+	// SDL frames have half the DIF sequences of an SD frame
+	if (DVstype(dvMode) == 0x01)
+		sequencesPerChannel = numSequences;
+	else
+		sequencesPerChannel = (DVstandard(dvMode) == kDVStandardPAL) ? 12 : 10;
+	if (sequencesPerChannel > numSequences)
+		sequencesPerChannel = numSequences;
+	
+	// The title timecode is recorded in the subcode of the second half of the DIF
+	// sequences of the first channel. Fall back to the first half if it's not there.
+	pPack = FindPackInSubcode(difBlockProc, pRefCon, sequencesPerChannel/2, kDVPackTitleTimeCode);
+	if (pPack == nil)
+		pPack = FindPackInSubcode(difBlockProc, pRefCon, 0, kDVPackTitleTimeCode);
+	if (pPack != nil)
+	{
+		pMetadata->timeCodeDropFrame = ((pPack[1] & 0x40) != 0);
+		pMetadata->timeCodeValid = (DecodeBCD(((pPack[1] & 0x30) >> 4), (pPack[1] & 0x0F), 29, &pMetadata->timeCodeFrames) &&
+									DecodeBCD(((pPack[2] & 0x70) >> 4), (pPack[2] & 0x0F), 59, &pMetadata->timeCodeSeconds) &&
+									DecodeBCD(((pPack[3] & 0x70) >> 4), (pPack[3] & 0x0F), 59, &pMetadata->timeCodeMinutes) &&
+									DecodeBCD(((pPack[4] & 0x30) >> 4), (pPack[4] & 0x0F), 23, &pMetadata->timeCodeHours));
+	}
+	
+	// The rec date and time are in the VAUX of the even and odd DIF sequences,
+	// and often repeated in the subcode.
+	for (sequence=0;sequence<2;sequence++)
+	{
+		if (pMetadata->recDateValid == false)
+		{
+			pPack = FindPackInVAUX(difBlockProc, pRefCon, sequence, kDVPackRecDate);
+			if (pPack == nil)
+				pPack = FindPackInSubcode(difBlockProc, pRefCon, (sequencesPerChannel/2)+sequence, kDVPackRecDate);
+			if (pPack != nil)
+			{
+				pMetadata->recDateValid = (DecodeBCD(((pPack[2] & 0x30) >> 4), (pPack[2] & 0x0F), 31, &pMetadata->recDay) &&
+										   DecodeBCD(((pPack[3] & 0x10) >> 4), (pPack[3] & 0x0F), 12, &pMetadata->recMonth) &&
+										   DecodeBCD(((pPack[4] & 0xF0) >> 4), (pPack[4] & 0x0F), 99, &year));
+				if (pMetadata->recDateValid == true)
+					pMetadata->recYear = (year < 75) ? (2000 + year) : (1900 + year);
+			}
+		}
+		
+		if (pMetadata->recTimeValid == false)
+		{
+			pPack = FindPackInVAUX(difBlockProc, pRefCon, sequence, kDVPackRecTime);
+			if (pPack == nil)
+				pPack = FindPackInSubcode(difBlockProc, pRefCon, (sequencesPerChannel/2)+sequence, kDVPackRecTime);
+			if (pPack != nil)
+				pMetadata->recTimeValid = (DecodeBCD(((pPack[2] & 0x70) >> 4), (pPack[2] & 0x0F), 59, &pMetadata->recSeconds) &&
+										   DecodeBCD(((pPack[3] & 0x70) >> 4), (pPack[3] & 0x0F), 59, &pMetadata->recMinutes) &&
+										   DecodeBCD(((pPack[4] & 0x30) >> 4), (pPack[4] & 0x0F), 23, &pMetadata->recHours));
+		}
+		
+		if (pMetadata->aspectRatioValid == false)
+		{
+			pPack = FindPackInVAUX(difBlockProc, pRefCon, sequence, kDVPackVAUXSourceControl);
+			if (pPack != nil)
+			{
+				// DISP: 000 = 4:3, 010 = 16:9 letterbox, 111 = 16:9 squeeze
+				switch (pPack[2] & 0x07)
+				{
+					case 0x00:
+						pMetadata->aspectRatio = kDVAspectRatio4x3;
+						pMetadata->aspectRatioValid = true;
+						break;
+						
+					case 0x02:
+					case 0x07:
+						pMetadata->aspectRatio = kDVAspectRatio16x9;
+						pMetadata->aspectRatioValid = true;
+						break;
+						
+					default:
+						break;
+				}
+			}
+		}
+		
+		if (pMetadata->audioValid == false)
+		{
+			pPack = FindPackInAAUX(difBlockProc, pRefCon, sequence, kDVPackAAUXSource);
+			if (pPack != nil)
+			{
+				smp = ((pPack[4] & 0x38) >> 3);
+				qu = (pPack[4] & 0x07);
+				if ((smp < 3) && (qu < 3))
+				{
+					pMetadata->audioValid = true;
+					pMetadata->audioLocked = ((pPack[1] & 0x80) == 0);
+					pMetadata->audioSampleRate = sampleRates[smp];
+					pMetadata->audioSamplesPerFrame = minSamplesPerFrame[((pPack[3] & 0x20) != 0) ? 1 : 0][smp] + (pPack[1] & 0x3F);
+					pMetadata->audioBitsPerSample = (qu == 0) ? 16 : ((qu == 1) ? 12 : 20);
+					
+					// Two channels per channel of DIF sequences, or four in 32KHz 12-bit mode
+					pMetadata->audioChannels = 2 * (numSequences / sequencesPerChannel);
+					if ((pMetadata->audioSampleRate == 32000) && (pMetadata->audioBitsPerSample == 12))
+						pMetadata->audioChannels *= 2;
+				}
+			}
+		}
+	}
+	
+	// DV HD modes are always 16:9
+	if ((pMetadata->aspectRatioValid == false) && ((DVstype(dvMode) == 0x02) || (DVstype(dvMode) == 0x1C)))
+	{
+		pMetadata->aspectRatio = kDVAspectRatio16x9;
+		pMetadata->aspectRatioValid = true;
+	}
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// ContiguousFrameDIFBlock_Helper
+//////////////////////////////////////////////////////
+static UInt8* ContiguousFrameDIFBlock_Helper(UInt32 frameOffset, void *pRefCon)
+{
+	return ((UInt8*) pRefCon) + frameOffset;
+}
+
+//////////////////////////////////////////////////////
+// FindPackInSubcode
+//////////////////////////////////////////////////////
+static UInt8* FindPackInSubcode(DVFrameDIFBlockProc difBlockProc, void *pRefCon, UInt32 sequence, UInt8 packHeader)
+{
+	UInt8 *pBlock;
+	UInt32 block;
+	UInt32 pack;
+	
+	for (block=0;block<kDVSubcodeBlocks;block++)
+	{
+		pBlock = difBlockProc(DIFBlockOffset(sequence,(kDVSubcodeFirstBlock+block)), pRefCon);
+		if (pBlock == nil)
+			return nil;
+		for (pack=0;pack<kDVSubcodePacksPerBlock;pack++)
+		{
+			if (pBlock[kDVSubcodePackOffset+(pack*kDVSubcodeSyncBlockSize)] == packHeader)
+				return &pBlock[kDVSubcodePackOffset+(pack*kDVSubcodeSyncBlockSize)];
+		}
+	}
+	return nil;
+}
+
+//////////////////////////////////////////////////////
+// FindPackInVAUX
+//////////////////////////////////////////////////////
+static UInt8* FindPackInVAUX(DVFrameDIFBlockProc difBlockProc, void *pRefCon, UInt32 sequence, UInt8 packHeader)
+{
+	UInt8 *pBlock;
+	UInt32 block;
+	UInt32 pack;
+	
+	for (block=0;block<kDVVAUXBlocks;block++)
+	{
+		pBlock = difBlockProc(DIFBlockOffset(sequence,(kDVVAUXFirstBlock+block)), pRefCon);
+		if (pBlock == nil)
+			return nil;
+		for (pack=0;pack<kDVVAUXPacksPerBlock;pack++)
+		{
+			if (pBlock[kDVVAUXPackOffset+(pack*kDVPackSize)] == packHeader)
+				return &pBlock[kDVVAUXPackOffset+(pack*kDVPackSize)];
+		}
+	}
+	return nil;
+}
+
+//////////////////////////////////////////////////////
+// FindPackInAAUX
+//////////////////////////////////////////////////////
+static UInt8* FindPackInAAUX(DVFrameDIFBlockProc difBlockProc, void *pRefCon, UInt32 sequence, UInt8 packHeader)
+{
+	UInt8 *pBlock;
+	UInt32 block;
+	
+	// Each audio DIF block starts with one AAUX pack
+	for (block=0;block<kDVAudioBlocks;block++)
+	{
+		pBlock = difBlockProc(DIFBlockOffset(sequence,(kDVFirstAudioBlock+(block*kDVAudioBlockInterval))), pRefCon);
+		if (pBlock == nil)
+			return nil;
+		if (pBlock[kDVAAUXPackOffset] == packHeader)
+			return &pBlock[kDVAAUXPackOffset];
+	}
+	return nil;
+}
+
+//////////////////////////////////////////////////////
+// DecodeBCD
+//////////////////////////////////////////////////////
+static bool DecodeBCD(UInt8 tens, UInt8 units, UInt8 maxValue, UInt8 *pValue)
+{
+	if (units > 9)
+		return false;
+	*pValue = (tens*10) + units;
+	return (*pValue <= maxValue);
+}
+
+} // namespace AVS
@@ -0,0 +1,117 @@
+/*
+	File:		DVFrameMetadata.h
+ 
+ Synopsis: This is the header file for the DV frame metadata extraction functions.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVFRAMEMETADATA__
+#define __AVCVIDEOSERVICES_DVFRAMEMETADATA__
+
+namespace AVS
+{
+
+// Aspect ratios for DVFrameMetadata.aspectRatio
+enum
+{
+	kDVAspectRatio4x3 = 0,
+	kDVAspectRatio16x9 = 1,
+	kDVAspectRatioUnknown = 0xFF
+};
+
+// The metadata extracted from a DV frame's subcode, VAUX, and AAUX packs.
+// Each group of fields is only meaningful if its valid flag is set.
+struct DVFrameMetadata
+{
+	bool extracted;				// False if metadata extraction wasn't enabled for this frame
+	
+	// SMPTE timecode, from the subcode title timecode pack
+	bool timeCodeValid;
+	bool timeCodeDropFrame;
+	UInt8 timeCodeHours;
+	UInt8 timeCodeMinutes;
+	UInt8 timeCodeSeconds;
+	UInt8 timeCodeFrames;
+	
+	// Recording date, from the VAUX (or subcode) rec date pack
+	bool recDateValid;
+	UInt16 recYear;
+	UInt8 recMonth;
+	UInt8 recDay;
+	
+	// Recording time, from the VAUX (or subcode) rec time pack
+	bool recTimeValid;
+	UInt8 recHours;
+	UInt8 recMinutes;
+	UInt8 recSeconds;
+	
+	// From the VAUX source control pack
+	bool aspectRatioValid;
+	UInt8 aspectRatio;
+	
+	// From the AAUX source pack
+	bool audioValid;
+	UInt32 audioSampleRate;		// In Hz
+	UInt32 audioSamplesPerFrame;
+	UInt8 audioChannels;
+	UInt8 audioBitsPerSample;
+	bool audioLocked;
+};
+
+// Function prototype for a proc that returns a pointer to the DIF block at the
+// specified byte offset in a frame. Used for frames that aren't in one buffer.
+typedef UInt8* (*DVFrameDIFBlockProc) (UInt32 frameOffset, void *pRefCon);
+
+// Extract the metadata from a DV frame. Only the subcode, VAUX, and audio DIF blocks
+// of a few DIF sequences are looked at, so this doesn't depend on the size of the frame.
+IOReturn GetDVFrameMetadata(UInt8 *pFrameData, UInt32 frameLen, UInt8 dvMode, DVFrameMetadata *pMetadata);
+
+// Same as above, for a frame that isn't in one buffer
+IOReturn GetDVFrameMetadataWithDIFBlockProc(DVFrameDIFBlockProc difBlockProc,
+											void *pRefCon,
+											UInt32 frameLen,
+											UInt8 dvMode,
+											DVFrameMetadata *pMetadata);
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVFRAMEMETADATA__
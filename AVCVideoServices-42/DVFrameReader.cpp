@@ -0,0 +1,520 @@
+/*
+	File:		DVFrameReader.cpp
+ 
+ Synopsis: Reads DV frames ahead into a DVTransmitter's frame buffers on a separate thread, and hands them to the transmitter without locks.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+#include <fcntl.h>
+#include <sys/time.h>
+
+namespace AVS
+{
+
+// Ready ring entries hold the frame index in the low bits, and the
+// seekCount the frame was read for in the high bits
+enum
+{
+	kDVFrameReaderFrameIndexBits = 16,
+	kDVFrameReaderFrameIndexMask = ((1 << kDVFrameReaderFrameIndexBits) - 1),
+	
+	// releaseFrame signals the reader thread without taking the mutex, so the
+	// wakeup can be missed. The reader thread checks for frames this often anyway.
+	kDVFrameReaderPollMicroseconds = 5000
+};
+
+// Prototypes for static functions in this file
+static void *DVFrameReaderThreadStart(DVFrameReader *pReader);
+static void DVFrameReaderTimedWait(pthread_cond_t *pCondition, pthread_mutex_t *pMutex, UInt32 microseconds);
+
+//////////////////////////////////////////////////////
+// Constructor
+//////////////////////////////////////////////////////
+DVFrameReader::DVFrameReader()
+{
+	nextReadProc = nil;
+	readDoneProc = nil;
+	rewindProc = nil;
+	idleProc = nil;
+	pProcRefCon = nil;
+	
+	pDVTransmitter = nil;
+	numTransmitterFrames = 0;
+	readerFrame = kDVFrameReaderNoFrame;
+	
+	seekCount = 0;
+	readCount = 0;
+	readerBusy = false;
+	endOfData = false;
+	endPullsAtDataAdded = 0;
+	prefetchResets = 0;
+	prefetchResetsSeen = 0;
+	
+	readerThreadRunning = false;
+	readerThreadShouldExit = false;
+	
+	bzero(&stats, sizeof(DVFrameReaderStats));
+	
+	pthread_mutex_init(&readerMutex, NULL);
+	pthread_cond_init(&readerCondition, NULL);
+	pthread_cond_init(&readyCondition, NULL);
+}
+
+//////////////////////////////////////////////////////
+// Destructor
+//////////////////////////////////////////////////////
+DVFrameReader::~DVFrameReader()
+{
+	stopReaderThread();
+	
+	pthread_cond_destroy(&readyCondition);
+	pthread_cond_destroy(&readerCondition);
+	pthread_mutex_destroy(&readerMutex);
+}
+
+//////////////////////////////////////////////////////
+// registerReaderCallbacks
+//////////////////////////////////////////////////////
+IOReturn DVFrameReader::registerReaderCallbacks(DVFrameReaderNextReadProc nextRead,
+												DVFrameReaderReadDoneProc readDone,
+												DVFrameReaderRewindProc rewind,
+												DVFrameReaderIdleProc idle,
+												void *pRefCon)
+{
+	if ((!nextRead) || (!readDone) || (!rewind))
+		return kIOReturnBadArgument;
+	
+	// Can't change them under a running reader thread
+	if (readerThreadRunning == true)
+		return kIOReturnBusy;
+	
+	nextReadProc = nextRead;
+	readDoneProc = readDone;
+	rewindProc = rewind;
+	idleProc = idle;
+	pProcRefCon = pRefCon;
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// startReaderThread
+//////////////////////////////////////////////////////
+IOReturn DVFrameReader::startReaderThread(void)
+{
+	if (!nextReadProc)
+		return kIOReturnNotReady;
+	
+	if (readerThreadRunning == true)
+		return kIOReturnExclusiveAccess;
+	
+	pDVTransmitter = nil;
+	numTransmitterFrames = 0;
+	readyFrames.reset();
+	freeFrames.reset();
+	readerFrame = kDVFrameReaderNoFrame;
+	seekCount = 0;
+	readCount = 0;
+	readerBusy = false;
+	endOfData = false;
+	endPullsAtDataAdded = 0;
+	bzero(&stats, sizeof(DVFrameReaderStats));
+	
+	// The reader thread waits until it has frames to fill
+	readerThreadShouldExit = false;
+	if (pthread_create(&readerThread, NULL, (void *(*)(void *))DVFrameReaderThreadStart, this) != 0)
+		return kIOReturnError;
+	readerThreadRunning = true;
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// stopReaderThread
+//////////////////////////////////////////////////////
+void DVFrameReader::stopReaderThread(void)
+{
+	if (readerThreadRunning == true)
+	{
+		pthread_mutex_lock(&readerMutex);
+		readerThreadShouldExit = true;
+		pthread_cond_signal(&readerCondition);
+		pthread_cond_broadcast(&readyCondition);
+		pthread_mutex_unlock(&readerMutex);
+		
+		pthread_join(readerThread, NULL);
+		readerThreadRunning = false;
+	}
+	
+	pDVTransmitter = nil;
+	numTransmitterFrames = 0;
+	readyFrames.reset();
+	freeFrames.reset();
+	readerFrame = kDVFrameReaderNoFrame;
+}
+
+//////////////////////////////////////////////////////
+// lock
+//////////////////////////////////////////////////////
+void DVFrameReader::lock(void)
+{
+	pthread_mutex_lock(&readerMutex);
+}
+
+//////////////////////////////////////////////////////
+// unlock
+//////////////////////////////////////////////////////
+void DVFrameReader::unlock(void)
+{
+	pthread_mutex_unlock(&readerMutex);
+}
+
+//////////////////////////////////////////////////////
+// dataAdded - the mutex must be held
+//////////////////////////////////////////////////////
+void DVFrameReader::dataAdded(void)
+{
+	// Only the transmitter's pulls after the reader runs out again count toward isPlaybackComplete
+	endOfData = false;
+	endPullsAtDataAdded = stats.endPulls;
+	pthread_cond_signal(&readerCondition);
+}
+
+//////////////////////////////////////////////////////
+// cancelRead - the mutex must be held
+//////////////////////////////////////////////////////
+void DVFrameReader::cancelRead(void)
+{
+	readCount += 1;
+	pthread_cond_signal(&readerCondition);
+}
+
+//////////////////////////////////////////////////////
+// discardReadFrames - the mutex must be held
+//////////////////////////////////////////////////////
+void DVFrameReader::discardReadFrames(void)
+{
+	// The ready ring belongs to pullFrame, so we can't empty it from here. Instead,
+	// bumping seekCount makes pullFrame throw away the frames read before now.
+	seekCount = (seekCount + 1) & kDVFrameReaderFrameIndexMask;
+	cancelRead();
+	dataAdded();
+}
+
+//////////////////////////////////////////////////////
+// prepareFrameQueue
+//////////////////////////////////////////////////////
+IOReturn DVFrameReader::prepareFrameQueue(DVTransmitter *pTransmitter)
+{
+	UInt32 numFrames;
+	UInt32 entry;
+	UInt32 firstUnsentFrame = kDVFrameReaderNoFrame;
+	UInt32 numUnsentFrames = 0;
+	UInt32 i;
+	IOReturn result;
+	
+	if ((!pTransmitter) || (!rewindProc))
+		return kIOReturnBadArgument;
+	
+	numFrames = pTransmitter->getNumFrames();
+	if ((numFrames == 0) || (numFrames > kDVFrameReaderMaxFrames))
+		return kIOReturnBadArgument;
+	
+	pthread_mutex_lock(&readerMutex);
+	
+	// Let any read in progress finish, so we can safely take back all the frames. The
+	// transmitter isn't running now, so nothing else is touching the rings either.
+	while (readerBusy == true)
+		pthread_cond_wait(&readyCondition, &readerMutex);
+	
+	// Any frames read for a previous run were never sent, so they must be read again
+	while (readyFrames.pop(&entry) == true)
+	{
+		if ((entry >> kDVFrameReaderFrameIndexBits) != seekCount)
+			continue;
+		if (firstUnsentFrame == kDVFrameReaderNoFrame)
+			firstUnsentFrame = entry & kDVFrameReaderFrameIndexMask;
+		numUnsentFrames += 1;
+	}
+	result = rewindProc(firstUnsentFrame, numUnsentFrames, numFrames, pProcRefCon);
+	
+	if ((result == kIOReturnSuccess) &&
+		((readyFrames.setup(numFrames) != kIOReturnSuccess) || (freeFrames.setup(numFrames) != kIOReturnSuccess)))
+		result = kIOReturnNoMemory;
+	
+	if (result != kIOReturnSuccess)
+	{
+		pDVTransmitter = nil;
+		numTransmitterFrames = 0;
+		pthread_mutex_unlock(&readerMutex);
+		return result;
+	}
+	
+	// The transmitter has just given us every frame. Hand them all to the reader thread.
+	pDVTransmitter = pTransmitter;
+	numTransmitterFrames = numFrames;
+	readerFrame = kDVFrameReaderNoFrame;
+	for (i=0;i<numFrames;i++)
+		freeFrames.push(i);
+	dataAdded();
+	
+	// Wait for the frames to be filled, so the transmitter starts with a full queue
+	while ((readerThreadRunning == true) &&
+		   ((freeFrames.count() != 0) || (readerFrame != kDVFrameReaderNoFrame) || (readerBusy == true)) &&
+		   (endOfData == false) && (readerThreadShouldExit == false))
+		pthread_cond_wait(&readyCondition, &readerMutex);
+	
+	// Start a new low-water mark for this run
+	OSMemoryBarrier();
+	prefetchResets += 1;
+	
+	pthread_mutex_unlock(&readerMutex);
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// isPlaybackComplete
+//////////////////////////////////////////////////////
+bool DVFrameReader::isPlaybackComplete(void)
+{
+	// Once we're out of frames, the transmitter needs to pull a few more times
+	// (repeating its last frame) before all of the DV data has been sent
+	return ((endOfData == true) && (readerBusy == false) && (readyFrames.count() == 0) && (numTransmitterFrames > 0) &&
+			(((stats.endPulls - endPullsAtDataAdded) + 2) > numTransmitterFrames));
+}
+
+//////////////////////////////////////////////////////
+// getStats
+//////////////////////////////////////////////////////
+void DVFrameReader::getStats(DVFrameReaderStats *pStats)
+{
+	// Every field has a single writer, so each one we copy is consistent
+	// on its own, even though the set of them is not a single snapshot
+	OSMemoryBarrier();
+	*pStats = stats;
+	pStats->prefetchDepth = readyFrames.count();
+	
+	// If pullFrame hasn't picked up a reset yet, the low-water mark is where we are now
+	if (prefetchResets != prefetchResetsSeen)
+		pStats->minPrefetchDepth = pStats->prefetchDepth;
+}
+
+//////////////////////////////////////////////////////
+// pullFrame
+//////////////////////////////////////////////////////
+IOReturn DVFrameReader::pullFrame(UInt32 *pFrameIndex)
+{
+	UInt32 entry;
+	UInt32 prefetchDepth;
+	
+	// Called on the transmitter's DCL callback thread. Only lock-free ring operations here!
+	while (readyFrames.pop(&entry) == true)
+	{
+		if ((entry >> kDVFrameReaderFrameIndexBits) != seekCount)
+		{
+			// This frame was read before a seek. Give it back to the reader thread.
+			freeFrames.push(entry & kDVFrameReaderFrameIndexMask);
+			pthread_cond_signal(&readerCondition);
+			continue;
+		}
+		
+		prefetchDepth = readyFrames.count();
+		if ((prefetchResetsSeen != prefetchResets) || (prefetchDepth < stats.minPrefetchDepth))
+		{
+			prefetchResetsSeen = prefetchResets;
+			stats.minPrefetchDepth = prefetchDepth;
+		}
+		stats.framesTransmitted += 1;
+		*pFrameIndex = entry & kDVFrameReaderFrameIndexMask;
+		return kIOReturnSuccess;
+	}
+	
+	// No frame, so the transmitter will repeat the previous one. That's
+	// expected once everything has been read, but otherwise it means
+	// the reader thread isn't keeping up.
+	if (endOfData == true)
+		stats.endPulls += 1;
+	else
+		stats.underruns += 1;
+	
+	return kIOReturnNotReady;
+}
+
+//////////////////////////////////////////////////////
+// releaseFrame
+//////////////////////////////////////////////////////
+IOReturn DVFrameReader::releaseFrame(UInt32 frameIndex)
+{
+	if ((!pDVTransmitter) || (frameIndex >= numTransmitterFrames))
+		return kIOReturnBadArgument;
+	
+	// Called on the transmitter's DCL callback thread. Only lock-free ring operations here!
+	// Signaling without the mutex can miss a reader thread that's about to wait, but it
+	// never waits for longer than kDVFrameReaderPollMicroseconds.
+	freeFrames.push(frameIndex);
+	pthread_cond_signal(&readerCondition);
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// ReaderThread
+//////////////////////////////////////////////////////
+void DVFrameReader::ReaderThread(void)
+{
+	DVFrameReaderRead read;
+	DVTransmitFrame *pFrame;
+	UInt32 readReadCount;
+	ssize_t bytesRead;
+	bool readOK;
+	
+	pthread_mutex_lock(&readerMutex);
+	
+	for (;;)
+	{
+		if (readerThreadShouldExit == true)
+			break;
+		
+		// Let the client do its housekeeping. It may drop the mutex.
+		if (idleProc)
+		{
+			idleProc(pProcRefCon);
+			if (readerThreadShouldExit == true)
+				break;
+		}
+		
+		// Find out what to read next
+		read.adviseFileDescriptor = -1;
+		if (nextReadProc(&read, pProcRefCon) == false)
+		{
+			if (endOfData == false)
+			{
+				endOfData = true;
+				pthread_cond_broadcast(&readyCondition);
+			}
+			DVFrameReaderTimedWait(&readerCondition, &readerMutex, kDVFrameReaderPollMicroseconds);
+			continue;
+		}
+		endOfData = false;
+		
+		// And a frame to read it into
+		if ((readerFrame == kDVFrameReaderNoFrame) && (freeFrames.pop(&readerFrame) == false))
+		{
+			DVFrameReaderTimedWait(&readerCondition, &readerMutex, kDVFrameReaderPollMicroseconds);
+			continue;
+		}
+		pFrame = pDVTransmitter->getFrame(readerFrame);
+		readReadCount = readCount;
+		readerBusy = true;
+		
+		// Do the i/o without holding the mutex, so the client isn't held up. The client
+		// doesn't close the files while we're busy.
+		pthread_mutex_unlock(&readerMutex);
+#ifdef F_RDADVISE
+		if (read.adviseFileDescriptor != -1)
+		{
+			struct radvisory advisory;
+			advisory.ra_offset = read.adviseOffset;
+			advisory.ra_count = (int) read.adviseLength;
+			fcntl(read.adviseFileDescriptor, F_RDADVISE, &advisory);
+		}
+#endif
+		bytesRead = pread(read.fileDescriptor, pFrame->pFrameData, read.length, read.offset);
+		pthread_mutex_lock(&readerMutex);
+		
+		readerBusy = false;
+		if (readReadCount == readCount)
+		{
+			readOK = (bytesRead == (ssize_t) read.length);
+			if (readOK == true)
+				stats.framesRead += 1;
+			else
+				stats.readErrors += 1;
+			
+			if (readDoneProc(&read, readerFrame, readOK, pProcRefCon) == true)
+			{
+				// The ring holds every transmitter frame, so this can't fail
+				readyFrames.push((seekCount << kDVFrameReaderFrameIndexBits) | readerFrame);
+				readerFrame = kDVFrameReaderNoFrame;
+			}
+		}
+		
+		// Otherwise, the read position changed while we were reading. This
+		// frame is stale, so keep it, and fill it again from the new position.
+		pthread_cond_broadcast(&readyCondition);
+	}
+	
+	pthread_mutex_unlock(&readerMutex);
+}
+
+//////////////////////////////////////////////////////
+// DVFrameReaderTimedWait
+//////////////////////////////////////////////////////
+static void DVFrameReaderTimedWait(pthread_cond_t *pCondition, pthread_mutex_t *pMutex, UInt32 microseconds)
+{
+	struct timeval now;
+	struct timespec wakeTime;
+	
+	gettimeofday(&now, NULL);
+	wakeTime.tv_sec = now.tv_sec + (microseconds / 1000000);
+	wakeTime.tv_nsec = (now.tv_usec + (microseconds % 1000000)) * 1000;
+	if (wakeTime.tv_nsec >= 1000000000)
+	{
+		wakeTime.tv_sec += 1;
+		wakeTime.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(pCondition, pMutex, &wakeTime);
+}
+
+//////////////////////////////////////////////////////
+// DVFrameReaderThreadStart
+//////////////////////////////////////////////////////
+static void *DVFrameReaderThreadStart(DVFrameReader *pReader)
+{
+	pReader->ReaderThread();
+	return nil;
+}
+
+} // namespace AVS
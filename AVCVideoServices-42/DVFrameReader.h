@@ -0,0 +1,236 @@
+/*
+	File:		DVFrameReader.h
+ 
+ Synopsis: Reads DV frames ahead into a DVTransmitter's frame buffers on a separate thread, and hands them to the transmitter without locks.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVFRAMEREADER__
+#define __AVCVIDEOSERVICES_DVFRAMEREADER__
+
+namespace AVS
+{
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  DVFrameReader: The frame queue and reader thread shared by DVFileSource and
+//  DVTimeline. For internal use only!
+//
+//  The reader thread reads frames with pread(), directly into the DVTransmitter's
+//  own frame buffers, and queues them on a lock-free ready ring. pullFrame() and
+//  releaseFrame(), called on the transmitter's DCL callback thread, only pop and push
+//  DVFrameIndexRing entries, so they never wait on the disk, or on the reader's mutex.
+//
+//  The client decides what to read through the callbacks registered with
+//  registerReaderCallbacks(), which the reader thread calls with the reader's mutex
+//  held. The client guards its own read position with the same mutex, using lock()
+//  and unlock(), and must call dataAdded() after anything that gives the reader
+//  something new to read.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+enum
+{
+	kDVFrameReaderNoFrame = 0xFFFFFFFF,
+	kDVFrameReaderMaxFrames = 0xFFFF		// Frame indices must fit in the low half of a ready ring entry
+};
+
+// One frame read, filled in by the client's next-read callback
+struct DVFrameReaderRead
+{
+	int fileDescriptor;
+	off_t offset;
+	UInt32 length;
+	
+	// Where the frame belongs, for the client's own use
+	void *pClientItem;
+	UInt32 clientFrame;
+	
+	// Optionally, a file range to ask the file system to start reading ahead (-1 for none)
+	int adviseFileDescriptor;
+	off_t adviseOffset;
+	UInt32 adviseLength;
+};
+
+// Counters shared by every DVFrameReader client. Each field has one writer: framesRead
+// and readErrors are written by the reader thread, and the rest by pullFrame. (The
+// client resets minPrefetchDepth through prefetchResets, which pullFrame picks up.)
+struct DVFrameReaderStats
+{
+	UInt32 prefetchDepth;		// Frames read and waiting to be transmitted
+	UInt32 minPrefetchDepth;	// The low-water mark of prefetchDepth, since the last prepareFrameQueue
+	UInt32 framesRead;			// Frames read by the reader thread
+	UInt32 framesTransmitted;	// Frames handed to the transmitter
+	UInt32 underruns;			// Frame pulls with more to read, but no frame ready
+	UInt32 endPulls;			// Frame pulls after everything was read
+	UInt32 readErrors;			// Number of failed (or short) reads
+};
+
+// Fill in pRead with the next frame to read, and return true, or return false if there's nothing
+// to read. It mustn't move the read position; that's done in the read done callback.
+typedef bool (*DVFrameReaderNextReadProc) (DVFrameReaderRead *pRead, void *pRefCon);
+
+// The read of pRead into frameIndex finished. Move the read position on, and return true
+// to queue the frame for the transmitter, or false to keep it and stop reading.
+typedef bool (*DVFrameReaderReadDoneProc) (DVFrameReaderRead *pRead, UInt32 frameIndex, bool readOK, void *pRefCon);
+
+// Called by prepareFrameQueue before it takes back the transmitter's frames. firstUnsentFrame
+// is the first of the numUnsentFrames frames that were read but never sent (kDVFrameReaderNoFrame
+// if none). Move the read position back to it, and get ready for numFrames frame buffers.
+typedef IOReturn (*DVFrameReaderRewindProc) (UInt32 firstUnsentFrame, UInt32 numUnsentFrames, UInt32 numFrames, void *pRefCon);
+
+// Called on the reader thread, with the mutex held, each time around its loop, for
+// housekeeping. It may unlock the mutex to do i/o, but must lock it again before returning.
+typedef void (*DVFrameReaderIdleProc) (void *pRefCon);
+
+//
+// The DVFrameReader Class Declaration
+//
+class DVFrameReader
+{
+	
+public:
+	// Constructor
+	DVFrameReader();
+	
+	// Destructor
+	~DVFrameReader();
+	
+	// Register the client's callbacks. The idle proc is optional.
+	IOReturn registerReaderCallbacks(DVFrameReaderNextReadProc nextReadProc,
+									 DVFrameReaderReadDoneProc readDoneProc,
+									 DVFrameReaderRewindProc rewindProc,
+									 DVFrameReaderIdleProc idleProc,
+									 void *pRefCon);
+	
+	// Empty the queues, zero the stats, and start the reader thread
+	IOReturn startReaderThread(void);
+	
+	// Stop the reader thread, and forget the transmitter. The transmitter must be stopped first.
+	void stopReaderThread(void);
+	
+	bool isReaderThreadRunning(void) {return readerThreadRunning;};
+	
+	// The mutex the reader thread holds while it calls the client's callbacks
+	void lock(void);
+	void unlock(void);
+	
+	// Calls made with the mutex held:
+	// The client has something new for the reader to read
+	void dataAdded(void);
+	// Drop the read in progress, if any, because the read position changed
+	void cancelRead(void);
+	// Throw away the frames read so far, and any read in progress (for a seek)
+	void discardReadFrames(void);
+	
+	// Take ownership of all of the transmitter's frames, and wait for the reader
+	// thread to fill them. The client must have checked the frame size.
+	IOReturn prepareFrameQueue(DVTransmitter *pTransmitter);
+	
+	// The transmitter given to prepareFrameQueue, and its number of frames
+	DVTransmitter *getTransmitter(void) {return pDVTransmitter;};
+	UInt32 getNumTransmitterFrames(void) {return numTransmitterFrames;};
+	
+	// True once everything has been read, and the transmitter has been
+	// given enough time to send out all of its frames
+	bool isPlaybackComplete(void);
+	
+	// Get the counters
+	void getStats(DVFrameReaderStats *pStats);
+	
+	// For the client's DVTransmitter frame callbacks, on the DCL callback thread
+	IOReturn pullFrame(UInt32 *pFrameIndex);
+	IOReturn releaseFrame(UInt32 frameIndex);
+	
+	// Reader thread entry point
+	void ReaderThread(void);
+	
+private:
+	
+	DVFrameReaderNextReadProc nextReadProc;
+	DVFrameReaderReadDoneProc readDoneProc;
+	DVFrameReaderRewindProc rewindProc;
+	DVFrameReaderIdleProc idleProc;
+	void *pProcRefCon;
+	
+	DVTransmitter *pDVTransmitter;
+	UInt32 numTransmitterFrames;
+	
+	// Frames waiting for the transmitter, pushed by the reader thread and popped by
+	// pullFrame. Each entry is a frame index, tagged with the seekCount it was read for.
+	DVFrameIndexRing readyFrames;
+	
+	// Frames waiting for the reader thread, pushed by releaseFrame (and by pullFrame,
+	// for frames read before a seek), and popped by the reader thread.
+	DVFrameIndexRing freeFrames;
+	
+	// A free frame the reader thread popped, but hasn't queued as ready yet
+	UInt32 readerFrame;
+	
+	// seekCount tags the ready frames, and readCount lets the reader thread
+	// know that the read it just did was cancelled
+	volatile UInt32 seekCount;
+	UInt32 readCount;
+	volatile bool readerBusy;
+	volatile bool endOfData;
+	UInt32 endPullsAtDataAdded;
+	
+	// prepareFrameQueue bumps prefetchResets to have pullFrame restart minPrefetchDepth,
+	// so only pullFrame writes it. prefetchResetsSeen is only used by pullFrame.
+	volatile UInt32 prefetchResets;
+	UInt32 prefetchResetsSeen;
+	
+	pthread_t readerThread;
+	bool readerThreadRunning;
+	volatile bool readerThreadShouldExit;
+	
+	// Serializes the reader thread and the client. Never taken on the DCL callback thread.
+	pthread_mutex_t readerMutex;
+	pthread_cond_t readerCondition;	// Signaled when there's work for the reader thread
+	pthread_cond_t readyCondition;	// Signaled when the reader thread finishes a frame
+	
+	DVFrameReaderStats stats;
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVFRAMEREADER__
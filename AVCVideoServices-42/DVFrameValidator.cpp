@@ -0,0 +1,314 @@
+/*
+	File:		DVFrameValidator.cpp
+ 
+ Synopsis: This is the implementation file for the DVFrameValidator class.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+namespace AVS
+{
+
+// Fields of the first quadlet of a DIF block, in native byte order
+enum
+{
+	kDIFBlockSCTMask = 0xE0000000,
+	kDIFBlockDseqMask = 0x00F00000,
+	kDIFBlockFSCMask = 0x00080000,
+	kDIFBlockFSPMask = 0x00040000,
+	kDIFBlockDBNMask = 0x0000FF00,
+	kDIFBlockSTAMask = 0x000000F0
+};
+
+// DIF block section types
+enum
+{
+	kDIFSectionHeader = 0,
+	kDIFSectionSubcode = 1,
+	kDIFSectionVAUX = 2,
+	kDIFSectionAudio = 3,
+	kDIFSectionVideo = 4
+};
+
+// STA value for a video DIF block with an error that wasn't concealed
+#define kDIFBlockSTAUncorrectedError 0x000000F0
+
+#define DIFBlockID(sct,dbn) ((((UInt32)(sct)) << 29) | (((UInt32)(dbn)) << 8))
+
+/////////////////////////////////////////////////////////
+// Constructor
+/////////////////////////////////////////////////////////
+DVFrameValidator::DVFrameValidator(UInt8 initialDVMode)
+{
+	UInt32 block;
+	UInt32 videoSection;
+	UInt32 i;
+	
+	pDVFormat = nil;
+	numSequences = 0;
+	sequencesPerChannel = 0;
+	idMask = 0;
+	checkSequenceNumbers = false;
+	currentBlock = 0;
+	
+	// Build the table of block IDs for one DIF sequence. This is the same for all DV modes:
+	// one header block, two subcode blocks, three VAUX blocks, then nine times one audio block
+	// followed by fifteen video blocks.
+	block = 0;
+	blockIDBits[block++] = DIFBlockID(kDIFSectionHeader,0);
+	for (i=0;i<2;i++)
+		blockIDBits[block++] = DIFBlockID(kDIFSectionSubcode,i);
+	for (i=0;i<3;i++)
+		blockIDBits[block++] = DIFBlockID(kDIFSectionVAUX,i);
+	for (videoSection=0;videoSection<9;videoSection++)
+	{
+		blockIDBits[block++] = DIFBlockID(kDIFSectionAudio,videoSection);
+		for (i=0;i<15;i++)
+			blockIDBits[block++] = DIFBlockID(kDIFSectionVideo,((videoSection*15)+i));
+	}
+	
+	for (i=0;i<kDVMaxDIFSequencesPerFrame;i++)
+		sequenceIDBits[i] = 0;
+
+	currentDVMode = initialDVMode;
+	setDVMode(initialDVMode);
+}
+
+/////////////////////////////////////////////////////////
+// Destructor
+/////////////////////////////////////////////////////////
+DVFrameValidator::~DVFrameValidator()
+{
+	
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameValidator::setDVMode
+/////////////////////////////////////////////////////////
+IOReturn DVFrameValidator::setDVMode(UInt8 dvMode)
+{
+	UInt32 i = 0;
+	UInt32 channel;
+	UInt32 numChannels;
+	
+	currentDVMode = dvMode;
+	pDVFormat = nil;
+	numSequences = 0;
+
+	// Find the DVFormat table entry for this mode, disregarding the speed bits
+	while (dvFormats[i].frameSize != 0)
+	{
+		if ((dvMode & 0xFC) == dvFormats[i].mode)
+		{
+			pDVFormat = &dvFormats[i];
+			break;
+		}
+		i+=1;
+	}
+	if (pDVFormat == nil)
+		return kIOReturnBadArgument;
+	
+	numSequences = pDVFormat->frameSize / kDVDIFSequenceSize;
+	if (numSequences > kDVMaxDIFSequencesPerFrame)
+		numSequences = kDVMaxDIFSequencesPerFrame;
+	
+	// SDL frames have half the DIF sequences of an SD frame. We don't check their
+	// sequence numbers. All other modes have 10 (525-60) or 12 (625-50) DIF sequences
+	// per channel, with 1, 2, or 4 channels.
+	if (DVstype(dvMode) == 0x01)
+	{
+		sequencesPerChannel = numSequences;
+		checkSequenceNumbers = false;
+	}
+	else
+	{
+		sequencesPerChannel = (DVstandard(dvMode) == kDVStandardPAL) ? 12 : 10;
+		checkSequenceNumbers = true;
+	}
+	numChannels = numSequences / sequencesPerChannel;
+	
+	idMask = (kDIFBlockSCTMask | kDIFBlockFSCMask | kDIFBlockDBNMask);
+	if (checkSequenceNumbers == true)
+		idMask |= kDIFBlockDseqMask;
+	if (numChannels == 4)
+		idMask |= kDIFBlockFSPMask;
+	
+	// The channels' DIF sequences follow each other in the frame. FSC identifies the channel
+	// of a two channel frame. Four channel frames also use FSP: channels 0 and 1 have it set.
+	for (i=0;i<numSequences;i++)
+	{
+		channel = i / sequencesPerChannel;
+		sequenceIDBits[i] = ((i % sequencesPerChannel) << 20) & kDIFBlockDseqMask;
+		if (channel & 0x01)
+			sequenceIDBits[i] |= kDIFBlockFSCMask;
+		if ((numChannels == 4) && (channel < 2))
+			sequenceIDBits[i] |= kDIFBlockFSPMask;
+	}
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameValidator::validateFrame
+/////////////////////////////////////////////////////////
+IOReturn DVFrameValidator::validateFrame(UInt8 *pFrameData, UInt32 frameLen, UInt8 dvMode, DVFrameValidationInfo *pInfo)
+{
+	IOReturn result = kIOReturnSuccess;
+	
+	if ((dvMode != currentDVMode) || (pDVFormat == nil))
+		result = setDVMode(dvMode);
+
+	beginFrame(pInfo);
+	if (result != kIOReturnSuccess)
+	{
+		pInfo->errorFlags |= kDVFrameErrorBadFrameSize;
+		return result;
+	}
+	
+	if (frameLen != pDVFormat->frameSize)
+		pInfo->errorFlags |= kDVFrameErrorBadFrameSize;
+	
+	validateFrameData(pFrameData, frameLen, pInfo);
+	endFrame(pInfo);
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameValidator::beginFrame
+/////////////////////////////////////////////////////////
+void DVFrameValidator::beginFrame(DVFrameValidationInfo *pInfo)
+{
+	pInfo->validated = true;
+	pInfo->errorFlags = kDVFrameErrorNone;
+	pInfo->sequenceErrorMap = 0;
+	pInfo->badBlockCount = 0;
+	pInfo->videoErrorBlockCount = 0;
+	pInfo->videoConcealedBlockCount = 0;
+	currentBlock = 0;
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameValidator::validateFrameData
+/////////////////////////////////////////////////////////
+void DVFrameValidator::validateFrameData(UInt8 *pData, UInt32 length, DVFrameValidationInfo *pInfo)
+{
+	UInt32 sequence = currentBlock / kDVDIFBlocksPerSequence;
+	UInt32 block = currentBlock % kDVDIFBlocksPerSequence;
+	UInt32 numBlocks = length / kDVDIFBlockSize;
+	UInt32 blockID;
+	UInt32 difference;
+	UInt32 sta;
+	
+	// Pieces must be whole DIF blocks
+	if ((length % kDVDIFBlockSize) != 0)
+		pInfo->errorFlags |= kDVFrameErrorBadFrameSize;
+	
+	// Don't run off the end of the frame
+	if ((currentBlock + numBlocks) > (numSequences*kDVDIFBlocksPerSequence))
+	{
+		pInfo->errorFlags |= kDVFrameErrorBadFrameSize;
+		numBlocks = (numSequences*kDVDIFBlocksPerSequence) - currentBlock;
+	}
+	currentBlock += numBlocks;
+	
+	while (numBlocks > 0)
+	{
+		// Compare the block's ID against the one we expect at this position in the frame
+		blockID = EndianU32_BtoN(*((UInt32*) pData));
+		difference = (blockID ^ (blockIDBits[block] | sequenceIDBits[sequence])) & idMask;
+		
+		if (difference != 0)
+		{
+			pInfo->badBlockCount += 1;
+			if (difference & (kDIFBlockSCTMask | kDIFBlockDBNMask))
+				flagSequence(sequence, kDVFrameErrorBadBlockID, pInfo);
+			if (difference & (kDIFBlockDseqMask | kDIFBlockFSCMask | kDIFBlockFSPMask))
+				flagSequence(sequence, kDVFrameErrorBadSequence, pInfo);
+		}
+		else if ((blockIDBits[block] & kDIFBlockSCTMask) == DIFBlockID(kDIFSectionVideo,0))
+		{
+			// For video blocks, check the STA error status
+			sta = blockID & kDIFBlockSTAMask;
+			if (sta == kDIFBlockSTAUncorrectedError)
+			{
+				pInfo->videoErrorBlockCount += 1;
+				flagSequence(sequence, kDVFrameErrorVideoError, pInfo);
+			}
+			else if (sta != 0)
+			{
+				pInfo->videoConcealedBlockCount += 1;
+				pInfo->errorFlags |= kDVFrameErrorVideoConcealed;
+			}
+		}
+		
+		pData += kDVDIFBlockSize;
+		numBlocks -= 1;
+		block += 1;
+		if (block == kDVDIFBlocksPerSequence)
+		{
+			block = 0;
+			sequence += 1;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameValidator::endFrame
+/////////////////////////////////////////////////////////
+void DVFrameValidator::endFrame(DVFrameValidationInfo *pInfo)
+{
+	if (currentBlock != (numSequences*kDVDIFBlocksPerSequence))
+		pInfo->errorFlags |= kDVFrameErrorBadFrameSize;
+}
+
+/////////////////////////////////////////////////////////
+// DVFrameValidator::flagSequence
+/////////////////////////////////////////////////////////
+void DVFrameValidator::flagSequence(UInt32 sequence, UInt32 errorFlag, DVFrameValidationInfo *pInfo)
+{
+	pInfo->errorFlags |= errorFlag;
+	pInfo->sequenceErrorMap |= (1ULL << sequence);
+}
+
+} // namespace AVS
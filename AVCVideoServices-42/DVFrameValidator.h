@@ -0,0 +1,133 @@
+/*
+	File:		DVFrameValidator.h
+ 
+ Synopsis: This is the header file for the DVFrameValidator class.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVFRAMEVALIDATOR__
+#define __AVCVIDEOSERVICES_DVFRAMEVALIDATOR__
+
+namespace AVS
+{
+
+// DV frame layout constants
+enum
+{
+	kDVDIFBlockSize = 80,
+	kDVDIFBlocksPerSequence = 150,
+	kDVDIFSequenceSize = (kDVDIFBlockSize*kDVDIFBlocksPerSequence),
+	kDVMaxDIFSequencesPerFrame = 48	// DVCPro100 625-50: 4 channels of 12 DIF sequences
+};
+
+// Error flags for DVFrameValidationInfo.errorFlags
+enum
+{
+	kDVFrameErrorNone = 0x00000000,
+	kDVFrameErrorBadFrameSize = 0x00000001,		// Frame length doesn't match the DV mode
+	kDVFrameErrorBadBlockID = 0x00000002,		// A DIF block's section type or block number is out of order
+	kDVFrameErrorBadSequence = 0x00000004,		// A DIF block's sequence number or channel is wrong
+	kDVFrameErrorVideoError = 0x00000008,		// A video DIF block's STA says it has an uncorrected error
+	kDVFrameErrorVideoConcealed = 0x00000010	// A video DIF block's STA says it was concealed (not counted in the error map)
+};
+
+// The result of validating a DV frame
+struct DVFrameValidationInfo
+{
+	bool validated;				// False if frame validation wasn't enabled for this frame
+	UInt32 errorFlags;			// kDVFrameError flags, or kDVFrameErrorNone for a good frame
+	UInt64 sequenceErrorMap;	// Bit n is set if DIF sequence n (in frame order) had an error
+	UInt32 badBlockCount;		// Number of DIF blocks with a bad block ID
+	UInt32 videoErrorBlockCount;	// Number of video DIF blocks with an uncorrected error
+	UInt32 videoConcealedBlockCount;	// Number of video DIF blocks with concealed errors
+};
+
+//
+// The DVFrameValidator Class Declaration
+//
+// Checks the DIF block IDs of a DV frame against the layout of a DIF sequence
+// (header, subcode, VAUX, then audio and video blocks interleaved), along with
+// the sequence number and channel of each block, and the STA error status of
+// the video blocks. The check is one masked compare per DIF block, against a
+// table built when the DV mode is set.
+//
+class DVFrameValidator
+{
+	
+public:
+	// Constructor
+	DVFrameValidator(UInt8 initialDVMode = 0x00);
+	
+	// Destructor
+	~DVFrameValidator();
+	
+	// Set the DV mode of the frames to be validated
+	IOReturn setDVMode(UInt8 dvMode);
+	
+	// Validate a whole frame. Sets the DV mode first, if needed.
+	IOReturn validateFrame(UInt8 *pFrameData, UInt32 frameLen, UInt8 dvMode, DVFrameValidationInfo *pInfo);
+	
+	// Validate a frame that isn't in one contiguous buffer. Call beginFrame, then
+	// validateFrameData for each piece of the frame, in order. Each piece must be a
+	// whole number of DIF blocks. Finish with endFrame to catch a short frame.
+	void beginFrame(DVFrameValidationInfo *pInfo);
+	void validateFrameData(UInt8 *pData, UInt32 length, DVFrameValidationInfo *pInfo);
+	void endFrame(DVFrameValidationInfo *pInfo);
+	
+private:
+	
+	void flagSequence(UInt32 sequence, UInt32 errorFlag, DVFrameValidationInfo *pInfo);
+	
+	UInt8 currentDVMode;
+	DVFormats *pDVFormat;
+	UInt32 numSequences;			// DIF sequences in the frame, all channels
+	UInt32 sequencesPerChannel;
+	UInt32 idMask;					// Bits of the first DIF block quadlet we check
+	bool checkSequenceNumbers;
+	UInt32 sequenceIDBits[kDVMaxDIFSequencesPerFrame];	// Expected Dseq/FSC/FSP bits for each sequence
+	UInt32 blockIDBits[kDVDIFBlocksPerSequence];		// Expected SCT/DBN bits for each block in a sequence
+	UInt32 currentBlock;			// Next DIF block expected by validateFrameData
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVFRAMEVALIDATOR__
@@ -49,6 +49,9 @@
 namespace AVS
 {
 
+// See if a source packet is the start of a frame. This should work for all DV modes
+#define DVSourcePacketStartsFrame(pSourcePacket) ((EndianU16_BtoN (*(short *)(pSourcePacket))  & 0xE0FC ) == 0x0004 )
+
 /////////////////////////////////////////////////////////
 // Constructor
 /////////////////////////////////////////////////////////
@@ -63,6 +66,9 @@ DVFramer::DVFramer(DVFramerCallback fCallback, void *pCallbackRefCon, UInt8 init
 	framerIsSetup = false;
 	clientCallback = fCallback;
 	pClientCallbackProcRefCon = pCallbackRefCon;
+	validateFrames = false;
+	extractFrameMetadata = false;
+	pFrameBufferPool = GetDVFrameBufferPool();
 }
 	
 /////////////////////////////////////////////////////////
@@ -87,7 +93,7 @@ DVFramer::~DVFramer()
 		
 		// Delete the frame buffer
 		if (pDeleteFrame->pFrameData)
-			delete [] pDeleteFrame->pFrameData;
+			FreeDVFrameBuffer(pFrameBufferPool,pDeleteFrame->pFrameData);
 		
 		// Delete the frame struct
 		delete pDeleteFrame;
@@ -123,7 +129,7 @@ IOReturn DVFramer::setupDVFramer(void)
 			return kIOReturnNoMemory;
 		
 		// Allocate a frame buffer for the dv frame
-		pDVFrame->pFrameData = new UInt8[pDVFormat->frameSize];
+		pDVFrame->pFrameData = AllocateDVFrameBuffer(pFrameBufferPool,pDVFormat->frameSize);
 		if (!pDVFrame->pFrameData)
 			return kIOReturnNoMemory;
 
@@ -146,16 +152,56 @@ IOReturn DVFramer::setupDVFramer(void)
 /////////////////////////////////////////////////////////
 IOReturn DVFramer::nextDVSourcePacket(UInt8 *pSourcePacket, UInt32 packetLen, UInt8 dvMode, UInt16 syt, UInt32 packetTimeStamp, UInt64 packetU64TimeStamp)
 {
-	bool startOfFrameFound;
+	return nextDVSourcePackets(pSourcePacket, 1, packetLen, dvMode, syt, packetTimeStamp, packetU64TimeStamp);
+}
+
+/////////////////////////////////////////////////////////
+// DVFramer::nextCIPPacket
+/////////////////////////////////////////////////////////
+IOReturn DVFramer::nextCIPPacket(FWAVCCIPPacketParserInfo *pParsedPacket, UInt32 packetTimeStamp, UInt64 packetU64TimeStamp)
+{
+	IOReturn result = kIOReturnSuccess;
+	UInt32 runStart = 0;
+	UInt32 runEnd;
+	
+	// The source packets of a parsed CIP packet normally follow each other in the payload,
+	// so this is usually one call. Split it up where they don't, just in case.
+	while ((runStart < pParsedPacket->numSourcePackets) && (result == kIOReturnSuccess))
+	{
+		runEnd = runStart + 1;
+		while ((runEnd < pParsedPacket->numSourcePackets) &&
+			   (pParsedPacket->pSourcePacket[runEnd] == (pParsedPacket->pSourcePacket[runEnd-1] + pParsedPacket->sourcePacketSize)))
+			runEnd += 1;
+		
+		result = nextDVSourcePackets(pParsedPacket->pSourcePacket[runStart],
+									 (runEnd - runStart),
+									 pParsedPacket->sourcePacketSize,
+									 pParsedPacket->dvMode,
+									 pParsedPacket->syt,
+									 packetTimeStamp,
+									 packetU64TimeStamp);
+		runStart = runEnd;
+	}
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////
+// DVFramer::nextDVSourcePackets
+/////////////////////////////////////////////////////////
+IOReturn DVFramer::nextDVSourcePackets(UInt8 *pSourcePackets, UInt32 numPackets, UInt32 packetLen, UInt8 dvMode, UInt16 syt, UInt32 packetTimeStamp, UInt64 packetU64TimeStamp)
+{
 	IOReturn result;
 	UInt32 expectedSourcePacketSize;
-	UInt8 *pReallocatedBuffer;
 	UInt8 savedDVMode;
+	UInt32 packet = 0;
+	UInt32 runPackets;
+	UInt32 packetsLeftInFrame;
 
 	if (framerIsSetup != true)
 		return kIOReturnNotReady;
 	
-	// See if this packet represents a mode change
+	// See if these packets represent a mode change
 	if (dvMode != currentDVMode)
 	{	
 		if (logger)
@@ -203,71 +249,22 @@ IOReturn DVFramer::nextDVSourcePacket(UInt8 *pSourcePacket, UInt32 packetLen, UI
 		return	kIOReturnBadArgument;
 	}
 	
-	// See if this is the start of a frame. This should work for all DV modes
-	startOfFrameFound = ((EndianU16_BtoN (*(short *)(pSourcePacket))  & 0xE0FC ) == 0x0004 );
-
-	if (startOfFrameFound)
+	while (packet < numPackets)
 	{
-		// If we have a partial frame now, then we didn't finish it.  Alert the client
-		// that the current frame is a corrupted frame. Otherwise, get a frame from the
-		// frame queue (if one exists)
-		if (pCurrentDVFrame)
-		{
-			if (clientCallback)
-				clientCallback(kDVFramerPartialFrameReceived, nil, pClientCallbackProcRefCon,this);
-		}
-		else
-			pCurrentDVFrame = getNextQueuedFrame();
-
-		if (pCurrentDVFrame)
-		{
-			// We have a dv frame. Ensure the buffer is big enough, and if not, attempt to reallocate one.
-			if (pDVFormat->frameSize > pCurrentDVFrame->frameBufferSize)
-			{
-				pReallocatedBuffer = new UInt8[pDVFormat->frameSize];		
-				if (pReallocatedBuffer)
-				{
-					delete [] pCurrentDVFrame->pFrameData;
-					pCurrentDVFrame->pFrameData = pReallocatedBuffer;
-					pCurrentDVFrame->frameBufferSize = pDVFormat->frameSize;
-				}
-				else
-				{
-					// Release this dv frame, since it's buffer isn't big enough to use anyway
-					ReleaseDVFrame(pCurrentDVFrame);
-					pCurrentDVFrame = nil;
-
-					// Alert the client
-					if (clientCallback)
-						clientCallback(kDVFramerNoMemoryForFrameBuffer, nil, pClientCallbackProcRefCon,this);
-					result = kIOReturnError;
-				}
-			
-			}
-		}
-		else
+		// See if this is the start of a frame
+		if (DVSourcePacketStartsFrame(&pSourcePackets[packet*packetLen]))
+			startFrame(syt, packetTimeStamp, packetU64TimeStamp);
+		
+		// If we're not in a frame, skip packets until the next one starts
+		if (!pCurrentDVFrame)
 		{
-			if (clientCallback)
-				clientCallback(kDVFramerNoFrameBufferAvailable, nil, pClientCallbackProcRefCon,this);
-			result = kIOReturnError;
+			packet += 1;
+			continue;
 		}
-
-		// Initialize the dv frame parameters
-		if (pCurrentDVFrame)
-		{
-			pCurrentDVFrame->frameSYTTime = syt;
-			pCurrentDVFrame->packetStartTimeStamp = packetTimeStamp;
-			pCurrentDVFrame->packetStartU64TimeStamp = packetU64TimeStamp;
-			pCurrentDVFrame->frameLen = pDVFormat->frameSize;
-			pCurrentDVFrame->frameMode = currentDVMode;
-			currentFrameOffset = 0;
-		}		
-	}	
-	
-	if (pCurrentDVFrame)
-	{
+		
 		// Ensure that there's space in this frame buffer for this source-packet (to prevent crashing if something has gone wrong)
-		if ((currentFrameOffset + packetLen) > pCurrentDVFrame->frameLen)
+		packetsLeftInFrame = (pCurrentDVFrame->frameLen - currentFrameOffset) / packetLen;
+		if (packetsLeftInFrame == 0)
 		{
 			// Report this unusal condition
 			if (clientCallback)
@@ -276,24 +273,29 @@ IOReturn DVFramer::nextDVSourcePacket(UInt8 *pSourcePacket, UInt32 packetLen, UI
 			// Release this dv frame
 			ReleaseDVFrame(pCurrentDVFrame);
 			pCurrentDVFrame = nil;
+			packet += 1;
+			continue;
 		}
-		else
-		{
-			// Copy the source packet into the frame buffer
-			memcpy(&pCurrentDVFrame->pFrameData[currentFrameOffset],pSourcePacket,packetLen);
-			
-			// Increment the currentFrameOffset
-			currentFrameOffset += packetLen;
-			
-			// See if the frame-buffer is full, and, if so,
-			// pass it to the client, and get another empty frame
-			if (currentFrameOffset == pCurrentDVFrame->frameLen)
-			{
-				if (clientCallback)
-					clientCallback(kDVFramerFrameReceivedSuccessfully, pCurrentDVFrame, pClientCallbackProcRefCon,this);
-				pCurrentDVFrame = nil;
-			}
-		}
+		
+		// Find the run of packets that go into this frame: up to the end of the frame,
+		// the start of the next frame, or the last packet we were passed
+		runPackets = 1;
+		while (((packet + runPackets) < numPackets) &&
+			   (runPackets < packetsLeftInFrame) &&
+			   (!DVSourcePacketStartsFrame(&pSourcePackets[(packet + runPackets)*packetLen])))
+			runPackets += 1;
+		
+		// Copy the source packets into the frame buffer
+		memcpy(&pCurrentDVFrame->pFrameData[currentFrameOffset],&pSourcePackets[packet*packetLen],(runPackets*packetLen));
+		
+		// Increment the currentFrameOffset
+		currentFrameOffset += (runPackets*packetLen);
+		packet += runPackets;
+		
+		// See if the frame-buffer is full, and, if so,
+		// pass it to the client, and get another empty frame
+		if (currentFrameOffset == pCurrentDVFrame->frameLen)
+			deliverFrame();
 	}
 	
 	// Don't always return success!
@@ -302,6 +304,95 @@ IOReturn DVFramer::nextDVSourcePacket(UInt8 *pSourcePacket, UInt32 packetLen, UI
 	// no available frame buffers).
 	return kIOReturnSuccess;
 }
+
+/////////////////////////////////////////////////////////
+// DVFramer::startFrame
+/////////////////////////////////////////////////////////
+void DVFramer::startFrame(UInt16 syt, UInt32 packetTimeStamp, UInt64 packetU64TimeStamp)
+{
+	UInt8 *pReallocatedBuffer;
+	
+	// If we have a partial frame now, then we didn't finish it.  Alert the client
+	// that the current frame is a corrupted frame. Otherwise, get a frame from the
+	// frame queue (if one exists)
+	if (pCurrentDVFrame)
+	{
+		if (clientCallback)
+			clientCallback(kDVFramerPartialFrameReceived, nil, pClientCallbackProcRefCon,this);
+	}
+	else
+		pCurrentDVFrame = getNextQueuedFrame();
+
+	if (pCurrentDVFrame)
+	{
+		// We have a dv frame. Ensure the buffer is big enough, and if not, attempt to reallocate one.
+		if (pDVFormat->frameSize > pCurrentDVFrame->frameBufferSize)
+		{
+			pReallocatedBuffer = AllocateDVFrameBuffer(pFrameBufferPool,pDVFormat->frameSize);		
+			if (pReallocatedBuffer)
+			{
+				FreeDVFrameBuffer(pFrameBufferPool,pCurrentDVFrame->pFrameData);
+				pCurrentDVFrame->pFrameData = pReallocatedBuffer;
+				pCurrentDVFrame->frameBufferSize = pDVFormat->frameSize;
+			}
+			else
+			{
+				// Release this dv frame, since it's buffer isn't big enough to use anyway
+				ReleaseDVFrame(pCurrentDVFrame);
+				pCurrentDVFrame = nil;
+
+				// Alert the client
+				if (clientCallback)
+					clientCallback(kDVFramerNoMemoryForFrameBuffer, nil, pClientCallbackProcRefCon,this);
+			}
+		
+		}
+	}
+	else
+	{
+		if (clientCallback)
+			clientCallback(kDVFramerNoFrameBufferAvailable, nil, pClientCallbackProcRefCon,this);
+	}
+
+	// Initialize the dv frame parameters
+	if (pCurrentDVFrame)
+	{
+		pCurrentDVFrame->frameSYTTime = syt;
+		pCurrentDVFrame->packetStartTimeStamp = packetTimeStamp;
+		pCurrentDVFrame->packetStartU64TimeStamp = packetU64TimeStamp;
+		pCurrentDVFrame->frameLen = pDVFormat->frameSize;
+		pCurrentDVFrame->frameMode = currentDVMode;
+		currentFrameOffset = 0;
+	}		
+}
+
+/////////////////////////////////////////////////////////
+// DVFramer::deliverFrame
+/////////////////////////////////////////////////////////
+void DVFramer::deliverFrame(void)
+{
+	// Check the frame's DIF blocks, if requested
+	if (validateFrames == true)
+		frameValidator.validateFrame(pCurrentDVFrame->pFrameData,
+									 pCurrentDVFrame->frameLen,
+									 pCurrentDVFrame->frameMode,
+									 &pCurrentDVFrame->frameValidation);
+	else
+		pCurrentDVFrame->frameValidation.validated = false;
+	
+	// Extract the frame's metadata, if requested
+	if (extractFrameMetadata == true)
+		GetDVFrameMetadata(pCurrentDVFrame->pFrameData,
+						   pCurrentDVFrame->frameLen,
+						   pCurrentDVFrame->frameMode,
+						   &pCurrentDVFrame->frameMetadata);
+	else
+		pCurrentDVFrame->frameMetadata.extracted = false;
+	
+	if (clientCallback)
+		clientCallback(kDVFramerFrameReceivedSuccessfully, pCurrentDVFrame, pClientCallbackProcRefCon,this);
+	pCurrentDVFrame = nil;
+}
 	
 /////////////////////////////////////////////////////////
 // DVFramer::resetDVFramer
@@ -338,7 +429,7 @@ DVFrame* DVFramer::getNextQueuedFrame(void)
 		if (pFrame)
 		{
 			// Allocate a frame buffer for the dv frame
-			pFrame->pFrameData = new UInt8[pDVFormat->frameSize];
+			pFrame->pFrameData = AllocateDVFrameBuffer(pFrameBufferPool,pDVFormat->frameSize);
 			if (!pFrame->pFrameData)
 			{
 				delete pFrame;
@@ -358,6 +449,24 @@ DVFrame* DVFramer::getNextQueuedFrame(void)
 	return pFrame;
 }
 
+/////////////////////////////////////////////////////////
+// DVFramer::setFrameValidation
+/////////////////////////////////////////////////////////
+IOReturn DVFramer::setFrameValidation(bool enable)
+{
+	validateFrames = enable;
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////
+// DVFramer::setFrameMetadataExtraction
+/////////////////////////////////////////////////////////
+IOReturn DVFramer::setFrameMetadataExtraction(bool enable)
+{
+	extractFrameMetadata = enable;
+	return kIOReturnSuccess;
+}
+
 /////////////////////////////////////////////////////////
 // DVFramer::ReleaseDVFrame
 /////////////////////////////////////////////////////////
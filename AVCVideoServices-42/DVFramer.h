@@ -79,6 +79,8 @@ struct DVFrame
 	UInt32 packetStartTimeStamp;
 	UInt64 packetStartU64TimeStamp;
 	class DVFramer *pDVFramer; // A pointer to the specific DVFramer object that created this frame struct
+	DVFrameValidationInfo frameValidation; // Only valid if frame validation is enabled (see setFrameValidation)
+	DVFrameMetadata frameMetadata; // Only valid if metadata extraction is enabled (see setFrameMetadataExtraction)
 	
 	// The client can use/modify these as needed
 	void *pClientPrivateData;
@@ -119,15 +121,40 @@ public:
 								UInt32 packetTimeStamp = 0xFFFFFFFF,
 								UInt64 packetU64TimeStamp = 0xFFFFFFFFFFFFFFFFLL);
 	
+	// Input a number of DV DIF packets into the framer, that follow each other in memory,
+	// such as the payload of a CIP packet. This is much cheaper than one call per packet.
+	IOReturn nextDVSourcePackets(UInt8 *pSourcePackets,
+								 UInt32 numPackets,
+								 UInt32 packetLen, 
+								 UInt8 dvMode, 
+								 UInt16 syt = 0xFFFFFFFF, 
+								 UInt32 packetTimeStamp = 0xFFFFFFFF,
+								 UInt64 packetU64TimeStamp = 0xFFFFFFFFFFFFFFFFLL);
+	
+	// Input all of the DV DIF packets of a CIP packet parsed by ParseCIPPacket()
+	IOReturn nextCIPPacket(FWAVCCIPPacketParserInfo *pParsedPacket,
+						   UInt32 packetTimeStamp = 0xFFFFFFFF,
+						   UInt64 packetU64TimeStamp = 0xFFFFFFFFFFFFFFFFLL);
+	
 	// Reset function
 	IOReturn resetDVFramer(void);
 	
 	// Release a DV frame buffer passed in a callback
 	IOReturn ReleaseDVFrame(DVFrame* pDVFrame);
+	
+	// Enable/disable validation of the DIF blocks of each completed frame.
+	// The results are in the frame's frameValidation struct.
+	IOReturn setFrameValidation(bool enable);
+	
+	// Enable/disable extraction of the timecode, rec date/time, aspect ratio,
+	// and audio format of each completed frame, into the frame's frameMetadata struct.
+	IOReturn setFrameMetadataExtraction(bool enable);
 			
 private:
 
 	DVFrame* getNextQueuedFrame(void);
+	void startFrame(UInt16 syt, UInt32 packetTimeStamp, UInt64 packetU64TimeStamp);
+	void deliverFrame(void);
 	IOReturn FindDVFormatInfoForCurrentMode(void);
 	
 	StringLogger *logger;
@@ -141,6 +168,10 @@ private:
 	pthread_mutex_t queueProtectMutex;
 	UInt32 frameCount;
 	bool framerIsSetup;
+	bool validateFrames;
+	bool extractFrameMetadata;
+	DVFrameValidator frameValidator;
+	DVFrameBufferPool *pFrameBufferPool;
 };
 	
 } // namespace AVS
@@ -53,7 +53,7 @@ using namespace AVS;
 
 // Globals
 DVReceiver *receiver = nil;
-FILE *outFile;
+DVRecorder *recorder = nil;
 UInt32 framesReceived = 0;
 
 // Prototypes
@@ -69,6 +69,7 @@ int main(int argc, char* argv[])
 {
 	// Local Vars
     IOReturn result = kIOReturnSuccess ;
+	DVRecorderStats recorderStats;
 	unsigned int captureTimeInSeconds;
 	unsigned int isochChannel;
 	UInt8 dvMode;
@@ -84,16 +85,16 @@ int main(int argc, char* argv[])
 
 	captureTimeInSeconds = atoi(argv[4]);
 
-	// Create the output file
-	outFile = fopen(argv[3],"wb");
-	if (outFile == nil)
+	// Alloacate a string logger object and pass it our callback func
+	StringLogger logger(PrintLogMessage);
+
+	// Create the output file (and its .dvnavi file). Frames are written on the recorder's own thread.
+	recorder = new DVRecorder(&logger);
+	if ((!recorder) || (recorder->openFile(argv[3]) != kIOReturnSuccess))
 	{
 		printf("Unable to open output file: %s\n",argv[3]);
 		return -1;
 	}
-	
-	// Alloacate a string logger object and pass it our callback func
-	StringLogger logger(PrintLogMessage);
 
 	result = CreateDVReceiver(&receiver,
 						   MyFrameReceivedProc,
@@ -137,6 +138,12 @@ int main(int argc, char* argv[])
 	// Delete the receiver object
 	DestroyDVReceiver(receiver);
 
+	// Finish writing the output file
+	recorder->closeFile();
+	recorder->getStats(&recorderStats);
+	printf("DV frames written: %d, dropped: %d\n",(int) recorderStats.framesWritten,(int) recorderStats.framesDropped);
+	delete recorder;
+
 	// We're done!
 	printf("DVReceiveTest complete!\n");
 	return result;
@@ -147,18 +154,10 @@ int main(int argc, char* argv[])
 //////////////////////////////////////////////////////
 IOReturn MyFrameReceivedProc (DVFrameReceiveMessage msg, DVReceiveFrame* pFrame, void *pRefCon)
 {
-	UInt32 cnt;
-
 	if (msg == kDVFrameReceivedSuccessfully)
 	{
 		framesReceived += 1;
-
-		cnt = fwrite(pFrame->pFrameData,1,pFrame->frameLen,outFile);
-		if (cnt != pFrame->frameLen)
-		{
-			printf("Error writing to dv output file.\n");
-			exit(-1);
-		}
+		recorder->pushReceiveFrame(pFrame);
 	}
 	
 	return kIOReturnError;
@@ -70,12 +70,12 @@ static IOReturn RemotePort_Stop_Helper(
 
 static void DVReceiveDCLCallback_Helper(DCLCommandPtr pDCLCommand);
 
+static UInt8* ScatterListFrameDIFBlock_Helper(UInt32 frameOffset, void *pRefCon);
+
 static void DVReceiveOverrunDCLCallback_Helper(DCLCommandPtr pDCLCommand);
 
 static IOReturn DVReceiveFinalizeCallback_Helper( void* refcon ) ;
 
-static UInt32  AddFWCycleTimeToFWCycleTime( UInt32 cycleTime1, UInt32 cycleTime2 );
-
 #ifdef kAVS_Enable_ForceStop_Handler	
 static void	DVReceiveForceStopHandler_Helper( IOFireWireLibIsochChannelRef interface, UInt32  stopCondition);
 #endif
@@ -98,8 +98,11 @@ DVReceiver::DVReceiver(StringLogger *stringLogger,
 					   UInt8 receiverDVMode,
 					   unsigned int cyclesPerSegment,
 					   unsigned int numSegments,
-					   bool doIRMAllocations)
+					   bool doIRMAllocations,
+					   bool followDVModeChanges)
 {
+	UInt32 i;
+	
     nodeNubInterface = nubInterface;
 	dclCommandPool = nil;
 	remoteIsocPort = nil;
@@ -111,10 +114,19 @@ DVReceiver::DVReceiver(StringLogger *stringLogger,
 	numFrames = numReceiveFrames;
 	pDVFormat = nil;
 	dvMode = receiverDVMode;
+	followModeChanges = followDVModeChanges;
+	scatterListFrames = false;
+	validateFrames = false;
+	extractMetadata = false;
+	pThumbnailSettings = nil;
+	pThumbnailSettingsInUse = nil;
+	pRetiredThumbnailSettings = nil;
+	pFrameBufferPool = GetDVFrameBufferPool();
 	receiveCycleBufferSize = 0;
 	pTimeStamps = nil;
 	pCurrentFrame = nil;
-	numFrameClients = 0;
+	pFramePool = nil;
+	nextPoolFrame = 0;
 	pOverrunReceiveBuffer = 0;
 	noDataTimer = nil;
 	noDataProc = nil;
@@ -138,13 +150,31 @@ DVReceiver::DVReceiver(StringLogger *stringLogger,
 	isochSegments = numSegments;
 	doIRM = doIRMAllocations;
 	receiveSegmentInfo = new DVReceiveSegment[isochSegments];
-
-	// Initialize the frame queue access mutex as a RECURSIVE mutex
-	pthread_mutexattr_t attribute;
-	pthread_mutexattr_init(&attribute);
-	pthread_mutexattr_settype(&attribute,PTHREAD_MUTEX_RECURSIVE);
-	pthread_mutex_init(&frameQueueMutex,&attribute);
-	pthread_mutexattr_destroy(&attribute);
+	pArmedSegments = new UInt32[isochSegments];
+	for (i=0;i<isochSegments;i++)
+	{
+		receiveSegmentInfo[i].pinCount = 0;
+		receiveSegmentInfo[i].armed = false;
+	}
+	armedSegmentsHead = 0;
+	armedSegmentsCount = 0;
+	lastArmedSegment = 0;
+
+	// Start with an empty list of frame receive notify clients
+	pFrameNotifyList = new DVFrameNotifyList;
+	pFrameNotifyList->numClients = 0;
+	pFrameNotifyList->ppClients = nil;
+	pFrameNotifyList->pRemovedClient = nil;
+	pFrameNotifyList->pNextRetired = nil;
+	pFrameNotifyListInUse = nil;
+	pRetiredFrameNotifyLists = nil;
+	dclCallbackThread = pthread_self();
+	
+	// Initialize the frame notify list mutex
+	pthread_mutex_init(&frameNotifyListMutex,NULL);
+	
+	// Initialize the thumbnail settings mutex
+	pthread_mutex_init(&thumbnailSettingsMutex,NULL);
 	
 	// Initialize the transport control mutex
 	pthread_mutex_init(&transportControlMutex,NULL);
@@ -161,8 +191,9 @@ DVReceiver::DVReceiver(StringLogger *stringLogger,
 //////////////////////////////////////////////////////
 DVReceiver::~DVReceiver()
 {
-	DVReceiveFrame* pDeleteFrame;
-	DVFrameNotifyInst* pNotifyInst;
+	DVFrameNotifyList* pNotifyList;
+	DVThumbnailSettings* pSettings;
+	UInt32 i;
 
 	if (transportState != kDVReceiverTransportStopped)
 		stopReceive();
@@ -202,37 +233,57 @@ DVReceiver::~DVReceiver()
 
 	// Free the receive segment info structs
 	delete [] receiveSegmentInfo;
+	delete [] pArmedSegments;
 
-	// Delete Frame notify queue
-	while (!frameNotifyQueue.empty())
+	// Delete the frame notify list, along with all of the notify instance structs on it
+	for (i=0;i<pFrameNotifyList->numClients;i++)
+		delete pFrameNotifyList->ppClients[i];
+	deleteFrameNotifyList(pFrameNotifyList);
+	
+	// Delete any lists retired by clients while in a frame-received callback
+	while (pRetiredFrameNotifyLists)
 	{
-		pNotifyInst = frameNotifyQueue.front();
-		frameNotifyQueue.pop_front();
-		delete pNotifyInst;
+		pNotifyList = pRetiredFrameNotifyLists;
+		pRetiredFrameNotifyLists = pNotifyList->pNextRetired;
+		deleteFrameNotifyList(pNotifyList);
+	}
+	
+	// Delete the thumbnail settings, and any retired from within a thumbnail callback
+	if (pThumbnailSettings)
+		delete pThumbnailSettings;
+	while (pRetiredThumbnailSettings)
+	{
+		pSettings = pRetiredThumbnailSettings;
+		pRetiredThumbnailSettings = pSettings->pNextRetired;
+		delete pSettings;
 	}
 	
 	// Delete video frames
-	while (!frameQueue.empty())
+	if (pFramePool)
 	{
-		// Get a pointer to the element at the head of the queue
-		pDeleteFrame = frameQueue.front();
-
-		// Remove it from the queue
-		frameQueue.pop_front();
-
-		// Delete the frame buffer
-		if (pDeleteFrame->pFrameData)
-			delete [] pDeleteFrame->pFrameData;
+		for (i=0;i<numFrames;i++)
+		{
+			// Delete the frame buffer
+			if (pFramePool[i].pFrameData)
+				FreeDVFrameBuffer(pFrameBufferPool,pFramePool[i].pFrameData);
 			
-		// Delete the frame struct
-		delete pDeleteFrame;
+			// Delete the scatter-list ranges
+			if (pFramePool[i].pFrameRanges)
+				delete [] pFramePool[i].pFrameRanges;
+		}
+		
+		// Delete the frame structs
+		delete [] pFramePool;
 	}
 	
 	if (nodeNubInterface != nil)
 		(*nodeNubInterface)->Release(nodeNubInterface);
 
-	// Release the frame queue mutex
-	pthread_mutex_destroy(&frameQueueMutex);
+	// Release the frame notify list mutex
+	pthread_mutex_destroy(&frameNotifyListMutex);
+	
+	// Release the thumbnail settings mutex
+	pthread_mutex_destroy(&thumbnailSettingsMutex);
 	
 	// Release the transport control mutex
 	pthread_mutex_destroy(&transportControlMutex);
@@ -257,7 +308,6 @@ IOReturn DVReceiver::setupIsocReceiver(void)
 	UInt32 seg;
 	UInt32 bufCnt = 0;
 	UInt32 i;
-	DVReceiveFrame* pFrame;
 	UInt32 curUpdateListIndex;
 	UInt32 minimumReceiveCycleBufferSize;
 	IOFireWireLibNubRef newNubInterface;
@@ -270,43 +320,67 @@ IOReturn DVReceiver::setupIsocReceiver(void)
 		return kIOReturnError ;
     }
 
-	pthread_mutex_lock(&frameQueueMutex);
-
-	// Allocate the video frame queue
+	// The DCL callback, and all the other callbacks, are dispatched on this thread
+	dclCallbackThread = pthread_self();
+	
+	// Allocate the video frame pool. Frames are never allocated or
+	// freed after this, they just cycle between the pool and the clients.
+	pFramePool = new DVReceiveFrame[numFrames];
+	if (!pFramePool)
+	{
+		logger->log("\nDVReceiver Error: DV frame struct memory allocation error\n");
+		return kIOReturnError ;
+	}
 	for (i=0;i<numFrames;i++)
 	{
-		pFrame = new DVReceiveFrame;
-		if (!pFrame)
+		pFramePool[i].frameSYTTime = 0;
+		pFramePool[i].frameReceivedTimeStamp = 0;
+		pFramePool[i].refCount = 0;
+		pFramePool[i].frameBufferSize = 0;
+		pFramePool[i].currentOffset = 0;
+		pFramePool[i].frameMode = 0;
+		pFramePool[i].pFWAVCPrivateData = nil;
+		pFramePool[i].pDVReceiver = this;
+		pFramePool[i].pFrameData = nil;
+		pFramePool[i].pFrameRanges = nil;
+		pFramePool[i].frameRangeCount = 0;
+		pFramePool[i].maxFrameRanges = 0;
+		pFramePool[i].pinnedSegmentMask = 0;
+	}
+	for (i=0;i<numFrames;i++)
+	{
+		// Allocate frame buffer memory
+		pFramePool[i].pFrameData = AllocateDVFrameBuffer(pFrameBufferPool,frameBufferSizeForFormat(pDVFormat));
+		if (!pFramePool[i].pFrameData)
 		{
-			logger->log("\nDVReceiver Error: DV frame struct memory allocation error\n");
+			logger->log("\nDVReceiver Error: DV frame buffer memory allocation error\n");
 			return kIOReturnError ;
 		}
-		pFrame->frameSYTTime = 0;
-		pFrame->frameReceivedTimeStamp = 0;
-		pFrame->refCount = 0;
-		pFrame->frameBufferSize = 0;
-		pFrame->currentOffset = 0;
-		pFrame->frameMode = 0;
+		pFramePool[i].frameBufferSize = frameBufferSizeForFormat(pDVFormat);
+		pFramePool[i].frameLen = pDVFormat->frameSize;
 		
-		// Allocate frame buffer memory
-		pFrame->pFrameData = (UInt8*) new UInt8[pDVFormat->frameSize];
-		if (!pFrame->pFrameData)
+		// Allocate the scatter-list ranges, if needed
+		if ((scatterListFrames == true) && (allocateFrameRanges(&pFramePool[i],pDVFormat) != kIOReturnSuccess))
 		{
-			logger->log("\nDVReceiver Error: DV frame buffer memory allocation error\n");
+			logger->log("\nDVReceiver Error: DV frame range memory allocation error\n");
 			return kIOReturnError ;
 		}
-		pFrame->frameLen = pDVFormat->frameSize;
-
-		// Add this frame to the frame queue
-		frameQueue.push_back(pFrame);
 	}
 
-	pthread_mutex_unlock(&frameQueueMutex);
-
 
 	// Calculate the size of a receive cycle buffer
 	minimumReceiveCycleBufferSize = (16+((pDVFormat->dbs*4)*(1 << pDVFormat->fn)*(1 << DVspeed(dvMode))));
 
+	// If we're following mode changes, make room for the largest packet of any DV mode
+	if (followModeChanges == true)
+	{
+		for (i=0;dvFormats[i].frameSize != 0;i++)
+		{
+			if ((16+((dvFormats[i].dbs*4)*(1 << dvFormats[i].fn)*(1 << DVspeed(dvMode)))) > minimumReceiveCycleBufferSize)
+				minimumReceiveCycleBufferSize = (16+((dvFormats[i].dbs*4)*(1 << dvFormats[i].fn)*(1 << DVspeed(dvMode))));
+		}
+	}
+
 	// Round it up to the nearest power of 2 size
 	receiveCycleBufferSize = 1;
 	while (receiveCycleBufferSize < minimumReceiveCycleBufferSize)
@@ -402,6 +476,14 @@ IOReturn DVReceiver::setupIsocReceiver(void)
 	(*remoteIsocPort)->SetStartHandler( remoteIsocPort, & RemotePort_Start_Helper );
 	(*remoteIsocPort)->SetStopHandler( remoteIsocPort, & RemotePort_Stop_Helper );
 
+	// The program starts with a jump to the first armed segment, since segment 0
+	// may still be pinned by scatter-list frames when the receiver is restarted.
+	// Jumps to bogus address, for now, like the segment jumps.
+	pLastDCL = (*dclCommandPool)->AllocateLabelDCL( dclCommandPool, pLastDCL ) ;
+	pFirstDCL = pLastDCL;
+	pLastDCL = (*dclCommandPool)->AllocateJumpDCL(dclCommandPool, pLastDCL,(DCLLabelPtr) pLastDCL);
+	pDCLStartJump = (DCLJumpPtr) pLastDCL;
+
 	// Create receive segements
 	curUpdateListIndex = 0;
 	for (seg=0;seg<isochSegments;seg++)
@@ -412,11 +494,6 @@ IOReturn DVReceiver::setupIsocReceiver(void)
 		pLastDCL = (*dclCommandPool)->AllocateLabelDCL( dclCommandPool, pLastDCL ) ;
 		receiveSegmentInfo[seg].pSegmentLabelDCL = (DCLLabelPtr) pLastDCL;
 
-		if (seg == 0)
-		{
-			pFirstDCL = pLastDCL;
-		}
-
 		for (cycle=0;cycle< isochCyclesPerSegment;cycle++)
 		{
 			// Allocate receive DCL
@@ -526,53 +603,562 @@ IOReturn DVReceiver::setupIsocReceiver(void)
 IOReturn
 DVReceiver::releaseFrame(DVReceiveFrame* pFrame)
 {
-	pthread_mutex_lock(&frameQueueMutex);
-
-	if (pFrame->refCount == 0)
+	// Never take a lock here, since this is called from client threads
+	// while the DCL callback may be handing out frames from the pool.
+	if (releaseFrameReference(pFrame) == false)
 	{
 		// Just a sanity check 
 		logger->log("DVReceiver Error: Client releasing frame with refCount of 0\n");
 	}
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// releaseFrameReference
+//////////////////////////////////////////////////////////////////////
+bool
+DVReceiver::releaseFrameReference(DVReceiveFrame* pFrame)
+{
+	int32_t refCount;
+	
+	do
+	{
+		refCount = pFrame->refCount;
+		if (refCount == 0)
+			return false;
+		
+		// If this is the last reference, give the DCL buffers the frame's
+		// ranges point into back to the receiver, before the frame goes back
+		// into the pool. Nobody else can take a reference to it now.
+		if (refCount == 1)
+			unpinFrameSegments(pFrame);
+	}while (!OSAtomicCompareAndSwap32Barrier(refCount, refCount-1, &pFrame->refCount));
+	
+	// If that was the last reference, the frame is back in the pool
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// getNextQueuedFrame
+//////////////////////////////////////////////////////////////////////
+DVReceiveFrame*
+DVReceiver::getNextQueuedFrame(void)
+{
+	DVReceiveFrame* pFrame;
+	UInt32 i;
+
+	// Look for a free frame, starting after the last one we handed out,
+	// so frames are reused in roughly the order they were released.
+	// Taking the frame gives us (the receiver) the only reference to it.
+	for (i=0;i<numFrames;i++)
+	{
+		pFrame = &pFramePool[nextPoolFrame];
+		nextPoolFrame += 1;
+		if (nextPoolFrame == numFrames)
+			nextPoolFrame = 0;
+
+		if (OSAtomicCompareAndSwap32Barrier(0, 1, &pFrame->refCount))
+		{
+			// The frame buffers and ranges were sized for every mode we can switch
+			// to when they were allocated, and we never allocate on this thread.
+			// If this frame can't hold the current mode anyway, drop the frame.
+			if ((pDVFormat->frameSize > pFrame->frameBufferSize) ||
+				((scatterListFrames == true) && (frameRangesForFormat(pDVFormat) > pFrame->maxFrameRanges)))
+			{
+				releaseFrameReference(pFrame);
+				return nil;
+			}
+			
+			// Initialize some frame parameters
+			pFrame->currentOffset = 0;
+			pFrame->frameRangeCount = 0;
+			pFrame->pDVReceiver = this;
+			pFrame->pFWAVCPrivateData = nil;
+			return pFrame;
+		}
+	}
+	
+	return nil;
+}
+
+//////////////////////////////////////////////////////////////////////
+// setScatterListFrames
+//////////////////////////////////////////////////////////////////////
+IOReturn
+DVReceiver::setScatterListFrames(bool enable)
+{
+	IOReturn result = kIOReturnSuccess ;
+	UInt32 i;
+	
+	// Each frame tracks the segments it uses in a 32 bit mask, and the
+	// receiver needs enough segments left over while the clients hold frames
+	if ((enable == true) &&
+		((isochSegments > kDVReceiverMaxScatterListSegments) ||
+		 (isochSegments < (kDVReceiverMinArmedSegments + segmentsPinnedPerFrame() + 1))))
+		return kIOReturnUnsupported;
+	
+	// Lock the transport control mutex
+	pthread_mutex_lock(&transportControlMutex);
+	
+	// Can't change this while receiving
+	if (transportState == kDVReceiverTransportRecording)
+	{
+		// Unlock the transport control mutex
+		pthread_mutex_unlock(&transportControlMutex);
+		
+		return kIOReturnBusy;
+	}
+	
+	// If the frame pool already exists, make sure its frames have their ranges.
+	// Otherwise, setupIsocReceiver will allocate them.
+	if ((enable == true) && (pFramePool))
+	{
+		for (i=0;i<numFrames;i++)
+		{
+			result = allocateFrameRanges(&pFramePool[i],pDVFormat);
+			if (result != kIOReturnSuccess)
+				break;
+		}
+	}
+	
+	if (result == kIOReturnSuccess)
+		scatterListFrames = enable;
+	
+	// Unlock the transport control mutex
+	pthread_mutex_unlock(&transportControlMutex);
+	
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////
+// setFrameValidation
+//////////////////////////////////////////////////////////////////////
+IOReturn
+DVReceiver::setFrameValidation(bool enable)
+{
+	validateFrames = enable;
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// validateFrame
+//////////////////////////////////////////////////////////////////////
+void
+DVReceiver::validateFrame(DVReceiveFrame* pFrame)
+{
+	UInt32 range;
+	
+	if (validateFrames == false)
+	{
+		pFrame->frameValidation.validated = false;
+		return;
+	}
+	
+	if (scatterListFrames == true)
+	{
+		// Validate the frame one range at a time
+		frameValidator.setDVMode(pFrame->frameMode);
+		frameValidator.beginFrame(&pFrame->frameValidation);
+		for (range=0;range<pFrame->frameRangeCount;range++)
+			frameValidator.validateFrameData(pFrame->pFrameRanges[range].pData,
+											 pFrame->pFrameRanges[range].length,
+											 &pFrame->frameValidation);
+		frameValidator.endFrame(&pFrame->frameValidation);
+	}
 	else
+		frameValidator.validateFrame(pFrame->pFrameData, pFrame->frameLen, pFrame->frameMode, &pFrame->frameValidation);
+}
+
+//////////////////////////////////////////////////////////////////////
+// setFrameMetadataExtraction
+//////////////////////////////////////////////////////////////////////
+IOReturn
+DVReceiver::setFrameMetadataExtraction(bool enable)
+{
+	extractMetadata = enable;
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// extractFrameMetadata
+//////////////////////////////////////////////////////////////////////
+void
+DVReceiver::extractFrameMetadata(DVReceiveFrame* pFrame)
+{
+	if (extractMetadata == false)
+	{
+		pFrame->frameMetadata.extracted = false;
+		return;
+	}
+	
+	if (scatterListFrames == true)
+		GetDVFrameMetadataWithDIFBlockProc(ScatterListFrameDIFBlock_Helper, pFrame, pFrame->frameLen, pFrame->frameMode, &pFrame->frameMetadata);
+	else
+		GetDVFrameMetadata(pFrame->pFrameData, pFrame->frameLen, pFrame->frameMode, &pFrame->frameMetadata);
+}
+
+//////////////////////////////////////////////////////////////////////
+// setThumbnailGeneration
+//////////////////////////////////////////////////////////////////////
+IOReturn
+DVReceiver::setThumbnailGeneration(UInt32 frameInterval, DVThumbnailProc handler, void *pRefCon)
+{
+	DVThumbnailSettings* pOldSettings;
+	DVThumbnailSettings* pNewSettings = nil;
+	
+	if ((frameInterval > 0) && (!handler))
+		return kIOReturnBadArgument;
+	
+	if (frameInterval > 0)
+	{
+		pNewSettings = new DVThumbnailSettings;
+		if (!pNewSettings)
+			return kIOReturnNoMemory;
+		pNewSettings->frameInterval = frameInterval;
+		pNewSettings->handler = handler;
+		pNewSettings->pRefCon = pRefCon;
+		pNewSettings->frameCount = 0;
+		pNewSettings->pNextRetired = nil;
+	}
+	
+	pthread_mutex_lock(&thumbnailSettingsMutex);
+	
+	// Publish the new settings. Once the DCL callback is done with
+	// the old ones, it can never pick them up again.
+	pOldSettings = pThumbnailSettings;
+	OSMemoryBarrier();
+	pThumbnailSettings = pNewSettings;
+	OSMemoryBarrier();
+	
+	pthread_mutex_unlock(&thumbnailSettingsMutex);
+	
+	if (!pOldSettings)
+		return kIOReturnSuccess;
+	
+	if (pthread_equal(pthread_self(),dclCallbackThread))
+	{
+		// We were called from the thumbnail callback, which returns to a DCL
+		// callback that won't call it again. It will free the old settings.
+		if (pThumbnailSettingsInUse == pOldSettings)
+		{
+			pOldSettings->pNextRetired = pRetiredThumbnailSettings;
+			pRetiredThumbnailSettings = pOldSettings;
+			return kIOReturnSuccess;
+		}
+	}
+	else
+	{
+		// Wait for the DCL callback to finish with the old settings, so the
+		// caller knows the old handler won't be called once we return.
+		while (pThumbnailSettingsInUse == pOldSettings)
+			usleep(100);
+	}
+	
+	delete pOldSettings;
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// generateThumbnail
+//////////////////////////////////////////////////////////////////////
+void
+DVReceiver::generateThumbnail(DVReceiveFrame* pFrame)
+{
+	DVThumbnailSettings* pSettings;
+	
+	// The retired list is only touched on this thread, so it's safe to check here
+	if ((!pThumbnailSettings) && (!pRetiredThumbnailSettings))
+		return;
+	
+	// Get a snapshot of the thumbnail settings, and let writers know we're using
+	// them. If they were replaced while we were doing that, try again.
+	do
 	{
-		pFrame->refCount -= 1;
-		if (pFrame->refCount == 0)
+		pSettings = pThumbnailSettings;
+		pThumbnailSettingsInUse = pSettings;
+		OSMemoryBarrier();
+	}while (pSettings != pThumbnailSettings);
+	
+	if (pSettings)
+	{
+		pSettings->frameCount += 1;
+		if (pSettings->frameCount >= pSettings->frameInterval)
 		{
-			// The frame is ours again, add it to our queue
-			frameQueue.push_back(pFrame);
+			pSettings->frameCount = 0;
+			if (thumbnailer.makeThumbnail(pFrame, &thumbnail) == kIOReturnSuccess)
+				pSettings->handler(&thumbnail, pSettings->pRefCon);
 		}
 	}
 	
-	pthread_mutex_unlock(&frameQueueMutex);
+	// We're done with our snapshot of the thumbnail settings
+	OSMemoryBarrier();
+	pThumbnailSettingsInUse = nil;
+	
+	// Free any settings that were replaced from within the thumbnail callback
+	while (pRetiredThumbnailSettings)
+	{
+		pSettings = pRetiredThumbnailSettings;
+		pRetiredThumbnailSettings = pSettings->pNextRetired;
+		delete pSettings;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// allocateFrameRanges
+//////////////////////////////////////////////////////////////////////
+IOReturn
+DVReceiver::allocateFrameRanges(DVReceiveFrame* pFrame, DVFormats* pFormat)
+{
+	DVReceiveFrameRange *pRanges;
+	UInt32 neededRanges = frameRangesForFormat(pFormat);
+	
+	if (neededRanges <= pFrame->maxFrameRanges)
+		return kIOReturnSuccess;
+	
+	pRanges = new DVReceiveFrameRange[neededRanges];
+	if (!pRanges)
+		return kIOReturnNoMemory;
+	
+	if (pFrame->pFrameRanges)
+		delete [] pFrame->pFrameRanges;
+	pFrame->pFrameRanges = pRanges;
+	pFrame->maxFrameRanges = neededRanges;
+	pFrame->frameRangeCount = 0;
 	
 	return kIOReturnSuccess;
 }
 
 //////////////////////////////////////////////////////////////////////
-// getNextQueuedFrame
+// addFrameRange
 //////////////////////////////////////////////////////////////////////
-DVReceiveFrame*
-DVReceiver::getNextQueuedFrame(void)
+void
+DVReceiver::addFrameRange(DVReceiveFrame* pFrame, UInt8 *pData, UInt32 length, UInt32 segment)
 {
-	DVReceiveFrame* pFrame = nil;
+	DVReceiveFrameRange *pLastRange;
+	int32_t segmentBit = (int32_t) (1U << segment);
+	
+	// Data blocks from the same packet are contiguous, so merge them
+	if (pFrame->frameRangeCount > 0)
+	{
+		pLastRange = &pFrame->pFrameRanges[pFrame->frameRangeCount-1];
+		if ((pLastRange->pData + pLastRange->length) == pData)
+			pLastRange->length += length;
+		else
+			pLastRange = nil;
+	}
+	else
+		pLastRange = nil;
+	
+	if (pLastRange == nil)
+	{
+		pFrame->pFrameRanges[pFrame->frameRangeCount].pData = pData;
+		pFrame->pFrameRanges[pFrame->frameRangeCount].length = length;
+		pFrame->frameRangeCount += 1;
+	}
+	
+	// Keep the segment out of the DCL program until the frame is released. Only
+	// the receiver holds a frame while it's being filled, so no CAS needed here.
+	if ((pFrame->pinnedSegmentMask & segmentBit) == 0)
+	{
+		OSAtomicIncrement32Barrier(&receiveSegmentInfo[segment].pinCount);
+		pFrame->pinnedSegmentMask |= segmentBit;
+		OSMemoryBarrier();
+	}
+}
 
-	pthread_mutex_lock(&frameQueueMutex);
+//////////////////////////////////////////////////////////////////////
+// unpinFrameSegments
+//////////////////////////////////////////////////////////////////////
+void
+DVReceiver::unpinFrameSegments(DVReceiveFrame* pFrame)
+{
+	int32_t segmentMask;
+	UInt32 segment;
+	
+	// This can race between a client releasing the frame, and the DCL callback
+	// copying its data, so whoever takes the mask gets to drop the pins.
+	do
+	{
+		segmentMask = pFrame->pinnedSegmentMask;
+		if (segmentMask == 0)
+			return;
+	}while (!OSAtomicCompareAndSwap32Barrier(segmentMask, 0, &pFrame->pinnedSegmentMask));
+	
+	for (segment=0;segment<isochSegments;segment++)
+	{
+		if (segmentMask & ((int32_t) (1U << segment)))
+			OSAtomicDecrement32Barrier(&receiveSegmentInfo[segment].pinCount);
+	}
+}
 
-	if (!frameQueue.empty())
+//////////////////////////////////////////////////////////////////////
+// copyFrameRangesToFrameData
+//////////////////////////////////////////////////////////////////////
+void
+DVReceiver::copyFrameRangesToFrameData(DVReceiveFrame* pFrame)
+{
+	UInt32 range;
+	UInt32 offset = 0;
+	
+	// Only for frames no client can see yet (the frame being filled, or one that's
+	// about to be delivered), since the ranges are replaced by a single range
+	// describing the copy in pFrameData.
+	for (range=0;range<pFrame->frameRangeCount;range++)
+	{
+		if (pFrame->pFrameRanges[range].pData != &pFrame->pFrameData[offset])
+			memcpy(&pFrame->pFrameData[offset],pFrame->pFrameRanges[range].pData,pFrame->pFrameRanges[range].length);
+		offset += pFrame->pFrameRanges[range].length;
+	}
+	
+	if (pFrame->frameRangeCount > 0)
 	{
-		pFrame = frameQueue.front();
-		frameQueue.pop_front();
+		pFrame->pFrameRanges[0].pData = pFrame->pFrameData;
+		pFrame->pFrameRanges[0].length = offset;
+		pFrame->frameRangeCount = 1;
+	}
+	
+	unpinFrameSegments(pFrame);
+}
 
-		// Initialize some frame parameters
-		pFrame->currentOffset = 0;
-		pFrame->refCount = numFrameClients;
-		pFrame->pDVReceiver = this;
-		pFrame->pFWAVCPrivateData = nil;
+//////////////////////////////////////////////////////////////////////
+// reclaimSegment
+//////////////////////////////////////////////////////////////////////
+void
+DVReceiver::reclaimSegment(UInt32 segment)
+{
+	int32_t segmentBit = (int32_t) (1U << segment);
+	
+	// Only the frame being filled can be moved. Frames the clients hold keep their
+	// segments pinned until they're released.
+	if ((pCurrentFrame) && (pCurrentFrame->pinnedSegmentMask & segmentBit))
+		copyFrameRangesToFrameData(pCurrentFrame);
+}
+
+//////////////////////////////////////////////////////////////////////
+// segmentsPinnedPerFrame
+//////////////////////////////////////////////////////////////////////
+UInt32
+DVReceiver::segmentsPinnedPerFrame(void)
+{
+	// A frame can start near the end of one segment, and end just
+	// into the one after the segments its cycles fill
+	return ((kDVReceiverMaxCyclesPerFrame + isochCyclesPerSegment - 1) / isochCyclesPerSegment) + 1;
+}
+
+//////////////////////////////////////////////////////////////////////
+// pinnedSegmentCount
+//////////////////////////////////////////////////////////////////////
+UInt32
+DVReceiver::pinnedSegmentCount(void)
+{
+	UInt32 seg;
+	UInt32 count = 0;
+	
+	for (seg=0;seg<isochSegments;seg++)
+	{
+		if (receiveSegmentInfo[seg].pinCount != 0)
+			count += 1;
 	}
+	
+	return count;
+}
 
-	pthread_mutex_unlock(&frameQueueMutex);
+//////////////////////////////////////////////////////////////////////
+// armSegment
+//////////////////////////////////////////////////////////////////////
+void
+DVReceiver::armSegment(UInt32 segment)
+{
+	// Make this segment the end of the DCL program
+	(*localIsocPort)->ModifyJumpDCL(localIsocPort,
+								 receiveSegmentInfo[segment].pSegmentJumpDCL,
+								 pDCLOverrunLabel );
+
+	(*localIsocPort)->ModifyJumpDCL(localIsocPort,
+								 receiveSegmentInfo[lastArmedSegment].pSegmentJumpDCL,
+								 receiveSegmentInfo[segment].pSegmentLabelDCL );
+	
+	lastArmedSegment = segment;
+	receiveSegmentInfo[segment].armed = true;
+	pArmedSegments[(armedSegmentsHead + armedSegmentsCount) % isochSegments] = segment;
+	armedSegmentsCount += 1;
+}
+
+//////////////////////////////////////////////////////////////////////
+// notifyFrameClients
+//////////////////////////////////////////////////////////////////////
+void
+DVReceiver::notifyFrameClients(DVFrameNotifyList* pNotifyList, DVFrameReceiveMessage msg)
+{
+	DVFrameNotifyInst* pNotifyInst;
+	UInt32 i;
+	
+	for (i=0;i<pNotifyList->numClients;i++)
+	{
+		pNotifyInst = pNotifyList->ppClients[i];
+		pNotifyInst->handler(msg, nil,pNotifyInst->refCon);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// replaceFrameNotifyList
+//////////////////////////////////////////////////////////////////////
+DVFrameNotifyList*
+DVReceiver::replaceFrameNotifyList(DVFrameNotifyList* pNewList, DVFrameNotifyInst* pRemovedClient)
+{
+	DVFrameNotifyList* pOldList = pFrameNotifyList;
+	
+	pOldList->pRemovedClient = pRemovedClient;
+	
+	// Publish the new list. Once the DCL callback is done with
+	// the old list, it can never pick it up again.
+	OSMemoryBarrier();
+	pFrameNotifyList = pNewList;
+	OSMemoryBarrier();
+
+	return pOldList;
+}
+
+//////////////////////////////////////////////////////////////////////
+// retireFrameNotifyList
+//////////////////////////////////////////////////////////////////////
+void
+DVReceiver::retireFrameNotifyList(DVFrameNotifyList* pOldList)
+{
+	if (pthread_equal(pthread_self(),dclCallbackThread))
+	{
+		// We were called from a frame-received callback. The DCL callback
+		// will free the old list when it's done with this segment.
+		if (pFrameNotifyListInUse == pOldList)
+		{
+			pOldList->pNextRetired = pRetiredFrameNotifyLists;
+			pRetiredFrameNotifyLists = pOldList;
+			return;
+		}
+	}
+	else
+	{
+		// Wait for the DCL callback to finish with the old list. This only
+		// ever blocks the registering client, never the DCL callback.
+		while (pFrameNotifyListInUse == pOldList)
+			usleep(100);
+	}
 	
-	return pFrame;
+	deleteFrameNotifyList(pOldList);
+}
+
+//////////////////////////////////////////////////////////////////////
+// deleteFrameNotifyList
+//////////////////////////////////////////////////////////////////////
+void
+DVReceiver::deleteFrameNotifyList(DVFrameNotifyList* pNotifyList)
+{
+	if (pNotifyList->pRemovedClient)
+		delete pNotifyList->pRemovedClient;
+	if (pNotifyList->ppClients)
+		delete [] pNotifyList->ppClients;
+	delete pNotifyList;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -581,24 +1167,56 @@ DVReceiver::getNextQueuedFrame(void)
 IOReturn
 DVReceiver::registerFrameReceivedCallback(DVFrameReceivedProc handler, void *refCon, DVFrameNotifyInst* *ppNotifyInstance)
 {
+	DVFrameNotifyList* pOldList;
+	DVFrameNotifyList* pNewList;
+	UInt32 i;
+	
 	DVFrameNotifyInst* pNotifyInst = new DVFrameNotifyInst;
 	if (!pNotifyInst)
 	{
 		return kIOReturnNoMemory;
 	}
 
-	pthread_mutex_lock(&frameQueueMutex);
-
 	pNotifyInst->handler = handler;
 	pNotifyInst->refCon = refCon;
 
-	// Add the new notify instance struct to notify queue
-	frameNotifyQueue.push_back(pNotifyInst);
+	pthread_mutex_lock(&frameNotifyListMutex);
 
-	numFrameClients += 1;
+	pOldList = pFrameNotifyList;
+	
+	// Make a copy of the current list, with the new notify instance struct added to the end
+	pNewList = new DVFrameNotifyList;
+	if (pNewList)
+	{
+		pNewList->numClients = pOldList->numClients+1;
+		pNewList->ppClients = new DVFrameNotifyInst*[pNewList->numClients];
+		pNewList->pRemovedClient = nil;
+		pNewList->pNextRetired = nil;
+	}
+	if ((!pNewList) || (!pNewList->ppClients))
+	{
+		pthread_mutex_unlock(&frameNotifyListMutex);
+		if (pNewList)
+			delete pNewList;
+		delete pNotifyInst;
+		return kIOReturnNoMemory;
+	}
+	
+	for (i=0;i<pOldList->numClients;i++)
+		pNewList->ppClients[i] = pOldList->ppClients[i];
+	pNewList->ppClients[pOldList->numClients] = pNotifyInst;
 
-	pthread_mutex_unlock(&frameQueueMutex);
+	pOldList = replaceFrameNotifyList(pNewList,nil);
+	
+	pthread_mutex_unlock(&frameNotifyListMutex);
+	
+	// Don't wait for the DCL callback while holding the mutex, since
+	// the DCL callback's clients may be trying to take it.
+	retireFrameNotifyList(pOldList);
 
+	if (ppNotifyInstance)
+		*ppNotifyInstance = pNotifyInst;
+	
 	return kIOReturnSuccess;
 }
 
@@ -608,25 +1226,59 @@ DVReceiver::registerFrameReceivedCallback(DVFrameReceivedProc handler, void *ref
 IOReturn
 DVReceiver::unregisterFrameReceivedCallback(DVFrameNotifyInst* pNotifyInstance)
 {
-	DVFrameNotifyInst* pNotifyInst;
+	DVFrameNotifyList* pOldList;
+	DVFrameNotifyList* pNewList;
+	UInt32 i;
+	UInt32 j;
 
-	pthread_mutex_lock(&frameQueueMutex);
+	pthread_mutex_lock(&frameNotifyListMutex);
 
-	for (std::deque<DVFrameNotifyInst*>::iterator dequeIterator = frameNotifyQueue.begin() ; dequeIterator != frameNotifyQueue.end() ; ++dequeIterator)
+	pOldList = pFrameNotifyList;
+	
+	for (i=0;i<pOldList->numClients;i++)
+		if (pOldList->ppClients[i] == pNotifyInstance)
+			break;
+	
+	if (i == pOldList->numClients)
 	{
-		pNotifyInst = *dequeIterator;
-		if (pNotifyInst == pNotifyInstance)
+		pthread_mutex_unlock(&frameNotifyListMutex);
+		return kIOReturnBadArgument;
+	}
+	
+	// Make a copy of the current list, without this notify instance struct
+	pNewList = new DVFrameNotifyList;
+	if (!pNewList)
+	{
+		pthread_mutex_unlock(&frameNotifyListMutex);
+		return kIOReturnNoMemory;
+	}
+	pNewList->numClients = pOldList->numClients-1;
+	pNewList->ppClients = nil;
+	pNewList->pRemovedClient = nil;
+	pNewList->pNextRetired = nil;
+	if (pNewList->numClients > 0)
+	{
+		pNewList->ppClients = new DVFrameNotifyInst*[pNewList->numClients];
+		if (!pNewList->ppClients)
 		{
-			frameNotifyQueue.erase(dequeIterator);
-			delete pNotifyInst;
-			numFrameClients -= 1;
-			pthread_mutex_unlock(&frameQueueMutex);
-			return kIOReturnSuccess;
+			pthread_mutex_unlock(&frameNotifyListMutex);
+			delete pNewList;
+			return kIOReturnNoMemory;
 		}
+		for (i=0,j=0;i<pOldList->numClients;i++)
+			if (pOldList->ppClients[i] != pNotifyInstance)
+				pNewList->ppClients[j++] = pOldList->ppClients[i];
 	}
+
+	// The notify instance struct is deleted along with the old list, once
+	// the DCL callback can no longer be calling its handler.
+	pOldList = replaceFrameNotifyList(pNewList,pNotifyInstance);
+	
+	pthread_mutex_unlock(&frameNotifyListMutex);
 	
-	pthread_mutex_unlock(&frameQueueMutex);
-	return kIOReturnBadArgument;
+	retireFrameNotifyList(pOldList);
+	
+	return kIOReturnSuccess;
 }
 
 
@@ -658,19 +1310,38 @@ IOReturn DVReceiver::registerNoDataNotificationCallback(DVNoDataProc handler, vo
 void DVReceiver::fixupDCLJumpTargets(void)
 {
 	UInt32 i;
+	DCLJumpPtr pPrevJumpDCL = pDCLStartJump;
 
+	// The frame being filled is the only one we can move out of the DCL buffers.
+	// Segments still pinned by frames the clients hold are left out of the DCL
+	// program, and put back by the DCL callback once the frames are released.
+	if ((pCurrentFrame) && (pCurrentFrame->pinnedSegmentMask != 0))
+		copyFrameRangesToFrameData(pCurrentFrame);
+	
+	armedSegmentsHead = 0;
+	armedSegmentsCount = 0;
 	for (i=0;i<isochSegments;i++)
 	{
-		if (i != (isochSegments-1))
+		if (receiveSegmentInfo[i].pinCount == 0)
+		{
 			(*localIsocPort)->ModifyJumpDCL(localIsocPort,
-								   receiveSegmentInfo[i].pSegmentJumpDCL,
-								   receiveSegmentInfo[i+1].pSegmentLabelDCL );
+								   pPrevJumpDCL,
+								   receiveSegmentInfo[i].pSegmentLabelDCL );
+			pPrevJumpDCL = receiveSegmentInfo[i].pSegmentJumpDCL;
+			
+			receiveSegmentInfo[i].armed = true;
+			pArmedSegments[armedSegmentsCount] = i;
+			armedSegmentsCount += 1;
+			lastArmedSegment = i;
+		}
 		else
-			(*localIsocPort)->ModifyJumpDCL(localIsocPort,
-								   receiveSegmentInfo[i].pSegmentJumpDCL,
-								   pDCLOverrunLabel );
+			receiveSegmentInfo[i].armed = false;
 	}
-	currentSegment = 0;
+	(*localIsocPort)->ModifyJumpDCL(localIsocPort,
+								   pPrevJumpDCL,
+								   pDCLOverrunLabel );
+	
+	currentSegment = pArmedSegments[0];
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -879,11 +1550,14 @@ void DVReceiver::DVReceiveDCLCallback(void)
 	UInt32 *pBlock;
 	UInt32 *pFrameDataWord;
 	DVFrameNotifyInst* pNotifyInst;
+	DVFrameNotifyList* pNotifyList;
+	DVFrameNotifyList* pRetiredList;
 	IOReturn result;
 	UInt32 currentWordOffset;
 	UInt32 numBlocks;
 	UInt32 expectedPacketSize;
-	bool alreadyOnFrameQueue;
+	UInt32 client;
+	UInt32 seg;
 	
 	UInt8 cip_fmt;
 	UInt8 cip_mode;
@@ -894,15 +1568,19 @@ void DVReceiver::DVReceiveDCLCallback(void)
 
 	bool segmentHasData = false;
 
-	std::deque<DVFrameNotifyInst*>::iterator dequeIterator;
-
-	std::deque<DVReceiveFrame*>::reverse_iterator frameQueueReverseIterator;
-	DVReceiveFrame* frameOnQueue;
-	
 	// See if this callback happened after we stopped
 	if (transportState == kDVReceiverTransportStopped)
 		return;
 	
+	// Get a snapshot of the frame notify list, and let writers know we're using
+	// it. If the list was replaced while we were doing that, try again.
+	do
+	{
+		pNotifyList = pFrameNotifyList;
+		pFrameNotifyListInUse = pNotifyList;
+		OSMemoryBarrier();
+	}while (pNotifyList != pFrameNotifyList);
+	
 	//logger->log("DV_DEBUG: DVReceiveDCLCallback: Timestamp 0x%08X\n",pTimeStamps[currentSegment]);
 	currentTime = pTimeStamps[currentSegment];
 
@@ -947,34 +1625,23 @@ void DVReceiver::DVReceiveDCLCallback(void)
 				// frame queue (if one exists), and start a new frame.
 				if (pCurrentFrame)
 				{
-					pthread_mutex_lock(&frameQueueMutex);
-					for (dequeIterator = frameNotifyQueue.begin() ; dequeIterator != frameNotifyQueue.end() ; ++dequeIterator)
-					{
-						pNotifyInst = *dequeIterator;
-						pNotifyInst->handler(kDVFrameCorrupted, nil,pNotifyInst->refCon);
-					}
+					notifyFrameClients(pNotifyList,kDVFrameCorrupted);
 
-					// Put the frame struct back on the queue
-					frameQueue.push_back(pCurrentFrame);
+					// Put the frame struct back in the pool
+					releaseFrameReference(pCurrentFrame);
 					pCurrentFrame = nil;
-					
-					pthread_mutex_unlock(&frameQueueMutex);
 				}
 
-				// Currently, if the received DV stream is not in the same mode as this DVReceive object
-				// was initialzied for, we don't process the packets, and we alert the clients via the
-				// FrameReceived callback of the invalid mode error. In the future, handle receiving
-				// frames for modes other than the initialized mode.
+				// If the received DV stream is not in the same mode as this DVReceive object is
+				// currently set for, either switch to the new mode (if we're following mode changes,
+				// and the new mode fits in our DCL buffers), or don't process the packets, and alert
+				// the clients via the FrameReceived callback of the invalid mode error.
+				if ((cip_mode != dvMode) && (followModeChanges == true))
+					switchDVMode(cip_mode);
+				
 				if (cip_mode != dvMode)
 				{
-					pthread_mutex_lock(&frameQueueMutex);
-					for (dequeIterator = frameNotifyQueue.begin() ; dequeIterator != frameNotifyQueue.end() ; ++dequeIterator)
-					{
-						pNotifyInst = *dequeIterator;
-						pNotifyInst->handler(kDVFrameWrongMode, nil,pNotifyInst->refCon);
-					}
-					
-					pthread_mutex_unlock(&frameQueueMutex);
+					notifyFrameClients(pNotifyList,kDVFrameWrongMode);
 				}
 				else
 				{
@@ -991,13 +1658,7 @@ void DVReceiver::DVReceiveDCLCallback(void)
 					else
 					{
 						// Send a dropped frame notification to the clients
-						pthread_mutex_lock(&frameQueueMutex);
-						for (dequeIterator = frameNotifyQueue.begin() ; dequeIterator != frameNotifyQueue.end() ; ++dequeIterator)
-						{
-							pNotifyInst = *dequeIterator;
-							pNotifyInst->handler(kDVFrameDropped, nil,pNotifyInst->refCon);
-						}
-						pthread_mutex_unlock(&frameQueueMutex);
+						notifyFrameClients(pNotifyList,kDVFrameDropped);
 					}
 				}
 			}
@@ -1011,18 +1672,11 @@ void DVReceiver::DVReceiveDCLCallback(void)
 				{
 					//logger->log("DV_DEBUG: DVReceiveDCLCallback: Bad cycle packet size: %d,\n",payloadLen);
 
-					pthread_mutex_lock(&frameQueueMutex);
-					for (dequeIterator = frameNotifyQueue.begin() ; dequeIterator != frameNotifyQueue.end() ; ++dequeIterator)
-					{
-						pNotifyInst = *dequeIterator;
-						pNotifyInst->handler(kDVFrameWrongMode, nil,pNotifyInst->refCon);
-					}
+					notifyFrameClients(pNotifyList,kDVFrameWrongMode);
 					
-					// Put the frame struct back on the queue
-					frameQueue.push_back(pCurrentFrame);
+					// Put the frame struct back in the pool
+					releaseFrameReference(pCurrentFrame);
 					pCurrentFrame = nil;
-					
-					pthread_mutex_unlock(&frameQueueMutex);
 				}
 				else
 				{
@@ -1033,11 +1687,19 @@ void DVReceiver::DVReceiveDCLCallback(void)
 					// frame buffer
 					for(dataBlock=0;dataBlock<numBlocks;dataBlock++)
 					{
-						// Copy the datablock into the framebuffer
+						// Copy the datablock into the framebuffer, or for scatter-list
+						// frames, just add it to the frame's list of ranges
 						pBlock = &pCycleBuf[3+(dataBlock*cip_dbs)];
-						pFrameDataWord = (UInt32*) pCurrentFrame->pFrameData;
-						currentWordOffset = pCurrentFrame->currentOffset/4;
-						memcpy(&pFrameDataWord[currentWordOffset],pBlock,(cip_dbs*4));
+						if (scatterListFrames == true)
+						{
+							addFrameRange(pCurrentFrame,(UInt8*) pBlock,(cip_dbs*4),segment);
+						}
+						else
+						{
+							pFrameDataWord = (UInt32*) pCurrentFrame->pFrameData;
+							currentWordOffset = pCurrentFrame->currentOffset/4;
+							memcpy(&pFrameDataWord[currentWordOffset],pBlock,(cip_dbs*4));
+						}
 						
 						pCurrentFrame->currentOffset += (cip_dbs*4);
 						
@@ -1045,48 +1707,41 @@ void DVReceiver::DVReceiveDCLCallback(void)
 						{
 							//logger->log("DV_DEBUG: DVReceiveDCLCallback: End of Frame Detected, Time: 0x%08X\n",currentTime);
 							
-							// We have a whole frame, pass it to the clients
-							pthread_mutex_lock(&frameQueueMutex);
+							// If the frames the clients hold (and this one) pin so many segments that
+							// the next frame might not fit in the rest, copy this frame out of the DCL
+							// buffers now, while no client can see its ranges.
+							if ((scatterListFrames == true) &&
+								(pinnedSegmentCount() > (isochSegments - kDVReceiverMinArmedSegments - segmentsPinnedPerFrame())))
+								copyFrameRangesToFrameData(pCurrentFrame);
+							
+							// Check the frame's DIF blocks, if requested
+							validateFrame(pCurrentFrame);
+							
+							// Extract the frame's metadata, if requested
+							extractFrameMetadata(pCurrentFrame);
 							
-							pCurrentFrame->refCount = numFrameClients;
+							// Make a thumbnail of the frame, if requested
+							generateThumbnail(pCurrentFrame);
 							
-							for (dequeIterator = frameNotifyQueue.begin() ; dequeIterator != frameNotifyQueue.end() ; ++dequeIterator)
+							// We have a whole frame, pass it to the clients. Each client gets a
+							// reference, and we hold on to ours until they've all been called.
+							OSAtomicAdd32Barrier(pNotifyList->numClients,&pCurrentFrame->refCount);
+							
+							for (client=0;client<pNotifyList->numClients;client++)
 							{
-								pNotifyInst = *dequeIterator;
+								pNotifyInst = pNotifyList->ppClients[client];
 								// Do Callback. If the client returns an error condition,
 								// it means he won't release the frame in the future, so release it here!
 								result = pNotifyInst->handler(kDVFrameReceivedSuccessfully, pCurrentFrame,pNotifyInst->refCon);
 								if (result != kIOReturnSuccess)
-									pCurrentFrame->refCount -= 1;
+									releaseFrameReference(pCurrentFrame);
 							}
 							
-							if (pCurrentFrame->refCount == 0)
-							{
-								// It is possible that the client(s) called releaseFrame(...) within frame-received callback,
-								// (since the frame queue mutex is now recursive). So, it's possible that this frame has already
-								// been pushed back onto the frame queue. Make sure that it's not already on the frame queue 
-								// before we push it on now. Note that we search the queue in reverse, since, if it was put 
-								// on the back of the queue, it will be the first thing we look at, ending the iterative search faster.
-								alreadyOnFrameQueue = false;
-								for (frameQueueReverseIterator = frameQueue.rbegin() ; frameQueueReverseIterator != frameQueue.rend() ; ++frameQueueReverseIterator)
-								{
-									frameOnQueue = *frameQueueReverseIterator;
-									if (frameOnQueue == pCurrentFrame)
-									{
-										alreadyOnFrameQueue = true;
-										break;	// We found this frame on the queue, so break out of the for-loop now!
-									}
-								}
-								
-								// Put the frame back on the queue
-								if (!alreadyOnFrameQueue)
-									frameQueue.push_back(pCurrentFrame);
-							}
-
+							// Drop our reference. If the client(s) already released the frame,
+							// (possibly within the frame-received callback), it's now back in the pool.
+							releaseFrameReference(pCurrentFrame);
 							pCurrentFrame = nil;
 							
-							pthread_mutex_unlock(&frameQueueMutex);
-							
 							// If there are more blocks in this packet, which can be the case
 							// for DV25 4X NTSC, then we need to allocate another frame buffer
 							if (dataBlock<(numBlocks-1))
@@ -1104,13 +1759,7 @@ void DVReceiver::DVReceiveDCLCallback(void)
 								else
 								{
 									// Send a dropped frame notification to the clients
-									pthread_mutex_lock(&frameQueueMutex);
-									for (dequeIterator = frameNotifyQueue.begin() ; dequeIterator != frameNotifyQueue.end() ; ++dequeIterator)
-									{
-										pNotifyInst = *dequeIterator;
-										pNotifyInst->handler(kDVFrameDropped, nil,pNotifyInst->refCon);
-									}
-									pthread_mutex_unlock(&frameQueueMutex);
+									notifyFrameClients(pNotifyList,kDVFrameDropped);
 								}
 								
 								if (pCurrentFrame == nil)
@@ -1127,25 +1776,54 @@ void DVReceiver::DVReceiveDCLCallback(void)
 		// value if I bump it ONLY in cycles that contain data, and I bump it
 		// with the num fw clocks per source packet for the current video standard,
 		// rather than the current bump of one cycle time per packet
-		currentTime =  AddFWCycleTimeToFWCycleTime( currentTime, 0x00001000 );
+		currentTime =  FWCycleTime::fromRegister(currentTime).addCycles(1).getRegister();
 		
 		// Bump to the next cycle buffer
 		pCycleBuf += (receiveCycleBufferSize/4);
 	}
 
-	// Update jump targets
-	(*localIsocPort)->ModifyJumpDCL(localIsocPort,
-								 receiveSegmentInfo[segment].pSegmentJumpDCL,
-								 pDCLOverrunLabel );
-
-	(*localIsocPort)->ModifyJumpDCL(localIsocPort,
-								 receiveSegmentInfo[(segment == 0) ? (isochSegments-1) : (segment-1) ].pSegmentJumpDCL,
-								 receiveSegmentInfo[segment].pSegmentLabelDCL );
-
-	// Increment current segment and handle wrap
-	currentSegment += 1;
-	if (currentSegment == isochSegments)
-		currentSegment = 0;
+	// This segment is no longer in the DCL program
+	armedSegmentsHead += 1;
+	if (armedSegmentsHead == isochSegments)
+		armedSegmentsHead = 0;
+	armedSegmentsCount -= 1;
+	receiveSegmentInfo[segment].armed = false;
+	
+	// Put it back at the end of the DCL program, unless scatter-list frames are still
+	// using its buffers. In that case, if we'd otherwise be left with too few segments,
+	// move the data of the frame being filled out of the way. Frames the clients hold
+	// are never overwritten; the copy done when frames are completed keeps them from
+	// pinning too many segments.
+	if (receiveSegmentInfo[segment].pinCount == 0)
+		armSegment(segment);
+	else if (armedSegmentsCount < kDVReceiverMinArmedSegments)
+	{
+		reclaimSegment(segment);
+		if (receiveSegmentInfo[segment].pinCount == 0)
+			armSegment(segment);
+	}
+	
+	// Put back any segments released by the clients since the last callback
+	for (seg=0;seg<isochSegments;seg++)
+	{
+		if ((receiveSegmentInfo[seg].armed == false) && (receiveSegmentInfo[seg].pinCount == 0))
+			armSegment(seg);
+	}
+	
+	// The next callback is for the oldest segment still in the DCL program
+	currentSegment = pArmedSegments[armedSegmentsHead];
+	
+	// We're done with our snapshot of the frame notify list
+	OSMemoryBarrier();
+	pFrameNotifyListInUse = nil;
+	
+	// Free any lists that were replaced from within a frame-received callback
+	while (pRetiredFrameNotifyLists)
+	{
+		pRetiredList = pRetiredFrameNotifyLists;
+		pRetiredFrameNotifyLists = pRetiredList->pNextRetired;
+		deleteFrameNotifyList(pRetiredList);
+	}
 	
 	// If the client has registered a no-data notification, see if we should reset the timer
 	if ((noDataProc != nil) && (segmentHasData == true))
@@ -1244,21 +1922,106 @@ DVReceiver::FindDVFormatForMode(void)
 	// speed code that's embedded in the low 2-bits of the mode
 	// value.
 
+	pDVFormat = LookupDVFormat(dvMode);
+	
+	return (pDVFormat != nil) ? kIOReturnSuccess : kIOReturnError;
+}
+
+//////////////////////////////////////////////////////////////////////
+// LookupDVFormat
+//////////////////////////////////////////////////////////////////////
+DVFormats*
+DVReceiver::LookupDVFormat(UInt8 mode)
+{
 	UInt32 i = 0;
 	DVFormats* pFormat = &dvFormats[i];
 
 	while (pFormat->frameSize != 0)
 	{
-		if ((dvMode & 0xFC) == pFormat->mode)
-		{
-			pDVFormat = pFormat;
-			return kIOReturnSuccess;
-		}
+		if ((mode & 0xFC) == pFormat->mode)
+			return pFormat;
 		i+=1;
 		pFormat = &dvFormats[i];
 	};
 
-	return kIOReturnError;
+	return nil;
+}
+
+//////////////////////////////////////////////////////////////////////
+// frameBufferSizeForFormat
+//////////////////////////////////////////////////////////////////////
+UInt32
+DVReceiver::frameBufferSizeForFormat(DVFormats* pFormat)
+{
+	UInt32 i = 0;
+	UInt32 bufferSize = pFormat->frameSize;
+
+	if (followModeChanges == false)
+		return bufferSize;
+	
+	// Round up to the largest frame size of any DV mode, so the frame
+	// buffers never need to be reallocated when the mode changes.
+	while (dvFormats[i].frameSize != 0)
+	{
+		if (dvFormats[i].frameSize > bufferSize)
+			bufferSize = dvFormats[i].frameSize;
+		i+=1;
+	}
+	
+	return bufferSize;
+}
+
+//////////////////////////////////////////////////////////////////////
+// frameRangesForFormat
+//////////////////////////////////////////////////////////////////////
+UInt32
+DVReceiver::frameRangesForFormat(DVFormats* pFormat)
+{
+	UInt32 i = 0;
+	
+	// Worst case, every data block of the frame is its own range
+	UInt32 numRanges = pFormat->frameSize / (pFormat->dbs*4);
+	
+	if (followModeChanges == false)
+		return numRanges;
+	
+	// Same as above, make room for any DV mode
+	while (dvFormats[i].frameSize != 0)
+	{
+		if ((dvFormats[i].frameSize / (dvFormats[i].dbs*4)) > numRanges)
+			numRanges = dvFormats[i].frameSize / (dvFormats[i].dbs*4);
+		i+=1;
+	}
+	
+	return numRanges;
+}
+
+//////////////////////////////////////////////////////////////////////
+// switchDVMode
+//////////////////////////////////////////////////////////////////////
+IOReturn
+DVReceiver::switchDVMode(UInt8 newMode)
+{
+	DVFormats* pNewFormat;
+	UInt8 oldMode = dvMode;
+	
+	pNewFormat = LookupDVFormat(newMode);
+	if (!pNewFormat)
+		return kIOReturnUnsupported;
+	
+	// The new mode's packets must fit in the DCL program's receive buffers
+	if ((16+((pNewFormat->dbs*4)*(1 << pNewFormat->fn)*(1 << DVspeed(newMode)))) > receiveCycleBufferSize)
+		return kIOReturnNoSpace;
+	
+	// Switch the frame geometry. The frame buffers are already
+	// big enough for any mode (see frameBufferSizeForFormat).
+	dvMode = newMode;
+	pDVFormat = pNewFormat;
+	
+	if (messageProc != nil)
+		messageProc(kDVReceiverDVModeChanged,newMode,oldMode,pMessageProcRefCon);
+	
+	return kIOReturnSuccess;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -1455,52 +2218,31 @@ static void DVReceiveOverrunDCLCallback_Helper(DCLCommandPtr pDCLCommand)
 }
 
 //////////////////////////////////////////////////////////////////////
-// DVReceiveFinalizeCallback_Helper
+// ScatterListFrameDIFBlock_Helper
 //////////////////////////////////////////////////////////////////////
-static IOReturn DVReceiveFinalizeCallback_Helper( void* refcon )
+static UInt8* ScatterListFrameDIFBlock_Helper(UInt32 frameOffset, void *pRefCon)
 {
-	DVReceiver *pDVReceiver = (DVReceiver*) refcon;
-	pDVReceiver->DVReceiveFinalizeCallback();
-	return kIOReturnSuccess;
+	DVReceiveFrame *pFrame = (DVReceiveFrame*) pRefCon;
+	UInt32 range;
+	
+	// Ranges are whole data blocks, so a DIF block is never split between two of them
+	for (range=0;range<pFrame->frameRangeCount;range++)
+	{
+		if (frameOffset < pFrame->pFrameRanges[range].length)
+			return &pFrame->pFrameRanges[range].pData[frameOffset];
+		frameOffset -= pFrame->pFrameRanges[range].length;
+	}
+	return nil;
 }
 
 //////////////////////////////////////////////////////////////////////
-// AddFWCycleTimeToFWCycleTime
+// DVReceiveFinalizeCallback_Helper
 //////////////////////////////////////////////////////////////////////
-UInt32  AddFWCycleTimeToFWCycleTime( UInt32 cycleTime1, UInt32 cycleTime2 )
+static IOReturn DVReceiveFinalizeCallback_Helper( void* refcon )
 {
-    UInt32    secondCount,
-	cycleCount,
-	cycleOffset;
-    UInt32    cycleTime;
-
-    // Add cycle offsets.
-    cycleOffset = (cycleTime1 & 0x0FFF) + (cycleTime2 & 0x0FFF);
-
-    // Add cycle counts.
-    cycleCount = (cycleTime1 & 0x01FFF000) + (cycleTime2 & 0x01FFF000);
-
-    // Add any carry over from cycle offset to cycle count.
-    if (cycleOffset > 3071)
-    {
-        cycleCount += 0x1000;
-        cycleOffset -= 3072;
-    }
-
-    // Add secondCounts.
-    secondCount = (cycleTime1 & 0xFE000000) + (cycleTime2 & 0xFE000000);
-
-    // Add any carry over from cycle count to secondCount.
-    if (cycleCount > (7999 << 12))
-    {
-        secondCount += 0x02000000;
-        cycleCount -= (8000 << 12);
-    }
-
-    // Put everything together into cycle time.
-    cycleTime = secondCount | cycleCount | cycleOffset;
-
-    return (cycleTime);
+	DVReceiver *pDVReceiver = (DVReceiver*) refcon;
+	pDVReceiver->DVReceiveFinalizeCallback();
+	return kIOReturnSuccess;
 }
 
 #ifdef kAVS_Enable_ForceStop_Handler	
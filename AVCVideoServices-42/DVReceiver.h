@@ -56,7 +56,8 @@ enum
 	kDVReceiverReceivedBadPacket = kFWAVCStreamReceivedBadPacket,
 	kDVReceiverDCLOverrun = kFWAVCStreamDCLOverrun,
 	kDVReceiverAllocateIsochPort = kFWAVCStreamAllocateIsochPort,
-	kDVReceiverReleaseIsochPort = kFWAVCStreamReleaseIsochPort
+	kDVReceiverReleaseIsochPort = kFWAVCStreamReleaseIsochPort,
+	kDVReceiverDVModeChanged = kFWAVCStreamDVModeChanged	// param1 = new mode, param2 = old mode
 };
 
 // enum for transport states
@@ -85,6 +86,23 @@ enum
 	kDVReceiveNumFrames = kFWAVCDVReceiveNumFrameBuffers
 };
 
+// The most segments a DVReceiver can have if scatter-list frames are enabled,
+// the fewest segments it keeps in the DCL program while frames are pinning
+// the others, and the most isoch cycles a frame can span (a 25 fps frame).
+enum
+{
+	kDVReceiverMaxScatterListSegments = 32,
+	kDVReceiverMinArmedSegments = 2,
+	kDVReceiverMaxCyclesPerFrame = 320
+};
+
+// One contiguous piece of a scatter-list frame's data
+struct DVReceiveFrameRange
+{
+	UInt8 *pData;
+	UInt32 length;
+};
+
 // Structure for frame data
 // TODO: Change this to a class with accessor functions
 // to hide the private members of this structure
@@ -96,11 +114,25 @@ struct DVReceiveFrame
 	UInt32 frameSYTTime;
 	UInt32 frameReceivedTimeStamp;
 	UInt8 frameMode;
+	
+	// If scatter-list frames are enabled, the frame data is not copied into pFrameData.
+	// Instead, these ranges, in order, make up the frame. They point into the receiver's
+	// DCL buffers (or into pFrameData, if the receiver needed those buffers back first).
+	DVReceiveFrameRange *pFrameRanges;
+	UInt32 frameRangeCount;
+	
+	// Only valid if frame validation is enabled (see setFrameValidation)
+	DVFrameValidationInfo frameValidation;
+	
+	// Only valid if metadata extraction is enabled (see setFrameMetadataExtraction)
+	DVFrameMetadata frameMetadata;
 
 	// These parameters are should be considered off-limits to the clients
-	UInt32 refCount;
+	volatile int32_t refCount;	// Zero when the frame is free in the receiver's frame pool
 	UInt32 frameBufferSize;
 	UInt32 currentOffset;
+	UInt32 maxFrameRanges;
+	volatile int32_t pinnedSegmentMask;	// DCL program segments the frame ranges point into
 
 	// The client can use/modify these as needed
 	void *pFWAVCPrivateData;
@@ -118,11 +150,16 @@ typedef void (*DVReceiverMessageProc) (UInt32 msg, UInt32 param1, UInt32 param2,
 // Function prototype for "no-data" callback.
 typedef IOReturn (*DVNoDataProc) (void *pRefCon);
 
+// Function prototype for thumbnail callback. The thumbnail is only valid during the callback.
+typedef void (*DVThumbnailProc) (DVThumbnail *pThumbnail, void *pRefCon);
+
 // Structure containing vars for each receive segment
 struct DVReceiveSegment
 {
 	DCLLabelPtr pSegmentLabelDCL;
 	DCLJumpPtr pSegmentJumpDCL;
+	volatile int32_t pinCount;		// Number of scatter-list frames using this segment's buffers
+	bool armed;						// True if the segment is part of the running DCL program
 };
 
 // Struct for maintaining a list of Frame Receive Notify Clients
@@ -132,6 +169,29 @@ struct DVFrameNotifyInst
 	void *refCon;
 };
 
+// A snapshot of the Frame Receive Notify Clients. Register and unregister
+// replace the whole list rather than modifying it, so the DCL callback can
+// walk its snapshot without taking a lock.
+struct DVFrameNotifyList
+{
+	UInt32 numClients;
+	DVFrameNotifyInst* *ppClients;
+	DVFrameNotifyInst* pRemovedClient;	// Deleted along with this list
+	DVFrameNotifyList* pNextRetired;
+};
+
+// A snapshot of the thumbnail settings. setThumbnailGeneration replaces the
+// whole struct, the same way the frame notify list is replaced, so the DCL
+// callback always sees a handler and refCon that belong together.
+struct DVThumbnailSettings
+{
+	UInt32 frameInterval;
+	DVThumbnailProc handler;
+	void *pRefCon;
+	UInt32 frameCount;					// Only used by the DCL callback
+	DVThumbnailSettings* pNextRetired;
+};
+
 //
 // The DV Receiver Class Declaration
 //
@@ -140,13 +200,20 @@ class DVReceiver
 
 public:
 	// Constructor
+	// Note: If followDVModeChanges is true, the receiver switches to the DV mode of the
+	// incoming stream whenever it changes (sending a kDVReceiverDVModeChanged message),
+	// rather than reporting kDVFrameWrongMode. The DCL program's buffers are sized for
+	// the largest DV mode at receiverDVMode's speed, so no DCL changes are needed. The
+	// frame buffers are sized for the largest DV mode of all, so nothing is allocated
+	// on the DCL callback thread when the mode changes.
     DVReceiver(StringLogger *stringLogger = nil,
 			   IOFireWireLibNubRef nubInterface = nil,
 			   UInt32 numReceiveFrames = kDVReceiveNumFrames,
 			   UInt8 receiverDVMode = 0x00,
 			   unsigned int cyclesPerSegment = kCyclesPerDVReceiveSegment,
 			   unsigned int numSegments = kNumDVReceiveSegments,
-			   bool doIRMAllocations = false);
+			   bool doIRMAllocations = false,
+			   bool followDVModeChanges = false);
 
     // Destructor
     ~DVReceiver();
@@ -179,6 +246,35 @@ public:
 	// Function to release a DVReceiveFrame that was passed to the client via the FrameReceivedProc
 	IOReturn releaseFrame(DVReceiveFrame* pFrame);
 
+	// Function to enable/disable scatter-list frames. Can only be called when stopped.
+	// Note: When enabled, received frames are not copied into pFrameData, but described
+	// by pFrameRanges. The DCL buffers a frame uses are kept out of the DCL program until
+	// the frame is released. A frame's ranges never change once the clients can see it.
+	// If the frames held by the clients already pin so many segments that the next frame
+	// might not be received, a newly completed frame is copied into its pFrameData (and
+	// described by a single range pointing there) before the clients are notified.
+	// Each frame pins up to (kDVReceiverMaxCyclesPerFrame/cyclesPerSegment)+2 segments,
+	// so the receiver must have at least kDVReceiverMinArmedSegments+1 more than that,
+	// or kIOReturnUnsupported is returned. The default 3 segments of 800 cycles are too
+	// few; use many short segments instead (for example, 16 segments of 100 cycles).
+	IOReturn setScatterListFrames(bool enable);
+
+	// Function to enable/disable validation of the DIF blocks of each received frame.
+	// The results are in the frame's frameValidation struct.
+	IOReturn setFrameValidation(bool enable);
+
+	// Function to enable/disable extraction of the timecode, rec date/time, aspect ratio,
+	// and audio format of each received frame, into the frame's frameMetadata struct.
+	IOReturn setFrameMetadataExtraction(bool enable);
+
+	// Function to enable/disable live thumbnails. Every frameInterval'th received frame, a
+	// 1/8-scale thumbnail of the frame is made from its DC coefficients, and passed to the
+	// handler, on the receiver's real-time thread, before the frame receive notify clients
+	// see the frame. A frameInterval of zero disables thumbnails. Only the 25 Mbps DV modes
+	// are supported; frames of other modes are skipped. Once this returns, the previous
+	// handler won't be called again.
+	IOReturn setThumbnailGeneration(UInt32 frameInterval, DVThumbnailProc handler, void *pRefCon = nil);
+
 	// Publically visible vars
 	unsigned int transportState;
 
@@ -189,9 +285,47 @@ private:
 
 	// Take the dvMode, and find the DVFormat info
 	IOReturn FindDVFormatForMode(void);
+	DVFormats* LookupDVFormat(UInt8 mode);
+	
+	// Switch the frame geometry to a new DV mode, without touching the DCL program
+	IOReturn switchDVMode(UInt8 newMode);
+	
+	// The size of the frame buffers, and the number of scatter-list ranges, we allocate for a DV format
+	UInt32 frameBufferSizeForFormat(DVFormats* pFormat);
+	UInt32 frameRangesForFormat(DVFormats* pFormat);
 
-	// Get a frame off the frame queue
+	// Get a free frame from the frame pool
 	DVReceiveFrame* getNextQueuedFrame(void);
+	
+	// Drop a reference to a frame, returning it to the frame pool when the count hits zero
+	bool releaseFrameReference(DVReceiveFrame* pFrame);
+	
+	// Scatter-list frame support
+	IOReturn allocateFrameRanges(DVReceiveFrame* pFrame, DVFormats* pFormat);
+	void addFrameRange(DVReceiveFrame* pFrame, UInt8 *pData, UInt32 length, UInt32 segment);
+	void unpinFrameSegments(DVReceiveFrame* pFrame);
+	void copyFrameRangesToFrameData(DVReceiveFrame* pFrame);
+	void reclaimSegment(UInt32 segment);
+	void armSegment(UInt32 segment);
+	UInt32 segmentsPinnedPerFrame(void);
+	UInt32 pinnedSegmentCount(void);
+	
+	// Fill in a completed frame's frameValidation struct
+	void validateFrame(DVReceiveFrame* pFrame);
+	
+	// Fill in a completed frame's frameMetadata struct
+	void extractFrameMetadata(DVReceiveFrame* pFrame);
+	
+	// Make a thumbnail of a completed frame, if it's time for one
+	void generateThumbnail(DVReceiveFrame* pFrame);
+	
+	// Send a message without a frame to all of the frame receive notify clients
+	void notifyFrameClients(DVFrameNotifyList* pNotifyList, DVFrameReceiveMessage msg);
+	
+	// Swap in a new notify client list, and free the old one once the DCL callback is done with it
+	DVFrameNotifyList* replaceFrameNotifyList(DVFrameNotifyList* pNewList, DVFrameNotifyInst* pRemovedClient);
+	void retireFrameNotifyList(DVFrameNotifyList* pOldList);
+	void deleteFrameNotifyList(DVFrameNotifyList* pNotifyList);
 	DVReceiveFrame* pCurrentFrame;
 	
 	// Interface pointers
@@ -207,8 +341,21 @@ private:
 	
 	// Class Variables
 	UInt8 dvMode;
+	bool followModeChanges;
+	bool scatterListFrames;
+	bool validateFrames;
+	bool extractMetadata;
+	DVFrameValidator frameValidator;
+	DVThumbnailer thumbnailer;
+	DVThumbnail thumbnail;
+	DVFrameBufferPool *pFrameBufferPool;
+	UInt32 *pArmedSegments;			// The segments in the DCL program, in the order they're received into
+	UInt32 armedSegmentsHead;
+	UInt32 armedSegmentsCount;
+	UInt32 lastArmedSegment;
 	DCLCommandPtr *updateDCLList;
 	DCLCommandStruct *pFirstDCL;
+	DCLJumpPtr pDCLStartJump;			// Jumps to the first segment armed at start
 	unsigned int receiveChannel;
 	IOFWSpeed receiveSpeed;
     UInt8 *pReceiveBuffer;
@@ -225,17 +372,31 @@ private:
 	DVFormats* pDVFormat;
 	UInt32 receiveCycleBufferSize;
 	UInt32 *pTimeStamps;
-	pthread_mutex_t frameQueueMutex;
-	UInt32 numFrameClients;
+	DVReceiveFrame* pFramePool;
+	UInt32 nextPoolFrame;
 	UInt32 *pOverrunReceiveBuffer;
 	volatile bool finalizeCallbackCalled;
 	pthread_mutex_t transportControlMutex;
-	std::deque<DVReceiveFrame*> frameQueue;
 		
 	// Message Handler functions
 	DVReceiverMessageProc messageProc;
 	void *pMessageProcRefCon;
-	std::deque<DVFrameNotifyInst*> frameNotifyQueue;
+	
+	// Frame receive notify clients. The list is only read by the DCL callback, which
+	// publishes the snapshot it is using in pFrameNotifyListInUse. Writers are serialized
+	// by frameNotifyListMutex, which the DCL callback never takes.
+	DVFrameNotifyList* volatile pFrameNotifyList;
+	DVFrameNotifyList* volatile pFrameNotifyListInUse;
+	DVFrameNotifyList* pRetiredFrameNotifyLists;
+	pthread_mutex_t frameNotifyListMutex;
+	pthread_t dclCallbackThread;
+	
+	// Thumbnail settings, published and retired like the frame notify list. Nil when
+	// thumbnails are off. Writers are serialized by thumbnailSettingsMutex.
+	DVThumbnailSettings* volatile pThumbnailSettings;
+	DVThumbnailSettings* volatile pThumbnailSettingsInUse;
+	DVThumbnailSettings* pRetiredThumbnailSettings;
+	pthread_mutex_t thumbnailSettingsMutex;
 	
 	// No data callback timer stuff
 	void startNoDataTimer( void );
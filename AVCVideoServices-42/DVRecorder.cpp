@@ -0,0 +1,1178 @@
+/*
+	File:		DVRecorder.cpp
+ 
+ Synopsis: Records DV frames to a file on a separate thread, along with a frame index (.dvnavi) file.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+#include <fcntl.h>
+#include <errno.h>
+
+namespace AVS
+{
+
+// Prototypes for static functions in this file
+static void *DVRecorderWriterThreadStart(DVRecorder *pRecorder);
+static ssize_t DVRecorderWriteAll(int fileDescriptor, const void *pData, UInt32 length, off_t offset);
+static UInt8* DVRecorderFrameDIFBlock(UInt32 frameOffset, void *pRefCon);
+static UInt32 DVTimeCodeToFrameCount(UInt8 hours, UInt8 minutes, UInt8 seconds, UInt8 frames, bool pal, bool dropFrame);
+
+// Used to find a DIF block in a frame that's made up of several ranges
+struct DVRecorderFrameRanges
+{
+	DVReceiveFrameRange *pRanges;
+	UInt32 rangeCount;
+};
+
+//////////////////////////////////////////////////////
+// Constructor
+//////////////////////////////////////////////////////
+DVRecorder::DVRecorder(StringLogger *stringLogger,
+					   UInt32 bufferSize,
+					   UInt32 numBuffers)
+{
+	if (stringLogger == nil)
+	{
+		logger = new StringLogger(nil);	// Throws away all log strings
+		noLogger = true;
+	}
+	else
+	{
+		logger = stringLogger;
+		noLogger = false;
+	}
+	
+	// Round the buffer size up to our granularity
+	if (bufferSize == 0)
+		bufferSize = kDVRecorderDefaultBufferSize;
+	bufferSize = ((bufferSize + kDVRecorderBufferSizeGranularity - 1) /
+		kDVRecorderBufferSizeGranularity) * kDVRecorderBufferSizeGranularity;
+	
+	// Need at least two buffers, so one can fill while the other is written
+	if (numBuffers < 2)
+		numBuffers = 2;
+	
+	this->bufferSize = bufferSize;
+	numWriteBuffers = numBuffers;
+	ppWriteBuffers = nil;
+	pWriteBufferLengths = nil;
+	
+	// Every frame ends in exactly one buffer, and even the smallest frames
+	// can't end in a buffer more often than this.
+	maxFramesPerBuffer = (bufferSize / kDVRecorderMinFrameSize) + 1;
+	ppFrameInfo = nil;
+	pFrameInfoCounts = nil;
+	
+	fillIndex = 0;
+	writeIndex = 0;
+	numFullBuffers = 0;
+	
+	fileDescriptor = -1;
+	naviFileDescriptor = -1;
+	queuedFileOffset = 0;
+	fileOffset = 0;
+	naviFileOffset = 0;
+	writerThreadRunning = false;
+	writerThreadShouldExit = false;
+	
+	bzero(&stats, sizeof(DVRecorderStats));
+	
+	pthread_mutex_init(&bufferQueueMutex, NULL);
+	pthread_cond_init(&bufferQueueCondition, NULL);
+}
+
+//////////////////////////////////////////////////////
+// Destructor
+//////////////////////////////////////////////////////
+DVRecorder::~DVRecorder()
+{
+	closeFile();
+	
+	pthread_cond_destroy(&bufferQueueCondition);
+	pthread_mutex_destroy(&bufferQueueMutex);
+	
+	// If we created an internal logger, free it
+	if (noLogger == true)
+		delete logger;
+}
+
+//////////////////////////////////////////////////////
+// openFile
+//////////////////////////////////////////////////////
+IOReturn DVRecorder::openFile(const char *pFileName, bool alsoCreateNaviFile)
+{
+	UInt32 i;
+	char *pNaviFileName;
+	DVNaviFileHeader naviHeader;
+	
+	if (!pFileName)
+		return kIOReturnBadArgument;
+	
+	// Make sure we are not already recording
+	if (fileDescriptor != -1)
+		return kIOReturnExclusiveAccess;
+	
+	// Allocate the write buffers, and the index entry arrays that go with them.
+	// The buffers come from vm_allocate, so they are page aligned, and already
+	// wired in by the time we start, since we touch every page below.
+	ppWriteBuffers = new UInt8*[numWriteBuffers];
+	pWriteBufferLengths = new UInt32[numWriteBuffers];
+	ppFrameInfo = new DVNaviFileFrameInfo*[numWriteBuffers];
+	pFrameInfoCounts = new UInt32[numWriteBuffers];
+	if ((!ppWriteBuffers) || (!pWriteBufferLengths) || (!ppFrameInfo) || (!pFrameInfoCounts))
+	{
+		releaseBuffers();
+		return kIOReturnNoMemory;
+	}
+	for (i=0;i<numWriteBuffers;i++)
+	{
+		ppWriteBuffers[i] = nil;
+		ppFrameInfo[i] = nil;
+	}
+	for (i=0;i<numWriteBuffers;i++)
+	{
+		vm_allocate(mach_task_self(), (vm_address_t *)&ppWriteBuffers[i], bufferSize, VM_FLAGS_ANYWHERE);
+		ppFrameInfo[i] = new DVNaviFileFrameInfo[maxFramesPerBuffer];
+		if ((!ppWriteBuffers[i]) || (!ppFrameInfo[i]))
+		{
+			logger->log("\nDVRecorder Error: Error allocating write buffers\n\n");
+			releaseBuffers();
+			return kIOReturnNoMemory;
+		}
+		bzero(ppWriteBuffers[i], bufferSize);
+		bzero(ppFrameInfo[i], maxFramesPerBuffer*sizeof(DVNaviFileFrameInfo));
+		pWriteBufferLengths[i] = 0;
+		pFrameInfoCounts[i] = 0;
+	}
+	
+	fileDescriptor = open(pFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fileDescriptor == -1)
+	{
+		logger->log("\nDVRecorder Error: Unable to create file: %s\n\n",pFileName);
+		releaseBuffers();
+		return kIOReturnError;
+	}
+	
+	// Bypass the buffer cache for our (large, page-aligned) writes
+	fcntl(fileDescriptor, F_NOCACHE, 1);
+	
+	if (alsoCreateNaviFile == true)
+	{
+		// Determine the navi filename
+		pNaviFileName = new char[strlen(pFileName)+10]; // Slightly overallocate
+		if (pNaviFileName)
+		{
+			strcpy(pNaviFileName,pFileName);
+			strcat(pNaviFileName,".dvnavi");
+			naviFileDescriptor = open(pNaviFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (naviFileDescriptor == -1)
+				logger->log("\nDVRecorder Error: Unable to create file: %s\n\n",pNaviFileName);
+			delete [] pNaviFileName;
+		}
+		
+		// The navi file's header is always big-endian, as are its frame entries
+		naviHeader.naviFileStructureRevision = EndianU32_NtoB(kDVNaviFileStructureRevision_1);
+		naviHeader.frameInfoSize = EndianU32_NtoB(sizeof(DVNaviFileFrameInfo));
+		if ((naviFileDescriptor == -1) ||
+			(DVRecorderWriteAll(naviFileDescriptor, &naviHeader, sizeof(DVNaviFileHeader), 0) != (ssize_t) sizeof(DVNaviFileHeader)))
+		{
+			if (naviFileDescriptor != -1)
+				close(naviFileDescriptor);
+			naviFileDescriptor = -1;
+			close(fileDescriptor);
+			fileDescriptor = -1;
+			releaseBuffers();
+			return kIOReturnError;
+		}
+	}
+	
+	queuedFileOffset = 0;
+	fileOffset = 0;
+	naviFileOffset = sizeof(DVNaviFileHeader);
+	fillIndex = 0;
+	writeIndex = 0;
+	numFullBuffers = 0;
+	bzero(&stats, sizeof(DVRecorderStats));
+	
+	// Start the writer thread
+	writerThreadShouldExit = false;
+	if (pthread_create(&writerThread, NULL, (void *(*)(void *))DVRecorderWriterThreadStart, this) != 0)
+	{
+		logger->log("\nDVRecorder Error: Unable to create writer thread\n\n");
+		if (naviFileDescriptor != -1)
+			close(naviFileDescriptor);
+		naviFileDescriptor = -1;
+		close(fileDescriptor);
+		fileDescriptor = -1;
+		releaseBuffers();
+		return kIOReturnError;
+	}
+	writerThreadRunning = true;
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// closeFile
+//////////////////////////////////////////////////////
+IOReturn DVRecorder::closeFile(void)
+{
+	IOReturn result = kIOReturnSuccess;
+	
+	if (fileDescriptor == -1)
+		return kIOReturnNotOpen;
+	
+	if (writerThreadRunning == true)
+	{
+		// Hand off any partially filled buffer, and tell the writer
+		// thread to exit once it has written everything
+		pthread_mutex_lock(&bufferQueueMutex);
+		if ((numFullBuffers < numWriteBuffers) && (pWriteBufferLengths[fillIndex] > 0))
+			submitFillBuffer();
+		writerThreadShouldExit = true;
+		pthread_cond_signal(&bufferQueueCondition);
+		pthread_mutex_unlock(&bufferQueueMutex);
+		
+		pthread_join(writerThread, NULL);
+		writerThreadRunning = false;
+	}
+	
+	if (stats.writeErrors > 0)
+		result = kIOReturnIOError;
+	
+	if (naviFileDescriptor != -1)
+	{
+		close(naviFileDescriptor);
+		naviFileDescriptor = -1;
+	}
+	close(fileDescriptor);
+	fileDescriptor = -1;
+	
+	releaseBuffers();
+	
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// releaseBuffers
+//////////////////////////////////////////////////////
+void DVRecorder::releaseBuffers(void)
+{
+	UInt32 i;
+	
+	if (ppWriteBuffers)
+	{
+		for (i=0;i<numWriteBuffers;i++)
+			if (ppWriteBuffers[i])
+				vm_deallocate(mach_task_self(), (vm_address_t) ppWriteBuffers[i], bufferSize);
+		delete [] ppWriteBuffers;
+		ppWriteBuffers = nil;
+	}
+	
+	if (pWriteBufferLengths)
+	{
+		delete [] pWriteBufferLengths;
+		pWriteBufferLengths = nil;
+	}
+	
+	if (ppFrameInfo)
+	{
+		for (i=0;i<numWriteBuffers;i++)
+			if (ppFrameInfo[i])
+				delete [] ppFrameInfo[i];
+		delete [] ppFrameInfo;
+		ppFrameInfo = nil;
+	}
+	
+	if (pFrameInfoCounts)
+	{
+		delete [] pFrameInfoCounts;
+		pFrameInfoCounts = nil;
+	}
+}
+
+//////////////////////////////////////////////////////
+// submitFillBuffer - bufferQueueMutex must be held
+//////////////////////////////////////////////////////
+void DVRecorder::submitFillBuffer(void)
+{
+	numFullBuffers += 1;
+	fillIndex += 1;
+	if (fillIndex == numWriteBuffers)
+		fillIndex = 0;
+	
+	// If the next buffer is free, start filling it
+	if (numFullBuffers < numWriteBuffers)
+	{
+		pWriteBufferLengths[fillIndex] = 0;
+		pFrameInfoCounts[fillIndex] = 0;
+	}
+	
+	pthread_cond_signal(&bufferQueueCondition);
+}
+
+//////////////////////////////////////////////////////
+// pushFrame
+//////////////////////////////////////////////////////
+IOReturn DVRecorder::pushFrame(UInt8 *pFrameData, UInt32 frameLen, UInt8 dvMode, DVFrameMetadata *pMetadata)
+{
+	DVReceiveFrameRange frameRange;
+	
+	if (!pFrameData)
+		return kIOReturnBadArgument;
+	
+	frameRange.pData = pFrameData;
+	frameRange.length = frameLen;
+	
+	return queueFrame(&frameRange, 1, frameLen, dvMode, pMetadata);
+}
+
+//////////////////////////////////////////////////////
+// pushReceiveFrame
+//////////////////////////////////////////////////////
+IOReturn DVRecorder::pushReceiveFrame(DVReceiveFrame *pFrame)
+{
+	DVReceiveFrameRange frameRange;
+	
+	if (!pFrame)
+		return kIOReturnBadArgument;
+	
+	// Scatter-list frames are recorded straight from the receiver's DCL buffers
+	if (pFrame->frameRangeCount > 0)
+		return queueFrame(pFrame->pFrameRanges, pFrame->frameRangeCount, pFrame->frameLen, pFrame->frameMode, &pFrame->frameMetadata);
+	
+	frameRange.pData = pFrame->pFrameData;
+	frameRange.length = pFrame->frameLen;
+	
+	return queueFrame(&frameRange, 1, pFrame->frameLen, pFrame->frameMode, &pFrame->frameMetadata);
+}
+
+//////////////////////////////////////////////////////
+// queueFrame
+//////////////////////////////////////////////////////
+IOReturn DVRecorder::queueFrame(DVReceiveFrameRange *pRanges, UInt32 rangeCount, UInt32 frameLen, UInt8 dvMode, DVFrameMetadata *pMetadata)
+{
+	UInt32 range;
+	UInt32 rangeOffset;
+	UInt32 copyLength;
+	UInt32 fillLength;
+	UInt32 freeSpace;
+	UInt32 backlog;
+	DVFrameMetadata frameMetadata;
+	DVRecorderFrameRanges frameRanges;
+	DVNaviFileFrameInfo *pFrameInfo;
+	
+	if (fileDescriptor == -1)
+		return kIOReturnNotOpen;
+	
+	if ((frameLen < kDVRecorderMinFrameSize) || (frameLen > ((numWriteBuffers-1)*bufferSize)))
+		return kIOReturnBadArgument;
+	
+	// Extract the metadata for the index, if the receiver didn't already do it
+	if ((!pMetadata) || (pMetadata->extracted == false))
+	{
+		if (rangeCount == 1)
+			GetDVFrameMetadata(pRanges[0].pData, frameLen, dvMode, &frameMetadata);
+		else
+		{
+			frameRanges.pRanges = pRanges;
+			frameRanges.rangeCount = rangeCount;
+			GetDVFrameMetadataWithDIFBlockProc(DVRecorderFrameDIFBlock, &frameRanges, frameLen, dvMode, &frameMetadata);
+		}
+		pMetadata = &frameMetadata;
+	}
+	
+	// Frames are recorded whole, or not at all. Make sure the frame fits
+	// in the rest of the fill buffer, plus the buffers after it that the
+	// writer thread isn't holding.
+	pthread_mutex_lock(&bufferQueueMutex);
+	if (numFullBuffers < numWriteBuffers)
+		freeSpace = (bufferSize - pWriteBufferLengths[fillIndex]) + ((numWriteBuffers - numFullBuffers - 1) * bufferSize);
+	else
+		freeSpace = 0;
+	stats.framesReceived += 1;
+	if (freeSpace < frameLen)
+	{
+		stats.framesDropped += 1;
+		pthread_mutex_unlock(&bufferQueueMutex);
+		return kIOReturnNoSpace;
+	}
+	pthread_mutex_unlock(&bufferQueueMutex);
+	
+	// Copy the frame into the fill buffer(s). We don't need to hold the mutex
+	// for the copy, since the writer thread never touches the fill buffer.
+	for (range=0;range<rangeCount;range++)
+	{
+		rangeOffset = 0;
+		while (rangeOffset < pRanges[range].length)
+		{
+			// If the fill buffer is full, hand it off to the writer thread
+			if (pWriteBufferLengths[fillIndex] == bufferSize)
+			{
+				pthread_mutex_lock(&bufferQueueMutex);
+				submitFillBuffer();
+				pthread_mutex_unlock(&bufferQueueMutex);
+			}
+			
+			fillLength = pWriteBufferLengths[fillIndex];
+			copyLength = pRanges[range].length - rangeOffset;
+			if (copyLength > (bufferSize - fillLength))
+				copyLength = bufferSize - fillLength;
+			bcopy(&pRanges[range].pData[rangeOffset], &ppWriteBuffers[fillIndex][fillLength], copyLength);
+			pWriteBufferLengths[fillIndex] = fillLength + copyLength;
+			rangeOffset += copyLength;
+		}
+	}
+	
+	// Add the frame's index entry to the buffer the frame ends in, so it
+	// isn't written to the navi file until all of the frame's data is.
+	pFrameInfo = &ppFrameInfo[fillIndex][pFrameInfoCounts[fillIndex]];
+	pFrameInfo->frameOffset = EndianU64_NtoB(queuedFileOffset);
+	pFrameInfo->frameLen = EndianU32_NtoB(frameLen);
+	pFrameInfo->dvMode = dvMode;
+	pFrameInfo->flags = 0;
+	pFrameInfo->timeCodeHours = pMetadata->timeCodeHours;
+	pFrameInfo->timeCodeMinutes = pMetadata->timeCodeMinutes;
+	pFrameInfo->timeCodeSeconds = pMetadata->timeCodeSeconds;
+	pFrameInfo->timeCodeFrames = pMetadata->timeCodeFrames;
+	pFrameInfo->recYear = EndianU16_NtoB(pMetadata->recYear);
+	pFrameInfo->recMonth = pMetadata->recMonth;
+	pFrameInfo->recDay = pMetadata->recDay;
+	if (pMetadata->timeCodeValid == true)
+		pFrameInfo->flags |= kDVNaviFrameTimeCodeValid;
+	if (pMetadata->timeCodeDropFrame == true)
+		pFrameInfo->flags |= kDVNaviFrameTimeCodeDropFrame;
+	if (pMetadata->recDateValid == true)
+		pFrameInfo->flags |= kDVNaviFrameRecDateValid;
+	pFrameInfoCounts[fillIndex] += 1;
+	queuedFileOffset += frameLen;
+	
+	// Hand off the fill buffer now if the frame filled it, or if it can't
+	// hold the index entry for another frame (only possible if bufferSize
+	// is tiny, since we only allow frames of kDVRecorderMinFrameSize or more)
+	pthread_mutex_lock(&bufferQueueMutex);
+	if ((pWriteBufferLengths[fillIndex] == bufferSize) || (pFrameInfoCounts[fillIndex] == maxFramesPerBuffer))
+		submitFillBuffer();
+	
+	// Update the stats
+	backlog = (numFullBuffers*bufferSize);
+	if (numFullBuffers < numWriteBuffers)
+		backlog += pWriteBufferLengths[fillIndex];
+	stats.backlogBytes = backlog;
+	if (backlog > stats.maxBacklogBytes)
+		stats.maxBacklogBytes = backlog;
+	pthread_mutex_unlock(&bufferQueueMutex);
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// getStats
+//////////////////////////////////////////////////////
+IOReturn DVRecorder::getStats(DVRecorderStats *pStats)
+{
+	if (!pStats)
+		return kIOReturnBadArgument;
+	
+	pthread_mutex_lock(&bufferQueueMutex);
+	*pStats = stats;
+	pthread_mutex_unlock(&bufferQueueMutex);
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// FrameReceived
+//////////////////////////////////////////////////////
+IOReturn DVRecorder::FrameReceived(DVFrameReceiveMessage msg, DVReceiveFrame *pFrame, void *pRefCon)
+{
+	DVRecorder *pRecorder = (DVRecorder*) pRefCon;
+	
+	if ((msg == kDVFrameReceivedSuccessfully) && (pFrame))
+		pRecorder->pushReceiveFrame(pFrame);
+	
+	// We're done with the frame, so let the receiver have it back
+	return kIOReturnError;
+}
+
+//////////////////////////////////////////////////////
+// WriterThread
+//////////////////////////////////////////////////////
+void DVRecorder::WriterThread(void)
+{
+	UInt8 *pWriteBuffer;
+	UInt32 writeLength;
+	UInt32 frameInfoCount;
+	UInt32 frameInfoLength;
+	ssize_t bytesWritten;
+	
+	pthread_mutex_lock(&bufferQueueMutex);
+	
+	for (;;)
+	{
+		// Wait for a full buffer, or for a request to exit
+		while ((numFullBuffers == 0) && (writerThreadShouldExit == false))
+			pthread_cond_wait(&bufferQueueCondition, &bufferQueueMutex);
+		
+		if (numFullBuffers == 0)
+			break;	// Nothing left to write, and we've been told to exit
+		
+		pWriteBuffer = ppWriteBuffers[writeIndex];
+		writeLength = pWriteBufferLengths[writeIndex];
+		frameInfoCount = pFrameInfoCounts[writeIndex];
+		frameInfoLength = frameInfoCount*sizeof(DVNaviFileFrameInfo);
+		
+		// Do the writes without holding the mutex, so the isoch thread can keep filling
+		pthread_mutex_unlock(&bufferQueueMutex);
+		bytesWritten = DVRecorderWriteAll(fileDescriptor, pWriteBuffer, writeLength, fileOffset);
+		pthread_mutex_lock(&bufferQueueMutex);
+		
+		if (bytesWritten != (ssize_t) writeLength)
+		{
+			logger->log("\nDVRecorder Error: Write of %u bytes at offset %lld failed\n\n",
+						(unsigned int) writeLength, (long long) fileOffset);
+			stats.writeErrors += 1;
+		}
+		if (bytesWritten > 0)
+			stats.bytesWritten += bytesWritten;
+		
+		// The index entries were made assuming every byte pushed lands in the file,
+		// so always move on by the full buffer length, even if the write failed.
+		fileOffset += writeLength;
+		stats.buffersWritten += 1;
+		stats.framesWritten += frameInfoCount;
+		
+		if ((naviFileDescriptor != -1) && (frameInfoCount > 0))
+		{
+			pthread_mutex_unlock(&bufferQueueMutex);
+			bytesWritten = DVRecorderWriteAll(naviFileDescriptor, ppFrameInfo[writeIndex], frameInfoLength, naviFileOffset);
+			pthread_mutex_lock(&bufferQueueMutex);
+			
+			if (bytesWritten != (ssize_t) frameInfoLength)
+			{
+				logger->log("\nDVRecorder Error: Write of %u bytes to navi file failed\n\n",
+							(unsigned int) frameInfoLength);
+				stats.writeErrors += 1;
+			}
+			naviFileOffset += frameInfoLength;
+		}
+		
+		// This buffer is free again. If the isoch thread ran out of buffers, it
+		// is waiting on this one, and will start filling it with the next push.
+		if (numFullBuffers == numWriteBuffers)
+		{
+			pWriteBufferLengths[writeIndex] = 0;
+			pFrameInfoCounts[writeIndex] = 0;
+		}
+		numFullBuffers -= 1;
+		writeIndex += 1;
+		if (writeIndex == numWriteBuffers)
+			writeIndex = 0;
+	}
+	
+	pthread_mutex_unlock(&bufferQueueMutex);
+}
+
+//////////////////////////////////////////////////////
+// DVRecorderWriterThreadStart
+//////////////////////////////////////////////////////
+static void *DVRecorderWriterThreadStart(DVRecorder *pRecorder)
+{
+	pRecorder->WriterThread();
+	return nil;
+}
+
+//////////////////////////////////////////////////////
+// DVRecorderWriteAll
+//////////////////////////////////////////////////////
+static ssize_t DVRecorderWriteAll(int fileDescriptor, const void *pData, UInt32 length, off_t offset)
+{
+	UInt32 totalWritten = 0;
+	ssize_t bytesWritten;
+	
+	// pwrite() can write less than asked for (a signal, or a full disk), so keep
+	// going from where it stopped, until it's all written or a write fails outright
+	while (totalWritten < length)
+	{
+		bytesWritten = pwrite(fileDescriptor, ((const UInt8*) pData) + totalWritten, length - totalWritten, offset + totalWritten);
+		if ((bytesWritten == -1) && (errno == EINTR))
+			continue;
+		if (bytesWritten <= 0)
+			break;
+		totalWritten += bytesWritten;
+	}
+	
+	return ((totalWritten == 0) && (length != 0)) ? -1 : (ssize_t) totalWritten;
+}
+
+//////////////////////////////////////////////////////
+// DVRecorderFrameDIFBlock
+//////////////////////////////////////////////////////
+static UInt8* DVRecorderFrameDIFBlock(UInt32 frameOffset, void *pRefCon)
+{
+	DVRecorderFrameRanges *pFrameRanges = (DVRecorderFrameRanges*) pRefCon;
+	UInt32 range;
+	
+	// The ranges are made up of whole source packets, so a DIF block never spans two of them
+	for (range=0;range<pFrameRanges->rangeCount;range++)
+	{
+		if (frameOffset < pFrameRanges->pRanges[range].length)
+			return &pFrameRanges->pRanges[range].pData[frameOffset];
+		frameOffset -= pFrameRanges->pRanges[range].length;
+	}
+	
+	return nil;
+}
+
+//////////////////////////////////////////////////////
+// DVTimeCodeToFrameCount
+//////////////////////////////////////////////////////
+static UInt32 DVTimeCodeToFrameCount(UInt8 hours, UInt8 minutes, UInt8 seconds, UInt8 frames, bool pal, bool dropFrame)
+{
+	UInt32 totalMinutes = (hours*60) + minutes;
+	UInt32 frameCount = (((totalMinutes*60) + seconds) * ((pal == true) ? 25 : 30)) + frames;
+	
+	// NTSC drop-frame time-code skips frames 0 and 1 at the start of every minute, except every tenth minute
+	if ((dropFrame == true) && (pal == false))
+		frameCount -= 2*(totalMinutes - (totalMinutes/10));
+	
+	return frameCount;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::DVNaviFileReader
+/////////////////////////////////////////////////////////////////////////////////////////////
+DVNaviFileReader::DVNaviFileReader(StringLogger *stringLogger)
+{
+	if (stringLogger == nil)
+	{
+		logger = new StringLogger(nil);	// Throws away all log strings
+		noLogger = true;
+	}
+	else
+	{
+		logger = stringLogger;
+		noLogger = false;
+	}
+	
+	hasNaviFile = false;
+	fileDescriptor = -1;
+	pNaviBuf = nil;
+	naviFrameInfoSize = 0;
+	numFrames = 0;
+	currentFrame = 0;
+	constantFrameSize = 0;
+	constantDVMode = 0;
+	pTimeCodeRuns = nil;
+	numTimeCodeRuns = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::~DVNaviFileReader
+/////////////////////////////////////////////////////////////////////////////////////////////
+DVNaviFileReader::~DVNaviFileReader()
+{
+	CloseFiles();
+	
+	// If we created an internal logger, free it
+	if (noLogger == true)
+		delete logger;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::InitWithDVFile
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::InitWithDVFile(const char *pDVFileName, bool failIfNoNaviFile)
+{
+	char *pNaviFileName;
+	int naviFileDescriptor;
+	struct stat fileInfo;
+	struct stat naviFileInfo;
+	DVNaviFileHeader *pNaviHeader;
+	DVNaviFileFrameInfo lastFrameInfo;
+	UInt8 frameHeader[480];
+	UInt32 sourcePacketSize;
+	
+	if (!pDVFileName)
+		return kIOReturnBadArgument;
+	
+	// Allow this object to be reused
+	CloseFiles();
+	
+	fileDescriptor = open(pDVFileName, O_RDONLY);
+	if ((fileDescriptor == -1) || (fstat(fileDescriptor, &fileInfo) != 0))
+	{
+		logger->log("\nDVNaviFileReader Error: Unable to open file: %s\n\n",pDVFileName);
+		CloseFiles();
+		return kIOReturnNotFound;
+	}
+	
+	// Determine the navi filename
+	pNaviFileName = new char[strlen(pDVFileName)+10]; // Slightly overallocate
+	if (!pNaviFileName)
+	{
+		CloseFiles();
+		return kIOReturnNoMemory;
+	}
+	strcpy(pNaviFileName,pDVFileName);
+	strcat(pNaviFileName,".dvnavi");
+	
+	// Open the navi file, and read the entire contents into memory. Only use the
+	// navi file if it has a header we understand, and at least one frame entry.
+	naviFileDescriptor = open(pNaviFileName, O_RDONLY);
+	delete [] pNaviFileName;
+	if ((naviFileDescriptor != -1) &&
+		(fstat(naviFileDescriptor, &naviFileInfo) == 0) &&
+		(naviFileInfo.st_size >= (off_t) (sizeof(DVNaviFileHeader)+sizeof(DVNaviFileFrameInfo))))
+	{
+		pNaviBuf = new UInt8[naviFileInfo.st_size];
+		if (!pNaviBuf)
+		{
+			close(naviFileDescriptor);
+			CloseFiles();
+			return kIOReturnNoMemory;
+		}
+		
+		if (pread(naviFileDescriptor, pNaviBuf, naviFileInfo.st_size, 0) == (ssize_t) naviFileInfo.st_size)
+		{
+			pNaviHeader = (DVNaviFileHeader*) pNaviBuf;
+			naviFrameInfoSize = EndianU32_BtoN(pNaviHeader->frameInfoSize);
+			
+			// Newer revisions may only append fields to the frame entries
+			if ((EndianU32_BtoN(pNaviHeader->naviFileStructureRevision) >= kDVNaviFileStructureRevision_1) &&
+				(naviFrameInfoSize >= sizeof(DVNaviFileFrameInfo)))
+			{
+				numFrames = (naviFileInfo.st_size - sizeof(DVNaviFileHeader)) / naviFrameInfoSize;
+				hasNaviFile = true;
+			}
+		}
+		
+		if (hasNaviFile == false)
+			logger->log("\nDVNaviFileReader Error: Unable to use navi file for: %s\n\n",pDVFileName);
+	}
+	if (naviFileDescriptor != -1)
+		close(naviFileDescriptor);
+	
+	if (hasNaviFile == false)
+	{
+		if (pNaviBuf)
+		{
+			delete [] pNaviBuf;
+			pNaviBuf = nil;
+		}
+		
+		if (failIfNoNaviFile == true)
+		{
+			CloseFiles();
+			return kIOReturnNotFound;
+		}
+		
+		// Without a navi file, assume every frame is the same as the first one
+		if ((pread(fileDescriptor, frameHeader, sizeof(frameHeader), 0) != (ssize_t) sizeof(frameHeader)) ||
+			(GetDVModeFromFrameData(frameHeader, &constantDVMode, &constantFrameSize, &sourcePacketSize) != kIOReturnSuccess))
+		{
+			logger->log("\nDVNaviFileReader Error: Unable to determine DV mode of file: %s\n\n",pDVFileName);
+			CloseFiles();
+			return kIOReturnUnsupported;
+		}
+		numFrames = (UInt32) (fileInfo.st_size / constantFrameSize);
+	}
+	else
+	{
+		// Don't use entries for frames that never made it into the DV file
+		while ((numFrames > 0) &&
+			   ((GetFrameInfo(numFrames-1, &lastFrameInfo) != kIOReturnSuccess) ||
+				((lastFrameInfo.frameOffset + lastFrameInfo.frameLen) > (UInt64) fileInfo.st_size)))
+			numFrames -= 1;
+		
+		buildTimeCodeRuns();
+	}
+	
+	if (numFrames == 0)
+	{
+		logger->log("\nDVNaviFileReader Error: File contains no complete DV frames: %s\n\n",pDVFileName);
+		CloseFiles();
+		return kIOReturnUnderrun;
+	}
+	
+#ifdef F_RDAHEAD
+	// Our reads are mostly sequential, so let the file system read ahead of us
+	fcntl(fileDescriptor, F_RDAHEAD, 1);
+#endif
+	
+	currentFrame = 0;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::CloseFiles
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::CloseFiles(void)
+{
+	if (fileDescriptor != -1)
+	{
+		close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+	
+	if (pNaviBuf)
+	{
+		delete [] pNaviBuf;
+		pNaviBuf = nil;
+	}
+	
+	if (pTimeCodeRuns)
+	{
+		delete [] pTimeCodeRuns;
+		pTimeCodeRuns = nil;
+	}
+	
+	hasNaviFile = false;
+	naviFrameInfoSize = 0;
+	numFrames = 0;
+	currentFrame = 0;
+	constantFrameSize = 0;
+	numTimeCodeRuns = 0;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::buildTimeCodeRuns
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::buildTimeCodeRuns(void)
+{
+	DVNaviFileFrameInfo frameInfo;
+	DVNaviTimeCodeRun scratchRun;
+	DVNaviTimeCodeRun *pRun;
+	UInt32 frame;
+	UInt32 pass;
+	UInt32 runCount;
+	UInt32 frameCount;
+	bool pal;
+	bool dropFrame;
+	
+	// Split the file into runs of frames whose time-codes count up by one, so
+	// a time-code seek only has to do one calculation per run. The first pass
+	// counts the runs, and the second fills them in.
+	for (pass=0;pass<2;pass++)
+	{
+		runCount = 0;
+		pRun = nil;
+		for (frame=0;frame<numFrames;frame++)
+		{
+			GetFrameInfo(frame, &frameInfo);
+			if ((frameInfo.flags & kDVNaviFrameTimeCodeValid) == 0)
+			{
+				pRun = nil;
+				continue;
+			}
+			
+			pal = (DVstandard(frameInfo.dvMode) == kDVStandardPAL);
+			dropFrame = ((frameInfo.flags & kDVNaviFrameTimeCodeDropFrame) != 0);
+			frameCount = DVTimeCodeToFrameCount(frameInfo.timeCodeHours,
+												frameInfo.timeCodeMinutes,
+												frameInfo.timeCodeSeconds,
+												frameInfo.timeCodeFrames,
+												pal,
+												dropFrame);
+			
+			if ((pRun) && (pRun->pal == pal) && (pRun->dropFrame == dropFrame) &&
+				(frameCount == (pRun->firstTimeCodeFrameCount + pRun->numFrames)))
+			{
+				pRun->numFrames += 1;
+				continue;
+			}
+			
+			// Start a new run. The first pass only needs to track the current one.
+			pRun = (pass == 0) ? &scratchRun : &pTimeCodeRuns[runCount];
+			pRun->firstFrame = frame;
+			pRun->numFrames = 1;
+			pRun->firstTimeCodeFrameCount = frameCount;
+			pRun->pal = pal;
+			pRun->dropFrame = dropFrame;
+			runCount += 1;
+		}
+		
+		if ((pass == 0) && (runCount > 0))
+		{
+			pTimeCodeRuns = new DVNaviTimeCodeRun[runCount];
+			if (!pTimeCodeRuns)
+				return kIOReturnNoMemory;
+		}
+		else if (pass == 0)
+			break;
+	}
+	
+	numTimeCodeRuns = runCount;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::GetFrameInfo
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::GetFrameInfo(UInt32 frameNumber, DVNaviFileFrameInfo *pFrameInfo)
+{
+	DVNaviFileFrameInfo *pNaviFrameInfo;
+	
+	if (!pFrameInfo)
+		return kIOReturnBadArgument;
+	
+	if (frameNumber >= numFrames)
+		return kIOReturnNotFound;
+	
+	if (hasNaviFile == true)
+	{
+		// The navi file is big-endian
+		pNaviFrameInfo = (DVNaviFileFrameInfo*) (pNaviBuf + sizeof(DVNaviFileHeader) + (frameNumber*naviFrameInfoSize));
+		*pFrameInfo = *pNaviFrameInfo;
+		pFrameInfo->frameOffset = EndianU64_BtoN(pNaviFrameInfo->frameOffset);
+		pFrameInfo->frameLen = EndianU32_BtoN(pNaviFrameInfo->frameLen);
+		pFrameInfo->recYear = EndianU16_BtoN(pNaviFrameInfo->recYear);
+	}
+	else
+	{
+		bzero(pFrameInfo, sizeof(DVNaviFileFrameInfo));
+		pFrameInfo->frameOffset = (UInt64) frameNumber * (UInt64) constantFrameSize;
+		pFrameInfo->frameLen = constantFrameSize;
+		pFrameInfo->dvMode = constantDVMode;
+	}
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::ReadFrame
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::ReadFrame(UInt32 frameNumber, UInt8 *pBuffer, UInt32 bufferSize, UInt32 *pFrameLen, UInt8 *pDVMode)
+{
+	DVNaviFileFrameInfo frameInfo;
+	IOReturn result;
+	
+	if (!pBuffer)
+		return kIOReturnBadArgument;
+	
+	if (fileDescriptor == -1)
+		return kIOReturnNotOpen;
+	
+	result = GetFrameInfo(frameNumber, &frameInfo);
+	if (result != kIOReturnSuccess)
+		return result;
+	
+	if (frameInfo.frameLen > bufferSize)
+		return kIOReturnNoSpace;
+	
+	if (pread(fileDescriptor, pBuffer, frameInfo.frameLen, frameInfo.frameOffset) != (ssize_t) frameInfo.frameLen)
+	{
+		logger->log("\nDVNaviFileReader Error: Read of frame %u failed\n\n",(unsigned int) frameNumber);
+		return kIOReturnIOError;
+	}
+	
+	if (pFrameLen)
+		*pFrameLen = frameInfo.frameLen;
+	if (pDVMode)
+		*pDVMode = frameInfo.dvMode;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::ReadNextFrame
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::ReadNextFrame(UInt8 *pBuffer, UInt32 bufferSize, UInt32 *pFrameLen, UInt8 *pDVMode)
+{
+	IOReturn result;
+	
+	if (currentFrame >= numFrames)
+		return kIOReturnUnderrun;
+	
+	result = ReadFrame(currentFrame, pBuffer, bufferSize, pFrameLen, pDVMode);
+	if (result == kIOReturnSuccess)
+		currentFrame += 1;
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::SeekForwards
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::SeekForwards(UInt32 seconds)
+{
+	DVNaviFileFrameInfo frameInfo;
+	UInt32 framesToSkip;
+	
+	if (GetFrameInfo(currentFrame, &frameInfo) != kIOReturnSuccess)
+		return kIOReturnError;
+	
+	framesToSkip = seconds * ((DVstandard(frameInfo.dvMode) == kDVStandardPAL) ? 25 : 30);
+	if ((currentFrame + framesToSkip) >= numFrames)
+		return kIOReturnError;
+	
+	currentFrame += framesToSkip;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::SeekBackwards
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::SeekBackwards(UInt32 seconds)
+{
+	DVNaviFileFrameInfo frameInfo;
+	UInt32 framesToSkip;
+	
+	if (numFrames == 0)
+		return kIOReturnError;
+	
+	// We may be positioned at the end of the file
+	GetFrameInfo((currentFrame < numFrames) ? currentFrame : numFrames-1, &frameInfo);
+	
+	framesToSkip = seconds * ((DVstandard(frameInfo.dvMode) == kDVStandardPAL) ? 25 : 30);
+	if (framesToSkip > currentFrame)
+		return SeekToBeginning();
+	
+	currentFrame -= framesToSkip;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::SeekToSpecificFrame
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::SeekToSpecificFrame(UInt32 frameNumber)
+{
+	if (frameNumber >= numFrames)
+		return kIOReturnError;
+	
+	currentFrame = frameNumber;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::SeekToTimeCode
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::SeekToTimeCode(UInt8 hours, UInt8 minutes, UInt8 seconds, UInt8 frames)
+{
+	IOReturn result;
+	UInt32 frameNumber;
+	
+	result = FindTimeCode(hours, minutes, seconds, frames, &frameNumber);
+	if (result == kIOReturnSuccess)
+		currentFrame = frameNumber;
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::SeekToBeginning
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::SeekToBeginning(void)
+{
+	currentFrame = 0;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::FindTimeCode
+/////////////////////////////////////////////////////////////////////////////////////////////
+IOReturn DVNaviFileReader::FindTimeCode(UInt8 hours, UInt8 minutes, UInt8 seconds, UInt8 frames, UInt32 *pFrameNumber)
+{
+	DVNaviTimeCodeRun *pRun;
+	DVNaviFileFrameInfo frameInfo;
+	UInt32 frameCount;
+	UInt32 run;
+	
+	if (!pFrameNumber)
+		return kIOReturnBadArgument;
+	
+	if (hasNaviFile == false)
+		return kIOReturnUnsupported;
+	
+	// A recording with continuous time-code is a single run, so this is just
+	// a calculation. Each time-code break in the recording adds another run.
+	for (run=0;run<numTimeCodeRuns;run++)
+	{
+		pRun = &pTimeCodeRuns[run];
+		frameCount = DVTimeCodeToFrameCount(hours, minutes, seconds, frames, pRun->pal, pRun->dropFrame);
+		if ((frameCount < pRun->firstTimeCodeFrameCount) ||
+			((frameCount - pRun->firstTimeCodeFrameCount) >= pRun->numFrames))
+			continue;
+		
+		// Make sure it's really the time-code we want. A time-code that
+		// drop-frame counting skips can alias a frame that's in the run.
+		GetFrameInfo(pRun->firstFrame + (frameCount - pRun->firstTimeCodeFrameCount), &frameInfo);
+		if ((frameInfo.timeCodeHours == hours) &&
+			(frameInfo.timeCodeMinutes == minutes) &&
+			(frameInfo.timeCodeSeconds == seconds) &&
+			(frameInfo.timeCodeFrames == frames))
+		{
+			*pFrameNumber = pRun->firstFrame + (frameCount - pRun->firstTimeCodeFrameCount);
+			return kIOReturnSuccess;
+		}
+	}
+	
+	return kIOReturnNotFound;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::GetCurrentPositionInFrames
+/////////////////////////////////////////////////////////////////////////////////////////////
+UInt32 DVNaviFileReader::GetCurrentPositionInFrames(void)
+{
+	return currentFrame;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// DVNaviFileReader::GetNumFrames
+/////////////////////////////////////////////////////////////////////////////////////////////
+UInt32 DVNaviFileReader::GetNumFrames(void)
+{
+	return numFrames;
+}
+
+} // namespace AVS
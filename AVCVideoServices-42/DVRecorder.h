@@ -0,0 +1,301 @@
+/*
+	File:		DVRecorder.h
+ 
+ Synopsis: Records DV frames to a file on a separate thread, along with a frame index (.dvnavi) file.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVRECORDER__
+#define __AVCVIDEOSERVICES_DVRECORDER__
+
+namespace AVS
+{
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  DV navigation control file: A navigation control file is used in conjunction
+//  with a DV file to allow random access by frame number or time-code, without
+//  assuming that every frame in the file is the same size (DV mode).
+//
+//  The version 1 dvnavi file structure consists of a DVNaviFileHeader struct,
+//  followed by one DVNaviFileFrameInfo struct for each frame in the DV file.
+//  The navi file for a DV file has the same name, with ".dvnavi" appended.
+//
+//  The class object DVRecorder records DV frames to a DV file without doing any
+//  file i/o on the isoch callback thread, and creates the navi file as it goes.
+//
+//  The class object DVNaviFileReader supports reading frames from a DV file, with
+//  repositioning by frame number or time-code.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+#define kDVNaviFileStructureRevision_1 1
+
+// The first thing in the navigation file is this structure
+typedef struct _DVNaviFileHeader
+{
+	UInt32 naviFileStructureRevision;
+	UInt32 frameInfoSize;		// sizeof(DVNaviFileFrameInfo) of the writer
+}DVNaviFileHeader;
+
+// Values for DVNaviFileFrameInfo.flags
+enum
+{
+	kDVNaviFrameTimeCodeValid = 0x01,
+	kDVNaviFrameTimeCodeDropFrame = 0x02,
+	kDVNaviFrameRecDateValid = 0x04
+};
+
+// After the header, there is one of these structs for each frame in the file
+typedef struct _DVNaviFileFrameInfo
+{
+	UInt64 frameOffset;			// Byte offset of the frame in the DV file
+	UInt32 frameLen;
+	UInt8 dvMode;
+	UInt8 flags;
+	UInt8 timeCodeHours;
+	UInt8 timeCodeMinutes;
+	UInt8 timeCodeSeconds;
+	UInt8 timeCodeFrames;
+	UInt16 recYear;
+	UInt8 recMonth;
+	UInt8 recDay;
+	UInt8 reserved[2];
+}DVNaviFileFrameInfo;
+
+enum
+{
+	// Buffer sizes are rounded up to a multiple of this, so every
+	// full buffer is a multiple of the VM page size. Frames are packed
+	// into the buffers back to back, and can span two buffers.
+	kDVRecorderBufferSizeGranularity = 0x10000,
+	
+	// Defaults for the write buffer pool
+	kDVRecorderDefaultBufferSize = 0x400000,
+	kDVRecorderDefaultNumBuffers = 8,
+	
+	// The smallest DV frame (SDL_525_60)
+	kDVRecorderMinFrameSize = 60000
+};
+
+// Struct to hold the recorder's stats
+struct DVRecorderStats
+{
+	UInt32 framesReceived;		// Total frames pushed into the recorder
+	UInt32 framesWritten;		// Frames written to the file (and indexed)
+	UInt32 framesDropped;		// Frames dropped because there wasn't enough write buffer space
+	UInt64 bytesWritten;		// Total bytes written to the DV file
+	UInt32 backlogBytes;		// Bytes received, but not yet written
+	UInt32 maxBacklogBytes;		// The high-water mark of backlogBytes
+	UInt32 buffersWritten;		// Number of buffer writes done by the writer thread
+	UInt32 writeErrors;			// Number of failed (or short) writes, to either file
+};
+
+/////////////////////////////////////
+//
+// DVRecorder Class object
+//
+/////////////////////////////////////
+class DVRecorder
+{
+	
+public:
+	// Constructor
+	DVRecorder(StringLogger *stringLogger = nil,
+			   UInt32 bufferSize = kDVRecorderDefaultBufferSize,
+			   UInt32 numBuffers = kDVRecorderDefaultNumBuffers);
+	
+	// Destructor
+	~DVRecorder();
+	
+	// Allocate the write buffers, create the DV file (and its navi file), and start the writer thread
+	IOReturn openFile(const char *pFileName, bool alsoCreateNaviFile = true);
+	
+	// Write any partially filled buffer, stop the writer thread, and close the files
+	IOReturn closeFile(void);
+	
+	// Push a received frame into the recorder. Safe to call from the isoch callback thread.
+	// If pMetadata is nil (or wasn't extracted), the recorder extracts the frame's metadata itself.
+	IOReturn pushFrame(UInt8 *pFrameData, UInt32 frameLen, UInt8 dvMode, DVFrameMetadata *pMetadata = nil);
+	
+	// Same as above, for a DVReceiver frame (which may be a scatter-list frame)
+	IOReturn pushReceiveFrame(DVReceiveFrame *pFrame);
+	
+	// Get a snapshot of the recorder's stats
+	IOReturn getStats(DVRecorderStats *pStats);
+	
+	// Helper that can be registered as a DVReceiver frame received callback (pRefCon is the DVRecorder)
+	static IOReturn FrameReceived(DVFrameReceiveMessage msg, DVReceiveFrame *pFrame, void *pRefCon);
+	
+	// Writer thread entry point
+	void WriterThread(void);
+	
+private:
+	
+	// Copy a frame, made up of one or more ranges, into the write buffers
+	IOReturn queueFrame(DVReceiveFrameRange *pRanges, UInt32 rangeCount, UInt32 frameLen, UInt8 dvMode, DVFrameMetadata *pMetadata);
+	
+	// Hand the current fill buffer to the writer thread
+	void submitFillBuffer(void);
+	
+	// Free the write buffers
+	void releaseBuffers(void);
+	
+	StringLogger *logger;
+	bool noLogger;
+	
+	int fileDescriptor;
+	int naviFileDescriptor;
+	UInt32 bufferSize;
+	UInt32 numWriteBuffers;
+	UInt8 **ppWriteBuffers;
+	UInt32 *pWriteBufferLengths;
+	
+	// The index entries for the frames that end in each buffer. They're
+	// appended to the navi file after the buffer has been written.
+	UInt32 maxFramesPerBuffer;
+	DVNaviFileFrameInfo **ppFrameInfo;
+	UInt32 *pFrameInfoCounts;
+	
+	// The buffers are filled and written in order. The writer thread
+	// writes buffer writeIndex, and the next numFullBuffers after it.
+	// The isoch thread fills buffer fillIndex, when one is available.
+	UInt32 fillIndex;
+	UInt32 writeIndex;
+	UInt32 numFullBuffers;
+	
+	UInt64 queuedFileOffset;	// Where the next frame pushed will go in the file (isoch thread only)
+	off_t fileOffset;
+	off_t naviFileOffset;
+	pthread_t writerThread;
+	bool writerThreadRunning;
+	volatile bool writerThreadShouldExit;
+	pthread_mutex_t bufferQueueMutex;
+	pthread_cond_t bufferQueueCondition;
+	
+	DVRecorderStats stats;
+};
+
+// A run of frames with continuous time-code, used for seeking by time-code
+struct DVNaviTimeCodeRun
+{
+	UInt32 firstFrame;
+	UInt32 numFrames;
+	UInt32 firstTimeCodeFrameCount;	// The time-code of firstFrame, as a count of frames since 00:00:00:00
+	bool pal;
+	bool dropFrame;
+};
+
+/////////////////////////////////////
+//
+// DVNaviFileReader Class object
+//
+/////////////////////////////////////
+class DVNaviFileReader
+{
+	
+public:
+	
+	// Constructor/Destructor
+	DVNaviFileReader(StringLogger *stringLogger = nil);
+	~DVNaviFileReader();
+	
+	// Initialization. If there's no navi file, and failIfNoNaviFile is false, every frame
+	// is assumed to be the same size as the first one, and time-code seeks aren't supported.
+	IOReturn InitWithDVFile(const char *pDVFileName, bool failIfNoNaviFile = true);
+	
+	// Close Files - Allows for another call to InitWithDVFile(...) without tearing down this object
+	IOReturn CloseFiles(void);
+	
+	// Read the frame at the current position, and advance to the next frame
+	IOReturn ReadNextFrame(UInt8 *pBuffer, UInt32 bufferSize, UInt32 *pFrameLen = nil, UInt8 *pDVMode = nil);
+	
+	// Read a specific frame, without changing the current position
+	IOReturn ReadFrame(UInt32 frameNumber, UInt8 *pBuffer, UInt32 bufferSize, UInt32 *pFrameLen = nil, UInt8 *pDVMode = nil);
+	
+	// Random Access
+	IOReturn SeekForwards(UInt32 seconds);
+	IOReturn SeekBackwards(UInt32 seconds);
+	IOReturn SeekToSpecificFrame(UInt32 frameNumber);
+	IOReturn SeekToTimeCode(UInt8 hours, UInt8 minutes, UInt8 seconds, UInt8 frames);
+	IOReturn SeekToBeginning(void);
+	
+	// Find the (first) frame with the specified time-code
+	IOReturn FindTimeCode(UInt8 hours, UInt8 minutes, UInt8 seconds, UInt8 frames, UInt32 *pFrameNumber);
+	
+	// The current position, in frames
+	UInt32 GetCurrentPositionInFrames(void);
+	
+	// Get the offset, size, mode, time-code, and rec date of a frame
+	IOReturn GetFrameInfo(UInt32 frameNumber, DVNaviFileFrameInfo *pFrameInfo);
+	
+	// The number of frames in the file
+	UInt32 GetNumFrames(void);
+	
+	// Client can use this to determine if we've opened a navi file for the current DV file
+	bool hasNaviFile;
+	
+private:
+	
+	// Build the table of continuous time-code runs
+	IOReturn buildTimeCodeRuns(void);
+	
+	StringLogger *logger;
+	bool noLogger;
+	
+	int fileDescriptor;
+	UInt8 *pNaviBuf;
+	UInt32 naviFrameInfoSize;
+	UInt32 numFrames;
+	UInt32 currentFrame;
+	
+	// Without a navi file, frames are at multiples of this
+	UInt32 constantFrameSize;
+	UInt8 constantDVMode;
+	
+	DVNaviTimeCodeRun *pTimeCodeRuns;
+	UInt32 numTimeCodeRuns;
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVRECORDER__
@@ -0,0 +1,470 @@
+/*
+	File:		DVThumbnailer.cpp
+ 
+ Synopsis: Makes 1/8-scale thumbnails of DV frames from the DC coefficients of their DCT blocks.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+namespace AVS
+{
+
+// Video DIF block layout
+enum
+{
+	kDVVideoBlocksPerSequence = 135,
+	kDVVideoBlocksPerSegment = 5,
+	kDVThumbnailNotVideo = 0xFFFF,
+	kDVThumbnailSquareMacroblock = 0x8000,
+	kDVThumbnailPlacementMask = 0x7FFF
+};
+
+// Byte offsets of the DCT blocks in a 25 Mbps video DIF block (after the block ID and STA/QNO)
+static const UInt8 kDVLumaBlockOffset[4] = { 4, 18, 32, 46 };
+static const UInt8 kDVCrBlockOffset = 60;
+static const UInt8 kDVCbBlockOffset = 70;
+
+// Shared between the makeThumbnails worker threads
+struct DVThumbnailerWork
+{
+	DVThumbnailer *pThumbnailer;
+	UInt8 **ppFrameData;
+	UInt32 numFrames;
+	UInt32 frameLen;
+	DVThumbnail *pThumbnails;
+	IOReturn result;
+};
+
+// Prototypes for static functions in this file
+static void *DVThumbnailerWorkerThreadStart(DVThumbnailerWork *pWork);
+
+// The DC coefficient of a DCT block is its first 9 bits, signed, in units of half
+// a pixel level, centered on 128. Offsetting it by 256 and dropping the low bit
+// leaves the first byte with its top bit flipped.
+#define DVBlockDC(pDCTBlock) ((UInt8) ((pDCTBlock)[0] ^ 0x80))
+
+/////////////////////////////////////////////////////////
+// DVThumbnailer::DVThumbnailer
+/////////////////////////////////////////////////////////
+DVThumbnailer::DVThumbnailer(UInt8 initialDVMode)
+{
+	currentDVMode = 0xFF;
+	pDVFormat = nil;
+	numSequences = 0;
+	thumbnailHeight = 0;
+	
+	setDVMode(initialDVMode);
+}
+
+/////////////////////////////////////////////////////////
+// DVThumbnailer::~DVThumbnailer
+/////////////////////////////////////////////////////////
+DVThumbnailer::~DVThumbnailer()
+{
+}
+
+/////////////////////////////////////////////////////////
+// DVThumbnailer::setDVMode
+/////////////////////////////////////////////////////////
+IOReturn DVThumbnailer::setDVMode(UInt8 dvMode)
+{
+	// The order of the macroblocks in a video segment, and where the
+	// segment's five superblocks start (SMPTE 314M, IEC 61834-2)
+	static const UInt8 superBlockRowOffset[kDVVideoBlocksPerSegment] = { 2, 6, 8, 0, 4 };
+	static const UInt8 superBlockColumn420[kDVVideoBlocksPerSegment] = { 18, 9, 27, 0, 36 };
+	static const UInt8 superBlockColumn411[kDVVideoBlocksPerSegment] = { 9, 4, 13, 0, 18 };
+	static const UInt8 serpentine420[27] = { 0,1,2,2,1,0, 0,1,2,2,1,0, 0,1,2,2,1,0, 0,1,2,2,1,0, 0,1,2 };
+	static const UInt8 serpentine411[30] = { 0,1,2,3,4,5,5,4,3,2,1,0, 0,1,2,3,4,5,5,4,3,2,1,0, 0,1,2,3,4,5 };
+	
+	UInt32 i = 0;
+	UInt32 sequence;
+	UInt32 videoBlock;
+	UInt32 superBlock;
+	UInt32 macroBlock;
+	UInt32 superBlockRow;
+	UInt32 column;
+	UInt32 row;
+	UInt32 x;
+	UInt32 y;
+	UInt16 shape;
+	bool is420;
+	DVFormats *pFormat = nil;
+	
+	// Find the DVFormat table entry for this mode, disregarding the speed bits
+	while (dvFormats[i].frameSize != 0)
+	{
+		if ((dvMode & 0xFC) == dvFormats[i].mode)
+		{
+			pFormat = &dvFormats[i];
+			break;
+		}
+		i++;
+	}
+	
+	// Only the 25 Mbps modes, which have one channel of 10 or 12 DIF sequences.
+	// The current mode and placement table are left as they were.
+	if ((pFormat == nil) || (DVstype(dvMode) == 0x01) || (pFormat->frameSize > (kDVDIFSequenceSize*12)))
+		return kIOReturnUnsupported;
+	
+	pDVFormat = pFormat;
+	currentDVMode = dvMode;
+	numSequences = pDVFormat->frameSize / kDVDIFSequenceSize;
+	thumbnailHeight = numSequences * 6;
+	
+	// 625-50 DV is 4:2:0, with 16x16 macroblocks. The rest are 4:1:1, with 32x8
+	// macroblocks, except at the right edge, where they're 16x16.
+	is420 = ((dvMode & 0xFC) == 0x80);
+	
+	for (i=0;i<(kDVDIFBlocksPerSequence*12);i++)
+		blockPlacement[i] = kDVThumbnailNotVideo;
+	
+	for (sequence=0;sequence<numSequences;sequence++)
+	{
+		for (videoBlock=0;videoBlock<kDVVideoBlocksPerSequence;videoBlock++)
+		{
+			// Each video segment has one macroblock from each of five superblocks
+			superBlock = videoBlock % kDVVideoBlocksPerSegment;
+			macroBlock = videoBlock / kDVVideoBlocksPerSegment;
+			superBlockRow = (sequence + superBlockRowOffset[superBlock]) % numSequences;
+			
+			if (is420 == true)
+			{
+				column = superBlockColumn420[superBlock] + (macroBlock / 3);
+				row = serpentine420[macroBlock] + (superBlockRow * 3);
+				x = column * 2;
+				y = row * 2;
+				shape = kDVThumbnailSquareMacroblock;
+			}
+			else
+			{
+				// The superblocks in the middle columns are offset by half a row of macroblocks
+				if ((superBlock == 1) || (superBlock == 2))
+					macroBlock += 3;
+				column = superBlockColumn411[superBlock] + (macroBlock / 6);
+				x = column * 4;
+				if (column < 22)
+				{
+					y = serpentine411[macroBlock] + (superBlockRow * 6);
+					shape = 0;
+				}
+				else
+				{
+					// The right edge macroblocks are two rows high, so there are only three down a superblock
+					y = (serpentine411[macroBlock] * 2) + (superBlockRow * 6);
+					shape = kDVThumbnailSquareMacroblock;
+				}
+			}
+			
+			// Video blocks follow the header, subcode and VAUX blocks, with an audio block before each 15
+			blockPlacement[(sequence*kDVDIFBlocksPerSequence) + 7 + videoBlock + (videoBlock/15)] =
+				(UInt16) (shape | ((y*kDVThumbnailMaxWidth) + x));
+		}
+	}
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////
+// DVThumbnailer::makeThumbnail
+/////////////////////////////////////////////////////////
+IOReturn DVThumbnailer::makeThumbnail(UInt8 *pFrameData, UInt32 frameLen, UInt8 dvMode, DVThumbnail *pThumbnail)
+{
+	IOReturn result;
+	
+	if ((!pFrameData) || (!pThumbnail))
+		return kIOReturnBadArgument;
+	
+	result = beginThumbnail(frameLen, dvMode, pThumbnail);
+	if (result != kIOReturnSuccess)
+		return result;
+	
+	processFrameData(pFrameData, frameLen, 0, pThumbnail);
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////
+// DVThumbnailer::makeThumbnail
+/////////////////////////////////////////////////////////
+IOReturn DVThumbnailer::makeThumbnail(DVFrame *pFrame, DVThumbnail *pThumbnail)
+{
+	IOReturn result;
+	
+	if ((!pFrame) || (!pThumbnail))
+		return kIOReturnBadArgument;
+	
+	result = makeThumbnail(pFrame->pFrameData, pFrame->frameLen, pFrame->frameMode, pThumbnail);
+	pThumbnail->frameSYTTime = pFrame->frameSYTTime;
+	pThumbnail->frameTimeStamp = pFrame->packetStartTimeStamp;
+	pThumbnail->frameU64TimeStamp = pFrame->packetStartU64TimeStamp;
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////
+// DVThumbnailer::makeThumbnail
+/////////////////////////////////////////////////////////
+IOReturn DVThumbnailer::makeThumbnail(DVReceiveFrame *pFrame, DVThumbnail *pThumbnail)
+{
+	IOReturn result;
+	UInt32 range;
+	UInt32 frameOffset = 0;
+	
+	if ((!pFrame) || (!pThumbnail))
+		return kIOReturnBadArgument;
+	
+	result = beginThumbnail(pFrame->frameLen, pFrame->frameMode, pThumbnail);
+	if (result != kIOReturnSuccess)
+		return result;
+	
+	if (pFrame->frameRangeCount > 0)
+	{
+		// Ranges are whole data blocks, so a DIF block is never split between two of them
+		for (range=0;range<pFrame->frameRangeCount;range++)
+		{
+			if ((frameOffset + pFrame->pFrameRanges[range].length) > pFrame->frameLen)
+				break;
+			processFrameData(pFrame->pFrameRanges[range].pData, pFrame->pFrameRanges[range].length, frameOffset, pThumbnail);
+			frameOffset += pFrame->pFrameRanges[range].length;
+		}
+	}
+	else
+		processFrameData(pFrame->pFrameData, pFrame->frameLen, 0, pThumbnail);
+	
+	pThumbnail->frameSYTTime = pFrame->frameSYTTime;
+	pThumbnail->frameTimeStamp = pFrame->frameReceivedTimeStamp;
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////
+// DVThumbnailer::makeThumbnails
+/////////////////////////////////////////////////////////
+IOReturn DVThumbnailer::makeThumbnails(UInt8 **ppFrameData,
+									   UInt32 numFrames,
+									   UInt32 frameLen,
+									   UInt8 dvMode,
+									   DVThumbnail *pThumbnails,
+									   UInt32 numThreads)
+{
+	IOReturn result = kIOReturnSuccess;
+	DVThumbnailerWork work[kDVThumbnailMaxThreads];
+	pthread_t workerThreads[kDVThumbnailMaxThreads];
+	bool threadStarted[kDVThumbnailMaxThreads];
+	UInt32 framesPerThread;
+	UInt32 firstFrame = 0;
+	UInt32 thread;
+	
+	if ((!ppFrameData) || (!pThumbnails))
+		return kIOReturnBadArgument;
+	if (numFrames == 0)
+		return kIOReturnSuccess;
+	
+	// Set the DV mode here, so the worker threads only read the placement table
+	if (dvMode != currentDVMode)
+		result = setDVMode(dvMode);
+	if (result != kIOReturnSuccess)
+		return result;
+	if ((!pDVFormat) || (frameLen != pDVFormat->frameSize))
+		return kIOReturnBadArgument;
+	
+	if (numThreads > kDVThumbnailMaxThreads)
+		numThreads = kDVThumbnailMaxThreads;
+	if (numThreads > numFrames)
+		numThreads = numFrames;
+	if (numThreads == 0)
+		numThreads = 1;
+	
+	// Give each thread a run of consecutive frames
+	framesPerThread = (numFrames + numThreads - 1) / numThreads;
+	for (thread=0;thread<numThreads;thread++)
+	{
+		work[thread].pThumbnailer = this;
+		work[thread].ppFrameData = &ppFrameData[firstFrame];
+		work[thread].numFrames = ((numFrames - firstFrame) < framesPerThread) ? (numFrames - firstFrame) : framesPerThread;
+		work[thread].frameLen = frameLen;
+		work[thread].pThumbnails = &pThumbnails[firstFrame];
+		work[thread].result = kIOReturnSuccess;
+		firstFrame += work[thread].numFrames;
+		
+		// The first run is done on this thread
+		threadStarted[thread] = false;
+		if ((thread > 0) && (work[thread].numFrames > 0))
+			threadStarted[thread] = (pthread_create(&workerThreads[thread], NULL, (void *(*)(void *))DVThumbnailerWorkerThreadStart, &work[thread]) == 0);
+	}
+	
+	// Do our run, along with any run we couldn't start a thread for
+	for (thread=0;thread<numThreads;thread++)
+	{
+		if (threadStarted[thread] == false)
+			work[thread].result = makeThumbnailsInRange(work[thread].ppFrameData, work[thread].numFrames, frameLen, work[thread].pThumbnails);
+	}
+	
+	for (thread=0;thread<numThreads;thread++)
+	{
+		if (threadStarted[thread] == true)
+			pthread_join(workerThreads[thread], NULL);
+		if ((result == kIOReturnSuccess) && (work[thread].result != kIOReturnSuccess))
+			result = work[thread].result;
+	}
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////
+// DVThumbnailer::makeThumbnailsInRange
+/////////////////////////////////////////////////////////
+IOReturn DVThumbnailer::makeThumbnailsInRange(UInt8 **ppFrameData, UInt32 numFrames, UInt32 frameLen, DVThumbnail *pThumbnails)
+{
+	IOReturn result = kIOReturnSuccess;
+	IOReturn frameResult;
+	UInt32 frame;
+	
+	// The DV mode is already set, so this won't change the placement table
+	for (frame=0;frame<numFrames;frame++)
+	{
+		frameResult = makeThumbnail(ppFrameData[frame], frameLen, currentDVMode, &pThumbnails[frame]);
+		if ((result == kIOReturnSuccess) && (frameResult != kIOReturnSuccess))
+			result = frameResult;
+	}
+	
+	return result;
+}
+
+/////////////////////////////////////////////////////////
+// DVThumbnailer::beginThumbnail
+/////////////////////////////////////////////////////////
+IOReturn DVThumbnailer::beginThumbnail(UInt32 frameLen, UInt8 dvMode, DVThumbnail *pThumbnail)
+{
+	IOReturn result = kIOReturnSuccess;
+	
+	pThumbnail->width = 0;
+	pThumbnail->height = 0;
+	pThumbnail->dvMode = dvMode;
+	pThumbnail->skippedBlocks = 0;
+	pThumbnail->frameSYTTime = 0xFFFFFFFF;
+	pThumbnail->frameTimeStamp = 0xFFFFFFFF;
+	pThumbnail->frameU64TimeStamp = 0xFFFFFFFFFFFFFFFFLL;
+	
+	if (dvMode != currentDVMode)
+		result = setDVMode(dvMode);
+	if (result != kIOReturnSuccess)
+		return result;
+	if ((!pDVFormat) || (frameLen != pDVFormat->frameSize))
+		return kIOReturnBadArgument;
+	
+	pThumbnail->width = kDVThumbnailMaxWidth;
+	pThumbnail->height = thumbnailHeight;
+	
+	// Any macroblock we don't find is left gray
+	memset(pThumbnail->lumaPlane, 128, kDVThumbnailMaxWidth*thumbnailHeight);
+	memset(pThumbnail->cbPlane, 128, kDVThumbnailMaxWidth*thumbnailHeight);
+	memset(pThumbnail->crPlane, 128, kDVThumbnailMaxWidth*thumbnailHeight);
+	
+	return kIOReturnSuccess;
+}
+
+/////////////////////////////////////////////////////////
+// DVThumbnailer::processFrameData
+/////////////////////////////////////////////////////////
+void DVThumbnailer::processFrameData(UInt8 *pData, UInt32 length, UInt32 frameOffset, DVThumbnail *pThumbnail)
+{
+	UInt32 block = frameOffset / kDVDIFBlockSize;
+	UInt32 lastBlock = block + (length / kDVDIFBlockSize);
+	UInt16 placement;
+	UInt8 *pLuma;
+	UInt8 *pCb;
+	UInt8 *pCr;
+	UInt8 cb;
+	UInt8 cr;
+	
+	for (;block<lastBlock;block++,pData+=kDVDIFBlockSize)
+	{
+		placement = blockPlacement[block];
+		if (placement == kDVThumbnailNotVideo)
+			continue;
+		
+		// Don't use a block that isn't a video block (SCT 4)
+		if ((pData[0] & 0xE0) != 0x80)
+		{
+			pThumbnail->skippedBlocks += 1;
+			continue;
+		}
+		
+		pLuma = &pThumbnail->lumaPlane[placement & kDVThumbnailPlacementMask];
+		pCb = &pThumbnail->cbPlane[placement & kDVThumbnailPlacementMask];
+		pCr = &pThumbnail->crPlane[placement & kDVThumbnailPlacementMask];
+		cr = DVBlockDC(&pData[kDVCrBlockOffset]);
+		cb = DVBlockDC(&pData[kDVCbBlockOffset]);
+		
+		if (placement & kDVThumbnailSquareMacroblock)
+		{
+			pLuma[0] = DVBlockDC(&pData[kDVLumaBlockOffset[0]]);
+			pLuma[1] = DVBlockDC(&pData[kDVLumaBlockOffset[1]]);
+			pLuma[kDVThumbnailMaxWidth] = DVBlockDC(&pData[kDVLumaBlockOffset[2]]);
+			pLuma[kDVThumbnailMaxWidth+1] = DVBlockDC(&pData[kDVLumaBlockOffset[3]]);
+			pCb[0] = pCb[1] = pCb[kDVThumbnailMaxWidth] = pCb[kDVThumbnailMaxWidth+1] = cb;
+			pCr[0] = pCr[1] = pCr[kDVThumbnailMaxWidth] = pCr[kDVThumbnailMaxWidth+1] = cr;
+		}
+		else
+		{
+			pLuma[0] = DVBlockDC(&pData[kDVLumaBlockOffset[0]]);
+			pLuma[1] = DVBlockDC(&pData[kDVLumaBlockOffset[1]]);
+			pLuma[2] = DVBlockDC(&pData[kDVLumaBlockOffset[2]]);
+			pLuma[3] = DVBlockDC(&pData[kDVLumaBlockOffset[3]]);
+			pCb[0] = pCb[1] = pCb[2] = pCb[3] = cb;
+			pCr[0] = pCr[1] = pCr[2] = pCr[3] = cr;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////
+// DVThumbnailerWorkerThreadStart
+/////////////////////////////////////////////////////////
+static void *DVThumbnailerWorkerThreadStart(DVThumbnailerWork *pWork)
+{
+	pWork->result = pWork->pThumbnailer->makeThumbnailsInRange(pWork->ppFrameData, pWork->numFrames, pWork->frameLen, pWork->pThumbnails);
+	return nil;
+}
+
+} // namespace AVS
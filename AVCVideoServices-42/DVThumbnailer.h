@@ -0,0 +1,147 @@
+/*
+	File:		DVThumbnailer.h
+ 
+ Synopsis: Makes 1/8-scale thumbnails of DV frames from the DC coefficients of their DCT blocks.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVTHUMBNAILER__
+#define __AVCVIDEOSERVICES_DVTHUMBNAILER__
+
+namespace AVS
+{
+
+struct DVReceiveFrame;
+
+// DV thumbnail constants
+enum
+{
+	kDVThumbnailMaxWidth = 90,		// 720 pixels / 8
+	kDVThumbnailMaxHeight = 72,		// 576 lines / 8 (625-50). 525-60 thumbnails are 60 lines.
+	kDVThumbnailMaxThreads = 8		// For makeThumbnails
+};
+
+// A 1/8-scale image of a DV frame. Each pixel is the DC coefficient (the average) of
+// the 8x8 luma block it came from, and of the chroma block that covers it, so the
+// chroma planes are the same size as the luma plane. The planes are stored row by row,
+// kDVThumbnailMaxWidth bytes apart, with 8-bit Y'CbCr values (chroma centered on 128).
+struct DVThumbnail
+{
+	UInt32 width;
+	UInt32 height;
+	UInt8 dvMode;
+	UInt32 skippedBlocks;		// DIF blocks in video block positions without a video block ID. Their pixels are left gray.
+	
+	// The timestamps of the frame the thumbnail came from
+	UInt32 frameSYTTime;
+	UInt32 frameTimeStamp;
+	UInt64 frameU64TimeStamp;	// 0xFFFFFFFFFFFFFFFF if not known
+	
+	UInt8 lumaPlane[kDVThumbnailMaxWidth*kDVThumbnailMaxHeight];
+	UInt8 cbPlane[kDVThumbnailMaxWidth*kDVThumbnailMaxHeight];
+	UInt8 crPlane[kDVThumbnailMaxWidth*kDVThumbnailMaxHeight];
+};
+
+//
+// The DVThumbnailer Class Declaration
+//
+// Makes a thumbnail of a DV frame without decoding it. Only the DC coefficient of each
+// DCT block is read: the first 9 bits of the block's data in its video DIF block. The
+// DIF blocks are read in frame order, and where each video DIF block's macroblock
+// goes in the thumbnail comes from a table built when the DV mode is set, so a frame
+// is one pass over its data, reading 6 bytes from each video block.
+//
+// Only the 25 Mbps modes (DV and DVCPro25, 525-60 and 625-50) are supported.
+//
+class DVThumbnailer
+{
+	
+public:
+	// Constructor
+	DVThumbnailer(UInt8 initialDVMode = 0x00);
+	
+	// Destructor
+	~DVThumbnailer();
+	
+	// Set the DV mode of the frames to make thumbnails of
+	IOReturn setDVMode(UInt8 dvMode);
+	
+	// Make a thumbnail of a whole frame. Sets the DV mode first, if needed.
+	IOReturn makeThumbnail(UInt8 *pFrameData, UInt32 frameLen, UInt8 dvMode, DVThumbnail *pThumbnail);
+	
+	// Same as above, for a DVFramer frame, or a DVReceiver frame (which may be a
+	// scatter-list frame).
+	IOReturn makeThumbnail(DVFrame *pFrame, DVThumbnail *pThumbnail);
+	IOReturn makeThumbnail(DVReceiveFrame *pFrame, DVThumbnail *pThumbnail);
+	
+	// Make thumbnails of a batch of frames of the same DV mode, splitting the frames
+	// between up to numThreads threads (including the calling thread). Returns the
+	// first error, if any of the frames failed.
+	IOReturn makeThumbnails(UInt8 **ppFrameData,
+							UInt32 numFrames,
+							UInt32 frameLen,
+							UInt8 dvMode,
+							DVThumbnail *pThumbnails,
+							UInt32 numThreads = 1);
+	
+	// Used by the makeThumbnails worker threads
+	IOReturn makeThumbnailsInRange(UInt8 **ppFrameData, UInt32 numFrames, UInt32 frameLen, DVThumbnail *pThumbnails);
+	
+private:
+	
+	IOReturn beginThumbnail(UInt32 frameLen, UInt8 dvMode, DVThumbnail *pThumbnail);
+	void processFrameData(UInt8 *pData, UInt32 length, UInt32 frameOffset, DVThumbnail *pThumbnail);
+	
+	UInt8 currentDVMode;
+	DVFormats *pDVFormat;
+	UInt32 numSequences;
+	UInt32 thumbnailHeight;
+	
+	// For each DIF block of the frame, where its macroblock's top-left pixel is in the
+	// thumbnail planes, or kDVThumbnailNotVideo. kDVThumbnailSquareMacroblock is set
+	// for a 2x2 pixel macroblock; otherwise the macroblock is 4x1 pixels.
+	UInt16 blockPlacement[kDVDIFBlocksPerSequence*12];
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVTHUMBNAILER__
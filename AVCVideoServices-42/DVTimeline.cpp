@@ -0,0 +1,650 @@
+/*
+	File:		DVTimeline.cpp
+ 
+ Synopsis: Plays a queue of DV file clips through a DVTransmitter, switching between them on exact frames.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+#include "AVCVideoServices.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace AVS
+{
+
+//////////////////////////////////////////////////////
+// Constructor
+//////////////////////////////////////////////////////
+DVTimeline::DVTimeline(StringLogger *stringLogger)
+{
+	if (stringLogger == nil)
+	{
+		logger = new StringLogger(nil);	// Throws away all log strings
+		noLogger = true;
+	}
+	else
+	{
+		logger = stringLogger;
+		noLogger = false;
+	}
+	
+	messageProc = nil;
+	pMessageProcRefCon = nil;
+	
+	dvMode = 0xFF;
+	frameSize = 0;
+	
+	pClipsHead = nil;
+	pClipsTail = nil;
+	pRetiredClips = nil;
+	nextClipID = 1;
+	
+	pReadClip = nil;
+	readClipFrame = 0;
+	
+	pFramePositions = nil;
+	numFramePositions = 0;
+	finishedThroughClipID = 0;
+	
+	bzero(&stats, sizeof(DVTimelineStats));
+	
+	frameReader.registerReaderCallbacks(ReaderNextRead, ReaderReadDone, ReaderRewind, ReaderIdle, this);
+}
+
+//////////////////////////////////////////////////////
+// Destructor
+//////////////////////////////////////////////////////
+DVTimeline::~DVTimeline()
+{
+	DVTimelineClip *pClip;
+	
+	// The transmitter must be stopped before the timeline is deleted
+	frameReader.stopReaderThread();
+	
+	while (pClipsHead != nil)
+		retireFirstClip();
+	while (pRetiredClips != nil)
+	{
+		pClip = pRetiredClips;
+		pRetiredClips = pClip->pNext;
+		close(pClip->fileDescriptor);
+		delete pClip;
+	}
+	
+	if (pFramePositions)
+		delete [] pFramePositions;
+	
+	// If we created an internal logger, free it
+	if (noLogger == true)
+		delete logger;
+}
+
+//////////////////////////////////////////////////////
+// registerMessageCallback
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::registerMessageCallback(DVTimelineMessageProc handler, void *pRefCon)
+{
+	messageProc = handler;
+	pMessageProcRefCon = pRefCon;
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// addClip
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::addClip(const char *pFileName, UInt32 inFrame, UInt32 outFrame, UInt32 *pClipID)
+{
+	// The clip length is checked against the file in queueClip
+	if ((outFrame != kDVTimelineLastFrame) && (outFrame < inFrame))
+		return kIOReturnBadArgument;
+	
+	return queueClip(pFileName, inFrame,
+					 (outFrame == kDVTimelineLastFrame) ? 0 : ((outFrame - inFrame) + 1),
+					 false, pClipID);
+}
+
+//////////////////////////////////////////////////////
+// addHold
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::addHold(const char *pFileName, UInt32 frame, UInt32 numFrames, UInt32 *pClipID)
+{
+	if (numFrames == 0)
+		return kIOReturnBadArgument;
+	
+	return queueClip(pFileName, frame, numFrames, true, pClipID);
+}
+
+//////////////////////////////////////////////////////
+// startReader
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::startReader(void)
+{
+	// The reader thread waits until it has frames to fill
+	if ((frameReader.isReaderThreadRunning() == false) && (frameReader.startReaderThread() != kIOReturnSuccess))
+	{
+		logger->log("\nDVTimeline Error: Unable to create reader thread\n\n");
+		return kIOReturnError;
+	}
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// queueClip
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::queueClip(const char *pFileName, UInt32 inFrame, UInt32 numFrames, bool holdFrame, UInt32 *pClipID)
+{
+	struct stat fileInfo;
+	UInt8 frameHeader[480];
+	UInt8 fileDVMode;
+	UInt32 fileFrameSize;
+	UInt32 sourcePacketSize;
+	UInt32 numFileFrames;
+	DVTimelineClip *pClip;
+	DVTransmitter *pTransmitter;
+	int fileDescriptor;
+	
+	if (!pFileName)
+		return kIOReturnBadArgument;
+	
+	// Start the reader thread with the first clip
+	if (startReader() != kIOReturnSuccess)
+		return kIOReturnError;
+	
+	fileDescriptor = open(pFileName, O_RDONLY);
+	if (fileDescriptor == -1)
+	{
+		logger->log("\nDVTimeline Error: Unable to open file: %s\n\n",pFileName);
+		return kIOReturnNotFound;
+	}
+	
+	// Determine the DV mode from the start of the first frame
+	if ((fstat(fileDescriptor, &fileInfo) != 0) ||
+		(pread(fileDescriptor, frameHeader, sizeof(frameHeader), 0) != (ssize_t) sizeof(frameHeader)) ||
+		(GetDVModeFromFrameData(frameHeader, &fileDVMode, &fileFrameSize, &sourcePacketSize) != kIOReturnSuccess))
+	{
+		logger->log("\nDVTimeline Error: Unable to determine DV mode of file: %s\n\n",pFileName);
+		close(fileDescriptor);
+		return kIOReturnUnsupported;
+	}
+	
+	// Make sure the clip is within the file
+	numFileFrames = (UInt32) (fileInfo.st_size / fileFrameSize);
+	if ((holdFrame == false) && (numFrames == 0) && (inFrame < numFileFrames))
+		numFrames = numFileFrames - inFrame;
+	if ((inFrame >= numFileFrames) || ((holdFrame == false) && ((numFileFrames - inFrame) < numFrames)))
+	{
+		logger->log("\nDVTimeline Error: Clip is outside of file: %s\n\n",pFileName);
+		close(fileDescriptor);
+		return kIOReturnBadArgument;
+	}
+	
+#ifdef F_RDAHEAD
+	// Our reads are sequential within a clip, so let the file system read ahead of us
+	fcntl(fileDescriptor, F_RDAHEAD, 1);
+#endif
+	
+	frameReader.lock();
+	
+	// Every clip must have the timeline's DV mode, or the switch wouldn't be seamless
+	pTransmitter = frameReader.getTransmitter();
+	if (((dvMode != 0xFF) && (fileDVMode != dvMode)) ||
+		((pTransmitter != nil) && (pTransmitter->getFrame(0)->frameLen != fileFrameSize)))
+	{
+		frameReader.unlock();
+		logger->log("\nDVTimeline Error: DV mode of file doesn't match the timeline: %s\n\n",pFileName);
+		close(fileDescriptor);
+		return kIOReturnBadArgument;
+	}
+	dvMode = fileDVMode;
+	frameSize = fileFrameSize;
+	
+	pClip = new DVTimelineClip;
+	if (!pClip)
+	{
+		frameReader.unlock();
+		close(fileDescriptor);
+		return kIOReturnNoMemory;
+	}
+	pClip->pNext = nil;
+	pClip->clipID = nextClipID++;
+	pClip->fileDescriptor = fileDescriptor;
+	pClip->inFrame = inFrame;
+	pClip->numFrames = numFrames;
+	pClip->holdFrame = holdFrame;
+	pClip->prefetched = false;
+	
+	if (pClipsTail != nil)
+		pClipsTail->pNext = pClip;
+	else
+		pClipsHead = pClip;
+	pClipsTail = pClip;
+	
+	// If the reader has read every other clip, this is the one it reads next
+	if (pReadClip == nil)
+	{
+		pReadClip = pClip;
+		readClipFrame = 0;
+	}
+	frameReader.dataAdded();
+	
+	if (pClipID)
+		*pClipID = pClip->clipID;
+	
+	frameReader.unlock();
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// removeClip
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::removeClip(UInt32 clipID)
+{
+	DVTimelineClip *pClip;
+	DVTimelineClip *pPrevClip = nil;
+	bool notStarted = false;
+	
+	frameReader.lock();
+	
+	for (pClip = pClipsHead; pClip != nil; pClip = pClip->pNext)
+	{
+		// Clips from pReadClip on haven't been read, except for the start of pReadClip itself
+		if ((pClip == pReadClip) && (readClipFrame == 0))
+			notStarted = true;
+		else if (pClip == pReadClip)
+			notStarted = false;
+		
+		if (pClip->clipID == clipID)
+			break;
+		
+		if (pClip == pReadClip)
+			notStarted = true;
+		pPrevClip = pClip;
+	}
+	
+	if (pClip == nil)
+	{
+		frameReader.unlock();
+		return kIOReturnNotFound;
+	}
+	
+	if (notStarted == false)
+	{
+		frameReader.unlock();
+		return kIOReturnBusy;
+	}
+	
+	// If the reader is about to read (or is reading) the first frame of this
+	// clip, move it on to the next one, and have it drop any read in progress
+	if (pClip == pReadClip)
+	{
+		pReadClip = pClip->pNext;
+		readClipFrame = 0;
+		frameReader.cancelRead();
+	}
+	
+	if (pPrevClip != nil)
+		pPrevClip->pNext = pClip->pNext;
+	else
+		pClipsHead = pClip->pNext;
+	if (pClipsTail == pClip)
+		pClipsTail = pPrevClip;
+	
+	// Let the reader thread close the file
+	pClip->pNext = pRetiredClips;
+	pRetiredClips = pClip;
+	
+	frameReader.unlock();
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// getDVMode
+//////////////////////////////////////////////////////
+UInt8 DVTimeline::getDVMode(void)
+{
+	return dvMode;
+}
+
+//////////////////////////////////////////////////////
+// prepareFrameQueue
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::prepareFrameQueue(DVTransmitter *pTransmitter)
+{
+	DVTransmitFrame *pFrame;
+	
+	if (!pTransmitter)
+		return kIOReturnBadArgument;
+	
+	// The transmitter's frame buffers must be the size of our frames
+	pFrame = pTransmitter->getFrame(0);
+	if ((!pFrame) || ((frameSize != 0) && (pFrame->frameLen != frameSize)))
+	{
+		logger->log("\nDVTimeline Error: Transmitter frame size doesn't match the timeline's DV mode\n\n");
+		return kIOReturnBadArgument;
+	}
+	
+	// The transmitter may be started before any clips are added
+	if (startReader() != kIOReturnSuccess)
+		return kIOReturnError;
+	
+	return frameReader.prepareFrameQueue(pTransmitter);
+}
+
+//////////////////////////////////////////////////////
+// isPlaybackComplete
+//////////////////////////////////////////////////////
+bool DVTimeline::isPlaybackComplete(void)
+{
+	return frameReader.isPlaybackComplete();
+}
+
+//////////////////////////////////////////////////////
+// getStats
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::getStats(DVTimelineStats *pStats)
+{
+	DVFrameReaderStats readerStats;
+	
+	if (!pStats)
+		return kIOReturnBadArgument;
+	
+	frameReader.getStats(&readerStats);
+	*pStats = stats;
+	pStats->prefetchDepth = readerStats.prefetchDepth;
+	pStats->minPrefetchDepth = readerStats.minPrefetchDepth;
+	pStats->framesRead = readerStats.framesRead;
+	pStats->framesTransmitted = readerStats.framesTransmitted;
+	pStats->underruns = readerStats.underruns;
+	pStats->starvedPulls = readerStats.endPulls;
+	pStats->readErrors = readerStats.readErrors;
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// findClip - the reader's mutex must be held
+//////////////////////////////////////////////////////
+DVTimelineClip *DVTimeline::findClip(UInt32 clipID)
+{
+	DVTimelineClip *pClip;
+	
+	for (pClip = pClipsHead; pClip != nil; pClip = pClip->pNext)
+		if (pClip->clipID == clipID)
+			break;
+	
+	return pClip;
+}
+
+//////////////////////////////////////////////////////
+// retireFirstClip - the reader's mutex must be held
+//////////////////////////////////////////////////////
+void DVTimeline::retireFirstClip(void)
+{
+	DVTimelineClip *pClip = pClipsHead;
+	
+	pClipsHead = pClip->pNext;
+	if (pClipsHead == nil)
+		pClipsTail = nil;
+	if (pReadClip == pClip)
+	{
+		pReadClip = pClipsHead;
+		readClipFrame = 0;
+		frameReader.cancelRead();
+	}
+	
+	// Closing the file is i/o, so it's left for the reader thread
+	pClip->pNext = pRetiredClips;
+	pRetiredClips = pClip;
+}
+
+//////////////////////////////////////////////////////
+// retireFinishedClips - the reader's mutex must be held
+//////////////////////////////////////////////////////
+void DVTimeline::retireFinishedClips(void)
+{
+	UInt32 finishedClipID = finishedThroughClipID;
+	
+	// Clip IDs increase along the timeline
+	while ((pClipsHead != nil) && (pClipsHead->clipID <= finishedClipID))
+		retireFirstClip();
+}
+
+//////////////////////////////////////////////////////
+// FramePull
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::FramePull(UInt32 *pFrameIndex, void *pRefCon)
+{
+	DVTimeline *pTimeline = (DVTimeline*) pRefCon;
+	
+	// Called on the transmitter's DCL callback thread. The reader never blocks here.
+	return pTimeline->frameReader.pullFrame(pFrameIndex);
+}
+
+//////////////////////////////////////////////////////
+// FrameRelease
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::FrameRelease(UInt32 frameIndex, void *pRefCon)
+{
+	DVTimeline *pTimeline = (DVTimeline*) pRefCon;
+	DVTransmitter *pTransmitter = pTimeline->frameReader.getTransmitter();
+	DVTimelineFramePosition position;
+	UInt32 frameSYTTime;
+	IOReturn result;
+	
+	if ((!pTransmitter) || (frameIndex >= pTimeline->numFramePositions))
+		return kIOReturnBadArgument;
+	
+	// Called on the transmitter's DCL callback thread, so no locks here. The frame's
+	// position and SYT time must be read before the reader thread gets the frame back.
+	position = pTimeline->pFramePositions[frameIndex];
+	frameSYTTime = pTransmitter->getFrame(frameIndex)->frameSYTTime;
+	result = pTimeline->frameReader.releaseFrame(frameIndex);
+	if ((result != kIOReturnSuccess) || (position.clipID == 0))
+		return result;
+	
+	pTimeline->stats.currentClipID = position.clipID;
+	pTimeline->stats.currentClipFrame = position.clipFrame;
+	if (position.clipFrame == 0)
+		pTimeline->stats.clipsStarted += 1;
+	if (position.lastFrame == true)
+		pTimeline->stats.clipsFinished += 1;
+	
+	// Every clip before this one has been completely sent (and this one too, after
+	// its last frame). The reader thread retires them, and closes their files.
+	pTimeline->finishedThroughClipID = (position.lastFrame == true) ? position.clipID : (position.clipID - 1);
+	
+	// The frame's SYT time is when the first frame of the clip is presented
+	if (pTimeline->messageProc != nil)
+	{
+		if (position.clipFrame == 0)
+			pTimeline->messageProc(kDVTimelineClipStarted,position.clipID,frameSYTTime,pTimeline->pMessageProcRefCon);
+		if (position.lastFrame == true)
+			pTimeline->messageProc(kDVTimelineClipFinished,position.clipID,0,pTimeline->pMessageProcRefCon);
+	}
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// ReaderNextRead
+//////////////////////////////////////////////////////
+bool DVTimeline::ReaderNextRead(DVFrameReaderRead *pRead, void *pRefCon)
+{
+	DVTimeline *pTimeline = (DVTimeline*) pRefCon;
+	DVTimelineClip *pClip = pTimeline->pReadClip;
+	DVTimelineClip *pPrefetchClip;
+	UInt32 numTransmitterFrames = pTimeline->frameReader.getNumTransmitterFrames();
+	
+	if (pClip == nil)
+		return false;
+	
+	pRead->fileDescriptor = pClip->fileDescriptor;
+	pRead->offset = ((off_t) (pClip->inFrame + ((pClip->holdFrame == true) ? 0 : pTimeline->readClipFrame))) * pTimeline->frameSize;
+	pRead->length = pTimeline->frameSize;
+	pRead->pClientItem = pClip;
+	pRead->clientFrame = pTimeline->readClipFrame;
+	
+	// When the end of this clip is within the prefetch depth, get the
+	// file system started on the next clip, so it's ready at the switch.
+	// Clips are only closed by the reader thread, so the descriptor stays valid.
+	pPrefetchClip = pClip->pNext;
+	if ((pPrefetchClip != nil) && (pPrefetchClip->prefetched == false) &&
+		((pClip->numFrames - pTimeline->readClipFrame) <= numTransmitterFrames))
+	{
+		pRead->adviseFileDescriptor = pPrefetchClip->fileDescriptor;
+		pRead->adviseOffset = ((off_t) pPrefetchClip->inFrame) * pTimeline->frameSize;
+		pRead->adviseLength = pTimeline->frameSize * ((pPrefetchClip->holdFrame == true) ? 1 :
+			((pPrefetchClip->numFrames < numTransmitterFrames) ? pPrefetchClip->numFrames : numTransmitterFrames));
+	}
+	
+	return true;
+}
+
+//////////////////////////////////////////////////////
+// ReaderReadDone
+//////////////////////////////////////////////////////
+bool DVTimeline::ReaderReadDone(DVFrameReaderRead *pRead, UInt32 frameIndex, bool readOK, void *pRefCon)
+{
+	DVTimeline *pTimeline = (DVTimeline*) pRefCon;
+	DVTimelineClip *pClip = (DVTimelineClip*) pRead->pClientItem;
+	DVTimelineFramePosition *pPosition = &pTimeline->pFramePositions[frameIndex];
+	
+	// A failed read still takes up its place in the timeline (the buffer keeps
+	// the last frame it held), so later clips still switch on the right frame.
+	if (readOK == false)
+		pTimeline->logger->log("\nDVTimeline Error: Read of frame %u of clip %u failed\n\n",
+							   (unsigned int) pRead->clientFrame, (unsigned int) pClip->clipID);
+	
+	// Only ask for the next clip to be read ahead once
+	if ((pRead->adviseFileDescriptor != -1) && (pClip->pNext != nil))
+		pClip->pNext->prefetched = true;
+	
+	pPosition->clipID = pClip->clipID;
+	pPosition->clipFrame = pRead->clientFrame;
+	pPosition->lastFrame = ((pRead->clientFrame + 1) == pClip->numFrames);
+	
+	pTimeline->readClipFrame = pRead->clientFrame + 1;
+	if (pTimeline->readClipFrame == pClip->numFrames)
+	{
+		pTimeline->pReadClip = pClip->pNext;
+		pTimeline->readClipFrame = 0;
+	}
+	
+	return true;
+}
+
+//////////////////////////////////////////////////////
+// ReaderRewind
+//////////////////////////////////////////////////////
+IOReturn DVTimeline::ReaderRewind(UInt32 firstUnsentFrame, UInt32 numUnsentFrames, UInt32 numFrames, void *pRefCon)
+{
+	DVTimeline *pTimeline = (DVTimeline*) pRefCon;
+	DVTimelineClip *pClip;
+	
+	// Any frames read for a previous run were never sent, so
+	// start reading again from the first of them
+	if ((firstUnsentFrame != kDVFrameReaderNoFrame) && (firstUnsentFrame < pTimeline->numFramePositions))
+	{
+		pClip = pTimeline->findClip(pTimeline->pFramePositions[firstUnsentFrame].clipID);
+		if (pClip != nil)
+		{
+			pTimeline->pReadClip = pClip;
+			pTimeline->readClipFrame = pTimeline->pFramePositions[firstUnsentFrame].clipFrame;
+		}
+	}
+	
+	// Everything before the read position has been sent. FrameRelease
+	// already counted the clips whose last frame it saw.
+	pTimeline->retireFinishedClips();
+	while ((pTimeline->pClipsHead != nil) && (pTimeline->pClipsHead != pTimeline->pReadClip))
+	{
+		pTimeline->retireFirstClip();
+		pTimeline->stats.clipsFinished += 1;
+	}
+	
+	if (numFrames != pTimeline->numFramePositions)
+	{
+		if (pTimeline->pFramePositions)
+			delete [] pTimeline->pFramePositions;
+		pTimeline->numFramePositions = 0;
+		pTimeline->pFramePositions = new DVTimelineFramePosition[numFrames];
+		if (!pTimeline->pFramePositions)
+			return kIOReturnNoMemory;
+		pTimeline->numFramePositions = numFrames;
+	}
+	bzero(pTimeline->pFramePositions, numFrames*sizeof(DVTimelineFramePosition));
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// ReaderIdle
+//////////////////////////////////////////////////////
+void DVTimeline::ReaderIdle(void *pRefCon)
+{
+	DVTimeline *pTimeline = (DVTimeline*) pRefCon;
+	DVTimelineClip *pClip;
+	DVTimelineClip *pNextClip;
+	
+	pTimeline->retireFinishedClips();
+	if (pTimeline->pRetiredClips == nil)
+		return;
+	
+	// Close the files of clips that have been sent or removed, without holding
+	// the mutex. The reader isn't reading, so none of them are in use.
+	pClip = pTimeline->pRetiredClips;
+	pTimeline->pRetiredClips = nil;
+	pTimeline->frameReader.unlock();
+	while (pClip != nil)
+	{
+		pNextClip = pClip->pNext;
+		close(pClip->fileDescriptor);
+		delete pClip;
+		pClip = pNextClip;
+	}
+	pTimeline->frameReader.lock();
+}
+
+} // namespace AVS
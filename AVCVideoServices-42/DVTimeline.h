@@ -0,0 +1,239 @@
+/*
+	File:		DVTimeline.h
+ 
+ Synopsis: Plays a queue of DV file clips through a DVTransmitter, switching between them on exact frames.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVTIMELINE__
+#define __AVCVIDEOSERVICES_DVTIMELINE__
+
+namespace AVS
+{
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  DVTimeline: Supplies DV frames to a DVTransmitter from a queue of clips, where
+//  each clip is a range of frames from a DV file (or one frame held for a number
+//  of frames). Clips can be added while the transmitter is running.
+//
+//  Like DVFileSource, a DVFrameReader reads frames with pread(), directly into the
+//  DVTransmitter's frame buffers, on its own thread, and the static FramePull and
+//  FrameRelease helpers never take a lock. The reader thread fills the buffers in
+//  timeline order, running straight from the last frame of one clip into the first
+//  frame of the next, so a switch between clips always lands on the exact frame,
+//  and doesn't leave a gap as long as the reader keeps ahead of the transmitter.
+//  Every clip's file is opened when the clip is added, and the reader asks the file
+//  system to start reading the next clip ahead of time, while it is still reading
+//  the last frames of the current one.
+//
+//  All of a timeline's clips must have the same DV mode (set by the first clip).
+//
+//  The client must call prepareFrameQueue() from its DVTransmitter message proc,
+//  when it receives the kDVTransmitterPreparePacketFetcher message.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+// enum for this module's messages
+enum
+{
+	kDVTimelineClipStarted = 0,		// param1: clipID, param2: SYT time of the clip's first frame
+	kDVTimelineClipFinished = 1		// param1: clipID, param2: 0
+};
+
+// Use for a clip's outFrame to play through the last frame of the file
+enum
+{
+	kDVTimelineLastFrame = 0xFFFFFFFF
+};
+
+// Prototype for the timeline message callback. It's called on the transmitter's
+// DCL callback thread, when the clip's frame is released by the transmitter, so it
+// must return quickly.
+typedef void (*DVTimelineMessageProc) (UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon);
+
+// Struct to hold the timeline's stats
+struct DVTimelineStats
+{
+	UInt32 prefetchDepth;		// Frames read and waiting to be transmitted
+	UInt32 minPrefetchDepth;	// The low-water mark of prefetchDepth, since the last prepareFrameQueue
+	UInt32 framesRead;			// Frames read from clip files by the reader thread
+	UInt32 framesTransmitted;	// Frames handed to the transmitter
+	UInt32 underruns;			// Frame pulls with clips queued, but no frame ready (the previous frame was repeated)
+	UInt32 starvedPulls;		// Frame pulls after every queued clip was sent (the last frame was repeated)
+	UInt32 clipsStarted;		// Clips whose first frame has been sent
+	UInt32 clipsFinished;		// Clips whose last frame has been sent
+	UInt32 readErrors;			// Number of failed (or short) reads
+	UInt32 currentClipID;		// The clip of the most recently sent frame (0 if none)
+	UInt32 currentClipFrame;	// The frame within that clip (counting from the clip's in-frame)
+};
+
+// A clip in the timeline, linked through pNext
+struct DVTimelineClip
+{
+	DVTimelineClip *pNext;
+	UInt32 clipID;
+	int fileDescriptor;
+	UInt32 inFrame;			// First file frame
+	UInt32 numFrames;		// Length of the clip, in frames
+	bool holdFrame;			// If true, inFrame is repeated for numFrames frames
+	bool prefetched;		// The reader has asked the file system to read ahead for this clip
+};
+
+// Where each transmitter frame buffer's contents belong in the timeline
+struct DVTimelineFramePosition
+{
+	UInt32 clipID;
+	UInt32 clipFrame;
+	bool lastFrame;			// clipFrame is the clip's last frame
+};
+
+//
+// The DVTimeline Class Declaration
+//
+class DVTimeline
+{
+	
+public:
+	// Constructor
+	DVTimeline(StringLogger *stringLogger = nil);
+	
+	// Destructor
+	~DVTimeline();
+	
+	// Register the clip start/finish message callback
+	IOReturn registerMessageCallback(DVTimelineMessageProc handler, void *pRefCon);
+	
+	// Add frames inFrame thru outFrame (inclusive) of a DV file to the end of the timeline
+	IOReturn addClip(const char *pFileName, UInt32 inFrame, UInt32 outFrame = kDVTimelineLastFrame, UInt32 *pClipID = nil);
+	
+	// Add one frame of a DV file, repeated for numFrames frames, to the end of the timeline
+	IOReturn addHold(const char *pFileName, UInt32 frame, UInt32 numFrames, UInt32 *pClipID = nil);
+	
+	// Remove a clip the reader thread hasn't started reading yet
+	IOReturn removeClip(UInt32 clipID);
+	
+	// The DV mode of the timeline's clips (0xFF until the first clip is added)
+	UInt8 getDVMode(void);
+	
+	// Take ownership of all of the transmitter's frames, and wait for the reader
+	// thread to fill them. Call this from the DVTransmitter message proc, for the
+	// kDVTransmitterPreparePacketFetcher message.
+	IOReturn prepareFrameQueue(DVTransmitter *pTransmitter);
+	
+	// True once every clip has been read, and the transmitter has been
+	// given enough time to send out all of its frames
+	bool isPlaybackComplete(void);
+	
+	// Get a snapshot of the timeline's stats
+	IOReturn getStats(DVTimelineStats *pStats);
+	
+	// Helpers that can be registered as DVTransmitter frame callbacks (pRefCon is the DVTimeline)
+	static IOReturn FramePull(UInt32 *pFrameIndex, void *pRefCon);
+	static IOReturn FrameRelease(UInt32 frameIndex, void *pRefCon);
+	
+private:
+	
+	// DVFrameReader callbacks (pRefCon is the DVTimeline), called with the reader's mutex held
+	static bool ReaderNextRead(DVFrameReaderRead *pRead, void *pRefCon);
+	static bool ReaderReadDone(DVFrameReaderRead *pRead, UInt32 frameIndex, bool readOK, void *pRefCon);
+	static IOReturn ReaderRewind(UInt32 firstUnsentFrame, UInt32 numUnsentFrames, UInt32 numFrames, void *pRefCon);
+	static void ReaderIdle(void *pRefCon);
+	
+	// Start the reader thread, if it isn't running yet
+	IOReturn startReader(void);
+	
+	// Open a clip's file, check its DV mode and frame range, and queue the clip
+	IOReturn queueClip(const char *pFileName, UInt32 inFrame, UInt32 numFrames, bool holdFrame, UInt32 *pClipID);
+	
+	// Find a clip in the timeline - the reader's mutex must be held
+	DVTimelineClip *findClip(UInt32 clipID);
+	
+	// Move the timeline's first clip to the list of clips for the reader
+	// thread to close - the reader's mutex must be held
+	void retireFirstClip(void);
+	
+	// Retire the clips FrameRelease has seen the end of - the reader's mutex must be held
+	void retireFinishedClips(void);
+	
+	StringLogger *logger;
+	bool noLogger;
+	
+	DVTimelineMessageProc messageProc;
+	void *pMessageProcRefCon;
+	
+	UInt8 dvMode;
+	UInt32 frameSize;
+	
+	// The clips not yet completely sent, in timeline order, and the
+	// clips that have been, waiting for the reader thread to close them.
+	DVTimelineClip *pClipsHead;
+	DVTimelineClip *pClipsTail;
+	DVTimelineClip *pRetiredClips;
+	UInt32 nextClipID;
+	
+	// The next frame the reader thread will read. pReadClip is nil once
+	// the reader has read every clip.
+	DVTimelineClip *pReadClip;
+	UInt32 readClipFrame;
+	
+	// The reader thread, and the frame queues. The clip lists and the
+	// read position are guarded by the reader's mutex.
+	DVFrameReader frameReader;
+	
+	// Where each transmitter frame's contents belong. Written by the reader
+	// thread before it queues the frame, and read by FrameRelease.
+	DVTimelineFramePosition *pFramePositions;
+	UInt32 numFramePositions;
+	
+	// Every clip up to this one has been completely sent. Written by FrameRelease,
+	// and read by the reader thread, which retires the clips.
+	volatile UInt32 finishedThroughClipID;
+	
+	// clipsStarted, clipsFinished, and the current clip are written by
+	// FrameRelease (and by prepareFrameQueue, while the transmitter is stopped)
+	DVTimelineStats stats;
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVTIMELINE__
@@ -0,0 +1,232 @@
+/*
+	File:		DVTransmitCadence.cpp
+ 
+ Synopsis: Computes the per-cycle DV transmit cadence, independent of any FireWire hardware.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+namespace AVS
+{
+
+//////////////////////////////////////////////////////
+// Constructor
+//////////////////////////////////////////////////////
+DVTransmitCadence::DVTransmitCadence()
+{
+	dvMode = 0xFF;
+	frameSize = 0;
+	cycleFrameBytes = 0;
+	blocksPerCycle = 0;
+	scaledClocksPerSourcePacket = kDVScaledClocksPerNTSCSourcePacket;
+	reset(0);
+}
+
+//////////////////////////////////////////////////////
+// Destructor
+//////////////////////////////////////////////////////
+DVTransmitCadence::~DVTransmitCadence()
+{
+}
+
+//////////////////////////////////////////////////////
+// setDVMode
+//////////////////////////////////////////////////////
+IOReturn DVTransmitCadence::setDVMode(UInt8 mode)
+{
+	UInt32 i = 0;
+	
+	// Find the dvFormats entry for this mode, disregarding the speed bits
+	while (dvFormats[i].frameSize != 0)
+	{
+		if ((mode & 0xFC) == dvFormats[i].mode)
+			break;
+		i += 1;
+	}
+	if (dvFormats[i].frameSize == 0)
+		return kIOReturnBadArgument;
+	
+	dvMode = mode;
+	frameSize = dvFormats[i].frameSize;
+	blocksPerCycle = ((1 << dvFormats[i].fn) * (1 << DVspeed(dvMode)));
+	cycleFrameBytes = dvFormats[i].dbs * 4 * blocksPerCycle;
+	scaledClocksPerSourcePacket = (DVstandard(dvMode) == kDVStandardNTSC) ?
+		kDVScaledClocksPerNTSCSourcePacket : kDVScaledClocksPerPALSourcePacket;
+	
+	reset(dvFormats[i].startingSYTOffset);
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// reset
+//////////////////////////////////////////////////////
+void DVTransmitCadence::reset(UInt32 sytOffsetCycles)
+{
+	// Note that currentIsochTime must not be initialized to a value
+	// less that zero, because the first transmit packet generated
+	// will be a CIP only! A value of 0 or greater for currentIsochTime
+	// will prevent the flow-control logic from adding source packets
+	// into the first isoch cycle.
+	sytOffset = sytOffsetCycles;
+	currentIsochTime = 0;
+	currentDVTime = FWClocksToScaledClocks(sytOffset*kFWClocksPerCycle, kDVScaledClockScale);
+	dbc = 0;
+	frameOffset = 0;
+}
+
+//////////////////////////////////////////////////////
+// nextCycle
+//////////////////////////////////////////////////////
+void DVTransmitCadence::nextCycle(DVTransmitCadenceCycle *pCycle, bool haveFrame)
+{
+	pCycle->dataCycle = false;
+	pCycle->dbc = dbc;
+	pCycle->frameOffset = frameOffset;
+	pCycle->frameBytes = 0;
+	pCycle->frameStart = false;
+	pCycle->frameEnd = false;
+	pCycle->nextFrameBytes = 0;
+	pCycle->frameSYTTime = 0;
+	
+	if (currentIsochTime < 0)
+	{
+		if (haveFrame == false)
+		{
+			// Nothing to send yet. Send a CIP-only packet, and leave the
+			// isoch time alone, so we try to send data again next cycle.
+			currentDVTime += FWClocksToScaledClocks(kFWClocksPerCycle, kDVScaledClockScale);
+			if (currentDVTime >= FWClocksToScaledClocks(kFWClocksPerTimeStampWrap, kDVScaledClockScale))
+				currentDVTime -= FWClocksToScaledClocks(kFWClocksPerTimeStampWrap, kDVScaledClockScale);
+			return;
+		}
+		
+		pCycle->dataCycle = true;
+		
+		// See if all this cycles bytes come from one frame, or
+		// two frames (in the case of 2x or 4x frame rates)
+		if ((frameOffset + cycleFrameBytes) <= frameSize)
+		{
+			if (frameOffset == 0)
+			{
+				pCycle->frameStart = true;
+				pCycle->frameSYTTime = calculateSYTTime();
+			}
+			pCycle->frameBytes = cycleFrameBytes;
+			frameOffset += cycleFrameBytes;
+			if (frameOffset == frameSize)
+			{
+				pCycle->frameEnd = true;
+				frameOffset = 0;
+			}
+		}
+		else
+		{
+			// The frame ends part way through this packet, and the next one starts
+			// right after it. There's no SYT in the CIP for this packet, since the
+			// new frame doesn't start at the beginning of it. That's the spec! Note
+			// that the SYT time is actually the SYT time for the first byte of this
+			// cycle's packet, so it's somewhat early for the new frame.
+			pCycle->frameBytes = frameSize - frameOffset;
+			pCycle->frameEnd = true;
+			pCycle->nextFrameBytes = cycleFrameBytes - pCycle->frameBytes;
+			pCycle->frameSYTTime = calculateSYTTime();
+			frameOffset = pCycle->nextFrameBytes;
+		}
+		
+		// Bump currentIsochTime and currentDVTime
+		currentDVTime += scaledClocksPerSourcePacket;
+		currentIsochTime += scaledClocksPerSourcePacket;
+		if (currentDVTime >= FWClocksToScaledClocks(kFWClocksPerTimeStampWrap, kDVScaledClockScale))
+			currentDVTime -= FWClocksToScaledClocks(kFWClocksPerTimeStampWrap, kDVScaledClockScale);
+		
+		// Bump dbc
+		dbc += blocksPerCycle;
+	}
+	
+    // Adjust currentIsoch time for next cycle
+    currentIsochTime -= FWClocksToScaledClocks(kFWClocksPerCycle, kDVScaledClockScale);
+}
+
+//////////////////////////////////////////////////////
+// recoverLostCycles
+//////////////////////////////////////////////////////
+void DVTransmitCadence::recoverLostCycles(UInt32 lostCycles)
+{
+	// By reducing currentIsochTime, we will
+	// transmit DIF data in places where there would
+	// have been CIP-only packets
+	currentIsochTime -= (FWClocksToScaledClocks(kFWClocksPerCycle, kDVScaledClockScale) * lostCycles);
+}
+
+//////////////////////////////////////////////////////
+// setDVTimeCycle
+//////////////////////////////////////////////////////
+void DVTransmitCadence::setDVTimeCycle(UInt32 cycle)
+{
+	currentDVTime = FWClocksToScaledClocks((cycle % kFWCyclesPerTimeStampWrap)*kFWClocksPerCycle, kDVScaledClockScale);
+}
+
+//////////////////////////////////////////////////////
+// frameTransmitStartCycleTime
+//////////////////////////////////////////////////////
+UInt32 DVTransmitCadence::frameTransmitStartCycleTime(UInt32 frameSYTTime)
+{
+	UInt32 actualFrameStartCycle;
+	
+	// Actual cycle time for transmit is sytTime, less the sytOffset, less 1
+	actualFrameStartCycle = FWTimeElapsed((sytOffset - 1), FWTimeStampToCycles(frameSYTTime), kFWCyclesPerTimeStampWrap);
+	
+	return ((frameSYTTime & 0x00000FFF) | FWCyclesToTimeStamp(actualFrameStartCycle));
+}
+
+//////////////////////////////////////////////////////
+// calculateSYTTime
+//////////////////////////////////////////////////////
+UInt32 DVTransmitCadence::calculateSYTTime(void)
+{
+	// The DV time is always less than 8 seconds, so this is a time stamp
+	return FWCycleTime(FWScaledClocksToClocks(currentDVTime, kDVScaledClockScale)).getTimeStamp();
+}
+
+} // namespace AVS
@@ -0,0 +1,143 @@
+/*
+	File:		DVTransmitCadence.h
+ 
+ Synopsis: Computes the per-cycle DV transmit cadence, independent of any FireWire hardware.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_DVTRANSMITCADENCE__
+#define __AVCVIDEOSERVICES_DVTRANSMITCADENCE__
+
+namespace AVS
+{
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  DVTransmitCadence: Decides, one isoch cycle at a time, what a DV transmitter sends.
+//
+//  DV source packets don't line up with the 8000Hz isoch cycle, so a transmitter
+//  sends DV data in most cycles, and a CIP-only packet in the rest. This class keeps
+//  track of the isoch and DV clocks, and for each cycle produces a record saying
+//  whether to send data, the CIP data block count, which bytes of the current frame
+//  go in the packet, where frames start and end, and the SYT of each new frame.
+//
+//  It has no knowledge of DCL programs or frame buffers, so it can be run against
+//  a simulated cycle clock, with every mode in the dvFormats table. The clocks are
+//  kept in 1/625ths of a FireWire clock, which makes the NTSC and PAL source packet
+//  periods whole numbers, so the cadence is exact over any length of time.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+// The record for one isoch cycle
+struct DVTransmitCadenceCycle
+{
+	bool dataCycle;			// True if this cycle carries DV data, false for a CIP-only cycle
+	UInt8 dbc;				// The data block count for this cycle's CIP header
+	UInt32 frameOffset;		// Offset into the current frame of this cycle's DV data
+	UInt32 frameBytes;		// Number of bytes of the current frame in this cycle
+	bool frameStart;		// True if the current frame starts in this cycle (frameSYTTime goes in the CIP SYT field)
+	bool frameEnd;			// True if the current frame ends in this cycle
+	UInt32 nextFrameBytes;	// If the current frame ends mid-packet, the number of bytes of the next frame that follow it
+	UInt32 frameSYTTime;	// Cycle-timer format presentation time of the frame starting in this cycle, if any
+};
+
+//
+// The DVTransmitCadence Class Declaration
+//
+class DVTransmitCadence
+{
+	
+public:
+	// Constructor
+	DVTransmitCadence();
+	
+	// Destructor
+	~DVTransmitCadence();
+	
+	// Set up for a DV mode (any entry in the dvFormats table, with any speed code)
+	IOReturn setDVMode(UInt8 mode);
+	
+	// Start over with the isoch and DV clocks in step. The first frame's
+	// SYT will be sytOffsetCycles after the first cycle.
+	void reset(UInt32 sytOffsetCycles);
+	
+	// Returns true if the next cycle is due to carry DV data
+	bool isDataCycle(void) {return (currentIsochTime < 0);};
+	
+	// Get the record for the next cycle, and advance the clocks. If haveFrame is false, no
+	// frame is available yet, so the cycle is CIP-only, and the data is sent in a later cycle.
+	void nextCycle(DVTransmitCadenceCycle *pCycle, bool haveFrame = true);
+	
+	// Send data in the next lostCycles CIP-only cycles, to make up for cycles that were lost
+	void recoverLostCycles(UInt32 lostCycles);
+	
+	// Move the DV clock (and so future SYT times) to the start of the specified cycle
+	void setDVTimeCycle(UInt32 cycle);
+	
+	// Convert a frame's SYT time to the cycle time its first packet is transmitted in
+	UInt32 frameTransmitStartCycleTime(UInt32 frameSYTTime);
+	
+	// Accessors
+	UInt32 getCycleFrameBytes(void) {return cycleFrameBytes;};
+	UInt32 getFrameSize(void) {return frameSize;};
+	
+private:
+	
+	// Convert the current DV time to a FireWire cycle-timer format SYT time
+	UInt32 calculateSYTTime(void);
+	
+	UInt8 dvMode;
+	UInt32 frameSize;
+	UInt32 cycleFrameBytes;
+	UInt8 blocksPerCycle;
+	SInt64 scaledClocksPerSourcePacket;
+	UInt32 sytOffset;
+	
+    SInt64 currentIsochTime;
+	SInt64 currentDVTime;
+	UInt8 dbc;
+	UInt32 frameOffset;
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_DVTRANSMITCADENCE__
@@ -55,20 +55,12 @@ IOReturn MyAVCDeviceMessageNotification(AVCDevice *pAVCDevice,
 										void * messageArgument,
 										void *pRefCon);
 void PrintLogMessage(char *pString);
-IOReturn FramePullProc (UInt32 *pFrameIndex, void *pRefCon);
-IOReturn FrameReleaseProc (UInt32 frameIndex, void *pRefCon);
 void MessageReceivedProc(UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon);
-void initialzeFrameQueue(void);
 
 // Globals
 StringLogger logger(PrintLogMessage);
 AVCDeviceController *pAVCDeviceController;
-UInt32 *pFrameQueue;
-UInt32 numFrames;
-FILE *inFile;
-DVTransmitFrame* pFrameQueueHead;
-bool transmitDone = false;
-UInt32 frameTransmittedCount = 0;
+DVFileSource *pDVFileSource;
 bool loopFileMode = false;
 AVCDeviceStream* pAVCDeviceStream = nil;
 AVCDevice *pTargetAVCDevice = nil;
@@ -81,6 +73,7 @@ AVCDevice *pTargetAVCDevice = nil;
 int main(int argc, char* argv[])
 {
 	IOReturn result = kIOReturnSuccess ;
+	DVFileSourceStats stats;
 
 	// Parse the command line
 	if (argc != 2)
@@ -89,9 +82,10 @@ int main(int argc, char* argv[])
 		return -1;
 	}
 		
-	// Open the input file
-	inFile = fopen(argv[1],"rb");
-	if (inFile == nil)
+	// Open the input file. The DVFileSource reads it on its own thread, so the
+	// transmitter's callbacks never wait on the disk.
+	pDVFileSource = new DVFileSource(&logger);
+	if (pDVFileSource->openFile(argv[1],loopFileMode) != kIOReturnSuccess)
 	{
 		printf("Unable to open input file: %s\n",argv[1]);
 		return -1;
@@ -111,8 +105,10 @@ int main(int argc, char* argv[])
 		usleep(1000000); // 1 second
 		if (pAVCDeviceStream != nil)
 		{
-			printf("DV frames transmitted: %d\n",(int)frameTransmittedCount);
-			if (transmitDone == true)
+			pDVFileSource->getStats(&stats);
+			printf("DV frames transmitted: %d  prefetched: %d (min %d)  underruns: %d\n",
+				   (int)stats.framesTransmitted,(int)stats.prefetchDepth,(int)stats.minPrefetchDepth,(int)stats.underruns);
+			if (pDVFileSource->isPlaybackComplete() == true)
 				break;
 		}
 	}
@@ -132,6 +128,9 @@ int main(int argc, char* argv[])
 		pAVCDeviceStream = nil;
 	}
 	
+	pDVFileSource->closeFile();
+	delete pDVFileSource;
+	
 	return result;
 }
 
@@ -177,16 +176,16 @@ IOReturn MyAVCDeviceControllerNotification(AVCDeviceController *pAVCDeviceContro
 
 				// Create a DV Transmit stream for this device
 				pAVCDeviceStream = pAVCDevice->CreateDVTransmitterForDevicePlug(0,
-																	FramePullProc,
-																	nil,
-																	FrameReleaseProc,
-																	nil,
+																	DVFileSource::FramePull,
+																	pDVFileSource,
+																	DVFileSource::FrameRelease,
+																	pDVFileSource,
 																	MessageReceivedProc,
 																	nil,
 																	&logger,
 																	kCyclesPerDVTransmitSegment,
 																	kNumDVTransmitSegments,
-																	0x00,
+																	pDVFileSource->getDVMode(),
 																	8);
 				if (pAVCDeviceStream == nil)
 				{
@@ -199,7 +198,6 @@ IOReturn MyAVCDeviceControllerNotification(AVCDeviceController *pAVCDeviceContro
 				else
 				{
 					printf("  Starting DV Transmit to device\n");
-					numFrames = pAVCDeviceStream->pDVTransmitter->getNumFrames();
 					result = pAVCDevice->StartAVCDeviceStream(pAVCDeviceStream);
 				}
 			}
@@ -332,23 +330,6 @@ IOReturn MyAVCDeviceMessageNotification(AVCDevice *pAVCDevice,
 	return kIOReturnSuccess ;
 }
 
-//////////////////////////////////////////////////////
-// initialzeFrameQueue
-//////////////////////////////////////////////////////
-void initialzeFrameQueue(void)
-{
-	UInt32 i;
-	DVTransmitFrame* pFrame;
-	
-	pFrameQueueHead = nil;
-	for (i=0;i<numFrames;i++)
-	{
-		pFrame = pAVCDeviceStream->pDVTransmitter->getFrame(i);
-		pFrame->pNext = pFrameQueueHead;
-		pFrameQueueHead = pFrame;
-	}
-}
-
 //////////////////////////////////////////////////////
 // PrintLogMessage
 //////////////////////////////////////////////////////
@@ -371,7 +352,7 @@ void MessageReceivedProc(UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon
 			break;
 			
 		case kDVTransmitterPreparePacketFetcher:
-			initialzeFrameQueue();
+			pDVFileSource->prepareFrameQueue(pAVCDeviceStream->pDVTransmitter);
 			break;
 			
 		default:
@@ -381,91 +362,3 @@ void MessageReceivedProc(UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon
 	
 	return;
 }
-
-//////////////////////////////////////////////////////
-// FramePullProc
-//////////////////////////////////////////////////////
-IOReturn FramePullProc (UInt32 *pFrameIndex, void *pRefCon)
-{
-	static bool flushMode = false;
-	static unsigned int flushCnt = 0;
-	unsigned int cnt;
-	IOReturn result = 0;
-	DVTransmitFrame* pFrame;
-	
-	if (flushMode == false)
-	{
-		if (pFrameQueueHead != nil)
-		{
-			pFrame = pFrameQueueHead;
-			pFrameQueueHead = pFrame->pNext;
-			
-			// Read the next TS packet from the input file
-			cnt = fread(pFrame->pFrameData,1,pFrame->frameLen,inFile);
-			if (cnt != pFrame->frameLen)
-			{
-				if (loopFileMode == false)
-				{
-					flushMode = true;
-					FrameReleaseProc(pFrame->frameIndex,pRefCon);
-					result = -1;	// Causes The previous frame to be used
-				}
-				else
-				{
-					// Rewind file
-					rewind(inFile);
-					
-					// Read again
-					cnt = fread(pFrame->pFrameData,1,pFrame->frameLen,inFile);
-					if (cnt != pFrame->frameLen)
-					{
-						flushMode = true;
-						FrameReleaseProc(pFrame->frameIndex,pRefCon);
-						result = -1;	// Causes The previous frame to be used
-					}
-					else
-					{
-						*pFrameIndex = pFrame->frameIndex;
-						frameTransmittedCount += 1;
-					}
-				}
-			}
-			else
-			{
-				*pFrameIndex = pFrame->frameIndex;
-				frameTransmittedCount += 1;
-			}
-		}
-		else
-		{
-			printf("DVTransmitTest: Repeating previous frame because no frames on framequeue!\n");
-			result = -1;	// Causes The previous frame to be used
-		}
-	}
-	else
-	{
-		// This code runs the transmitter for enough additional cycles to
-		// flush all the DV data from the DCL buffers. A pretty sloppy way
-		// of doing it, though.
-		if (flushCnt > (numFrames-2))
-			transmitDone = true;
-		else
-			flushCnt += 1;
-		result = -1;	// Causes a the previous frame to be used
-	}
-	
-	return result;
-}
-
-//////////////////////////////////////////////////////
-// FrameReleaseProc
-//////////////////////////////////////////////////////
-IOReturn FrameReleaseProc (UInt32 frameIndex, void *pRefCon)
-{
-	DVTransmitFrame* pFrame;
-	pFrame = pAVCDeviceStream->pDVTransmitter->getFrame(frameIndex);
-	pFrame->pNext = pFrameQueueHead;
-	pFrameQueueHead = pFrame;
-	return kIOReturnSuccess;
-}
-
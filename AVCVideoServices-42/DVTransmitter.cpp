@@ -107,9 +107,9 @@ DVTransmitter::DVTransmitter(StringLogger *stringLogger,
 	xmitSpeed = kFWSpeed100MBit;
 	runLoopRef = nil;
 	dvMode = transmitterDVMode;
-	dbc = 0;
 	numFrames = numFrameBuffers;
 	ppCallbackCycles = nil;
+	pFrameBufferPool = GetDVFrameBufferPool();
 	
 	if (stringLogger == nil)
 	{
@@ -209,8 +209,8 @@ DVTransmitter::~DVTransmitter()
 			if (framePtrs[i])
 			{
 				// Free the frame buffer memory.
-				if (framePtrs[i]->pFrameData != nil)
-					delete [] framePtrs[i]->pFrameData;
+				if (framePtrs[i]->pInternalFrameData != nil)
+					FreeDVFrameBuffer(pFrameBufferPool,framePtrs[i]->pInternalFrameData);
 				
 				delete framePtrs[i];
 			}
@@ -260,6 +260,7 @@ IOReturn DVTransmitter::setupIsocTransmitter(void)
 
 	// Set the SYT offset for this DV mode
 	sourcePacketCycleCountStartValue = pDVFormat->startingSYTOffset;
+	cadence.setDVMode(dvMode);
 	
 	// This is the calculation of the size of an isoch packet payload that contains DV data
 	xmitPayloadSize = kDVXmitCIPOnlySize + ((pDVFormat->dbs*4) * (1 << pDVFormat->fn) * (1 << DVspeed(dvMode)));
@@ -384,14 +385,16 @@ IOReturn DVTransmitter::setupIsocTransmitter(void)
 		framePtrs[i]->frameSYTTime = 0;
 		framePtrs[i]->frameTransmitStartCycleTime = 0;
 		framePtrs[i]->timeStampSecondsFieldValid = false;
+		framePtrs[i]->pInternalFrameData = nil;
 
 		// Allocate frame buffer
-		framePtrs[i]->pFrameData = (UInt8*) new UInt8[pDVFormat->frameSize];
+		framePtrs[i]->pFrameData = AllocateDVFrameBuffer(pFrameBufferPool,pDVFormat->frameSize);
 		if (framePtrs[i]->pFrameData == nil)
 		{
 			logger->log("\nDVTransmitter Error: Error allocating DV frame buffer\n");
 			return kIOReturnNoMemory ;
 		}
+		framePtrs[i]->pInternalFrameData = framePtrs[i]->pFrameData;
 	}
 
     // Set the isoc tag field correctly for CIP style isoc.
@@ -678,16 +681,9 @@ DVTransmitter::prepareForTransmit(bool notifyClient)
 	do (*nodeNubInterface)->GetBusGeneration(nodeNubInterface, &generation);
 	while  ((*nodeNubInterface)->GetLocalNodeIDWithGeneration(nodeNubInterface,generation,&nodeID) != kIOReturnSuccess);
 
-	// Note that currentIsochTime must not be initialized to a value
-	// less that zero, because the first transmit packet generated
-	// will be a CIP only! A value of 0 or greater for currentIsochTime
-	// will prevent the flow-control logic from adding source packets
-	// into the first isoch cycle.
-	currentIsochTime = 0.0;
-	
-    currentDVTime = (sourcePacketCycleCountStartValue*3072);
+	// Start the transmit cadence over
+	cadence.reset(sourcePacketCycleCountStartValue);
 	currentSegment = 0;
-	dbc = 0;
 	pCurrentFrame = nil;
 	expectedTimeStampCycle = isochCyclesPerSegment - 1;
 	
@@ -705,6 +701,7 @@ DVTransmitter::prepareForTransmit(bool notifyClient)
 			framePtrs[i]->frameSYTTime = 0;
 			framePtrs[i]->frameTransmitStartCycleTime = 0;
 			framePtrs[i]->timeStampSecondsFieldValid = false;
+			framePtrs[i]->pFrameData = framePtrs[i]->pInternalFrameData;
 		}
 	
 		// Prepare the packet fetcher
@@ -786,23 +783,44 @@ DVTransmitter::FillCycleBuffer(DVXmitCycle *pCycle, UInt16 nodeID, bool doUpdate
 {
 	IOReturn result;
 	UInt32 newFrameIndex;
-	UInt32 cycleFrameBytes;
+	DVTransmitCadenceCycle cycleInfo;
 	DVTransmitFrame* pReleaseFrame;
 	UInt32 savedNewFrameReleaseIndex = 0;
 	bool useSavedNewFrameReleaseIndex = false;
 	UInt32* pXmitBufWord = (UInt32*) pCycle->pBuf;
-	UInt32* pFrameBufWord;
-	UInt32 *pCopyStartWord;
-	int actualFrameStartCycle;
-	int actualFrameStartSeconds;
-	
-	UInt32 sytTime;
+
+	// If it's time to send some DV, but we don't have our first frame yet, try and get it
+	if ((cadence.isDataCycle() == true) && (pCurrentFrame == nil))
+	{
+		if (!framePullProc)
+		{
+			// No frame pull proc, so no continuing
+			return;
+		}
+		
+		result = framePullProc(&newFrameIndex,pFramePullProcRefCon);
+		if ((result == kIOReturnSuccess) && (newFrameIndex < numFrames))
+		{
+			pCurrentFrame = getFrame(newFrameIndex);
+
+			// Initialize some new frame parameters
+			pCurrentFrame->inUse = true;
+			pCurrentFrame->curOffset = 0;
+			pCurrentFrame->dclProgramRefCount = 1;
+			pCurrentFrame->frameSYTTime = 0;
+			pCurrentFrame->frameTransmitStartCycleTime = 0;
+			pCurrentFrame->timeStampSecondsFieldValid = false;
+		}
+	}
+
+	// Find out what goes in this cycle
+	cadence.nextCycle(&cycleInfo, (pCurrentFrame != nil));
 
 	// CIP Header 0 - Initialize this in bus-byte order!
 	pXmitBufWord[0] = EndianU32_NtoB(((nodeID & 0x3F) << 24) +
 		(pDVFormat->dbs << 16) +
 		(pDVFormat->fn << 14) +
-		dbc);
+		cycleInfo.dbc);
 
 	// CIP Header 1 - Note: Keep this quadlet in machine native byte order for now!
 	// We'll adjust it to bus-byte order after we decide if the SYT needs to be applied
@@ -812,164 +830,31 @@ DVTransmitter::FillCycleBuffer(DVXmitCycle *pCycle, UInt16 nodeID, bool doUpdate
 		(dvMode << 16) + 
 		0x0000FFFF;
 
-	// See if it's time to send some DV
-    if (currentIsochTime < 0.0)
-    {
+	if (cycleInfo.dataCycle == true)
+	{
 		// Send DV Data
-
-		// If we don't have our first frame yet, try and get it
-		if 	(pCurrentFrame == nil)
+		
+		// See if a frame starts in this cycle,
+		if (cycleInfo.frameStart == true)
 		{
-			if (framePullProc)
-			{
-				result = framePullProc(&newFrameIndex,pFramePullProcRefCon);
-				if ((result == kIOReturnSuccess) && (newFrameIndex < numFrames))
-				{
-					pCurrentFrame = getFrame(newFrameIndex);
-
-					// Initialize some new frame parameters
-					pCurrentFrame->inUse = true;
-					pCurrentFrame->curOffset = 0;
-					pCurrentFrame->dclProgramRefCount = 1;
-					pCurrentFrame->frameSYTTime = 0;
-					pCurrentFrame->frameTransmitStartCycleTime = 0;
-					pCurrentFrame->timeStampSecondsFieldValid = false;
-				}
-				else
-				{
-					pCurrentFrame = nil;
-
-					// Set the mode for this cycle object
-					pCycle->CycleMode = CycleModeCIPOnly;
-
-					// Deal with previous cycle objects jump target
-					(pCycle->pPrev)->UpdateJumpTarget(pCycle->CycleMode, localIsocPort);
-
-					// Bump currentDVTime to the next cycle
-					currentDVTime += 3072.0;
-					if (currentDVTime >= 196608000.0)
-						currentDVTime -= 196608000.0;
-
-					// Adjust CIP1 to bus-byte order
-					pXmitBufWord[1] = EndianU32_NtoB(pXmitBufWord[1]);
-
-					return;
-				}
-			}
-			else
-			{
-				// Adjust CIP1 to bus-byte order
-				pXmitBufWord[1] = EndianU32_NtoB(pXmitBufWord[1]);
-
-				// No frame pull proc, so no continuing
-				return;
-			}
+			// Add the SYT to the CIP Header, and frame struct
+			pXmitBufWord[1] &= 0xFFFF0000;
+			pXmitBufWord[1] += FWCycleTime::fromRegister(cycleInfo.frameSYTTime).getSYT();
+			pCurrentFrame->frameSYTTime = cycleInfo.frameSYTTime;
+			pCurrentFrame->frameTransmitStartCycleTime = cadence.frameTransmitStartCycleTime(cycleInfo.frameSYTTime);
+			pCurrentFrame->timeStampSecondsFieldValid = firstDCLCallbackOccurred;
 		}
 
-		// Calculate the number of DV data bytes that are needed in this cycle
-		cycleFrameBytes = pDVFormat->dbs * (1 << pDVFormat->fn) * (1 << DVspeed(dvMode)) * 4;
-
-		// See if all this cycles bytes come from one frame, or
-		// two frames (in the case of 2x or 4x frame rates)
-		if  ((pCurrentFrame->curOffset+cycleFrameBytes) <= pCurrentFrame->frameLen)
-		{
-			// See if a frame starts in this cycle,
-			if (pCurrentFrame->curOffset == 0)
-			{
-				// Generate SYT and add it to the CIP Header, and frame struct
-				sytTime = calculateSYTTime();
-				pXmitBufWord[1] &= 0xFFFF0000;
-				pXmitBufWord[1] += (sytTime & 0x0000FFFF);
-				pCurrentFrame->frameSYTTime = sytTime; // Set the SYT time into the current frame struct
-
-				// Actual cycle time for transmit is sytTime, less the sourcePacketCycleCountStartValue, less 1
-				actualFrameStartCycle = ((pCurrentFrame->frameSYTTime & 0x01FFF000) >> 12);
-				actualFrameStartSeconds = ((pCurrentFrame->frameSYTTime & 0x0E000000) >> 25);
-
-				actualFrameStartCycle -= (sourcePacketCycleCountStartValue - 1);
-				if (actualFrameStartCycle < 0)
-				{
-					actualFrameStartCycle = 8000 - actualFrameStartCycle;
-					actualFrameStartSeconds -= 1;
-					if (actualFrameStartSeconds < 0)
-						actualFrameStartSeconds = 8 - actualFrameStartSeconds;
-				}
-				pCurrentFrame->frameTransmitStartCycleTime = ((pCurrentFrame->frameSYTTime & 0x00000FFF) | (actualFrameStartCycle << 12) | (actualFrameStartSeconds << 25));
-				pCurrentFrame->timeStampSecondsFieldValid = firstDCLCallbackOccurred;
-			}
-
-			// Copy the frame buffer data to the transmit buffer
-			pFrameBufWord = (UInt32*) &pCurrentFrame->pFrameData[pCurrentFrame->curOffset];
-			pCopyStartWord = &pXmitBufWord[2];
-			memcpy(pCopyStartWord,pFrameBufWord,cycleFrameBytes);
-				
-			// Set the mode for this cycle object
-			pCycle->CycleMode = CycleModeFull;
+		// Copy the frame buffer data to the transmit buffer
+		memcpy(&pXmitBufWord[2],&pCurrentFrame->pFrameData[cycleInfo.frameOffset],cycleInfo.frameBytes);
+		pCurrentFrame->curOffset = cycleInfo.frameOffset + cycleInfo.frameBytes;
 			
-			// Bump the offset in the current frame
-			pCurrentFrame->curOffset += cycleFrameBytes;
-
-			// See if we need to get the next frame
-			if (pCurrentFrame->curOffset == pCurrentFrame->frameLen)
-			{
-				// We have a frame that ends in this cycle. Save that information for future release
-				savedNewFrameReleaseIndex = pCurrentFrame->frameIndex;
-				useSavedNewFrameReleaseIndex = true;
-
-				// Get the next frame
-				result = framePullProc(&newFrameIndex,pFramePullProcRefCon);
-				if ((result == kIOReturnSuccess) && (newFrameIndex < numFrames))
-				{
-					// Got the next frame
-					pCurrentFrame = getFrame(newFrameIndex);
-
-					// Initialize some new frame parameters
-					pCurrentFrame->inUse = true;
-					pCurrentFrame->curOffset = 0;
-					pCurrentFrame->dclProgramRefCount += 1;
-					pCurrentFrame->frameSYTTime = 0;
-					pCurrentFrame->frameTransmitStartCycleTime = 0;
-					pCurrentFrame->timeStampSecondsFieldValid = false;
-				}
-				else
-				{
-					// Didn't get another frame, so we are going to reuse the one we have
-					if ((result == kIOReturnSuccess) && (newFrameIndex >= numFrames))
-						logger->log("\nDVTransmitter Warning: Frame pull proc was given illegal frame index: %d\n",newFrameIndex);
-
-					// Don't release the frame because we need it again
-					useSavedNewFrameReleaseIndex = false;
-
-					// Initialize some frame parameters
-					pCurrentFrame->curOffset = 0;
-					pCurrentFrame->dclProgramRefCount += 1;
-					pCurrentFrame->frameSYTTime = 0;
-					pCurrentFrame->frameTransmitStartCycleTime = 0;
-					pCurrentFrame->timeStampSecondsFieldValid = false;
-
-					// We should mute the audio in this frame for retransmission
-					DVSilenceFrame(dvMode, pCurrentFrame->pFrameData);
-				}
-			}
-		}
-		else
+		// Set the mode for this cycle object
+		pCycle->CycleMode = CycleModeFull;
+		
+		// See if we need to get the next frame
+		if (cycleInfo.frameEnd == true)
 		{
-			// Note: No SYT in CIP for this packet, because the SYT should
-			// only be in the CIP when a new frame starts at the beginning
-			// of this packet, which isn't the case here. That's the spec!
-
-			// Copy the frame buffer data to the transmit buffer
-			pFrameBufWord = (UInt32*) &pCurrentFrame->pFrameData[pCurrentFrame->curOffset];
-			pCopyStartWord = &pXmitBufWord[2];
-			memcpy(pCopyStartWord,pFrameBufWord,(cycleFrameBytes/2));
-			
-			// Set the mode for this cycle object
-			pCycle->CycleMode = CycleModeFull;
-			
-			pCurrentFrame->curOffset += (cycleFrameBytes/2);
-			if (pCurrentFrame->curOffset != pCurrentFrame->frameLen)
-				logger->log("\nDVTransmitter Warning: Frame not complete when expected!\n");
-
 			// We have a frame that ends in this cycle. Save that information for future release
 			savedNewFrameReleaseIndex = pCurrentFrame->frameIndex;
 			useSavedNewFrameReleaseIndex = true;
@@ -980,11 +865,7 @@ DVTransmitter::FillCycleBuffer(DVXmitCycle *pCycle, UInt16 nodeID, bool doUpdate
 			{
 				// Got the next frame
 				pCurrentFrame = getFrame(newFrameIndex);
-
-				// Initialize some new frame parameters
 				pCurrentFrame->inUse = true;
-				pCurrentFrame->curOffset = 0;
-				pCurrentFrame->dclProgramRefCount += 1;
 			}
 			else
 			{
@@ -995,61 +876,30 @@ DVTransmitter::FillCycleBuffer(DVXmitCycle *pCycle, UInt16 nodeID, bool doUpdate
 				// Don't release the frame because we need it again
 				useSavedNewFrameReleaseIndex = false;
 
-				// Initialize some frame parameters
-				pCurrentFrame->curOffset = 0;
-				pCurrentFrame->dclProgramRefCount += 1;
-
 				// We should mute the audio in this frame for retransmission
-				DVSilenceFrame(dvMode, pCurrentFrame->pFrameData);
+				silenceRepeatedFrame(pCurrentFrame);
 			}
 
-			// Set the SYT time into the current frame struct
-			// Not that the SYT time is actually the SYT time for the
-			// first byte of this cycle's packet, so the cycle-offset in this SYT
-			// is somewhat wrong for a frame that starts in the middle of the packet
-			// like this one does.
-			pCurrentFrame->frameSYTTime = calculateSYTTime();
-
-			// Actual cycle time for transmit is sytTime, less the sourcePacketCycleCountStartValue, less 1
-			actualFrameStartCycle = ((pCurrentFrame->frameSYTTime & 0x01FFF000) >> 12);
-			actualFrameStartSeconds = ((pCurrentFrame->frameSYTTime & 0x0E000000) >> 25);
+			// Initialize some new frame parameters
+			pCurrentFrame->curOffset = 0;
+			pCurrentFrame->dclProgramRefCount += 1;
+			pCurrentFrame->frameSYTTime = 0;
+			pCurrentFrame->frameTransmitStartCycleTime = 0;
+			pCurrentFrame->timeStampSecondsFieldValid = false;
 			
-			actualFrameStartCycle -= (sourcePacketCycleCountStartValue - 1);
-			if (actualFrameStartCycle < 0)
+			// See if the new frame starts in the middle of this cycle's packet
+			// (in the case of 4x frame rates). If so, there's no SYT in the CIP.
+			if (cycleInfo.nextFrameBytes > 0)
 			{
-				actualFrameStartCycle = 8000 - actualFrameStartCycle;
-				actualFrameStartSeconds -= 1;
-				if (actualFrameStartSeconds < 0)
-					actualFrameStartSeconds = 8 - actualFrameStartSeconds;
+				pCurrentFrame->frameSYTTime = cycleInfo.frameSYTTime;
+				pCurrentFrame->frameTransmitStartCycleTime = cadence.frameTransmitStartCycleTime(cycleInfo.frameSYTTime);
+				pCurrentFrame->timeStampSecondsFieldValid = firstDCLCallbackOccurred;
+				
+				// Copy the frame buffer data to the transmit buffer
+				memcpy(&pXmitBufWord[2+(cycleInfo.frameBytes/4)],pCurrentFrame->pFrameData,cycleInfo.nextFrameBytes);
+				pCurrentFrame->curOffset = cycleInfo.nextFrameBytes;
 			}
-			pCurrentFrame->frameTransmitStartCycleTime = ((pCurrentFrame->frameSYTTime & 0x00000FFF) | (actualFrameStartCycle << 12) | (actualFrameStartSeconds << 25));
-			pCurrentFrame->timeStampSecondsFieldValid = firstDCLCallbackOccurred;
-			
-			// Copy the frame buffer data to the transmit buffer
-			pFrameBufWord = (UInt32*) &pCurrentFrame->pFrameData[pCurrentFrame->curOffset];
-			pCopyStartWord = &pXmitBufWord[2+(cycleFrameBytes/4)];
-			memcpy(pCopyStartWord,pFrameBufWord,(cycleFrameBytes/2));
-			
-			// Bump current offset for this new frame
-			pCurrentFrame->curOffset += (cycleFrameBytes/2);
-		}
-		
-		// Bump currentIsochTime and currentDVTime
-		if (DVstandard(dvMode) == kDVStandardNTSC)
-		{
-			currentDVTime += kIsochCycleClocksPerNTSCSourcePacket;
-			currentIsochTime += kIsochCycleClocksPerNTSCSourcePacket;
 		}
-		else
-		{
-			currentDVTime += kIsochCycleClocksPerPALSourcePacket;
-			currentIsochTime += kIsochCycleClocksPerPALSourcePacket;
-		}
-		if (currentDVTime >= 196608000.0)
-			currentDVTime -= 196608000.0;
-
-		// Bump dbc
-		dbc += ((1 << pDVFormat->fn) * (1 << DVspeed(dvMode)));
 	}
 	else
 	{
@@ -1066,12 +916,10 @@ DVTransmitter::FillCycleBuffer(DVXmitCycle *pCycle, UInt16 nodeID, bool doUpdate
 		pReleaseFrame = getFrame(savedNewFrameReleaseIndex);
 		pReleaseFrame->inUse = false;
 		pReleaseFrame->curOffset = 0;
+		pReleaseFrame->pFrameData = pReleaseFrame->pInternalFrameData;
 		frameReleaseProc(savedNewFrameReleaseIndex,pFrameReleaseProcRefCon);
 	}
 	
-    // Adjust currentIsoch time for next cycle
-    currentIsochTime -= 3072.000;
-
     // Deal with previous cycle objects jump target
 	if (doUpdateJumpTarget == true)
 		(pCycle->pPrev)->UpdateJumpTarget(pCycle->CycleMode, localIsocPort);
@@ -1082,31 +930,6 @@ DVTransmitter::FillCycleBuffer(DVXmitCycle *pCycle, UInt16 nodeID, bool doUpdate
 	return;
 }
 
-//////////////////////////////////////////////////////////////////////
-// calculateSYTTime
-//////////////////////////////////////////////////////////////////////
-unsigned int
-DVTransmitter::calculateSYTTime(void)
-{
-	UInt32	cycle_count;
-	UInt32  cycle_time;
-	UInt32  cycle_seconds;
-	
-	UInt32 savedCurrentDVTime = (UInt32) currentDVTime;
-	
-	// Calculate the seconds field, and remove those clocks from savedCurrentDVTime
-	cycle_seconds = savedCurrentDVTime/24576000;
-	savedCurrentDVTime = savedCurrentDVTime - (cycle_seconds*24576000);
-	
-	// Calculate the cycles field, and remove those clocks from savedCurrentDVTime
-	cycle_count = savedCurrentDVTime/3072;
-	savedCurrentDVTime = savedCurrentDVTime - (cycle_count*3072);
-
-	// Formulate a FireWire style time-stamp
-	cycle_time = ((cycle_seconds << 25) | (cycle_count<<12) | savedCurrentDVTime);
-	return cycle_time;
-}
-
 //////////////////////////////////////////////////////////////////////
 // FindDVFormatForMode
 //////////////////////////////////////////////////////////////////////
@@ -1152,6 +975,55 @@ DVTransmitFrame* DVTransmitter::getFrame(UInt32 frameIndex)
 	return (frameIndex < numFrames) ? framePtrs[frameIndex]: 0 ;
 }
 
+//////////////////////////////////////////////////////////////////////
+// attachFrameData
+//////////////////////////////////////////////////////////////////////
+IOReturn DVTransmitter::attachFrameData(UInt32 frameIndex, UInt8 *pData, UInt32 length)
+{
+	DVTransmitFrame* pFrame = getFrame(frameIndex);
+	
+	if (!pFrame)
+		return kIOReturnBadArgument;
+
+	// Can't switch the memory out from under a frame we're still transmitting,
+	// whether attaching client memory or detaching it
+	if (pFrame->inUse == true)
+		return kIOReturnBusy;
+
+	// Detach any client memory
+	if (pData == nil)
+	{
+		pFrame->pFrameData = pFrame->pInternalFrameData;
+		return kIOReturnSuccess;
+	}
+	
+	if (length != pFrame->frameLen)
+	{
+		logger->log("\nDVTransmitter Error: Attached frame data length %u doesn't match frame length %u\n",
+					(unsigned int) length, (unsigned int) pFrame->frameLen);
+		return kIOReturnBadArgument;
+	}
+	
+	pFrame->pFrameData = pData;
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// silenceRepeatedFrame
+//////////////////////////////////////////////////////////////////////
+void DVTransmitter::silenceRepeatedFrame(DVTransmitFrame *pFrame)
+{
+	// Client frame data may be read-only (i.e. a mapped file), and must not
+	// be modified in any case, so copy it into our own buffer to silence it.
+	if (pFrame->pFrameData != pFrame->pInternalFrameData)
+	{
+		memcpy(pFrame->pInternalFrameData, pFrame->pFrameData, pFrame->frameLen);
+		pFrame->pFrameData = pFrame->pInternalFrameData;
+	}
+	
+	DVSilenceFrame(dvMode, pFrame->pFrameData);
+}
+
 //////////////////////////////////////////////////////////////////////
 // RemotePort_GetSupported
 //////////////////////////////////////////////////////////////////////
@@ -1265,6 +1137,7 @@ void DVTransmitter::DVXmitDCLOverrunCallback(void)
 				pReleaseFrame->frameSYTTime = 0xFFFFFFFF;
 				pReleaseFrame->frameTransmitStartCycleTime = 0xFFFFFFFF;
 				pReleaseFrame->timeStampSecondsFieldValid = false;
+				pReleaseFrame->pFrameData = pReleaseFrame->pInternalFrameData;
 				framePtrs[i]->dclProgramRefCount = 0;
 				frameReleaseProc(i,pFrameReleaseProcRefCon);
 			}
@@ -1337,17 +1210,14 @@ void DVTransmitter::DVXmitDCLCallback( DVXmitCycle *pCallBackCycle )
 
 	// Get the current end-of-cycle timestamp and convert it to cycles
 	// 8000 cycles per second times 8 seconds gives a cycle number betwen 0 thru 63999
-	actualTimeStampCycle = ((pTimeStamps[currentSegment] & 0x01FFF000) >> 12);
-	actualTimeStampCycle += (((pTimeStamps[currentSegment] & 0x0E000000) >> 25) * 8000);
+	actualTimeStampCycle = FWTimeStampToCycles(pTimeStamps[currentSegment]);
 	
 	// If the actual time stamp is not what we expect, we need to deal with
 	// it here. 
 	if (actualTimeStampCycle != expectedTimeStampCycle)
 	{
 		// Calculate lost cycles (deal with wrap-around condition)
-		lostCycles = actualTimeStampCycle - expectedTimeStampCycle;
-		if (lostCycles < 0)
-			lostCycles += 64000; // based on 8 Seconds worth of cycles
+		lostCycles = FWTimeElapsed(expectedTimeStampCycle, actualTimeStampCycle, kFWCyclesPerTimeStampWrap);
 
 		// See if the descrepency between actual and expected time-stamps is
 		// only due to the fact that the initial value for the time-stsamp
@@ -1374,8 +1244,8 @@ void DVTransmitter::DVXmitDCLCallback( DVXmitCycle *pCallBackCycle )
 			
 			actualTimeStampCycle %= 64000;  // modulo by 8 Seconds worth of cycles
 			
-			// Compensate for difference by modifying currentDVTime
-			currentDVTime = actualTimeStampCycle*3072; 
+			// Compensate for difference by modifying the DV time
+			cadence.setDVTimeCycle(actualTimeStampCycle);
 		}
 		else
 		{
@@ -1403,16 +1273,15 @@ void DVTransmitter::DVXmitDCLCallback( DVXmitCycle *pCallBackCycle )
 			expectedTimeStampCycle = actualTimeStampCycle;
 			
 			// If the number of lost cycles is within our threshold,
-			// recover the lost time. Otherwise, just bump the currentDVTime
+			// recover the lost time. Otherwise, just bump the DV time
 			// which will affect future SYT times.
 			if (lostCycles <= kDVTransmitterLostCycleRecoveryThreshold)
 			{
 				logger->log("DVTransmitter timestamp adjust, using lost-cycle recovery\n");
 				
-				// By reducing currentIsochTime, we will
-				// transmit DIF data in places where there would
+				// Transmit DIF data in places where there would
 				// have been CIP-only packets
-				currentIsochTime -= (3072.000 * lostCycles);
+				cadence.recoverLostCycles(lostCycles);
 			}
 			else
 			{
@@ -1428,8 +1297,8 @@ void DVTransmitter::DVXmitDCLCallback( DVXmitCycle *pCallBackCycle )
 				
 				actualTimeStampCycle %= 64000;  // modulo by 8 Seconds worth of cycles
 				
-				// Compensate for difference by modifying currentDVTime
-				currentDVTime = actualTimeStampCycle*3072; 
+				// Compensate for difference by modifying the DV time
+				cadence.setDVTimeCycle(actualTimeStampCycle);
 			}
 		}
 	}
@@ -102,6 +102,10 @@ struct DVTransmitFrame
 	UInt32 curOffset;
 	UInt32 dclProgramRefCount;
 
+	// The transmitter's own frame buffer. pFrameData points here, unless the client
+	// has attached its own memory to this frame with DVTransmitter::attachFrameData().
+	UInt8 *pInternalFrameData;
+
 	// If timeStampSecondsFieldValid is true, then the 3-bits of "seconds field" in the 
 	// frameTransmitStartCycleTime are valid (bits 27:25). Otherwise, if
 	// timeStampSecondsFieldValid is false, the 3-bits of "seconds field" are not valid.
@@ -171,6 +175,16 @@ public:
 	// Convert a frame index into a pointer to the frame struct
 	DVTransmitFrame* getFrame(UInt32 frameIndex);
 	
+	// Have a frame transmit from client-owned memory (for example, a view into a
+	// memory-mapped DV file), instead of the client copying into the frame's buffer.
+	// Call this for the frame being returned from the frame pull proc. The memory
+	// must hold a full frame, and is only read by the transmitter. The frame goes
+	// back to using its own buffer before it's passed to the frame release proc,
+	// after which the client memory is no longer referenced. Passing nil for pData
+	// detaches any client memory from a frame that won't be transmitted after all.
+	// Either way, returns kIOReturnBusy if the frame is still being transmitted.
+	IOReturn attachFrameData(UInt32 frameIndex, UInt8 *pData, UInt32 length);
+	
 	// Publically visible vars
 	unsigned int transportState;
 
@@ -185,13 +199,13 @@ private:
 	// Internal function used during DCL callbacks
 	void FillCycleBuffer(DVXmitCycle *pCycle, UInt16 nodeID, bool doUpdateJumpTarget);
 
-	// Function to create DV SYT fields
-	// from currentDVTime
-    unsigned int calculateSYTTime(void);
-
 	// Take the dvMode, and find the DVFormat info
 	IOReturn FindDVFormatForMode(void);
 	
+	// Mute the audio of a frame that will be sent again, moving
+	// any attached client frame data into the frame's own buffer first
+	void silenceRepeatedFrame(DVTransmitFrame *pFrame);
+	
 	// Frame handler functions
 	DVFramePullProc framePullProc;
 	void *pFramePullProcRefCon;
@@ -218,11 +232,9 @@ private:
 	DCLCommandStruct *pOverrunCallbackLabel;
 
 	UInt8 dvMode;
-	UInt8 dbc;
 	UInt32 numFrames;
 	DVFormats* pDVFormat;
-    double currentIsochTime;
-	double currentDVTime;
+	DVTransmitCadence cadence;
 	unsigned int xmitChannel;
 	IOFWSpeed xmitSpeed;
 	UInt8 *pTransmitBuffer;
@@ -237,6 +249,7 @@ private:
 	UInt32 expectedTimeStampCycle;
 	UInt32 transmitBufferSize;
 	DVTransmitFrame** framePtrs;
+	DVFrameBufferPool *pFrameBufferPool;
 	StringLogger *logger;
 	DVTransmitFrame* pCurrentFrame;
 	volatile bool finalizeCallbackCalled;
@@ -1404,6 +1404,22 @@ void FWAVCDVTransmitterFrameGetDataBuf(FWAVCDVTransmitterFrameRef fwavcDVTransmi
 	*pFrameLen = pDVTransmitFrame->frameLen;
 }
 
+//////////////////////////////////////////////////////////
+// FWAVCDVTransmitterFrameAttachDataBuf
+//////////////////////////////////////////////////////////
+IOReturn FWAVCDVTransmitterFrameAttachDataBuf(FWAVCDeviceStreamRef fwavcDeviceStreamRef,
+											  FWAVCDVTransmitterFrameRef fwavcDVTransmitterFrameRef,
+											  UInt8 *pFrameData,
+											  UInt32 frameLen)
+{
+	DVTransmitFrame *pDVTransmitFrame = (DVTransmitFrame*) fwavcDVTransmitterFrameRef;
+
+	if (fwavcDeviceStreamRef->pAVCDeviceStream->streamType != kStreamTypeDVTransmitter)
+		return kIOReturnBadArgument;
+	
+	return fwavcDeviceStreamRef->pAVCDeviceStream->pDVTransmitter->attachFrameData(pDVTransmitFrame->frameIndex, pFrameData, frameLen);
+}
+
 //////////////////////////////////////////////////////////
 // FWAVCDVTransmitterFrameGetSYTTime
 //////////////////////////////////////////////////////////
@@ -1643,6 +1659,17 @@ IOReturn FWAVCDVFramerNextDVSourcePacket(FWAVCDVFramerRef fwavcDVFramerRef,
 	return fwavcDVFramerRef->pDVFramer->nextDVSourcePacket(pSourcePacket,packetLen,dvMode,syt,packetTimeStamp,packetU64TimeStamp);
 }
 
+//////////////////////////////////////////////////////////
+// FWAVCDVFramerNextCIPPacket
+//////////////////////////////////////////////////////////
+IOReturn FWAVCDVFramerNextCIPPacket(FWAVCDVFramerRef fwavcDVFramerRef,
+									FWAVCCIPPacketParserInfo *pParsedPacket,
+									UInt32 packetTimeStamp,
+									UInt64 packetU64TimeStamp)
+{
+	return fwavcDVFramerRef->pDVFramer->nextCIPPacket(pParsedPacket,packetTimeStamp,packetU64TimeStamp);
+}
+
 //////////////////////////////////////////////////////////
 // FWAVCDVFramerReturnDVFrame
 //////////////////////////////////////////////////////////
@@ -1642,6 +1642,35 @@ extern
 void FWAVCDVTransmitterFrameGetDataBuf(FWAVCDVTransmitterFrameRef fwavcDVTransmitterFrameRef, UInt8 **ppFrameData, UInt32 *pFrameLen)
 																	AVAILABLE_MAC_OS_X_VERSION_10_4_AND_LATER;
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*!
+	@function FWAVCDVTransmitterFrameAttachDataBuf
+ 
+	@abstract For dv-transmitter type avc device streams frames, have the frame transmit from client-owned memory,
+ such as a view into a memory-mapped DV file, instead of copying the frame data into the frame's buffer.
+ 
+	@discussion Call this from the frame request proc, for the frame being returned. The transmitter only reads 
+ from the attached memory. The frame reverts to its own buffer before it is passed to the frame return proc, after 
+ which the client memory is no longer referenced.
+ 
+	@param fwavcDeviceStreamRef The reference to the AVC device stream.
+
+	@param fwavcDVTransmitterFrameRef The reference to the DV transmitter frame.
+ 
+	@param pFrameData A pointer to the client's frame data, or nil to detach previously attached client memory.
+
+	@param frameLen The length of the client's frame data. This must match the frame's length.
+ 
+	@result kIOReturnSuccess if successful, specific error otherwise. 
+*/
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+extern
+IOReturn FWAVCDVTransmitterFrameAttachDataBuf(FWAVCDeviceStreamRef fwavcDeviceStreamRef,
+											  FWAVCDVTransmitterFrameRef fwavcDVTransmitterFrameRef,
+											  UInt8 *pFrameData,
+											  UInt32 frameLen)
+																	AVAILABLE_MAC_OS_X_VERSION_10_4_AND_LATER;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /*!
 	@function FWAVCDVTransmitterFrameGetSYTTime
@@ -1916,6 +1945,31 @@ IOReturn FWAVCDVFramerNextDVSourcePacket(FWAVCDVFramerRef fwavcDVFramerRef,
 										 UInt64 packetU64TimeStamp)
 																	AVAILABLE_MAC_OS_X_VERSION_10_4_AND_LATER;
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*!
+	@function FWAVCDVFramerNextCIPPacket
+ 
+	@abstract Pass all of the DV "source packets" of a CIP packet into the DV framer. This is much cheaper than 
+	calling FWAVCDVFramerNextDVSourcePacket for each source packet.
+ 
+	@param fwavcDVFramerRef The reference to the DV framer.
+	
+	@param pParsedPacket A pointer to the FWAVCCIPPacketParserInfo structure returned by FWAVCParseCIPPacket.
+ 
+	@param packetTimeStamp The FireWire time-stamp, or any other 32-bit value associated with the CIP packet.
+ 
+	@param packetU64TimeStamp The system time-stamp, or any other 64-bit value associated with the CIP packet. 
+ 
+	@result kIOReturnSuccess if successful, specific error otherwise. 
+*/
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+extern
+IOReturn FWAVCDVFramerNextCIPPacket(FWAVCDVFramerRef fwavcDVFramerRef,
+									FWAVCCIPPacketParserInfo *pParsedPacket,
+									UInt32 packetTimeStamp,
+									UInt64 packetU64TimeStamp)
+																	AVAILABLE_MAC_OS_X_VERSION_10_4_AND_LATER;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /*!
 	@function FWAVCDVFramerReturnDVFrame
@@ -463,14 +463,10 @@ IOReturn UniversalReceiveCallback(FWAVCDeviceStreamRef fwavcDeviceStreamRef,
 					lastFmt = kFWAVC61883Fmt_DV;
 				}
 				
-				for (sourcePacket=0;sourcePacket<parsedPacket.numSourcePackets;sourcePacket++)
-					result = FWAVCDVFramerNextDVSourcePacket(MyFWAVCDVFramerRef,
-															 parsedPacket.pSourcePacket[sourcePacket], 
-															 parsedPacket.sourcePacketSize, 
-															 parsedPacket.dvMode, 
-															 parsedPacket.syt, 
-															 pCycleData[cycle].fireWireTimeStamp,
-															 pCycleData[cycle].nanoSecondsTimeStamp);
+				result = FWAVCDVFramerNextCIPPacket(MyFWAVCDVFramerRef,
+													&parsedPacket,
+													pCycleData[cycle].fireWireTimeStamp,
+													pCycleData[cycle].nanoSecondsTimeStamp);
 				if (result != kIOReturnSuccess)
 					printf("DataReceiveCallback: nextTSPacket failed. Result: 0x%08X\n",result);
 			}
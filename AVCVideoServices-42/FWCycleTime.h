@@ -0,0 +1,267 @@
+/*
+	File:		FWCycleTime.h
+ 
+ Synopsis: Integer FireWire cycle-time arithmetic, shared by the isoch transmitters and receivers.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_FWCYCLETIME__
+#define __AVCVIDEOSERVICES_FWCYCLETIME__
+
+namespace AVS
+{
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  FireWire cycle-time arithmetic
+//
+//  The cycle timer counts 24.576MHz clocks: 3072 clocks per 125uSec cycle, 8000
+//  cycles per second, and a 7-bit seconds field, so it wraps every 128 seconds.
+//  DCL time stamps and DV SYT times only carry the low 3 bits of the seconds
+//  field, and MPEG2 source packet headers carry no seconds at all.
+//
+//  Everything here is integer math, so it gives the same answer every time, and
+//  it can be exercised without any FireWire hardware.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+enum
+{
+	kFWClocksPerCycle = 3072,
+	kFWCyclesPerSecond = 8000,
+	kFWClocksPerSecond = 24576000,
+	kFWNanoSecondsPerCycle = 125000,
+	kFWCyclesPerTimeStampWrap = 64000,			// 8 seconds: DCL time stamps and DV SYT times
+	kFWClocksPerTimeStampWrap = 196608000,
+	kFWCyclesPerCycleTimeWrap = 1024000			// 128 seconds: the full cycle timer
+};
+
+static const UInt32 kFWClocksPerCycleTimeWrap = 3145728000U;
+
+//////////////////////////////////////////////////////
+// FWClocksIntoSecond
+//
+// Clocks since the start of the current second, from
+// a cycle timer value, time stamp, or source packet header
+//////////////////////////////////////////////////////
+static inline UInt32 FWClocksIntoSecond(UInt32 cycleTime)
+{
+	return ((((cycleTime & 0x01FFF000) >> 12) * kFWClocksPerCycle) + (cycleTime & 0x00000FFF));
+}
+
+//////////////////////////////////////////////////////
+// FWTimeStampToCycles
+//
+// Cycles since the last 8 second wrap, from a DCL time stamp
+// or cycle timer value
+//////////////////////////////////////////////////////
+static inline UInt32 FWTimeStampToCycles(UInt32 timeStamp)
+{
+	return ((((timeStamp & 0x0E000000) >> 25) * kFWCyclesPerSecond) + ((timeStamp & 0x01FFF000) >> 12));
+}
+
+//////////////////////////////////////////////////////
+// FWCyclesToTimeStamp
+//
+// The time stamp (3-bit seconds, cycle count, zero offset)
+// for a count of cycles
+//////////////////////////////////////////////////////
+static inline UInt32 FWCyclesToTimeStamp(UInt32 cycles)
+{
+	cycles %= kFWCyclesPerTimeStampWrap;
+	return (((cycles / kFWCyclesPerSecond) << 25) | ((cycles % kFWCyclesPerSecond) << 12));
+}
+
+//////////////////////////////////////////////////////
+// FWTimeElapsed
+//
+// Time from "from" to "to", in any units that wrap at "wrap".
+// Both times must be less than wrap.
+//////////////////////////////////////////////////////
+static inline UInt32 FWTimeElapsed(UInt32 from, UInt32 to, UInt32 wrap)
+{
+	return (to >= from) ? (to - from) : (to + (wrap - from));
+}
+
+//////////////////////////////////////////////////////
+// FWClocksToNanoSeconds
+//
+// A FireWire clock is exactly 15625/384 nSec
+//////////////////////////////////////////////////////
+static inline UInt64 FWClocksToNanoSeconds(UInt64 clocks)
+{
+	return (((clocks * 15625) + 192) / 384);
+}
+
+//////////////////////////////////////////////////////
+// FWNanoSecondsToClocks
+//////////////////////////////////////////////////////
+static inline UInt64 FWNanoSecondsToClocks(UInt64 nanoSeconds)
+{
+	return (((nanoSeconds * 384) + 7812) / 15625);
+}
+
+//////////////////////////////////////////////////////
+// FWCyclesToNanoSeconds
+//////////////////////////////////////////////////////
+static inline UInt64 FWCyclesToNanoSeconds(UInt64 cycles)
+{
+	return (cycles * kFWNanoSecondsPerCycle);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  Scaled clocks
+//
+//  A packet cadence that isn't a whole number of clocks per packet is tracked as an
+//  SInt64 count of 1/scale clocks. When the scale makes the packet period a whole
+//  number (625 for both DV standards), the cadence is exact and never drifts.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////
+// FWClocksToScaledClocks
+//////////////////////////////////////////////////////
+static inline SInt64 FWClocksToScaledClocks(UInt32 clocks, UInt64 scale)
+{
+	return ((SInt64) clocks * (SInt64) scale);
+}
+
+//////////////////////////////////////////////////////
+// FWScaledClocksToClocks
+//
+// Whole clocks in a (non-negative) scaled time
+//////////////////////////////////////////////////////
+static inline UInt32 FWScaledClocksToClocks(SInt64 scaledClocks, UInt64 scale)
+{
+	return (UInt32) (scaledClocks / (SInt64) scale);
+}
+
+//////////////////////////////////////////////////////
+// FWScaledClocksPerPacket
+//
+// The packet period, in scaled clocks, of a stream of
+// bitsPerPacket sized packets at bitsPerSecond. Call it when the
+// rate changes, not once per packet.
+//////////////////////////////////////////////////////
+static inline SInt64 FWScaledClocksPerPacket(double bitsPerSecond, UInt32 bitsPerPacket, UInt64 scale)
+{
+	return (SInt64) (((((double) kFWClocksPerSecond) * bitsPerPacket * scale) / bitsPerSecond) + 0.5);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  FWCycleTime: A point in time on the 128 second cycle timer, kept as a count of
+//  clocks. Conversions to and from the cycle timer register layout, time stamps,
+//  SYT and SPH fields are exact, as is adding, subtracting and comparing with wrap.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+class FWCycleTime
+{
+	
+public:
+	FWCycleTime(void) {clocks = 0;};
+	explicit FWCycleTime(UInt32 clockCount) {clocks = (clockCount % kFWClocksPerCycleTimeWrap);};
+	
+	// Make a cycle time from a cycle timer register value
+	static FWCycleTime fromRegister(UInt32 cycleTime)
+	{
+		return FWCycleTime((((cycleTime & 0xFE000000) >> 25) * kFWClocksPerSecond) + FWClocksIntoSecond(cycleTime));
+	};
+	
+	// Make a cycle time from a count of cycles
+	static FWCycleTime fromCycles(UInt32 cycles)
+	{
+		return FWCycleTime((cycles % kFWCyclesPerCycleTimeWrap) * kFWClocksPerCycle);
+	};
+	
+	// Accessors
+	UInt32 getClocks(void) const {return clocks;};
+	UInt32 getCycles(void) const {return (clocks / kFWClocksPerCycle);};
+	UInt32 getSeconds(void) const {return (clocks / kFWClocksPerSecond);};
+	UInt32 getCycleCount(void) const {return (getCycles() % kFWCyclesPerSecond);};
+	UInt32 getCycleOffset(void) const {return (clocks % kFWClocksPerCycle);};
+	
+	// The cycle timer register layout: 7-bit seconds, 13-bit cycle count, 12-bit offset
+	UInt32 getRegister(void) const {return ((getSeconds() << 25) | (getCycleCount() << 12) | getCycleOffset());};
+	
+	// A DCL time stamp, or DV frame SYT time: the register layout with 3-bit seconds
+	UInt32 getTimeStamp(void) const {return (getRegister() & 0x0FFFFFFF);};
+	
+	// An MPEG2 source packet header time: 13-bit cycle count, 12-bit offset
+	UInt32 getSPH(void) const {return ((getCycleCount() << 12) | getCycleOffset());};
+	
+	// A CIP header SYT field: low 4 bits of the cycle count, 12-bit offset
+	UInt16 getSYT(void) const {return (UInt16) (((getCycleCount() & 0x0F) << 12) | getCycleOffset());};
+	
+	// Later and earlier times, with wrap
+	FWCycleTime add(UInt32 deltaClocks) const
+	{
+		return FWCycleTime((UInt32) (((UInt64) clocks + (deltaClocks % kFWClocksPerCycleTimeWrap)) % kFWClocksPerCycleTimeWrap));
+	};
+	FWCycleTime addCycles(UInt32 deltaCycles) const {return add(fromCycles(deltaCycles).getClocks());};
+	FWCycleTime subtract(UInt32 deltaClocks) const {return add(kFWClocksPerCycleTimeWrap - (deltaClocks % kFWClocksPerCycleTimeWrap));};
+	
+	// Clocks from an earlier time to this one (0 thru just under 128 seconds)
+	UInt32 clocksSince(FWCycleTime earlier) const {return FWTimeElapsed(earlier.clocks, clocks, kFWClocksPerCycleTimeWrap);};
+	
+	// Signed clocks from other to this time, taking the nearest way around the wrap
+	SInt32 clocksFrom(FWCycleTime other) const
+	{
+		UInt32 elapsed = clocksSince(other);
+		return (elapsed < (kFWClocksPerCycleTimeWrap/2)) ? (SInt32) elapsed : -((SInt32) (kFWClocksPerCycleTimeWrap - elapsed));
+	};
+	
+	// Less than zero if this time is before other, zero if the same, greater than zero if after
+	int compare(FWCycleTime other) const
+	{
+		SInt32 delta = clocksFrom(other);
+		return (delta < 0) ? -1 : ((delta > 0) ? 1 : 0);
+	};
+	
+private:
+	UInt32 clocks;
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_FWCYCLETIME__
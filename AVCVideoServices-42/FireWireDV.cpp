@@ -106,6 +106,7 @@ struct DVReceiverThreadParams
 	bool doIRMAllocations;
 	UInt8 receiverDVMode;
 	UInt32 numFrameBuffers;
+	bool followDVModeChanges;
 };
 
 // Prototypes for static functions in this file
@@ -257,7 +258,8 @@ IOReturn CreateDVReceiver(DVReceiver **ppReceiver,
 						  unsigned int numSegments,
 						  UInt8 receiverDVMode,
 						  UInt32 numFrameBuffers,
-						  bool doIRMAllocations)
+						  bool doIRMAllocations,
+						  bool followDVModeChanges)
 {
 	DVReceiverThreadParams threadParams;
 	pthread_t rtThread;
@@ -276,6 +278,7 @@ IOReturn CreateDVReceiver(DVReceiver **ppReceiver,
 	threadParams.doIRMAllocations = doIRMAllocations;
 	threadParams.receiverDVMode = receiverDVMode;
 	threadParams.numFrameBuffers = numFrameBuffers;
+	threadParams.followDVModeChanges = followDVModeChanges;
 
 	// Create the real-time thread which will instantiate and setup new FireWireDV object
 	pthread_attr_init(&threadAttr);
@@ -330,7 +333,8 @@ static void *DVReceiverRTThreadStart(DVReceiverThreadParams* pParams)
 						   pParams->receiverDVMode,
 						   pParams->cyclesPerSegment,
 						   pParams->numSegments,
-						   pParams->doIRMAllocations);
+						   pParams->doIRMAllocations,
+						   pParams->followDVModeChanges);
 
 	// Setup the receiver object
 	if (receiver)
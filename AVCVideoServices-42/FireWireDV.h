@@ -90,7 +90,8 @@ IOReturn CreateDVReceiver(DVReceiver **ppReceiver,
 						  unsigned int numSegments = kNumDVReceiveSegments,
 						  UInt8 receiverDVMode = 0x00,
 						  UInt32 numFrameBuffers = kDVReceiveNumFrames,
-						  bool doIRMAllocations = false);
+						  bool doIRMAllocations = false,
+						  bool followDVModeChanges = false);
 
 // Destroy a DVReceiver object created with CreateDVReceiver(), and it's dedicated thread
 IOReturn DestroyDVReceiver(DVReceiver *pReceiver);
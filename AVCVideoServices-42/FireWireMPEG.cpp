@@ -63,6 +63,7 @@ struct MPEG2ReceiverThreadParams
 	unsigned int cyclesPerSegment;
 	unsigned int numSegments;
 	bool doIRMAllocations;
+	unsigned int maxPacketsPerCycle;
 };
 
 struct MPEG2TransmitterThreadParams
@@ -82,9 +83,42 @@ struct MPEG2TransmitterThreadParams
 	unsigned int tsPacketQueueSizeInPackets;
 };
 
+struct MPEG2MultiStreamTransmitterThreadParams
+{
+	volatile bool threadReady;
+	MPEG2MultiStreamTransmitter *pMultiStreamTransmitter;
+	StringLogger *stringLogger;
+	IOFireWireLibNubRef nubInterface;
+	unsigned int cyclesPerSegment;
+	unsigned int numSegments;
+	bool doIRMAllocations;
+	unsigned int packetsPerCycle;
+	unsigned int tsPacketQueueSizeInPackets;
+	unsigned int packetsPerPull;
+};
+
+struct MPEG2MultiChannelReceiverThreadParams
+{
+	volatile bool threadReady;
+	MPEG2MultiChannelReceiver *pMultiChannelReceiver;
+	MPEG2MultiChannelDataPushProc dataPushProcHandler;
+	void *pDataPushProcRefCon;
+	MPEG2MultiChannelMessageProc messageProcHandler;
+	void *pMessageProcRefCon;
+	StringLogger *stringLogger;
+	IOFireWireLibNubRef nubInterface;
+	unsigned int cyclesPerSegment;
+	unsigned int numSegments;
+	bool doIRMAllocations;
+	unsigned int maxPacketsPerCycle;
+	unsigned int maxChannels;
+};
+
 // Prototypes for static functions in this file
 static void *MPEG2ReceiverRTThreadStart(MPEG2ReceiverThreadParams* pParams);
 static void *MPEG2TransmitterRTThreadStart(MPEG2TransmitterThreadParams* pParams);
+static void *MPEG2MultiStreamTransmitterRTThreadStart(MPEG2MultiStreamTransmitterThreadParams* pParams);
+static void *MPEG2MultiChannelReceiverRTThreadStart(MPEG2MultiChannelReceiverThreadParams* pParams);
 
 //////////////////////////////////////////////////////
 // CreateMPEG2Receiver
@@ -98,7 +132,8 @@ IOReturn CreateMPEG2Receiver(MPEG2Receiver **ppReceiver,
 							 IOFireWireLibNubRef nubInterface,
 							 unsigned int cyclesPerSegment,
 							 unsigned int numSegments,
-							 bool doIRMAllocations)
+							 bool doIRMAllocations,
+							 unsigned int maxPacketsPerCycle)
 {
 	MPEG2ReceiverThreadParams threadParams;
 	pthread_t rtThread;
@@ -113,6 +148,7 @@ IOReturn CreateMPEG2Receiver(MPEG2Receiver **ppReceiver,
 	threadParams.cyclesPerSegment = cyclesPerSegment;
 	threadParams.numSegments = numSegments;
 	threadParams.doIRMAllocations = doIRMAllocations;
+	threadParams.maxPacketsPerCycle = maxPacketsPerCycle;
 	threadParams.pDataPushProcRefCon = pDataPushProcRefCon;
 	threadParams.pMessageProcRefCon = pMessageProcRefCon;
 
@@ -224,6 +260,142 @@ IOReturn DestroyMPEG2Transmitter(MPEG2Transmitter *pTransmitter)
 	return result;
 }
 
+//////////////////////////////////////////////////////
+// CreateMPEG2MultiStreamTransmitter
+//////////////////////////////////////////////////////
+IOReturn CreateMPEG2MultiStreamTransmitter(MPEG2MultiStreamTransmitter **ppMultiStreamTransmitter,
+										   StringLogger *stringLogger,
+										   IOFireWireLibNubRef nubInterface,
+										   unsigned int cyclesPerSegment,
+										   unsigned int numSegments,
+										   bool doIRMAllocations,
+										   unsigned int packetsPerCycle,
+										   unsigned int tsPacketQueueSizeInPackets,
+										   unsigned int packetsPerPull)
+{
+	MPEG2MultiStreamTransmitterThreadParams threadParams;
+	pthread_t rtThread;
+	pthread_attr_t threadAttr;
+
+	threadParams.threadReady = false;
+	threadParams.pMultiStreamTransmitter = nil;
+	threadParams.stringLogger = stringLogger;
+	threadParams.nubInterface = nubInterface;
+	threadParams.cyclesPerSegment = cyclesPerSegment;
+	threadParams.numSegments = numSegments;
+	threadParams.doIRMAllocations = doIRMAllocations;
+	threadParams.packetsPerCycle = packetsPerCycle;
+	threadParams.tsPacketQueueSizeInPackets = tsPacketQueueSizeInPackets;
+	threadParams.packetsPerPull = packetsPerPull;
+
+	// Create the real-time thread which will be shared by all the streams
+	pthread_attr_init(&threadAttr);
+	pthread_attr_setdetachstate(&threadAttr, PTHREAD_CREATE_DETACHED);
+	pthread_create(&rtThread, &threadAttr, (void *(*)(void *))MPEG2MultiStreamTransmitterRTThreadStart, &threadParams);
+	pthread_attr_destroy(&threadAttr);
+
+	// Wait forever for the new thread to be ready
+	while (threadParams.threadReady == false) usleep(1000);
+
+	*ppMultiStreamTransmitter = threadParams.pMultiStreamTransmitter;
+
+	if (threadParams.pMultiStreamTransmitter)
+		return kIOReturnSuccess;
+	else
+		return kIOReturnError;
+}
+
+//////////////////////////////////////////////////////
+// DestroyMPEG2MultiStreamTransmitter
+//////////////////////////////////////////////////////
+IOReturn DestroyMPEG2MultiStreamTransmitter(MPEG2MultiStreamTransmitter *pMultiStreamTransmitter)
+{
+	IOReturn result = kIOReturnSuccess ;
+	CFRunLoopRef runLoopRef;
+
+	// Save the ref to the run loop the streams are using
+	runLoopRef = pMultiStreamTransmitter->runLoopRef;
+
+	// Delete the multi-stream transmitter object, and all of its streams
+	delete pMultiStreamTransmitter;
+
+	// Stop the run-loop in the RT thread. The RT thread will then terminate
+	CFRunLoopStop(runLoopRef);
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// CreateMPEG2MultiChannelReceiver
+//////////////////////////////////////////////////////
+IOReturn CreateMPEG2MultiChannelReceiver(MPEG2MultiChannelReceiver **ppMultiChannelReceiver,
+										 MPEG2MultiChannelDataPushProc dataPushProcHandler,
+										 void *pDataPushProcRefCon,
+										 MPEG2MultiChannelMessageProc messageProcHandler,
+										 void *pMessageProcRefCon,
+										 StringLogger *stringLogger,
+										 IOFireWireLibNubRef nubInterface,
+										 unsigned int cyclesPerSegment,
+										 unsigned int numSegments,
+										 bool doIRMAllocations,
+										 unsigned int maxPacketsPerCycle,
+										 unsigned int maxChannels)
+{
+	MPEG2MultiChannelReceiverThreadParams threadParams;
+	pthread_t rtThread;
+	pthread_attr_t threadAttr;
+
+	threadParams.threadReady = false;
+	threadParams.pMultiChannelReceiver = nil;
+	threadParams.dataPushProcHandler = dataPushProcHandler;
+	threadParams.pDataPushProcRefCon = pDataPushProcRefCon;
+	threadParams.messageProcHandler = messageProcHandler;
+	threadParams.pMessageProcRefCon = pMessageProcRefCon;
+	threadParams.stringLogger = stringLogger;
+	threadParams.nubInterface = nubInterface;
+	threadParams.cyclesPerSegment = cyclesPerSegment;
+	threadParams.numSegments = numSegments;
+	threadParams.doIRMAllocations = doIRMAllocations;
+	threadParams.maxPacketsPerCycle = maxPacketsPerCycle;
+	threadParams.maxChannels = maxChannels;
+
+	// Create the real-time thread which will be shared by all the channels
+	pthread_attr_init(&threadAttr);
+	pthread_attr_setdetachstate(&threadAttr, PTHREAD_CREATE_DETACHED);
+	pthread_create(&rtThread, &threadAttr, (void *(*)(void *))MPEG2MultiChannelReceiverRTThreadStart, &threadParams);
+	pthread_attr_destroy(&threadAttr);
+
+	// Wait forever for the new thread to be ready
+	while (threadParams.threadReady == false) usleep(1000);
+
+	*ppMultiChannelReceiver = threadParams.pMultiChannelReceiver;
+
+	if (threadParams.pMultiChannelReceiver)
+		return kIOReturnSuccess;
+	else
+		return kIOReturnError;
+}
+
+//////////////////////////////////////////////////////
+// DestroyMPEG2MultiChannelReceiver
+//////////////////////////////////////////////////////
+IOReturn DestroyMPEG2MultiChannelReceiver(MPEG2MultiChannelReceiver *pMultiChannelReceiver)
+{
+	IOReturn result = kIOReturnSuccess ;
+	CFRunLoopRef runLoopRef;
+
+	// Save the ref to the run loop the channels are using
+	runLoopRef = pMultiChannelReceiver->runLoopRef;
+
+	// Delete the multi-channel receiver object, and all of its channels
+	delete pMultiChannelReceiver;
+
+	// Stop the run-loop in the RT thread. The RT thread will then terminate
+	CFRunLoopStop(runLoopRef);
+
+	return result;
+}
+
 //////////////////////////////////////////////////////////////////////
 // MPEG2ReceiverRTThreadStart
 //////////////////////////////////////////////////////////////////////
@@ -237,7 +409,8 @@ static void *MPEG2ReceiverRTThreadStart(MPEG2ReceiverThreadParams* pParams)
 							  pParams->nubInterface,
 							  pParams->cyclesPerSegment,
 							  pParams->numSegments,
-							  pParams->doIRMAllocations);
+							  pParams->doIRMAllocations,
+							  pParams->maxPacketsPerCycle);
 							  
 	// Setup the receiver object
 	if (receiver)
@@ -326,4 +499,97 @@ static void *MPEG2TransmitterRTThreadStart(MPEG2TransmitterThreadParams* pParams
 	return nil;
 }
 
+//////////////////////////////////////////////////////////////////////
+// MPEG2MultiStreamTransmitterRTThreadStart
+//////////////////////////////////////////////////////////////////////
+static void *MPEG2MultiStreamTransmitterRTThreadStart(MPEG2MultiStreamTransmitterThreadParams* pParams)
+{
+	IOReturn result = kIOReturnSuccess ;
+	MPEG2MultiStreamTransmitter *multiStreamTransmitter;
+
+	// Instantiate a new multi-stream transmitter object
+	multiStreamTransmitter = new MPEG2MultiStreamTransmitter(pParams->stringLogger,
+															 pParams->nubInterface,
+															 pParams->cyclesPerSegment,
+															 pParams->numSegments,
+															 pParams->doIRMAllocations,
+															 pParams->packetsPerCycle,
+															 pParams->tsPacketQueueSizeInPackets,
+															 pParams->packetsPerPull);
+
+	// Setup the multi-stream transmitter object on this thread's run loop
+	if (multiStreamTransmitter)
+		result = multiStreamTransmitter->setupMultiStreamTransmitter();
+
+	// Update the return parameter with a pointer to the new multi-stream transmitter object
+	if (result == kIOReturnSuccess)
+		pParams->pMultiStreamTransmitter = multiStreamTransmitter;
+	else
+	{
+		delete multiStreamTransmitter;
+		multiStreamTransmitter = nil;
+		pParams->pMultiStreamTransmitter = nil;
+	}
+
+	// Boost priority of this thread
+	MakeCurrentThreadTimeContraintThread();
+
+	// Signal that this thread is ready
+	pParams->threadReady = true;
+
+	// Start the run loop
+	if ((multiStreamTransmitter) && (result == kIOReturnSuccess))
+		CFRunLoopRun();
+
+	return nil;
+}
+
+//////////////////////////////////////////////////////////////////////
+// MPEG2MultiChannelReceiverRTThreadStart
+//////////////////////////////////////////////////////////////////////
+static void *MPEG2MultiChannelReceiverRTThreadStart(MPEG2MultiChannelReceiverThreadParams* pParams)
+{
+	IOReturn result = kIOReturnSuccess ;
+	MPEG2MultiChannelReceiver *multiChannelReceiver;
+
+	// Instantiate a new multi-channel receiver object
+	multiChannelReceiver = new MPEG2MultiChannelReceiver(pParams->stringLogger,
+														 pParams->nubInterface,
+														 pParams->cyclesPerSegment,
+														 pParams->numSegments,
+														 pParams->doIRMAllocations,
+														 pParams->maxPacketsPerCycle,
+														 pParams->maxChannels);
+
+	// Setup the multi-channel receiver object on this thread's run loop
+	if (multiChannelReceiver)
+		result = multiChannelReceiver->setupMultiChannelReceiver();
+
+	// Update the return parameter with a pointer to the new multi-channel receiver object
+	if (result == kIOReturnSuccess)
+	{
+		multiChannelReceiver->registerDataPushCallback(pParams->dataPushProcHandler,pParams->pDataPushProcRefCon);
+		multiChannelReceiver->registerMessageCallback(pParams->messageProcHandler,pParams->pMessageProcRefCon);
+		pParams->pMultiChannelReceiver = multiChannelReceiver;
+	}
+	else
+	{
+		delete multiChannelReceiver;
+		multiChannelReceiver = nil;
+		pParams->pMultiChannelReceiver = nil;
+	}
+
+	// Boost priority of this thread
+	MakeCurrentThreadTimeContraintThread();
+
+	// Signal that this thread is ready
+	pParams->threadReady = true;
+
+	// Start the run loop
+	if ((multiChannelReceiver) && (result == kIOReturnSuccess))
+		CFRunLoopRun();
+
+	return nil;
+}
+
 } // namespace AVS
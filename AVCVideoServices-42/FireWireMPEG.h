@@ -69,7 +69,8 @@ IOReturn CreateMPEG2Receiver(MPEG2Receiver **ppReceiver,
 							 IOFireWireLibNubRef nubInterface = nil,
 							 unsigned int cyclesPerSegment = kCyclesPerReceiveSegment,
 							 unsigned int numSegments = kNumReceiveSegments,
-							 bool doIRMAllocations = false);
+							 bool doIRMAllocations = false,
+							 unsigned int maxPacketsPerCycle = kMaxNumReceivePacketsPerCycle);
 
 // Destroy a MPEG2Receiver object created with CreateMPEG2Receiver(), and it's dedicated thread
 IOReturn DestroyMPEG2Receiver(MPEG2Receiver *pReceiver);
@@ -91,6 +92,37 @@ IOReturn CreateMPEG2Transmitter(MPEG2Transmitter **ppTransmitter,
 // Destroy a MPEG2Transmitter object created with CreateMPEG2Transmitter(), and it's dedicated thread
 IOReturn DestroyMPEG2Transmitter(MPEG2Transmitter *pTransmitter);
 
+// Create and setup a MPEG2MultiStreamTransmitter object and the one real-time thread shared by all of its streams
+IOReturn CreateMPEG2MultiStreamTransmitter(MPEG2MultiStreamTransmitter **ppMultiStreamTransmitter,
+										   StringLogger *stringLogger = nil,
+										   IOFireWireLibNubRef nubInterface = nil,
+										   unsigned int cyclesPerSegment = kCyclesPerTransmitSegment,
+										   unsigned int numSegments = kNumTransmitSegments,
+										   bool doIRMAllocations = false,
+										   unsigned int packetsPerCycle = kNumTSPacketsPerCycle,
+										   unsigned int tsPacketQueueSizeInPackets = kTSPacketQueueSizeInPackets,
+										   unsigned int packetsPerPull = kMPEG2MultiStreamTransmitterDefaultPacketsPerPull);
+
+// Destroy a MPEG2MultiStreamTransmitter object created with CreateMPEG2MultiStreamTransmitter(), all of its streams, and it's thread
+IOReturn DestroyMPEG2MultiStreamTransmitter(MPEG2MultiStreamTransmitter *pMultiStreamTransmitter);
+
+// Create and setup a MPEG2MultiChannelReceiver object and the one real-time thread shared by all of its channels
+IOReturn CreateMPEG2MultiChannelReceiver(MPEG2MultiChannelReceiver **ppMultiChannelReceiver,
+										 MPEG2MultiChannelDataPushProc dataPushProcHandler,
+										 void *pDataPushProcRefCon = nil,
+										 MPEG2MultiChannelMessageProc messageProcHandler = nil,
+										 void *pMessageProcRefCon = nil,
+										 StringLogger *stringLogger = nil,
+										 IOFireWireLibNubRef nubInterface = nil,
+										 unsigned int cyclesPerSegment = kCyclesPerReceiveSegment,
+										 unsigned int numSegments = kNumReceiveSegments,
+										 bool doIRMAllocations = false,
+										 unsigned int maxPacketsPerCycle = kMaxNumReceivePacketsPerCycle,
+										 unsigned int maxChannels = kMPEG2MultiChannelReceiverDefaultMaxChannels);
+
+// Destroy a MPEG2MultiChannelReceiver object created with CreateMPEG2MultiChannelReceiver(), all of its channels, and it's thread
+IOReturn DestroyMPEG2MultiChannelReceiver(MPEG2MultiChannelReceiver *pMultiChannelReceiver);
+
 } // namespace AVS
 
 #endif // __AVCVIDEOSERVICES_FIREWIREMPEG__
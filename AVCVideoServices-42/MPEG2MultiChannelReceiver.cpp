@@ -0,0 +1,556 @@
+/*
+	File:		MPEG2MultiChannelReceiver.cpp
+ 
+ Synopsis: This is the implementation file for the MPEG2MultiChannelReceiver class.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+namespace AVS
+{
+
+// Prototypes for static functions in this file
+static IOReturn MultiChannelSpanDataPush_Helper(UInt32 packetCount, MPEGReceivePacketDescriptor *pPackets, void *pRefCon);
+static void MultiChannelMessage_Helper(UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon);
+static void MultiChannelFreeChannel_Helper(void *pRefCon);
+
+//////////////////////////////////////////////////////
+// Constructor
+//////////////////////////////////////////////////////
+MPEG2MultiChannelReceiver::MPEG2MultiChannelReceiver(StringLogger *stringLogger,
+													 IOFireWireLibNubRef nubInterface,
+													 unsigned int cyclesPerSegment,
+													 unsigned int numSegments,
+													 bool doIRMAllocations,
+													 unsigned int maxPacketsPerCycle,
+													 unsigned int maxChannels)
+{
+	UInt32 i;
+
+	nodeNubInterface = nubInterface;
+	isochCyclesPerSegment = cyclesPerSegment;
+	isochSegments = numSegments;
+	doIRM = doIRMAllocations;
+	receivePacketsPerCycle = maxPacketsPerCycle;
+	runLoopRef = nil;
+	numChannels = 0;
+	dataPush = nil;
+	pDataPushRefCon = nil;
+	messageProc = nil;
+	pMessageProcRefCon = nil;
+
+	pBufferArena = nil;
+	bufferArenaSize = 0;
+	arenaSlotSize = 0;
+	if (maxChannels == 0)
+		maxArenaChannels = 1;
+	else if (maxChannels > kMPEG2MultiChannelReceiverNumIsochChannels)
+		maxArenaChannels = kMPEG2MultiChannelReceiverNumIsochChannels;
+	else
+		maxArenaChannels = maxChannels;
+
+	for (i=0;i<kMPEG2MultiChannelReceiverNumIsochChannels;i++)
+	{
+		pChannels[i] = nil;
+		arenaSlotInUse[i] = false;
+	}
+
+	if (stringLogger == nil)
+	{
+		logger = new StringLogger(nil);	// Throws away all log strings
+		noLogger = true;
+	}
+	else
+	{
+		logger = stringLogger;
+		noLogger = false;
+	}
+
+	// Initialize the channels mutex
+	pthread_mutex_init(&channelsMutex,NULL);
+}
+
+//////////////////////////////////////////////////////
+// Destructor
+//////////////////////////////////////////////////////
+MPEG2MultiChannelReceiver::~MPEG2MultiChannelReceiver()
+{
+	UInt32 i;
+	MPEG2MultiChannelReceiverChannel *pChannel;
+
+	// Stop and delete all the channels
+	for (i=0;i<kMPEG2MultiChannelReceiverNumIsochChannels;i++)
+	{
+		pthread_mutex_lock(&channelsMutex);
+		pChannel = pChannels[i];
+		pChannels[i] = nil;
+		pthread_mutex_unlock(&channelsMutex);
+
+		if (pChannel != nil)
+			deleteChannel(pChannel);
+	}
+	numChannels = 0;
+
+	// All the receivers are gone, so nobody is using the buffer arena
+	if (pBufferArena != nil)
+		vm_deallocate(mach_task_self(), (vm_address_t) pBufferArena, bufferArenaSize);
+
+	// If we created an internal logger, free it
+	if (noLogger == true)
+		delete logger;
+
+	// Release the channels mutex
+	pthread_mutex_destroy(&channelsMutex);
+}
+
+//////////////////////////////////////////////////////
+// setupMultiChannelReceiver
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::setupMultiChannelReceiver(void)
+{
+	// Install our command source, which also keeps the
+	// run loop from exiting when there are no channels installed.
+	if (commandSource.install() != kIOReturnSuccess)
+	{
+		logger->log("\nMPEG2MultiChannelReceiver Error: Error creating run loop source\n\n");
+		return kIOReturnError;
+	}
+
+	// Save a reference to the current run loop. All channels
+	// will have their callbacks dispatched on this run loop.
+	runLoopRef = CFRunLoopGetCurrent();
+
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// registerDataPushCallback
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::registerDataPushCallback(MPEG2MultiChannelDataPushProc handler, void *pRefCon)
+{
+	pDataPushRefCon = pRefCon;
+	dataPush = handler;
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// registerMessageCallback
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::registerMessageCallback(MPEG2MultiChannelMessageProc handler, void *pRefCon)
+{
+	pMessageProcRefCon = pRefCon;
+	messageProc = handler;
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// allocateBufferArena
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::allocateBufferArena(unsigned int slotSize)
+{
+	UInt8 *pBuffer = nil;
+
+	// Keep every receiver's DCL buffers page-aligned
+	arenaSlotSize = (slotSize + (vm_page_size-1)) & ~(vm_page_size-1);
+	bufferArenaSize = arenaSlotSize*maxArenaChannels;
+
+	vm_allocate(mach_task_self(), (vm_address_t *)&pBuffer, bufferArenaSize, VM_FLAGS_ANYWHERE);
+	if (!pBuffer)
+	{
+		logger->log("\nMPEG2MultiChannelReceiver Error: Error allocating buffer arena.\n\n");
+		arenaSlotSize = 0;
+		bufferArenaSize = 0;
+		return kIOReturnNoMemory;
+	}
+
+	pBufferArena = pBuffer;
+
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// addChannel
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::addChannel(unsigned int chan, IOFWSpeed speed)
+{
+	IOReturn result = kIOReturnSuccess;
+	MPEG2MultiChannelReceiverChannel *pChannel;
+	UInt32 slot;
+
+	if (chan >= kMPEG2MultiChannelReceiverNumIsochChannels)
+		return kIOReturnBadArgument;
+
+	// Make sure we've been setup
+	if (runLoopRef == nil)
+		return kIOReturnNotReady;
+
+	pthread_mutex_lock(&channelsMutex);
+
+	if (pChannels[chan] != nil)
+	{
+		pthread_mutex_unlock(&channelsMutex);
+		return kIOReturnExclusiveAccess;
+	}
+
+	// Find a free slot in the buffer arena
+	for (slot=0;slot<maxArenaChannels;slot++)
+		if (arenaSlotInUse[slot] == false)
+			break;
+
+	if (slot == maxArenaChannels)
+	{
+		pthread_mutex_unlock(&channelsMutex);
+		logger->log("\nMPEG2MultiChannelReceiver Error: No free buffer arena slots\n\n");
+		return kIOReturnNoResources;
+	}
+
+	pChannel = new MPEG2MultiChannelReceiverChannel;
+	if (!pChannel)
+	{
+		pthread_mutex_unlock(&channelsMutex);
+		return kIOReturnNoMemory;
+	}
+
+	bzero(pChannel,sizeof(MPEG2MultiChannelReceiverChannel));
+	pChannel->pMultiChannelReceiver = this;
+	pChannel->channel = chan;
+	pChannel->arenaSlot = slot;
+
+	// Create the channel's receiver
+	pChannel->pReceiver = new MPEG2Receiver(logger,
+											nodeNubInterface,
+											isochCyclesPerSegment,
+											isochSegments,
+											doIRM,
+											receivePacketsPerCycle);
+	if (!pChannel->pReceiver)
+		result = kIOReturnNoMemory;
+
+	// Every receiver has the same DCL buffer size, so the arena
+	// can be sized from the first one we create
+	if ((result == kIOReturnSuccess) && (pBufferArena == nil))
+		result = allocateBufferArena(pChannel->pReceiver->getDCLBufferSize());
+
+	if ((result == kIOReturnSuccess) && (pChannel->pReceiver->getDCLBufferSize() > arenaSlotSize))
+		result = kIOReturnNoSpace;
+
+	// Setup the receiver on our shared run loop, with its DCL buffers in its arena slot
+	if (result == kIOReturnSuccess)
+		result = pChannel->pReceiver->setupIsocReceiver(runLoopRef, &pBufferArena[slot*arenaSlotSize]);
+
+	if (result == kIOReturnSuccess)
+	{
+		pChannel->pReceiver->registerSpanDataPushCallback(MultiChannelSpanDataPush_Helper,pChannel);
+		pChannel->pReceiver->registerMessageCallback(MultiChannelMessage_Helper,pChannel);
+		pChannel->pReceiver->setReceiveIsochChannel(chan);
+		pChannel->pReceiver->setReceiveIsochSpeed(speed);
+
+		arenaSlotInUse[slot] = true;
+		pChannels[chan] = pChannel;
+		numChannels += 1;
+	}
+
+	pthread_mutex_unlock(&channelsMutex);
+
+	if (result != kIOReturnSuccess)
+	{
+		logger->log("\nMPEG2MultiChannelReceiver Error: Error creating receiver for channel %u: 0x%08X\n\n",chan,result);
+		deleteChannel(pChannel);
+	}
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// removeChannel
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::removeChannel(unsigned int chan)
+{
+	MPEG2MultiChannelReceiverChannel *pChannel;
+	UInt32 slot;
+
+	if (chan >= kMPEG2MultiChannelReceiverNumIsochChannels)
+		return kIOReturnBadArgument;
+
+	pthread_mutex_lock(&channelsMutex);
+
+	pChannel = pChannels[chan];
+	if (pChannel == nil)
+	{
+		pthread_mutex_unlock(&channelsMutex);
+		return kIOReturnBadArgument;
+	}
+
+	pChannels[chan] = nil;
+	numChannels -= 1;
+	slot = pChannel->arenaSlot;
+
+	pthread_mutex_unlock(&channelsMutex);
+
+	// The channel is out of the table, so no other client call can reach it
+	deleteChannel(pChannel);
+
+	// The receiver is gone, so nothing is using its DCL buffers any more,
+	// and its arena slot can be handed out again
+	pthread_mutex_lock(&channelsMutex);
+	arenaSlotInUse[slot] = false;
+	pthread_mutex_unlock(&channelsMutex);
+
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// deleteChannel
+//////////////////////////////////////////////////////
+void MPEG2MultiChannelReceiver::deleteChannel(MPEG2MultiChannelReceiverChannel *pChannel)
+{
+	// Stop the channel's DCL program first. This waits for the receiver's
+	// finalize callback, which comes on the shared run loop, so it can't
+	// be done on the shared run loop's thread.
+	if ((pChannel->pReceiver) && (pChannel->pReceiver->transportState != kMpeg2ReceiverTransportStopped))
+		pChannel->pReceiver->stopReceive();
+
+	// The channel's data push and message callbacks are only called on the
+	// shared run loop's thread, so free the channel there, where none of
+	// them can be running.
+	commandSource.performCommand(MultiChannelFreeChannel_Helper,pChannel);
+}
+
+//////////////////////////////////////////////////////
+// startChannel
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::startChannel(unsigned int chan)
+{
+	IOReturn result;
+
+	if (chan >= kMPEG2MultiChannelReceiverNumIsochChannels)
+		return kIOReturnBadArgument;
+
+	pthread_mutex_lock(&channelsMutex);
+
+	if (pChannels[chan] == nil)
+		result = kIOReturnBadArgument;
+	else
+		result = pChannels[chan]->pReceiver->startReceive();
+
+	pthread_mutex_unlock(&channelsMutex);
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// stopChannel
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::stopChannel(unsigned int chan)
+{
+	IOReturn result;
+
+	if (chan >= kMPEG2MultiChannelReceiverNumIsochChannels)
+		return kIOReturnBadArgument;
+
+	pthread_mutex_lock(&channelsMutex);
+
+	if (pChannels[chan] == nil)
+		result = kIOReturnBadArgument;
+	else
+		result = pChannels[chan]->pReceiver->stopReceive();
+
+	pthread_mutex_unlock(&channelsMutex);
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// startAllChannels
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::startAllChannels(void)
+{
+	IOReturn result = kIOReturnSuccess;
+	IOReturn channelResult;
+	UInt32 i;
+
+	pthread_mutex_lock(&channelsMutex);
+
+	for (i=0;i<kMPEG2MultiChannelReceiverNumIsochChannels;i++)
+	{
+		if ((pChannels[i] != nil) && (pChannels[i]->pReceiver->transportState == kMpeg2ReceiverTransportStopped))
+		{
+			channelResult = pChannels[i]->pReceiver->startReceive();
+			if (channelResult != kIOReturnSuccess)
+			{
+				logger->log("\nMPEG2MultiChannelReceiver Error: Error starting channel %u: 0x%08X\n\n",(unsigned int) i,channelResult);
+				result = channelResult;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&channelsMutex);
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// stopAllChannels
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::stopAllChannels(void)
+{
+	UInt32 i;
+
+	pthread_mutex_lock(&channelsMutex);
+
+	for (i=0;i<kMPEG2MultiChannelReceiverNumIsochChannels;i++)
+		if ((pChannels[i] != nil) && (pChannels[i]->pReceiver->transportState != kMpeg2ReceiverTransportStopped))
+			pChannels[i]->pReceiver->stopReceive();
+
+	pthread_mutex_unlock(&channelsMutex);
+
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// getChannelReceiver
+//////////////////////////////////////////////////////
+MPEG2Receiver *MPEG2MultiChannelReceiver::getChannelReceiver(unsigned int chan)
+{
+	MPEG2Receiver *pReceiver = nil;
+
+	if (chan >= kMPEG2MultiChannelReceiverNumIsochChannels)
+		return nil;
+
+	pthread_mutex_lock(&channelsMutex);
+	if (pChannels[chan] != nil)
+		pReceiver = pChannels[chan]->pReceiver;
+	pthread_mutex_unlock(&channelsMutex);
+
+	return pReceiver;
+}
+
+//////////////////////////////////////////////////////
+// getChannelStats
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::getChannelStats(unsigned int chan, MPEG2ReceiverStats *pStats)
+{
+	IOReturn result;
+
+	if ((chan >= kMPEG2MultiChannelReceiverNumIsochChannels) || (pStats == nil))
+		return kIOReturnBadArgument;
+
+	pthread_mutex_lock(&channelsMutex);
+
+	if (pChannels[chan] == nil)
+		result = kIOReturnBadArgument;
+	else
+		result = pChannels[chan]->pReceiver->getStats(pStats);
+
+	pthread_mutex_unlock(&channelsMutex);
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// getNumChannels
+//////////////////////////////////////////////////////
+UInt32 MPEG2MultiChannelReceiver::getNumChannels(void)
+{
+	UInt32 channels;
+
+	pthread_mutex_lock(&channelsMutex);
+	channels = numChannels;
+	pthread_mutex_unlock(&channelsMutex);
+
+	return channels;
+}
+
+//////////////////////////////////////////////////////
+// ChannelDataPush
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiChannelReceiver::ChannelDataPush(MPEG2MultiChannelReceiverChannel *pChannel, UInt32 packetCount, MPEGReceivePacketDescriptor *pPackets)
+{
+	if (dataPush != nil)
+		return dataPush(pChannel->channel,packetCount,pPackets,pDataPushRefCon);
+	else
+		return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// ChannelMessage
+//////////////////////////////////////////////////////
+void MPEG2MultiChannelReceiver::ChannelMessage(MPEG2MultiChannelReceiverChannel *pChannel, UInt32 msg, UInt32 param1, UInt32 param2)
+{
+	if (messageProc != nil)
+		messageProc(pChannel->channel,msg,param1,param2,pMessageProcRefCon);
+}
+
+//////////////////////////////////////////////////////////////////////
+// MultiChannelSpanDataPush_Helper
+//////////////////////////////////////////////////////////////////////
+static IOReturn MultiChannelSpanDataPush_Helper(UInt32 packetCount, MPEGReceivePacketDescriptor *pPackets, void *pRefCon)
+{
+	MPEG2MultiChannelReceiverChannel *pChannel = (MPEG2MultiChannelReceiverChannel*) pRefCon;
+	return pChannel->pMultiChannelReceiver->ChannelDataPush(pChannel,packetCount,pPackets);
+}
+
+//////////////////////////////////////////////////////////////////////
+// MultiChannelMessage_Helper
+//////////////////////////////////////////////////////////////////////
+static void MultiChannelMessage_Helper(UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon)
+{
+	MPEG2MultiChannelReceiverChannel *pChannel = (MPEG2MultiChannelReceiverChannel*) pRefCon;
+	pChannel->pMultiChannelReceiver->ChannelMessage(pChannel,msg,param1,param2);
+}
+
+//////////////////////////////////////////////////////////////////////
+// MultiChannelFreeChannel_Helper
+//////////////////////////////////////////////////////////////////////
+static void MultiChannelFreeChannel_Helper(void *pRefCon)
+{
+	MPEG2MultiChannelReceiverChannel *pChannel = (MPEG2MultiChannelReceiverChannel*) pRefCon;
+
+	// Deleting the receiver removes its callback dispatchers from the shared run loop
+	if (pChannel->pReceiver)
+		delete pChannel->pReceiver;
+
+	delete pChannel;
+}
+
+} // namespace AVS
@@ -0,0 +1,194 @@
+/*
+	File:		MPEG2MultiChannelReceiver.h
+ 
+ Synopsis: This is the header file for the MPEG2MultiChannelReceiver class.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_MPEG2MULTICHANNELRECEIVER__
+#define __AVCVIDEOSERVICES_MPEG2MULTICHANNELRECEIVER__
+
+namespace AVS
+{
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  MPEG2MultiChannelReceiver: Receives MPEG2 transport streams from many isoch
+//  channels at once, on a single real-time thread.
+//
+//  Each channel is captured by an MPEG2Receiver with its own DCL program, but all
+//  of the receivers share one run loop, so thread count stays at one no matter how
+//  many channels are being captured. The DCL buffers for all of the channels are
+//  carved out of one buffer arena, which is allocated (for maxChannels channels)
+//  when the first channel is added, and reused as channels come and go.
+//
+//  Received packets are delivered to a single data push callback once per DCL
+//  program segment per channel, as a batch of packet descriptors tagged with the
+//  isoch channel they were received on.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+enum
+{
+	// The number of isoch channels on the bus, including the broadcast channel
+	kMPEG2MultiChannelReceiverNumIsochChannels = 64,
+
+	// The default number of channels the buffer arena is sized for
+	kMPEG2MultiChannelReceiverDefaultMaxChannels = 8
+};
+
+// Function prototype for multi-channel data push callback.
+// Notes: Called once per DCL program segment for each channel that received
+// packets in that segment. The packet buffers are only valid until the
+// callback returns.
+typedef IOReturn (*MPEG2MultiChannelDataPushProc) (UInt32 channel,
+												   UInt32 packetCount,
+												   MPEGReceivePacketDescriptor *pPackets,
+												   void *pRefCon);
+
+// Function prototype for multi-channel message callback.
+typedef void (*MPEG2MultiChannelMessageProc) (UInt32 channel, UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon);
+
+class MPEG2MultiChannelReceiver;
+
+// The object we keep for each captured channel
+struct MPEG2MultiChannelReceiverChannel
+{
+	MPEG2MultiChannelReceiver *pMultiChannelReceiver;
+	MPEG2Receiver *pReceiver;
+	UInt32 channel;
+	UInt32 arenaSlot;
+};
+
+//
+// The MPEG2 Multi-Channel Receiver Class Declaration
+//
+class MPEG2MultiChannelReceiver
+{
+public:
+
+	// Constructor
+	MPEG2MultiChannelReceiver(StringLogger *stringLogger = nil,
+							  IOFireWireLibNubRef nubInterface = nil,
+							  unsigned int cyclesPerSegment = kCyclesPerReceiveSegment,
+							  unsigned int numSegments = kNumReceiveSegments,
+							  bool doIRMAllocations = false,
+							  unsigned int maxPacketsPerCycle = kMaxNumReceivePacketsPerCycle,
+							  unsigned int maxChannels = kMPEG2MultiChannelReceiverDefaultMaxChannels);
+
+	// Destructor
+	~MPEG2MultiChannelReceiver();
+
+	// Function to setup the shared run loop. Must be called on the
+	// thread that will service callbacks for all the channels.
+	IOReturn setupMultiChannelReceiver(void);
+
+	// Install the handlers for received data and receiver messages, for all channels
+	IOReturn registerDataPushCallback(MPEG2MultiChannelDataPushProc handler, void *pRefCon);
+	IOReturn registerMessageCallback(MPEG2MultiChannelMessageProc handler, void *pRefCon);
+
+	// Add/remove a channel. A removed channel is stopped first, so removeChannel
+	// must not be called from a channel callback.
+	IOReturn addChannel(unsigned int chan, IOFWSpeed speed = kFWSpeed100MBit);
+	IOReturn removeChannel(unsigned int chan);
+
+	// Start/Stop routines
+	IOReturn startChannel(unsigned int chan);
+	IOReturn stopChannel(unsigned int chan);
+	IOReturn startAllChannels(void);
+	IOReturn stopAllChannels(void);
+
+	// Access to a channel's MPEG2Receiver object, for no-data notification, etc.
+	MPEG2Receiver *getChannelReceiver(unsigned int chan);
+
+	// Get a snapshot of a channel's receive stream analysis stats
+	IOReturn getChannelStats(unsigned int chan, MPEG2ReceiverStats *pStats);
+
+	// Get the number of currently captured channels
+	UInt32 getNumChannels(void);
+
+	// A reference to the shared run loop for isoch callbacks
+	CFRunLoopRef runLoopRef;
+
+	// Callbacks from channel receivers
+	IOReturn ChannelDataPush(MPEG2MultiChannelReceiverChannel *pChannel, UInt32 packetCount, MPEGReceivePacketDescriptor *pPackets);
+	void ChannelMessage(MPEG2MultiChannelReceiverChannel *pChannel, UInt32 msg, UInt32 param1, UInt32 param2);
+
+private:
+
+	IOReturn allocateBufferArena(unsigned int slotSize);
+	void deleteChannel(MPEG2MultiChannelReceiverChannel *pChannel);
+
+	MPEG2MultiChannelReceiverChannel *pChannels[kMPEG2MultiChannelReceiverNumIsochChannels];
+	UInt32 numChannels;
+	pthread_mutex_t channelsMutex;
+
+	// One vm allocation holding the DCL buffers for up to
+	// maxArenaChannels receivers, one page-aligned slot each
+	UInt8 *pBufferArena;
+	unsigned int bufferArenaSize;
+	unsigned int arenaSlotSize;
+	unsigned int maxArenaChannels;
+	bool arenaSlotInUse[kMPEG2MultiChannelReceiverNumIsochChannels];
+
+	// Keeps the shared run loop running when no channels are present,
+	// and frees removed channels on the shared run loop's thread
+	RunLoopCommandSource commandSource;
+
+	MPEG2MultiChannelDataPushProc dataPush;
+	void *pDataPushRefCon;
+	MPEG2MultiChannelMessageProc messageProc;
+	void *pMessageProcRefCon;
+
+	IOFireWireLibNubRef nodeNubInterface;
+	unsigned int isochCyclesPerSegment;
+	unsigned int isochSegments;
+	bool doIRM;
+	unsigned int receivePacketsPerCycle;
+
+	bool noLogger;
+	StringLogger *logger;
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_MPEG2MULTICHANNELRECEIVER__
@@ -0,0 +1,644 @@
+/*
+	File:		MPEG2MultiStreamTransmitter.cpp
+ 
+ Synopsis: This is the implementation file for the MPEG2MultiStreamTransmitter class.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+namespace AVS
+{
+
+// Prototypes for static functions in this file
+static IOReturn MultiStreamDataPull_Helper(UInt32 **ppBuf, bool *pDiscontinuityFlag, void *pRefCon);
+static void MultiStreamMessage_Helper(UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon);
+static void MultiStreamFreeStream_Helper(void *pRefCon);
+
+//////////////////////////////////////////////////////
+// Constructor
+//////////////////////////////////////////////////////
+MPEG2MultiStreamTransmitter::MPEG2MultiStreamTransmitter(StringLogger *stringLogger,
+														 IOFireWireLibNubRef nubInterface,
+														 unsigned int cyclesPerSegment,
+														 unsigned int numSegments,
+														 bool doIRMAllocations,
+														 unsigned int packetsPerCycle,
+														 unsigned int tsPacketQueueSizeInPackets,
+														 unsigned int packetsPerPull)
+{
+	UInt32 i;
+
+	nodeNubInterface = nubInterface;
+	isochCyclesPerSegment = cyclesPerSegment;
+	isochSegments = numSegments;
+	doIRM = doIRMAllocations;
+	tsPacketsPerCycle = packetsPerCycle;
+	numTSPacketsInPacketQueue = tsPacketQueueSizeInPackets;
+	batchPacketsPerPull = (packetsPerPull > 0) ? packetsPerPull : 1;
+	runLoopRef = nil;
+	numStreams = 0;
+
+	for (i=0;i<kMPEG2MultiStreamTransmitterMaxStreams;i++)
+		pStreams[i] = nil;
+
+	if (stringLogger == nil)
+	{
+		logger = new StringLogger(nil);	// Throws away all log strings
+		noLogger = true;
+	}
+	else
+	{
+		logger = stringLogger;
+		noLogger = false;
+	}
+
+	// Initialize the streams mutex
+	pthread_mutex_init(&streamsMutex,NULL);
+}
+
+//////////////////////////////////////////////////////
+// Destructor
+//////////////////////////////////////////////////////
+MPEG2MultiStreamTransmitter::~MPEG2MultiStreamTransmitter()
+{
+	UInt32 i;
+	MPEG2MultiStreamTransmitterStream *pStream;
+
+	// Stop and delete all the streams
+	for (i=0;i<kMPEG2MultiStreamTransmitterMaxStreams;i++)
+	{
+		pthread_mutex_lock(&streamsMutex);
+		pStream = pStreams[i];
+		pStreams[i] = nil;
+		pthread_mutex_unlock(&streamsMutex);
+
+		if (pStream != nil)
+			deleteStream(pStream);
+	}
+	numStreams = 0;
+
+	// If we created an internal logger, free it
+	if (noLogger == true)
+		delete logger;
+
+	// Release the streams mutex
+	pthread_mutex_destroy(&streamsMutex);
+}
+
+//////////////////////////////////////////////////////
+// setupMultiStreamTransmitter
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::setupMultiStreamTransmitter(void)
+{
+	// Install our command source, which also keeps the
+	// run loop from exiting when there are no streams installed.
+	if (commandSource.install() != kIOReturnSuccess)
+	{
+		logger->log("\nMPEG2MultiStreamTransmitter Error: Error creating run loop source\n\n");
+		return kIOReturnError;
+	}
+
+	// Save a reference to the current run loop. All streams
+	// will have their callbacks dispatched on this run loop.
+	runLoopRef = CFRunLoopGetCurrent();
+
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// addStream
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::addStream(UInt32 *pStreamIndex,
+												unsigned int chan,
+												IOFWSpeed speed,
+												DataPullProc dataPullProcHandler,
+												void *pDataPullProcRefCon,
+												MPEG2TransmitterMessageProc messageProcHandler,
+												void *pMessageProcRefCon)
+{
+	return addStreamInternal(pStreamIndex,
+							 chan,
+							 speed,
+							 dataPullProcHandler,
+							 pDataPullProcRefCon,
+							 nil,
+							 nil,
+							 messageProcHandler,
+							 pMessageProcRefCon);
+}
+
+//////////////////////////////////////////////////////
+// addBatchStream
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::addBatchStream(UInt32 *pStreamIndex,
+													 unsigned int chan,
+													 IOFWSpeed speed,
+													 MPEG2MultiStreamBatchDataPullProc batchDataPullProcHandler,
+													 void *pBatchDataPullProcRefCon,
+													 MPEG2TransmitterMessageProc messageProcHandler,
+													 void *pMessageProcRefCon)
+{
+	return addStreamInternal(pStreamIndex,
+							 chan,
+							 speed,
+							 nil,
+							 nil,
+							 batchDataPullProcHandler,
+							 pBatchDataPullProcRefCon,
+							 messageProcHandler,
+							 pMessageProcRefCon);
+}
+
+//////////////////////////////////////////////////////
+// addStreamInternal
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::addStreamInternal(UInt32 *pStreamIndex,
+														unsigned int chan,
+														IOFWSpeed speed,
+														DataPullProc dataPullProcHandler,
+														void *pDataPullProcRefCon,
+														MPEG2MultiStreamBatchDataPullProc batchDataPullProcHandler,
+														void *pBatchDataPullProcRefCon,
+														MPEG2TransmitterMessageProc messageProcHandler,
+														void *pMessageProcRefCon)
+{
+	IOReturn result = kIOReturnSuccess;
+	MPEG2MultiStreamTransmitterStream *pStream;
+	UInt32 streamIndex;
+
+	// Make sure we've been setup
+	if (runLoopRef == nil)
+		return kIOReturnNotReady;
+
+	pthread_mutex_lock(&streamsMutex);
+
+	// Find a free stream slot
+	for (streamIndex=0;streamIndex<kMPEG2MultiStreamTransmitterMaxStreams;streamIndex++)
+		if (pStreams[streamIndex] == nil)
+			break;
+
+	if (streamIndex == kMPEG2MultiStreamTransmitterMaxStreams)
+	{
+		pthread_mutex_unlock(&streamsMutex);
+		logger->log("\nMPEG2MultiStreamTransmitter Error: No free stream slots\n\n");
+		return kIOReturnNoResources;
+	}
+
+	pStream = new MPEG2MultiStreamTransmitterStream;
+	if (!pStream)
+	{
+		pthread_mutex_unlock(&streamsMutex);
+		return kIOReturnNoMemory;
+	}
+
+	bzero(pStream,sizeof(MPEG2MultiStreamTransmitterStream));
+	pStream->pMultiStreamTransmitter = this;
+	pStream->streamIndex = streamIndex;
+	pStream->packetFetch = dataPullProcHandler;
+	pStream->pPacketFetchRefCon = pDataPullProcRefCon;
+	pStream->batchPacketFetch = batchDataPullProcHandler;
+	pStream->pBatchPacketFetchRefCon = pBatchDataPullProcRefCon;
+	pStream->messageProc = messageProcHandler;
+	pStream->pMessageProcRefCon = pMessageProcRefCon;
+	pStream->stats.isochChannel = chan;
+	pStream->stats.transportState = kMpeg2TransmitterTransportStopped;
+
+	// Allocate the array of packet pointers for batched pulls.
+	// This is done up-front, so nothing is allocated while streaming.
+	if (batchDataPullProcHandler != nil)
+	{
+		pStream->ppBatchBufs = new UInt32*[batchPacketsPerPull];
+		if (!pStream->ppBatchBufs)
+			result = kIOReturnNoMemory;
+	}
+
+	// Create the stream's transmitter
+	if (result == kIOReturnSuccess)
+	{
+		pStream->pTransmitter = new MPEG2Transmitter(logger,
+													 nodeNubInterface,
+													 isochCyclesPerSegment,
+													 isochSegments,
+													 doIRM,
+													 tsPacketsPerCycle,
+													 numTSPacketsInPacketQueue);
+		if (!pStream->pTransmitter)
+			result = kIOReturnNoMemory;
+	}
+
+	// Setup the transmitter on our shared run loop
+	if (result == kIOReturnSuccess)
+		result = pStream->pTransmitter->setupIsocTransmitter(runLoopRef);
+
+	if (result == kIOReturnSuccess)
+	{
+		pStream->pTransmitter->registerDataPullCallback(MultiStreamDataPull_Helper,pStream);
+		pStream->pTransmitter->registerMessageCallback(MultiStreamMessage_Helper,pStream);
+		pStream->pTransmitter->setTransmitIsochChannel(chan);
+		pStream->pTransmitter->setTransmitIsochSpeed(speed);
+
+		pStreams[streamIndex] = pStream;
+		numStreams += 1;
+		*pStreamIndex = streamIndex;
+	}
+
+	pthread_mutex_unlock(&streamsMutex);
+
+	if (result != kIOReturnSuccess)
+	{
+		logger->log("\nMPEG2MultiStreamTransmitter Error: Error creating stream transmitter: 0x%08X\n\n",result);
+		deleteStream(pStream);
+	}
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// removeStream
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::removeStream(UInt32 streamIndex)
+{
+	MPEG2MultiStreamTransmitterStream *pStream;
+
+	if (streamIndex >= kMPEG2MultiStreamTransmitterMaxStreams)
+		return kIOReturnBadArgument;
+
+	// Stopping the stream waits for its finalize callback, which only comes on the
+	// shared run loop, and freeing it there would free it under the stream callback
+	// that called us. So a stream can't be removed from the shared run loop's thread.
+	if (CFRunLoopGetCurrent() == runLoopRef)
+		return kIOReturnNotPermitted;
+
+	pthread_mutex_lock(&streamsMutex);
+
+	pStream = pStreams[streamIndex];
+	if (pStream == nil)
+	{
+		pthread_mutex_unlock(&streamsMutex);
+		return kIOReturnBadArgument;
+	}
+
+	pStreams[streamIndex] = nil;
+	numStreams -= 1;
+
+	pthread_mutex_unlock(&streamsMutex);
+
+	// The stream is out of the table, so no other client call can reach it
+	deleteStream(pStream);
+
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// deleteStream
+//////////////////////////////////////////////////////
+void MPEG2MultiStreamTransmitter::deleteStream(MPEG2MultiStreamTransmitterStream *pStream)
+{
+	// Stop the stream's DCL program first. This waits for the transmitter's
+	// finalize callback, which comes on the shared run loop, so it can't
+	// be done on the shared run loop's thread (removeStream checks for that).
+	if ((pStream->pTransmitter) && (pStream->pTransmitter->transportState != kMpeg2TransmitterTransportStopped))
+		pStream->pTransmitter->stopTransmit();
+
+	// The stream's data pull and message callbacks are only called on the
+	// shared run loop's thread, so free the stream there, where none of
+	// them can be running.
+	commandSource.performCommand(MultiStreamFreeStream_Helper,pStream);
+}
+
+//////////////////////////////////////////////////////
+// startStream
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::startStream(UInt32 streamIndex)
+{
+	IOReturn result;
+	MPEG2MultiStreamTransmitterStream *pStream;
+
+	if (streamIndex >= kMPEG2MultiStreamTransmitterMaxStreams)
+		return kIOReturnBadArgument;
+
+	pthread_mutex_lock(&streamsMutex);
+
+	pStream = pStreams[streamIndex];
+	if (pStream == nil)
+		result = kIOReturnBadArgument;
+	else
+		result = pStream->pTransmitter->startTransmit();
+
+	pthread_mutex_unlock(&streamsMutex);
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// stopStream
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::stopStream(UInt32 streamIndex)
+{
+	IOReturn result;
+	MPEG2MultiStreamTransmitterStream *pStream;
+
+	if (streamIndex >= kMPEG2MultiStreamTransmitterMaxStreams)
+		return kIOReturnBadArgument;
+
+	// Stopping waits for a finalize callback on the shared run loop
+	if (CFRunLoopGetCurrent() == runLoopRef)
+		return kIOReturnNotPermitted;
+
+	pthread_mutex_lock(&streamsMutex);
+
+	pStream = pStreams[streamIndex];
+	if (pStream == nil)
+		result = kIOReturnBadArgument;
+	else
+		result = pStream->pTransmitter->stopTransmit();
+
+	pthread_mutex_unlock(&streamsMutex);
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// startAllStreams
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::startAllStreams(void)
+{
+	IOReturn result = kIOReturnSuccess;
+	IOReturn streamResult;
+	UInt32 i;
+
+	pthread_mutex_lock(&streamsMutex);
+
+	// Start all the streams back-to-back. Since every transmit DCL
+	// program waits for a cycle-count of zero before starting, streams
+	// started here will all be segment-aligned with each other.
+	for (i=0;i<kMPEG2MultiStreamTransmitterMaxStreams;i++)
+	{
+		if ((pStreams[i] != nil) && (pStreams[i]->pTransmitter->transportState == kMpeg2TransmitterTransportStopped))
+		{
+			streamResult = pStreams[i]->pTransmitter->startTransmit();
+			if (streamResult != kIOReturnSuccess)
+			{
+				logger->log("\nMPEG2MultiStreamTransmitter Error: Error starting stream %u: 0x%08X\n\n",(unsigned int) i,streamResult);
+				result = streamResult;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&streamsMutex);
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// stopAllStreams
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::stopAllStreams(void)
+{
+	UInt32 i;
+
+	// Stopping waits for a finalize callback on the shared run loop
+	if (CFRunLoopGetCurrent() == runLoopRef)
+		return kIOReturnNotPermitted;
+
+	pthread_mutex_lock(&streamsMutex);
+
+	for (i=0;i<kMPEG2MultiStreamTransmitterMaxStreams;i++)
+		if ((pStreams[i] != nil) && (pStreams[i]->pTransmitter->transportState != kMpeg2TransmitterTransportStopped))
+			pStreams[i]->pTransmitter->stopTransmit();
+
+	pthread_mutex_unlock(&streamsMutex);
+
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// getStreamTransmitter
+//////////////////////////////////////////////////////
+MPEG2Transmitter *MPEG2MultiStreamTransmitter::getStreamTransmitter(UInt32 streamIndex)
+{
+	MPEG2Transmitter *pTransmitter = nil;
+
+	if (streamIndex >= kMPEG2MultiStreamTransmitterMaxStreams)
+		return nil;
+
+	pthread_mutex_lock(&streamsMutex);
+	if (pStreams[streamIndex] != nil)
+		pTransmitter = pStreams[streamIndex]->pTransmitter;
+	pthread_mutex_unlock(&streamsMutex);
+
+	return pTransmitter;
+}
+
+//////////////////////////////////////////////////////
+// getStreamStats
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::getStreamStats(UInt32 streamIndex, MPEG2MultiStreamTransmitterStreamStats *pStats)
+{
+	IOReturn result = kIOReturnSuccess;
+	MPEG2MultiStreamTransmitterStream *pStream;
+
+	if ((streamIndex >= kMPEG2MultiStreamTransmitterMaxStreams) || (pStats == nil))
+		return kIOReturnBadArgument;
+
+	pthread_mutex_lock(&streamsMutex);
+
+	pStream = pStreams[streamIndex];
+	if (pStream == nil)
+		result = kIOReturnBadArgument;
+	else
+	{
+		// Note: The counters are only written on the shared run loop thread,
+		// so the worst case here is a snapshot that's one update behind.
+		*pStats = pStream->stats;
+		pStats->mpegDataRate = pStream->pTransmitter->mpegDataRate;
+		pStats->transportState = pStream->pTransmitter->transportState;
+	}
+
+	pthread_mutex_unlock(&streamsMutex);
+
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// getNumStreams
+//////////////////////////////////////////////////////
+UInt32 MPEG2MultiStreamTransmitter::getNumStreams(void)
+{
+	UInt32 streams;
+
+	pthread_mutex_lock(&streamsMutex);
+	streams = numStreams;
+	pthread_mutex_unlock(&streamsMutex);
+
+	return streams;
+}
+
+//////////////////////////////////////////////////////
+// StreamDataPull
+//////////////////////////////////////////////////////
+IOReturn MPEG2MultiStreamTransmitter::StreamDataPull(MPEG2MultiStreamTransmitterStream *pStream, UInt32 **ppBuf, bool *pDiscontinuityFlag)
+{
+	IOReturn result;
+
+	if (pStream->batchPacketFetch != nil)
+	{
+		// If we've used up the last batch, ask the client for another one
+		if (pStream->batchNext >= pStream->batchCount)
+		{
+			pStream->batchCount = 0;
+			pStream->batchNext = 0;
+			pStream->batchDiscontinuity = false;
+
+			result = pStream->batchPacketFetch(pStream->streamIndex,
+											   pStream->ppBatchBufs,
+											   batchPacketsPerPull,
+											   &pStream->batchCount,
+											   &pStream->batchDiscontinuity,
+											   pStream->pBatchPacketFetchRefCon);
+			pStream->stats.batchPulls += 1;
+
+			if ((result != kIOReturnSuccess) || (pStream->batchCount == 0))
+			{
+				pStream->batchCount = 0;
+				pStream->stats.packetFetchErrors += 1;
+				return kIOReturnUnderrun;
+			}
+
+			if (pStream->batchCount > batchPacketsPerPull)
+				pStream->batchCount = batchPacketsPerPull;
+		}
+
+		// Hand the transmitter the next packet from the batch
+		*ppBuf = pStream->ppBatchBufs[pStream->batchNext];
+		*pDiscontinuityFlag = (pStream->batchNext == 0) ? pStream->batchDiscontinuity : false;
+		pStream->batchNext += 1;
+		pStream->stats.tsPacketsPulled += 1;
+
+		return kIOReturnSuccess;
+	}
+	else if (pStream->packetFetch != nil)
+	{
+		result = pStream->packetFetch(ppBuf,pDiscontinuityFlag,pStream->pPacketFetchRefCon);
+		if (result == kIOReturnSuccess)
+			pStream->stats.tsPacketsPulled += 1;
+		else
+			pStream->stats.packetFetchErrors += 1;
+
+		return result;
+	}
+
+	pStream->stats.packetFetchErrors += 1;
+	return kIOReturnUnderrun;
+}
+
+//////////////////////////////////////////////////////
+// StreamMessage
+//////////////////////////////////////////////////////
+void MPEG2MultiStreamTransmitter::StreamMessage(MPEG2MultiStreamTransmitterStream *pStream, UInt32 msg, UInt32 param1, UInt32 param2)
+{
+	switch (msg)
+	{
+		case kMpeg2TransmitterAllocateIsochPort:
+			pStream->stats.isochChannel = param2;
+			break;
+
+		case kMpeg2TransmitterTimeStampAdjust:
+			pStream->stats.timeStampAdjusts += 1;
+			break;
+
+		case kFWAVCStreamDCLOverrunAutoRestartFailed:
+			pStream->stats.overrunRestartFailures += 1;
+			break;
+
+		case kMpeg2TransmitterPreparePacketFetcher:
+			// The transmitter is (re)starting, so any partially consumed batch is stale
+			pStream->batchCount = 0;
+			pStream->batchNext = 0;
+			break;
+
+		default:
+			break;
+	}
+
+	// Pass the message on to the client
+	if (pStream->messageProc != nil)
+		pStream->messageProc(msg,param1,param2,pStream->pMessageProcRefCon);
+}
+
+//////////////////////////////////////////////////////////////////////
+// MultiStreamDataPull_Helper
+//////////////////////////////////////////////////////////////////////
+static IOReturn MultiStreamDataPull_Helper(UInt32 **ppBuf, bool *pDiscontinuityFlag, void *pRefCon)
+{
+	MPEG2MultiStreamTransmitterStream *pStream = (MPEG2MultiStreamTransmitterStream*) pRefCon;
+	return pStream->pMultiStreamTransmitter->StreamDataPull(pStream,ppBuf,pDiscontinuityFlag);
+}
+
+//////////////////////////////////////////////////////////////////////
+// MultiStreamMessage_Helper
+//////////////////////////////////////////////////////////////////////
+static void MultiStreamMessage_Helper(UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon)
+{
+	MPEG2MultiStreamTransmitterStream *pStream = (MPEG2MultiStreamTransmitterStream*) pRefCon;
+	pStream->pMultiStreamTransmitter->StreamMessage(pStream,msg,param1,param2);
+}
+
+//////////////////////////////////////////////////////////////////////
+// MultiStreamFreeStream_Helper
+//////////////////////////////////////////////////////////////////////
+static void MultiStreamFreeStream_Helper(void *pRefCon)
+{
+	MPEG2MultiStreamTransmitterStream *pStream = (MPEG2MultiStreamTransmitterStream*) pRefCon;
+
+	// Deleting the transmitter removes its callback dispatchers from the shared run loop
+	if (pStream->pTransmitter)
+		delete pStream->pTransmitter;
+
+	if (pStream->ppBatchBufs)
+		delete [] pStream->ppBatchBufs;
+
+	delete pStream;
+}
+
+} // namespace AVS
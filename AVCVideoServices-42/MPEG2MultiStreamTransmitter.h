@@ -0,0 +1,245 @@
+/*
+	File:		MPEG2MultiStreamTransmitter.h
+ 
+ Synopsis: This is the header file for the MPEG2MultiStreamTransmitter class.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_MPEG2MULTISTREAMTRANSMITTER__
+#define __AVCVIDEOSERVICES_MPEG2MULTISTREAMTRANSMITTER__
+
+namespace AVS
+{
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  MPEG2MultiStreamTransmitter: Hosts multiple logical MPEG2 transmit streams, each
+//  on its own isoch channel, on a single real-time thread.
+//
+//  Each stream is a full MPEG2Transmitter with its own DCL program, pacing, PSI
+//  state and data pull callback, but all of the streams share one run loop, so
+//  thread count stays at one no matter how many outputs are active.
+//
+//  All MPEG2 transmit DCL programs start on a cycle-count of zero, so streams that
+//  are started together (startAllStreams) end their segments on the same cycle,
+//  and all of their end-of-segment callbacks are serviced in one pass of the
+//  shared run loop.
+//
+//  Streams can be fed with a standard per-packet DataPullProc, or with a batched
+//  pull callback which is asked for many TS packets at once (typically once per
+//  segment, depending on data rate and packetsPerPull).
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+enum
+{
+	// The maximum number of streams one MPEG2MultiStreamTransmitter
+	// can host. One per isoch channel, excluding the broadcast channel.
+	kMPEG2MultiStreamTransmitterMaxStreams = 63,
+
+	// The default max number of TS packets requested
+	// from a batched data pull callback at a time
+	kMPEG2MultiStreamTransmitterDefaultPacketsPerPull = 256
+};
+
+// Function prototype for batched data pull callback.
+// Notes: The registered batch-pull function is called whenever the stream's
+// transmitter needs a TS packet and all previously pulled packets have been
+// consumed. The application should fill in up to maxPackets pointers to
+// 188 byte packets in ppBufs, and return the number of packets provided in
+// pNumPackets. The application should not modify the contents of these buffers
+// after returning from this callback, until either the next callback, or until
+// the stream is stopped. Setting the discontinuity flag applies to the first
+// packet of the batch, the same as for a DataPullProc.
+typedef IOReturn (*MPEG2MultiStreamBatchDataPullProc) (UInt32 streamIndex,
+													   UInt32 **ppBufs,
+													   UInt32 maxPackets,
+													   UInt32 *pNumPackets,
+													   bool *pDiscontinuityFlag,
+													   void *pRefCon);
+
+// Per-stream statistics, returned by getStreamStats
+struct MPEG2MultiStreamTransmitterStreamStats
+{
+	UInt32 tsPacketsPulled;			// TS packets delivered by the client
+	UInt32 packetFetchErrors;		// Pull callbacks that failed (each results in a CIP-only cycle)
+	UInt32 batchPulls;				// Number of calls to the batched data pull callback
+	UInt32 timeStampAdjusts;		// Number of kMpeg2TransmitterTimeStampAdjust messages
+	UInt32 overrunRestartFailures;	// Number of DCL overruns we couldn't restart from
+	UInt32 isochChannel;			// The isoch channel allocated for this stream
+	double mpegDataRate;			// The stream's current data rate
+	unsigned int transportState;	// The stream's current transport state
+};
+
+class MPEG2MultiStreamTransmitter;
+
+// The object we keep for each hosted stream
+struct MPEG2MultiStreamTransmitterStream
+{
+	MPEG2MultiStreamTransmitter *pMultiStreamTransmitter;
+	MPEG2Transmitter *pTransmitter;
+	UInt32 streamIndex;
+
+	DataPullProc packetFetch;
+	void *pPacketFetchRefCon;
+	MPEG2MultiStreamBatchDataPullProc batchPacketFetch;
+	void *pBatchPacketFetchRefCon;
+	MPEG2TransmitterMessageProc messageProc;
+	void *pMessageProcRefCon;
+
+	UInt32 **ppBatchBufs;
+	UInt32 batchCount;
+	UInt32 batchNext;
+	bool batchDiscontinuity;
+
+	MPEG2MultiStreamTransmitterStreamStats stats;
+};
+
+//
+// The MPEG2 Multi-Stream Transmitter Class Declaration
+//
+class MPEG2MultiStreamTransmitter
+{
+public:
+
+	// Constructor
+	MPEG2MultiStreamTransmitter(StringLogger *stringLogger = nil,
+								IOFireWireLibNubRef nubInterface = nil,
+								unsigned int cyclesPerSegment = kCyclesPerTransmitSegment,
+								unsigned int numSegments = kNumTransmitSegments,
+								bool doIRMAllocations = false,
+								unsigned int packetsPerCycle = kNumTSPacketsPerCycle,
+								unsigned int tsPacketQueueSizeInPackets = kTSPacketQueueSizeInPackets,
+								unsigned int packetsPerPull = kMPEG2MultiStreamTransmitterDefaultPacketsPerPull);
+
+	// Destructor
+	~MPEG2MultiStreamTransmitter();
+
+	// Function to setup the shared run loop. Must be called on the
+	// thread that will service callbacks for all the streams.
+	IOReturn setupMultiStreamTransmitter(void);
+
+	// Add a stream fed by a per-packet data pull callback
+	IOReturn addStream(UInt32 *pStreamIndex,
+					   unsigned int chan,
+					   IOFWSpeed speed,
+					   DataPullProc dataPullProcHandler,
+					   void *pDataPullProcRefCon = nil,
+					   MPEG2TransmitterMessageProc messageProcHandler = nil,
+					   void *pMessageProcRefCon = nil);
+
+	// Add a stream fed by a batched data pull callback
+	IOReturn addBatchStream(UInt32 *pStreamIndex,
+							unsigned int chan,
+							IOFWSpeed speed,
+							MPEG2MultiStreamBatchDataPullProc batchDataPullProcHandler,
+							void *pBatchDataPullProcRefCon = nil,
+							MPEG2TransmitterMessageProc messageProcHandler = nil,
+							void *pMessageProcRefCon = nil);
+
+	// Stop and remove a stream. Stopping a stream waits for its DCL program to
+	// finalize on the shared run loop, so removeStream, stopStream and stopAllStreams
+	// return kIOReturnNotPermitted when called on the shared run loop's thread
+	// (from any stream's data pull, batch pull, or message callback).
+	IOReturn removeStream(UInt32 streamIndex);
+
+	// Start/Stop routines
+	IOReturn startStream(UInt32 streamIndex);
+	IOReturn stopStream(UInt32 streamIndex);
+	IOReturn startAllStreams(void);
+	IOReturn stopAllStreams(void);
+
+	// Access to a stream's MPEG2Transmitter object, for
+	// setting playback mode, time-stamp callbacks, etc.
+	// Only valid until the stream is removed.
+	MPEG2Transmitter *getStreamTransmitter(UInt32 streamIndex);
+
+	// Get a snapshot of a stream's statistics
+	IOReturn getStreamStats(UInt32 streamIndex, MPEG2MultiStreamTransmitterStreamStats *pStats);
+
+	// Get the number of currently hosted streams
+	UInt32 getNumStreams(void);
+
+	// A reference to the shared run loop for isoch callbacks
+	CFRunLoopRef runLoopRef;
+
+	// Callbacks from stream transmitters
+	IOReturn StreamDataPull(MPEG2MultiStreamTransmitterStream *pStream, UInt32 **ppBuf, bool *pDiscontinuityFlag);
+	void StreamMessage(MPEG2MultiStreamTransmitterStream *pStream, UInt32 msg, UInt32 param1, UInt32 param2);
+
+private:
+
+	IOReturn addStreamInternal(UInt32 *pStreamIndex,
+							   unsigned int chan,
+							   IOFWSpeed speed,
+							   DataPullProc dataPullProcHandler,
+							   void *pDataPullProcRefCon,
+							   MPEG2MultiStreamBatchDataPullProc batchDataPullProcHandler,
+							   void *pBatchDataPullProcRefCon,
+							   MPEG2TransmitterMessageProc messageProcHandler,
+							   void *pMessageProcRefCon);
+
+	void deleteStream(MPEG2MultiStreamTransmitterStream *pStream);
+
+	MPEG2MultiStreamTransmitterStream *pStreams[kMPEG2MultiStreamTransmitterMaxStreams];
+	UInt32 numStreams;
+	pthread_mutex_t streamsMutex;
+
+	// Keeps the shared run loop running when no streams are present,
+	// and frees removed streams on the shared run loop's thread
+	RunLoopCommandSource commandSource;
+
+	IOFireWireLibNubRef nodeNubInterface;
+	unsigned int isochCyclesPerSegment;
+	unsigned int isochSegments;
+	bool doIRM;
+	unsigned int tsPacketsPerCycle;
+	unsigned int numTSPacketsInPacketQueue;
+	unsigned int batchPacketsPerPull;
+
+	bool noLogger;
+	StringLogger *logger;
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_MPEG2MULTISTREAMTRANSMITTER__
@@ -74,8 +74,6 @@ static void MPEG2ReceiveOverrunDCLCallback_Helper(DCLCommandPtr pDCLCommand);
 
 static IOReturn MPEG2ReceiveFinalizeCallback_Helper( void* refcon ) ;
 
-static UInt32  AddFWCycleTimeToFWCycleTime( UInt32 cycleTime1, UInt32 cycleTime2 );
-
 #ifdef kAVS_Enable_ForceStop_Handler	
 static void	MPEG2ReceiveForceStopHandler_Helper( IOFireWireLibIsochChannelRef interface, UInt32  stopCondition);
 #endif
@@ -89,6 +87,21 @@ static void NoDataTimeoutHelper(CFRunLoopTimerRef timer, void *data)
 	pMPEG2Receiver->NoDataTimeout();
 }
 
+//////////////////////////////////////////////////////
+// StatsHistogramBin
+//////////////////////////////////////////////////////
+static UInt32 StatsHistogramBin(UInt32 value)
+{
+	UInt32 bin = 0;
+	
+	while ((value != 0) && (bin < (kMPEG2ReceiverStatsHistogramBins-1)))
+	{
+		value >>= 1;
+		bin += 1;
+	}
+	return bin;
+}
+
 //////////////////////////////////////////////////////
 // Constructor
 //////////////////////////////////////////////////////
@@ -96,7 +109,8 @@ MPEG2Receiver::MPEG2Receiver(StringLogger *stringLogger,
 							 IOFireWireLibNubRef nubInterface,
 							 unsigned int cyclesPerSegment,
 							 unsigned int numSegments,
-							 bool doIRMAllocations)
+							 bool doIRMAllocations,
+							 unsigned int maxPacketsPerCycle)
 {
     nodeNubInterface = nubInterface;
 	dclCommandPool = nil;
@@ -126,15 +140,33 @@ MPEG2Receiver::MPEG2Receiver(StringLogger *stringLogger,
 	structuredDataPush = nil;
 	maxNumStructuredDataStructsInCallback = 1;
 	pCyclDataStruct = nil;
+
+	cycleSpanDataPush = nil;
+	maxNumCycleSpansInCallback = 1;
+	pCycleSpans = nil;
+	ppCycleSpanPacketPtrs = nil;
+
+	spanDataPush = nil;
+	pPacketDescriptors = nil;
 	
 	messageProc = nil;
 	noDataProc = nil;
 	noDataTimeLimitInSeconds = 0.0;
 	pReceiveBuffer = nil;
+	externalReceiveBuffer = false;
 	transportState = kMpeg2ReceiverTransportStopped;
 	isochCyclesPerSegment = cyclesPerSegment;
 	isochSegments = numSegments;
 	doIRM = doIRMAllocations;
+	
+	// Size the receive buffers for the max number of packets per cycle
+	if (maxPacketsPerCycle == 0)
+		receivePacketsPerCycle = kMaxNumReceivePacketsPerCycle;
+	else if (maxPacketsPerCycle > kMaxNumReceivePacketsPerCycleLimit)
+		receivePacketsPerCycle = kMaxNumReceivePacketsPerCycleLimit;
+	else
+		receivePacketsPerCycle = maxPacketsPerCycle;
+	receiveBufferSize = ((receivePacketsPerCycle*192)+16);
 	receiveSegmentInfo = new MPEGReceiveSegment[isochSegments];
 
 	// Initialize the transport control mutex
@@ -143,11 +175,18 @@ MPEG2Receiver::MPEG2Receiver(StringLogger *stringLogger,
 	// Initialize the no-data timer mutex
 	pthread_mutex_init(&noDataTimerMutex,NULL);
 	
+	// Initialize the receive stream analysis stats
+	clearStats();
+	publishStats();
+	statsResetRequested = false;
+	haveExpectedDBC = false;
+	expectedDBC = 0;
+	
 	// Calculate the size of the DCL command pool needed
 	dclCommandPoolSize = ((((isochCyclesPerSegment)*isochSegments)+(isochSegments*4)+(isochSegments*4)+16)*32);
 
 	// Calculate the size of the VM buffer for the dcl receive packets
-	dclVMBufferSize = (((isochSegments*isochCyclesPerSegment)+1)*kMPEG2ReceiveBufferSize)+(isochSegments*4); // Allocate space for buffers and timestamps
+	dclVMBufferSize = (((isochSegments*isochCyclesPerSegment)+1)*receiveBufferSize)+(isochSegments*4); // Allocate space for buffers and timestamps
 }
 
 //////////////////////////////////////////////////////
@@ -185,7 +224,7 @@ MPEG2Receiver::~MPEG2Receiver()
 		(*dclCommandPool)->Release(dclCommandPool);
 
 	// Free the vm allocated DCL buffer
-	if (pReceiveBuffer != nil)
+	if ((pReceiveBuffer != nil) && (externalReceiveBuffer == false))
 		vm_deallocate(mach_task_self(), (vm_address_t) pReceiveBuffer,dclVMBufferSize);
 
 	// Free the update DCL list
@@ -203,6 +242,16 @@ MPEG2Receiver::~MPEG2Receiver()
 	if (pCyclDataStruct)
 		delete [] pCyclDataStruct;
 	
+	// If we allocated memory for the array of span packet descriptors, free it now
+	if (pPacketDescriptors)
+		delete [] pPacketDescriptors;
+	
+	// If we allocated memory for the cycle-span structs, free it now
+	if (pCycleSpans)
+		delete [] pCycleSpans;
+	if (ppCycleSpanPacketPtrs)
+		delete [] ppCycleSpanPacketPtrs;
+	
 	if (nodeNubInterface != nil)
 		(*nodeNubInterface)->Release(nodeNubInterface);
 
@@ -214,10 +263,18 @@ MPEG2Receiver::~MPEG2Receiver()
 
 }
 
+//////////////////////////////////////////////////////
+// getDCLBufferSize
+//////////////////////////////////////////////////////
+unsigned int MPEG2Receiver::getDCLBufferSize(void)
+{
+	return dclVMBufferSize;
+}
+
 //////////////////////////////////////////////////////
 // setupIsocReceiver
 //////////////////////////////////////////////////////
-IOReturn MPEG2Receiver::setupIsocReceiver(void)
+IOReturn MPEG2Receiver::setupIsocReceiver(CFRunLoopRef isochRunLoopRef, UInt8 *pExternalBuffer)
 {
 	// Local Vars
 	IOReturn result = kIOReturnSuccess ;
@@ -253,8 +310,8 @@ IOReturn MPEG2Receiver::setupIsocReceiver(void)
 		nodeNubInterface = newNubInterface;
 	}
 	
-	// Save a reference to the current run loop
-	runLoopRef = CFRunLoopGetCurrent();
+	// Save a reference to the run loop to use for callbacks
+	runLoopRef = (isochRunLoopRef != nil) ? isochRunLoopRef : CFRunLoopGetCurrent();
 	
 	// Install a asynch callback dispatcher to this thread's run loop
 	result = (*nodeNubInterface)->AddCallbackDispatcherToRunLoop( nodeNubInterface, runLoopRef ) ;
@@ -295,8 +352,14 @@ IOReturn MPEG2Receiver::setupIsocReceiver(void)
 	(*remoteIsocPort)->SetStartHandler( remoteIsocPort, & RemotePort_Start_Helper );
 	(*remoteIsocPort)->SetStopHandler( remoteIsocPort, & RemotePort_Stop_Helper );
 
-	// Allocate memory for the isoch transmit buffers
-	vm_allocate(mach_task_self(), (vm_address_t *)&pBuffer,dclVMBufferSize, VM_FLAGS_ANYWHERE);
+	// Allocate memory for the isoch receive buffers, unless the client gave us some
+	if (pExternalBuffer != nil)
+	{
+		pBuffer = pExternalBuffer;
+		externalReceiveBuffer = true;
+	}
+	else
+		vm_allocate(mach_task_self(), (vm_address_t *)&pBuffer,dclVMBufferSize, VM_FLAGS_ANYWHERE);
     if (!pBuffer)
     {
 		logger->log("\nMPEG2Receiver Error: Error allocating isoch receive buffers.\n\n");
@@ -313,10 +376,10 @@ IOReturn MPEG2Receiver::setupIsocReceiver(void)
 	pReceiveBuffer = pBuffer;
 	
 	// Calculate the pointer to the DCL overrun receive buffer
-	pOverrunReceiveBuffer = (UInt32*) &pBuffer[(isochSegments*isochCyclesPerSegment*kMPEG2ReceiveBufferSize)];
+	pOverrunReceiveBuffer = (UInt32*) &pBuffer[(isochSegments*isochCyclesPerSegment*receiveBufferSize)];
 	
 	// Set the timestamp pointer
-	pTimeStamps = (UInt32*) &pBuffer[(((isochSegments*isochCyclesPerSegment)+1)*kMPEG2ReceiveBufferSize)];
+	pTimeStamps = (UInt32*) &pBuffer[(((isochSegments*isochCyclesPerSegment)+1)*receiveBufferSize)];
 	
 	// Allocate memory for the update list - Enough for all receive DCLs and timestamp DCLs 
     updateDCLList = (DCLCommandPtr *)malloc(((isochSegments*isochCyclesPerSegment)+isochSegments) * sizeof(DCLCommandPtr));
@@ -339,7 +402,7 @@ IOReturn MPEG2Receiver::setupIsocReceiver(void)
 		for (cycle=0;cycle< isochCyclesPerSegment;cycle++)
 		{
 			// Allocate receive DCL
-			pLastDCL = (*dclCommandPool)->AllocateReceivePacketStartDCL(dclCommandPool, pLastDCL, &pBuffer[bufCnt*kMPEG2ReceiveBufferSize],kMPEG2ReceiveBufferSize);
+			pLastDCL = (*dclCommandPool)->AllocateReceivePacketStartDCL(dclCommandPool, pLastDCL, &pBuffer[bufCnt*receiveBufferSize],receiveBufferSize);
 
 			// Save receive DCL ptr into update list
 			updateDCLList[curUpdateListIndex] = pLastDCL;
@@ -371,7 +434,7 @@ IOReturn MPEG2Receiver::setupIsocReceiver(void)
 	// Allocate Overrun label & callback DCL
 	pLastDCL = (*dclCommandPool)->AllocateLabelDCL( dclCommandPool, pLastDCL ) ;
 	pDCLOverrunLabel = (DCLLabelPtr) pLastDCL;
-	pLastDCL = (*dclCommandPool)->AllocateReceivePacketStartDCL(dclCommandPool, pLastDCL, pOverrunReceiveBuffer,kMPEG2ReceiveBufferSize);
+	pLastDCL = (*dclCommandPool)->AllocateReceivePacketStartDCL(dclCommandPool, pLastDCL, pOverrunReceiveBuffer,receiveBufferSize);
 	pLastDCL = (*dclCommandPool)->AllocateCallProcDCL(dclCommandPool, pLastDCL, MPEG2ReceiveOverrunDCLCallback_Helper, (DCLCallProcDataType) this);
 
 
@@ -407,7 +470,7 @@ IOReturn MPEG2Receiver::setupIsocReceiver(void)
 	isochChannel = (*nodeNubInterface)->CreateIsochChannel(
 														nodeNubInterface,
 														doIRM,
-														kMPEG2ReceiveBufferSize,
+														receiveBufferSize,
 														kFWSpeedMaximum,
 														CFUUIDGetUUIDBytes( kIOFireWireIsochChannelInterfaceID ));
 	if (!isochChannel)
@@ -471,6 +534,14 @@ MPEG2Receiver::registerExtendedDataPushCallback(ExtendedDataPushProc handler, vo
 IOReturn 
 MPEG2Receiver::registerStructuredDataPushCallback(StructuredDataPushProc handler, UInt32 maxCycleStructsPerCallback, void *pRefCon)
 {
+	// MPEGReceiveCycleData structs can't hold more than kMaxNumReceivePacketsPerCycle packets
+	if ((handler != nil) && (receivePacketsPerCycle > kMaxNumReceivePacketsPerCycle))
+	{
+		logger->log("\nMPEG2Receiver Error: Structured-data callback can't be used with more than %d packets per cycle. Use the cycle-span callback.\n\n",
+					kMaxNumReceivePacketsPerCycle);
+		return kIOReturnUnsupported;
+	}
+	
 	if (pCyclDataStruct == nil)
 	{
 		// Need to allocate array of the MPEGReceiveCycleData structs, one per cyclePerSegment
@@ -492,6 +563,61 @@ MPEG2Receiver::registerStructuredDataPushCallback(StructuredDataPushProc handler
 	return kIOReturnSuccess;
 }
 
+//////////////////////////////////////////////////////////////////////
+// registerCycleSpanDataPushCallback
+//////////////////////////////////////////////////////////////////////
+IOReturn 
+MPEG2Receiver::registerCycleSpanDataPushCallback(CycleSpanDataPushProc handler, UInt32 maxCycleSpansPerCallback, void *pRefCon)
+{
+	if (pCycleSpans == nil)
+	{
+		// Need to allocate array of the MPEGReceiveCycleSpan structs, one per cyclePerSegment,
+		// and the packet pointers for them, enough for every cycle to be full
+		pCycleSpans = new MPEGReceiveCycleSpan[isochCyclesPerSegment];
+		if (!pCycleSpans)
+			return kIOReturnNoMemory;
+		ppCycleSpanPacketPtrs = new UInt32*[isochCyclesPerSegment*receivePacketsPerCycle];
+		if (!ppCycleSpanPacketPtrs)
+		{
+			delete [] pCycleSpans;
+			pCycleSpans = nil;
+			return kIOReturnNoMemory;
+		}
+	}
+	
+	cycleSpanDataPush = handler;
+	pPacketPushRefCon = pRefCon;
+	
+	if (maxCycleSpansPerCallback == 0)
+		maxNumCycleSpansInCallback = 1;
+	else if (maxCycleSpansPerCallback > isochCyclesPerSegment)
+		maxNumCycleSpansInCallback = isochCyclesPerSegment;
+	else
+		maxNumCycleSpansInCallback = maxCycleSpansPerCallback;
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// registerSpanDataPushCallback
+//////////////////////////////////////////////////////////////////////
+IOReturn 
+MPEG2Receiver::registerSpanDataPushCallback(SpanDataPushProc handler, void *pRefCon)
+{
+	if (pPacketDescriptors == nil)
+	{
+		// Need to allocate array of packet descriptors, enough for a full segment
+		pPacketDescriptors = new MPEGReceivePacketDescriptor[isochCyclesPerSegment*receivePacketsPerCycle];
+		if (!pPacketDescriptors)
+			return kIOReturnNoMemory;
+	}
+	
+	spanDataPush = handler;
+	pPacketPushRefCon = pRefCon;
+	
+	return kIOReturnSuccess;
+}
+
 //////////////////////////////////////////////////////////////////////
 // registerMessageCallback
 //////////////////////////////////////////////////////////////////////
@@ -571,6 +697,9 @@ MPEG2Receiver::startReceive(void)
 	// Fixup all the DCL Jump targets
 	fixupDCLJumpTargets();
 	
+	// Don't flag a DBC gap across a stop/start
+	haveExpectedDBC = false;
+	
 	result = (*isochChannel)->AllocateChannel( isochChannel ) ;
 
 	if (result == kIOReturnSuccess)
@@ -747,10 +876,10 @@ void MPEG2Receiver::MPEG2ReceiveDCLCallback(void)
 	UInt32 startBuf;
 	UInt32 i;
 	UInt32 payloadLen;
+	bool validCycle;
 	UInt32 tsCount = 0;
 	UInt32 cyclePktCount = 0;
-	UInt32 *pPacketPtr[kMaxNumReceivePacketsPerCycle];
-	UInt32 incrementVal;
+	UInt32 *pPacketPtr[kMaxNumReceivePacketsPerCycleLimit];
 	bool segmentHasData = false;
 	bool segmentBadPacketDetected = false;
 	UInt32 dclTimeStamp;
@@ -761,25 +890,20 @@ void MPEG2Receiver::MPEG2ReceiveDCLCallback(void)
 	Nanoseconds currentUpTimeInNanoSeconds;
 	UInt64 currentUpTimeInNanoSecondsU64;
 	
-	int currentCycleTimeSecondsLo;	// Low 3-bits
-	int currentCycleTimeSecondsHi;	// High 4-bits
-	int currentCycleTimeSeconds;
-	int currentCycleTimeCycles;
-	
-	int dclTimeStampSecondsLo;		// Low 3-bits
-	int dclTimeStampSecondsHi;		// High 4-bits (we calculate this)
-	int dclTimeStampSeconds;
-	int dclTimeStampCycles;
-	
-	UInt32 currentCycleTimeInCycles;
-	UInt32 dclTimeInCycles;
 	UInt32 deltaCycles;
-	UInt32 deltaNanoSeconds;
+	UInt64 deltaNanoSeconds;
 	UInt64 dclTimeStampTimeInNanoSecondsU64 = 0LL;
 	
 	UInt32 numCycleStructs = 0;
 	UInt32 numCycleStructsDeliveredToClient = 0;
 	UInt32 numCycleStructsThisCallback = 0;
+	UInt32 numPacketDescriptors = 0;
+	UInt32 numCycleSpans = 0;
+	UInt32 numCycleSpansDeliveredToClient = 0;
+	UInt32 numCycleSpansThisCallback = 0;
+	UInt32 numCycleSpanPacketPtrs = 0;
+	UInt32 j;
+	bool wantTimeStamps = ((structuredDataPush != nil) || (cycleSpanDataPush != nil) || (spanDataPush != nil));
 
 	// See if this callback happened after we stopped
 	if (transportState == kMpeg2ReceiverTransportStopped)
@@ -787,18 +911,17 @@ void MPEG2Receiver::MPEG2ReceiveDCLCallback(void)
 	
 	dclTimeStamp = pTimeStamps[currentSegment];
 	
+	// This callback updates the receive stream analysis stats
+	beginStatsUpdate();
+	stats.segmentCallbacks += 1;
+	
 	segment = currentSegment;
 	startBuf = segment*isochCyclesPerSegment;
-	
-	if (includeSPH == true)
-		incrementVal = 0;
-	else
-		incrementVal = 1;
 
 	// Deal with calculating AbsoluteTime (in nano-seconds) info, only if the 
-	// structuredDataPush callback has been installed by the client
+	// structuredDataPush or spanDataPush callback has been installed by the client
 	// since the other callback methods don't provide this info to the client
-	if (structuredDataPush != nil)
+	if (wantTimeStamps == true)
 	{
 		// Get cycle timer and up-time. Do this in quick succession to best
 		// establish the relationship between the two.
@@ -808,58 +931,27 @@ void MPEG2Receiver::MPEG2ReceiveDCLCallback(void)
 		// Add one cycle to the current cycletime, if we are currently more than half-way
 		// through the cycle. Makes it a little more accurate!
 		if ((outCycleTime & 0x00000FFF) > 1536) 
-			outCycleTime =  AddFWCycleTimeToFWCycleTime( outCycleTime, 0x00001000 );
-		
-		// Process cycle timer, dcl-timestamp, and up-time to determine delta
-		currentCycleTimeSecondsLo = ((outCycleTime & 0x0E000000) >> 25);	
-		currentCycleTimeSecondsHi = ((outCycleTime & 0xF0000000) >> 25);
-		currentCycleTimeSeconds = ((outCycleTime & 0xFE000000) >> 25);
-		currentCycleTimeCycles = ((outCycleTime & 0x01FFF000) >> 12);
-		
-		dclTimeStampCycles = ((dclTimeStamp & 0x01FFF000) >> 12);
-		dclTimeStampSecondsLo = ((dclTimeStamp & 0x0E000000) >> 25);		
-		if (dclTimeStampSecondsLo > currentCycleTimeSecondsLo )
-			dclTimeStampSecondsHi = currentCycleTimeSecondsHi - 8 ;	// Subtract 8 seconds from this value!
-		else
-			dclTimeStampSecondsHi = currentCycleTimeSecondsHi;
-		dclTimeStampSeconds = dclTimeStampSecondsHi + dclTimeStampSecondsLo;
+			outCycleTime =  FWCycleTime::fromRegister(outCycleTime).addCycles(1).getRegister();
 		
+		// Process cycle timer, dcl-timestamp, and up-time to determine delta.
+		// The dcl timestamp only has the low 3 bits of the seconds field, so measure
+		// the delta in cycles since the last 8 second wrap. The dcl timestamp
+		// is always the earlier of the two, so this takes care of any rollover.
 		currentUpTimeInNanoSeconds = AbsoluteToNanoseconds(currentUpTime);
 		currentUpTimeInNanoSecondsU64 = ((UInt64) currentUpTimeInNanoSeconds.hi << 32) | currentUpTimeInNanoSeconds.lo;
 		
+		deltaCycles = FWTimeElapsed(FWTimeStampToCycles(dclTimeStamp), FWTimeStampToCycles(outCycleTime), kFWCyclesPerTimeStampWrap);
+		deltaNanoSeconds = FWCyclesToNanoSeconds(deltaCycles);
+		dclTimeStampTimeInNanoSecondsU64 = currentUpTimeInNanoSecondsU64 - deltaNanoSeconds;
+		
 #if 0
-		printf("CycleTime = 0x%08X (%d:%d:%d)\n",(int) outCycleTime,
-			   currentCycleTimeSeconds,
-			   currentCycleTimeCycles,
-			   (int) (outCycleTime & 0x00000FFF));
+		printf("CycleTime = 0x%08X, DCL TimeStamp = 0x%08X\n",(int) outCycleTime,(int) dclTimeStamp);
 		
 		printf("UpTime= %lld (%10.10f)\n",
 			   currentUpTimeInNanoSecondsU64,
 			   currentUpTimeInNanoSecondsU64/1000000000.0);
 		
-		printf("DCL TimeStamp = 0x%08X (%d:%d:%d)\n",(int) dclTimeStamp,
-			   dclTimeStampSeconds,
-			   dclTimeStampCycles,
-			   (int) (dclTimeStamp & 0x00000FFF));
-#endif
-		
-		// Here we are going to arbitrarily add 8 seconds to both the current cycle timer, and the dcl timestamp, to 
-		// eliminate the possiblity that the dcl timestamp full seconds field is a negative number.
-		// This is OK, since we're only interested in the delta between the two timetstamps, and 
-		// this eliminates any rollover issue!
-		dclTimeStampSeconds += 8;
-		currentCycleTimeSeconds += 8;
-		
-		// Convert the seconds fields and cycles fields of both timestamps to a count of cycles
-		currentCycleTimeInCycles = (currentCycleTimeSeconds * 8000) + currentCycleTimeCycles;
-		dclTimeInCycles = (dclTimeStampSeconds * 8000) + dclTimeStampCycles;
-		
-		deltaCycles = currentCycleTimeInCycles-dclTimeInCycles;
-		deltaNanoSeconds = (deltaCycles*125000);
-		dclTimeStampTimeInNanoSecondsU64 = currentUpTimeInNanoSecondsU64 - deltaNanoSeconds;
-		
-#if 0
-		printf("Delta between dcl timestamp and current cycle time: %d cycles (%d nsec) \n",(int)deltaCycles,(int)deltaNanoSeconds);
+		printf("Delta between dcl timestamp and current cycle time: %d cycles (%lld nsec) \n",(int)deltaCycles,deltaNanoSeconds);
 		
 		printf("DCL TimeStamp UpTime= %lld (%10.10f)\n",
 			   dclTimeStampTimeInNanoSecondsU64,
@@ -867,79 +959,71 @@ void MPEG2Receiver::MPEG2ReceiveDCLCallback(void)
 #endif
 	}
 		
-	UInt32 *pCycleBuf = (UInt32*) (pReceiveBuffer + (startBuf*kMPEG2ReceiveBufferSize));
+	UInt32 *pCycleBuf = (UInt32*) (pReceiveBuffer + (startBuf*receiveBufferSize));
 
 	for (i=0;i<isochCyclesPerSegment;i++)
 	{
-		payloadLen = ((*pCycleBuf & 0xFFFF0000) >> 16); // Note that this quadlet is already in machine native byte order!
-
-		switch (payloadLen)
+		validCycle = MPEG2ReceiverParseCycle(pCycleBuf, receivePacketsPerCycle, includeSPH, pPacketPtr, &cyclePktCount);
+		if (validCycle == true)
 		{
-			case 8:
-				cyclePktCount = 0;
-				break;
-				
-			case 200:
-				cyclePktCount = 1;
-				tsCount += 1;
-				pPacketPtr[0] = &pCycleBuf[3+incrementVal];
-				segmentHasData = true;
-				break;
-
-			case 392:
-				cyclePktCount = 2;
-				tsCount += 2;
-				pPacketPtr[0] = &pCycleBuf[3+incrementVal];
-				pPacketPtr[1] = &pCycleBuf[51+incrementVal];
-				segmentHasData = true;
-				break;
-
-			case 584:
-				cyclePktCount = 3;
-				tsCount += 3;
-				pPacketPtr[0] = &pCycleBuf[3+incrementVal];
-				pPacketPtr[1] = &pCycleBuf[51+incrementVal];
-				pPacketPtr[2] = &pCycleBuf[99+incrementVal];						
-				segmentHasData = true;
-				break;
-
-			case 776:
-				cyclePktCount = 4;
-				tsCount += 4;
-				pPacketPtr[0] = &pCycleBuf[3+incrementVal];
-				pPacketPtr[1] = &pCycleBuf[51+incrementVal];
-				pPacketPtr[2] = &pCycleBuf[99+incrementVal];
-				pPacketPtr[3] = &pCycleBuf[147+incrementVal];									
-				segmentHasData = true;
-				break;
-
-			case 968:
-				cyclePktCount = 5;
-				tsCount += 5;
-				pPacketPtr[0] = &pCycleBuf[3+incrementVal];
-				pPacketPtr[1] = &pCycleBuf[51+incrementVal];
-				pPacketPtr[2] = &pCycleBuf[99+incrementVal];
-				pPacketPtr[3] = &pCycleBuf[147+incrementVal];									
-				pPacketPtr[4] = &pCycleBuf[195+incrementVal];									
+			if (cyclePktCount > 0)
+			{
+				tsCount += cyclePktCount;
 				segmentHasData = true;
-				break;
+			}
+		}
+		else
+		{
+			// This is not a valid 61883-4 packet. Only notify the client once per DCL program segment
+			stats.badPackets += 1;
+			if (segmentBadPacketDetected == false)
+			{
+				// Post message if handler installed
+				payloadLen = ((*pCycleBuf & 0xFFFF0000) >> 16); // Note that this quadlet is already in machine native byte order!
+				logger->log("\nMPEG2Receiver Error: Received unsupported length isoch packet:%d\n\n",payloadLen);
+				if (messageProc != nil)
+					messageProc(kMpeg2ReceiverReceivedBadPacket,0x00000000,0x00000000,pMessageProcRefCon);
 				
-			default:
-				// This is not a valid 61883-4 packet. Only notify the client once per DCL program segment
-				if (segmentBadPacketDetected == false)
-				{
-					// Post message if handler installed
-					logger->log("\nMPEG2Receiver Error: Received unsupported length isoch packet:%d\n\n",payloadLen);
-					if (messageProc != nil)
-						messageProc(kMpeg2ReceiverReceivedBadPacket,0x00000000,0x00000000,pMessageProcRefCon);
-					
-					segmentBadPacketDetected = true;
-				}
-				break;
-		};
+				segmentBadPacketDetected = true;
+			}
+		}
 		
+		// Update the receive stream analysis for valid cycles
+		if (validCycle == true)
+			analyzeCycle(pCycleBuf, cyclePktCount, dclTimeStamp);
+		
+		// If we're using the span callback method, and this cycle had mpeg data, fill in a MPEGReceivePacketDescriptor per packet
+		if ((spanDataPush != nil) && (cyclePktCount > 0))
+		{
+			for (j=0;j<cyclePktCount;j++)
+			{
+				pPacketDescriptors[numPacketDescriptors].pBuf = pPacketPtr[j];
+				pPacketDescriptors[numPacketDescriptors].cycle = i;
+				pPacketDescriptors[numPacketDescriptors].fireWireTimeStamp = dclTimeStamp;
+				pPacketDescriptors[numPacketDescriptors].nanoSecondsTimeStamp = dclTimeStampTimeInNanoSecondsU64;
+				numPacketDescriptors++;
+			}
+		}
+		// If we're using the cycle-span callback method, and this cycle had mpeg data, fill in a MPEGReceiveCycleSpan struct
+		else if ((cycleSpanDataPush != nil) && (cyclePktCount > 0))
+		{
+			pCycleSpans[numCycleSpans].tsPacketCount = cyclePktCount;
+			pCycleSpans[numCycleSpans].ppBuf = &ppCycleSpanPacketPtrs[numCycleSpanPacketPtrs];
+			for (j=0;j<cyclePktCount;j++)
+				ppCycleSpanPacketPtrs[numCycleSpanPacketPtrs++] = pPacketPtr[j];
+			
+			pCycleSpans[numCycleSpans].pRefCon = pPacketPushRefCon;
+			pCycleSpans[numCycleSpans].isochHeader = pCycleBuf[0];
+			pCycleSpans[numCycleSpans].cipHeader0 = pCycleBuf[1];
+			pCycleSpans[numCycleSpans].cipHeader1 = pCycleBuf[2];
+			pCycleSpans[numCycleSpans].fireWireTimeStamp = dclTimeStamp;
+			pCycleSpans[numCycleSpans].nanoSecondsTimeStamp = dclTimeStampTimeInNanoSecondsU64;
+			
+			// Bump the number of cycleSpans
+			numCycleSpans++;
+		}
 		// If we're using the structured-data callback method, and this cycle had mpeg data, fill in a MPEGReceiveCycleData struct
-		if ((structuredDataPush != nil) && (cyclePktCount > 0))
+		else if ((structuredDataPush != nil) && (cyclePktCount > 0))
 		{
 			pCyclDataStruct[numCycleStructs].tsPacketCount = cyclePktCount;
 			
@@ -967,21 +1051,43 @@ void MPEG2Receiver::MPEG2ReceiveDCLCallback(void)
 		}
 		
 		// Bump the dcl timestamp by one cycle
-		// Only if the client has registered an extended callback function, or a structure-data callback function
-		if ((extendedPacketPush != nil) || (structuredDataPush != nil))
-			dclTimeStamp =  AddFWCycleTimeToFWCycleTime( dclTimeStamp, 0x00001000 );
+		dclTimeStamp =  FWCycleTime::fromRegister(dclTimeStamp).addCycles(1).getRegister();
 		
 		// Bump the absolute-time for the next cycle
-		// Only if the client has registered a structure-data callback function
-		if (structuredDataPush != nil)
+		// Only if the client has registered a structure-data or span callback function
+		if (wantTimeStamps == true)
 		{
 			// Bump the dcl time stamp by 125uSec (or 125000 nSec)
 			dclTimeStampTimeInNanoSecondsU64 += 125000LL;
 		}
 		
-		pCycleBuf += (kMPEG2ReceiveBufferSize/4);
+		pCycleBuf += (receiveBufferSize/4);
 	}
 
+	// If we're using the span callback method, and if we received any mpeg
+	// data during this segment, deliver the whole segment in one callback
+	if ((spanDataPush != nil) && (numPacketDescriptors > 0))
+		spanDataPush(numPacketDescriptors,pPacketDescriptors,pPacketPushRefCon);
+
+	// If we're using the cycle-span callback method, and if we received any mpeg
+	// data during this segment, now is the time to do the callback(s) 
+	if ((cycleSpanDataPush != nil) && (numCycleSpans > 0))
+	{
+		while (numCycleSpansDeliveredToClient < numCycleSpans)
+		{
+			// If the number of spans remainining to be delivered is greater than the client's  
+			// requested max, send only the requested max number of spans this time!
+			numCycleSpansThisCallback = ((numCycleSpans-numCycleSpansDeliveredToClient) > maxNumCycleSpansInCallback) ? 
+				maxNumCycleSpansInCallback : (numCycleSpans-numCycleSpansDeliveredToClient);
+			
+			// Callback the client 
+			cycleSpanDataPush(numCycleSpansThisCallback,&pCycleSpans[numCycleSpansDeliveredToClient],pPacketPushRefCon);
+			
+			// Bump
+			numCycleSpansDeliveredToClient += numCycleSpansThisCallback;
+		}
+	}
+	
 	// If we're using the structured-data callback method, and if we received any mpeg
 	// data during this segment, now is the time to do the callback(s) 
 	if ((structuredDataPush != nil) && (numCycleStructs > 0))
@@ -1003,6 +1109,14 @@ void MPEG2Receiver::MPEG2ReceiveDCLCallback(void)
 	
 	// Update some UI fields
 	mpegDataRate = (tsCount*8.0*188.0) * (8000.0/isochCyclesPerSegment);
+	
+	// Update the data rate stats. The smoothed rate is an exponential moving average over about 8 segments.
+	stats.mpegDataRate = mpegDataRate;
+	if (stats.segmentCallbacks == 1)
+		stats.smoothedMpegDataRate = mpegDataRate;
+	else
+		stats.smoothedMpegDataRate += ((mpegDataRate - stats.smoothedMpegDataRate) / 8.0);
+	publishStats();
 
 	// Update jump targets
 	(*localIsocPort)->ModifyJumpDCL(localIsocPort,
@@ -1024,6 +1138,123 @@ void MPEG2Receiver::MPEG2ReceiveDCLCallback(void)
 }
 	
 
+//////////////////////////////////////////////////////////////////////
+// analyzeCycle
+//////////////////////////////////////////////////////////////////////
+void MPEG2Receiver::analyzeCycle(UInt32 *pCycleBuf, UInt32 cyclePktCount, UInt32 arrivalCycleTime)
+{
+	UInt32 cipHeader0 = EndianU32_BtoN(pCycleBuf[1]);
+	UInt32 dbc = (cipHeader0 & 0x000000FF);
+	UInt32 dataBlocksPerPacket = (1 << ((cipHeader0 & 0x0000C000) >> 14));	// From the CIP FN field
+	UInt32 arrivalCycle = ((arrivalCycleTime & 0x01FFF000) >> 12);
+	UInt32 sph;
+	UInt32 sphLatency;
+	UInt32 i;
+	
+	stats.cycles += 1;
+	stats.tsPacketsReceived += cyclePktCount;
+	if (cyclePktCount < kMPEG2ReceiverStatsPacketsPerCycleBins)
+		stats.packetsPerCycle[cyclePktCount] += 1;
+	else
+		stats.packetsPerCycle[kMPEG2ReceiverStatsPacketsPerCycleBins-1] += 1;
+	if (cyclePktCount == 0)
+		stats.cipOnlyCycles += 1;
+	
+	// Check DBC continuity. The DBC of each cycle should follow on from the
+	// DBC of the previous cycle plus the number of data blocks it carried.
+	if ((haveExpectedDBC == true) && (dbc != expectedDBC))
+		stats.dbcGaps += 1;
+	expectedDBC = ((dbc + (cyclePktCount*dataBlocksPerPacket)) & 0x000000FF);
+	haveExpectedDBC = true;
+	
+	// Compare each packet's SPH delivery time to the cycle it arrived in.
+	// The SPH is always in the receive buffer, even if we don't pass it on to the client.
+	for (i=0;i<cyclePktCount;i++)
+	{
+		sph = EndianU32_BtoN(pCycleBuf[3+(i*48)]);
+		sphLatency = ((((sph & 0x01FFF000) >> 12) + 8000) - arrivalCycle) % 8000;
+		
+		// More than half a second in the future means the delivery time had already passed
+		if (sphLatency > 4000)
+			stats.lateSphPackets += 1;
+		else
+		{
+			stats.sphLatencyInCycles[StatsHistogramBin(sphLatency)] += 1;
+			if (sphLatency < stats.minSphLatencyInCycles)
+				stats.minSphLatencyInCycles = sphLatency;
+			if (sphLatency > stats.maxSphLatencyInCycles)
+				stats.maxSphLatencyInCycles = sphLatency;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// beginStatsUpdate
+//////////////////////////////////////////////////////////////////////
+void MPEG2Receiver::beginStatsUpdate(void)
+{
+	// Handle a reset requested while we were running
+	if (statsResetRequested == true)
+	{
+		clearStats();
+		statsResetRequested = false;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// publishStats
+//////////////////////////////////////////////////////////////////////
+void MPEG2Receiver::publishStats(void)
+{
+	statsLock.publish(&publishedStats, &stats, sizeof(MPEG2ReceiverStats));
+}
+
+//////////////////////////////////////////////////////////////////////
+// clearStats
+//////////////////////////////////////////////////////////////////////
+void MPEG2Receiver::clearStats(void)
+{
+	bzero(&stats, sizeof(MPEG2ReceiverStats));
+	stats.minSphLatencyInCycles = 0xFFFFFFFF;
+}
+
+//////////////////////////////////////////////////////////////////////
+// getStats
+//////////////////////////////////////////////////////////////////////
+IOReturn MPEG2Receiver::getStats(MPEG2ReceiverStats *pStats)
+{
+	if (!pStats)
+		return kIOReturnBadArgument;
+	
+	// The DCL callback never publishes from inside a client
+	// callback, so this can't spin forever if called from one
+	statsLock.read(pStats, &publishedStats, sizeof(MPEG2ReceiverStats));
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// resetStats
+//////////////////////////////////////////////////////////////////////
+void MPEG2Receiver::resetStats(void)
+{
+	// Lock the transport control mutex
+	pthread_mutex_lock(&transportControlMutex);
+	
+	// If we're stopped nobody is writing the stats, so clear them here.
+	// Otherwise let the DCL callback clear them on its next update.
+	if (transportState == kMpeg2ReceiverTransportStopped)
+	{
+		clearStats();
+		publishStats();
+	}
+	else
+		statsResetRequested = true;
+	
+	// Unlock the transport control mutex
+	pthread_mutex_unlock(&transportControlMutex);
+}
+
 //////////////////////////////////////////////////////////////////////
 // MPEG2ReceiveOverrunDCLCallback
 //////////////////////////////////////////////////////////////////////
@@ -1044,6 +1275,12 @@ void MPEG2Receiver::MPEG2ReceiveOverrunDCLCallback(void)
 		(*isochChannel)->ReleaseChannel( isochChannel ) ;
 		transportState = kMpeg2ReceiverTransportStopped;
 		
+		// Count the overrun, and don't flag a DBC gap across the restart
+		beginStatsUpdate();
+		stats.dclOverruns += 1;
+		haveExpectedDBC = false;
+		publishStats();
+		
 		// Post message if handler installed
 		logger->log("\nMPEG2Receiver Error: DCL Overrun!\n\n");
 		if (messageProc != nil)
@@ -1304,45 +1541,6 @@ static IOReturn MPEG2ReceiveFinalizeCallback_Helper( void* refcon )
 	return kIOReturnSuccess;
 }
 
-//////////////////////////////////////////////////////////////////////
-// AddFWCycleTimeToFWCycleTime
-//////////////////////////////////////////////////////////////////////
-UInt32  AddFWCycleTimeToFWCycleTime( UInt32 cycleTime1, UInt32 cycleTime2 )
-{
-    UInt32    secondCount,
-	cycleCount,
-	cycleOffset;
-    UInt32    cycleTime;
-	
-    // Add cycle offsets.
-    cycleOffset = (cycleTime1 & 0x0FFF) + (cycleTime2 & 0x0FFF);
-	
-    // Add cycle counts.
-    cycleCount = (cycleTime1 & 0x01FFF000) + (cycleTime2 & 0x01FFF000);
-	
-    // Add any carry over from cycle offset to cycle count.
-    if (cycleOffset > 3071)
-    {
-        cycleCount += 0x1000;
-        cycleOffset -= 3072;
-    }
-	
-    // Add secondCounts.
-    secondCount = (cycleTime1 & 0xFE000000) + (cycleTime2 & 0xFE000000);
-	
-    // Add any carry over from cycle count to secondCount.
-    if (cycleCount > (7999 << 12))
-    {
-        secondCount += 0x02000000;
-        cycleCount -= (8000 << 12);
-    }
-	
-    // Put everything together into cycle time.
-    cycleTime = secondCount | cycleCount | cycleOffset;
-	
-    return (cycleTime);
-}
-
 #ifdef kAVS_Enable_ForceStop_Handler	
 //////////////////////////////////////////////////////////////////////
 // MPEG2ReceiveForceStopHandler_Helper
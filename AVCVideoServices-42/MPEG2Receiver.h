@@ -75,8 +75,45 @@ enum
 	kMaxNumReceivePacketsPerCycle = kFWAVCMaxNumMPEG2ReceivePacketsPerCycle
 };
 
+// The most source packets that will fit in one isoch packet at S800 (4096 byte payload).
+// This is the upper limit for the maxPacketsPerCycle receiver class constructor parameter.
+enum
+{
+	kMaxNumReceivePacketsPerCycleLimit = 21
+};
+
 // Other defines
-#define kMPEG2ReceiveBufferSize ((kMaxNumReceivePacketsPerCycle*192)+16)
+#define kMPEG2ReceiveBufferSize ((kMaxNumReceivePacketsPerCycle*192)+16)	// For the default maxPacketsPerCycle
+
+// Parse one cycle's entry in the receive buffer: the isoch packet header (already in
+// machine native byte order), the two CIP header quadlets, then the source packets.
+// Returns false, with a packet count of zero, if it isn't a valid 61883-4 packet with
+// at most maxPacketsPerCycle source packets. Otherwise, fills in a pointer to each
+// ts packet (or to its source packet header, if includeSPH is true).
+static inline bool MPEG2ReceiverParseCycle(UInt32 *pCycleBuf,
+										   UInt32 maxPacketsPerCycle,
+										   bool includeSPH,
+										   UInt32 **ppPacketPtrs,
+										   UInt32 *pPacketCount)
+{
+	UInt32 payloadLen = ((*pCycleBuf & 0xFFFF0000) >> 16);
+	UInt32 packetOffset = (includeSPH == true) ? 3 : 4;
+	UInt32 packetCount;
+	UInt32 i;
+	
+	// A valid 61883-4 packet has an 8 byte CIP header, followed by zero or more 192 byte source packets
+	if ((payloadLen < 8) || (((payloadLen-8) % 192) != 0) || (((payloadLen-8) / 192) > maxPacketsPerCycle))
+	{
+		*pPacketCount = 0;
+		return false;
+	}
+	
+	packetCount = ((payloadLen-8) / 192);
+	for (i=0;i<packetCount;i++)
+		ppPacketPtrs[i] = &pCycleBuf[packetOffset+(i*48)];
+	*pPacketCount = packetCount;
+	return true;
+}
 
 // Structure containing vars for each receive segment
 struct MPEGReceiveSegment
@@ -91,7 +128,7 @@ struct MPEGReceiveSegment
 //
 // Due to the desire to keep backwards compatibility for users of older versions of
 // this module, while still being able to provide new features to current users,
-// there are now three different methods (i.e. three different callbacks) used to push 
+// there are now five different methods (i.e. five different callbacks) used to push 
 // data to the clients. They are
 //
 //  1) The original DataPushProc(...), which is the default callback, and is 
@@ -114,23 +151,42 @@ struct MPEGReceiveSegment
 //  number of which is specified in the call to registerStructuredDataPushCallback(...), or
 //  the sepecified cyclesPerSegment, whichever is smaller. This allows a client to only
 //  receive one callback per segment of the program, or one per cycle, or anything in between.
+//  Note: MPEGReceiveCycleData can only hold kMaxNumReceivePacketsPerCycle packets, so this
+//  callback can't be used with a receiver constructed with a larger maxPacketsPerCycle.
+//
+//  4) The CycleSpanDataPushProc(...), which is installed using the method call
+//  registerCycleSpanDataPushCallback(...), and works just like the StructuredDataPushProc,
+//  except that each cycle's struct (MPEGReceiveCycleSpan) points to a variable-length span
+//  of packet pointers, so it works with any maxPacketsPerCycle.
+//
+//  5) The SpanDataPushProc(...), which is installed using the method call
+//  registerSpanDataPushCallback(...), and is called once per segment of the program that
+//  contains ts data. It passes one contiguous array of MPEGReceivePacketDescriptor structs,
+//  one per ts packet in the segment, each with the packet pointer, the cycle (within the
+//  segment) it arrived in, and its firewire and nano-seconds timestamps. This lets a client
+//  write or demux a whole segment's worth of packets in bulk.
 //  
 //  Only one of these callback methods will be called, and the precedence is the following:
 //
-//		A - If a callback is installed using registerStructuredDataPushCallback(...) the 
+//		A - If a callback is installed using registerSpanDataPushCallback(...) the
+//      SpanDataPushProc will be used, overriding any other callback installed.
+//
+//		B - Otherwise, if a callback is installed using registerCycleSpanDataPushCallback(...) the
+//      CycleSpanDataPushProc will be used, overriding any StructuredDataPushProc, ExtendedDataPushProc,
+//      or DataPushProc installed.
+//
+//		C - Otherwise, if a callback is installed using registerStructuredDataPushCallback(...) the 
 //      StructuredDataPushProc will be used, overriding any ExtendedDataPushProc, or DataPushProc
 //      installed.
 //
-//      B - If registerStructuredDataPushCallback(...) is not called (or called with a pointer
-//      to NULL for the StructuredDataPushProc, and a callback is installed using
-//      registerExtendedDataPushCallback, the ExtendedDataPushProc will be used, overriding
-//      any any DataPushProc installed.
+//      D - Otherwise, if a callback is installed using registerExtendedDataPushCallback(...) the
+//      ExtendedDataPushProc will be used, overriding any DataPushProc installed.
 //
-//      C - Otherwise, the DataPushProc is used.
+//      E - Otherwise, the DataPushProc is used.
 //
 ///////////////////////////////////////////////////////////////////////////////////////
 
-// The prototypes for the three data-push callback schemes:
+// The prototypes for the five data-push callback schemes:
 
 // Function prototype for data push callback.
 typedef IOReturn (*DataPushProc) (UInt32 tsPacketCount, UInt32 **ppBuf, void *pRefCon);
@@ -151,8 +207,77 @@ typedef FWAVCMPEGReceiveCycleData MPEGReceiveCycleData;
 // Function prototype for alternate "structured" data push callback.
 typedef IOReturn (*StructuredDataPushProc) (UInt32 CycleDataCount, MPEGReceiveCycleData *pCycleData, void *pRefCon);
 
+// Struct to hold all info regarding a single cycle's received MPEG data, with a
+// variable-length span of packet pointers. Only used by the "cycle-span" callback method.
+struct MPEGReceiveCycleSpan
+{
+	UInt32 tsPacketCount;
+	UInt32 **ppBuf;				// Points to tsPacketCount packet pointers
+	void *pRefCon; 
+	UInt32 isochHeader;
+	UInt32 cipHeader0;
+	UInt32 cipHeader1;
+	UInt32 fireWireTimeStamp;
+	UInt64 nanoSecondsTimeStamp;
+};
+
+// Function prototype for alternate "cycle-span" data push callback.
+typedef IOReturn (*CycleSpanDataPushProc) (UInt32 cycleSpanCount, MPEGReceiveCycleSpan *pCycleSpans, void *pRefCon);
+
+// Struct to hold info for a single received ts packet.
+// Only used by the "span" callback method.
+struct MPEGReceivePacketDescriptor
+{
+	UInt32 *pBuf;					// Pointer to the ts packet (or SPH+TS, if receiving SPHs)
+	UInt32 cycle;					// The cycle, within the DCL program segment, the packet arrived in
+	UInt32 fireWireTimeStamp;		// The firewire cycle-time of that cycle
+	UInt64 nanoSecondsTimeStamp;	// The system up-time, in nano-seconds, of that cycle
+};
+
+// Function prototype for alternate "span" data push callback.
+typedef IOReturn (*SpanDataPushProc) (UInt32 packetCount, MPEGReceivePacketDescriptor *pPackets, void *pRefCon);
+
 ///////////////////////////////////////////////////////////////////////////////////////
 
+// Receive stream analysis. These stats are always collected by the receiver's
+// DCL callback, and can be read from any thread with getStats(...). They are
+// published at the end of each segment, so a data push callback sees the stats
+// as of the end of the previous segment.
+enum
+{
+	kMPEG2ReceiverStatsHistogramBins = 16,
+	kMPEG2ReceiverStatsPacketsPerCycleBins = (kMaxNumReceivePacketsPerCycle+1)
+};
+
+typedef struct _MPEG2ReceiverStats
+{
+	UInt32 segmentCallbacks;
+	
+	// Per-cycle counts
+	UInt64 cycles;
+	UInt64 cipOnlyCycles;
+	UInt64 tsPacketsReceived;
+	UInt64 packetsPerCycle[kMPEG2ReceiverStatsPacketsPerCycleBins];
+	UInt32 badPackets;
+	
+	// Number of cycles whose CIP header DBC didn't follow on from the previous cycle
+	UInt32 dbcGaps;
+	
+	// Source packet header delivery time, minus the cycle the packet arrived in.
+	// Packets whose delivery time had already passed when they arrived are counted
+	// as late, and not included in the histogram or min/max.
+	UInt32 sphLatencyInCycles[kMPEG2ReceiverStatsHistogramBins];	// log2 bins
+	UInt32 minSphLatencyInCycles;
+	UInt32 maxSphLatencyInCycles;
+	UInt32 lateSphPackets;
+	
+	UInt32 dclOverruns;
+	
+	// Data rate over the last segment, and smoothed over many segments
+	double mpegDataRate;
+	double smoothedMpegDataRate;
+}MPEG2ReceiverStats;
+
 // Function prototype for message callback.
 typedef void (*MPEG2ReceiverMessageProc) (UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon);
 
@@ -171,13 +296,18 @@ public:
 				  IOFireWireLibNubRef nubInterface = nil,
 				  unsigned int cyclesPerSegment = kCyclesPerReceiveSegment,
 				  unsigned int numSegments = kNumReceiveSegments,
-				  bool doIRMAllocations = false);
+				  bool doIRMAllocations = false,
+				  unsigned int maxPacketsPerCycle = kMaxNumReceivePacketsPerCycle);
 
     // Destructor
     ~MPEG2Receiver();
 
-    // Function to setup all the isoc stuff
-    IOReturn setupIsocReceiver(void);
+    // Function to setup all the isoc stuff.
+	// If isochRunLoopRef is nil, the current thread's run loop is used. If pExternalBuffer
+	// is non-nil, it must point to at least getDCLBufferSize() bytes of page-aligned memory,
+	// which the receiver uses for its DCL buffers instead of allocating its own, and does
+	// not free.
+    IOReturn setupIsocReceiver(CFRunLoopRef isochRunLoopRef = nil, UInt8 *pExternalBuffer = nil);
 
 	// Set the isoch receive channel
 	IOReturn setReceiveIsochChannel(unsigned int chan);
@@ -201,6 +331,15 @@ public:
 	// Note: If a non-nil value is set for this structured-data callback, the standard callback and/or the extended
 	// callback will not be called.
 	IOReturn registerStructuredDataPushCallback(StructuredDataPushProc handler, UInt32 maxCycleStructsPerCallback, void *pRefCon);
+
+	// Function to install a handler for receiving data packets using the alternate "cycle-span" callback prototype
+	// Note: If a non-nil value is set for this cycle-span callback, the structured-data, extended, and standard
+	// callbacks will not be called.
+	IOReturn registerCycleSpanDataPushCallback(CycleSpanDataPushProc handler, UInt32 maxCycleSpansPerCallback, void *pRefCon);
+
+	// Function to install a handler for receiving data packets using the alternate "span" callback prototype
+	// Note: If a non-nil value is set for this span callback, none of the other data push callbacks will be called.
+	IOReturn registerSpanDataPushCallback(SpanDataPushProc handler, void *pRefCon);
 	
 	// Function to install a handler for receiving messages
 	IOReturn registerMessageCallback(MPEG2ReceiverMessageProc handler, void *pRefCon);
@@ -212,6 +351,15 @@ public:
 	// pointers to SPH+TS or just TS themselves
 	void ReceiveSourcePacketHeaders(bool wantSPH);
 	
+	// Get a consistent snapshot of the receive stream analysis stats
+	IOReturn getStats(MPEG2ReceiverStats *pStats);
+	
+	// Clear the receive stream analysis stats
+	void resetStats(void);
+	
+	// Get the size of the memory needed for the DCL program's buffers
+	unsigned int getDCLBufferSize(void);
+	
 	// Publically visible vars
     double mpegDataRate;	// Users should treat as read-only for status
 	unsigned int transportState;
@@ -233,18 +381,29 @@ private:
 	// Call to fixup jump targets in receive dcl
 	void fixupDCLJumpTargets(void);
 	
+	// Receive stream analysis. Only the DCL callback writes the working stats,
+	// calling beginStatsUpdate before it starts, and publishStats when it's done
+	// (after any client callbacks).
+	void beginStatsUpdate(void);
+	void publishStats(void);
+	void clearStats(void);
+	void analyzeCycle(UInt32 *pCycleBuf, UInt32 cyclePktCount, UInt32 arrivalCycleTime);
+	
 	// Class Variables
 	DCLCommandStruct *pFirstDCL;
 	DCLCommandPtr *updateDCLList;
 	unsigned int receiveChannel;
 	IOFWSpeed receiveSpeed;
     UInt8 *pReceiveBuffer;
+	bool externalReceiveBuffer;
 	MPEGReceiveSegment *receiveSegmentInfo;
 	DCLLabelPtr pDCLOverrunLabel;
 	UInt32 currentSegment;
 	unsigned int isochCyclesPerSegment;
 	unsigned int isochSegments;
 	unsigned int dclCommandPoolSize;
+	unsigned int receivePacketsPerCycle;
+	unsigned int receiveBufferSize;
 	bool doIRM;
 	bool noLogger;
 	unsigned int dclVMBufferSize;
@@ -260,6 +419,14 @@ private:
 	StructuredDataPushProc structuredDataPush;
 	UInt32 maxNumStructuredDataStructsInCallback;
 	MPEGReceiveCycleData *pCyclDataStruct;
+	
+	CycleSpanDataPushProc cycleSpanDataPush;
+	UInt32 maxNumCycleSpansInCallback;
+	MPEGReceiveCycleSpan *pCycleSpans;
+	UInt32 **ppCycleSpanPacketPtrs;
+	
+	SpanDataPushProc spanDataPush;
+	MPEGReceivePacketDescriptor *pPacketDescriptors;
 		
 	void *pPacketPushRefCon;
 	MPEG2ReceiverMessageProc messageProc;
@@ -275,6 +442,14 @@ private:
 	void stopNoDataTimer( void );
 	CFRunLoopTimerRef noDataTimer;
 	
+	// Receive stream analysis stats
+	MPEG2ReceiverStats stats;			// Working copy, only touched by the DCL callback
+	MPEG2ReceiverStats publishedStats;
+	StatsSeqLock statsLock;
+	volatile bool statsResetRequested;
+	bool haveExpectedDBC;
+	UInt32 expectedDBC;
+	
 public:
 	// Callbacks for remote isoch port object
 	IOReturn RemotePort_GetSupported(
@@ -0,0 +1,502 @@
+/*
+	File:		MPEG2RecordingSink.cpp
+ 
+ Synopsis: This is the implementation file for the MPEG2RecordingSink class.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVCVideoServices.h"
+
+#include <fcntl.h>
+#include <errno.h>
+
+namespace AVS
+{
+
+// Prototypes for static functions in this file
+static void *MPEG2RecordingSinkWriterThreadStart(MPEG2RecordingSink *pSink);
+
+//////////////////////////////////////////////////////
+// Constructor
+//////////////////////////////////////////////////////
+MPEG2RecordingSink::MPEG2RecordingSink(StringLogger *stringLogger,
+									   UInt32 packetsPerBuffer,
+									   UInt32 numBuffers,
+									   bool includeSPH)
+{
+	if (stringLogger == nil)
+	{
+		logger = new StringLogger(nil);	// Throws away all log strings
+		noLogger = true;
+	}
+	else
+	{
+		logger = stringLogger;
+		noLogger = false;
+	}
+	
+	// Round the buffer size up to our granularity
+	if (packetsPerBuffer == 0)
+		packetsPerBuffer = kMPEG2RecordingSinkDefaultPacketsPerBuffer;
+	packetsPerBuffer = ((packetsPerBuffer + kMPEG2RecordingSinkPacketsPerBufferGranularity - 1) /
+		kMPEG2RecordingSinkPacketsPerBufferGranularity) * kMPEG2RecordingSinkPacketsPerBufferGranularity;
+	
+	// Need at least two buffers, so one can fill while the other is written
+	if (numBuffers < 2)
+		numBuffers = 2;
+	
+	packetSize = (includeSPH == true) ? 192 : 188;
+	bufferSize = packetsPerBuffer * packetSize;
+	numWriteBuffers = numBuffers;
+	ppWriteBuffers = nil;
+	pWriteBufferLengths = nil;
+	fillIndex = 0;
+	writeIndex = 0;
+	numFullBuffers = 0;
+	
+	fileDescriptor = -1;
+	fileOffset = 0;
+	writerThreadRunning = false;
+	writerThreadShouldExit = false;
+	writeFailed = false;
+	
+	bzero(&stats, sizeof(MPEG2RecordingSinkStats));
+	
+	pthread_mutex_init(&bufferQueueMutex, NULL);
+	pthread_cond_init(&bufferQueueCondition, NULL);
+}
+
+//////////////////////////////////////////////////////
+// Destructor
+//////////////////////////////////////////////////////
+MPEG2RecordingSink::~MPEG2RecordingSink()
+{
+	closeFile();
+	
+	pthread_cond_destroy(&bufferQueueCondition);
+	pthread_mutex_destroy(&bufferQueueMutex);
+	
+	// If we created an internal logger, free it
+	if (noLogger == true)
+		delete logger;
+}
+
+//////////////////////////////////////////////////////
+// openFile
+//////////////////////////////////////////////////////
+IOReturn MPEG2RecordingSink::openFile(const char *pFileName)
+{
+	UInt32 i;
+	
+	if (!pFileName)
+		return kIOReturnBadArgument;
+	
+	// Make sure we are not already recording
+	if (fileDescriptor != -1)
+		return kIOReturnExclusiveAccess;
+	
+	// Allocate the array of buffer pointers, and the buffers themselves. The buffers
+	// come from vm_allocate, so they are page aligned, and already wired in by the
+	// time we start, since we touch every page below.
+	ppWriteBuffers = new UInt8*[numWriteBuffers];
+	pWriteBufferLengths = new UInt32[numWriteBuffers];
+	if ((!ppWriteBuffers) || (!pWriteBufferLengths))
+	{
+		releaseBuffers();
+		return kIOReturnNoMemory;
+	}
+	for (i=0;i<numWriteBuffers;i++)
+		ppWriteBuffers[i] = nil;
+	for (i=0;i<numWriteBuffers;i++)
+	{
+		vm_allocate(mach_task_self(), (vm_address_t *)&ppWriteBuffers[i], bufferSize, VM_FLAGS_ANYWHERE);
+		if (!ppWriteBuffers[i])
+		{
+			logger->log("\nMPEG2RecordingSink Error: Error allocating write buffers\n\n");
+			releaseBuffers();
+			return kIOReturnNoMemory;
+		}
+		bzero(ppWriteBuffers[i], bufferSize);
+		pWriteBufferLengths[i] = 0;
+	}
+	
+	fileDescriptor = open(pFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fileDescriptor == -1)
+	{
+		logger->log("\nMPEG2RecordingSink Error: Unable to create file: %s\n\n",pFileName);
+		releaseBuffers();
+		return kIOReturnError;
+	}
+	
+	// Bypass the buffer cache for our (large, page-aligned) writes
+	fcntl(fileDescriptor, F_NOCACHE, 1);
+	
+	fileOffset = 0;
+	fillIndex = 0;
+	writeIndex = 0;
+	numFullBuffers = 0;
+	writeFailed = false;
+	bzero(&stats, sizeof(MPEG2RecordingSinkStats));
+	
+	// Start the writer thread
+	writerThreadShouldExit = false;
+	if (pthread_create(&writerThread, NULL, (void *(*)(void *))MPEG2RecordingSinkWriterThreadStart, this) != 0)
+	{
+		logger->log("\nMPEG2RecordingSink Error: Unable to create writer thread\n\n");
+		close(fileDescriptor);
+		fileDescriptor = -1;
+		releaseBuffers();
+		return kIOReturnError;
+	}
+	writerThreadRunning = true;
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// closeFile
+//////////////////////////////////////////////////////
+IOReturn MPEG2RecordingSink::closeFile(void)
+{
+	IOReturn result = kIOReturnSuccess;
+	
+	if (fileDescriptor == -1)
+		return kIOReturnNotOpen;
+	
+	if (writerThreadRunning == true)
+	{
+		// Hand off any partially filled buffer, and tell the writer
+		// thread to exit once it has written everything
+		pthread_mutex_lock(&bufferQueueMutex);
+		if ((numFullBuffers < numWriteBuffers) && (pWriteBufferLengths[fillIndex] > 0))
+			submitFillBuffer();
+		writerThreadShouldExit = true;
+		pthread_cond_signal(&bufferQueueCondition);
+		pthread_mutex_unlock(&bufferQueueMutex);
+		
+		pthread_join(writerThread, NULL);
+		writerThreadRunning = false;
+	}
+	
+	if (writeFailed == true)
+		result = kIOReturnIOError;
+	
+	close(fileDescriptor);
+	fileDescriptor = -1;
+	
+	releaseBuffers();
+	
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// releaseBuffers
+//////////////////////////////////////////////////////
+void MPEG2RecordingSink::releaseBuffers(void)
+{
+	UInt32 i;
+	
+	if (ppWriteBuffers)
+	{
+		for (i=0;i<numWriteBuffers;i++)
+			if (ppWriteBuffers[i])
+				vm_deallocate(mach_task_self(), (vm_address_t) ppWriteBuffers[i], bufferSize);
+		delete [] ppWriteBuffers;
+		ppWriteBuffers = nil;
+	}
+	
+	if (pWriteBufferLengths)
+	{
+		delete [] pWriteBufferLengths;
+		pWriteBufferLengths = nil;
+	}
+}
+
+//////////////////////////////////////////////////////
+// submitFillBuffer - bufferQueueMutex must be held
+//////////////////////////////////////////////////////
+void MPEG2RecordingSink::submitFillBuffer(void)
+{
+	numFullBuffers += 1;
+	fillIndex += 1;
+	if (fillIndex == numWriteBuffers)
+		fillIndex = 0;
+	
+	// If the next buffer is free, start it off empty. Otherwise, the
+	// writer thread empties it when it's done writing it.
+	if (numFullBuffers < numWriteBuffers)
+		pWriteBufferLengths[fillIndex] = 0;
+	pthread_cond_signal(&bufferQueueCondition);
+}
+
+//////////////////////////////////////////////////////
+// updateBacklog - bufferQueueMutex must be held
+//////////////////////////////////////////////////////
+void MPEG2RecordingSink::updateBacklog(void)
+{
+	UInt32 backlog;
+	
+	backlog = (numFullBuffers*bufferSize);
+	if (numFullBuffers < numWriteBuffers)
+		backlog += pWriteBufferLengths[fillIndex];
+	stats.backlogBytes = backlog;
+	if (backlog > stats.maxBacklogBytes)
+		stats.maxBacklogBytes = backlog;
+}
+
+//////////////////////////////////////////////////////
+// pushTSPackets
+//////////////////////////////////////////////////////
+IOReturn MPEG2RecordingSink::pushTSPackets(UInt32 tsPacketCount, UInt32 **ppBuf)
+{
+	UInt32 i;
+	UInt32 fillLength;
+	UInt8 *pFillBuffer;
+	bool haveFillBuffer;
+	bool recordingFailed;
+	UInt32 bytesDropped = 0;
+	
+	if (fileDescriptor == -1)
+		return kIOReturnNotOpen;
+	
+	// The fill buffer is only available if the writer thread isn't holding every
+	// buffer. Once a write has failed, there's no point buffering any more data.
+	pthread_mutex_lock(&bufferQueueMutex);
+	recordingFailed = writeFailed;
+	haveFillBuffer = ((numFullBuffers < numWriteBuffers) && (recordingFailed == false));
+	pthread_mutex_unlock(&bufferQueueMutex);
+	
+	for (i=0;i<tsPacketCount;i++)
+	{
+		if (haveFillBuffer == false)
+		{
+			bytesDropped = ((tsPacketCount-i)*packetSize);
+			break;
+		}
+		
+		// Copy this packet into the fill buffer. We don't need to hold the mutex
+		// for the copy, since the writer thread never touches the fill buffer.
+		fillLength = pWriteBufferLengths[fillIndex];
+		pFillBuffer = ppWriteBuffers[fillIndex];
+		bcopy(ppBuf[i], &pFillBuffer[fillLength], packetSize);
+		fillLength += packetSize;
+		pWriteBufferLengths[fillIndex] = fillLength;
+		
+		// If the fill buffer is now full, hand it off to the writer thread
+		if (fillLength == bufferSize)
+		{
+			pthread_mutex_lock(&bufferQueueMutex);
+			submitFillBuffer();
+			haveFillBuffer = (numFullBuffers < numWriteBuffers);
+			pthread_mutex_unlock(&bufferQueueMutex);
+		}
+	}
+	
+	// Update the stats
+	pthread_mutex_lock(&bufferQueueMutex);
+	stats.bytesReceived += (tsPacketCount*packetSize);
+	stats.bytesDropped += bytesDropped;
+	updateBacklog();
+	pthread_mutex_unlock(&bufferQueueMutex);
+	
+	if (recordingFailed == true)
+		return kIOReturnIOError;
+	else if (bytesDropped > 0)
+		return kIOReturnNoResources;
+	else
+		return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// getStats
+//////////////////////////////////////////////////////
+IOReturn MPEG2RecordingSink::getStats(MPEG2RecordingSinkStats *pStats)
+{
+	if (!pStats)
+		return kIOReturnBadArgument;
+	
+	pthread_mutex_lock(&bufferQueueMutex);
+	*pStats = stats;
+	pthread_mutex_unlock(&bufferQueueMutex);
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// DataPush
+//////////////////////////////////////////////////////
+IOReturn MPEG2RecordingSink::DataPush(UInt32 tsPacketCount, UInt32 **ppBuf, void *pRefCon)
+{
+	MPEG2RecordingSink *pSink = (MPEG2RecordingSink*) pRefCon;
+	return pSink->pushTSPackets(tsPacketCount, ppBuf);
+}
+
+//////////////////////////////////////////////////////
+// SpanDataPush
+//////////////////////////////////////////////////////
+IOReturn MPEG2RecordingSink::SpanDataPush(UInt32 packetCount, MPEGReceivePacketDescriptor *pPackets, void *pRefCon)
+{
+	MPEG2RecordingSink *pSink = (MPEG2RecordingSink*) pRefCon;
+	UInt32 *pPacketPtrs[kMaxNumReceivePacketsPerCycle*8];
+	UInt32 i;
+	UInt32 numPackets;
+	IOReturn result = kIOReturnSuccess;
+	IOReturn pushResult;
+	
+	// Push the packets in groups, to keep the number of mutex acquisitions low
+	while (packetCount > 0)
+	{
+		numPackets = (packetCount > (kMaxNumReceivePacketsPerCycle*8)) ? (kMaxNumReceivePacketsPerCycle*8) : packetCount;
+		for (i=0;i<numPackets;i++)
+			pPacketPtrs[i] = pPackets[i].pBuf;
+		pushResult = pSink->pushTSPackets(numPackets, pPacketPtrs);
+		if (pushResult != kIOReturnSuccess)
+			result = pushResult;
+		pPackets += numPackets;
+		packetCount -= numPackets;
+	}
+	
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// writeBuffer
+//////////////////////////////////////////////////////
+bool MPEG2RecordingSink::writeBuffer(UInt8 *pWriteBuffer, UInt32 writeLength)
+{
+	UInt32 totalWritten = 0;
+	ssize_t bytesWritten;
+	
+	// pwrite can write less than we asked for, or be interrupted
+	// before writing anything, so keep going until it's all written.
+	while (totalWritten < writeLength)
+	{
+		bytesWritten = pwrite(fileDescriptor, &pWriteBuffer[totalWritten], writeLength-totalWritten, fileOffset);
+		if (bytesWritten > 0)
+		{
+			totalWritten += bytesWritten;
+			fileOffset += bytesWritten;
+		}
+		else if ((bytesWritten == -1) && (errno == EINTR))
+			continue;
+		else
+		{
+			// A real error, or the file system won't take any more data
+			logger->log("\nMPEG2RecordingSink Error: Write of %u bytes at offset %lld failed (errno %d)\n\n",
+						(unsigned int) (writeLength-totalWritten), (long long) fileOffset, (bytesWritten == -1) ? errno : 0);
+			break;
+		}
+	}
+	
+	pthread_mutex_lock(&bufferQueueMutex);
+	stats.bytesWritten += totalWritten;
+	pthread_mutex_unlock(&bufferQueueMutex);
+	
+	return (totalWritten == writeLength);
+}
+
+//////////////////////////////////////////////////////
+// WriterThread
+//////////////////////////////////////////////////////
+void MPEG2RecordingSink::WriterThread(void)
+{
+	UInt8 *pWriteBuffer;
+	UInt32 writeLength;
+	bool writeOK;
+	
+	pthread_mutex_lock(&bufferQueueMutex);
+	
+	for (;;)
+	{
+		// Wait for a full buffer, or for a request to exit
+		while ((numFullBuffers == 0) && (writerThreadShouldExit == false))
+			pthread_cond_wait(&bufferQueueCondition, &bufferQueueMutex);
+		
+		if (numFullBuffers == 0)
+			break;	// Nothing left to write, and we've been told to exit
+		
+		pWriteBuffer = ppWriteBuffers[writeIndex];
+		writeLength = pWriteBufferLengths[writeIndex];
+		
+		// Do the write without holding the mutex, so the isoch thread can keep filling.
+		// Once a write has failed, the file has a hole in it, so we just discard the
+		// rest of the buffered data.
+		if (writeFailed == false)
+		{
+			pthread_mutex_unlock(&bufferQueueMutex);
+			writeOK = writeBuffer(pWriteBuffer, writeLength);
+			pthread_mutex_lock(&bufferQueueMutex);
+			
+			if (writeOK == false)
+			{
+				stats.writeErrors += 1;
+				writeFailed = true;
+			}
+			stats.buffersWritten += 1;
+		}
+		else
+			stats.bytesDropped += writeLength;
+		
+		// This buffer is free again. If the isoch thread ran out of buffers, it
+		// is waiting on this one, and will start filling it with the next push.
+		if (numFullBuffers == numWriteBuffers)
+			pWriteBufferLengths[writeIndex] = 0;
+		numFullBuffers -= 1;
+		writeIndex += 1;
+		if (writeIndex == numWriteBuffers)
+			writeIndex = 0;
+		updateBacklog();
+	}
+	
+	pthread_mutex_unlock(&bufferQueueMutex);
+}
+
+//////////////////////////////////////////////////////
+// MPEG2RecordingSinkWriterThreadStart
+//////////////////////////////////////////////////////
+static void *MPEG2RecordingSinkWriterThreadStart(MPEG2RecordingSink *pSink)
+{
+	pSink->WriterThread();
+	return nil;
+}
+
+} // namespace AVS
@@ -0,0 +1,180 @@
+/*
+	File:		MPEG2RecordingSink.h
+ 
+ Synopsis: This is the header file for the MPEG2RecordingSink class.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_MPEG2RECORDINGSINK__
+#define __AVCVIDEOSERVICES_MPEG2RECORDINGSINK__
+
+namespace AVS
+{
+
+///////////////////////////////////////////////////////////////////////////////////////
+//
+//  MPEG2RecordingSink: Records received TS packets to a file without doing any file
+//  i/o on the isoch callback thread.
+//
+//  Packets pushed into the sink are copied into a small set of large, page-aligned
+//  write buffers. Each full buffer is handed off to a dedicated writer thread, which
+//  writes it to the file with pwrite(). The file is opened with F_NOCACHE, so large
+//  recordings don't flood the buffer cache.
+//
+//  The isoch callback thread never waits on the disk. If the writer thread falls so
+//  far behind that every buffer is waiting to be written, packets are dropped (and
+//  counted) until a buffer is freed, instead of stalling the DCL program, and the
+//  push returns kIOReturnNoResources.
+//
+//  If a write fails (or the disk stops taking data), the recording is failed: the
+//  rest of the buffered data is discarded, every later push returns kIOReturnIOError,
+//  and closeFile returns kIOReturnIOError.
+//
+//  The static DataPush and SpanDataPush helpers can be registered directly with a
+//  MPEG2Receiver, passing the MPEG2RecordingSink object as the refcon.
+//
+///////////////////////////////////////////////////////////////////////////////////////
+
+enum
+{
+	// Buffer sizes are rounded up to a multiple of this many packets,
+	// so every full buffer is a multiple of the VM page size, with or
+	// without source packet headers.
+	kMPEG2RecordingSinkPacketsPerBufferGranularity = 1024,
+	
+	// Defaults for the write buffer pool (about 3MB per buffer)
+	kMPEG2RecordingSinkDefaultPacketsPerBuffer = 16384,
+	kMPEG2RecordingSinkDefaultNumBuffers = 8
+};
+
+// Struct to hold the sink's stats
+struct MPEG2RecordingSinkStats
+{
+	UInt64 bytesReceived;		// Total bytes pushed into the sink
+	UInt64 bytesWritten;		// Total bytes written to the file
+	UInt64 bytesDropped;		// Bytes dropped because no write buffer was available
+	UInt32 backlogBytes;		// Bytes received, but not yet written
+	UInt32 maxBacklogBytes;		// The high-water mark of backlogBytes
+	UInt32 buffersWritten;		// Number of buffer writes done by the writer thread
+	UInt32 writeErrors;			// Number of buffer writes that failed (the recording stops at the first one)
+};
+
+//
+// The MPEG2RecordingSink Class Declaration
+//
+class MPEG2RecordingSink
+{
+	
+public:
+	// Constructor
+	MPEG2RecordingSink(StringLogger *stringLogger = nil,
+					   UInt32 packetsPerBuffer = kMPEG2RecordingSinkDefaultPacketsPerBuffer,
+					   UInt32 numBuffers = kMPEG2RecordingSinkDefaultNumBuffers,
+					   bool includeSPH = false);
+	
+	// Destructor
+	~MPEG2RecordingSink();
+	
+	// Allocate the write buffers, create the file, and start the writer thread
+	IOReturn openFile(const char *pFileName);
+	
+	// Write any partially filled buffer, stop the writer thread, and close the file
+	IOReturn closeFile(void);
+	
+	// Push received packets into the sink. Safe to call from the isoch callback thread.
+	IOReturn pushTSPackets(UInt32 tsPacketCount, UInt32 **ppBuf);
+	
+	// Get a snapshot of the sink's stats
+	IOReturn getStats(MPEG2RecordingSinkStats *pStats);
+	
+	// Helpers that can be registered as MPEG2Receiver data push callbacks (pRefCon is the MPEG2RecordingSink)
+	static IOReturn DataPush(UInt32 tsPacketCount, UInt32 **ppBuf, void *pRefCon);
+	static IOReturn SpanDataPush(UInt32 packetCount, MPEGReceivePacketDescriptor *pPackets, void *pRefCon);
+	
+	// Writer thread entry point
+	void WriterThread(void);
+	
+private:
+	
+	// Hand the current fill buffer to the writer thread
+	void submitFillBuffer(void);
+	
+	// Recompute backlogBytes and maxBacklogBytes
+	void updateBacklog(void);
+	
+	// Write a whole buffer to the file, at fileOffset
+	bool writeBuffer(UInt8 *pWriteBuffer, UInt32 writeLength);
+	
+	// Free the write buffers
+	void releaseBuffers(void);
+	
+	StringLogger *logger;
+	bool noLogger;
+	
+	int fileDescriptor;
+	UInt32 packetSize;
+	UInt32 bufferSize;
+	UInt32 numWriteBuffers;
+	UInt8 **ppWriteBuffers;
+	UInt32 *pWriteBufferLengths;
+	
+	// The buffers are filled and written in order. The writer thread
+	// writes buffer writeIndex, and the next numFullBuffers after it.
+	// The isoch thread fills buffer fillIndex, when one is available.
+	UInt32 fillIndex;
+	UInt32 writeIndex;
+	UInt32 numFullBuffers;
+	
+	off_t fileOffset;
+	pthread_t writerThread;
+	bool writerThreadRunning;
+	volatile bool writerThreadShouldExit;
+	bool writeFailed;
+	pthread_mutex_t bufferQueueMutex;
+	pthread_cond_t bufferQueueCondition;
+	
+	MPEG2RecordingSinkStats stats;
+};
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_MPEG2RECORDINGSINK__
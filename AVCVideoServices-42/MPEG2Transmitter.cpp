@@ -87,6 +87,30 @@ static void	MPEG2XmitForceStopHandler_Helper( IOFireWireLibIsochChannelRef inter
 #define kMaxNuDCLsPerNotify 30
 #endif
 
+//////////////////////////////////////////////////////
+// StatsDumpTimeoutHelper
+//////////////////////////////////////////////////////
+static void StatsDumpTimeoutHelper(CFRunLoopTimerRef timer, void *data)
+{
+	MPEG2Transmitter *pTransmitter = (MPEG2Transmitter*) data;
+	pTransmitter->StatsDumpTimeout();
+}
+
+//////////////////////////////////////////////////////
+// StatsHistogramBin
+//////////////////////////////////////////////////////
+static UInt32 StatsHistogramBin(UInt32 value)
+{
+	UInt32 bin = 0;
+	
+	while ((value != 0) && (bin < (kMPEG2TransmitterStatsHistogramBins-1)))
+	{
+		value >>= 1;
+		bin += 1;
+	}
+	return bin;
+}
+
 //////////////////////////////////////////////////////
 // Constructor
 //////////////////////////////////////////////////////
@@ -122,10 +146,17 @@ MPEG2Transmitter::MPEG2Transmitter(StringLogger *stringLogger,
 	pProgramDCLs = nil;
 	nuDCLPool = nil;
 	encryptionProc = nil;
+	segmentEncryptionProc = nil;
+	pSegmentEncryptionProcRefCon = nil;
+	ppSegmentEncryptionPackets = nil;
+	pSegmentEncryptionCyclePacketCounts = nil;
+	pSegmentEncryptionSy = nil;
 #else
 	dclCommandPool = nil;
 	pFirstCycleObject = nil;
 	ppCallbackCycles = nil;
+	pPacketQueueBuf = nil;
+	pPacketQueueHead = nil;
 #endif
 	
 	if (stringLogger == nil)
@@ -155,11 +186,26 @@ MPEG2Transmitter::MPEG2Transmitter(StringLogger *stringLogger,
 		tsPacketsPerCycle = kMaxTSPacketsPerCycle;
 	else
 		tsPacketsPerCycle = packetsPerCycle;
-#else
-	// Calculate the size of the DCL command pool needed
-	dclCommandPoolSize = ((((isochCyclesPerSegment*6)*isochSegments)+(isochSegments*6)+16)*32);
 #endif
 	
+	adaptiveSegmentSizing = false;
+	segmentSizingInfo.minCyclesPerSegment = kMPEG2TransmitterAdaptiveMinCyclesPerSegment;
+	segmentSizingInfo.maxCyclesPerSegment = kMPEG2TransmitterAdaptiveMaxCyclesPerSegment;
+	segmentSizingInfo.maxLatencyInCycles = kMPEG2TransmitterAdaptiveMaxLatencyInCycles;
+	segmentSizingInfo.maxCallbackLoadPercent = kMPEG2TransmitterAdaptiveMaxCallbackLoadPercent;
+	segmentSizingInfo.nextCyclesPerSegment = isochCyclesPerSegment;
+	segmentSizingInfo.nextNumSegments = isochSegments;
+	segmentSizingInfo.retuneCount = 0;
+	segmentSizingInfo.latencyLimited = false;
+	resetSegmentSizingMeasurements();
+
+	statsResetRequested = false;
+	statsDumpTimer = nil;
+	statsDumpProc = nil;
+	pStatsDumpRefCon = nil;
+	clearStats();
+	publishStats();
+	pthread_mutex_init(&statsDumpTimerMutex,NULL);
 }
 
 //////////////////////////////////////////////////////
@@ -167,17 +213,12 @@ MPEG2Transmitter::MPEG2Transmitter(StringLogger *stringLogger,
 //////////////////////////////////////////////////////
 MPEG2Transmitter::~MPEG2Transmitter()
 {
-
-#ifndef kAVS_Use_NuDCL_Mpeg2Transmitter
-	// Local Vars
-	MPEG2XmitCycle *pXmitCycle;
-	unsigned int i;
-	TSPacket *pTSPacket;
-#endif
-	
 	if (transportState != kMpeg2TransmitterTransportStopped)
 		stopTransmit();
 
+	// Stop the stats dump timer
+	stopStatsDump();
+
 	// Remove isoch callback dispatcher from runloop
 	if (nodeNubInterface != nil)
 		(*nodeNubInterface)->RemoveIsochCallbackDispatcherFromRunLoop(nodeNubInterface);
@@ -186,6 +227,38 @@ MPEG2Transmitter::~MPEG2Transmitter()
 	if (nodeNubInterface != nil)
 		(*nodeNubInterface)->RemoveCallbackDispatcherFromRunLoop(nodeNubInterface);
 	
+	// Release the DCL program, buffers, ports and channel
+	releaseIsochProgram();
+	
+	// Free the psi table parser object
+	delete psiTables;
+
+	// If we created an internall logger, free it
+	if (noLogger == true)
+		delete logger;
+
+	if (nodeNubInterface != nil)
+		(*nodeNubInterface)->Release(nodeNubInterface);
+
+	// Release the transport control mutex
+	pthread_mutex_destroy(&transportControlMutex);
+
+	// Release the stats dump timer mutex
+	pthread_mutex_destroy(&statsDumpTimerMutex);
+}
+
+//////////////////////////////////////////////////////
+// releaseIsochProgram
+//////////////////////////////////////////////////////
+void MPEG2Transmitter::releaseIsochProgram(void)
+{
+#ifndef kAVS_Use_NuDCL_Mpeg2Transmitter
+	// Local Vars
+	MPEG2XmitCycle *pXmitCycle;
+	unsigned int i;
+	TSPacket *pTSPacket;
+#endif
+	
 	if (isochChannel)
 	{
 #ifdef kAVS_Enable_ForceStop_Handler	
@@ -193,29 +266,35 @@ MPEG2Transmitter::~MPEG2Transmitter()
 		(*isochChannel)->TurnOffNotification(isochChannel);
 #endif
 		(*isochChannel)->Release(isochChannel);
+		isochChannel = nil;
 	}
 
 	if (localIsocPort)
+	{
 		(*localIsocPort)->Release(localIsocPort);
+		localIsocPort = nil;
+	}
 
 	if (remoteIsocPort)
+	{
 		(*remoteIsocPort)->Release(remoteIsocPort);
+		remoteIsocPort = nil;
+	}
 
 #ifdef kAVS_Use_NuDCL_Mpeg2Transmitter
 	if (nuDCLPool)
+	{
 		(*nuDCLPool)->Release(nuDCLPool);
+		nuDCLPool = nil;
+	}
 #else	
 	if (dclCommandPool)
+	{
 		(*dclCommandPool)->Release(dclCommandPool);
+		dclCommandPool = nil;
+	}
 #endif
 	
-	// Free the psi table parser object
-	delete psiTables;
-
-	// If we created an internall logger, free it
-	if (noLogger == true)
-		delete logger;
-
 #ifdef kAVS_Use_NuDCL_Mpeg2Transmitter	
 	// Free the vm allocated DCL buffer
 	if (pTransmitBuffer != nil)
@@ -238,83 +317,95 @@ MPEG2Transmitter::~MPEG2Transmitter()
 				delete pXmitCycle;
 			}
 		}
+		pFirstCycleObject = nil;
 	}
 #endif
+	pTransmitBuffer = nil;
 	
-	if (nodeNubInterface != nil)
-		(*nodeNubInterface)->Release(nodeNubInterface);
-
 #ifdef kAVS_Use_NuDCL_Mpeg2Transmitter	
 	if (pProgramDCLs)
+	{
 		delete [] pProgramDCLs;
+		pProgramDCLs = nil;
+	}
+	
+	// The TSPacketBuf objects are about to be freed, so release the fifos
+	packetQueues.release();
 	
 	if (pTSPacketBufArray)
+	{
 		delete [] pTSPacketBufArray;
+		pTSPacketBufArray = nil;
+	}
+	
+	if (ppSegmentEncryptionPackets)
+	{
+		delete [] ppSegmentEncryptionPackets;
+		ppSegmentEncryptionPackets = nil;
+	}
+	
+	if (pSegmentEncryptionCyclePacketCounts)
+	{
+		delete [] pSegmentEncryptionCyclePacketCounts;
+		pSegmentEncryptionCyclePacketCounts = nil;
+	}
+	
+	if (pSegmentEncryptionSy)
+	{
+		delete [] pSegmentEncryptionSy;
+		pSegmentEncryptionSy = nil;
+	}
 	
 	if (pSegUpdateBags)
 	{
 		// Release bags
 		for (UInt32 seg=0;seg<isochSegments;seg++)
-			CFRelease(pSegUpdateBags[seg]);
+			if (pSegUpdateBags[seg])
+				CFRelease(pSegUpdateBags[seg]);
 		
 		// Release array
 		delete [] pSegUpdateBags;
+		pSegUpdateBags = nil;
 	}
 #else
 	// Delete transport stream  packet processing queue buffers
 	if (pPacketQueueBuf != nil)
+	{
 		vm_deallocate(mach_task_self(), (vm_address_t) pPacketQueueBuf,
 				(numTSPacketsInPacketQueue*kMPEG2TSPacketSize));
+		pPacketQueueBuf = nil;
+	}
 
 	// Delete transport stream packet queue
-	for (i=0;i<numTSPacketsInPacketQueue;i++)
+	if (pPacketQueueHead != nil)
 	{
-		pTSPacket = pPacketQueueHead;
-		pPacketQueueHead = pPacketQueueHead->pNext;
-		if (pTSPacket)
-			delete pTSPacket;
+		for (i=0;i<numTSPacketsInPacketQueue;i++)
+		{
+			pTSPacket = pPacketQueueHead;
+			pPacketQueueHead = pPacketQueueHead->pNext;
+			if (pTSPacket)
+				delete pTSPacket;
+		}
+		pPacketQueueHead = nil;
 	}
 	
 	// Free the list of end-of-segment MPEG2XmitCycle pointers
 	if (ppCallbackCycles)
+	{
 		delete [] ppCallbackCycles;
+		ppCallbackCycles = nil;
+	}
 #endif
-	
-	// Release the transport control mutex
-	pthread_mutex_destroy(&transportControlMutex);
 }
 
 //////////////////////////////////////////////////////
 // setupIsocTransmitter
 //////////////////////////////////////////////////////
-IOReturn MPEG2Transmitter::setupIsocTransmitter(void)
+IOReturn MPEG2Transmitter::setupIsocTransmitter(CFRunLoopRef isochRunLoopRef)
 {
 	// Local Vars
 	IOReturn result = kIOReturnSuccess ;
-	UInt32 totalObjects = isochCyclesPerSegment * isochSegments;
-    UInt8 *pBuffer = nil;
-    UInt32 i;
-	IOVirtualRange bufRange;
 	IOFireWireLibNubRef newNubInterface;
-	
-#ifdef kAVS_Use_NuDCL_Mpeg2Transmitter	
-	UInt32 programDCLCount;
-	NuDCLSendPacketRef thisDCL;
-	UInt32 seg;
-	UInt32 cycle;
-#else
-    DCLCommandStruct *pLastDCL = nil;
-	MPEG2XmitCycle *pCycleObject = nil;
-    MPEG2XmitCycle *pLastCycleObject = nil;
-    DCLJumpPtr jumpDCL;
-	TSPacket *pTSPacket = nil;
-	TSPacket *pLastTSPacket = nil;
-	unsigned char *pPacketQueueBufCharPtr;
-	bool hasCallback;
-	UInt32 segment = 0;
-	UInt32 transmitBufferSize;
-	UInt32 endOfCycleIndex = 0;
-#endif
 
 	// Either create a new local node device interface, or duplicate the passed-in device interface
 	if (nodeNubInterface == nil)
@@ -337,8 +428,8 @@ IOReturn MPEG2Transmitter::setupIsocTransmitter(void)
 		nodeNubInterface = newNubInterface;
 	}
 
-	// Save a reference to the current run loop
-	runLoopRef = CFRunLoopGetCurrent();
+	// Save a reference to the run loop we'll use for callbacks
+	runLoopRef = (isochRunLoopRef != nil) ? isochRunLoopRef : CFRunLoopGetCurrent();
 
 	// Install a asynch callback dispatcher to this thread's run loop
 	result = (*nodeNubInterface)->AddCallbackDispatcherToRunLoop( nodeNubInterface, runLoopRef ) ;
@@ -346,6 +437,48 @@ IOReturn MPEG2Transmitter::setupIsocTransmitter(void)
 	// Install a isoc callback dispatcher to this thread's run loop
 	result = (*nodeNubInterface)->AddIsochCallbackDispatcherToRunLoop( nodeNubInterface, runLoopRef ) ;
 
+	// Create the DCL program, buffers, ports and channel
+	result = createIsochProgram();
+	
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// createIsochProgram
+//////////////////////////////////////////////////////
+IOReturn MPEG2Transmitter::createIsochProgram(void)
+{
+	// Local Vars
+	IOReturn result = kIOReturnSuccess ;
+	UInt32 totalObjects = isochCyclesPerSegment * isochSegments;
+    UInt8 *pBuffer = nil;
+    UInt32 i;
+	IOVirtualRange bufRange;
+	
+#ifdef kAVS_Use_NuDCL_Mpeg2Transmitter	
+	UInt32 programDCLCount;
+	NuDCLSendPacketRef thisDCL;
+	UInt32 seg;
+	UInt32 cycle;
+#else
+    DCLCommandStruct *pLastDCL = nil;
+	MPEG2XmitCycle *pCycleObject = nil;
+    MPEG2XmitCycle *pLastCycleObject = nil;
+    DCLJumpPtr jumpDCL;
+	TSPacket *pTSPacket = nil;
+	TSPacket *pLastTSPacket = nil;
+	unsigned char *pPacketQueueBufCharPtr;
+	bool hasCallback;
+	UInt32 segment = 0;
+	UInt32 transmitBufferSize;
+	UInt32 endOfCycleIndex = 0;
+#endif
+
+#ifndef kAVS_Use_NuDCL_Mpeg2Transmitter
+	// Calculate the size of the DCL command pool needed
+	dclCommandPoolSize = ((((isochCyclesPerSegment*6)*isochSegments)+(isochSegments*6)+16)*32);
+#endif
+
 #ifdef kAVS_Use_NuDCL_Mpeg2Transmitter	
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	//
@@ -367,13 +500,19 @@ IOReturn MPEG2Transmitter::setupIsocTransmitter(void)
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	
 	// Calculate the number of TSPacketBuf objects we need, and allocate an array of them
-	numTSPacketBuf = numTSPacketsInPacketQueue + (tsPacketsPerCycle*totalObjects);
+	numTSPacketBuf = TSPacketBufQueues::numTSPacketBufForProgram(numTSPacketsInPacketQueue,tsPacketsPerCycle,totalObjects);
 	pTSPacketBufArray = new TSPacketBuf[numTSPacketBuf];
 	if (!pTSPacketBufArray)
 	{
 		return kIOReturnNoMemory ;
 	}
 	
+	// Allocate the fifos. Each one must be able to hold every TSPacketBuf object.
+	if (packetQueues.allocate(numTSPacketBuf) != kIOReturnSuccess)
+	{
+		return kIOReturnNoMemory ;
+	}
+	
 	// Allocate an array to hold pointers to our DCLs
 	pProgramDCLs = new NuDCLSendPacketRef[totalObjects];
 	if (!pProgramDCLs)
@@ -381,6 +520,17 @@ IOReturn MPEG2Transmitter::setupIsocTransmitter(void)
 		return kIOReturnNoMemory ;
 	}
 	
+	// Allocate the arrays used to pass a segment's worth of packets to the segment encryption callback.
+	// Note: FillCycleBuffer may put up to tsPacketsPerCycle+1 packets in a cycle.
+	ppSegmentEncryptionPackets = new UInt32*[isochCyclesPerSegment*(kMaxTSPacketsPerCycle+1)];
+	pSegmentEncryptionCyclePacketCounts = new UInt32[isochCyclesPerSegment];
+	pSegmentEncryptionSy = new UInt8[isochCyclesPerSegment];
+	if ((!ppSegmentEncryptionPackets) || (!pSegmentEncryptionCyclePacketCounts) || (!pSegmentEncryptionSy))
+	{
+		return kIOReturnNoMemory ;
+	}
+	segmentEncryptionPacketCount = 0;
+	
 	// Allocate an array of bags for end-of-segment dcl update lists
 	pSegUpdateBags = new CFMutableSetRef[isochSegments];
 	if (!pSegUpdateBags)
@@ -432,7 +582,7 @@ IOReturn MPEG2Transmitter::setupIsocTransmitter(void)
 		pTSPacketBufArray[i].pBuf = pNextSourcePacketBuffer;
 		pNextSourcePacketBuffer += 192;
 		
-		freeFifo.push_back(&pTSPacketBufArray[i]);
+		packetQueues.addFreePacket(&pTSPacketBufArray[i]);
 	}
 	
 	// Use the nub interface to create a NuDCL command pool object
@@ -831,6 +981,19 @@ MPEG2Transmitter::startTransmit(void)
 		return kIOReturnExclusiveAccess;
 	}
 	
+	// If doing adaptive segment sizing, rebuild the DCL program
+	// if the measurements from the last run call for a new geometry
+	if (adaptiveSegmentSizing == true)
+	{
+		result = applySegmentSizing();
+		if (result != kIOReturnSuccess)
+		{
+			// Unlock the transport control mutex
+			pthread_mutex_unlock(&transportControlMutex);
+			return result;
+		}
+	}
+
 	// Prepare for transmit
 	prepareForTransmit();
 	
@@ -927,6 +1090,483 @@ IOReturn MPEG2Transmitter::registerTimeStampCallback(MPEG2TransmitterTimeStampPr
 	return kIOReturnSuccess;
 }
 
+//////////////////////////////////////////////////////////////////////
+// setAdaptiveSegmentSizing
+//////////////////////////////////////////////////////////////////////
+IOReturn MPEG2Transmitter::setAdaptiveSegmentSizing(bool enable,
+													unsigned int minCyclesPerSegment,
+													unsigned int maxCyclesPerSegment,
+													unsigned int maxLatencyInCycles,
+													unsigned int maxCallbackLoadPercent)
+{
+	if ((minCyclesPerSegment == 0) ||
+		(minCyclesPerSegment > maxCyclesPerSegment) ||
+		((maxCyclesPerSegment*kMPEG2TransmitterAdaptiveMinSegments) > kMPEG2TransmitterAdaptiveMaxProgramCycles) ||
+		((minCyclesPerSegment*kMPEG2TransmitterAdaptiveMinSegments) > maxLatencyInCycles) ||
+		(maxCallbackLoadPercent == 0) ||
+		(maxCallbackLoadPercent > 100))
+		return kIOReturnBadArgument;
+	
+	// Lock the transport control mutex
+	pthread_mutex_lock(&transportControlMutex);
+	
+	adaptiveSegmentSizing = enable;
+	segmentSizingInfo.minCyclesPerSegment = minCyclesPerSegment;
+	segmentSizingInfo.maxCyclesPerSegment = maxCyclesPerSegment;
+	segmentSizingInfo.maxLatencyInCycles = maxLatencyInCycles;
+	segmentSizingInfo.maxCallbackLoadPercent = maxCallbackLoadPercent;
+	
+	// Start with a fresh set of measurements
+	segmentSizingInfo.nextCyclesPerSegment = isochCyclesPerSegment;
+	segmentSizingInfo.nextNumSegments = isochSegments;
+	segmentSizingInfo.latencyLimited = false;
+	resetSegmentSizingMeasurements();
+	
+	// Unlock the transport control mutex
+	pthread_mutex_unlock(&transportControlMutex);
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// getSegmentSizingInfo
+//////////////////////////////////////////////////////////////////////
+IOReturn MPEG2Transmitter::getSegmentSizingInfo(MPEG2TransmitterSegmentSizingInfo *pInfo)
+{
+	if (!pInfo)
+		return kIOReturnBadArgument;
+	
+	*pInfo = segmentSizingInfo;
+	pInfo->adaptiveModeEnabled = adaptiveSegmentSizing;
+	pInfo->cyclesPerSegment = isochCyclesPerSegment;
+	pInfo->numSegments = isochSegments;
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// resetSegmentSizingMeasurements
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::resetSegmentSizingMeasurements(void)
+{
+	totalServiceTimeInMicroseconds = 0;
+	segmentSizingInfo.callbacksMeasured = 0;
+	segmentSizingInfo.lastServiceTimeInMicroseconds = 0;
+	segmentSizingInfo.avgServiceTimeInMicroseconds = 0;
+	segmentSizingInfo.maxServiceTimeInMicroseconds = 0;
+	segmentSizingInfo.lastCallbackLatencyInCycles = 0;
+	segmentSizingInfo.maxCallbackLatencyInCycles = 0;
+	segmentSizingInfo.minSlackInCycles = 0xFFFFFFFF;
+	segmentSizingInfo.timeStampAdjusts = 0;
+	segmentSizingInfo.overruns = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// measureSegmentCallback
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::measureSegmentCallback(AbsoluteTime callbackStartUpTime, UInt32 callbackStartCycleTime, UInt32 segmentTimeStamp)
+{
+	UInt32 serviceTime;
+	UInt32 latency;
+	UInt32 delay;
+	UInt32 programSlack;
+	
+	// How long did we spend in the callback?
+	serviceTime = (UInt32) (UnsignedWideToUInt64(AbsoluteDeltaToNanoseconds(UpTime(), callbackStartUpTime)) / 1000);
+	
+	// How many cycles after the end of the segment did the callback start? Only
+	// the cycle-count field is used, so this is valid for latencies under one second.
+	latency = ((((callbackStartCycleTime & 0x01FFF000) >> 12) + 8000) - ((segmentTimeStamp & 0x01FFF000) >> 12)) % 8000;
+	
+	// Update the callback timing stats
+	stats.segmentCallbacks += 1;
+	stats.callbackLatencyInCycles[StatsHistogramBin(latency)] += 1;
+	stats.callbackServiceTimeInMicroseconds[StatsHistogramBin(serviceTime)] += 1;
+	if (latency > stats.maxCallbackLatencyInCycles)
+		stats.maxCallbackLatencyInCycles = latency;
+	if (serviceTime > stats.maxCallbackServiceTimeInMicroseconds)
+		stats.maxCallbackServiceTimeInMicroseconds = serviceTime;
+
+	// The rest is only for adaptive segment sizing
+	if (adaptiveSegmentSizing == false)
+		return;
+
+	segmentSizingInfo.callbacksMeasured += 1;
+	totalServiceTimeInMicroseconds += serviceTime;
+	segmentSizingInfo.lastServiceTimeInMicroseconds = serviceTime;
+	segmentSizingInfo.avgServiceTimeInMicroseconds = (UInt32) (totalServiceTimeInMicroseconds / segmentSizingInfo.callbacksMeasured);
+	if (serviceTime > segmentSizingInfo.maxServiceTimeInMicroseconds)
+		segmentSizingInfo.maxServiceTimeInMicroseconds = serviceTime;
+	
+	segmentSizingInfo.lastCallbackLatencyInCycles = latency;
+	if (latency > segmentSizingInfo.maxCallbackLatencyInCycles)
+		segmentSizingInfo.maxCallbackLatencyInCycles = latency;
+	
+	// The callback for a segment must finish before the DCL program runs through
+	// all of the other segments and into the overrun DCL. Track how close we came.
+	delay = latency + ((serviceTime + 124) / 125);	// 125 microseconds per cycle
+	programSlack = (isochSegments-1)*isochCyclesPerSegment;
+	if (delay < programSlack)
+		programSlack -= delay;
+	else
+		programSlack = 0;
+	if (programSlack < segmentSizingInfo.minSlackInCycles)
+		segmentSizingInfo.minSlackInCycles = programSlack;
+}
+
+//////////////////////////////////////////////////////////////////////
+// chooseSegmentSizing
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::chooseSegmentSizing(void)
+{
+	UInt32 worstDelayInCycles;
+	UInt32 requiredSlackInCycles;
+	UInt32 loadBoundInCycles;
+	UInt32 newCyclesPerSegment;
+	UInt32 newNumSegments;
+	UInt32 latencyBoundInCycles;
+	
+	// Nothing measured, nothing to change
+	if ((segmentSizingInfo.callbacksMeasured == 0) && (segmentSizingInfo.overruns == 0))
+		return;
+	
+	// The worst observed delay from the end of a segment until its callback finished
+	worstDelayInCycles = segmentSizingInfo.maxCallbackLatencyInCycles +
+		((segmentSizingInfo.maxServiceTimeInMicroseconds + 124) / 125);
+	
+	// If we overran, the delay exceeded all of the slack the current program had
+	if ((segmentSizingInfo.overruns > 0) && (worstDelayInCycles < ((isochSegments-1)*isochCyclesPerSegment)))
+		worstDelayInCycles = (isochSegments-1)*isochCyclesPerSegment;
+	
+	requiredSlackInCycles = worstDelayInCycles * kMPEG2TransmitterAdaptiveSafetyFactor;
+	
+	// The smallest segment that keeps the callback CPU load under the bound:
+	// avgServiceTime / (cyclesPerSegment * 125us) <= maxCallbackLoadPercent / 100
+	loadBoundInCycles = segmentSizingInfo.maxCallbackLoadPercent * 125;
+	newCyclesPerSegment = ((segmentSizingInfo.avgServiceTimeInMicroseconds * 100) + loadBoundInCycles - 1) / loadBoundInCycles;
+	
+	// Round up to our granularity, to avoid rebuilding the program for small changes
+	newCyclesPerSegment = ((newCyclesPerSegment + kMPEG2TransmitterAdaptiveCyclesPerSegmentGranularity - 1) /
+		kMPEG2TransmitterAdaptiveCyclesPerSegmentGranularity) * kMPEG2TransmitterAdaptiveCyclesPerSegmentGranularity;
+	
+	if (newCyclesPerSegment < segmentSizingInfo.minCyclesPerSegment)
+		newCyclesPerSegment = segmentSizingInfo.minCyclesPerSegment;
+	else if (newCyclesPerSegment > segmentSizingInfo.maxCyclesPerSegment)
+		newCyclesPerSegment = segmentSizingInfo.maxCyclesPerSegment;
+	
+	// Use enough segments that all but one of them cover the required slack
+	newNumSegments = ((requiredSlackInCycles + newCyclesPerSegment - 1) / newCyclesPerSegment) + 1;
+	if (newNumSegments < kMPEG2TransmitterAdaptiveMinSegments)
+		newNumSegments = kMPEG2TransmitterAdaptiveMinSegments;
+	
+	// Never exceed the max program length, or the client's latency bound
+	latencyBoundInCycles = segmentSizingInfo.maxLatencyInCycles;
+	if (latencyBoundInCycles > kMPEG2TransmitterAdaptiveMaxProgramCycles)
+		latencyBoundInCycles = kMPEG2TransmitterAdaptiveMaxProgramCycles;
+	
+	segmentSizingInfo.latencyLimited = false;
+	if ((newCyclesPerSegment*newNumSegments) > latencyBoundInCycles)
+	{
+		if ((newCyclesPerSegment*newNumSegments) > segmentSizingInfo.maxLatencyInCycles)
+			segmentSizingInfo.latencyLimited = true;
+		
+		// Fewer segments first. If even the minimum number of segments is too
+		// long, shrink the segments, but not below the configured minimum.
+		newNumSegments = latencyBoundInCycles / newCyclesPerSegment;
+		if (newNumSegments < kMPEG2TransmitterAdaptiveMinSegments)
+		{
+			newNumSegments = kMPEG2TransmitterAdaptiveMinSegments;
+			newCyclesPerSegment = latencyBoundInCycles / kMPEG2TransmitterAdaptiveMinSegments;
+			if (newCyclesPerSegment < segmentSizingInfo.minCyclesPerSegment)
+				newCyclesPerSegment = segmentSizingInfo.minCyclesPerSegment;
+		}
+	}
+	
+	if (segmentSizingInfo.latencyLimited == true)
+		logger->log("MPEG2Transmitter adaptive segment sizing, latency bound of %u cycles limits slack to %u cycles, %u needed\n",
+					(unsigned int) segmentSizingInfo.maxLatencyInCycles,
+					(unsigned int) ((newNumSegments-1)*newCyclesPerSegment),
+					(unsigned int) requiredSlackInCycles);
+	
+	segmentSizingInfo.nextCyclesPerSegment = newCyclesPerSegment;
+	segmentSizingInfo.nextNumSegments = newNumSegments;
+}
+
+//////////////////////////////////////////////////////////////////////
+// applySegmentSizing
+//////////////////////////////////////////////////////////////////////
+IOReturn MPEG2Transmitter::applySegmentSizing(void)
+{
+	IOReturn result = kIOReturnSuccess ;
+	UInt32 oldCyclesPerSegment = isochCyclesPerSegment;
+	UInt32 oldNumSegments = isochSegments;
+	
+	chooseSegmentSizing();
+	
+	if ((segmentSizingInfo.nextCyclesPerSegment != isochCyclesPerSegment) ||
+		(segmentSizingInfo.nextNumSegments != isochSegments))
+	{
+		logger->log("MPEG2Transmitter adaptive segment sizing, old: %u x %u cycles  new: %u x %u cycles\n",
+					(unsigned int) isochSegments,
+					(unsigned int) isochCyclesPerSegment,
+					(unsigned int) segmentSizingInfo.nextNumSegments,
+					(unsigned int) segmentSizingInfo.nextCyclesPerSegment);
+	
+		// Tear down the current DCL program, and build one with the new geometry
+		releaseIsochProgram();
+		isochCyclesPerSegment = segmentSizingInfo.nextCyclesPerSegment;
+		isochSegments = segmentSizingInfo.nextNumSegments;
+		result = createIsochProgram();
+		if (result == kIOReturnSuccess)
+			segmentSizingInfo.retuneCount += 1;
+		else
+		{
+			logger->log("\nMPEG2Transmitter Error: Error rebuilding DCL program for adaptive segment sizing: 0x%08X\n\n",result);
+	
+			// Fall back to the previous geometry
+			releaseIsochProgram();
+			isochCyclesPerSegment = oldCyclesPerSegment;
+			isochSegments = oldNumSegments;
+			segmentSizingInfo.nextCyclesPerSegment = oldCyclesPerSegment;
+			segmentSizingInfo.nextNumSegments = oldNumSegments;
+			result = createIsochProgram();
+		}
+	}
+	
+	// Measure the new program from scratch
+	resetSegmentSizingMeasurements();
+	
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////
+// beginStatsUpdate
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::beginStatsUpdate(void)
+{
+	// Handle a reset requested while we were running
+	if (statsResetRequested == true)
+	{
+		clearStats();
+		statsResetRequested = false;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// publishStats
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::publishStats(void)
+{
+	statsLock.publish(&publishedStats, &stats, sizeof(MPEG2TransmitterStats));
+}
+
+//////////////////////////////////////////////////////////////////////
+// clearStats
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::clearStats(void)
+{
+	bzero(&stats, sizeof(MPEG2TransmitterStats));
+	stats.minAnalysisFifoDepth = 0xFFFFFFFF;
+	stats.minFreeFifoDepth = 0xFFFFFFFF;
+}
+
+//////////////////////////////////////////////////////////////////////
+// countTransmitCycle
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::countTransmitCycle(UInt32 numPackets, bool hadFetchError)
+{
+	stats.cycles += 1;
+	if (numPackets == 0)
+		stats.cipOnlyCycles += 1;
+	if (hadFetchError == true)
+		stats.fetchErrorCycles += 1;
+	stats.tsPacketsTransmitted += numPackets;
+	if (numPackets < kMPEG2TransmitterStatsPacketsPerCycleBins)
+		stats.packetsPerCycle[numPackets] += 1;
+	else
+		stats.packetsPerCycle[kMPEG2TransmitterStatsPacketsPerCycleBins-1] += 1;
+}
+
+//////////////////////////////////////////////////////////////////////
+// getStats
+//////////////////////////////////////////////////////////////////////
+IOReturn MPEG2Transmitter::getStats(MPEG2TransmitterStats *pStats)
+{
+	if (!pStats)
+		return kIOReturnBadArgument;
+	
+	// The DCL program's thread never publishes from inside a client
+	// callback, so this can't spin forever if called from one
+	statsLock.read(pStats, &publishedStats, sizeof(MPEG2TransmitterStats));
+	
+	pStats->mpegDataRate = mpegDataRate;
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// resetStats
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::resetStats(void)
+{
+	// Lock the transport control mutex
+	pthread_mutex_lock(&transportControlMutex);
+	
+	// If we're stopped nobody is writing the stats, so clear them here.
+	// Otherwise let the DCL program's thread clear them on its next update.
+	if (transportState == kMpeg2TransmitterTransportStopped)
+	{
+		clearStats();
+		publishStats();
+	}
+	else
+		statsResetRequested = true;
+	
+	// Unlock the transport control mutex
+	pthread_mutex_unlock(&transportControlMutex);
+}
+
+//////////////////////////////////////////////////////////////////////
+// logStats
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::logStats(MPEG2TransmitterStats *pStats)
+{
+	MPEG2TransmitterStats snapshot;
+	UInt32 i;
+	
+	if (pStats == nil)
+	{
+		getStats(&snapshot);
+		pStats = &snapshot;
+	}
+	
+	logger->log("MPEG2Transmitter Stats: rate=%.0f cycles=%llu cipOnly=%llu fetchErrorCycles=%llu tsPackets=%llu fetchErrors=%llu badHeaders=%u\n",
+				pStats->mpegDataRate,
+				pStats->cycles,
+				pStats->cipOnlyCycles,
+				pStats->fetchErrorCycles,
+				pStats->tsPacketsTransmitted,
+				pStats->packetFetchErrors,
+				(unsigned int) pStats->invalidPacketHeaders);
+	logger->log("MPEG2Transmitter Stats: callbacks=%u maxLatency=%u cycles maxService=%u us tsAdjusts=%u recoveries=%u (%u cycles) resyncs=%u overruns=%u\n",
+				(unsigned int) pStats->segmentCallbacks,
+				(unsigned int) pStats->maxCallbackLatencyInCycles,
+				(unsigned int) pStats->maxCallbackServiceTimeInMicroseconds,
+				(unsigned int) pStats->timeStampAdjusts,
+				(unsigned int) pStats->lostCycleRecoveries,
+				(unsigned int) pStats->lostCyclesRecovered,
+				(unsigned int) pStats->sphResyncs,
+				(unsigned int) pStats->dclOverruns);
+	logger->log("MPEG2Transmitter Stats: analysisFifo=%u (min %u) xmitFifo=%u (max %u) freeFifo=%u (min %u) rateChanges=%u psiRescans=%u\n",
+				(unsigned int) pStats->analysisFifoDepth,
+				(unsigned int) ((pStats->minAnalysisFifoDepth == 0xFFFFFFFF) ? 0 : pStats->minAnalysisFifoDepth),
+				(unsigned int) pStats->xmitFifoDepth,
+				(unsigned int) pStats->maxXmitFifoDepth,
+				(unsigned int) pStats->freeFifoDepth,
+				(unsigned int) ((pStats->minFreeFifoDepth == 0xFFFFFFFF) ? 0 : pStats->minFreeFifoDepth),
+				(unsigned int) pStats->dataRateChanges,
+				(unsigned int) pStats->psiRescans);
+	
+	logger->log("MPEG2Transmitter Stats: latency histogram:");
+	for (i=0;i<kMPEG2TransmitterStatsHistogramBins;i++)
+		logger->log(" %u",(unsigned int) pStats->callbackLatencyInCycles[i]);
+	logger->log("\nMPEG2Transmitter Stats: service time histogram:");
+	for (i=0;i<kMPEG2TransmitterStatsHistogramBins;i++)
+		logger->log(" %u",(unsigned int) pStats->callbackServiceTimeInMicroseconds[i]);
+	logger->log("\nMPEG2Transmitter Stats: packets per cycle:");
+	for (i=0;i<kMPEG2TransmitterStatsPacketsPerCycleBins;i++)
+		logger->log(" %llu",pStats->packetsPerCycle[i]);
+	logger->log("\n");
+}
+
+//////////////////////////////////////////////////////////////////////
+// startStatsDump
+//////////////////////////////////////////////////////////////////////
+IOReturn MPEG2Transmitter::startStatsDump(double intervalInSeconds, MPEG2TransmitterStatsProc handler, void *pRefCon)
+{
+	CFRunLoopTimerContext		context;
+	CFAbsoluteTime				time;
+	
+	if (intervalInSeconds <= 0.0)
+		return kIOReturnBadArgument;
+	
+	// We need the run loop from setupIsocTransmitter
+	if (runLoopRef == nil)
+		return kIOReturnNotReady;
+	
+	// Lock the stats dump timer mutex
+	pthread_mutex_lock(&statsDumpTimerMutex);
+	
+	// Stop if necessary
+	if ( statsDumpTimer )
+	{
+		CFRunLoopTimerInvalidate( statsDumpTimer );
+		CFRelease( statsDumpTimer );
+		statsDumpTimer = NULL;
+	}
+	
+	statsDumpProc = handler;
+	pStatsDumpRefCon = pRefCon;
+	
+	context.version             = 0;
+	context.info                = this;
+	context.retain              = NULL;
+	context.release             = NULL;
+	context.copyDescription     = NULL;
+	
+	time = CFAbsoluteTimeGetCurrent() + intervalInSeconds;
+	
+	statsDumpTimer = CFRunLoopTimerCreate(NULL,
+										  time,
+										  intervalInSeconds,
+										  0,
+										  0,
+										  (CFRunLoopTimerCallBack)&StatsDumpTimeoutHelper,
+										  &context);
+	
+	if ( statsDumpTimer )
+		CFRunLoopAddTimer( runLoopRef, statsDumpTimer, kCFRunLoopDefaultMode );
+	
+	// Unlock the stats dump timer mutex
+	pthread_mutex_unlock(&statsDumpTimerMutex);
+	
+	return (statsDumpTimer != NULL) ? kIOReturnSuccess : kIOReturnNoMemory;
+}
+
+//////////////////////////////////////////////////////////////////////
+// stopStatsDump
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::stopStatsDump(void)
+{
+	// Lock the stats dump timer mutex
+	pthread_mutex_lock(&statsDumpTimerMutex);
+	
+	if ( statsDumpTimer )
+	{
+		CFRunLoopTimerInvalidate( statsDumpTimer );
+		CFRelease( statsDumpTimer );
+		statsDumpTimer = NULL;
+	}
+	
+	// Unlock the stats dump timer mutex
+	pthread_mutex_unlock(&statsDumpTimerMutex);
+}
+
+//////////////////////////////////////////////////////////////////////
+// StatsDumpTimeout
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::StatsDumpTimeout(void)
+{
+	MPEG2TransmitterStats snapshot;
+	
+	getStats(&snapshot);
+	
+	if (statsDumpProc != nil)
+		statsDumpProc(&snapshot,pStatsDumpRefCon);
+	else
+		logStats(&snapshot);
+}
+
 //////////////////////////////////////////////////////////////////////
 // prepareForTransmit
 //////////////////////////////////////////////////////////////////////
@@ -939,29 +1579,31 @@ MPEG2Transmitter::prepareForTransmit(void)
 
 #ifdef kAVS_Use_NuDCL_Mpeg2Transmitter	
 	IOReturn result;
-	TSPacketBuf *pTSPacketBuf;
 	UInt32 segment, cycle;
 	UInt32 numDCLsNotified,totalDCLsToNotify,numDCLsForThisNotify;
 #else
 	MPEG2XmitCycle *pFirstCycle;
 #endif
 	
+	// The packet fetching and cycle filling below updates the stats
+	beginStatsUpdate();
+
 	// Get the local node ID
 	do (*nodeNubInterface)->GetBusGeneration(nodeNubInterface, &generation);
 	while  ((*nodeNubInterface)->GetLocalNodeIDWithGeneration(nodeNubInterface,generation,&nodeID) != kIOReturnSuccess);
 
 	// Start with a nominal bit rate of 1 packet per cycle
 	mpegDataRate = kMaxDataRate_OneTSPacketPerCycle;
-	isochCycleClocksPerTSPacket = 24576000.0/(mpegDataRate/1504);
+	scaledClocksPerTSPacket = FWScaledClocksPerPacket(mpegDataRate, (kMPEG2TSPacketSize*8), kMPEG2TransmitterScaledClockScale);
 	
     // Note that currentIsochTime must not be initialized to a value
 	// less that zero, because the first transmit packet generated
 	// will be a CIP only! A value of 0 or greater for currentIsochTime
 	// will prevent the flow-control logic from adding source packets
 	// into the first isoch cycle.
-	currentIsochTime = 0.0;
+	currentIsochTime = 0;
 	
-    currentMPEGTime = (kMPEGSourcePacketCycleCountStartValue*3072);
+    currentMPEGTime = (kMPEGSourcePacketCycleCountStartValue*kMPEG2TransmitterScaledClocksPerCycle);
     dbcCount = 0;
 	lastPCR = 0.0;
 	packetsBetweenPCR = 0;
@@ -1000,31 +1642,25 @@ MPEG2Transmitter::prepareForTransmit(void)
 	// Make sure all TSPacketBuf objects are on the freeFifo, and that the other Fifos are empty.
 	// TODO: For the DCL overrun case, we shouldn't have to throw away everything on the analysisFifo,
 	// only what's on the xmitFifo. For now we clear both!
-	while (!xmitFifo.empty())
-	{
-		pTSPacketBuf = xmitFifo.front();
-		xmitFifo.pop_front();
-		freeFifo.push_back(pTSPacketBuf);
-	}
-	while (!analysisFifo.empty())
-	{
-		pTSPacketBuf = analysisFifo.front();
-		analysisFifo.pop_front();
-		freeFifo.push_back(pTSPacketBuf);
-	}
-	
 	// AY_DEBUG: Sanity check to ensure all TSPacketBuf objects are on the freeFifo now
-	if (freeFifo.size() != numTSPacketBuf)
-		logger->log("\nMPEG2Transmitter Error: Incorrect number of TSPacketBuf objects on freeFiFo. Expected: %d, Actual: %d\n\n",numTSPacketBuf,freeFifo.size());
+	if (packetQueues.releaseAll() == false)
+		logger->log("\nMPEG2Transmitter Error: Incorrect number of TSPacketBuf objects on freeFiFo. Expected: %d, Actual: %d\n\n",numTSPacketBuf,packetQueues.freeDepth());
 	
 	// Fill the analysis fifo with packets
 	for (i=0;i<numTSPacketsInPacketQueue;i++)
 		AddPacketToTSPacketQueue();
 	
 	// Initialize all the cycles in the program with data!
+	segmentEncryptionPacketCount = 0;
 	for (segment=0;segment<isochSegments;segment++)
+	{
 		for (cycle=0;cycle<isochCyclesPerSegment;cycle++)
 			FillCycleBuffer(pProgramDCLs[(segment*isochCyclesPerSegment)+cycle],nodeID,segment,cycle);
+		
+		// If a segment encryption proc has been installed, call it now for the packets in this segment
+		if (segmentEncryptionProc)
+			EncryptSegment(segment);
+	}
 	
 	// Do a Modification notification for all DCLs in the program (except for overrun dcl)
 	numDCLsNotified = 0;
@@ -1092,6 +1728,8 @@ MPEG2Transmitter::prepareForTransmit(void)
     }while (pNextUpdateCycle != pFirstCycle);
 #endif
 
+	publishStats();
+
 	return kIOReturnSuccess;
 }
 
@@ -1142,18 +1780,20 @@ void MPEG2Transmitter::AddPacketToTSPacketQueue(void)
 	else
 		result = -1;
 
+	if (result != kIOReturnSuccess)
+		stats.packetFetchErrors += 1;
+
 #ifdef kAVS_Use_NuDCL_Mpeg2Transmitter	
+	// Get a TSPacketBuf off the free queue
+	pTSPacketBuf = packetQueues.takeFreePacket();
+	
 	// AY_DEBUG: Sanity check to make sure we have successfully got a TSPacketBuf off the free fifo
-	if (freeFifo.empty())
+	if (!pTSPacketBuf)
 	{
 		logger->log("\nMPEG2Transmitter Error: Unable to get a TSPacketBuf off the freeFifo in AddPacketToTSPacketQueue\n\n");
 		return;
 	}
 	
-	// Get a TSPacketBuf off the free queue
-	pTSPacketBuf = freeFifo.front();
-	freeFifo.pop_front();
-	
 	// Handle the case where we were unable to get a TS packet
 	if (result != kIOReturnSuccess)
 	{
@@ -1182,6 +1822,7 @@ void MPEG2Transmitter::AddPacketToTSPacketQueue(void)
 		if (pTSPacketBuf->pBuf[4] != 0x47)
 		{
 			logger->log("MPEG2Transmitter Error: Invalid TS Packet Header!\n");
+			stats.invalidPacketHeaders += 1;
 			pTSPacketBuf->packetInfo.hasPacketFetchError = true;
 		}
 		else
@@ -1223,6 +1864,7 @@ void MPEG2Transmitter::AddPacketToTSPacketQueue(void)
 			if (packetsBetweenPCR > kMPEG2TransmitterMaxPacketsBetweenPCRs)
 			{
 				logger->log("MPEG2Transmitter: Timeout waiting for next PCR. Searching for new PSI!\n");
+				stats.psiRescans += 1;
 
 				psiTables->ResetPSITables();
 				programIndex += 1;
@@ -1237,7 +1879,7 @@ void MPEG2Transmitter::AddPacketToTSPacketQueue(void)
 	}
 	
 	// Add this TSPacketBuf to the Analysis Fifo
-	analysisFifo.push_back(pTSPacketBuf);
+	packetQueues.queueForAnalysis(pTSPacketBuf);
 #else	
 	// Handle the case where we were unable to get a TS packet
 	if (result != kIOReturnSuccess)
@@ -1267,6 +1909,7 @@ void MPEG2Transmitter::AddPacketToTSPacketQueue(void)
 		if (pTSPacket->pPacket[0] != 0x47)
 		{
 			logger->log("MPEG2Transmitter Error: Invalid TS Packet Header!\n");
+			stats.invalidPacketHeaders += 1;
 			pTSPacket->hasPacketFetchError = true;
 		}
 		else
@@ -1308,6 +1951,7 @@ void MPEG2Transmitter::AddPacketToTSPacketQueue(void)
 			if (packetsBetweenPCR > kMPEG2TransmitterMaxPacketsBetweenPCRs)
 			{
 				logger->log("MPEG2Transmitter: Timeout waiting for next PCR. Searching for new PSI!\n");
+				stats.psiRescans += 1;
 
 				psiTables->ResetPSITables();
 				programIndex += 1;
@@ -1340,21 +1984,76 @@ IOReturn MPEG2Transmitter::registerDataEncryptionCallback(MPEG2TransmitterEncryp
 	return kIOReturnSuccess;
 }
 
+//////////////////////////////////////////////////////////////////////
+// registerSegmentDataEncryptionCallback
+//////////////////////////////////////////////////////////////////////
+IOReturn MPEG2Transmitter::registerSegmentDataEncryptionCallback(MPEG2TransmitterSegmentEncryptionProc handler, void *pRefCon)
+{
+	// Lock the transport control mutex
+	pthread_mutex_lock(&transportControlMutex);
+	
+	// We can't switch between per-cycle and per-segment encryption mid-segment
+	if (transportState != kMpeg2TransmitterTransportStopped)
+	{
+		pthread_mutex_unlock(&transportControlMutex);
+		return kIOReturnNotPermitted;
+	}
+	
+	segmentEncryptionProc = handler;
+	pSegmentEncryptionProcRefCon = pRefCon;
+	
+	// Unlock the transport control mutex
+	pthread_mutex_unlock(&transportControlMutex);
+	
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////
+// EncryptSegment
+//////////////////////////////////////////////////////////////////////
+void MPEG2Transmitter::EncryptSegment(UInt32 segment)
+{
+	UInt32 cycle;
+	UInt32 *pIsochHeaderAndMask;
+	
+	// Each cycle starts out with the last SY used
+	for (cycle=0;cycle<isochCyclesPerSegment;cycle++)
+		pSegmentEncryptionSy[cycle] = lastSy;
+	
+	segmentEncryptionProc(isochCyclesPerSegment,
+						  pSegmentEncryptionCyclePacketCounts,
+						  segmentEncryptionPacketCount,
+						  ppSegmentEncryptionPackets,
+						  pSegmentEncryptionSy,
+						  pSegmentEncryptionProcRefCon);
+	
+	// Set the SY field of each cycle in the segment. Note: the DCL Modification
+	// notification for this segment will happen after this function!
+	for (cycle=0;cycle<isochCyclesPerSegment;cycle++)
+	{
+		pIsochHeaderAndMask = &pIsochHeaders[(segment*isochCyclesPerSegment*4)+(cycle*4)];
+		pIsochHeaderAndMask[0] = (pSegmentEncryptionSy[cycle] & 0xF);
+	}
+	lastSy = pSegmentEncryptionSy[isochCyclesPerSegment-1];
+	
+	// Start collecting packets for the next segment
+	segmentEncryptionPacketCount = 0;
+}
+
 //////////////////////////////////////////////////////////////////////
 // GetNextTSPacketQueuePacket
 //////////////////////////////////////////////////////////////////////
 TSPacketBuf *MPEG2Transmitter::GetNextTSPacketQueuePacket(void)
 {
-	// AY_DEBUG: Sanity check to make sure we have successfully got a TSPacketBuf off the free fifo
-	if (analysisFifo.empty())
+	TSPacketBuf *pTSPacketBuf = packetQueues.takeAnalyzedPacket();
+	
+	// AY_DEBUG: Sanity check to make sure we have successfully got a TSPacketBuf off the analysis fifo
+	if (!pTSPacketBuf)
 	{
 		logger->log("\nMPEG2Transmitter Error: Unable to get a TSPacketBuf off the analysisFifo in GetNextTSPacketQueuePacket\n\n");
 		return nil;
 	}
 	
-	TSPacketBuf *pTSPacketBuf = analysisFifo.front();
-	analysisFifo.pop_front();
-	
 	// Code to detect if the LastPCR packet is removed
 	// from the queue. Need to nil it! Hopefully, the
 	// queue is big enough for this never to happen
@@ -1371,8 +2070,8 @@ TSPacketBuf *MPEG2Transmitter::GetNextTSPacketQueuePacket(void)
 void
 MPEG2Transmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UInt32 segment, UInt32 cycle)
 {
-	double savedMPEGTime = currentMPEGTime;
-	double savedIsochTime = currentIsochTime;
+	SInt64 savedMPEGTime = currentMPEGTime;
+	SInt64 savedIsochTime = currentIsochTime;
 
 	UInt32 *pCIPHeader = &pCIPHeaders[(segment*isochCyclesPerSegment*2)+(cycle*2)];
 	UInt32 *pIsochHeaderAndMask = &pIsochHeaders[(segment*isochCyclesPerSegment*4)+(cycle*4)];
@@ -1385,9 +2084,7 @@ MPEG2Transmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UInt32
 	UInt32 *pPacketWordBuffers[kMaxTSPacketsPerCycle];
 	UInt32 i;
 	UInt32 sph;
-	UInt32 sphInClocks;
-	UInt32 currentCycleTimeInClocks;
-	int prepareTimeStampDeltaInClocks;
+	UInt32 prepareTimeStampDeltaInClocks;
 	
 	// The first range is for the CIP header
 	range[numRanges].address = (IOVirtualAddress) pCIPHeader ;
@@ -1402,22 +2099,19 @@ MPEG2Transmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UInt32
         pCIPHeader[1] = EndianU32_NtoB(0xA0000000);
 		
 		// Bump currentMPEGTime to the next cycle
-		currentMPEGTime += 3072.0;
-		if (currentMPEGTime >= 24576000.0)
-			currentMPEGTime -= 24576000.0;
+		currentMPEGTime += kMPEG2TransmitterScaledClocksPerCycle;
+		if (currentMPEGTime >= kMPEG2TransmitterScaledClocksPerSecond)
+			currentMPEGTime -= kMPEG2TransmitterScaledClocksPerSecond;
 	}
 	else
 	{
-		while ((currentIsochTime < 0.0) && ((numRanges-1) <= tsPacketsPerCycle)) 
+		while ((currentIsochTime < 0) && ((numRanges-1) <= tsPacketsPerCycle)) 
 		{
 			// Get the next packet from the analysis fifo
 			pTSPacketBuf = GetNextTSPacketQueuePacket();
 			
-			// Mark the segment number for this TSPacketBuf
-			pTSPacketBuf->xmitSegmentNumber = segment;
-			
-			// Push it onto the xmit fifo
-			xmitFifo.push_back(pTSPacketBuf);
+			// Mark the segment number for this TSPacketBuf, and push it onto the xmit fifo
+			packetQueues.commitToSegment(pTSPacketBuf,segment);
 			
 			if (pTSPacketBuf->packetInfo.hasPacketFetchError == true)
 			{
@@ -1437,7 +2131,8 @@ MPEG2Transmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UInt32
 				if (pTSPacketBuf->packetInfo.hasDataRateChange == true)
 				{
 					mpegDataRate = pTSPacketBuf->packetInfo.dataRate;
-					isochCycleClocksPerTSPacket = 24576000.0/(mpegDataRate/1504);
+					stats.dataRateChanges += 1;
+					scaledClocksPerTSPacket = FWScaledClocksPerPacket(mpegDataRate, (kMPEG2TSPacketSize*8), kMPEG2TransmitterScaledClockScale);
 				}
 				
 				// Add a range to this dcl
@@ -1450,22 +2145,18 @@ MPEG2Transmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UInt32
 				if ((timeStampProc != nil) && (pTSPacketBuf->packetInfo.hasPCR) && (firstDCLCallbackOccurred) && (pTSPacketBuf->packetInfo.pid == psiTables->pcrPID)) 
 				{
 					sph = sourcePacketHeader();  
-					sphInClocks = (((sph & 0x01FFF000) >> 12)*3072)+(sph & 0x00000FFF);
-					currentCycleTimeInClocks = (((currentFireWireCycleTime & 0x01FFF000) >> 12)*3072)+(currentFireWireCycleTime & 0x00000FFF);
-					prepareTimeStampDeltaInClocks = sphInClocks - currentCycleTimeInClocks;
-					if (prepareTimeStampDeltaInClocks < 0)
-						prepareTimeStampDeltaInClocks += 24576000;
+					prepareTimeStampDeltaInClocks = FWTimeElapsed(FWClocksIntoSecond(currentFireWireCycleTime), FWClocksIntoSecond(sph), kFWClocksPerSecond);
 					
-					timeStampProc(pTSPacketBuf->packetInfo.pcr,currentUpTimeInNanoSecondsU64 + (prepareTimeStampDeltaInClocks*40.690104167),pTimeStampProcRefCon);
+					timeStampProc(pTSPacketBuf->packetInfo.pcr,currentUpTimeInNanoSecondsU64 + FWClocksToNanoSeconds(prepareTimeStampDeltaInClocks),pTimeStampProcRefCon);
 				}
 				
 				// Bump currentMPEGTime
-				currentMPEGTime += isochCycleClocksPerTSPacket;
-				if (currentMPEGTime >= 24576000.0)
-					currentMPEGTime -= 24576000.0;
+				currentMPEGTime += scaledClocksPerTSPacket;
+				if (currentMPEGTime >= kMPEG2TransmitterScaledClocksPerSecond)
+					currentMPEGTime -= kMPEG2TransmitterScaledClocksPerSecond;
 				
 				// Bump currentIsochTime
-				currentIsochTime += isochCycleClocksPerTSPacket;
+				currentIsochTime += scaledClocksPerTSPacket;
 			}
 			
 			// Fetch another packet for the analysis fifo from the client 
@@ -1477,9 +2168,9 @@ MPEG2Transmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UInt32
 			// currentMPEGTime should bump by exactly one cylce from where we started in 
 			// the call to this function! 
 			currentMPEGTime = savedMPEGTime;
-			currentMPEGTime += 3072.0;
-			if (currentMPEGTime >= 24576000.0)
-				currentMPEGTime -= 24576000.0;
+			currentMPEGTime += kMPEG2TransmitterScaledClocksPerCycle;
+			if (currentMPEGTime >= kMPEG2TransmitterScaledClocksPerSecond)
+				currentMPEGTime -= kMPEG2TransmitterScaledClocksPerSecond;
 
 			// currentIsochTime should be reset to exactly where we started in 
 			// the call to this function! 
@@ -1488,7 +2179,7 @@ MPEG2Transmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UInt32
 		else
 		{
 			// Adjust currentIsoch time for next time. 
-			currentIsochTime -= 3072.0;
+			currentIsochTime -= kMPEG2TransmitterScaledClocksPerCycle;
 		}
 		
 		// set CIP
@@ -1502,11 +2193,26 @@ MPEG2Transmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UInt32
 		dbcCount &= 0x000000FF;
 	}
 	
+	// Update the stats for this cycle
+	countTransmitCycle(numRanges-1, hadFetchErrorPacket);
+
 	// Program new ranges into this dcl
 	(*nuDCLPool)->SetDCLRanges(dcl,numRanges,range);
 	
-	// If an encrpyion proc has been installed, call it now for the packets in this cycle
-	if (encryptionProc)
+	// If a segment encryption proc has been installed, just collect the packets in this cycle.
+	// EncryptSegment(...) will encrypt them, and set the SY field, once the whole segment is filled.
+	// Otherwise, if an encrpyion proc has been installed, call it now for the packets in this cycle
+	if (segmentEncryptionProc)
+	{
+		for (i=0;i<numRanges-1;i++)
+		{
+			ppSegmentEncryptionPackets[segmentEncryptionPacketCount] = (UInt32*) range[i+1].address;
+			ppSegmentEncryptionPackets[segmentEncryptionPacketCount] += 1;	// Skip over the SPH!
+			segmentEncryptionPacketCount += 1;
+		}
+		pSegmentEncryptionCyclePacketCounts[cycle] = numRanges-1;
+	}
+	else if (encryptionProc)
 	{
 		// The number of ts packets in this cycle is numRanges-1.
 		// The pointers to the source packetes ar in the ranges range[1]...range[numRanges-1]
@@ -1563,15 +2269,13 @@ MPEG2Transmitter::FillCycleBuffer(MPEG2XmitCycle *pCycle, UInt16 nodeID, bool do
     UInt32 i;
     UInt32 *pDestBuf = (UInt32*) pCycle->pBuf;
     UInt32 pktNum;
-	double savedIsochTime = currentIsochTime;
-    double savedMPEGTime = currentMPEGTime;
+	SInt64 savedIsochTime = currentIsochTime;
+    SInt64 savedMPEGTime = currentMPEGTime;
 	TSPacket *pTSPacket;
 	UInt32 *pTSPacketBuf;
 	UInt32 shiftedNodeID = ((nodeID & 0x3F) << 24);
 	UInt32 sph;
-	UInt32 sphInClocks;
-	UInt32 currentCycleTimeInClocks;
-	int prepareTimeStampDeltaInClocks;
+	UInt32 prepareTimeStampDeltaInClocks;
 	
 	// First, see if we are in pause state
 	if (playbackMode == kMpeg2TransmitterPlaybackModePause)
@@ -1587,15 +2291,18 @@ MPEG2Transmitter::FillCycleBuffer(MPEG2XmitCycle *pCycle, UInt16 nodeID, bool do
 		(pCycle->pPrev)->UpdateJumpTarget(pCycle->CycleMode, localIsocPort);
 
 		// Bump currentMPEGTime to the next cycle
-		currentMPEGTime += 3072.0;
-		if (currentMPEGTime >= 24576000.0)
-			currentMPEGTime -= 24576000.0;
+		currentMPEGTime += kMPEG2TransmitterScaledClocksPerCycle;
+		if (currentMPEGTime >= kMPEG2TransmitterScaledClocksPerSecond)
+			currentMPEGTime -= kMPEG2TransmitterScaledClocksPerSecond;
+
+		// Update the stats for this cycle
+		countTransmitCycle(0, false);
 
 		return;
 	}
 
 	// See if it's time to send some MPEG
-    if (currentIsochTime < 0.0)
+    if (currentIsochTime < 0)
     {
         // TODO: Until we get a change to the
         // DCL languate to allow us to
@@ -1643,9 +2350,9 @@ MPEG2Transmitter::FillCycleBuffer(MPEG2XmitCycle *pCycle, UInt16 nodeID, bool do
 				currentIsochTime = savedIsochTime;
 
 				// Bump currentMPEGTime to the next cycle
-				currentMPEGTime += 3072.0;
-				if (currentMPEGTime >= 24576000.0)
-					currentMPEGTime -= 24576000.0;
+				currentMPEGTime += kMPEG2TransmitterScaledClocksPerCycle;
+				if (currentMPEGTime >= kMPEG2TransmitterScaledClocksPerSecond)
+					currentMPEGTime -= kMPEG2TransmitterScaledClocksPerSecond;
 
 				// Fetch a new packet from the user and add it to the queue.
 				// Even though we didn't get a packet from the user
@@ -1653,6 +2360,9 @@ MPEG2Transmitter::FillCycleBuffer(MPEG2XmitCycle *pCycle, UInt16 nodeID, bool do
 				// now needs to be refilled.
 				AddPacketToTSPacketQueue();
 				
+				// Update the stats for this cycle
+				countTransmitCycle(0, true);
+				
 				// We're done with this cycle, so return here!
 				return;
 			}
@@ -1661,7 +2371,8 @@ MPEG2Transmitter::FillCycleBuffer(MPEG2XmitCycle *pCycle, UInt16 nodeID, bool do
 			if (pTSPacket->hasDataRateChange == true)
 			{
 				mpegDataRate = pTSPacket->dataRate;
-				isochCycleClocksPerTSPacket = 24576000.0/(mpegDataRate/1504);
+				stats.dataRateChanges += 1;
+				scaledClocksPerTSPacket = FWScaledClocksPerPacket(mpegDataRate, (kMPEG2TSPacketSize*8), kMPEG2TransmitterScaledClockScale);
 			}
 
             // Copy packet data into DCL transmit buffer
@@ -1674,25 +2385,21 @@ MPEG2Transmitter::FillCycleBuffer(MPEG2XmitCycle *pCycle, UInt16 nodeID, bool do
 			if ((timeStampProc != nil) && (pTSPacket->hasPCR) && (firstDCLCallbackOccurred) && (pTSPacket->pid == psiTables->pcrPID)) 
 			{
 				sph = sourcePacketHeader();  
-				sphInClocks = (((sph & 0x01FFF000) >> 12)*3072)+(sph & 0x00000FFF);
-				currentCycleTimeInClocks = (((currentFireWireCycleTime & 0x01FFF000) >> 12)*3072)+(currentFireWireCycleTime & 0x00000FFF);
-				prepareTimeStampDeltaInClocks = sphInClocks - currentCycleTimeInClocks;
-				if (prepareTimeStampDeltaInClocks < 0)
-					prepareTimeStampDeltaInClocks += 24576000;
+				prepareTimeStampDeltaInClocks = FWTimeElapsed(FWClocksIntoSecond(currentFireWireCycleTime), FWClocksIntoSecond(sph), kFWClocksPerSecond);
 				
-				timeStampProc(pTSPacket->pcr,currentUpTimeInNanoSecondsU64 + (prepareTimeStampDeltaInClocks*40.690104167),pTimeStampProcRefCon);
+				timeStampProc(pTSPacket->pcr,currentUpTimeInNanoSecondsU64 + FWClocksToNanoSeconds(prepareTimeStampDeltaInClocks),pTimeStampProcRefCon);
 			}
 			
 			// Fetch a new packet from the user and add it to the queue
 			AddPacketToTSPacketQueue();
 
 			// Bump currentMPEGTime
-            currentMPEGTime += isochCycleClocksPerTSPacket;
-            if (currentMPEGTime >= 24576000.0)
-                currentMPEGTime -= 24576000.0;
+            currentMPEGTime += scaledClocksPerTSPacket;
+            if (currentMPEGTime >= kMPEG2TransmitterScaledClocksPerSecond)
+                currentMPEGTime -= kMPEG2TransmitterScaledClocksPerSecond;
 
             // Bump currentIsochTime
-            currentIsochTime += isochCycleClocksPerTSPacket;
+            currentIsochTime += scaledClocksPerTSPacket;
         }
 
 		// Set the mode for this cycle object
@@ -1713,8 +2420,11 @@ MPEG2Transmitter::FillCycleBuffer(MPEG2XmitCycle *pCycle, UInt16 nodeID, bool do
 		pCycle->CycleMode = CycleModeCIPOnly;
     }
 
+	// Update the stats for this cycle
+	countTransmitCycle((pCycle->CycleMode == CycleModeFull) ? tsPacketsPerCycle : 0, false);
+
     // Adjust currentIsoch time for next time
-    currentIsochTime -= 3072.0;
+    currentIsochTime -= kMPEG2TransmitterScaledClocksPerCycle;
 
     // Deal with previous cycle objects jump target
 	if (doUpdateJumpTarget == true)
@@ -1730,19 +2440,7 @@ MPEG2Transmitter::FillCycleBuffer(MPEG2XmitCycle *pCycle, UInt16 nodeID, bool do
 unsigned int
 MPEG2Transmitter::sourcePacketHeader(void)
 {
-	UInt32	cycle_count;
-	UInt32	cycle_offset;
-	UInt32  cycle_time;
-
-	cycle_count = ((UInt32)currentMPEGTime/3072);
-	cycle_offset = ((UInt32)currentMPEGTime - (cycle_count*3072));
-
-	cycle_count = (cycle_count%8000);
-	cycle_offset = (cycle_offset%3072);
-
-	cycle_time = ((cycle_count<<12) | cycle_offset);
-
-	return cycle_time;
+	return FWCycleTime(FWScaledClocksToClocks(currentMPEGTime, kMPEG2TransmitterScaledClockScale)).getSPH();
 }
 
 
@@ -1840,6 +2538,11 @@ void MPEG2Transmitter::MPEG2XmitDCLOverrunCallback(void)
 	if (transportState == kMpeg2TransmitterTransportPlaying)
 	{
 		logger->log("\nMPEG2Transmitter Error: DCL Overrun!\n\n");
+		segmentSizingInfo.overruns += 1;
+
+		beginStatsUpdate();
+		stats.dclOverruns += 1;
+		publishStats();
 		
 		// Restart transmitter
 		(*isochChannel)->Stop( isochChannel ) ;
@@ -1889,12 +2592,14 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(void)
 	NuDCLRef pLastSegEndDCL;
 	IOReturn result;
 	UInt32 cycle;
-	TSPacketBuf *pTSPacketBuf;
 	UInt32 numDCLsNotified,totalDCLsToNotify,numDCLsForThisNotify;
 	
 	UInt32 outBusTime;
 	AbsoluteTime currentUpTime;
 	Nanoseconds currentUpTimeInNanoSeconds;
+	AbsoluteTime callbackStartUpTime;
+	UInt32 callbackStartCycleTime = 0;
+	UInt32 segmentTimeStamp;
 	
 	// Special debugging check to see if we received an out-of-order callback.
 	// Note: the out-of-order delivery of callbacks shouldn't cause any problems,
@@ -1906,23 +2611,28 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(void)
 	if (transportState == kMpeg2TransmitterTransportStopped)
 		return;
 	
+	// Note when this callback started, for the stats and adaptive segment sizing
+	callbackStartUpTime = UpTime();
+	(*nodeNubInterface)->GetBusCycleTime( nodeNubInterface, &outBusTime, &callbackStartCycleTime);
+	segmentTimeStamp = pTimeStamps[currentSegment];
+
+	// This callback updates the stats
+	beginStatsUpdate();
+	
 	// Get the local node ID
 	do (*nodeNubInterface)->GetBusGeneration(nodeNubInterface, &generation);
 	while  ((*nodeNubInterface)->GetLocalNodeIDWithGeneration(nodeNubInterface,generation,&nodeID) != kIOReturnSuccess);
 	
 	// Get the current end-of-cycle timestamp and convert it to cycles
 	// 8000 cycles per second times 8 seconds gives a cycle number betwen 0 thru 63999
-	actualTimeStampCycle = ((pTimeStamps[currentSegment] & 0x01FFF000) >> 12);
-	actualTimeStampCycle += (((pTimeStamps[currentSegment] & 0x0E000000) >> 25) * 8000);
+	actualTimeStampCycle = FWTimeStampToCycles(pTimeStamps[currentSegment]);
 	
 	// If the actual time stamp is not what we expect, we need to deal with
 	// it here. 
 	if (actualTimeStampCycle != expectedTimeStampCycle)
 	{
 		// Calculate lost cycles (deal with wrap-around condition)
-		lostCycles = actualTimeStampCycle - expectedTimeStampCycle;
-		if (lostCycles < 0)
-			lostCycles += 64000; // based on 8 Seconds worth of cycles
+		lostCycles = FWTimeElapsed(expectedTimeStampCycle, actualTimeStampCycle, kFWCyclesPerTimeStampWrap);
 		
 		// See if the descrepency between actual and expected time-stamps is
 		// only due to the fact that the initial value for the time-stsamp
@@ -1950,7 +2660,7 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(void)
 			actualTimeStampCycle %= 64000;  // modulo by 8 Seconds worth of cycles
 			
 			// Compensate for difference by modifying currentMPEGTime
-			currentMPEGTime = actualTimeStampCycle*3072; 
+			currentMPEGTime = ((actualTimeStampCycle % kFWCyclesPerSecond)*kMPEG2TransmitterScaledClocksPerCycle); 
 		}
 		else
 		{
@@ -1958,6 +2668,9 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(void)
 						(unsigned int) expectedTimeStampCycle,
 						(unsigned int) actualTimeStampCycle);
 			
+			segmentSizingInfo.timeStampAdjusts += 1;
+			stats.timeStampAdjusts += 1;
+			
 			// Notify client of timestamp adjust
 			if (messageProc != nil)
 				messageProc(kMpeg2TransmitterTimeStampAdjust,
@@ -1983,15 +2696,18 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(void)
 			if (lostCycles <= kMPEG2TransmitterLostCycleRecoveryThreshold)
 			{
 				logger->log("MPEG2Transmitter timestamp adjust, using lost-cycle recovery\n");
+				stats.lostCycleRecoveries += 1;
+				stats.lostCyclesRecovered += lostCycles;
 				
 				// By reducing currentIsochTime, we will
 				// transmit DIF data in places where there would
 				// have been CIP-only packets
-				currentIsochTime -= (3072.000 * lostCycles);
+				currentIsochTime -= (kMPEG2TransmitterScaledClocksPerCycle * lostCycles);
 			}
 			else
 			{
 				logger->log("MPEG2Transmitter timestamp adjust, using SPH adjust\n");
+				stats.sphResyncs += 1;
 				
 				// Using the actual time stamp captured, calculate the new current MPEG Time
 				// for the start of the segment we are about to process
@@ -2004,7 +2720,7 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(void)
 				actualTimeStampCycle %= 64000;  // modulo by 8 Seconds worth of cycles
 				
 				// Compensate for difference by modifying currentMPEGTime
-				currentMPEGTime = actualTimeStampCycle*3072; 
+				currentMPEGTime = ((actualTimeStampCycle % kFWCyclesPerSecond)*kMPEG2TransmitterScaledClocksPerCycle); 
 			}
 		}
 	}
@@ -2027,22 +2743,27 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(void)
 	expectedTimeStampCycle %= 64000; // modulo by 8 Seconds worth of cycles
 	
 	// Move TSPacketBuf objects previously commited to this segment from the xmitFifo to the freeFifo
-	for(;;)
-	{
-		if (xmitFifo.empty())
-			break;
-		pTSPacketBuf = xmitFifo.front();
-		if (pTSPacketBuf->xmitSegmentNumber != currentSegment)
-			break;
-		
-		xmitFifo.pop_front();
-		freeFifo.push_back(pTSPacketBuf);
-	}
-	
+	packetQueues.releaseSegment(currentSegment);
+	
+	// Sample the fifo depths
+	stats.analysisFifoDepth = packetQueues.analysisDepth();
+	if (stats.analysisFifoDepth < stats.minAnalysisFifoDepth)
+		stats.minAnalysisFifoDepth = stats.analysisFifoDepth;
+	stats.xmitFifoDepth = packetQueues.xmitDepth();
+	if (stats.xmitFifoDepth > stats.maxXmitFifoDepth)
+		stats.maxXmitFifoDepth = stats.xmitFifoDepth;
+	stats.freeFifoDepth = packetQueues.freeDepth();
+	if (stats.freeFifoDepth < stats.minFreeFifoDepth)
+		stats.minFreeFifoDepth = stats.freeFifoDepth;
+
 	// Fill this segments buffers
 	for (cycle=0;cycle<isochCyclesPerSegment;cycle++)
 		FillCycleBuffer(pProgramDCLs[(currentSegment*isochCyclesPerSegment)+cycle],nodeID,currentSegment,cycle);
 	
+	// If a segment encryption proc has been installed, call it now for the packets in this segment
+	if (segmentEncryptionProc)
+		EncryptSegment(currentSegment);
+	
 	// Point this segment's callback cycle to the overrun callback DCL
 	(*nuDCLPool)->SetDCLBranch(pProgramDCLs[((currentSegment+1)*isochCyclesPerSegment)-1], overrunDCL);
 	
@@ -2081,11 +2802,16 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(void)
 		logger->log("\nMPEG2Transmitter Error: NuDCL kFWNuDCLModifyJumpNotification Notify Error in MPEG2XmitDCLCallback: 0x%08X\n\n",result);
 	}
 	
+	// Update the callback timing stats, and adaptive segment sizing measurements
+	measureSegmentCallback(callbackStartUpTime, callbackStartCycleTime, segmentTimeStamp);
+	
 	// Bump Current Segment
 	if (currentSegment != (isochSegments-1))
 		currentSegment += 1;
 	else
 		currentSegment = 0;
+
+	publishStats();
 	
 	return;
 }
@@ -2105,6 +2831,9 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(MPEG2XmitCycle *pCallBackCycle)
 	UInt32 outBusTime;
 	AbsoluteTime currentUpTime;
 	Nanoseconds currentUpTimeInNanoSeconds;
+	AbsoluteTime callbackStartUpTime;
+	UInt32 callbackStartCycleTime = 0;
+	UInt32 segmentTimeStamp;
 
 	// Special debugging check to see if we received an out-of-order callback.
 	// Note: the out-of-order delivery of callbacks shouldn't cause any problems,
@@ -2116,6 +2845,14 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(MPEG2XmitCycle *pCallBackCycle)
 	if (transportState == kMpeg2TransmitterTransportStopped)
 		return;
 	
+	// Note when this callback started, for the stats and adaptive segment sizing
+	callbackStartUpTime = UpTime();
+	(*nodeNubInterface)->GetBusCycleTime( nodeNubInterface, &outBusTime, &callbackStartCycleTime);
+	segmentTimeStamp = pTimeStamps[currentSegment];
+
+	// This callback updates the stats
+	beginStatsUpdate();
+	
 	// Get the local node ID
 	do (*nodeNubInterface)->GetBusGeneration(nodeNubInterface, &generation);
 	while  ((*nodeNubInterface)->GetLocalNodeIDWithGeneration(nodeNubInterface,generation,&nodeID) != kIOReturnSuccess);
@@ -2127,6 +2864,10 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(MPEG2XmitCycle *pCallBackCycle)
 		 (unsigned int) expectedTimeStampCycle,
 		 (unsigned int) actualTimeStampCycle);
 
+		segmentSizingInfo.timeStampAdjusts += 1;
+		stats.timeStampAdjusts += 1;
+		stats.sphResyncs += 1;
+		
 		// Notify client of timestamp adjust
 		if (messageProc != nil)
 			messageProc(kMpeg2TransmitterTimeStampAdjust,
@@ -2148,7 +2889,7 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(MPEG2XmitCycle *pCallBackCycle)
 		actualTimeStampCycle %= 8000;
 		
 		// Compensate for difference by modifying currentMPEGTime
-		currentMPEGTime = actualTimeStampCycle*3072; 
+		currentMPEGTime = (actualTimeStampCycle*kMPEG2TransmitterScaledClocksPerCycle); 
 	}
 	
 	// Bump expected time stamp cycle value
@@ -2217,11 +2958,16 @@ void MPEG2Transmitter::MPEG2XmitDCLCallback(MPEG2XmitCycle *pCallBackCycle)
 	// Set a new last callback cycle
     pLastCallbackCycle = ppCallbackCycles[currentSegment];
 
+	// Update the callback timing stats, and adaptive segment sizing measurements
+	measureSegmentCallback(callbackStartUpTime, callbackStartCycleTime, segmentTimeStamp);
+	
 	// Bump Current Segment
 	if (currentSegment != (isochSegments-1))
 		currentSegment += 1;
 	else
 		currentSegment = 0;
+
+	publishStats();
 	
 	return;
 }
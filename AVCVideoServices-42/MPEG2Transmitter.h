@@ -121,8 +121,188 @@ struct TSPacketBuf
 	UInt32 xmitSegmentNumber;	// When commited to the xmit program, this is the program segment it is commited to.
 };
 
+// A fixed-capacity fifo of TSPacketBuf pointers. The storage is allocated once,
+// when the DCL program is created, so the push/pop operations done on the
+// real-time DCL thread never allocate or free memory. The capacity is a power
+// of two, so the indexes can be wrapped with a mask.
+class TSPacketBufFifo
+{
+public:
+	TSPacketBufFifo() : ppRing(nil), capacityMask(0), head(0), tail(0) {}
+	~TSPacketBufFifo() { release(); }
+	
+	IOReturn allocate(UInt32 minCapacity)
+	{
+		UInt32 capacity = 1;
+		
+		release();
+		while (capacity < minCapacity)
+			capacity <<= 1;
+		ppRing = new TSPacketBuf*[capacity];
+		if (!ppRing)
+			return kIOReturnNoMemory;
+		capacityMask = capacity-1;
+		return kIOReturnSuccess;
+	}
+	
+	void release(void)
+	{
+		if (ppRing)
+		{
+			delete [] ppRing;
+			ppRing = nil;
+		}
+		capacityMask = 0;
+		head = 0;
+		tail = 0;
+	}
+	
+	// head and tail are free-running, so the fifo is full when they differ by the capacity
+	bool empty(void) { return (head == tail); }
+	UInt32 size(void) { return (tail - head); }
+	void clear(void) { head = tail; }
+	TSPacketBuf *front(void) { return ppRing[head & capacityMask]; }
+	void pop_front(void) { head += 1; }
+	
+	// The caller must never push more TSPacketBuf objects than were
+	// allocated, which is what the fifos are sized for
+	void push_back(TSPacketBuf *pTSPacketBuf) { ppRing[tail & capacityMask] = pTSPacketBuf; tail += 1; }
+	
+private:
+	TSPacketBuf **ppRing;
+	UInt32 capacityMask;
+	UInt32 head;
+	UInt32 tail;
+};
+
+// The transmitter's TSPacketBuf objects move from the free fifo, to the analysis
+// fifo once they have a TS packet in them, to the xmit fifo once they're committed
+// to a program segment, and back to the free fifo once that segment has been sent.
+// This keeps the three fifos together, so the moves can be run without a DCL program.
+class TSPacketBufQueues
+{
+public:
+	TSPacketBufQueues() : numTSPacketBuf(0) {}
+	
+	// The TSPacketBuf objects a DCL program needs: enough for the packet
+	// queue, plus the most packets every cycle of the program can hold
+	static UInt32 numTSPacketBufForProgram(UInt32 packetQueueSize, UInt32 tsPacketsPerCycle, UInt32 programCycles)
+	{
+		return packetQueueSize + (tsPacketsPerCycle*programCycles);
+	}
+	
+	// Each fifo must be able to hold every TSPacketBuf object
+	IOReturn allocate(UInt32 numBufs)
+	{
+		numTSPacketBuf = numBufs;
+		if ((freeFifo.allocate(numBufs) != kIOReturnSuccess) ||
+			(analysisFifo.allocate(numBufs) != kIOReturnSuccess) ||
+			(xmitFifo.allocate(numBufs) != kIOReturnSuccess))
+			return kIOReturnNoMemory;
+		return kIOReturnSuccess;
+	}
+	
+	void release(void)
+	{
+		freeFifo.release();
+		analysisFifo.release();
+		xmitFifo.release();
+		numTSPacketBuf = 0;
+	}
+	
+	// Used to hand over the TSPacketBuf objects after allocating them
+	void addFreePacket(TSPacketBuf *pTSPacketBuf) { freeFifo.push_back(pTSPacketBuf); }
+	
+	// Get a TSPacketBuf to fill with a TS packet. Returns nil if there aren't any.
+	TSPacketBuf *takeFreePacket(void)
+	{
+		TSPacketBuf *pTSPacketBuf;
+		
+		if (freeFifo.empty())
+			return nil;
+		pTSPacketBuf = freeFifo.front();
+		freeFifo.pop_front();
+		return pTSPacketBuf;
+	}
+	
+	void queueForAnalysis(TSPacketBuf *pTSPacketBuf) { analysisFifo.push_back(pTSPacketBuf); }
+	
+	// Get the oldest analyzed TSPacketBuf. Returns nil if there aren't any.
+	TSPacketBuf *takeAnalyzedPacket(void)
+	{
+		TSPacketBuf *pTSPacketBuf;
+		
+		if (analysisFifo.empty())
+			return nil;
+		pTSPacketBuf = analysisFifo.front();
+		analysisFifo.pop_front();
+		return pTSPacketBuf;
+	}
+	
+	void commitToSegment(TSPacketBuf *pTSPacketBuf, UInt32 segment)
+	{
+		pTSPacketBuf->xmitSegmentNumber = segment;
+		xmitFifo.push_back(pTSPacketBuf);
+	}
+	
+	// Free the TSPacketBuf objects committed to a segment that has been sent.
+	// Returns the number freed.
+	UInt32 releaseSegment(UInt32 segment)
+	{
+		UInt32 released = 0;
+		
+		while ((!xmitFifo.empty()) && (xmitFifo.front()->xmitSegmentNumber == segment))
+		{
+			freeFifo.push_back(xmitFifo.front());
+			xmitFifo.pop_front();
+			released += 1;
+		}
+		return released;
+	}
+	
+	// Free everything, when the DCL program is (re)started. Returns false if
+	// any TSPacketBuf objects are missing.
+	bool releaseAll(void)
+	{
+		while (!xmitFifo.empty())
+		{
+			freeFifo.push_back(xmitFifo.front());
+			xmitFifo.pop_front();
+		}
+		while (!analysisFifo.empty())
+		{
+			freeFifo.push_back(analysisFifo.front());
+			analysisFifo.pop_front();
+		}
+		return (freeFifo.size() == numTSPacketBuf);
+	}
+	
+	UInt32 freeDepth(void) { return freeFifo.size(); }
+	UInt32 analysisDepth(void) { return analysisFifo.size(); }
+	UInt32 xmitDepth(void) { return xmitFifo.size(); }
+	
+private:
+	UInt32 numTSPacketBuf;
+	TSPacketBufFifo freeFifo;
+	TSPacketBufFifo analysisFifo;
+	TSPacketBufFifo xmitFifo;
+};
+
 // Function prototype for Encryption Callback
 typedef IOReturn (*MPEG2TransmitterEncryptionProc) (UInt32 tsPacketCount, UInt32 **ppBuf, UInt8 *pSy, void *pRefCon);
+
+// Function prototype for the per-segment Encryption Callback. This is called once
+// for all of the packets committed to a program segment, instead of once per cycle.
+// ppBuf holds tsPacketCount packet pointers, in transmit order. pCyclePacketCounts holds
+// the number of those packets in each of the cycleCount cycles (CIP-only cycles have 0).
+// pSy holds one SY value per cycle, each initialized to the last SY used. The callback
+// may change any of them, so the SY field can still change at cycle granularity.
+typedef IOReturn (*MPEG2TransmitterSegmentEncryptionProc) (UInt32 cycleCount,
+														   UInt32 *pCyclePacketCounts,
+														   UInt32 tsPacketCount,
+														   UInt32 **ppBuf,
+														   UInt8 *pSy,
+														   void *pRefCon);
 #endif
 
 // To prevent erroneously low bit-rate calculations from stalling the transmitter,
@@ -131,6 +311,12 @@ typedef IOReturn (*MPEG2TransmitterEncryptionProc) (UInt32 tsPacketCount, UInt32
 // discontinuties, or packet errors.
 #define kMPEG2TransmitterLowBitRateThreshold 400000.0
 
+// The MPEG2Transmitter keeps its isoch and source-packet-header clocks
+// in 1/2^32ths of a FireWire clock (see FWCycleTime.h)
+#define kMPEG2TransmitterScaledClockScale 0x100000000ULL
+#define kMPEG2TransmitterScaledClocksPerCycle ((SInt64) kFWClocksPerCycle << 32)
+#define kMPEG2TransmitterScaledClocksPerSecond ((SInt64) kFWClocksPerSecond << 32)
+
 // Function prototype for data pull callback.
 // Notes: The registered data-pull function is called every time the
 // MPEG transmitter is ready for the next TS packet. The application
@@ -148,6 +334,127 @@ typedef void (*MPEG2TransmitterMessageProc) (UInt32 msg, UInt32 param1, UInt32 p
 // Function prototype for time-stamp delivery callback.
 typedef void (*MPEG2TransmitterTimeStampProc) (UInt64 pcr, UInt64 transmitTimeInNanoSeconds, void *pRefCon);
 
+// Defaults and limits for the adaptive segment sizing mode. When enabled,
+// the transmitter measures its DCL callback service time and how close each
+// callback came to overrunning the DCL program, and on the next startTransmit
+// rebuilds the DCL program with the smallest segment size that stays within
+// the configured latency and CPU bounds. The latency bound is a hard limit on
+// the length of the DCL program, even if the measurements call for more slack.
+// It must allow at least kMPEG2TransmitterAdaptiveMinSegments segments of
+// minCyclesPerSegment cycles.
+enum
+{
+	kMPEG2TransmitterAdaptiveMinCyclesPerSegment = 100,
+	kMPEG2TransmitterAdaptiveMaxCyclesPerSegment = 4000,
+	kMPEG2TransmitterAdaptiveMaxLatencyInCycles = 8000,		// One second
+	kMPEG2TransmitterAdaptiveMaxCallbackLoadPercent = 10,
+
+	// Segment sizes are chosen in multiples of this
+	kMPEG2TransmitterAdaptiveCyclesPerSegmentGranularity = 100,
+	
+	// Never use fewer segments than this
+	kMPEG2TransmitterAdaptiveMinSegments = 3,
+	
+	// Never build a DCL program longer than this (two seconds)
+	kMPEG2TransmitterAdaptiveMaxProgramCycles = 16000,
+	
+	// Require this many times the worst observed callback delay
+	// as slack before the DCL program would overrun
+	kMPEG2TransmitterAdaptiveSafetyFactor = 3
+};
+
+// Adaptive segment sizing parameters and measurements
+typedef struct _MPEG2TransmitterSegmentSizingInfo
+{
+	bool adaptiveModeEnabled;
+	
+	// Geometry of the current DCL program
+	UInt32 cyclesPerSegment;
+	UInt32 numSegments;
+	
+	// Geometry that will be used on the next startTransmit
+	UInt32 nextCyclesPerSegment;
+	UInt32 nextNumSegments;
+	
+	// Configured bounds
+	UInt32 minCyclesPerSegment;
+	UInt32 maxCyclesPerSegment;
+	UInt32 maxLatencyInCycles;
+	UInt32 maxCallbackLoadPercent;
+	
+	// Measurements since the DCL program was last (re)built
+	UInt32 callbacksMeasured;
+	UInt32 lastServiceTimeInMicroseconds;
+	UInt32 avgServiceTimeInMicroseconds;
+	UInt32 maxServiceTimeInMicroseconds;
+	UInt32 lastCallbackLatencyInCycles;		// From end-of-segment time-stamp to callback
+	UInt32 maxCallbackLatencyInCycles;
+	UInt32 minSlackInCycles;				// Fewest cycles remaining before a DCL overrun
+	UInt32 timeStampAdjusts;
+	UInt32 overruns;
+	
+	// Number of times the DCL program has been rebuilt with a new geometry
+	UInt32 retuneCount;
+	
+	// Set when the latency bound left the next geometry with less
+	// slack than the measurements called for
+	bool latencyLimited;
+}MPEG2TransmitterSegmentSizingInfo;
+
+// Transmit statistics. For the histograms, bin 0 counts samples of zero, bin n
+// counts samples in the range [2^(n-1), 2^n), and the last bin counts everything
+// larger. The packetsPerCycle histogram is indexed by the number of TS packets
+// in the cycle, with the last bin counting everything larger.
+enum
+{
+	kMPEG2TransmitterStatsHistogramBins = 16,
+	kMPEG2TransmitterStatsPacketsPerCycleBins = 8
+};
+
+typedef struct _MPEG2TransmitterStats
+{
+	// DCL callback timing
+	UInt32 segmentCallbacks;
+	UInt32 callbackLatencyInCycles[kMPEG2TransmitterStatsHistogramBins];	// From end-of-segment time-stamp to callback
+	UInt32 callbackServiceTimeInMicroseconds[kMPEG2TransmitterStatsHistogramBins];
+	UInt32 maxCallbackLatencyInCycles;
+	UInt32 maxCallbackServiceTimeInMicroseconds;
+	
+	// Isoch cycles prepared
+	UInt64 cycles;
+	UInt64 cipOnlyCycles;
+	UInt64 fetchErrorCycles;
+	UInt64 tsPacketsTransmitted;
+	UInt64 packetsPerCycle[kMPEG2TransmitterStatsPacketsPerCycleBins];
+	
+	// Packet fetching
+	UInt64 packetFetchErrors;
+	UInt32 invalidPacketHeaders;
+	
+	// Time-stamp discrepancies and overruns
+	UInt32 timeStampAdjusts;
+	UInt32 lostCycleRecoveries;		// Adjusts handled by dropping future CIP-only cycles
+	UInt32 lostCyclesRecovered;
+	UInt32 sphResyncs;				// Adjusts handled by moving the source-packet-header time
+	UInt32 dclOverruns;
+	
+	// Fifo depths, sampled at each DCL callback (NuDCL transmitter only)
+	UInt32 analysisFifoDepth;
+	UInt32 minAnalysisFifoDepth;
+	UInt32 xmitFifoDepth;
+	UInt32 maxXmitFifoDepth;
+	UInt32 freeFifoDepth;
+	UInt32 minFreeFifoDepth;
+	
+	// Stream analysis
+	double mpegDataRate;
+	UInt32 dataRateChanges;
+	UInt32 psiRescans;
+}MPEG2TransmitterStats;
+
+// Function prototype for periodic stats delivery callback.
+typedef void (*MPEG2TransmitterStatsProc) (MPEG2TransmitterStats *pStats, void *pRefCon);
+
 //
 // The MPEG2 Transmitter Class Declaration
 //
@@ -167,8 +474,10 @@ public:
     // Destructor
     ~MPEG2Transmitter();
 
-    // Function to setup all the isoc stuff
-    IOReturn setupIsocTransmitter(void);
+    // Function to setup all the isoc stuff. The isoch and asynch callback
+    // dispatchers are installed on the specified run loop, or on the
+    // current thread's run loop if isochRunLoopRef is nil.
+    IOReturn setupIsocTransmitter(CFRunLoopRef isochRunLoopRef = nil);
 
 	// Set the isoch transmit channel
 	IOReturn setTransmitIsochChannel(unsigned int chan);
@@ -189,6 +498,28 @@ public:
 	// Function to install a handler for receiving time-stamp notifications
 	IOReturn registerTimeStampCallback(MPEG2TransmitterTimeStampProc handler, void *pRefCon);
 	
+	// Adaptive segment sizing. Changes to the segment geometry are applied
+	// on the next call to startTransmit.
+	IOReturn setAdaptiveSegmentSizing(bool enable,
+									  unsigned int minCyclesPerSegment = kMPEG2TransmitterAdaptiveMinCyclesPerSegment,
+									  unsigned int maxCyclesPerSegment = kMPEG2TransmitterAdaptiveMaxCyclesPerSegment,
+									  unsigned int maxLatencyInCycles = kMPEG2TransmitterAdaptiveMaxLatencyInCycles,
+									  unsigned int maxCallbackLoadPercent = kMPEG2TransmitterAdaptiveMaxCallbackLoadPercent);
+	IOReturn getSegmentSizingInfo(MPEG2TransmitterSegmentSizingInfo *pInfo);
+
+	// Transmit statistics. These can be called from any thread. The stats are
+	// published at the end of each DCL callback, so stats read from inside a
+	// client callback don't yet include the callback in progress. If no stats
+	// handler is passed to startStatsDump, the stats are written to the logger.
+	IOReturn getStats(MPEG2TransmitterStats *pStats);
+	void resetStats(void);
+	void logStats(MPEG2TransmitterStats *pStats = nil);
+	IOReturn startStatsDump(double intervalInSeconds, MPEG2TransmitterStatsProc handler = nil, void *pRefCon = nil);
+	void stopStatsDump(void);
+
+	// Callback for the stats dump timer
+	void StatsDumpTimeout(void);
+	
 	// Publically visible vars
 	UInt8 playbackMode;	// Allows for user to signal entering/exiting pause mode
     double mpegDataRate;
@@ -199,6 +530,9 @@ public:
 
 #ifdef kAVS_Use_NuDCL_Mpeg2Transmitter
 	IOReturn registerDataEncryptionCallback(MPEG2TransmitterEncryptionProc handler, void *pRefCon);
+	
+	// If a segment encryption callback is registered, it is used instead of the per-cycle encryption callback
+	IOReturn registerSegmentDataEncryptionCallback(MPEG2TransmitterSegmentEncryptionProc handler, void *pRefCon);
 #endif
 
 private:
@@ -206,6 +540,24 @@ private:
 	// Function to pre-initialize all the isoch xmit buffers
 	IOReturn prepareForTransmit(void);
 
+	// Functions to build and tear-down the DCL program, buffers, ports and channel
+	IOReturn createIsochProgram(void);
+	void releaseIsochProgram(void);
+	
+	// Adaptive segment sizing helpers
+	void measureSegmentCallback(AbsoluteTime callbackStartUpTime, UInt32 callbackStartCycleTime, UInt32 segmentTimeStamp);
+	void chooseSegmentSizing(void);
+	IOReturn applySegmentSizing(void);
+	void resetSegmentSizingMeasurements(void);
+
+	// Transmit statistics helpers. Only the thread running the DCL program
+	// writes the working stats, calling beginStatsUpdate before it starts,
+	// and publishStats when it's done (and not in the middle of a client callback).
+	void beginStatsUpdate(void);
+	void publishStats(void);
+	void clearStats(void);
+	void countTransmitCycle(UInt32 numPackets, bool hadFetchError);
+
 	// Registered Handler functions
 	DataPullProc packetFetch;
 	void *pPacketFetchRefCon;
@@ -228,9 +580,16 @@ private:
 #ifdef kAVS_Use_NuDCL_Mpeg2Transmitter
 	void FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UInt32 segment, UInt32 cycle);
 	TSPacketBuf *GetNextTSPacketQueuePacket(void);
+	void EncryptSegment(UInt32 segment);
 
 	MPEG2TransmitterEncryptionProc encryptionProc;
 	void *pEncryptionProcRefCon;
+	MPEG2TransmitterSegmentEncryptionProc segmentEncryptionProc;
+	void *pSegmentEncryptionProcRefCon;
+	UInt32 **ppSegmentEncryptionPackets;
+	UInt32 *pSegmentEncryptionCyclePacketCounts;
+	UInt8 *pSegmentEncryptionSy;
+	UInt32 segmentEncryptionPacketCount;
 	IOFireWireLibNuDCLPoolRef nuDCLPool;
 	UInt32 numTSPacketBuf;
 	TSPacketBuf *pTSPacketBufArray;
@@ -244,9 +603,7 @@ private:
 	NuDCLSendPacketRef overrunDCL;
 	CFMutableSetRef *pSegUpdateBags;
 	IOVirtualRange range[7];
-	std::deque<TSPacketBuf*> freeFifo;
-	std::deque<TSPacketBuf*> analysisFifo;
-	std::deque<TSPacketBuf*> xmitFifo;
+	TSPacketBufQueues packetQueues;
 	TSPacketBuf *pLastPCRPacketBuf;
 	UInt32 transmitBufferSize;
 	NuDCLSendPacketRef *pProgramDCLs;
@@ -272,9 +629,9 @@ private:
 #endif
 	
     // Other vars
-    double currentIsochTime;
-    double currentMPEGTime;
-    double isochCycleClocksPerTSPacket;
+    SInt64 currentIsochTime;
+    SInt64 currentMPEGTime;
+    SInt64 scaledClocksPerTSPacket;
 	double lastPCR;
 	unsigned int packetsBetweenPCR;
     unsigned int dbcCount;
@@ -301,6 +658,19 @@ private:
 	UInt32 currentFireWireCycleTime;
 	UInt64 currentUpTimeInNanoSecondsU64;
 	
+	bool adaptiveSegmentSizing;
+	UInt64 totalServiceTimeInMicroseconds;
+	MPEG2TransmitterSegmentSizingInfo segmentSizingInfo;
+
+	MPEG2TransmitterStats stats;			// Working copy, only touched by the DCL program's thread
+	MPEG2TransmitterStats publishedStats;
+	StatsSeqLock statsLock;
+	volatile bool statsResetRequested;
+	CFRunLoopTimerRef statsDumpTimer;
+	MPEG2TransmitterStatsProc statsDumpProc;
+	void *pStatsDumpRefCon;
+	pthread_mutex_t statsDumpTimerMutex;
+	
 	// Packet Processing Queue Functions
 	void AddPacketToTSPacketQueue(void);
 	
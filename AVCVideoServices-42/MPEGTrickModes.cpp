@@ -498,7 +498,7 @@ UInt32 MPEGNaviFileReader::FileLenInTSPackets(void)
 /////////////////////////////////////////////////////////////////////////////////////////////
 MPEGNaviFileWriter::MPEGNaviFileWriter()
 {
-	tsFile = nil;
+	pTSFileSink = nil;
 	naviFile = nil;
 	frameHorizontalSize = 0;
 	frameVerticalSize = 0;
@@ -517,8 +517,8 @@ MPEGNaviFileWriter::MPEGNaviFileWriter()
 /////////////////////////////////////////////////////////////////////////////////////////////
 MPEGNaviFileWriter::~MPEGNaviFileWriter()
 {
-	if (tsFile)
-		fclose(tsFile);
+	if (pTSFileSink)
+		delete pTSFileSink;
 	
 	if (naviFile)
 		fclose(naviFile);
@@ -535,7 +535,7 @@ IOReturn MPEGNaviFileWriter::InitWithTSFile(char *pTSFileName, bool alsoCreateNa
 	IOReturn result = kIOReturnSuccess;
 
 	// First, make sure the files are not open
-	if ((tsFile) || (naviFile))
+	if ((pTSFileSink) || (naviFile))
 		return kIOReturnExclusiveAccess;
 	
 	// Allocate memory for the navi filename string
@@ -546,9 +546,15 @@ IOReturn MPEGNaviFileWriter::InitWithTSFile(char *pTSFileName, bool alsoCreateNa
 	// Create the TS file
 	if (result == kIOReturnSuccess)
 	{
-		tsFile = fopen(pTSFileName,"wb");
-		if (tsFile == nil)
+		pTSFileSink = new MPEG2RecordingSink;
+		if (!pTSFileSink)
+			result = kIOReturnNoMemory;
+		else if (pTSFileSink->openFile(pTSFileName) != kIOReturnSuccess)
+		{
+			delete pTSFileSink;
+			pTSFileSink = nil;
 			result = kIOReturnError;
+		}
 	}
 	
 	if (alsoCreateNaviFile == true)
@@ -606,46 +612,69 @@ UInt32 MPEGNaviFileWriter::WriteNextTSPackets(void *pBuffer, UInt32 numTSPackets
 	unsigned int cnt = 0;
 	IOReturn result = kIOReturnSuccess;
 	UInt8 *pByteBuf = (UInt8*) pBuffer;
+	UInt32 *pPacketPtrs[64];
+	UInt32 numPackets;
+	UInt32 numTSPacketsWritten = 0;
 	
 	// First, make sure the file is open
-	if (!tsFile)
+	if (!pTSFileSink)
+		return 0;
+	
+	// Hand the packets to the sink in groups
+	while ((numTSPackets > 0) && (result == kIOReturnSuccess))
+	{
+		numPackets = (numTSPackets > 64) ? 64 : numTSPackets;
+		for (i=0;i<numPackets;i++)
+			pPacketPtrs[i] = (UInt32*) &pByteBuf[188*i];
+		cnt = WriteNextTSPackets(pPacketPtrs, numPackets);
+		if (cnt != numPackets)
+			result = kIOReturnError;
+		numTSPacketsWritten += cnt;
+		pByteBuf += (188*numPackets);
+		numTSPackets -= numPackets;
+	}
+	
+	if (result == kIOReturnSuccess)
+		return numTSPacketsWritten;
+	else
+		return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// MPEGNaviFileWriter::WriteNextTSPackets
+/////////////////////////////////////////////////////////////////////////////////////////////
+UInt32 MPEGNaviFileWriter::WriteNextTSPackets(UInt32 **ppBuf, UInt32 numTSPackets)
+{
+	UInt32 i;
+	
+	// First, make sure the file is open
+	if (!pTSFileSink)
+		return 0;
+	
+	// Write the TS packets to the transport stream file. If the sink had to drop any
+	// packets, the navi file offsets would no longer match the TS file, so treat
+	// that as a write error too.
+	if (pTSFileSink->pushTSPackets(numTSPackets, ppBuf) != kIOReturnSuccess)
 		return 0;
 	
 	// Loop for each TS packet
 	for (i=0;i<numTSPackets;i++)
 	{
-		// Write the TS packet to the transport stream file
-		cnt = fwrite(&pByteBuf[188*i],kMPEG2TSPacketSize,1,tsFile);
-		if (cnt != 1)
+		if (pTSDemuxer != nil)
 		{
-			result = kIOReturnError;
-			break;
-		}
-		else
-		{
-			if (pTSDemuxer != nil)
-			{
-				// Send the TS packet to the demuxer
-				pTSDemuxer->nextTSPacket(&pByteBuf[188*i],numTSPacketsStored);
-				
-				// See if the demuxer had a file write error
-				if (tsDemuxerHadFileWriteError == true)
-				{
-					result = kIOReturnError;
-					break;
-				}
-				
-			}
+			// Send the TS packet to the demuxer
+			pTSDemuxer->nextTSPacket((UInt8*) ppBuf[i],numTSPacketsStored);
 			
-			// Bump the packet count
-			numTSPacketsStored += 1;
+			// See if the demuxer had a file write error
+			if (tsDemuxerHadFileWriteError == true)
+				return 0;
 		}
+		
+		// Bump the packet count
+		numTSPacketsStored += 1;
 	}
 	
-	if (result == kIOReturnSuccess)
-		return cnt;
-	else
-		return 0;
+	return numTSPackets;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -653,14 +682,18 @@ UInt32 MPEGNaviFileWriter::WriteNextTSPackets(void *pBuffer, UInt32 numTSPackets
 /////////////////////////////////////////////////////////////////////////////////////////////
 IOReturn MPEGNaviFileWriter::CloseFiles(void)
 {
+	IOReturn result = kIOReturnSuccess;
+	
 	// First, make sure the files are open
-	if ((!tsFile) || (!naviFile))
+	if ((!pTSFileSink) || (!naviFile))
 		return kIOReturnNotOpen;
 	
-	if (tsFile)
+	if (pTSFileSink)
 	{
-		fclose(tsFile);
-		tsFile = nil;
+		// Flushes the rest of the TS packets, and reports any write error
+		result = pTSFileSink->closeFile();
+		delete pTSFileSink;
+		pTSFileSink = nil;
 	}
 	
 	if (naviFile)
@@ -675,7 +708,7 @@ IOReturn MPEGNaviFileWriter::CloseFiles(void)
 		pTSDemuxer = nil;
 	}
 	
-	return kIOReturnSuccess;
+	return result;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
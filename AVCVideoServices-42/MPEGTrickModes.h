@@ -197,6 +197,12 @@ public:
 	// Entries for navi file will be written as well.
 	// Note: Buffer size must be numTSPackets * 188 bytes
 	UInt32 WriteNextTSPackets(void *pBuffer, UInt32 numTSPackets);
+	
+	// Same as above, for packets that aren't contiguous (for example, the
+	// packet pointers passed to a MPEG2Receiver data push callback).
+	// The TS packets are written to the file by a MPEG2RecordingSink, so
+	// this is safe to call from the isoch callback thread.
+	UInt32 WriteNextTSPackets(UInt32 **ppBuf, UInt32 numTSPackets);
 
 	// Close Files - Allows for another call to InitWithTSFile(...) without tearing down this object
 	IOReturn CloseFiles(void);
@@ -219,7 +225,7 @@ private:
 		
 	static IOReturn PESCallback(TSDemuxerMessage msg, PESPacketBuf* pPESPacket,void *pRefCon);
 		
-	FILE *tsFile;	
+	MPEG2RecordingSink *pTSFileSink;
 	FILE *naviFile;
 	UInt32 frameHorizontalSize;
 	UInt32 frameVerticalSize;
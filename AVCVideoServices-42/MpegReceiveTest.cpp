@@ -77,7 +77,7 @@ IOReturn MyStructuredDataPushProc(UInt32 CycleDataCount,
 								  MPEGReceiveCycleData *pCycleData, 
 								  void *pRefCon);
 // Globals
-FILE *outFile;
+MPEG2RecordingSink *pRecordingSink;
 unsigned int packetCount = 0;
 
 //////////////////////////////////////////////////////
@@ -102,16 +102,17 @@ int main(int argc, char* argv[])
 	isochChannel = atoi(argv[1]);
 	captureTimeInSeconds = atoi(argv[3]);
 
-	// Create the output file
-	outFile = fopen(argv[2],"wb");
-	if (outFile == nil)
+	// Alloacate a string logger object and pass it our callback func
+	StringLogger logger(PrintLogMessage);
+
+	// Create the output file. The recording sink does the file writes on its
+	// own thread, so the receive callback never waits on the disk.
+	pRecordingSink = new MPEG2RecordingSink(&logger);
+	if ((!pRecordingSink) || (pRecordingSink->openFile(argv[2]) != kIOReturnSuccess))
 	{
 		printf("Unable to open output file: %s\n",argv[2]);
 		return -1;
 	}
-
-	// Alloacate a string logger object and pass it our callback func
-	StringLogger logger(PrintLogMessage);
 	
 	// Use the FireWireMPEG framework's helper function to create the
 	// MPEG2Receiver object and dedicated real-time thread.
@@ -164,6 +165,18 @@ int main(int argc, char* argv[])
 	// Delete the receiver object
 	DestroyMPEG2Receiver(receiver);
 
+	// Write out the rest of the packets, and close the file
+	MPEG2RecordingSinkStats sinkStats;
+	pRecordingSink->getStats(&sinkStats);
+	if (pRecordingSink->closeFile() != kIOReturnSuccess)
+	{
+		printf("Error writing to output file.\n");
+		result = kIOReturnIOError;
+	}
+	if (sinkStats.bytesDropped > 0)
+		printf("Output file fell behind, dropped %llu bytes\n",(unsigned long long) sinkStats.bytesDropped);
+	delete pRecordingSink;
+
 	// We're done!
 	printf("MpegReceiveTest complete!\n");
 	return result;
@@ -195,21 +208,14 @@ void MessageReceivedProc(UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon
 //////////////////////////////////////////////////////
 IOReturn MpegReceiveCallback(UInt32 tsPacketCount, UInt32 **ppBuf, void *pRefCont)
 {
-	unsigned int i;
-	unsigned int cnt;
-
 	// Increment packet count for progress display
 	packetCount += tsPacketCount;
 
 	// Write packets to file
-	for (i=0;i<tsPacketCount;i++)
+	if (pRecordingSink->pushTSPackets(tsPacketCount,ppBuf) == kIOReturnIOError)
 	{
-		cnt = fwrite(ppBuf[i],1,kMPEG2TSPacketSize,outFile);
-		if (cnt != kMPEG2TSPacketSize)
-		{
-			printf("Error writing to output file.\n");
-			exit(-1);
-		}
+		printf("Error writing to output file.\n");
+		exit(-1);
 	}
 	
 	return 0;
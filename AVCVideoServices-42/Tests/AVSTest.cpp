@@ -0,0 +1,116 @@
+/*
+	File:		AVSTest.cpp
+ 
+ Synopsis: Pass/fail checks and timing helpers shared by the hardware-independent tests and benchmarks.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#include "AVSTest.h"
+
+namespace AVS
+{
+
+static UInt32 testChecks = 0;
+static UInt32 testFailures = 0;
+
+//////////////////////////////////////////////////////
+// AVSTestRecordCheck
+//////////////////////////////////////////////////////
+void AVSTestRecordCheck(bool passed, const char *pConditionString, const char *pFile, int line)
+{
+	testChecks += 1;
+	if (passed == false)
+	{
+		testFailures += 1;
+		printf("FAILED: %s (%s:%d)\n",pConditionString,pFile,line);
+	}
+}
+
+//////////////////////////////////////////////////////
+// AVSTestFinish
+//////////////////////////////////////////////////////
+int AVSTestFinish(const char *pTestName)
+{
+	if (testFailures == 0)
+	{
+		printf("%s: PASS (%u checks)\n",pTestName,(unsigned int) testChecks);
+		return 0;
+	}
+	else
+	{
+		printf("%s: FAIL (%u of %u checks failed)\n",pTestName,(unsigned int) testFailures,(unsigned int) testChecks);
+		return 1;
+	}
+}
+
+//////////////////////////////////////////////////////
+// AVSTestNanoseconds
+//////////////////////////////////////////////////////
+UInt64 AVSTestNanoseconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (((UInt64) now.tv_sec) * 1000000000ULL) + now.tv_nsec;
+}
+
+//////////////////////////////////////////////////////
+// AVSTestMakeScratchFilePath
+//////////////////////////////////////////////////////
+void AVSTestMakeScratchFilePath(char *pPath, UInt32 pathLen, const char *pBaseName)
+{
+	const char *pTempDir = getenv("TMPDIR");
+
+	if ((pTempDir == nil) || (pTempDir[0] == 0))
+		pTempDir = "/tmp";
+	snprintf(pPath,pathLen,"%s/%s.%d",pTempDir,pBaseName,(int) getpid());
+}
+
+//////////////////////////////////////////////////////
+// AVSTestRemoveScratchFile
+//////////////////////////////////////////////////////
+void AVSTestRemoveScratchFile(const char *pPath)
+{
+	unlink(pPath);
+}
+
+} // namespace AVS
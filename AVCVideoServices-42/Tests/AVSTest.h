@@ -0,0 +1,82 @@
+/*
+	File:		AVSTest.h
+ 
+ Synopsis: Pass/fail checks and timing helpers shared by the hardware-independent tests and benchmarks.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_AVSTEST__
+#define __AVCVIDEOSERVICES_AVSTEST__
+
+namespace AVS
+{
+
+// Record the result of one check. Failures are printed with the
+// file and line, and counted toward the result of AVSTestFinish.
+#define AVSTestCheck(condition) AVSTestRecordCheck((condition), #condition, __FILE__, __LINE__)
+
+void AVSTestRecordCheck(bool passed, const char *pConditionString, const char *pFile, int line);
+
+// Print a one line summary, and return the process exit status for the test.
+int AVSTestFinish(const char *pTestName);
+
+// A monotonic clock, in nanoseconds, for benchmarks
+UInt64 AVSTestNanoseconds(void);
+
+// Make a path for a scratch file in the temp directory. The file is removed
+// by AVSTestRemoveScratchFile.
+void AVSTestMakeScratchFilePath(char *pPath, UInt32 pathLen, const char *pBaseName);
+void AVSTestRemoveScratchFile(const char *pPath);
+
+// Fill pFrameData with a DV frame of the given mode: every DIF block ID in place,
+// the subcode, VAUX, and AAUX packs a camcorder records (timecode 00:00:00:00,
+// rec date 2007-06-15, rec time 10:20:30, 4:3, 48 KHz 16-bit audio), and zeroed
+// audio and video. Returns the frame size, or zero for an unknown mode. (In
+// AVSTestSupport.cpp, with the stand-ins for dvFormats and GetDVModeFromFrameData.)
+UInt32 AVSTestMakeDVFrame(UInt8 *pFrameData, UInt8 dvMode);
+
+// Set the title timecode of a frame made by AVSTestMakeDVFrame
+void AVSTestSetDVFrameTimeCode(UInt8 *pFrameData, UInt8 dvMode, UInt8 hours, UInt8 minutes, UInt8 seconds, UInt8 frames, bool dropFrame);
+
+} // namespace AVS
+
+#endif // __AVCVIDEOSERVICES_AVSTEST__
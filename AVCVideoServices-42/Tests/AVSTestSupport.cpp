@@ -0,0 +1,449 @@
+/*
+	File:		AVSTestSupport.cpp
+ 
+ Synopsis: Stand-ins for the FireWireDV.cpp DV format table and frame parsing, and synthetic DV frames, for the hardware-independent tests and benchmarks.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// FireWireDV.cpp can only be built against IOKit, so the tests get its DV format
+// table, and its frame header parsing, from here. Keep these in sync with it.
+//
+// AVSTestMakeDVFrame makes frames the way a DV camcorder lays them out, so the
+// DV tests and benchmarks don't need sample files.
+//
+
+#include "AVSTest.h"
+
+namespace AVS
+{
+
+//
+// DV Formats
+// Note: Only the 1x speed formats are included in this table.
+//
+DVFormats dvFormats[] =
+{
+// size    mode  dbs   fn    sytoffset
+  {72000,  0x84, 0x3C, 0x00, 0x02},  // SDL_625_50
+  {60000,  0x04, 0x3C, 0x00, 0x02},  // SDL_525_60
+  {144000, 0x80, 0x78, 0x00, 0x02},  // SD_625_50
+  {120000, 0x00, 0x78, 0x00, 0x02},  // SD_525_60
+  {144000, 0xF8, 0x78, 0x00, 0x03},  // DVCPro25_625_50
+  {120000, 0x78, 0x78, 0x00, 0x03},  // DVCPro25_525_60
+  {288000, 0xF4, 0x78, 0x01, 0x03},  // DVCPro50_625_50
+  {240000, 0x74, 0x78, 0x01, 0x03},  // DVCPro50_525_60
+  {288000, 0x88, 0xF0, 0x00, 0x03},  // HD_1250_50
+  {240000, 0x08, 0xF0, 0x00, 0x03},  // HD_1125_60
+  {576000, 0xF0, 0x78, 0x02, 0x06},  // DVCPro100_50
+  {480000, 0x70, 0x78, 0x02, 0x06},  // DVCPro100_60
+  {0,0,0,0} // Terminator: Don't eliminate this!
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+// GetDVModeFromFrameData - Requires a pointer to at least 480 bytes of the frame data
+///////////////////////////////////////////////////////////////////////////////////////
+IOReturn GetDVModeFromFrameData(UInt8 *pDVFrameData, UInt8 *pDVMode, UInt32 *pFrameSize, UInt32 *pSourcePacketSize)
+{
+	bool found = false;
+	UInt8 *pPack;
+	UInt32 vaux,pack;
+	UInt8 dvMode;
+	UInt32 i = 0;
+	DVFormats *pDVFormat = nil;
+	UInt8 apt;
+	
+	// Pre-initialize the DV mode to an illegal value!
+	dvMode = 0xFF;
+	
+	// First, validate that the frame data indeed looks like a valid DV frame
+	// We do this by looking at the section-type field of the first 6 DIF block sections!
+	if (((pDVFrameData[0] & 0xF0) != 0x10) || ((pDVFrameData[80] & 0xF0) != 0x30) || ((pDVFrameData[160] & 0xF0) != 0x30) || ((pDVFrameData[240] & 0xF0) != 0x50) ||
+		((pDVFrameData[320] & 0xF0) != 0x50) || ((pDVFrameData[400] & 0xF0) != 0x50))
+		return kIOReturnError;
+
+	// Extract the APT field from the header dif block. It's used
+	// to distinguish DV25 NTSC/PAL from DVCPro25 NTSC/PAL.
+	apt = pDVFrameData[4] & 0x07;
+	
+	// Search for VS pack data in all the VAUX sections
+	for (vaux=0;vaux<3;vaux++)
+	{
+		for (pack=0;pack<15;pack++)
+		{
+			pPack = &pDVFrameData[243+(vaux*80)+(pack*5)];
+			
+			// The VS pack has a pack header of 0x60!
+			if (pPack[0] == 0x60)
+			{
+				found = true;
+				break;
+			}
+		}
+		if (found == true)
+			break;
+	}
+	
+	// If we found the VS pack, determine the DV mode
+	if (found == true)
+	{
+		switch (pPack[3] & 0x3F)
+		{
+			// DV25 - NTSC (or DVCPro25-NTSC)
+			case 0x00:
+				if (apt)
+					dvMode = kFWAVCDVMode_DVCPro25_525_60; 
+				else
+					dvMode = kFWAVCDVMode_SD_525_60;
+				break;
+				
+			// DV25 - PAL (or DVCPro25-PAL)
+			case 0x20:
+				if (apt)
+					dvMode = kFWAVCDVMode_DVCPro25_625_50; 
+				else
+					dvMode = kFWAVCDVMode_SD_625_50; 
+				break;
+
+			// SDL - NTSC
+			case 0x01:
+				dvMode = kFWAVCDVMode_SDL_525_60; 
+				break;
+				
+			// SDL - PAL
+			case 0x21:
+				dvMode = kFWAVCDVMode_SDL_625_50; 
+				break;
+				
+			// 1125-60
+			case 0x02:
+				dvMode = kFWAVCDVMode_HD_1125_60; 
+				break;
+				
+			// 11250-50
+			case 0x22:
+				dvMode = kFWAVCDVMode_HD_1250_50; 
+				break;
+				
+			// DVCPro50 - NTSC
+			case 0x04:
+				dvMode = kFWAVCDVMode_DVCPro50_525_60; 
+				break;
+				
+			// DVCPro50 - PAL
+			case 0x24:
+				dvMode = kFWAVCDVMode_DVCPro50_625_50; 
+				break;
+			
+			// DVCProHD - NTSC	
+			case 0x14:
+			case 0x15:
+			case 0x18:
+				dvMode = kFWAVCDVMode_DVCPro100_60; 
+				break;
+				
+			// DVCProHD - PAL
+			case 0x34:
+			case 0x35:
+			case 0x38:
+				dvMode = kFWAVCDVMode_DVCPro100_50; 
+				break;
+				
+			default:
+				break;
+		};
+	}
+	else
+		return kIOReturnError;
+
+	if (dvMode == 0xFF)
+		return kIOReturnUnsupportedMode;
+	else
+	{
+		// Locate format information regarding this dvMode
+		// so we can report the frame-size, and the 
+		// source-packet-size.
+		DVFormats* pFormat = &dvFormats[i];
+		
+		while (pFormat->frameSize != 0)
+		{
+			if ((dvMode & 0xFC) == pFormat->mode)
+			{
+				pDVFormat = pFormat;
+				break;
+			}
+			i+=1;
+			pFormat = &dvFormats[i];
+		};
+		
+		if (pDVFormat)	// Since we set the dvMode (above), this should never be null here!
+		{
+			*pDVMode = dvMode;
+			*pFrameSize = pDVFormat->frameSize;
+			*pSourcePacketSize = (pDVFormat->dbs*4)*(1 << pDVFormat->fn);
+			return kIOReturnSuccess;
+		}
+		else
+		{
+			return kIOReturnError;
+		}
+	}
+}
+
+
+//////////////////////////////////////////////////////
+// FindTestDVFormat
+//////////////////////////////////////////////////////
+static DVFormats *FindTestDVFormat(UInt8 dvMode)
+{
+	UInt32 i = 0;
+	
+	while (dvFormats[i].frameSize != 0)
+	{
+		if ((dvMode & 0xFC) == dvFormats[i].mode)
+			return &dvFormats[i];
+		i+=1;
+	}
+	return nil;
+}
+
+//////////////////////////////////////////////////////
+// TestDVSequencesPerChannel
+//////////////////////////////////////////////////////
+static UInt32 TestDVSequencesPerChannel(UInt8 dvMode, UInt32 numSequences)
+{
+	// SDL frames have half the DIF sequences of an SD frame, in one channel
+	if (DVstype(dvMode) == 0x01)
+		return numSequences;
+	else
+		return (DVstandard(dvMode) == kDVStandardPAL) ? 12 : 10;
+}
+
+//////////////////////////////////////////////////////
+// AVSTestMakeDVFrame
+//////////////////////////////////////////////////////
+UInt32 AVSTestMakeDVFrame(UInt8 *pFrameData, UInt8 dvMode)
+{
+	DVFormats *pDVFormat = FindTestDVFormat(dvMode);
+	UInt32 numSequences;
+	UInt32 sequencesPerChannel;
+	UInt32 numChannels;
+	UInt32 sequence;
+	UInt32 channel;
+	UInt32 block;
+	UInt8 *pBlock;
+	UInt8 *pPack;
+	UInt8 sct;
+	UInt8 dbn;
+	UInt8 idByte1;
+	UInt8 vsPackType;
+	
+	if (pDVFormat == nil)
+		return 0;
+	
+	// The VS pack's system type, as GetDVModeFromFrameData decodes it
+	switch (dvMode & 0x7C)
+	{
+		case 0x04: vsPackType = 0x01; break;	// SDL
+		case 0x08: vsPackType = 0x02; break;	// HD
+		case 0x74: vsPackType = 0x04; break;	// DVCPro50
+		case 0x70: vsPackType = 0x14; break;	// DVCPro100
+		default: vsPackType = 0x00; break;		// SD, DVCPro25
+	}
+	vsPackType |= (DVstandard(dvMode) << 5);
+	
+	numSequences = pDVFormat->frameSize / kDVDIFSequenceSize;
+	sequencesPerChannel = TestDVSequencesPerChannel(dvMode, numSequences);
+	numChannels = numSequences / sequencesPerChannel;
+	
+	memset(pFrameData, 0, pDVFormat->frameSize);
+	pBlock = pFrameData;
+	for (sequence=0;sequence<numSequences;sequence++)
+	{
+		// Dseq, FSC (odd channels), and FSP (set, except for channels 2 and 3 of a four channel frame)
+		channel = sequence / sequencesPerChannel;
+		idByte1 = ((sequence % sequencesPerChannel) << 4) | 0x07;
+		if (channel & 0x01)
+			idByte1 |= 0x08;
+		if ((numChannels == 4) && (channel >= 2))
+			idByte1 &= ~0x04;
+		
+		// One header block, two subcode blocks, three VAUX blocks, then nine
+		// times one audio block followed by fifteen video blocks
+		for (block=0;block<150;block++)
+		{
+			if (block == 0)
+			{
+				sct = 0;
+				dbn = 0;
+			}
+			else if (block < 3)
+			{
+				sct = 1;
+				dbn = block-1;
+			}
+			else if (block < 6)
+			{
+				sct = 2;
+				dbn = block-3;
+			}
+			else if (((block-6) % 16) == 0)
+			{
+				sct = 3;
+				dbn = (block-6) / 16;
+			}
+			else
+			{
+				sct = 4;
+				dbn = (((block-6) / 16) * 15) + (((block-6) % 16) - 1);
+			}
+			
+			pBlock[0] = (sct << 5) | 0x10 | 0x0F;
+			pBlock[1] = idByte1;
+			pBlock[2] = dbn;
+			
+			// Header block: DSF and APT (1 for DVCPro25)
+			if (sct == 0)
+			{
+				pBlock[3] = (DVstandard(dvMode) << 7) | 0x3F;
+				pBlock[4] = 0xF8 | (((dvMode & 0x7C) == 0x78) ? 0x01 : 0x00);
+			}
+			
+			// Subcode blocks: no-info packs. The rec date and time go in the second
+			// half of each channel's DIF sequences, along with the timecode (see
+			// AVSTestSetDVFrameTimeCode).
+			if (sct == 1)
+			{
+				memset(&pBlock[3], 0xFF, 77);
+				if ((sequence % sequencesPerChannel) >= (sequencesPerChannel/2))
+				{
+					pPack = &pBlock[6+(1*8)];
+					pPack[0] = 0x62; pPack[1] = 0xFF; pPack[2] = 0xD5; pPack[3] = 0xE6; pPack[4] = 0x07;
+					pPack = &pBlock[6+(2*8)];
+					pPack[0] = 0x63; pPack[1] = 0xFF; pPack[2] = 0xB0; pPack[3] = 0xA0; pPack[4] = 0xD0;
+				}
+			}
+			
+			// VAUX blocks: the VS and VSC packs (4:3), and the rec date (2007-06-15)
+			// and rec time (10:20:30) packs, in the first one. The rest are no-info packs.
+			if (sct == 2)
+			{
+				memset(&pBlock[3], 0xFF, 75);
+				if (dbn == 0)
+				{
+					pPack = &pBlock[3];
+					pPack[0] = 0x60; pPack[3] = vsPackType;
+					pPack = &pBlock[3+5];
+					pPack[0] = 0x61; pPack[1] = 0x03; pPack[2] = 0x80; pPack[3] = 0xFC; pPack[4] = 0xFF;
+					pPack = &pBlock[3+10];
+					pPack[0] = 0x62; pPack[1] = 0xFF; pPack[2] = 0xD5; pPack[3] = 0xE6; pPack[4] = 0x07;
+					pPack = &pBlock[3+15];
+					pPack[0] = 0x63; pPack[1] = 0xFF; pPack[2] = 0xB0; pPack[3] = 0xA0; pPack[4] = 0xD0;
+				}
+			}
+			
+			// Audio blocks: the AAUX source pack (48 KHz, 16 bits, locked) in
+			// the first one. The rest have no-info packs.
+			if (sct == 3)
+			{
+				pPack = &pBlock[3];
+				memset(pPack, 0xFF, 5);
+				if (dbn == 0)
+				{
+					pPack[0] = 0x50;
+					pPack[1] = 0x40 | ((DVstandard(dvMode) == kDVStandardPAL) ? 24 : 20);
+					pPack[2] = 0x00;
+					pPack[3] = 0xC0 | (DVstandard(dvMode) << 5) | DVstype(dvMode);
+					pPack[4] = 0xC0;
+				}
+			}
+			
+			pBlock += 80;
+		}
+	}
+	
+	AVSTestSetDVFrameTimeCode(pFrameData, dvMode, 0, 0, 0, 0, false);
+	
+	return pDVFormat->frameSize;
+}
+
+//////////////////////////////////////////////////////
+// AVSTestSetDVFrameTimeCode
+//////////////////////////////////////////////////////
+void AVSTestSetDVFrameTimeCode(UInt8 *pFrameData, UInt8 dvMode, UInt8 hours, UInt8 minutes, UInt8 seconds, UInt8 frames, bool dropFrame)
+{
+	DVFormats *pDVFormat = FindTestDVFormat(dvMode);
+	UInt32 numSequences;
+	UInt32 sequencesPerChannel;
+	UInt32 sequence;
+	UInt32 block;
+	UInt32 pack;
+	UInt8 *pPack;
+	
+	if (pDVFormat == nil)
+		return;
+	
+	numSequences = pDVFormat->frameSize / kDVDIFSequenceSize;
+	sequencesPerChannel = TestDVSequencesPerChannel(dvMode, numSequences);
+	
+	// The title timecode is in packs 0 and 3 of both subcode blocks, in
+	// the second half of each channel's DIF sequences
+	for (sequence=0;sequence<numSequences;sequence++)
+	{
+		if ((sequence % sequencesPerChannel) < (sequencesPerChannel/2))
+			continue;
+		for (block=1;block<3;block++)
+		{
+			for (pack=0;pack<6;pack+=3)
+			{
+				pPack = &pFrameData[(((sequence*kDVDIFBlocksPerSequence)+block)*kDVDIFBlockSize)+6+(pack*8)];
+				pPack[0] = 0x13;
+				pPack[1] = (dropFrame ? 0x40 : 0x00) | ((frames / 10) << 4) | (frames % 10);
+				pPack[2] = 0x80 | ((seconds / 10) << 4) | (seconds % 10);
+				pPack[3] = 0x80 | ((minutes / 10) << 4) | (minutes % 10);
+				pPack[4] = 0xC0 | ((hours / 10) << 4) | (hours % 10);
+			}
+		}
+	}
+}
+
+} // namespace AVS
@@ -0,0 +1,377 @@
+/*
+	File:		AVSTestSupport.h
+ 
+ Synopsis: Mac OS X types and AVCVideoServices constants for building the hardware-independent parts of the framework, and their tests, on any POSIX system.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+#ifndef __AVCVIDEOSERVICES_AVSTESTSUPPORT__
+#define __AVCVIDEOSERVICES_AVSTESTSUPPORT__
+
+// This header is force-included (with -include) into everything the test
+// Makefile builds. It stands in for AVCVideoServices.h, which needs IOKit and
+// CoreFoundation. It defines the umbrella header's include guard, so the
+// framework sources' own #include "AVCVideoServices.h" becomes a no-op, then
+// supplies just enough of the Mac OS X types, and of the umbrella header's
+// constants, to compile the framework sources that don't touch the hardware.
+// The FireWire and run loop types are opaque here. Nothing in the tests may
+// call into them.
+#define __AVCVIDEOSERVICES_AVCVIDEOSERVICES__
+
+// Include Required Standard Headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Include required STL Headers
+#include <deque>
+
+//////////////////////////////////////////////////////////////////
+// Mac OS X base types
+//////////////////////////////////////////////////////////////////
+typedef uint8_t UInt8;
+typedef int8_t SInt8;
+typedef uint16_t UInt16;
+typedef int16_t SInt16;
+typedef uint32_t UInt32;
+typedef int32_t SInt32;
+typedef uint64_t UInt64;
+typedef int64_t SInt64;
+typedef unsigned char Boolean;
+typedef int IOReturn;
+typedef unsigned int natural_t;
+typedef UInt64 Nanoseconds;
+typedef UInt64 AbsoluteTime;
+
+#ifndef nil
+#define nil NULL
+#endif
+
+// The IOReturn codes the framework uses, with the values from IOReturn.h
+#define kIOReturnSuccess			((IOReturn) 0)
+#define kIOReturnError				((IOReturn) 0xE00002BC)
+#define kIOReturnNoMemory			((IOReturn) 0xE00002BD)
+#define kIOReturnNoResources		((IOReturn) 0xE00002BE)
+#define kIOReturnBadArgument		((IOReturn) 0xE00002C2)
+#define kIOReturnExclusiveAccess	((IOReturn) 0xE00002C5)
+#define kIOReturnUnsupported		((IOReturn) 0xE00002C7)
+#define kIOReturnInternalError		((IOReturn) 0xE00002C9)
+#define kIOReturnIOError			((IOReturn) 0xE00002CA)
+#define kIOReturnNotOpen			((IOReturn) 0xE00002CD)
+#define kIOReturnBusy				((IOReturn) 0xE00002D5)
+#define kIOReturnTimeout			((IOReturn) 0xE00002D6)
+#define kIOReturnNotReady			((IOReturn) 0xE00002D8)
+#define kIOReturnNoSpace			((IOReturn) 0xE00002DB)
+#define kIOReturnUnsupportedMode	((IOReturn) 0xE00002E6)
+#define kIOReturnUnderrun			((IOReturn) 0xE00002E7)
+#define kIOReturnNotFound			((IOReturn) 0xE00002F0)
+
+// Byte order (Endian.h). The tests only run on little-endian hosts.
+#define EndianU16_BtoN(x) ((UInt16) __builtin_bswap16(x))
+#define EndianU32_BtoN(x) ((UInt32) __builtin_bswap32(x))
+#define EndianU64_BtoN(x) ((UInt64) __builtin_bswap64(x))
+#define EndianU16_NtoB(x) ((UInt16) __builtin_bswap16(x))
+#define EndianU32_NtoB(x) ((UInt32) __builtin_bswap32(x))
+#define EndianU64_NtoB(x) ((UInt64) __builtin_bswap64(x))
+
+// Atomics and barriers (libkern/OSAtomic.h)
+#define OSMemoryBarrier() __sync_synchronize()
+static inline int32_t OSAtomicIncrement32Barrier(volatile int32_t *pValue) { return __sync_add_and_fetch(pValue,1); }
+static inline int32_t OSAtomicDecrement32Barrier(volatile int32_t *pValue) { return __sync_sub_and_fetch(pValue,1); }
+static inline int32_t OSAtomicAdd32Barrier(int32_t amount, volatile int32_t *pValue) { return __sync_add_and_fetch(pValue,amount); }
+static inline int64_t OSAtomicAdd64Barrier(int64_t amount, volatile int64_t *pValue) { return __sync_add_and_fetch(pValue,amount); }
+static inline bool OSAtomicCompareAndSwap32Barrier(int32_t oldValue, int32_t newValue, volatile int32_t *pValue) { return __sync_bool_compare_and_swap(pValue,oldValue,newValue); }
+static inline bool OSAtomicCompareAndSwapPtrBarrier(void *oldValue, void *newValue, void * volatile *pValue) { return __sync_bool_compare_and_swap(pValue,oldValue,newValue); }
+
+// Virtual memory (mach/vm_map.h), on top of mmap
+typedef int kern_return_t;
+typedef int vm_map_t;
+typedef unsigned long vm_address_t;
+typedef unsigned long vm_size_t;
+#define KERN_SUCCESS 0
+#define KERN_FAILURE 5
+#define vm_page_size ((vm_size_t) getpagesize())
+#define VM_FLAGS_ANYWHERE 0x0001
+#define VM_FLAGS_SUPERPAGE_SIZE_2M 0x0000
+static inline vm_map_t mach_task_self(void) { return 0; }
+static inline kern_return_t vm_allocate(vm_map_t task, vm_address_t *pAddress, vm_size_t size, int flags)
+{
+	void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return 3;	// KERN_NO_SPACE
+	*pAddress = (vm_address_t) p;
+	return KERN_SUCCESS;
+}
+static inline kern_return_t vm_deallocate(vm_map_t task, vm_address_t address, vm_size_t size)
+{
+	munmap((void*) address, size);
+	return KERN_SUCCESS;
+}
+
+// fcntl(F_NOCACHE) has no Linux equivalent. Make it a harmless F_GETFD.
+#ifndef F_NOCACHE
+#define F_NOCACHE F_GETFD
+#endif
+
+//////////////////////////////////////////////////////////////////
+// Opaque stand-ins for the IOKit and CoreFoundation types that
+// appear in the framework's class declarations
+//////////////////////////////////////////////////////////////////
+typedef struct __CFRunLoop *CFRunLoopRef;
+typedef struct __CFRunLoopSource *CFRunLoopSourceRef;
+typedef struct __CFRunLoopTimer *CFRunLoopTimerRef;
+typedef struct __CFSet *CFMutableSetRef;
+typedef struct __IOFireWireLibNub **IOFireWireLibNubRef;
+typedef struct __IOFireWireLibNub **IOFireWireLibDeviceRef;
+typedef struct __IOFireWireLibIsochPort **IOFireWireLibIsochPortRef;
+typedef struct __IOFireWireLibIsochPort **IOFireWireLibLocalIsochPortRef;
+typedef struct __IOFireWireLibIsochPort **IOFireWireLibRemoteIsochPortRef;
+typedef struct __IOFireWireLibIsochChannel **IOFireWireLibIsochChannelRef;
+typedef struct __IOFireWireLibDCLCommandPool **IOFireWireLibDCLCommandPoolRef;
+typedef struct __IOFireWireLibNuDCLPool **IOFireWireLibNuDCLPoolRef;
+typedef struct __NuDCL *NuDCLRef;
+typedef NuDCLRef NuDCLSendPacketRef;
+typedef NuDCLRef NuDCLReceivePacketRef;
+typedef struct DCLCommandStruct DCLCommand;
+typedef DCLCommand *DCLCommandPtr;
+typedef DCLCommand *DCLJumpPtr;
+typedef DCLCommand *DCLLabelPtr;
+typedef void* DCLCallProcDataType;
+typedef void (*DCLCallCommandProcPtr)(DCLCommandPtr pDCLCommand);
+typedef struct __IOFireWireAVCLibProtocol IOFireWireAVCLibProtocolInterface;
+typedef UInt32 IOFWSpeed;
+typedef struct { UInt32 address; UInt32 length; } IOVirtualRange;
+
+namespace AVS
+{
+
+class AVCDevice;
+
+//////////////////////////////////////////////////////////////////
+// Constants from AVCVideoServices.h. Keep these in sync with it.
+//////////////////////////////////////////////////////////////////
+
+// The DV Modes
+enum
+{
+	kDVModeSDL_625_50 = 0x84,
+	kDVModeSDL_525_60 = 0x04,
+	kDVModeSD_625_50 = 0x80,
+	kDVModeSD_525_60 = 0x00,
+	kDVModeDVCPro25_625_50 = 0xF8,
+	kDVModeDVCPro25_525_60 = 0x78,
+	kDVModeDVCPro50_625_50 = 0xF4,
+	kDVModeDVCPro50_525_60 = 0x74,
+	kDVModeHD_1250_50 = 0x88,
+	kDVModeHD_1125_60 = 0x08,
+	kDVModeDVCPro100_50 = 0xF0,
+	kDVModeDVCPro100_60 = 0x70
+};
+
+// The DV transfer speed
+// Note: These can be logically-or'ed with the DV Mode
+enum
+{
+	kDVTransferSpeedRealTime = 0x00,
+	kDVTransferSpeed_1x = 0x00,
+	kDVTransferSpeed_2x = 0x01,
+	kDVTransferSpeed_4x = 0x02
+};
+
+struct DVFormats
+{
+	// Frame size, in bytes
+	UInt32 frameSize;
+
+	// DV mode (8-bit value)
+	UInt8 mode;
+
+	// Data block size, in quadlets
+	UInt8 dbs;
+
+	// Represents the number of data-blocks in a source packet
+	// A 2-bit value
+	// 0 = 1 datablock, 1 = 2 datablocks, 2 = 4 datablocks, 3 = 8 datablocks
+	UInt8 fn;
+	
+	// The starting SYT offset for transmitting this particular mode of DV
+	UInt32 startingSYTOffset;
+};
+
+typedef unsigned int XmitCycleMode;
+enum
+{
+    CycleModeFull,
+    CycleModeCIPOnly
+};
+
+// A define for any available isoch channel.
+// Specify this value as the DV/MPEG2 receiver
+// or transmitter channel num, to allow the FireWire
+// family's isoch code determine and allocate an available
+// channel. An application can then determine which
+// channel was allocated in the message callback
+// for the AllocateChannel message.
+// Note: This value should only be used if the
+// DV/MPEG Transmitter or DV/MPEG Recevier are created
+// with the doIRMAllocations flag set to true.
+#define kAnyAvailableIsochChannel 0xFFFFFFFF
+
+// Macro to extract the DV standard from the DV mode
+// Same thing works for MPEG devices (HDV, DVHS)
+// A 1-bit value, 0 = NTSC, 1 = PAL
+#define DVstandard(a) (((a) & 0x80) >> 7)
+#define MPEGstandard(a) (((a) & 0x80) >> 7)
+
+#define kVideoStandard60 0
+#define kVideoStandard50 1
+#define kVideoStandardNTSC 0
+#define kVideoStandardPAL 1
+
+// Macro to extract the STYPE from the DV mode
+// A 5-bit value
+#define DVstype(a) (((a) & 0x7C) >> 2)
+
+// Macro to extract the DV speed from the DV mode
+// A 2-bit value, 0 = 1x, 1 = 2x, 2 = 4x
+#define DVspeed(a) ((a) & 0x03)
+
+// NTSC DV Timing Constants
+// ------------------------
+// FramesPerSec = ((1000/1001)*30) = 29.97002997
+// BitsPerSec = (FramesPerSec*(120000*8)) = 28771228.7712288
+// BitsPerSourcePacket = (480*8) = 3840
+// FWClocksPerSec = 24576000.0
+// FWClocksPerSourcePacket = FWClocksPerSec/(BitsPerSec/3840) = 3280.0768
+#define kNTSCFramesPerSecond 29.97002997
+#define kIsochCycleClocksPerNTSCSourcePacket 3280.0768
+
+// PAL DV Timing Constants
+// -----------------------
+// FramesPerSec = 25.000000
+// BitsPerSec = (FramesPerSec*(144000*8)) = 28800000.000
+// BitsPerSourcePacket = (480*8) = 3840
+// FWClocksPerSec = 24576000.0
+// FWClocksPerSourcePacket = FWClocksPerSec/(BitsPerSec/3840) = 3276.8000
+#define kPALFramesPerSecond 25.000000
+#define kIsochCycleClocksPerPALSourcePacket 3276.8000
+
+// The same DV packet periods, exactly, in 1/625ths of a FireWire clock
+enum
+{
+	kDVScaledClockScale = 625,
+	kDVScaledClocksPerNTSCSourcePacket = 2050048,
+	kDVScaledClocksPerPALSourcePacket = 2048000
+};
+
+// Misc DV Constants
+enum
+{
+	kDVStandardNTSC = 0,
+	kDVStandardPAL = 1,
+	kDVXmitCIPOnlySize = 8
+};
+
+// Sizes of MPEG2 stuff
+enum
+{
+	kMPEG2XmitCIPOnlySize = 8,
+	kMPEG2TSPacketSize = 188,
+	kMPEG2TSPacketSizeInWords = 47,
+	kMPEG2SourcePacketSize = 192,
+	kMPEG2DataBlocksPerPacket = 8
+};
+
+// Some Max data rate constants for different number of packets per cycle
+enum
+{
+	kMaxDataRate_EighthTSPacketPerCycle 	= 1504000,
+	kMaxDataRate_QuarterTSPacketPerCycle 	= 3008000,
+	kMaxDataRate_HalfTSPacketPerCycle 		= 6016000,
+	kMaxDataRate_OneTSPacketPerCycle 		= 12032000,
+	kMaxDataRate_TwoTSPackestPerCycle 		= 24064000,
+	kMaxDataRate_ThreeTSPacketsPerCycle 	= 36096000,
+	kMaxDataRate_FourTSPacketsPerCycle 		= 48128000,
+	kMaxDataRate_FiveTSPacketsPerCycle 		= 60160000
+};
+
+} // namespace AVS
+
+// Include Local Headers, in AVCVideoServices.h order, skipping
+// the ones that can only be built against IOKit
+#include "AVSShared.h"
+#include "AVSCommon.h"
+#include "StringLogger.h"
+#include "FWCycleTime.h"
+#include "TSPacket.h"
+#include "PSITables.h"
+#include "MPEG2XmitCycle.h"
+#include "MPEG2Transmitter.h"
+#include "MPEG2Receiver.h"
+#include "MPEG2RecordingSink.h"
+#include "DVFrameValidator.h"
+#include "DVFrameMetadata.h"
+#include "DVFrameBufferPool.h"
+#include "DVFramer.h"
+#include "DVTransmitCadence.h"
+#include "DVXmitCycle.h"
+#include "DVTransmitter.h"
+#include "DVThumbnailer.h"
+#include "DVReceiver.h"
+#include "DVAudioExtractor.h"
+#include "DVFrameIndexRing.h"
+#include "DVFrameReader.h"
+#include "DVFileSource.h"
+#include "DVTimeline.h"
+#include "DVRecorder.h"
+#include "FireWireDV.h"
+
+#endif // __AVCVIDEOSERVICES_AVSTESTSUPPORT__
@@ -0,0 +1,348 @@
+/*
+	File:		DVAudioExtractorTest.cpp
+ 
+ Synopsis: Tests for DVAudioExtractor's audio de-shuffling, in every DV mode it supports.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Fills the audio DIF blocks of test frames with a known sample for every channel
+// and sample slot, placed with the shuffle tables from the DV specs (IEC 61834-2
+// tables 22 and 23, as libdv has them) rather than with the extractor's own
+// formula, and checks that the extractor puts every sample back where it belongs.
+// Covers each DV mode with its own audio layout (SD, DVCPro25, DVCPro50, and
+// DVCPro100, in both standards), 16 and 12-bit samples, each sample rate, contiguous
+// and scatter-list frames, error samples, and modes it doesn't support.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kTestMaxFrameSize = 576000,
+	kTestBufferSamples = (kDVAudioMaxSamplesPerFrame * kDVAudioMaxChannels),
+	kTestAudioFirstBlock = 6,
+	kTestAudioBlockInterval = 16,
+	kTestErrorCode16Bit = 0x8000,
+	kTestErrorCode12Bit = 0x800
+};
+
+#define TestDIFBlockOffset(sequence,block) ((((sequence)*kDVDIFBlocksPerSequence)+(block))*kDVDIFBlockSize)
+
+// The sample position of each audio block's first sample, by DIF sequence (of
+// a half of a channel's sequences) and audio block
+static const UInt32 shuffle525_60[5][9] =
+{
+	{ 0, 15, 30, 10, 25, 40,  5, 20, 35},
+	{ 3, 18, 33, 13, 28, 43,  8, 23, 38},
+	{ 6, 21, 36,  1, 16, 31, 11, 26, 41},
+	{ 9, 24, 39,  4, 19, 34, 14, 29, 44},
+	{12, 27, 42,  7, 22, 37,  2, 17, 32}
+};
+
+static const UInt32 shuffle625_50[6][9] =
+{
+	{ 0, 18, 36, 13, 31, 49,  8, 26, 44},
+	{ 3, 21, 39, 16, 34, 52, 11, 29, 47},
+	{ 6, 24, 42,  1, 19, 37, 14, 32, 50},
+	{ 9, 27, 45,  4, 22, 40, 17, 35, 53},
+	{12, 30, 48,  7, 25, 43,  2, 20, 38},
+	{15, 33, 51, 10, 28, 46,  5, 23, 41}
+};
+
+static const UInt32 sampleRates[3] = {48000, 44100, 32000};
+static const UInt32 minSamplesPerFrame[2][3] = {{1580, 1452, 1053}, {1896, 1742, 1264}};
+
+static UInt8 frameData[kTestMaxFrameSize];
+static SInt16 samples[kTestBufferSamples];
+
+//////////////////////////////////////////////////////
+// TestSample16 - The 16-bit sample for a channel and sample slot (never the error code)
+//////////////////////////////////////////////////////
+static SInt16 TestSample16(UInt32 channel, UInt32 slot)
+{
+	SInt16 sample = (SInt16) (((channel * 7919) + (slot * 31)) ^ 0x1234);
+	
+	return (sample == (SInt16) kTestErrorCode16Bit) ? 1 : sample;
+}
+
+//////////////////////////////////////////////////////
+// TestSample12 - The 12-bit code for a channel and sample slot (never the error code)
+//////////////////////////////////////////////////////
+static UInt32 TestSample12(UInt32 channel, UInt32 slot)
+{
+	UInt32 code = ((channel * 577) + (slot * 13)) & 0xFFF;
+	
+	return (code == kTestErrorCode12Bit) ? (kTestErrorCode12Bit + 1) : code;
+}
+
+//////////////////////////////////////////////////////
+// Expand12Bit - 12-bit non-linear to 16-bit linear (IEC 61834-2 figure 12)
+//////////////////////////////////////////////////////
+static SInt16 Expand12Bit(UInt32 code)
+{
+	SInt32 sample = (code > 2047) ? ((SInt32) code - 4096) : (SInt32) code;
+	SInt32 shift = (code & 0xF00) >> 8;
+	
+	if ((shift < 2) || (shift > 0xD))
+		return sample;
+	if (shift < 8)
+	{
+		shift -= 1;
+		return (sample - (256*shift)) << shift;
+	}
+	shift = 0xE - shift;
+	return ((sample + (256*shift) + 1) << shift) - 1;
+}
+
+//////////////////////////////////////////////////////
+// MakeAudioFrame - Make a frame, and fill in its audio. Returns the number of audio channels.
+//////////////////////////////////////////////////////
+static UInt32 MakeAudioFrame(UInt8 dvMode, UInt32 smp, UInt32 qu, UInt32 afSize, UInt32 *pFrameLen)
+{
+	bool pal = (DVstandard(dvMode) == kDVStandardPAL);
+	UInt32 sequencesPerHalf = (pal == true) ? 6 : 5;
+	UInt32 sequencesPerChannel = 2*sequencesPerHalf;
+	UInt32 numSequences;
+	UInt32 sequence;
+	UInt32 channel;
+	UInt32 block;
+	UInt32 position;
+	UInt32 slot;
+	UInt32 codeY;
+	UInt32 codeZ;
+	SInt16 sample;
+	UInt8 *pBlock;
+	
+	*pFrameLen = AVSTestMakeDVFrame(frameData, dvMode);
+	numSequences = *pFrameLen / kDVDIFSequenceSize;
+	
+	for (sequence=0;sequence<numSequences;sequence++)
+	{
+		// The first half of a channel's DIF sequences carries its first audio
+		// channel (or pair of 12-bit channels), and the second half the next
+		channel = (2 * (sequence / sequencesPerChannel)) + ((sequence % sequencesPerChannel) / sequencesPerHalf);
+		if (qu == 1)
+			channel *= 2;
+		
+		for (block=0;block<kDVAudioBlocksPerSequence;block++)
+		{
+			pBlock = &frameData[TestDIFBlockOffset(sequence, (kTestAudioFirstBlock + (block*kTestAudioBlockInterval)))];
+			
+			// The AAUX source pack
+			if (block == 0)
+			{
+				pBlock[4] = (pBlock[4] & 0xC0) | afSize;
+				pBlock[7] = 0xC0 | (smp << 3) | qu;
+			}
+			
+			slot = (pal == true) ? shuffle625_50[sequence % sequencesPerHalf][block] :
+								   shuffle525_60[sequence % sequencesPerHalf][block];
+			if (qu == 0)
+			{
+				for (position=0;position<(kDVAudioBlockDataSize/2);position++)
+				{
+					sample = TestSample16(channel, slot + (position * sequencesPerHalf * 9));
+					pBlock[kDVAudioBlockDataOffset + (position*2)] = ((UInt16) sample) >> 8;
+					pBlock[kDVAudioBlockDataOffset + (position*2) + 1] = ((UInt16) sample) & 0xFF;
+				}
+			}
+			else
+			{
+				for (position=0;position<(kDVAudioBlockDataSize/3);position++)
+				{
+					codeY = TestSample12(channel, slot + (position * sequencesPerHalf * 9));
+					codeZ = TestSample12(channel+1, slot + (position * sequencesPerHalf * 9));
+					pBlock[kDVAudioBlockDataOffset + (position*3)] = codeY >> 4;
+					pBlock[kDVAudioBlockDataOffset + (position*3) + 1] = codeZ >> 4;
+					pBlock[kDVAudioBlockDataOffset + (position*3) + 2] = ((codeY & 0x0F) << 4) | (codeZ & 0x0F);
+				}
+			}
+		}
+	}
+	
+	return (2 * (numSequences / sequencesPerChannel)) * ((qu == 1) ? 2 : 1);
+}
+
+//////////////////////////////////////////////////////
+// CheckSamples - Count the output samples that aren't the ones put in the frame
+//////////////////////////////////////////////////////
+static UInt32 CheckSamples(UInt8 dvMode, UInt32 qu, UInt32 numChannels)
+{
+	UInt32 sequencesPerHalf = (DVstandard(dvMode) == kDVStandardPAL) ? 6 : 5;
+	UInt32 numSlots = sequencesPerHalf * kDVAudioBlocksPerSequence * ((qu == 0) ? 36 : 24);
+	UInt32 slot;
+	UInt32 channel;
+	SInt16 expected;
+	UInt32 badSamples = 0;
+	
+	for (slot=0;slot<numSlots;slot++)
+	{
+		for (channel=0;channel<numChannels;channel++)
+		{
+			expected = (qu == 0) ? TestSample16(channel, slot) : Expand12Bit(TestSample12(channel, slot));
+			if (samples[(slot*numChannels) + channel] != expected)
+				badSamples += 1;
+		}
+	}
+	
+	return badSamples;
+}
+
+//////////////////////////////////////////////////////
+// TestMode
+//////////////////////////////////////////////////////
+static void TestMode(UInt8 dvMode, UInt32 smp, UInt32 qu, UInt32 afSize, bool scatter)
+{
+	DVAudioExtractor extractor;
+	DVAudioFrameInfo info;
+	DVReceiveFrame receiveFrame;
+	DVReceiveFrameRange ranges[1500];
+	UInt32 frameLen;
+	UInt32 numChannels;
+	UInt32 numRanges = 0;
+	UInt32 offset = 0;
+	IOReturn result;
+	bool pal = (DVstandard(dvMode) == kDVStandardPAL);
+	
+	numChannels = MakeAudioFrame(dvMode, smp, qu, afSize, &frameLen);
+	memset(samples, 0x55, sizeof(samples));
+	
+	if (scatter == false)
+		result = extractor.extractAudio(frameData, frameLen, dvMode, samples, kTestBufferSamples, &info);
+	else
+	{
+		// Ranges of one and two data blocks, as a receiver's DCL buffers would hand them over
+		while (offset < frameLen)
+		{
+			ranges[numRanges].pData = &frameData[offset];
+			ranges[numRanges].length = ((numRanges % 3) == 0) ? 480 : 960;
+			if ((offset + ranges[numRanges].length) > frameLen)
+				ranges[numRanges].length = frameLen - offset;
+			offset += ranges[numRanges].length;
+			numRanges += 1;
+		}
+		bzero(&receiveFrame, sizeof(DVReceiveFrame));
+		receiveFrame.frameLen = frameLen;
+		receiveFrame.frameMode = dvMode;
+		receiveFrame.pFrameRanges = ranges;
+		receiveFrame.frameRangeCount = numRanges;
+		receiveFrame.frameSYTTime = 0x1234;
+		result = extractor.extractAudio(&receiveFrame, samples, kTestBufferSamples, &info);
+		AVSTestCheck(info.frameSYTTime == 0x1234);
+	}
+	
+	AVSTestCheck(result == kIOReturnSuccess);
+	AVSTestCheck(info.numChannels == numChannels);
+	AVSTestCheck(info.sampleRate == sampleRates[smp]);
+	AVSTestCheck(info.samplesPerFrame == (minSamplesPerFrame[pal ? 1 : 0][smp] + afSize));
+	AVSTestCheck(info.bitsPerSample == ((qu == 0) ? 16 : 12));
+	AVSTestCheck(info.errorSamples == 0);
+	AVSTestCheck(CheckSamples(dvMode, qu, numChannels) == 0);
+}
+
+//////////////////////////////////////////////////////
+// TestErrors
+//////////////////////////////////////////////////////
+static void TestErrors(void)
+{
+	DVAudioExtractor extractor;
+	DVAudioFrameInfo info;
+	UInt32 frameLen;
+	UInt8 *pBlock;
+	
+	// An error sample comes out as zero, and is counted
+	MakeAudioFrame(0x00, 0, 0, 20, &frameLen);
+	pBlock = &frameData[TestDIFBlockOffset(0, kTestAudioFirstBlock)];
+	pBlock[kDVAudioBlockDataOffset] = (kTestErrorCode16Bit >> 8) & 0xFF;
+	pBlock[kDVAudioBlockDataOffset+1] = kTestErrorCode16Bit & 0xFF;
+	AVSTestCheck(extractor.extractAudio(frameData, frameLen, 0x00, samples, kTestBufferSamples, &info) == kIOReturnSuccess);
+	AVSTestCheck((info.errorSamples == 1) && (samples[0] == 0));
+	
+	// Too small a buffer, and the wrong frame length
+	AVSTestCheck(extractor.extractAudio(frameData, frameLen, 0x00, samples, 100, &info) == kIOReturnNoSpace);
+	AVSTestCheck(extractor.extractAudio(frameData, frameLen-480, 0x00, samples, kTestBufferSamples, &info) == kIOReturnBadArgument);
+	
+	// SDL has a different audio layout, and 0x3C isn't a mode at all. A mode that
+	// isn't supported stays unsupported, however many times it's tried, and
+	// doesn't disturb the mode that was already set.
+	AVSTestCheck(extractor.setDVMode(0x04) == kIOReturnUnsupported);
+	AVSTestCheck(extractor.setDVMode(0x3C) == kIOReturnUnsupported);
+	AVSTestCheck(extractor.extractAudio(frameData, 60000, 0x04, samples, kTestBufferSamples, &info) == kIOReturnUnsupported);
+	AVSTestCheck(extractor.extractAudio(frameData, 60000, 0x04, samples, kTestBufferSamples, &info) == kIOReturnUnsupported);
+	AVSTestCheck(extractor.extractAudio(frameData, frameLen, 0x00, samples, kTestBufferSamples, &info) == kIOReturnSuccess);
+	
+	DVAudioExtractor sdlExtractor(0x04);
+	AVSTestCheck(sdlExtractor.extractAudio(frameData, 60000, 0x04, samples, kTestBufferSamples, &info) == kIOReturnUnsupported);
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	// SD, with each sample rate and quantization
+	TestMode(0x00, 0, 0, 20, false);
+	TestMode(0x80, 0, 0, 24, false);
+	TestMode(0x00, 1, 0, 10, true);
+	TestMode(0x80, 1, 0, 0, false);
+	TestMode(0x00, 2, 0, 5, false);
+	TestMode(0x00, 2, 1, 0, false);
+	TestMode(0x80, 2, 1, 16, true);
+	
+	// The professional modes, with more DIF sequences (and channels) per frame
+	TestMode(0x78, 0, 0, 22, false);
+	TestMode(0xF8, 0, 0, 24, true);
+	TestMode(0x74, 0, 0, 20, false);
+	TestMode(0xF4, 0, 0, 24, true);
+	TestMode(0x70, 0, 0, 20, true);
+	TestMode(0xF0, 0, 0, 20, false);
+	
+	// The speed bits don't change the layout
+	TestMode(0x01, 0, 0, 20, false);
+	
+	TestErrors();
+	
+	return AVSTestFinish("DVAudioExtractorTest");
+}
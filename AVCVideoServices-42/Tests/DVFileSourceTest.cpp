@@ -0,0 +1,367 @@
+/*
+	File:		DVFileSourceTest.cpp
+ 
+ Synopsis: Tests for DVFrameIndexRing, and for DVFileSource feeding a stand-in DVTransmitter.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Checks DVFrameIndexRing's fifo order, full and empty handling, and wrapping, on
+// one thread and then between a producer and a consumer thread. Then plays a scratch
+// DV file through a DVFileSource, with this thread making the FramePull and
+// FrameRelease calls the transmitter's DCL callback thread would make, and checks
+// that every frame arrives in order, that a seek discards the frames prefetched
+// before it, that loop mode wraps, and that playback completes at the end of the file.
+//
+// DVFileSource only uses the transmitter's frame structs, so the DVTransmitter
+// members it calls are replaced below with stand-ins that own a few frame buffers.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kTestRingCapacity = 5,
+	kTestThreadedValues = 1000000,
+	kTestFileFrames = 20,
+	kTestTransmitterFrames = 4,
+	kTestMaxFrameSize = 144000,
+	kTestPullTimeoutMilliseconds = 2000
+};
+
+static DVTransmitFrame testFrames[kTestTransmitterFrames];
+static UInt8 *pTestFrameData[kTestTransmitterFrames];
+
+//////////////////////////////////////////////////////
+// DVTransmitter stand-ins
+//////////////////////////////////////////////////////
+namespace AVS
+{
+DVTransmitter::DVTransmitter(StringLogger *stringLogger,
+							 IOFireWireLibNubRef nubInterface,
+							 UInt8 transmitterDVMode,
+							 UInt32 numFrameBuffers,
+							 unsigned int cyclesPerSegment,
+							 unsigned int numSegments,
+							 bool doIRMAllocations)
+{
+	numFrames = kTestTransmitterFrames;
+}
+
+DVTransmitter::~DVTransmitter()
+{
+}
+
+UInt32 DVTransmitter::getNumFrames(void)
+{
+	return numFrames;
+}
+
+DVTransmitFrame* DVTransmitter::getFrame(UInt32 frameIndex)
+{
+	return (frameIndex < numFrames) ? &testFrames[frameIndex] : nil;
+}
+} // namespace AVS
+
+//////////////////////////////////////////////////////
+// TestRing
+//////////////////////////////////////////////////////
+static void TestRing(void)
+{
+	DVFrameIndexRing ring;
+	UInt32 value;
+	UInt32 nextPush = 0;
+	UInt32 nextPop = 0;
+	UInt32 i, j;
+	
+	// Not set up yet
+	AVSTestCheck(ring.push(1) == false);
+	AVSTestCheck(ring.pop(&value) == false);
+	AVSTestCheck(ring.setup(0) == kIOReturnBadArgument);
+	
+	AVSTestCheck(ring.setup(kTestRingCapacity) == kIOReturnSuccess);
+	AVSTestCheck(ring.getCapacity() == kTestRingCapacity);
+	AVSTestCheck(ring.count() == 0);
+	
+	// Fill it, and overfill it
+	for (i=0;i<kTestRingCapacity;i++)
+	{
+		AVSTestCheck(ring.push(nextPush++) == true);
+		AVSTestCheck(ring.count() == (i+1));
+	}
+	AVSTestCheck(ring.push(nextPush) == false);
+	AVSTestCheck(ring.count() == kTestRingCapacity);
+	
+	// Empty it, and overempty it
+	for (i=0;i<kTestRingCapacity;i++)
+	{
+		AVSTestCheck((ring.pop(&value) == true) && (value == nextPop++));
+		AVSTestCheck(ring.count() == (kTestRingCapacity-i-1));
+	}
+	AVSTestCheck(ring.pop(&value) == false);
+	
+	// Push and pop different amounts, so the head and tail wrap at every offset
+	for (i=0;i<1000;i++)
+	{
+		for (j=0;j<=(i % kTestRingCapacity);j++)
+			AVSTestCheck(ring.push(nextPush++) == true);
+		for (j=0;j<=(i % kTestRingCapacity);j++)
+			AVSTestCheck((ring.pop(&value) == true) && (value == nextPop++));
+		AVSTestCheck(ring.count() == 0);
+	}
+	
+	// A full ring wraps too
+	for (i=0;i<(kTestRingCapacity*3);i++)
+	{
+		while (ring.push(nextPush) == true)
+			nextPush += 1;
+		AVSTestCheck(ring.count() == kTestRingCapacity);
+		AVSTestCheck((ring.pop(&value) == true) && (value == nextPop++));
+	}
+	
+	// Resetting empties it
+	ring.reset();
+	AVSTestCheck(ring.count() == 0);
+	AVSTestCheck(ring.pop(&value) == false);
+}
+
+//////////////////////////////////////////////////////
+// RingProducerThread
+//////////////////////////////////////////////////////
+static void *RingProducerThread(void *pRefCon)
+{
+	DVFrameIndexRing *pRing = (DVFrameIndexRing*) pRefCon;
+	UInt32 i;
+	
+	for (i=0;i<kTestThreadedValues;i++)
+	{
+		while (pRing->push(i) == false)
+			sched_yield();
+	}
+	
+	return nil;
+}
+
+//////////////////////////////////////////////////////
+// TestRingThreads
+//////////////////////////////////////////////////////
+static void TestRingThreads(void)
+{
+	DVFrameIndexRing ring;
+	pthread_t producer;
+	UInt32 value;
+	UInt32 expected = 0;
+	UInt32 outOfOrder = 0;
+	
+	AVSTestCheck(ring.setup(kTestRingCapacity) == kIOReturnSuccess);
+	AVSTestCheck(pthread_create(&producer, NULL, RingProducerThread, &ring) == 0);
+	
+	while (expected < kTestThreadedValues)
+	{
+		if (ring.pop(&value) == false)
+		{
+			sched_yield();
+			continue;
+		}
+		if (value != expected)
+			outOfOrder += 1;
+		expected += 1;
+	}
+	
+	pthread_join(producer, NULL);
+	AVSTestCheck(outOfOrder == 0);
+	AVSTestCheck(ring.count() == 0);
+}
+
+//////////////////////////////////////////////////////
+// FileFrameNumber - The file frame number written into the end of a test frame
+//////////////////////////////////////////////////////
+static UInt32 FileFrameNumber(UInt32 frameIndex, UInt32 frameSize)
+{
+	UInt32 frameNumber;
+	
+	memcpy(&frameNumber, &pTestFrameData[frameIndex][frameSize-sizeof(UInt32)], sizeof(UInt32));
+	return frameNumber;
+}
+
+//////////////////////////////////////////////////////
+// PullFrame - Pull like the transmitter, waiting for the reader thread if needed
+//////////////////////////////////////////////////////
+static bool PullFrame(DVFileSource *pSource, UInt32 *pFrameIndex)
+{
+	UInt32 i;
+	
+	for (i=0;i<kTestPullTimeoutMilliseconds;i++)
+	{
+		if (DVFileSource::FramePull(pFrameIndex, pSource) == kIOReturnSuccess)
+			return true;
+		usleep(1000);
+	}
+	
+	return false;
+}
+
+//////////////////////////////////////////////////////
+// PullAndRelease - Pull the next frame, check its file frame number, and release it
+//////////////////////////////////////////////////////
+static bool PullAndRelease(DVFileSource *pSource, UInt32 expectedFileFrame, UInt32 frameSize)
+{
+	UInt32 frameIndex;
+	bool result;
+	
+	if (PullFrame(pSource, &frameIndex) == false)
+		return false;
+	
+	result = (frameIndex < kTestTransmitterFrames) && (FileFrameNumber(frameIndex, frameSize) == expectedFileFrame);
+	DVFileSource::FrameRelease(frameIndex, pSource);
+	
+	return result;
+}
+
+//////////////////////////////////////////////////////
+// TestFileSource
+//////////////////////////////////////////////////////
+static void TestFileSource(void)
+{
+	char path[256];
+	UInt8 *pFrame;
+	UInt32 frameSize;
+	UInt32 frameIndex;
+	UInt32 i;
+	FILE *pFile;
+	DVFileSourceStats stats;
+	
+	// Write a file of SD frames, each numbered in its last four bytes
+	pFrame = new UInt8[kTestMaxFrameSize];
+	frameSize = AVSTestMakeDVFrame(pFrame, 0x00);
+	AVSTestMakeScratchFilePath(path, sizeof(path), "DVFileSourceTest.dv");
+	pFile = fopen(path, "wb");
+	AVSTestCheck(pFile != nil);
+	if (!pFile)
+	{
+		delete [] pFrame;
+		return;
+	}
+	for (i=0;i<kTestFileFrames;i++)
+	{
+		memcpy(&pFrame[frameSize-sizeof(UInt32)], &i, sizeof(UInt32));
+		fwrite(pFrame, 1, frameSize, pFile);
+	}
+	fclose(pFile);
+	delete [] pFrame;
+	
+	for (i=0;i<kTestTransmitterFrames;i++)
+	{
+		pTestFrameData[i] = new UInt8[frameSize];
+		bzero(&testFrames[i], sizeof(DVTransmitFrame));
+		testFrames[i].frameIndex = i;
+		testFrames[i].pFrameData = pTestFrameData[i];
+		testFrames[i].frameLen = frameSize;
+	}
+	
+	DVTransmitter transmitter;
+	DVFileSource source;
+	
+	AVSTestCheck(source.openFile(path) == kIOReturnSuccess);
+	AVSTestCheck(source.getDVMode() == 0x00);
+	AVSTestCheck(source.getNumFileFrames() == kTestFileFrames);
+	
+	// The queue starts full
+	AVSTestCheck(source.prepareFrameQueue(&transmitter) == kIOReturnSuccess);
+	source.getStats(&stats);
+	AVSTestCheck(stats.prefetchDepth == kTestTransmitterFrames);
+	AVSTestCheck(stats.framesRead == kTestTransmitterFrames);
+	
+	// Play the first half in order
+	for (i=0;i<(kTestFileFrames/2);i++)
+		AVSTestCheck(PullAndRelease(&source, i, frameSize));
+	
+	// Seek back. Frames prefetched before the seek must never come out.
+	AVSTestCheck(source.seekToFrame(3) == kIOReturnSuccess);
+	for (i=3;i<kTestFileFrames;i++)
+		AVSTestCheck(PullAndRelease(&source, i, frameSize));
+	
+	// The end of the file. The transmitter repeats its last frame until playback is complete.
+	for (i=0;(i<kTestPullTimeoutMilliseconds) && (source.isPlaybackComplete() == false);i++)
+	{
+		AVSTestCheck(DVFileSource::FramePull(&frameIndex, &source) != kIOReturnSuccess);
+		usleep(1000);
+	}
+	AVSTestCheck(source.isPlaybackComplete() == true);
+	
+	// Looping restarts the reader at the start of the file
+	source.setLoopMode(true);
+	for (i=0;i<(kTestFileFrames+5);i++)
+		AVSTestCheck(PullAndRelease(&source, (i % kTestFileFrames), frameSize));
+	AVSTestCheck(source.isPlaybackComplete() == false);
+	
+	source.getStats(&stats);
+	AVSTestCheck(stats.framesTransmitted == ((kTestFileFrames/2) + (kTestFileFrames-3) + (kTestFileFrames+5)));
+	AVSTestCheck(stats.loops >= 1);
+	AVSTestCheck(stats.readErrors == 0);
+	AVSTestCheck(stats.minPrefetchDepth < kTestTransmitterFrames);
+	
+	// Restarting the transmitter replays the frames that were prefetched but never sent
+	AVSTestCheck(source.prepareFrameQueue(&transmitter) == kIOReturnSuccess);
+	AVSTestCheck(PullAndRelease(&source, 5, frameSize));
+	
+	AVSTestCheck(source.closeFile() == kIOReturnSuccess);
+	AVSTestCheck(source.closeFile() == kIOReturnNotOpen);
+	
+	for (i=0;i<kTestTransmitterFrames;i++)
+		delete [] pTestFrameData[i];
+	AVSTestRemoveScratchFile(path);
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	TestRing();
+	TestRingThreads();
+	TestFileSource();
+	
+	return AVSTestFinish("DVFileSourceTest");
+}
@@ -0,0 +1,216 @@
+/*
+	File:		DVFrameBufferPoolTest.cpp
+ 
+ Synopsis: Tests of DVFrameBufferPool growth, buffer release, and reuse.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Grows a pool one allocation at a time, checking that each size class doubles
+// (up to kDVFrameBufferPoolMaxGrowBuffers buffers at a time), then releases every
+// buffer out of order, across all of the slabs, and checks that they're reused
+// without growing the pool again. Also checks that a buffer from another pool is
+// refused, and that a pool that isn't allowed to grow fails allocations instead.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kTestAllocations = 40,
+	kTestSDFrameSize = 120000
+};
+
+//////////////////////////////////////////////////////
+// GetSizeClassStats
+//////////////////////////////////////////////////////
+static DVFrameBufferPoolSizeClassStats GetSizeClassStats(DVFrameBufferPool *pPool, UInt32 bufferSize)
+{
+	DVFrameBufferPoolStats stats;
+	UInt32 i;
+	
+	pPool->getStats(&stats);
+	for (i=0;i<stats.numSizeClasses;i++)
+	{
+		if (stats.sizeClass[i].bufferSize == bufferSize)
+			return stats.sizeClass[i];
+	}
+	
+	bzero(&stats.sizeClass[0],sizeof(DVFrameBufferPoolSizeClassStats));
+	return stats.sizeClass[0];
+}
+
+//////////////////////////////////////////////////////
+// TestGrowAndRelease
+//////////////////////////////////////////////////////
+static void TestGrowAndRelease(void)
+{
+	DVFrameBufferPool pool;
+	DVFrameBufferPoolSizeClassStats stats;
+	UInt8 *pBuffers[kTestAllocations];
+	UInt32 expectedTotal = 0;
+	UInt32 expectedGrows = 0;
+	UInt32 maxGrowBuffers = kDVFrameBufferPoolMaxGrowBuffers;
+	UInt32 i, j;
+	
+	for (i=0;i<kTestAllocations;i++)
+	{
+		// The pool only grows when it's full, by as many buffers as it already has
+		if (i == expectedTotal)
+		{
+			expectedGrows += 1;
+			expectedTotal += (expectedTotal == 0) ? 1 : ((expectedTotal < maxGrowBuffers) ? expectedTotal : maxGrowBuffers);
+		}
+		
+		pBuffers[i] = pool.allocateBuffer(kTestSDFrameSize);
+		AVSTestCheck(pBuffers[i] != nil);
+		AVSTestCheck((((unsigned long) pBuffers[i]) % kDVFrameBufferPoolBufferHeaderSize) == 0);
+		
+		// The whole buffer is usable
+		memset(pBuffers[i], (int) i, kTestSDFrameSize);
+		
+		stats = GetSizeClassStats(&pool, kTestSDFrameSize);
+		AVSTestCheck(stats.totalBuffers == expectedTotal);
+		AVSTestCheck(stats.growAllocations == expectedGrows);
+		AVSTestCheck(stats.buffersInUse == (i+1));
+	}
+	
+	// No buffer was handed out twice, or overwritten by its neighbors
+	for (i=0;i<kTestAllocations;i++)
+	{
+		AVSTestCheck((pBuffers[i][0] == (UInt8) i) && (pBuffers[i][kTestSDFrameSize-1] == (UInt8) i));
+		for (j=i+1;j<kTestAllocations;j++)
+			AVSTestCheck(pBuffers[i] != pBuffers[j]);
+	}
+	
+	// Release them out of order, so they come from every slab
+	for (i=0;i<kTestAllocations;i+=2)
+		pool.releaseBuffer(pBuffers[i]);
+	for (i=1;i<kTestAllocations;i+=2)
+		pool.releaseBuffer(pBuffers[kTestAllocations-i]);
+	stats = GetSizeClassStats(&pool, kTestSDFrameSize);
+	AVSTestCheck(stats.buffersInUse == 0);
+	AVSTestCheck(stats.maxBuffersInUse == kTestAllocations);
+	
+	// And they're all reused, without growing the pool
+	for (i=0;i<expectedTotal;i++)
+	{
+		pBuffers[i % kTestAllocations] = pool.allocateBuffer(kTestSDFrameSize);
+		AVSTestCheck(pBuffers[i % kTestAllocations] != nil);
+		if (i >= kTestAllocations)
+			pool.releaseBuffer(pBuffers[i % kTestAllocations]);
+	}
+	stats = GetSizeClassStats(&pool, kTestSDFrameSize);
+	AVSTestCheck(stats.totalBuffers == expectedTotal);
+	AVSTestCheck(stats.growAllocations == expectedGrows);
+	for (i=0;i<kTestAllocations;i++)
+		pool.releaseBuffer(pBuffers[i]);
+	
+	stats = GetSizeClassStats(&pool, kTestSDFrameSize);
+	AVSTestCheck(stats.buffersInUse == 0);
+}
+
+//////////////////////////////////////////////////////
+// TestForeignBuffer
+//////////////////////////////////////////////////////
+static void TestForeignBuffer(void)
+{
+	DVFrameBufferPool pool;
+	DVFrameBufferPool otherPool;
+	UInt8 *pBuffer;
+	UInt8 *pOtherBuffer;
+	
+	pBuffer = pool.allocateBuffer(kTestSDFrameSize);
+	pOtherBuffer = otherPool.allocateBuffer(kTestSDFrameSize);
+	AVSTestCheck((pBuffer != nil) && (pOtherBuffer != nil));
+	
+	// The other pool's buffer names a slab index this pool has, but isn't in it
+	pool.releaseBuffer(pOtherBuffer);
+	AVSTestCheck(GetSizeClassStats(&pool, kTestSDFrameSize).buffersInUse == 1);
+	AVSTestCheck(GetSizeClassStats(&otherPool, kTestSDFrameSize).buffersInUse == 1);
+	
+	pool.releaseBuffer(pBuffer);
+	otherPool.releaseBuffer(pOtherBuffer);
+	AVSTestCheck(GetSizeClassStats(&pool, kTestSDFrameSize).buffersInUse == 0);
+	AVSTestCheck(GetSizeClassStats(&otherPool, kTestSDFrameSize).buffersInUse == 0);
+}
+
+//////////////////////////////////////////////////////
+// TestNoGrowth
+//////////////////////////////////////////////////////
+static void TestNoGrowth(void)
+{
+	DVFrameBufferPool pool(nil, false);
+	DVFrameBufferPoolSizeClassStats stats;
+	UInt8 *pBuffers[3];
+	
+	AVSTestCheck(pool.reserveBuffersForDVMode(kDVModeSD_525_60, 2) == kIOReturnSuccess);
+	pBuffers[0] = pool.allocateBuffer(kTestSDFrameSize);
+	pBuffers[1] = pool.allocateBuffer(kTestSDFrameSize);
+	pBuffers[2] = pool.allocateBuffer(kTestSDFrameSize);
+	AVSTestCheck((pBuffers[0] != nil) && (pBuffers[1] != nil) && (pBuffers[2] == nil));
+	
+	stats = GetSizeClassStats(&pool, kTestSDFrameSize);
+	AVSTestCheck(stats.totalBuffers == 2);
+	AVSTestCheck(stats.growAllocations == 0);
+	AVSTestCheck(stats.failedAllocations == 1);
+	
+	pool.releaseBuffer(pBuffers[0]);
+	pool.releaseBuffer(pBuffers[1]);
+	
+	// A buffer bigger than any DV frame has no size class
+	AVSTestCheck(pool.allocateBuffer(576001) == nil);
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	TestGrowAndRelease();
+	TestForeignBuffer();
+	TestNoGrowth();
+	
+	return AVSTestFinish("DVFrameBufferPoolTest");
+}
@@ -0,0 +1,306 @@
+/*
+	File:		DVFrameMetadataBench.cpp
+ 
+ Synopsis: Benchmark of DV frame metadata extraction, over synthetic frames or a raw DV file.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Times GetDVFrameMetadata on whole frames, and GetDVFrameMetadataWithDIFBlockProc
+// on frames split into source packets (the way the DVReceiver's scatter-list frames
+// are), against a reference that finds the same packs by scanning every DIF block
+// of the frame. With no arguments, the frames are synthetic, in several DV modes,
+// with a running timecode that's checked against what's extracted. Otherwise, the
+// argument is a raw DV file, and up to kBenchMaxFileFrames of its frames are used.
+//
+//	DVFrameMetadataBench [file.dv]
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kBenchSyntheticFrames = 60,
+	kBenchMaxFileFrames = 300,
+	kBenchMinFramesTimed = 20000
+};
+
+// A frame split into source packets, for GetDVFrameMetadataWithDIFBlockProc
+struct BenchScatterFrame
+{
+	UInt8 **ppSourcePackets;
+	UInt32 sourcePacketSize;
+};
+
+//////////////////////////////////////////////////////
+// ScatterFrameDIFBlock
+//////////////////////////////////////////////////////
+static UInt8* ScatterFrameDIFBlock(UInt32 frameOffset, void *pRefCon)
+{
+	BenchScatterFrame *pFrame = (BenchScatterFrame*) pRefCon;
+	
+	return pFrame->ppSourcePackets[frameOffset / pFrame->sourcePacketSize] + (frameOffset % pFrame->sourcePacketSize);
+}
+
+//////////////////////////////////////////////////////
+// ScanFrameForPacks
+//////////////////////////////////////////////////////
+static UInt32 ScanFrameForPacks(UInt8 *pFrameData, UInt32 frameLen)
+{
+	UInt32 offset;
+	UInt32 pack;
+	UInt32 packsFound = 0;
+	UInt8 *pBlock;
+	
+	// Look at the section type of every DIF block, and at every pack of the
+	// subcode, VAUX, and audio blocks, without knowing where they are
+	for (offset=0;offset<frameLen;offset+=kDVDIFBlockSize)
+	{
+		pBlock = &pFrameData[offset];
+		switch (pBlock[0] >> 5)
+		{
+			case 1:
+				for (pack=0;pack<6;pack++)
+				{
+					if (pBlock[6+(pack*8)] != 0xFF)
+						packsFound += 1;
+				}
+				break;
+				
+			case 2:
+				for (pack=0;pack<15;pack++)
+				{
+					if (pBlock[3+(pack*5)] != 0xFF)
+						packsFound += 1;
+				}
+				break;
+				
+			case 3:
+				if (pBlock[3] != 0xFF)
+					packsFound += 1;
+				break;
+				
+			default:
+				break;
+		}
+	}
+	
+	return packsFound;
+}
+
+//////////////////////////////////////////////////////
+// RunBenchmark
+//////////////////////////////////////////////////////
+static void RunBenchmark(const char *pName, UInt8 *pFrames, UInt32 numFrames, UInt32 frameSize, UInt8 dvMode, UInt32 sourcePacketSize)
+{
+	DVFrameMetadata metadata;
+	BenchScatterFrame *pScatterFrames;
+	UInt8 **ppSourcePackets;
+	UInt32 packetsPerFrame = frameSize / sourcePacketSize;
+	UInt32 reps = (kBenchMinFramesTimed + numFrames - 1) / numFrames;
+	UInt32 rep, frame, packet;
+	UInt64 startTime;
+	double directNs, scatterNs, scanNs;
+	UInt32 timeCodes = 0;
+	UInt32 packsFound = 0;
+	
+	// Point the scatter frames at the source packets of the contiguous frames
+	pScatterFrames = new BenchScatterFrame[numFrames];
+	ppSourcePackets = new UInt8*[numFrames*packetsPerFrame];
+	for (frame=0;frame<numFrames;frame++)
+	{
+		pScatterFrames[frame].ppSourcePackets = &ppSourcePackets[frame*packetsPerFrame];
+		pScatterFrames[frame].sourcePacketSize = sourcePacketSize;
+		for (packet=0;packet<packetsPerFrame;packet++)
+			ppSourcePackets[(frame*packetsPerFrame)+packet] = &pFrames[(frame*frameSize)+(packet*sourcePacketSize)];
+	}
+	
+	startTime = AVSTestNanoseconds();
+	for (rep=0;rep<reps;rep++)
+	{
+		for (frame=0;frame<numFrames;frame++)
+		{
+			GetDVFrameMetadata(&pFrames[frame*frameSize], frameSize, dvMode, &metadata);
+			if (metadata.timeCodeValid == true)
+				timeCodes += 1;
+		}
+	}
+	directNs = (AVSTestNanoseconds() - startTime) / (double) (reps*numFrames);
+	
+	startTime = AVSTestNanoseconds();
+	for (rep=0;rep<reps;rep++)
+	{
+		for (frame=0;frame<numFrames;frame++)
+			GetDVFrameMetadataWithDIFBlockProc(ScatterFrameDIFBlock, &pScatterFrames[frame], frameSize, dvMode, &metadata);
+	}
+	scatterNs = (AVSTestNanoseconds() - startTime) / (double) (reps*numFrames);
+	
+	startTime = AVSTestNanoseconds();
+	for (rep=0;rep<reps;rep++)
+	{
+		for (frame=0;frame<numFrames;frame++)
+			packsFound += ScanFrameForPacks(&pFrames[frame*frameSize], frameSize);
+	}
+	scanNs = (AVSTestNanoseconds() - startTime) / (double) (reps*numFrames);
+	
+	printf("  %-18s mode 0x%02X, %6u byte frames: direct %7.1f ns/frame, DIF block proc %7.1f ns/frame, full scan %9.1f ns/frame (%.0fx), %u of %u with timecode\n",
+		   pName,dvMode,(unsigned int) frameSize,
+		   directNs,scatterNs,scanNs,scanNs/directNs,
+		   (unsigned int) (timeCodes/reps),(unsigned int) numFrames);
+	
+	// Keep the scan from being optimized away
+	AVSTestCheck(packsFound != 0);
+	
+	delete [] pScatterFrames;
+	delete [] ppSourcePackets;
+}
+
+//////////////////////////////////////////////////////
+// RunSyntheticBenchmark
+//////////////////////////////////////////////////////
+static void RunSyntheticBenchmark(const char *pName, UInt8 dvMode)
+{
+	DVFrameMetadata metadata;
+	UInt8 *pFrames;
+	UInt8 parsedMode;
+	UInt32 frameSize;
+	UInt32 sourcePacketSize;
+	UInt32 frameRate = (DVstandard(dvMode) == kDVStandardPAL) ? 25 : 30;
+	UInt32 frame;
+	UInt32 timeCodeFrame;
+	
+	pFrames = new UInt8[kBenchSyntheticFrames*576000];
+	frameSize = AVSTestMakeDVFrame(pFrames, dvMode);
+	AVSTestCheck(GetDVModeFromFrameData(pFrames, &parsedMode, &frameSize, &sourcePacketSize) == kIOReturnSuccess);
+	
+	// Start each mode's frames a little before a minute rolls over
+	for (frame=0;frame<kBenchSyntheticFrames;frame++)
+	{
+		timeCodeFrame = (59*frameRate) + frame;
+		AVSTestMakeDVFrame(&pFrames[frame*frameSize], dvMode);
+		AVSTestSetDVFrameTimeCode(&pFrames[frame*frameSize], dvMode, 1, (timeCodeFrame / (60*frameRate)) + 2,
+								  (timeCodeFrame / frameRate) % 60, timeCodeFrame % frameRate, false);
+	}
+	
+	// Make sure we're timing the extraction of the right values
+	frame = kBenchSyntheticFrames-1;
+	timeCodeFrame = (59*frameRate) + frame;
+	AVSTestCheck(GetDVFrameMetadata(&pFrames[frame*frameSize], frameSize, dvMode, &metadata) == kIOReturnSuccess);
+	AVSTestCheck(metadata.timeCodeValid == true);
+	AVSTestCheck(metadata.timeCodeHours == 1);
+	AVSTestCheck(metadata.timeCodeMinutes == ((timeCodeFrame / (60*frameRate)) + 2));
+	AVSTestCheck(metadata.timeCodeSeconds == ((timeCodeFrame / frameRate) % 60));
+	AVSTestCheck(metadata.timeCodeFrames == (timeCodeFrame % frameRate));
+	AVSTestCheck((metadata.recDateValid == true) && (metadata.recYear == 2007) && (metadata.recMonth == 6) && (metadata.recDay == 15));
+	AVSTestCheck((metadata.recTimeValid == true) && (metadata.recHours == 10) && (metadata.recMinutes == 20) && (metadata.recSeconds == 30));
+	AVSTestCheck((metadata.audioValid == true) && (metadata.audioSampleRate == 48000) && (metadata.audioBitsPerSample == 16));
+	AVSTestCheck((metadata.aspectRatioValid == true) && (metadata.aspectRatio == kDVAspectRatio4x3));
+	
+	RunBenchmark(pName, pFrames, kBenchSyntheticFrames, frameSize, dvMode, sourcePacketSize);
+	
+	delete [] pFrames;
+}
+
+//////////////////////////////////////////////////////
+// RunFileBenchmark
+//////////////////////////////////////////////////////
+static bool RunFileBenchmark(const char *pPath)
+{
+	FILE *inFile;
+	UInt8 frameHeader[480];
+	UInt8 *pFrames;
+	UInt8 dvMode;
+	UInt32 frameSize;
+	UInt32 sourcePacketSize;
+	UInt32 numFrames = 0;
+	
+	inFile = fopen(pPath,"rb");
+	if (inFile == nil)
+	{
+		printf("DVFrameMetadataBench: Can't open %s\n",pPath);
+		return false;
+	}
+	
+	if ((fread(frameHeader,1,480,inFile) != 480) ||
+		(GetDVModeFromFrameData(frameHeader, &dvMode, &frameSize, &sourcePacketSize) != kIOReturnSuccess))
+	{
+		printf("DVFrameMetadataBench: %s isn't a raw DV file\n",pPath);
+		fclose(inFile);
+		return false;
+	}
+	
+	rewind(inFile);
+	pFrames = new UInt8[kBenchMaxFileFrames*frameSize];
+	while ((numFrames < kBenchMaxFileFrames) && (fread(&pFrames[numFrames*frameSize],1,frameSize,inFile) == frameSize))
+		numFrames += 1;
+	fclose(inFile);
+	
+	printf("DVFrameMetadataBench: %u frames of %s\n",(unsigned int) numFrames,pPath);
+	RunBenchmark("file", pFrames, numFrames, frameSize, dvMode, sourcePacketSize);
+	
+	delete [] pFrames;
+	return true;
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	if (argc > 1)
+	{
+		if (RunFileBenchmark(argv[1]) == false)
+			return 1;
+	}
+	else
+	{
+		printf("DVFrameMetadataBench: %u synthetic frames per mode\n",(unsigned int) kBenchSyntheticFrames);
+		RunSyntheticBenchmark("DV25 525-60", kDVModeSD_525_60);
+		RunSyntheticBenchmark("DV25 625-50", kDVModeSD_625_50);
+		RunSyntheticBenchmark("DVCPro50 625-50", kDVModeDVCPro50_625_50);
+		RunSyntheticBenchmark("DVCPro100 525-60", kDVModeDVCPro100_60);
+	}
+	
+	return AVSTestFinish("DVFrameMetadataBench");
+}
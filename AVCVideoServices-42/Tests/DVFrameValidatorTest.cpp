@@ -0,0 +1,234 @@
+/*
+	File:		DVFrameValidatorTest.cpp
+ 
+ Synopsis: Tests that DVFrameValidator accepts well-formed DV frames, and flags corrupted DIF block IDs, sequence numbers, and video error status.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Builds a well-formed frame in every DV mode, and checks that the validator's
+// masks accept it, whole and in pieces. Then corrupts one DIF block at a time
+// (section type, block number, sequence number, channel, and video STA), and
+// checks that exactly that error, in exactly that DIF sequence, is reported.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kTestMaxFrameSize = 576000,
+	kTestCorruptSequence = 3
+};
+
+//////////////////////////////////////////////////////
+// DIFBlock
+//////////////////////////////////////////////////////
+static UInt8 *DIFBlock(UInt8 *pFrameData, UInt32 sequence, UInt32 block)
+{
+	return &pFrameData[((sequence*kDVDIFBlocksPerSequence)+block)*kDVDIFBlockSize];
+}
+
+//////////////////////////////////////////////////////
+// CheckCorruptFrame
+//////////////////////////////////////////////////////
+static void CheckCorruptFrame(DVFrameValidator *pValidator, UInt8 *pFrameData, UInt32 frameSize, UInt8 dvMode, UInt32 expectedError)
+{
+	DVFrameValidationInfo info;
+	
+	AVSTestCheck(pValidator->validateFrame(pFrameData, frameSize, dvMode, &info) == kIOReturnSuccess);
+	AVSTestCheck(info.errorFlags == expectedError);
+	AVSTestCheck(info.sequenceErrorMap == (1ULL << kTestCorruptSequence));
+}
+
+//////////////////////////////////////////////////////
+// TestMode
+//////////////////////////////////////////////////////
+static void TestMode(UInt8 dvMode, UInt8 *pFrameData)
+{
+	DVFrameValidator validator;
+	DVFrameValidationInfo info;
+	UInt32 frameSize = AVSTestMakeDVFrame(pFrameData, dvMode);
+	UInt32 numSequences = frameSize / kDVDIFSequenceSize;
+	UInt32 sequencesPerChannel = (DVstandard(dvMode) == kDVStandardPAL) ? 12 : 10;
+	UInt32 offset;
+	UInt32 pieceSize;
+	UInt8 *pBlock;
+	UInt8 savedByte;
+	
+	AVSTestCheck(frameSize != 0);
+	
+	// The VS pack identifies the mode
+	{
+		UInt8 parsedMode;
+		UInt32 parsedFrameSize;
+		UInt32 sourcePacketSize;
+		AVSTestCheck(GetDVModeFromFrameData(pFrameData, &parsedMode, &parsedFrameSize, &sourcePacketSize) == kIOReturnSuccess);
+		AVSTestCheck(parsedMode == dvMode);
+		AVSTestCheck(parsedFrameSize == frameSize);
+	}
+	
+	// A good frame, whole
+	AVSTestCheck(validator.validateFrame(pFrameData, frameSize, dvMode, &info) == kIOReturnSuccess);
+	AVSTestCheck(info.validated == true);
+	AVSTestCheck(info.errorFlags == kDVFrameErrorNone);
+	AVSTestCheck(info.sequenceErrorMap == 0);
+	AVSTestCheck(info.badBlockCount == 0);
+	AVSTestCheck(info.videoErrorBlockCount == 0);
+	
+	// The same frame in pieces, the way scatter-list frames are received (one
+	// source packet of six DIF blocks at a time, and a whole sequence at a time)
+	for (pieceSize=(6*kDVDIFBlockSize);pieceSize<=kDVDIFSequenceSize;pieceSize+=(kDVDIFSequenceSize-(6*kDVDIFBlockSize)))
+	{
+		validator.beginFrame(&info);
+		for (offset=0;offset<frameSize;offset+=pieceSize)
+			validator.validateFrameData(&pFrameData[offset], pieceSize, &info);
+		validator.endFrame(&info);
+		AVSTestCheck(info.errorFlags == kDVFrameErrorNone);
+	}
+	
+	// A short frame
+	AVSTestCheck(validator.validateFrame(pFrameData, frameSize-kDVDIFSequenceSize, dvMode, &info) == kIOReturnSuccess);
+	AVSTestCheck(info.errorFlags == kDVFrameErrorBadFrameSize);
+	
+	// A video block with the wrong block number
+	pBlock = DIFBlock(pFrameData, kTestCorruptSequence, 100);
+	savedByte = pBlock[2];
+	pBlock[2] ^= 0x01;
+	CheckCorruptFrame(&validator, pFrameData, frameSize, dvMode, kDVFrameErrorBadBlockID);
+	AVSTestCheck(info.badBlockCount == 0);
+	AVSTestCheck(validator.validateFrame(pFrameData, frameSize, dvMode, &info) == kIOReturnSuccess);
+	AVSTestCheck(info.badBlockCount == 1);
+	pBlock[2] = savedByte;
+	
+	// An audio block where a video block should be
+	pBlock = DIFBlock(pFrameData, kTestCorruptSequence, 22);
+	savedByte = pBlock[0];
+	pBlock[0] = (pBlock[0] & 0x1F) | (4 << 5);
+	CheckCorruptFrame(&validator, pFrameData, frameSize, dvMode, kDVFrameErrorBadBlockID);
+	pBlock[0] = savedByte;
+	
+	// A subcode block from the wrong channel
+	pBlock = DIFBlock(pFrameData, kTestCorruptSequence, 1);
+	savedByte = pBlock[1];
+	pBlock[1] ^= 0x08;
+	CheckCorruptFrame(&validator, pFrameData, frameSize, dvMode, kDVFrameErrorBadSequence);
+	pBlock[1] = savedByte;
+	
+	// A header block from the wrong DIF sequence. SDL frames don't number their sequences.
+	pBlock = DIFBlock(pFrameData, kTestCorruptSequence, 0);
+	savedByte = pBlock[1];
+	pBlock[1] ^= 0x10;
+	if (DVstype(dvMode) == 0x01)
+	{
+		AVSTestCheck(validator.validateFrame(pFrameData, frameSize, dvMode, &info) == kIOReturnSuccess);
+		AVSTestCheck(info.errorFlags == kDVFrameErrorNone);
+	}
+	else
+		CheckCorruptFrame(&validator, pFrameData, frameSize, dvMode, kDVFrameErrorBadSequence);
+	pBlock[1] = savedByte;
+	
+	// FSP only identifies the channel of a four channel frame
+	pBlock = DIFBlock(pFrameData, kTestCorruptSequence, 50);
+	savedByte = pBlock[1];
+	pBlock[1] ^= 0x04;
+	if (numSequences == (4*sequencesPerChannel))
+		CheckCorruptFrame(&validator, pFrameData, frameSize, dvMode, kDVFrameErrorBadSequence);
+	else
+	{
+		AVSTestCheck(validator.validateFrame(pFrameData, frameSize, dvMode, &info) == kIOReturnSuccess);
+		AVSTestCheck(info.errorFlags == kDVFrameErrorNone);
+	}
+	pBlock[1] = savedByte;
+	
+	// A video block with an uncorrected error, then one with a concealed error
+	pBlock = DIFBlock(pFrameData, kTestCorruptSequence, 7);
+	pBlock[3] = 0xF0;
+	CheckCorruptFrame(&validator, pFrameData, frameSize, dvMode, kDVFrameErrorVideoError);
+	AVSTestCheck(validator.validateFrame(pFrameData, frameSize, dvMode, &info) == kIOReturnSuccess);
+	AVSTestCheck(info.videoErrorBlockCount == 1);
+	pBlock[3] = 0x70;
+	AVSTestCheck(validator.validateFrame(pFrameData, frameSize, dvMode, &info) == kIOReturnSuccess);
+	AVSTestCheck(info.errorFlags == kDVFrameErrorVideoConcealed);
+	AVSTestCheck(info.sequenceErrorMap == 0);
+	AVSTestCheck(info.videoConcealedBlockCount == 1);
+	pBlock[3] = 0x00;
+	
+	// The STA of a non-video block isn't checked
+	pBlock = DIFBlock(pFrameData, kTestCorruptSequence, 6);
+	pBlock[3] = 0xF0;
+	AVSTestCheck(validator.validateFrame(pFrameData, frameSize, dvMode, &info) == kIOReturnSuccess);
+	AVSTestCheck(info.errorFlags == kDVFrameErrorNone);
+	pBlock[3] = 0x00;
+	
+	// Errors in the first and last DIF sequences are mapped to the right bits
+	DIFBlock(pFrameData, 0, 149)[2] ^= 0x01;
+	DIFBlock(pFrameData, numSequences-1, 0)[0] ^= 0x20;
+	AVSTestCheck(validator.validateFrame(pFrameData, frameSize, dvMode, &info) == kIOReturnSuccess);
+	AVSTestCheck(info.errorFlags == kDVFrameErrorBadBlockID);
+	AVSTestCheck(info.sequenceErrorMap == ((1ULL << (numSequences-1)) | 1ULL));
+	AVSTestCheck(info.badBlockCount == 2);
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	UInt8 *pFrameData = new UInt8[kTestMaxFrameSize];
+	DVFrameValidator validator;
+	DVFrameValidationInfo info;
+	UInt32 i;
+	
+	for (i=0;dvFormats[i].frameSize != 0;i++)
+		TestMode(dvFormats[i].mode, pFrameData);
+	
+	// An unknown mode can't be validated
+	AVSTestCheck(validator.setDVMode(0x7C) == kIOReturnBadArgument);
+	AVSTestCheck(validator.validateFrame(pFrameData, 120000, 0x7C, &info) == kIOReturnBadArgument);
+	AVSTestCheck(info.errorFlags == kDVFrameErrorBadFrameSize);
+	
+	delete [] pFrameData;
+	
+	return AVSTestFinish("DVFrameValidatorTest");
+}
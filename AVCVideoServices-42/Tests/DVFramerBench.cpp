@@ -0,0 +1,233 @@
+/*
+	File:		DVFramerBench.cpp
+ 
+ Synopsis: Benchmark of DVFramer source packet input, one packet per call against batches of packets.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Feeds the same synthetic DV frames to a DVFramer four ways: one source packet per
+// nextDVSourcePacket call, one CIP packet per nextCIPPacket call (one source packet
+// per CIP at 1x, four at 4x), and a whole frame per nextDVSourcePackets call, the
+// way a DV file reader would. First, each way is checked to deliver every frame,
+// intact. Then each is timed.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kBenchFrames = 30,
+	kBenchReps = 20
+};
+
+enum
+{
+	kBenchPerPacket,
+	kBenchPerCIP1x,
+	kBenchPerCIP4x,
+	kBenchPerFrame,
+	kBenchNumWays
+};
+
+static const char *benchWayNames[kBenchNumWays] =
+{
+	"nextDVSourcePacket",
+	"nextCIPPacket, 1x",
+	"nextCIPPacket, 4x",
+	"nextDVSourcePackets, frame"
+};
+
+// What the framer callback checks the frames against
+struct BenchFramerState
+{
+	UInt8 *pFrames;
+	UInt32 frameSize;
+	UInt32 framesDelivered;
+	UInt32 framesBad;
+	bool checkFrames;
+};
+
+//////////////////////////////////////////////////////
+// FramerCallback
+//////////////////////////////////////////////////////
+static IOReturn FramerCallback(DVFramerCallbackMessage msg, DVFrame* pDVFrame, void *pRefCon, DVFramer *pDVFramer)
+{
+	BenchFramerState *pState = (BenchFramerState*) pRefCon;
+	
+	if (msg != kDVFramerFrameReceivedSuccessfully)
+	{
+		pState->framesBad += 1;
+		return kIOReturnSuccess;
+	}
+	
+	if ((pState->checkFrames == true) &&
+		((pDVFrame->frameLen != pState->frameSize) ||
+		 (memcmp(pDVFrame->pFrameData, &pState->pFrames[(pState->framesDelivered % kBenchFrames)*pState->frameSize], pState->frameSize) != 0)))
+		pState->framesBad += 1;
+	
+	pState->framesDelivered += 1;
+	pDVFramer->ReleaseDVFrame(pDVFrame);
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// FeedFrames
+//////////////////////////////////////////////////////
+static void FeedFrames(DVFramer *pFramer, UInt32 way, UInt8 *pFrames, UInt32 frameSize, UInt32 packetLen, UInt8 dvMode)
+{
+	FWAVCCIPPacketParserInfo parsedPacket;
+	UInt32 totalPackets = (kBenchFrames*frameSize) / packetLen;
+	UInt32 packetsPerCIP = (way == kBenchPerCIP4x) ? 4 : 1;
+	UInt32 packet;
+	UInt32 frame;
+	UInt32 i;
+	
+	switch (way)
+	{
+		case kBenchPerPacket:
+			for (packet=0;packet<totalPackets;packet++)
+				pFramer->nextDVSourcePacket(&pFrames[packet*packetLen], packetLen, dvMode);
+			break;
+			
+		case kBenchPerCIP1x:
+		case kBenchPerCIP4x:
+			parsedPacket.fmt = 0;
+			parsedPacket.sourcePacketSize = packetLen;
+			parsedPacket.numSourcePackets = packetsPerCIP;
+			parsedPacket.dvMode = dvMode | ((way == kBenchPerCIP4x) ? kDVTransferSpeed_4x : kDVTransferSpeed_1x);
+			parsedPacket.syt = 0xFFFF;
+			for (packet=0;packet<totalPackets;packet+=packetsPerCIP)
+			{
+				for (i=0;i<packetsPerCIP;i++)
+					parsedPacket.pSourcePacket[i] = &pFrames[(packet+i)*packetLen];
+				pFramer->nextCIPPacket(&parsedPacket);
+			}
+			break;
+			
+		case kBenchPerFrame:
+		default:
+			for (frame=0;frame<kBenchFrames;frame++)
+				pFramer->nextDVSourcePackets(&pFrames[frame*frameSize], frameSize/packetLen, packetLen, dvMode);
+			break;
+	}
+}
+
+//////////////////////////////////////////////////////
+// RunBenchmark
+//////////////////////////////////////////////////////
+static void RunBenchmark(const char *pName, UInt8 dvMode)
+{
+	BenchFramerState state;
+	DVFramer *pFramer;
+	UInt8 *pFrames;
+	UInt8 parsedMode;
+	UInt32 frameSize;
+	UInt32 packetLen;
+	UInt32 way;
+	UInt32 rep;
+	UInt32 frame;
+	UInt64 startTime;
+	double ns;
+	double perPacketNs = 0.0;
+	
+	pFrames = new UInt8[kBenchFrames*576000];
+	frameSize = AVSTestMakeDVFrame(pFrames, dvMode);
+	AVSTestCheck(GetDVModeFromFrameData(pFrames, &parsedMode, &frameSize, &packetLen) == kIOReturnSuccess);
+	
+	// Give each frame different contents, so the check catches misplaced packets
+	for (frame=0;frame<kBenchFrames;frame++)
+	{
+		AVSTestMakeDVFrame(&pFrames[frame*frameSize], dvMode);
+		AVSTestSetDVFrameTimeCode(&pFrames[frame*frameSize], dvMode, 0, 0, 0, frame, false);
+		memset(&pFrames[(frame*frameSize)+(7*kDVDIFBlockSize)+4], frame+1, kDVDIFBlockSize-4);
+	}
+	
+	printf("  %s (mode 0x%02X, %u byte source packets, %u packets per frame)\n",
+		   pName,dvMode,(unsigned int) packetLen,(unsigned int) (frameSize/packetLen));
+	
+	state.pFrames = pFrames;
+	state.frameSize = frameSize;
+	for (way=0;way<kBenchNumWays;way++)
+	{
+		pFramer = new DVFramer(FramerCallback, &state, dvMode, 4);
+		AVSTestCheck(pFramer->setupDVFramer() == kIOReturnSuccess);
+		
+		// Every frame delivered, intact
+		state.framesDelivered = 0;
+		state.framesBad = 0;
+		state.checkFrames = true;
+		FeedFrames(pFramer, way, pFrames, frameSize, packetLen, dvMode);
+		AVSTestCheck(state.framesDelivered == kBenchFrames);
+		AVSTestCheck(state.framesBad == 0);
+		
+		state.checkFrames = false;
+		startTime = AVSTestNanoseconds();
+		for (rep=0;rep<kBenchReps;rep++)
+			FeedFrames(pFramer, way, pFrames, frameSize, packetLen, dvMode);
+		ns = (AVSTestNanoseconds() - startTime) / (double) (kBenchReps*kBenchFrames);
+		if (way == kBenchPerPacket)
+			perPacketNs = ns;
+		
+		printf("    %-28s %9.1f us/frame  %6.1f ns/packet  %.2fx\n",
+			   benchWayNames[way],ns/1000.0,ns/(frameSize/packetLen),perPacketNs/ns);
+		
+		delete pFramer;
+	}
+	
+	delete [] pFrames;
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	printf("DVFramerBench: %u synthetic frames, fed %u times\n",(unsigned int) kBenchFrames,(unsigned int) kBenchReps);
+	RunBenchmark("DV25 525-60", kDVModeSD_525_60);
+	RunBenchmark("DVCPro50 625-50", kDVModeDVCPro50_625_50);
+	RunBenchmark("DVCPro100 525-60", kDVModeDVCPro100_60);
+	
+	return AVSTestFinish("DVFramerBench");
+}
@@ -0,0 +1,393 @@
+/*
+	File:		DVRecorderTest.cpp
+ 
+ Synopsis: Tests for DVRecorder and DVNaviFileReader: the navi index round trip, and drop-frame time-code seeking.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Records a mix of frames with DVRecorder: NTSC drop-frame time-code across a
+// dropped minute boundary, a time-code break to just before a tenth minute (which
+// drops nothing), frames without time-code, and PAL frames. Some are pushed whole,
+// and some as scatter lists, the way the receiver hands them over. Then reads the
+// file back through DVNaviFileReader, and checks that every frame and its index
+// entry survived the round trip, that every time-code seeks to its own frame, that
+// the time-codes drop-frame counting skips are never found, and that index entries
+// past the end of a truncated file are ignored.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kTestBufferSize = 1000000,
+	kTestNumBuffers = 3,
+	kTestMaxFrameSize = 144000,
+	kTestNumFrames = 600,
+	
+	// The frames of the recording
+	kTestFirstRunFrames = 300,		// NTSC drop-frame, starting at kTestFirstRunStart
+	kTestFirstRunStart = 1798,		// Frame count of 00:00:59;28
+	kTestSecondRunFrames = 100,		// NTSC drop-frame, starting at kTestSecondRunStart
+	kTestSecondRunStart = 17950,	// Frame count of 00:09:58;28
+	kTestNoTimeCodeFrames = 50,		// NTSC, without time-code
+	kTestPALStart = 90000			// The rest are PAL, starting at 01:00:00:00
+};
+
+struct TestFrame
+{
+	UInt8 dvMode;
+	UInt32 frameLen;
+	bool timeCodeValid;
+	bool dropFrame;
+	UInt8 hours;
+	UInt8 minutes;
+	UInt8 seconds;
+	UInt8 frames;
+};
+
+static TestFrame testFrames[kTestNumFrames];
+
+//////////////////////////////////////////////////////
+// FrameCountToTimeCode
+//////////////////////////////////////////////////////
+static void FrameCountToTimeCode(UInt32 frameCount, bool pal, bool dropFrame, TestFrame *pFrame)
+{
+	UInt32 framesPerSecond = (pal == true) ? 25 : 30;
+	UInt32 tenMinutes;
+	UInt32 remainder;
+	
+	// NTSC drop-frame time-code skips frames 0 and 1 at the start of every minute, except every tenth minute
+	if ((dropFrame == true) && (pal == false))
+	{
+		tenMinutes = frameCount / 17982;
+		remainder = frameCount % 17982;
+		frameCount += 18*tenMinutes;
+		if (remainder > 2)
+			frameCount += 2*((remainder - 2) / 1798);
+	}
+	
+	pFrame->frames = frameCount % framesPerSecond;
+	pFrame->seconds = (frameCount / framesPerSecond) % 60;
+	pFrame->minutes = (frameCount / (framesPerSecond*60)) % 60;
+	pFrame->hours = frameCount / (framesPerSecond*3600);
+}
+
+//////////////////////////////////////////////////////
+// SetUpTestFrames
+//////////////////////////////////////////////////////
+static void SetUpTestFrames(void)
+{
+	TestFrame *pFrame;
+	UInt32 i;
+	
+	for (i=0;i<kTestNumFrames;i++)
+	{
+		pFrame = &testFrames[i];
+		bzero(pFrame, sizeof(TestFrame));
+		if (i < kTestFirstRunFrames)
+		{
+			pFrame->dvMode = 0x00;
+			pFrame->timeCodeValid = true;
+			pFrame->dropFrame = true;
+			FrameCountToTimeCode(kTestFirstRunStart + i, false, true, pFrame);
+		}
+		else if (i < (kTestFirstRunFrames + kTestSecondRunFrames))
+		{
+			pFrame->dvMode = 0x00;
+			pFrame->timeCodeValid = true;
+			pFrame->dropFrame = true;
+			FrameCountToTimeCode(kTestSecondRunStart + (i - kTestFirstRunFrames), false, true, pFrame);
+		}
+		else if (i < (kTestFirstRunFrames + kTestSecondRunFrames + kTestNoTimeCodeFrames))
+			pFrame->dvMode = 0x00;
+		else
+		{
+			pFrame->dvMode = 0x80;
+			pFrame->timeCodeValid = true;
+			FrameCountToTimeCode(kTestPALStart + i, true, false, pFrame);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////
+// MakeTestFrame - Make frame i, with the frame number in its last four bytes
+//////////////////////////////////////////////////////
+static UInt32 MakeTestFrame(UInt8 *pFrameData, UInt32 i)
+{
+	TestFrame *pFrame = &testFrames[i];
+	UInt32 frameLen;
+	
+	frameLen = AVSTestMakeDVFrame(pFrameData, pFrame->dvMode);
+	if (pFrame->timeCodeValid == true)
+		AVSTestSetDVFrameTimeCode(pFrameData, pFrame->dvMode, pFrame->hours, pFrame->minutes, pFrame->seconds, pFrame->frames, pFrame->dropFrame);
+	memcpy(&pFrameData[frameLen-sizeof(UInt32)], &i, sizeof(UInt32));
+	pFrame->frameLen = frameLen;
+	
+	return frameLen;
+}
+
+//////////////////////////////////////////////////////
+// Record - Record the test frames, waiting for the writer thread when the buffers are full
+//////////////////////////////////////////////////////
+static void Record(const char *pPath)
+{
+	DVRecorder recorder(nil, kTestBufferSize, kTestNumBuffers);
+	DVRecorderStats stats;
+	DVFrameMetadata metadata;
+	DVReceiveFrame receiveFrame;
+	DVReceiveFrameRange ranges[3];
+	UInt8 *pFrameData = new UInt8[kTestMaxFrameSize];
+	UInt32 frameLen;
+	UInt32 numDropped = 0;
+	UInt32 i;
+	IOReturn result;
+	
+	AVSTestCheck(recorder.openFile(pPath) == kIOReturnSuccess);
+	
+	for (i=0;i<kTestNumFrames;i++)
+	{
+		frameLen = MakeTestFrame(pFrameData, i);
+		
+		for (;;)
+		{
+			if (testFrames[i].timeCodeValid == false)
+			{
+				// The metadata the receiver extracted, without time-code
+				GetDVFrameMetadata(pFrameData, frameLen, testFrames[i].dvMode, &metadata);
+				metadata.timeCodeValid = false;
+				result = recorder.pushFrame(pFrameData, frameLen, testFrames[i].dvMode, &metadata);
+			}
+			else if ((i % 7) == 3)
+			{
+				// A scatter list, split mid DIF sequence, with the metadata left for the recorder to extract
+				ranges[0].pData = pFrameData;
+				ranges[0].length = 480*50;
+				ranges[1].pData = &pFrameData[480*50];
+				ranges[1].length = 480*100 + 13;
+				ranges[2].pData = &pFrameData[480*150 + 13];
+				ranges[2].length = frameLen - (480*150 + 13);
+				bzero(&receiveFrame, sizeof(DVReceiveFrame));
+				receiveFrame.frameLen = frameLen;
+				receiveFrame.frameMode = testFrames[i].dvMode;
+				receiveFrame.pFrameRanges = ranges;
+				receiveFrame.frameRangeCount = 3;
+				result = recorder.pushReceiveFrame(&receiveFrame);
+			}
+			else
+				result = recorder.pushFrame(pFrameData, frameLen, testFrames[i].dvMode);
+			
+			if (result != kIOReturnNoSpace)
+				break;
+			numDropped += 1;
+			usleep(1000);
+		}
+		AVSTestCheck(result == kIOReturnSuccess);
+	}
+	
+	AVSTestCheck(recorder.closeFile() == kIOReturnSuccess);
+	recorder.getStats(&stats);
+	AVSTestCheck(stats.framesReceived == (kTestNumFrames + numDropped));
+	AVSTestCheck(stats.framesDropped == numDropped);
+	AVSTestCheck(stats.framesWritten == kTestNumFrames);
+	AVSTestCheck(stats.writeErrors == 0);
+	
+	delete [] pFrameData;
+}
+
+//////////////////////////////////////////////////////
+// TestNaviRoundTrip
+//////////////////////////////////////////////////////
+static void TestNaviRoundTrip(const char *pPath)
+{
+	DVNaviFileReader reader;
+	DVNaviFileFrameInfo frameInfo;
+	TestFrame *pFrame;
+	UInt8 *pFrameData = new UInt8[kTestMaxFrameSize];
+	UInt32 frameLen;
+	UInt32 frameNumber;
+	UInt8 dvMode;
+	UInt32 badFrames = 0;
+	UInt32 badEntries = 0;
+	UInt32 badTimeCodes = 0;
+	UInt32 i;
+	
+	AVSTestCheck(reader.InitWithDVFile(pPath) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetNumFrames() == kTestNumFrames);
+	
+	for (i=0;i<kTestNumFrames;i++)
+	{
+		pFrame = &testFrames[i];
+		
+		// The frame itself
+		if ((reader.ReadNextFrame(pFrameData, kTestMaxFrameSize, &frameLen, &dvMode) != kIOReturnSuccess) ||
+			(frameLen != pFrame->frameLen) || (dvMode != pFrame->dvMode) ||
+			(memcmp(&pFrameData[frameLen-sizeof(UInt32)], &i, sizeof(UInt32)) != 0))
+			badFrames += 1;
+		
+		// Its index entry
+		if ((reader.GetFrameInfo(i, &frameInfo) != kIOReturnSuccess) ||
+			(frameInfo.dvMode != pFrame->dvMode) ||
+			(((frameInfo.flags & kDVNaviFrameTimeCodeValid) != 0) != pFrame->timeCodeValid) ||
+			(((frameInfo.flags & kDVNaviFrameTimeCodeDropFrame) != 0) != pFrame->dropFrame) ||
+			((frameInfo.flags & kDVNaviFrameRecDateValid) == 0) ||
+			(frameInfo.recYear != 2007) || (frameInfo.recMonth != 6) || (frameInfo.recDay != 15))
+			badEntries += 1;
+		if ((pFrame->timeCodeValid == true) &&
+			((frameInfo.timeCodeHours != pFrame->hours) || (frameInfo.timeCodeMinutes != pFrame->minutes) ||
+			 (frameInfo.timeCodeSeconds != pFrame->seconds) || (frameInfo.timeCodeFrames != pFrame->frames)))
+			badEntries += 1;
+		
+		// Every time-code finds its own frame
+		if ((pFrame->timeCodeValid == true) &&
+			((reader.FindTimeCode(pFrame->hours, pFrame->minutes, pFrame->seconds, pFrame->frames, &frameNumber) != kIOReturnSuccess) ||
+			 (frameNumber != i)))
+			badTimeCodes += 1;
+	}
+	AVSTestCheck(badFrames == 0);
+	AVSTestCheck(badEntries == 0);
+	AVSTestCheck(badTimeCodes == 0);
+	AVSTestCheck(reader.ReadNextFrame(pFrameData, kTestMaxFrameSize) != kIOReturnSuccess);
+	
+	// Random access
+	AVSTestCheck(reader.ReadFrame(kTestNumFrames-1, pFrameData, kTestMaxFrameSize, &frameLen, &dvMode) == kIOReturnSuccess);
+	i = kTestNumFrames-1;
+	AVSTestCheck((frameLen == 144000) && (dvMode == 0x80) && (memcmp(&pFrameData[frameLen-sizeof(UInt32)], &i, sizeof(UInt32)) == 0));
+	AVSTestCheck(reader.ReadFrame(kTestNumFrames, pFrameData, kTestMaxFrameSize) != kIOReturnSuccess);
+	AVSTestCheck(reader.ReadFrame(0, pFrameData, 1000) != kIOReturnSuccess);
+	
+	delete [] pFrameData;
+}
+
+//////////////////////////////////////////////////////
+// TestDropFrameSeek
+//////////////////////////////////////////////////////
+static void TestDropFrameSeek(const char *pPath)
+{
+	DVNaviFileReader reader;
+	UInt32 frameNumber;
+	
+	AVSTestCheck(reader.InitWithDVFile(pPath) == kIOReturnSuccess);
+	
+	// 00:00:59;29 is followed by 00:01:00;02. The two between don't exist.
+	AVSTestCheck(reader.SeekToTimeCode(0, 0, 59, 29) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == 1);
+	AVSTestCheck(reader.FindTimeCode(0, 1, 0, 0, &frameNumber) == kIOReturnNotFound);
+	AVSTestCheck(reader.FindTimeCode(0, 1, 0, 1, &frameNumber) == kIOReturnNotFound);
+	AVSTestCheck(reader.SeekToTimeCode(0, 1, 0, 2) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == 2);
+	AVSTestCheck(reader.SeekToTimeCode(0, 1, 0, 0) == kIOReturnNotFound);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == 2);
+	
+	// Ten seconds in, 300 frames of drop-frame time-code are ten seconds, less the two dropped
+	AVSTestCheck(reader.SeekToTimeCode(0, 1, 9, 2) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == (2 + 270));
+	
+	// The tenth minute keeps its first two frames. The second run starts at 00:09:58;28.
+	AVSTestCheck(reader.SeekToTimeCode(0, 9, 59, 29) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == (kTestFirstRunFrames + 31));
+	AVSTestCheck(reader.SeekToTimeCode(0, 10, 0, 0) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == (kTestFirstRunFrames + 32));
+	AVSTestCheck(reader.SeekToTimeCode(0, 10, 0, 1) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == (kTestFirstRunFrames + 33));
+	
+	// A time-code between the runs, and a PAL one
+	AVSTestCheck(reader.FindTimeCode(0, 5, 0, 2, &frameNumber) == kIOReturnNotFound);
+	AVSTestCheck(reader.SeekToTimeCode(1, 0, 18, 0) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == 450);
+	
+	// Seeking by seconds counts frames at the frame rate of the current frame
+	AVSTestCheck(reader.SeekToSpecificFrame(10) == kIOReturnSuccess);
+	AVSTestCheck(reader.SeekForwards(2) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == 70);
+	AVSTestCheck(reader.SeekBackwards(10) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == 0);
+	AVSTestCheck(reader.SeekToSpecificFrame(500) == kIOReturnSuccess);
+	AVSTestCheck(reader.SeekForwards(2) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetCurrentPositionInFrames() == 550);
+	AVSTestCheck(reader.SeekForwards(2) == kIOReturnError);
+	AVSTestCheck(reader.SeekToSpecificFrame(kTestNumFrames) == kIOReturnError);
+}
+
+//////////////////////////////////////////////////////
+// TestTruncatedFile
+//////////////////////////////////////////////////////
+static void TestTruncatedFile(const char *pPath)
+{
+	DVNaviFileReader reader;
+	char naviPath[300];
+	
+	// The entries for frames that didn't make it into the DV file are ignored
+	AVSTestCheck(truncate(pPath, (100*120000) + 1000) == 0);
+	AVSTestCheck(reader.InitWithDVFile(pPath) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetNumFrames() == 100);
+	
+	// Without the navi file, the reader can only assume every frame is like the first
+	snprintf(naviPath, sizeof(naviPath), "%s.dvnavi", pPath);
+	AVSTestRemoveScratchFile(naviPath);
+	AVSTestCheck(reader.InitWithDVFile(pPath) == kIOReturnNotFound);
+	AVSTestCheck(reader.InitWithDVFile(pPath, false) == kIOReturnSuccess);
+	AVSTestCheck(reader.GetNumFrames() == 100);
+	AVSTestCheck(reader.hasNaviFile == false);
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	char path[256];
+	
+	AVSTestMakeScratchFilePath(path, sizeof(path), "DVRecorderTest.dv");
+	
+	SetUpTestFrames();
+	Record(path);
+	TestNaviRoundTrip(path);
+	TestDropFrameSeek(path);
+	TestTruncatedFile(path);
+	
+	AVSTestRemoveScratchFile(path);
+	
+	return AVSTestFinish("DVRecorderTest");
+}
@@ -0,0 +1,322 @@
+/*
+	File:		DVThumbnailerTest.cpp
+ 
+ Synopsis: Tests for where DVThumbnailer places each macroblock of a frame.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Makes a frame whose video DIF blocks each carry their own DIF sequence and video
+// block number in their DC coefficients (the sequence in Cr, the block in Cb, and
+// the DCT block number in each luma block), so every thumbnail pixel says which
+// DCT block it came from. The pixels are checked against a few positions worked
+// out by hand from the SMPTE 314M superblock figures (including the 4:1:1 right
+// edge macroblocks, and the 4:2:0 superblock columns), and then, for every video
+// block of the frame, against the macroblock position computed in picture space
+// the way libdv's place.c does it, which doesn't share the thumbnailer's tables.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kTestMaxFrameSize = 144000,
+	kTestVideoBlocksPerSequence = 135,
+	kTestLumaOffset = 4,		// The DC bytes of the four luma, the Cr, and the Cb DCT blocks
+	kTestLumaInterval = 14,
+	kTestCrOffset = 60,
+	kTestCbOffset = 70
+};
+
+static UInt8 frameData[kTestMaxFrameSize];
+static DVThumbnail thumbnail;
+
+//////////////////////////////////////////////////////
+// VideoBlockData - Where a video block is in the frame
+//////////////////////////////////////////////////////
+static UInt8* VideoBlockData(UInt32 sequence, UInt32 videoBlock)
+{
+	UInt32 block = 7 + videoBlock + (videoBlock/15);
+	
+	return &frameData[((sequence*kDVDIFBlocksPerSequence) + block) * kDVDIFBlockSize];
+}
+
+//////////////////////////////////////////////////////
+// MakeTaggedFrame - Make a frame with each video block's DC coefficients telling where it came from
+//////////////////////////////////////////////////////
+static UInt32 MakeTaggedFrame(UInt8 dvMode)
+{
+	UInt32 frameLen = AVSTestMakeDVFrame(frameData, dvMode);
+	UInt32 sequence;
+	UInt32 videoBlock;
+	UInt32 luma;
+	UInt8 *pBlock;
+	
+	for (sequence=0;sequence<(frameLen/kDVDIFSequenceSize);sequence++)
+	{
+		for (videoBlock=0;videoBlock<kTestVideoBlocksPerSequence;videoBlock++)
+		{
+			// The thumbnailer flips the sign bit of each 9-bit DC coefficient
+			pBlock = VideoBlockData(sequence, videoBlock);
+			for (luma=0;luma<4;luma++)
+				pBlock[kTestLumaOffset + (luma*kTestLumaInterval)] = luma ^ 0x80;
+			pBlock[kTestCrOffset] = sequence ^ 0x80;
+			pBlock[kTestCbOffset] = videoBlock ^ 0x80;
+		}
+	}
+	
+	return frameLen;
+}
+
+//////////////////////////////////////////////////////
+// PixelIs - Whether a thumbnail pixel came from a DCT block
+//////////////////////////////////////////////////////
+static bool PixelIs(UInt32 x, UInt32 y, UInt32 sequence, UInt32 videoBlock, UInt32 luma)
+{
+	UInt32 offset = (y*kDVThumbnailMaxWidth) + x;
+	
+	return ((thumbnail.crPlane[offset] == sequence) &&
+			(thumbnail.cbPlane[offset] == videoBlock) &&
+			(thumbnail.lumaPlane[offset] == luma));
+}
+
+//////////////////////////////////////////////////////
+// MacroblockIs - Whether a macroblock (in thumbnail pixels) came from a video block
+//////////////////////////////////////////////////////
+static bool MacroblockIs(UInt32 x, UInt32 y, bool square, UInt32 sequence, UInt32 videoBlock)
+{
+	if (square == true)
+		return (PixelIs(x, y, sequence, videoBlock, 0) && PixelIs(x+1, y, sequence, videoBlock, 1) &&
+				PixelIs(x, y+1, sequence, videoBlock, 2) && PixelIs(x+1, y+1, sequence, videoBlock, 3));
+	else
+		return (PixelIs(x, y, sequence, videoBlock, 0) && PixelIs(x+1, y, sequence, videoBlock, 1) &&
+				PixelIs(x+2, y, sequence, videoBlock, 2) && PixelIs(x+3, y, sequence, videoBlock, 3));
+}
+
+//////////////////////////////////////////////////////
+// ReferenceMacroblockPosition - A macroblock's top-left pixel in the picture, after libdv's place.c
+//////////////////////////////////////////////////////
+static void ReferenceMacroblockPosition(bool is420, UInt32 numSequences, UInt32 sequence, UInt32 videoBlock,
+										UInt32 *pX, UInt32 *pY, bool *pSquare)
+{
+	// The superblock row and column of each of a video segment's five macroblocks
+	static const UInt32 superMapVertical[5] = {2, 6, 8, 0, 4};
+	static const UInt32 superMapHorizontal[5] = {2, 1, 3, 0, 4};
+	static const UInt32 columnOffset411[5] = {0, 4, 9, 13, 18};
+	static const UInt32 columnOffset420[5] = {0, 9, 18, 27, 36};
+	UInt32 i = (sequence + superMapVertical[videoBlock % 5]) % numSequences;
+	UInt32 j = superMapHorizontal[videoBlock % 5];
+	UInt32 k = videoBlock / 5;
+	UInt32 mbNum;
+	UInt32 mbRow;
+	UInt32 mbCol;
+	
+	if (is420 == true)
+	{
+		// Superblocks of 9 columns of 3 macroblocks of 16x16, zig-zagging down the columns
+		mbRow = (((k/3) % 2) == 0) ? (k % 3) : (2 - (k % 3));
+		mbCol = (k/3) + columnOffset420[j];
+		*pX = mbCol * 16;
+		*pY = ((i*3) + mbRow) * 16;
+		*pSquare = true;
+		return;
+	}
+	
+	// Superblocks of columns of 6 macroblocks of 32x8, the odd superblock
+	// columns starting half a column down
+	mbNum = ((j % 2) == 1) ? (k + 3) : k;
+	mbRow = (((mbNum/6) % 2) == 0) ? (mbNum % 6) : (5 - (mbNum % 6));
+	mbCol = ((mbNum/6) + columnOffset411[j]) * 4;
+	if (mbCol < (22*4))
+	{
+		*pX = mbCol * 8;
+		*pY = ((i*6) + mbRow) * 8;
+		*pSquare = false;
+	}
+	else
+	{
+		// The right edge has 16x16 macroblocks, three down each superblock
+		*pX = mbCol * 8;
+		*pY = ((i*3) + (mbNum % 6)) * 16;
+		*pSquare = true;
+	}
+}
+
+//////////////////////////////////////////////////////
+// TestReferencePlacement - Every video block, against the reference placement
+//////////////////////////////////////////////////////
+static void TestReferencePlacement(bool is420, UInt32 numSequences)
+{
+	UInt32 sequence;
+	UInt32 videoBlock;
+	UInt32 x;
+	UInt32 y;
+	bool square;
+	UInt32 misplaced = 0;
+	UInt32 squares = 0;
+	UInt32 grayPixels = 0;
+	
+	for (sequence=0;sequence<numSequences;sequence++)
+	{
+		for (videoBlock=0;videoBlock<kTestVideoBlocksPerSequence;videoBlock++)
+		{
+			ReferenceMacroblockPosition(is420, numSequences, sequence, videoBlock, &x, &y, &square);
+			if (MacroblockIs(x/8, y/8, square, sequence, videoBlock) == false)
+				misplaced += 1;
+			if (square == true)
+				squares += 1;
+		}
+	}
+	
+	// Each of the picture's 8x8 blocks comes from a video block, none left gray
+	for (y=0;y<thumbnail.height;y++)
+		for (x=0;x<thumbnail.width;x++)
+			if (thumbnail.crPlane[(y*kDVThumbnailMaxWidth) + x] == 128)
+				grayPixels += 1;
+	
+	// In 4:1:1, only the three right edge macroblocks of each superblock row are square
+	AVSTestCheck(misplaced == 0);
+	AVSTestCheck(squares == ((is420 == true) ? (numSequences * kTestVideoBlocksPerSequence) : (numSequences * 3)));
+	AVSTestCheck(grayPixels == 0);
+}
+
+//////////////////////////////////////////////////////
+// Test411
+//////////////////////////////////////////////////////
+static void Test411(void)
+{
+	DVThumbnailer thumbnailer;
+	UInt32 frameLen = MakeTaggedFrame(0x00);
+	
+	AVSTestCheck(thumbnailer.makeThumbnail(frameData, frameLen, 0x00, &thumbnail) == kIOReturnSuccess);
+	AVSTestCheck((thumbnail.width == 90) && (thumbnail.height == 60) && (thumbnail.skippedBlocks == 0));
+	
+	// DIF sequence 0, video segment 0: superblock column 2 of superblock row 2,
+	// macroblock 0, at picture (288,96)
+	AVSTestCheck(MacroblockIs(36, 12, false, 0, 0));
+	
+	// Its second macroblock, superblock column 1 of row 6, starts half a column
+	// down (macroblock 3 of the superblock), at picture (128,312)
+	AVSTestCheck(MacroblockIs(16, 39, false, 0, 1));
+	
+	// Video segment 1 zig-zags down the first column of superblock column 0, row 0
+	AVSTestCheck(MacroblockIs(0, 1, false, 0, 8));
+	
+	// Macroblock 6 of a superblock is the bottom of its second column
+	AVSTestCheck(MacroblockIs(4, 5, false, 0, 33));
+	
+	// The right edge: the last three macroblocks of superblock column 4 are 16x16,
+	// at picture x 704, one above another. DIF sequence 0's are in superblock row 4.
+	AVSTestCheck(MacroblockIs(88, 24, true, 0, 124));
+	AVSTestCheck(MacroblockIs(88, 26, true, 0, 129));
+	AVSTestCheck(MacroblockIs(88, 28, true, 0, 134));
+	
+	// And the bottom right corner, from superblock row 9 (DIF sequence 5)
+	AVSTestCheck(MacroblockIs(88, 58, true, 5, 134));
+	
+	// The 32x8 macroblock just left of the right edge
+	AVSTestCheck(MacroblockIs(84, 24, false, 0, 119));
+	
+	TestReferencePlacement(false, 10);
+}
+
+//////////////////////////////////////////////////////
+// Test420
+//////////////////////////////////////////////////////
+static void Test420(void)
+{
+	DVThumbnailer thumbnailer(0x80);
+	UInt32 frameLen = MakeTaggedFrame(0x80);
+	
+	AVSTestCheck(thumbnailer.makeThumbnail(frameData, frameLen, 0x80, &thumbnail) == kIOReturnSuccess);
+	AVSTestCheck((thumbnail.width == 90) && (thumbnail.height == 72) && (thumbnail.skippedBlocks == 0));
+	
+	// Superblocks are 9 macroblocks wide: columns start at picture x 0, 144, 288, 432, and 576
+	AVSTestCheck(MacroblockIs(36, 12, true, 0, 0));			// Column 2, row 2
+	AVSTestCheck(MacroblockIs(18, 36, true, 0, 1));			// Column 1, row 6
+	AVSTestCheck(MacroblockIs(54, 48, true, 0, 2));			// Column 3, row 8
+	AVSTestCheck(MacroblockIs(0, 0, true, 0, 3));			// Column 0, row 0
+	AVSTestCheck(MacroblockIs(72, 24, true, 0, 4));			// Column 4, row 4
+	
+	// Down the first column of macroblocks, then back up the second
+	AVSTestCheck(MacroblockIs(0, 4, true, 0, 13));
+	AVSTestCheck(MacroblockIs(2, 4, true, 0, 18));
+	AVSTestCheck(MacroblockIs(2, 0, true, 0, 28));
+	
+	// The bottom right corner, from superblock row 11 (DIF sequence 7)
+	AVSTestCheck(MacroblockIs(88, 70, true, 7, 134));
+	
+	TestReferencePlacement(true, 12);
+}
+
+//////////////////////////////////////////////////////
+// TestUnsupportedModes
+//////////////////////////////////////////////////////
+static void TestUnsupportedModes(void)
+{
+	DVThumbnailer thumbnailer;
+	UInt32 frameLen = MakeTaggedFrame(0x00);
+	
+	// SDL and the 50 and 100 Mbps modes aren't supported, however many times they're
+	// tried, and trying them doesn't disturb the mode that was already set
+	AVSTestCheck(thumbnailer.makeThumbnail(frameData, frameLen, 0x00, &thumbnail) == kIOReturnSuccess);
+	AVSTestCheck(thumbnailer.setDVMode(0x04) == kIOReturnUnsupported);
+	AVSTestCheck(thumbnailer.setDVMode(0x74) == kIOReturnUnsupported);
+	AVSTestCheck(thumbnailer.makeThumbnail(frameData, 288000, 0x74, &thumbnail) == kIOReturnUnsupported);
+	AVSTestCheck(thumbnailer.makeThumbnail(frameData, 288000, 0x74, &thumbnail) == kIOReturnUnsupported);
+	AVSTestCheck(thumbnailer.makeThumbnail(frameData, frameLen, 0x00, &thumbnail) == kIOReturnSuccess);
+	AVSTestCheck(MacroblockIs(36, 12, false, 0, 0));
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	Test411();
+	Test420();
+	TestUnsupportedModes();
+	
+	return AVSTestFinish("DVThumbnailerTest");
+}
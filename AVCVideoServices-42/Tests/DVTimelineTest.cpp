@@ -0,0 +1,375 @@
+/*
+	File:		DVTimelineTest.cpp
+ 
+ Synopsis: Tests for DVTimeline, feeding a stand-in DVTransmitter run against a simulated cycle clock.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Builds a timeline of clips from scratch DV files (a range of frames, a held frame,
+// a whole file, and a single frame, with one clip removed before it's read) and plays
+// it through a stand-in transmitter. DVTransmitCadence supplies the simulated isoch
+// cycle clock, and this thread makes the FramePull and FrameRelease calls the
+// transmitter's DCL callback thread would make, at each frame boundary. Checks that
+// the clips come out back to back in exactly timeline order, across a transmitter
+// restart and a clip added while playing, that each clip start message carries the
+// SYT time of the clip's first frame, and that the clip counts add up.
+//
+// DVTimeline only uses the transmitter's frame structs, so the DVTransmitter
+// members it calls are replaced below with stand-ins that own a few frame buffers.
+//
+
+#include "AVSTest.h"
+
+#include <vector>
+
+using namespace AVS;
+
+enum
+{
+	kTestTransmitterFrames = 8,
+	kTestMaxFrameSize = 144000,
+	kTestRestartFrame = 30,			// Restart the transmitter after this many frames
+	kTestAddClipFrame = 60,			// Add a clip after this many frames
+	kTestMaxCycles = (8000*60)
+};
+
+// The scratch files. Every frame is stamped with its file and frame number.
+enum
+{
+	kTestFileA = 1,
+	kTestFileB = 2,
+	kTestFileC = 3,
+	kTestFileAFrames = 40,
+	kTestFileBFrames = 20,
+	kTestFileCFrames = 50
+};
+
+struct TestClipMessage
+{
+	UInt32 msg;
+	UInt32 clipID;
+	UInt32 sytTime;
+};
+
+static DVTransmitFrame testFrames[kTestTransmitterFrames];
+static std::vector<TestClipMessage> clipMessages;
+
+//////////////////////////////////////////////////////
+// DVTransmitter stand-ins
+//////////////////////////////////////////////////////
+namespace AVS
+{
+DVTransmitter::DVTransmitter(StringLogger *stringLogger,
+							 IOFireWireLibNubRef nubInterface,
+							 UInt8 transmitterDVMode,
+							 UInt32 numFrameBuffers,
+							 unsigned int cyclesPerSegment,
+							 unsigned int numSegments,
+							 bool doIRMAllocations)
+{
+	numFrames = kTestTransmitterFrames;
+}
+
+DVTransmitter::~DVTransmitter()
+{
+}
+
+UInt32 DVTransmitter::getNumFrames(void)
+{
+	return numFrames;
+}
+
+DVTransmitFrame* DVTransmitter::getFrame(UInt32 frameIndex)
+{
+	return (frameIndex < numFrames) ? &testFrames[frameIndex] : nil;
+}
+} // namespace AVS
+
+//////////////////////////////////////////////////////
+// FrameStamp - The file and frame number a test frame is stamped with
+//////////////////////////////////////////////////////
+static UInt32 FrameStamp(UInt32 file, UInt32 frame)
+{
+	return ((file << 16) | frame);
+}
+
+//////////////////////////////////////////////////////
+// MakeClipFile - Write a scratch file of SD frames, each stamped in its last four bytes
+//////////////////////////////////////////////////////
+static bool MakeClipFile(char *pPath, UInt32 pathLen, const char *pBaseName, UInt8 dvMode, UInt32 file, UInt32 numFrames)
+{
+	UInt8 *pFrame = new UInt8[kTestMaxFrameSize];
+	UInt32 frameSize;
+	UInt32 stamp;
+	UInt32 i;
+	FILE *pFile;
+	
+	frameSize = AVSTestMakeDVFrame(pFrame, dvMode);
+	AVSTestMakeScratchFilePath(pPath, pathLen, pBaseName);
+	pFile = fopen(pPath, "wb");
+	if (!pFile)
+	{
+		delete [] pFrame;
+		return false;
+	}
+	for (i=0;i<numFrames;i++)
+	{
+		stamp = FrameStamp(file, i);
+		memcpy(&pFrame[frameSize-sizeof(UInt32)], &stamp, sizeof(UInt32));
+		fwrite(pFrame, 1, frameSize, pFile);
+	}
+	fclose(pFile);
+	delete [] pFrame;
+	
+	return true;
+}
+
+//////////////////////////////////////////////////////
+// ClipMessage
+//////////////////////////////////////////////////////
+static void ClipMessage(UInt32 msg, UInt32 param1, UInt32 param2, void *pRefCon)
+{
+	TestClipMessage message;
+	
+	message.msg = msg;
+	message.clipID = param1;
+	message.sytTime = param2;
+	clipMessages.push_back(message);
+}
+
+//////////////////////////////////////////////////////
+// TestTimeline
+//////////////////////////////////////////////////////
+static void TestTimeline(void)
+{
+	char pathA[256];
+	char pathB[256];
+	char pathC[256];
+	char pathPAL[256];
+	UInt32 frameSize;
+	UInt32 clipA, clipB, clipC, clipX, clipD, clipE = 0;
+	UInt32 frameIndex;
+	UInt32 stamp;
+	UInt32 i;
+	std::vector<UInt32> expected;
+	std::vector<UInt32> sent;
+	std::vector<UInt32> sentSYTTimes;
+	DVTransmitFrame *pCurrentFrame = nil;
+	bool newFrame = false;
+	bool restarted = false;
+	bool added = false;
+	UInt32 cycles;
+	DVTransmitCadence cadence;
+	DVTransmitCadenceCycle cycle;
+	DVTimelineStats stats;
+	
+	AVSTestCheck(MakeClipFile(pathA, sizeof(pathA), "DVTimelineTestA.dv", 0x00, kTestFileA, kTestFileAFrames));
+	AVSTestCheck(MakeClipFile(pathB, sizeof(pathB), "DVTimelineTestB.dv", 0x00, kTestFileB, kTestFileBFrames));
+	AVSTestCheck(MakeClipFile(pathC, sizeof(pathC), "DVTimelineTestC.dv", 0x00, kTestFileC, kTestFileCFrames));
+	AVSTestCheck(MakeClipFile(pathPAL, sizeof(pathPAL), "DVTimelineTestPAL.dv", 0x80, kTestFileA, 2));
+	
+	AVSTestCheck(cadence.setDVMode(0x00) == kIOReturnSuccess);
+	frameSize = cadence.getFrameSize();
+	for (i=0;i<kTestTransmitterFrames;i++)
+	{
+		bzero(&testFrames[i], sizeof(DVTransmitFrame));
+		testFrames[i].frameIndex = i;
+		testFrames[i].pFrameData = new UInt8[frameSize];
+		testFrames[i].frameLen = frameSize;
+	}
+	
+	DVTransmitter transmitter;
+	DVTimeline timeline;
+	timeline.registerMessageCallback(ClipMessage, nil);
+	
+	// A range of frames, a held frame, a whole file, a clip to remove, and a single frame
+	AVSTestCheck(timeline.addClip(pathA, 10, 29, &clipA) == kIOReturnSuccess);
+	for (i=10;i<=29;i++)
+		expected.push_back(FrameStamp(kTestFileA, i));
+	AVSTestCheck(timeline.addHold(pathB, 5, 7, &clipB) == kIOReturnSuccess);
+	for (i=0;i<7;i++)
+		expected.push_back(FrameStamp(kTestFileB, 5));
+	AVSTestCheck(timeline.addClip(pathC, 0, kDVTimelineLastFrame, &clipC) == kIOReturnSuccess);
+	for (i=0;i<kTestFileCFrames;i++)
+		expected.push_back(FrameStamp(kTestFileC, i));
+	AVSTestCheck(timeline.addClip(pathA, 3, 9, &clipX) == kIOReturnSuccess);
+	AVSTestCheck(timeline.addClip(pathA, 0, 0, &clipD) == kIOReturnSuccess);
+	expected.push_back(FrameStamp(kTestFileA, 0));
+	AVSTestCheck(timeline.getDVMode() == 0x00);
+	
+	// Clips that can't be added
+	AVSTestCheck(timeline.addClip(pathA, 30, 20) == kIOReturnBadArgument);
+	AVSTestCheck(timeline.addClip(pathA, 0, kTestFileAFrames) == kIOReturnBadArgument);
+	AVSTestCheck(timeline.addHold(pathA, kTestFileAFrames, 1) == kIOReturnBadArgument);
+	AVSTestCheck(timeline.addClip(pathPAL, 0) == kIOReturnBadArgument);
+	
+	AVSTestCheck(timeline.removeClip(clipX) == kIOReturnSuccess);
+	AVSTestCheck(timeline.removeClip(clipX) == kIOReturnNotFound);
+	
+	// The queue starts full, and the first clip can't be removed once it's been read
+	AVSTestCheck(timeline.prepareFrameQueue(&transmitter) == kIOReturnSuccess);
+	timeline.getStats(&stats);
+	AVSTestCheck(stats.prefetchDepth == kTestTransmitterFrames);
+	AVSTestCheck(timeline.removeClip(clipA) == kIOReturnBusy);
+	
+	// Run the transmitter. It pulls a new frame as each one ends, and repeats the
+	// last one if there isn't one. Only the frames it pulls are recorded.
+	for (cycles=0;(cycles < kTestMaxCycles) && (timeline.isPlaybackComplete() == false);cycles++)
+	{
+		if ((cadence.isDataCycle() == true) && (pCurrentFrame == nil) &&
+			(DVTimeline::FramePull(&frameIndex, &timeline) == kIOReturnSuccess))
+		{
+			pCurrentFrame = &testFrames[frameIndex];
+			newFrame = true;
+		}
+		
+		cadence.nextCycle(&cycle, (pCurrentFrame != nil));
+		if (cycle.dataCycle == false)
+			continue;
+		
+		if ((cycle.frameStart == true) && (newFrame == true))
+		{
+			pCurrentFrame->frameSYTTime = cycle.frameSYTTime;
+			memcpy(&stamp, &pCurrentFrame->pFrameData[frameSize-sizeof(UInt32)], sizeof(UInt32));
+			sent.push_back(stamp);
+			sentSYTTimes.push_back(cycle.frameSYTTime);
+			newFrame = false;
+		}
+		
+		if (cycle.frameEnd == true)
+		{
+			if (DVTimeline::FramePull(&frameIndex, &timeline) == kIOReturnSuccess)
+			{
+				DVTimeline::FrameRelease(pCurrentFrame->frameIndex, &timeline);
+				pCurrentFrame = &testFrames[frameIndex];
+				newFrame = true;
+			}
+			
+			// Give the reader thread time to keep up
+			usleep(1000);
+			
+			// Stop and restart the transmitter. The frame it had pulled, but not
+			// started sending, is dropped; the rest are read again.
+			if ((restarted == false) && (sent.size() == kTestRestartFrame))
+			{
+				expected.erase(expected.begin() + kTestRestartFrame);
+				AVSTestCheck(timeline.prepareFrameQueue(&transmitter) == kIOReturnSuccess);
+				cadence.setDVMode(0x00);
+				pCurrentFrame = nil;
+				newFrame = false;
+				restarted = true;
+			}
+			
+			// Add a clip while the transmitter is running
+			if ((added == false) && (sent.size() == kTestAddClipFrame))
+			{
+				AVSTestCheck(timeline.addClip(pathB, 0, kTestFileBFrames-1, &clipE) == kIOReturnSuccess);
+				for (i=0;i<kTestFileBFrames;i++)
+					expected.push_back(FrameStamp(kTestFileB, i));
+				added = true;
+			}
+		}
+	}
+	
+	AVSTestCheck(timeline.isPlaybackComplete() == true);
+	AVSTestCheck(sent == expected);
+	if (sent != expected)
+	{
+		for (i=0;(i<sent.size()) && (i<expected.size());i++)
+			if (sent[i] != expected[i])
+				break;
+		printf("  %u frames sent, %u expected, first difference at frame %u\n",
+			   (unsigned int) sent.size(), (unsigned int) expected.size(), i);
+	}
+	
+	// Every clip start, in order, with the SYT time of the clip's first frame. The
+	// last frame of the last clip is still being repeated, so it hasn't finished.
+	UInt32 clipIDs[] = {clipA, clipB, clipC, clipD, clipE};
+	UInt32 clipLengths[] = {20, 7, kTestFileCFrames-1, 1, kTestFileBFrames};
+	UInt32 firstFrame = 0;
+	UInt32 numStarted = 0;
+	UInt32 numFinished = 0;
+	for (i=0;i<clipMessages.size();i++)
+	{
+		if (clipMessages[i].msg == kDVTimelineClipStarted)
+		{
+			AVSTestCheck((numStarted < 5) && (clipMessages[i].clipID == clipIDs[numStarted]));
+			AVSTestCheck((firstFrame < sentSYTTimes.size()) && (clipMessages[i].sytTime == sentSYTTimes[firstFrame]));
+			if (numStarted < 5)
+				firstFrame += clipLengths[numStarted];
+			numStarted += 1;
+		}
+		else if (clipMessages[i].msg == kDVTimelineClipFinished)
+		{
+			AVSTestCheck((numFinished < 4) && (clipMessages[i].clipID == clipIDs[numFinished]));
+			numFinished += 1;
+		}
+	}
+	AVSTestCheck(numStarted == 5);
+	AVSTestCheck(numFinished == 4);
+	
+	timeline.getStats(&stats);
+	AVSTestCheck(stats.clipsStarted == 5);
+	AVSTestCheck(stats.clipsFinished == 4);
+	AVSTestCheck(stats.currentClipID == clipE);
+	AVSTestCheck(stats.currentClipFrame == (kTestFileBFrames-2));
+	AVSTestCheck(stats.readErrors == 0);
+	AVSTestCheck(stats.starvedPulls >= (kTestTransmitterFrames-1));
+	
+	for (i=0;i<kTestTransmitterFrames;i++)
+		delete [] testFrames[i].pFrameData;
+	AVSTestRemoveScratchFile(pathA);
+	AVSTestRemoveScratchFile(pathB);
+	AVSTestRemoveScratchFile(pathC);
+	AVSTestRemoveScratchFile(pathPAL);
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	TestTimeline();
+	
+	return AVSTestFinish("DVTimelineTest");
+}
@@ -0,0 +1,122 @@
+/*
+	File:		DVTransmitCadenceBench.cpp
+ 
+ Synopsis: Benchmark for DVTransmitCadence::nextCycle.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Times DVTransmitCadence::nextCycle, the per-cycle work a DVTransmitter does on its
+// DCL callback thread to decide what each isoch packet carries, for every mode in the
+// dvFormats table at each speed the mode supports. The records are summed, so the
+// compiler can't skip the work.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kBenchSimulatedSeconds = 300
+};
+
+//////////////////////////////////////////////////////
+// BenchCadence
+//////////////////////////////////////////////////////
+static double BenchCadence(UInt8 mode)
+{
+	DVTransmitCadence cadence;
+	DVTransmitCadenceCycle cycle;
+	UInt32 numCycles = kBenchSimulatedSeconds * kFWCyclesPerSecond;
+	UInt32 dataCycles = 0;
+	UInt32 frames = 0;
+	UInt32 sytSum = 0;
+	UInt64 startTime;
+	double nsPerCycle;
+	UInt32 n;
+	
+	cadence.setDVMode(mode);
+	
+	startTime = AVSTestNanoseconds();
+	for (n=0;n<numCycles;n++)
+	{
+		cadence.nextCycle(&cycle);
+		dataCycles += cycle.dataCycle;
+		frames += cycle.frameEnd;
+		sytSum += cycle.frameSYTTime;
+	}
+	nsPerCycle = (AVSTestNanoseconds() - startTime) / (double) numCycles;
+	
+	printf("  mode 0x%02X %ux: %5.1f ns/cycle  (%u data cycles, %u frames, SYT sum 0x%08X)\n",
+		   (unsigned int) mode,(unsigned int) (1 << DVspeed(mode)),nsPerCycle,
+		   (unsigned int) dataCycles,(unsigned int) frames,(unsigned int) sytSum);
+	
+	return nsPerCycle;
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	UInt32 i;
+	UInt8 speed;
+	double totalNs = 0.0;
+	UInt32 numRuns = 0;
+	
+	printf("DVTransmitCadenceBench: %u simulated seconds per mode\n",(unsigned int) kBenchSimulatedSeconds);
+	
+	for (i=0;dvFormats[i].frameSize != 0;i++)
+	{
+		// A packet can't hold more than 8 data blocks
+		for (speed=0;(speed<3) && ((dvFormats[i].fn + speed) <= 3);speed++)
+		{
+			totalNs += BenchCadence(dvFormats[i].mode | speed);
+			numRuns += 1;
+		}
+	}
+	
+	printf("  average: %.1f ns/cycle, %.3f%% of one 125 us isoch cycle\n",totalNs/numRuns,(totalNs/numRuns)/1250.0);
+	
+	return 0;
+}
@@ -0,0 +1,278 @@
+/*
+	File:		DVTransmitCadenceTest.cpp
+ 
+ Synopsis: Tests for DVTransmitCadence, against a simulated cycle clock.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Runs DVTransmitCadence against a simulated isoch cycle clock, and checks every
+// cycle record: the DBC sequence, that the frame offsets are contiguous and each data
+// cycle carries exactly one packet's worth of bytes, and that each frame's SYT time is
+// within a clock of where it should be (or, for a frame that starts part way through a
+// packet, no more than that packet's period early). At the end of the run, the number
+// of frames sent must be within one of the exact rate: 25 fps for 625-50 and
+// 30000/1001 fps for 525-60, times the speed.
+//
+// 525-60 and 625-50 SD are run for several simulated hours at 1x, 2x, and 4x, where
+// any error in the source packet period would show up as drift. Every other mode in
+// the dvFormats table is run for a few simulated minutes.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kTestLongRunHours = 3,
+	kTestShortRunMinutes = 10,
+	kTestScaledClocksPerCycle = (kFWClocksPerCycle * kDVScaledClockScale)
+};
+
+//////////////////////////////////////////////////////
+// ClocksBetween - Signed clocks from actual to ideal, the nearest way around the 8 second wrap
+//////////////////////////////////////////////////////
+static SInt32 ClocksBetween(UInt32 actual, UInt32 ideal)
+{
+	UInt32 elapsed = FWTimeElapsed(actual, ideal, kFWClocksPerTimeStampWrap);
+	
+	return (elapsed < (kFWClocksPerTimeStampWrap/2)) ? (SInt32) elapsed : -((SInt32) (kFWClocksPerTimeStampWrap - elapsed));
+}
+
+//////////////////////////////////////////////////////
+// RunCadence
+//////////////////////////////////////////////////////
+static void RunCadence(UInt32 formatIndex, UInt8 speed, UInt64 numCycles)
+{
+	DVTransmitCadence cadence;
+	DVTransmitCadenceCycle cycle;
+	UInt8 mode = dvFormats[formatIndex].mode | speed;
+	UInt32 frameSize = dvFormats[formatIndex].frameSize;
+	UInt64 sytOffsetScaled = ((UInt64) dvFormats[formatIndex].startingSYTOffset) * kTestScaledClocksPerCycle;
+	UInt64 scaledClocksPerPacket;
+	UInt32 packetBytes;
+	UInt8 expectedDBC = 0;
+	UInt32 expectedOffset = 0;
+	UInt64 framesStarted = 0;
+	UInt64 framesEnded = 0;
+	UInt64 idealFrameStart;
+	UInt64 n;
+	SInt32 sytError;
+	SInt32 maxSYTError = 0;
+	UInt32 badCycles = 0;
+	UInt32 badSYTs = 0;
+	UInt64 exactFrames;
+	UInt64 countedFrames;
+	UInt64 oneFrame;
+	
+	AVSTestCheck(cadence.setDVMode(mode) == kIOReturnSuccess);
+	AVSTestCheck(cadence.getFrameSize() == frameSize);
+	packetBytes = cadence.getCycleFrameBytes();
+	AVSTestCheck(packetBytes == (dvFormats[formatIndex].dbs * 4 * (1 << dvFormats[formatIndex].fn) * (1 << speed)));
+	scaledClocksPerPacket = (DVstandard(mode) == kDVStandardNTSC) ? kDVScaledClocksPerNTSCSourcePacket : kDVScaledClocksPerPALSourcePacket;
+	
+	for (n=0;n<numCycles;n++)
+	{
+		cadence.nextCycle(&cycle);
+		
+		if ((cycle.dbc != expectedDBC) || (cycle.frameOffset != expectedOffset))
+			badCycles += 1;
+		
+		if (cycle.dataCycle == false)
+		{
+			if (cycle.frameBytes || cycle.frameStart || cycle.frameEnd || cycle.nextFrameBytes)
+				badCycles += 1;
+			continue;
+		}
+		
+		if ((cycle.frameBytes + cycle.nextFrameBytes) != packetBytes)
+			badCycles += 1;
+		
+		if (cycle.frameStart || cycle.nextFrameBytes)
+		{
+			// The frame should present at the DV time of its first byte: the start
+			// time, plus its position in the stream in source packet periods. Convert
+			// the scaled clocks to clocks the way the cadence does, by truncating.
+			idealFrameStart = ((sytOffsetScaled * packetBytes) + (framesStarted * frameSize * scaledClocksPerPacket)) / (packetBytes * kDVScaledClockScale);
+			sytError = ClocksBetween((FWTimeStampToCycles(cycle.frameSYTTime) * kFWClocksPerCycle) + (cycle.frameSYTTime & 0xFFF),
+									 (UInt32) (idealFrameStart % kFWClocksPerTimeStampWrap));
+			
+			// A frame that starts part way through a packet gets the packet's SYT, which is early
+			if (cycle.nextFrameBytes)
+				sytError -= (SInt32) ((((UInt64) (packetBytes - cycle.nextFrameBytes)) * scaledClocksPerPacket) / (packetBytes * kDVScaledClockScale));
+			if ((sytError > 1) || (sytError < -1))
+				badSYTs += 1;
+			if (abs(sytError) > maxSYTError)
+				maxSYTError = abs(sytError);
+			
+			if (cycle.frameStart && (cycle.frameOffset != 0))
+				badCycles += 1;
+			framesStarted += 1;
+		}
+		
+		if (cycle.frameEnd)
+			framesEnded += 1;
+		
+		expectedDBC += (1 << dvFormats[formatIndex].fn) * (1 << speed);
+		expectedOffset = (cycle.nextFrameBytes) ? cycle.nextFrameBytes : (cycle.frameEnd ? 0 : (expectedOffset + cycle.frameBytes));
+	}
+	
+	// Frames sent, against the exact rate, both in frames times clocks per frame (scaled).
+	// One frame is (frameSize / packetBytes) source packet periods.
+	exactFrames = numCycles * kTestScaledClocksPerCycle * packetBytes;
+	countedFrames = framesEnded * frameSize * scaledClocksPerPacket;
+	oneFrame = ((UInt64) frameSize) * scaledClocksPerPacket;
+	
+	AVSTestCheck(badCycles == 0);
+	AVSTestCheck(badSYTs == 0);
+	AVSTestCheck((countedFrames + oneFrame) >= exactFrames);
+	AVSTestCheck(countedFrames <= (exactFrames + oneFrame));
+	AVSTestCheck((framesStarted == framesEnded) || (framesStarted == (framesEnded + 1)));
+	
+	printf("  mode 0x%02X %ux: %llu frames in %.2f hours (%.6f fps, %+.3f frames from exact), max SYT error %d clocks\n",
+		   (unsigned int) mode,(unsigned int) (1 << speed),(unsigned long long) framesEnded,(numCycles / (double) (kFWCyclesPerSecond * 3600)),
+		   (framesEnded * (double) kFWCyclesPerSecond) / numCycles,
+		   (((double) countedFrames) - ((double) exactFrames)) / oneFrame,(int) maxSYTError);
+}
+
+//////////////////////////////////////////////////////
+// TestSpecificRates
+//////////////////////////////////////////////////////
+static void TestSpecificRates(void)
+{
+	DVTransmitCadence cadence;
+	DVTransmitCadenceCycle cycle;
+	UInt32 frames = 0;
+	UInt32 n;
+	
+	// Exactly 25 frames in one second of 625-50, and 30000 frames in 1001 seconds of 525-60
+	cadence.setDVMode(0x80);
+	for (n=0;n<kFWCyclesPerSecond;n++)
+	{
+		cadence.nextCycle(&cycle);
+		if (cycle.frameEnd)
+			frames += 1;
+	}
+	AVSTestCheck(frames == 25);
+	
+	frames = 0;
+	cadence.setDVMode(0x00);
+	for (n=0;n<(1001*kFWCyclesPerSecond);n++)
+	{
+		cadence.nextCycle(&cycle);
+		if (cycle.frameEnd)
+			frames += 1;
+	}
+	AVSTestCheck((frames == 30000) || (frames == 29999));
+	
+	// Unknown modes are refused
+	AVSTestCheck(cadence.setDVMode(0x0C) == kIOReturnBadArgument);
+}
+
+//////////////////////////////////////////////////////
+// TestNoFrame
+//////////////////////////////////////////////////////
+static void TestNoFrame(void)
+{
+	DVTransmitCadence cadence;
+	DVTransmitCadenceCycle cycle;
+	UInt32 n;
+	
+	// Without a frame, every cycle is CIP-only, and the data waits for the next cycle
+	cadence.setDVMode(0x00);
+	for (n=0;n<100;n++)
+	{
+		cadence.nextCycle(&cycle, false);
+		AVSTestCheck((cycle.dataCycle == false) && (cycle.dbc == 0));
+		AVSTestCheck(cadence.isDataCycle() == true);
+	}
+	cadence.nextCycle(&cycle);
+	AVSTestCheck((cycle.dataCycle == true) && (cycle.frameStart == true) && (cycle.frameOffset == 0));
+}
+
+//////////////////////////////////////////////////////
+// TestStartTimeWrap
+//////////////////////////////////////////////////////
+static void TestStartTimeWrap(void)
+{
+	DVTransmitCadence cadence;
+	
+	// SD starts sending a frame one cycle before its SYT (2 cycles of SYT offset, less 1)
+	cadence.setDVMode(0x00);
+	AVSTestCheck(cadence.frameTransmitStartCycleTime((3 << 25) | (100 << 12) | 0x123) == ((3 << 25) | (99 << 12) | 0x123));
+	AVSTestCheck(cadence.frameTransmitStartCycleTime((3 << 25) | (0 << 12) | 0x123) == ((2 << 25) | (7999 << 12) | 0x123));
+	AVSTestCheck(cadence.frameTransmitStartCycleTime((0 << 25) | (0 << 12) | 0x456) == ((7 << 25) | (7999 << 12) | 0x456));
+	
+	// DVCPro100 starts 5 cycles early
+	cadence.setDVMode(0xF0);
+	AVSTestCheck(cadence.frameTransmitStartCycleTime((1 << 25) | (3 << 12)) == ((0 << 25) | (7998 << 12)));
+	AVSTestCheck(cadence.frameTransmitStartCycleTime((0 << 25) | (4 << 12)) == ((7 << 25) | (7999 << 12)));
+	AVSTestCheck(cadence.frameTransmitStartCycleTime((0 << 25) | (5 << 12)) == ((0 << 25) | (0 << 12)));
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	UInt32 i;
+	UInt8 speed;
+	
+	TestSpecificRates();
+	TestNoFrame();
+	TestStartTimeWrap();
+	
+	for (i=0;dvFormats[i].frameSize != 0;i++)
+	{
+		if ((dvFormats[i].mode & 0x7C) == 0x00)
+		{
+			// SD, at 1x, 2x, and 4x
+			for (speed=0;speed<3;speed++)
+				RunCadence(i, speed, ((UInt64) kTestLongRunHours) * 3600 * kFWCyclesPerSecond);
+		}
+		else
+			RunCadence(i, 0, ((UInt64) kTestShortRunMinutes) * 60 * kFWCyclesPerSecond);
+	}
+	
+	return AVSTestFinish("DVTransmitCadenceTest");
+}
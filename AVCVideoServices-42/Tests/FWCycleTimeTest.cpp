@@ -0,0 +1,291 @@
+/*
+	File:		FWCycleTimeTest.cpp
+ 
+ Synopsis: Tests for the FireWire cycle-time arithmetic in FWCycleTime.h.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Checks the FWCycleTime.h helpers: conversions between clocks, cycle timer register
+// values, time stamps, SPH and SYT fields; adding, subtracting, and comparing across
+// the 8000 cycle (one second), 8 second, and 128 second wraps; and the clock to
+// nanosecond and scaled clock conversions. Fixed edge cases are checked first, then
+// a few hundred thousand pseudo-random values.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kTestRandomValues = 200000
+};
+
+static UInt32 randomState = 1;
+
+//////////////////////////////////////////////////////
+// TestRandom - A small LCG, so every run checks the same values
+//////////////////////////////////////////////////////
+static UInt32 TestRandom(void)
+{
+	randomState = (randomState * 1103515245) + 12345;
+	return (randomState >> 1);
+}
+
+//////////////////////////////////////////////////////
+// MakeRegister
+//////////////////////////////////////////////////////
+static UInt32 MakeRegister(UInt32 seconds, UInt32 cycle, UInt32 offset)
+{
+	return ((seconds << 25) | (cycle << 12) | offset);
+}
+
+//////////////////////////////////////////////////////
+// RandomRegister - A valid cycle timer register value
+//////////////////////////////////////////////////////
+static UInt32 RandomRegister(void)
+{
+	return MakeRegister(TestRandom() % 128, TestRandom() % kFWCyclesPerSecond, TestRandom() % kFWClocksPerCycle);
+}
+
+//////////////////////////////////////////////////////
+// TestFieldConversions
+//////////////////////////////////////////////////////
+static void TestFieldConversions(void)
+{
+	FWCycleTime t;
+	UInt32 reg;
+	UInt32 i;
+	UInt32 badRoundTrips = 0;
+	
+	// Accessors on a known time: 9 seconds, cycle 7999, offset 3071
+	reg = MakeRegister(9, 7999, 3071);
+	t = FWCycleTime::fromRegister(reg);
+	AVSTestCheck(t.getClocks() == ((9 * kFWClocksPerSecond) + (7999 * kFWClocksPerCycle) + 3071));
+	AVSTestCheck(t.getSeconds() == 9);
+	AVSTestCheck(t.getCycles() == ((9 * kFWCyclesPerSecond) + 7999));
+	AVSTestCheck(t.getCycleCount() == 7999);
+	AVSTestCheck(t.getCycleOffset() == 3071);
+	AVSTestCheck(t.getRegister() == reg);
+	
+	// Time stamps and SYTs keep 3 bits of seconds, SPHs none, CIP SYTs 4 bits of cycles
+	AVSTestCheck(t.getTimeStamp() == MakeRegister(1, 7999, 3071));
+	AVSTestCheck(t.getSPH() == ((7999 << 12) | 3071));
+	AVSTestCheck(t.getSYT() == (((7999 & 0x0F) << 12) | 3071));
+	AVSTestCheck(FWClocksIntoSecond(reg) == ((7999 * kFWClocksPerCycle) + 3071));
+	AVSTestCheck(FWTimeStampToCycles(reg) == ((1 * kFWCyclesPerSecond) + 7999));
+	
+	// Cycle counts
+	AVSTestCheck(FWCycleTime::fromCycles(8000).getRegister() == MakeRegister(1, 0, 0));
+	AVSTestCheck(FWCycleTime::fromCycles(kFWCyclesPerCycleTimeWrap - 1).getRegister() == MakeRegister(127, 7999, 0));
+	AVSTestCheck(FWCycleTime::fromCycles(kFWCyclesPerCycleTimeWrap).getClocks() == 0);
+	AVSTestCheck(FWCyclesToTimeStamp(7999) == MakeRegister(0, 7999, 0));
+	AVSTestCheck(FWCyclesToTimeStamp(8000) == MakeRegister(1, 0, 0));
+	AVSTestCheck(FWCyclesToTimeStamp(kFWCyclesPerTimeStampWrap - 1) == MakeRegister(7, 7999, 0));
+	AVSTestCheck(FWCyclesToTimeStamp(kFWCyclesPerTimeStampWrap) == 0);
+	
+	// Every time stamp cycle round trips
+	for (i=0;i<kFWCyclesPerTimeStampWrap;i++)
+	{
+		if (FWTimeStampToCycles(FWCyclesToTimeStamp(i)) != i)
+			badRoundTrips += 1;
+	}
+	
+	// And so do register values
+	for (i=0;i<kTestRandomValues;i++)
+	{
+		reg = RandomRegister();
+		if (FWCycleTime::fromRegister(reg).getRegister() != reg)
+			badRoundTrips += 1;
+	}
+	AVSTestCheck(badRoundTrips == 0);
+	
+	// A clock count wraps at 128 seconds
+	AVSTestCheck(FWCycleTime(kFWClocksPerCycleTimeWrap).getClocks() == 0);
+	AVSTestCheck(FWCycleTime(kFWClocksPerCycleTimeWrap + 5).getClocks() == 5);
+}
+
+//////////////////////////////////////////////////////
+// TestAddSubtract
+//////////////////////////////////////////////////////
+static void TestAddSubtract(void)
+{
+	FWCycleTime a, b;
+	UInt32 delta;
+	UInt32 i;
+	UInt32 badSums = 0;
+	
+	// Carry from the offset into the cycle count, at 8000 cycles into the seconds, and at 128 seconds
+	AVSTestCheck(FWCycleTime::fromRegister(MakeRegister(5, 100, 3071)).add(1).getRegister() == MakeRegister(5, 101, 0));
+	AVSTestCheck(FWCycleTime::fromRegister(MakeRegister(5, 7999, 3071)).add(1).getRegister() == MakeRegister(6, 0, 0));
+	AVSTestCheck(FWCycleTime::fromRegister(MakeRegister(5, 7999, 10)).addCycles(1).getRegister() == MakeRegister(6, 0, 10));
+	AVSTestCheck(FWCycleTime::fromRegister(MakeRegister(127, 7999, 3071)).add(1).getClocks() == 0);
+	AVSTestCheck(FWCycleTime::fromRegister(MakeRegister(127, 7990, 7)).addCycles(20).getRegister() == MakeRegister(0, 10, 7));
+	AVSTestCheck(FWCycleTime::fromRegister(MakeRegister(1, 2, 3)).add(kFWClocksPerCycleTimeWrap).getRegister() == MakeRegister(1, 2, 3));
+	
+	// Borrows, the other way
+	AVSTestCheck(FWCycleTime::fromRegister(MakeRegister(5, 101, 0)).subtract(1).getRegister() == MakeRegister(5, 100, 3071));
+	AVSTestCheck(FWCycleTime::fromRegister(MakeRegister(6, 0, 0)).subtract(1).getRegister() == MakeRegister(5, 7999, 3071));
+	AVSTestCheck(FWCycleTime(0).subtract(1).getRegister() == MakeRegister(127, 7999, 3071));
+	AVSTestCheck(FWCycleTime(0).subtract(kFWClocksPerCycle * 8001).getRegister() == MakeRegister(126, 7999, 0));
+	AVSTestCheck(FWCycleTime(0).subtract(0).getClocks() == 0);
+	
+	// Elapsed time across the wraps
+	AVSTestCheck(FWTimeElapsed(7990, 10, kFWCyclesPerSecond) == 20);
+	AVSTestCheck(FWTimeElapsed(kFWCyclesPerTimeStampWrap - 1, 0, kFWCyclesPerTimeStampWrap) == 1);
+	AVSTestCheck(FWTimeElapsed(100, 100, kFWCyclesPerTimeStampWrap) == 0);
+	AVSTestCheck(FWCycleTime(0).clocksSince(FWCycleTime(kFWClocksPerCycleTimeWrap - 1)) == 1);
+	
+	// Adding then subtracting any delta gets back to where we started, and
+	// clocksSince measures the delta, whichever wraps are crossed
+	for (i=0;i<kTestRandomValues;i++)
+	{
+		a = FWCycleTime::fromRegister(RandomRegister());
+		delta = (TestRandom() * 3) % kFWClocksPerCycleTimeWrap;
+		b = a.add(delta);
+		if ((b.subtract(delta).getClocks() != a.getClocks()) ||
+			(b.clocksSince(a) != delta) ||
+			(a.subtract(kFWClocksPerCycleTimeWrap - delta).getClocks() != b.getClocks()))
+			badSums += 1;
+	}
+	AVSTestCheck(badSums == 0);
+}
+
+//////////////////////////////////////////////////////
+// TestCompare
+//////////////////////////////////////////////////////
+static void TestCompare(void)
+{
+	FWCycleTime beforeWrap = FWCycleTime::fromRegister(MakeRegister(127, 7999, 0));
+	FWCycleTime afterWrap = FWCycleTime::fromRegister(MakeRegister(0, 1, 0));
+	FWCycleTime a, b;
+	SInt32 delta;
+	UInt32 i;
+	UInt32 badCompares = 0;
+	
+	// The nearest way around the 128 second wrap decides which time is first
+	AVSTestCheck(beforeWrap.compare(afterWrap) < 0);
+	AVSTestCheck(afterWrap.compare(beforeWrap) > 0);
+	AVSTestCheck(afterWrap.clocksFrom(beforeWrap) == (2 * kFWClocksPerCycle));
+	AVSTestCheck(beforeWrap.clocksFrom(afterWrap) == -(2 * kFWClocksPerCycle));
+	AVSTestCheck(beforeWrap.compare(beforeWrap) == 0);
+	
+	// Within a second, and within a cycle
+	AVSTestCheck(FWCycleTime::fromRegister(MakeRegister(3, 10, 5)).compare(FWCycleTime::fromRegister(MakeRegister(3, 10, 6))) < 0);
+	AVSTestCheck(FWCycleTime::fromRegister(MakeRegister(3, 7999, 0)).compare(FWCycleTime::fromRegister(MakeRegister(4, 0, 0))) < 0);
+	
+	// Just under half the wrap apart is still nearest one way, just over is nearest the other
+	a = FWCycleTime(0);
+	AVSTestCheck(a.add((kFWClocksPerCycleTimeWrap/2) - 1).compare(a) > 0);
+	AVSTestCheck(a.add((kFWClocksPerCycleTimeWrap/2) + 1).compare(a) < 0);
+	
+	// Comparisons are antisymmetric, and agree with adding
+	for (i=0;i<kTestRandomValues;i++)
+	{
+		a = FWCycleTime::fromRegister(RandomRegister());
+		b = FWCycleTime::fromRegister(RandomRegister());
+		if (a.compare(b) != -b.compare(a))
+			badCompares += 1;
+		delta = a.clocksFrom(b);
+		if (((delta >= 0) ? b.add((UInt32) delta) : b.subtract((UInt32) -delta)).getClocks() != a.getClocks())
+			badCompares += 1;
+		if (a.add(1 + (TestRandom() % (kFWClocksPerCycleTimeWrap/2 - 1))).compare(a) <= 0)
+			badCompares += 1;
+	}
+	AVSTestCheck(badCompares == 0);
+}
+
+//////////////////////////////////////////////////////
+// TestOffsetConversions
+//////////////////////////////////////////////////////
+static void TestOffsetConversions(void)
+{
+	UInt32 clocks;
+	UInt64 nanoSeconds;
+	UInt32 badConversions = 0;
+	
+	// Exact at cycle and second boundaries
+	AVSTestCheck(FWClocksToNanoSeconds(kFWClocksPerCycle) == kFWNanoSecondsPerCycle);
+	AVSTestCheck(FWClocksToNanoSeconds(kFWClocksPerSecond) == 1000000000ULL);
+	AVSTestCheck(FWClocksToNanoSeconds(kFWClocksPerCycleTimeWrap) == 128000000000ULL);
+	AVSTestCheck(FWNanoSecondsToClocks(kFWNanoSecondsPerCycle) == kFWClocksPerCycle);
+	AVSTestCheck(FWNanoSecondsToClocks(1000000000ULL) == kFWClocksPerSecond);
+	AVSTestCheck(FWCyclesToNanoSeconds(kFWCyclesPerSecond) == 1000000000ULL);
+	
+	// Rounded to the nearest: one clock is 40.69 nSec
+	AVSTestCheck(FWClocksToNanoSeconds(1) == 41);
+	AVSTestCheck(FWClocksToNanoSeconds(3) == 122);
+	AVSTestCheck(FWNanoSecondsToClocks(20) == 0);
+	AVSTestCheck(FWNanoSecondsToClocks(21) == 1);
+	
+	// Every clock offset in a second converts to nanoseconds and back exactly,
+	// and the nanoseconds are within half a nanosecond of the real value
+	for (clocks=0;clocks<kFWClocksPerSecond;clocks++)
+	{
+		nanoSeconds = FWClocksToNanoSeconds(clocks);
+		if ((FWNanoSecondsToClocks(nanoSeconds) != clocks) ||
+			((((UInt64) clocks * 15625) > ((nanoSeconds * 384) + 192)) || (((nanoSeconds * 384)) > (((UInt64) clocks * 15625) + 192))))
+			badConversions += 1;
+	}
+	AVSTestCheck(badConversions == 0);
+	
+	// Scaled clocks: the DV source packet periods are whole numbers at a scale of 625
+	AVSTestCheck(FWScaledClocksPerPacket(25.0 * 300 * 480 * 8, 480 * 8, kDVScaledClockScale) == kDVScaledClocksPerPALSourcePacket);
+	AVSTestCheck(FWScaledClocksPerPacket((30000.0 / 1001.0) * 250 * 480 * 8, 480 * 8, kDVScaledClockScale) == kDVScaledClocksPerNTSCSourcePacket);
+	AVSTestCheck(FWClocksToScaledClocks(kFWClocksPerCycle, kDVScaledClockScale) == (kFWClocksPerCycle * kDVScaledClockScale));
+	AVSTestCheck(FWScaledClocksToClocks(kDVScaledClocksPerNTSCSourcePacket, kDVScaledClockScale) == 3280);
+	AVSTestCheck(FWScaledClocksToClocks(FWClocksToScaledClocks(kFWClocksPerTimeStampWrap, kDVScaledClockScale) - 1, kDVScaledClockScale) == (kFWClocksPerTimeStampWrap - 1));
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	TestFieldConversions();
+	TestAddSubtract();
+	TestCompare();
+	TestOffsetConversions();
+	
+	return AVSTestFinish("FWCycleTimeTest");
+}
@@ -0,0 +1,260 @@
+/*
+	File:		MPEG2ReceiveCycleParseTest.cpp
+ 
+ Synopsis: Checks MPEG2Receiver's receive buffer parsing with simulated isoch payloads, up to the largest per-cycle packet limit.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Builds receive buffers the way the MPEG2Receiver DCL program fills them (isoch header,
+// CIP header, then source packets, one cycle per receive buffer entry, with each entry
+// sized for the receiver's maxPacketsPerCycle), and runs them through the same parse
+// the DCL callback uses. Checks every packet count from zero to one past the limit,
+// at the default limit and at the larger limits used for S400/S800 capture, with and
+// without source packet headers, and that bad payload lengths are rejected.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kTestCyclesPerSegment = 200
+};
+
+//////////////////////////////////////////////////////
+// FillSimulatedCycle
+//////////////////////////////////////////////////////
+static void FillSimulatedCycle(UInt32 *pCycleBuf, UInt32 payloadLen, UInt32 cycle)
+{
+	UInt32 numPackets = (payloadLen >= 8) ? ((payloadLen-8) / 192) : 0;
+	UInt32 i;
+	UInt8 *pTSPacket;
+	
+	// The isoch header is in native byte order, the rest is as received
+	pCycleBuf[0] = (payloadLen << 16) | 0x00000060;
+	pCycleBuf[1] = EndianU32_NtoB(0x00C00000 | (cycle & 0xFF));
+	pCycleBuf[2] = EndianU32_NtoB(0xA0000000);
+	for (i=0;i<numPackets;i++)
+	{
+		// Source packet header, with the cycle and packet number as the time stamp
+		pCycleBuf[3+(i*48)] = EndianU32_NtoB(((cycle % 8000) << 12) | i);
+		pTSPacket = (UInt8*) &pCycleBuf[4+(i*48)];
+		memset(pTSPacket, 0, kMPEG2TSPacketSize);
+		pTSPacket[0] = 0x47;
+		pTSPacket[1] = (UInt8) cycle;
+		pTSPacket[2] = (UInt8) i;
+	}
+}
+
+//////////////////////////////////////////////////////
+// CheckParsedPackets
+//////////////////////////////////////////////////////
+static bool CheckParsedPackets(UInt32 **ppPacketPtrs, UInt32 numPackets, bool includeSPH, UInt32 cycle)
+{
+	UInt32 i;
+	UInt8 *pTSPacket;
+	UInt32 sph;
+	
+	for (i=0;i<numPackets;i++)
+	{
+		if (includeSPH == true)
+		{
+			sph = EndianU32_BtoN(ppPacketPtrs[i][0]);
+			if (sph != (((cycle % 8000) << 12) | i))
+				return false;
+			pTSPacket = (UInt8*) &ppPacketPtrs[i][1];
+		}
+		else
+			pTSPacket = (UInt8*) ppPacketPtrs[i];
+		
+		if ((pTSPacket[0] != 0x47) || (pTSPacket[1] != (UInt8) cycle) || (pTSPacket[2] != (UInt8) i))
+			return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////
+// TestPacketCounts
+//////////////////////////////////////////////////////
+static void TestPacketCounts(UInt32 maxPacketsPerCycle, bool includeSPH)
+{
+	UInt32 receiveBufferSize = ((maxPacketsPerCycle*192)+16);
+	UInt32 *pCycleBuf = new UInt32[(((kMaxNumReceivePacketsPerCycleLimit+1)*192)+16)/4];
+	UInt32 *pPacketPtrs[kMaxNumReceivePacketsPerCycleLimit+1];
+	UInt32 numPackets;
+	UInt32 parsedCount;
+	bool countsOK = true;
+	bool packetsOK = true;
+	bool valid;
+	
+	// A payload with one packet more than fits the receive buffer entry can't
+	// actually arrive, but the length check has to reject it either way
+	for (numPackets=0;numPackets<=(maxPacketsPerCycle+1);numPackets++)
+	{
+		FillSimulatedCycle(pCycleBuf, 8+(numPackets*192), numPackets);
+		valid = MPEG2ReceiverParseCycle(pCycleBuf, maxPacketsPerCycle, includeSPH, pPacketPtrs, &parsedCount);
+		if (numPackets <= maxPacketsPerCycle)
+		{
+			if ((valid == false) || (parsedCount != numPackets))
+				countsOK = false;
+			else if (CheckParsedPackets(pPacketPtrs, parsedCount, includeSPH, numPackets) == false)
+				packetsOK = false;
+			
+			// Every packet has to be inside this cycle's receive buffer entry
+			if ((parsedCount > 0) &&
+				(((UInt8*) pPacketPtrs[parsedCount-1] + 192 - ((includeSPH == true) ? 0 : 4)) > ((UInt8*) pCycleBuf + receiveBufferSize)))
+				packetsOK = false;
+		}
+		else if ((valid == true) || (parsedCount != 0))
+			countsOK = false;
+	}
+	AVSTestCheck(countsOK);
+	AVSTestCheck(packetsOK);
+	
+	delete [] pCycleBuf;
+}
+
+//////////////////////////////////////////////////////
+// TestBadLengths
+//////////////////////////////////////////////////////
+static void TestBadLengths(void)
+{
+	UInt32 badLengths[] = { 0, 4, 7, 8+1, 8+188, 8+191, 8+193, 8+(2*192)+4 };
+	UInt32 *pCycleBuf = new UInt32[(((kMaxNumReceivePacketsPerCycleLimit+1)*192)+16)/4];
+	UInt32 *pPacketPtrs[kMaxNumReceivePacketsPerCycleLimit];
+	UInt32 parsedCount;
+	bool rejected = true;
+	UInt32 i;
+	
+	for (i=0;i<(sizeof(badLengths)/sizeof(UInt32));i++)
+	{
+		FillSimulatedCycle(pCycleBuf, badLengths[i], i);
+		parsedCount = 0xFFFFFFFF;
+		if ((MPEG2ReceiverParseCycle(pCycleBuf, kMaxNumReceivePacketsPerCycleLimit, false, pPacketPtrs, &parsedCount) == true) ||
+			(parsedCount != 0))
+			rejected = false;
+	}
+	AVSTestCheck(rejected);
+	
+	delete [] pCycleBuf;
+}
+
+//////////////////////////////////////////////////////
+// TestSimulatedSegment - a whole segment of receive buffers, with varying packet counts
+//////////////////////////////////////////////////////
+static void TestSimulatedSegment(UInt32 maxPacketsPerCycle, bool includeSPH)
+{
+	UInt32 receiveBufferSize = ((maxPacketsPerCycle*192)+16);
+	UInt8 *pSegmentBuf = new UInt8[kTestCyclesPerSegment*receiveBufferSize];
+	UInt32 *pPacketPtrs[kMaxNumReceivePacketsPerCycleLimit];
+	UInt32 *pCycleBuf;
+	UInt32 cycle;
+	UInt32 numPackets;
+	UInt32 parsedCount;
+	UInt32 expectedTSCount = 0;
+	UInt32 tsCount = 0;
+	UInt32 badCycles = 0;
+	bool packetsOK = true;
+	
+	// Every 50th cycle is a bad (truncated) packet
+	for (cycle=0;cycle<kTestCyclesPerSegment;cycle++)
+	{
+		pCycleBuf = (UInt32*) &pSegmentBuf[cycle*receiveBufferSize];
+		numPackets = (cycle * 7) % (maxPacketsPerCycle+1);
+		if ((cycle % 50) == 49)
+			FillSimulatedCycle(pCycleBuf, 8+(numPackets*192)+4, cycle);
+		else
+		{
+			FillSimulatedCycle(pCycleBuf, 8+(numPackets*192), cycle);
+			expectedTSCount += numPackets;
+		}
+	}
+	
+	// Parse it the way MPEG2ReceiveDCLCallback does
+	for (cycle=0;cycle<kTestCyclesPerSegment;cycle++)
+	{
+		pCycleBuf = (UInt32*) &pSegmentBuf[cycle*receiveBufferSize];
+		if (MPEG2ReceiverParseCycle(pCycleBuf, maxPacketsPerCycle, includeSPH, pPacketPtrs, &parsedCount) == true)
+		{
+			tsCount += parsedCount;
+			if (CheckParsedPackets(pPacketPtrs, parsedCount, includeSPH, cycle) == false)
+				packetsOK = false;
+		}
+		else
+			badCycles += 1;
+	}
+	
+	AVSTestCheck(tsCount == expectedTSCount);
+	AVSTestCheck(badCycles == (kTestCyclesPerSegment / 50));
+	AVSTestCheck(packetsOK);
+	
+	printf("%u packets per cycle%s: %u ts packets in %u cycles, %u bad cycles\n",
+		   (unsigned int) maxPacketsPerCycle,
+		   (includeSPH == true) ? " with SPH" : "",
+		   (unsigned int) tsCount,
+		   (unsigned int) kTestCyclesPerSegment,
+		   (unsigned int) badCycles);
+	
+	delete [] pSegmentBuf;
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	UInt32 limits[] = { kMaxNumReceivePacketsPerCycle, 10, 20, kMaxNumReceivePacketsPerCycleLimit };
+	UInt32 i;
+	
+	for (i=0;i<(sizeof(limits)/sizeof(UInt32));i++)
+	{
+		TestPacketCounts(limits[i], false);
+		TestPacketCounts(limits[i], true);
+		TestSimulatedSegment(limits[i], false);
+		TestSimulatedSegment(limits[i], true);
+	}
+	TestBadLengths();
+	
+	return AVSTestFinish("MPEG2ReceiveCycleParseTest");
+}
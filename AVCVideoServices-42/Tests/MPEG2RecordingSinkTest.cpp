@@ -0,0 +1,275 @@
+/*
+	File:		MPEG2RecordingSinkTest.cpp
+ 
+ Synopsis: Checks that MPEG2RecordingSink writes exactly the packets pushed into it, and fails the recording on a write error.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Feeds MPEG2RecordingSink synthetic batches of packets, the way the MPEG2Receiver data
+// push callbacks would, and reads the file back to check that every byte made it, in
+// order, with and without source packet headers. Also checks that the writer thread
+// brings backlogBytes back down as it drains the buffers, and that a write the file
+// system cuts short (here, by RLIMIT_FSIZE) fails the recording instead of leaving a
+// hole in the file.
+//
+
+#include "AVSTest.h"
+#include <signal.h>
+#include <sys/resource.h>
+
+using namespace AVS;
+
+enum
+{
+	kTestPacketsPerBuffer = kMPEG2RecordingSinkPacketsPerBufferGranularity,
+	kTestNumBuffers = 4,
+	kTestNumBatches = 400,
+	kTestWaitTimeoutInMs = 5000
+};
+
+//////////////////////////////////////////////////////
+// FillTestPacket
+//////////////////////////////////////////////////////
+static void FillTestPacket(UInt8 *pPacket, UInt32 packetSize, UInt32 packetIndex)
+{
+	UInt32 i;
+	
+	for (i=0;i<packetSize;i++)
+		pPacket[i] = (UInt8) ((packetIndex * 7) + (i * 13) + (packetIndex >> 8));
+}
+
+//////////////////////////////////////////////////////
+// WaitForStats - polls the sink's stats until done(stats) is true, or we time out
+//////////////////////////////////////////////////////
+static bool BacklogBelow(MPEG2RecordingSinkStats *pStats, UInt64 limit) { return (pStats->backlogBytes < limit); }
+static bool HadWriteError(MPEG2RecordingSinkStats *pStats, UInt64 limit) { return (pStats->writeErrors > 0); }
+
+static bool WaitForStats(MPEG2RecordingSink *pSink,
+						 bool (*done)(MPEG2RecordingSinkStats *pStats, UInt64 limit),
+						 UInt64 limit,
+						 MPEG2RecordingSinkStats *pStats)
+{
+	UInt32 i;
+	
+	for (i=0;i<kTestWaitTimeoutInMs;i++)
+	{
+		pSink->getStats(pStats);
+		if (done(pStats, limit) == true)
+			return true;
+		usleep(1000);
+	}
+	return false;
+}
+
+//////////////////////////////////////////////////////
+// TestRoundTrip
+//////////////////////////////////////////////////////
+static void TestRoundTrip(bool includeSPH, bool useSpanDataPush)
+{
+	char path[256];
+	UInt32 packetSize = (includeSPH == true) ? 192 : 188;
+	UInt32 bufferSize = kTestPacketsPerBuffer * packetSize;
+	MPEG2RecordingSink *pSink = new MPEG2RecordingSink(nil, kTestPacketsPerBuffer, kTestNumBuffers, includeSPH);
+	MPEGReceivePacketDescriptor packets[kMaxNumReceivePacketsPerCycle*8];
+	UInt32 *pPacketPtrs[kMaxNumReceivePacketsPerCycle*8];
+	UInt8 *pPacketData = new UInt8[kMaxNumReceivePacketsPerCycle*8*packetSize];
+	UInt8 expected[192];
+	UInt8 actual[192];
+	MPEG2RecordingSinkStats stats;
+	UInt32 batch, i;
+	UInt32 numPackets;
+	UInt32 totalPackets = 0;
+	bool pushesOK = true;
+	bool dataOK = true;
+	bool drained = true;
+	IOReturn result;
+	FILE *pFile;
+	
+	AVSTestMakeScratchFilePath(path, sizeof(path), "MPEG2RecordingSinkTest");
+	AVSTestCheck(pSink->openFile(path) == kIOReturnSuccess);
+	
+	for (batch=0;batch<kTestNumBatches;batch++)
+	{
+		// Vary the batch size, from one cycle's worth of packets up to a
+		// whole segment's worth, so batches straddle the buffer boundaries
+		numPackets = 1 + ((batch * 37) % (kMaxNumReceivePacketsPerCycle*8));
+		for (i=0;i<numPackets;i++)
+		{
+			FillTestPacket(&pPacketData[i*packetSize], packetSize, totalPackets+i);
+			pPacketPtrs[i] = (UInt32*) &pPacketData[i*packetSize];
+			packets[i].pBuf = pPacketPtrs[i];
+			packets[i].cycle = i;
+			packets[i].fireWireTimeStamp = 0;
+			packets[i].nanoSecondsTimeStamp = 0;
+		}
+		
+		if (useSpanDataPush == true)
+			result = MPEG2RecordingSink::SpanDataPush(numPackets, packets, pSink);
+		else
+			result = MPEG2RecordingSink::DataPush(numPackets, pPacketPtrs, pSink);
+		if (result != kIOReturnSuccess)
+			pushesOK = false;
+		totalPackets += numPackets;
+		
+		// Don't outrun the writer thread, so nothing gets dropped. This
+		// only returns if the writer thread updates backlogBytes as it
+		// drains the buffers, since we're not pushing in the meantime.
+		if (WaitForStats(pSink, BacklogBelow, bufferSize, &stats) == false)
+			drained = false;
+	}
+	
+	AVSTestCheck(pushesOK);
+	AVSTestCheck(drained);
+	AVSTestCheck(pSink->closeFile() == kIOReturnSuccess);
+	pSink->getStats(&stats);
+	AVSTestCheck(stats.bytesReceived == ((UInt64) totalPackets * packetSize));
+	AVSTestCheck(stats.bytesWritten == ((UInt64) totalPackets * packetSize));
+	AVSTestCheck(stats.bytesDropped == 0);
+	AVSTestCheck(stats.backlogBytes == 0);
+	AVSTestCheck(stats.writeErrors == 0);
+	
+	// Read the file back
+	pFile = fopen(path, "rb");
+	AVSTestCheck(pFile != nil);
+	if (pFile)
+	{
+		for (i=0;i<totalPackets;i++)
+		{
+			FillTestPacket(expected, packetSize, i);
+			if ((fread(actual, 1, packetSize, pFile) != packetSize) || (memcmp(expected, actual, packetSize) != 0))
+			{
+				dataOK = false;
+				break;
+			}
+		}
+		if (fread(actual, 1, 1, pFile) != 0)
+			dataOK = false;
+		fclose(pFile);
+	}
+	AVSTestCheck(dataOK);
+	
+	printf("%s%s: %u packets, %llu bytes written, max backlog %u bytes\n",
+		   (useSpanDataPush == true) ? "SpanDataPush" : "DataPush",
+		   (includeSPH == true) ? " with SPH" : "",
+		   (unsigned int) totalPackets,
+		   (unsigned long long) stats.bytesWritten,
+		   (unsigned int) stats.maxBacklogBytes);
+	
+	AVSTestRemoveScratchFile(path);
+	delete [] pPacketData;
+	delete pSink;
+}
+
+//////////////////////////////////////////////////////
+// TestWriteFailure
+//////////////////////////////////////////////////////
+static void TestWriteFailure(void)
+{
+	char path[256];
+	UInt32 bufferSize = kTestPacketsPerBuffer * 188;
+	MPEG2RecordingSink *pSink = new MPEG2RecordingSink(nil, kTestPacketsPerBuffer, kTestNumBuffers);
+	UInt8 *pPacketData = new UInt8[kTestPacketsPerBuffer*188];
+	UInt32 **ppPacketPtrs = new UInt32*[kTestPacketsPerBuffer];
+	MPEG2RecordingSinkStats stats;
+	struct rlimit savedLimit;
+	struct rlimit limit;
+	void (*savedHandler)(int);
+	UInt32 fileSizeLimit = bufferSize + (bufferSize / 2);
+	UInt32 i;
+	
+	for (i=0;i<kTestPacketsPerBuffer;i++)
+	{
+		FillTestPacket(&pPacketData[i*188], 188, i);
+		ppPacketPtrs[i] = (UInt32*) &pPacketData[i*188];
+	}
+	
+	// Let the file grow to one and a half buffers. The second buffer's first
+	// pwrite comes up short, and the one after it fails with EFBIG.
+	getrlimit(RLIMIT_FSIZE, &savedLimit);
+	limit = savedLimit;
+	limit.rlim_cur = fileSizeLimit;
+	savedHandler = signal(SIGXFSZ, SIG_IGN);
+	setrlimit(RLIMIT_FSIZE, &limit);
+	
+	AVSTestMakeScratchFilePath(path, sizeof(path), "MPEG2RecordingSinkTest");
+	AVSTestCheck(pSink->openFile(path) == kIOReturnSuccess);
+	
+	AVSTestCheck(pSink->pushTSPackets(kTestPacketsPerBuffer, ppPacketPtrs) == kIOReturnSuccess);
+	AVSTestCheck(pSink->pushTSPackets(kTestPacketsPerBuffer, ppPacketPtrs) == kIOReturnSuccess);
+	AVSTestCheck(WaitForStats(pSink, HadWriteError, 0, &stats));
+	
+	// The short write was kept, and everything after it refused
+	AVSTestCheck(stats.writeErrors == 1);
+	AVSTestCheck(stats.bytesWritten == fileSizeLimit);
+	AVSTestCheck(pSink->pushTSPackets(kTestPacketsPerBuffer, ppPacketPtrs) == kIOReturnIOError);
+	AVSTestCheck(pSink->closeFile() == kIOReturnIOError);
+	pSink->getStats(&stats);
+	AVSTestCheck(stats.bytesDropped == bufferSize);
+	
+	printf("Write failure: %llu bytes written, %llu dropped, %u write errors\n",
+		   (unsigned long long) stats.bytesWritten,
+		   (unsigned long long) stats.bytesDropped,
+		   (unsigned int) stats.writeErrors);
+	
+	setrlimit(RLIMIT_FSIZE, &savedLimit);
+	signal(SIGXFSZ, savedHandler);
+	
+	AVSTestRemoveScratchFile(path);
+	delete [] ppPacketPtrs;
+	delete [] pPacketData;
+	delete pSink;
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	TestRoundTrip(false, false);
+	TestRoundTrip(true, false);
+	TestRoundTrip(false, true);
+	TestRoundTrip(true, true);
+	TestWriteFailure();
+	
+	return AVSTestFinish("MPEG2RecordingSinkTest");
+}
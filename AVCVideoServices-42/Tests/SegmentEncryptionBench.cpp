@@ -0,0 +1,349 @@
+/*
+	File:		SegmentEncryptionBench.cpp
+ 
+ Synopsis: Compares per-cycle and per-segment encryption callbacks in MPEG2Transmitter, using a software AES-CBC cipher as a stand-in for DTCP.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// Encrypts five seconds of a simulated transport stream the way the NuDCL MPEG2Transmitter
+// delivers it to the client's cipher: once per isoch cycle through an
+// MPEG2TransmitterEncryptionProc, or once per program segment through an
+// MPEG2TransmitterSegmentEncryptionProc. The stand-in cipher is AES-128-CBC,
+// which encrypts the 16-byte blocks of each packet, leaving the 12-byte remainder
+// in the clear. Like the DTCP ciphers it stands in for, it sets up its key on each
+// call: the AES key schedule, plus, in the second set of runs, deriving the content
+// key from an exchange key and nonce (modelled as a CBC-MAC over a fixed number
+// of blocks). The cipher is checked against the FIPS-197 test vector first.
+//
+
+#include "AVSTest.h"
+
+using namespace AVS;
+
+enum
+{
+	kBenchCyclesPerSegment = kCyclesPerTransmitSegment,
+	kBenchSimulatedSeconds = 5,
+	kBenchKeyDerivationBlocks = 64,
+	kBenchCiphertextBytesPerPacket = (kMPEG2TSPacketSize/16)*16
+};
+
+//////////////////////////////////////////////////////
+// AES-128 (FIPS-197), encryption only
+//////////////////////////////////////////////////////
+static UInt8 aesSBox[256];
+
+struct AESCBCContext
+{
+	UInt8 roundKeys[176];
+	UInt8 iv[16];
+};
+
+static UInt8 AESTimes2(UInt8 x)
+{
+	return (UInt8) ((x << 1) ^ ((x & 0x80) ? 0x1B : 0x00));
+}
+
+static void AESInitSBox(void)
+{
+	UInt8 p = 1;
+	UInt8 q = 1;
+	UInt8 x;
+
+	// Walk the multiplicative group with generator 3, tracking the inverse
+	do
+	{
+		p = p ^ AESTimes2(p);
+		q ^= q << 1;
+		q ^= q << 2;
+		q ^= q << 4;
+		if (q & 0x80)
+			q ^= 0x09;
+		x = q ^ ((q << 1) | (q >> 7)) ^ ((q << 2) | (q >> 6)) ^ ((q << 3) | (q >> 5)) ^ ((q << 4) | (q >> 4));
+		aesSBox[p] = x ^ 0x63;
+	}while (p != 1);
+	aesSBox[0] = 0x63;
+}
+
+static void AESExpandKey(AESCBCContext *pContext, const UInt8 *pKey)
+{
+	UInt8 rcon = 1;
+	UInt8 temp[4];
+	UInt8 t;
+	UInt32 i;
+
+	memcpy(pContext->roundKeys,pKey,16);
+	for (i=16;i<176;i+=4)
+	{
+		memcpy(temp,&pContext->roundKeys[i-4],4);
+		if ((i % 16) == 0)
+		{
+			t = temp[0];
+			temp[0] = aesSBox[temp[1]] ^ rcon;
+			temp[1] = aesSBox[temp[2]];
+			temp[2] = aesSBox[temp[3]];
+			temp[3] = aesSBox[t];
+			rcon = AESTimes2(rcon);
+		}
+		pContext->roundKeys[i+0] = pContext->roundKeys[i-16+0] ^ temp[0];
+		pContext->roundKeys[i+1] = pContext->roundKeys[i-16+1] ^ temp[1];
+		pContext->roundKeys[i+2] = pContext->roundKeys[i-16+2] ^ temp[2];
+		pContext->roundKeys[i+3] = pContext->roundKeys[i-16+3] ^ temp[3];
+	}
+}
+
+static void AESEncryptBlock(const AESCBCContext *pContext, UInt8 *pState)
+{
+	UInt8 t[16];
+	UInt32 round;
+	UInt32 i;
+	UInt8 a0,a1,a2,a3,all;
+
+	for (i=0;i<16;i++)
+		pState[i] ^= pContext->roundKeys[i];
+
+	for (round=1;round<=10;round++)
+	{
+		// SubBytes and ShiftRows
+		for (i=0;i<16;i++)
+			t[i] = aesSBox[pState[((i + ((i & 3)*4)) & 15)]];
+
+		// MixColumns, except in the last round
+		if (round != 10)
+		{
+			for (i=0;i<16;i+=4)
+			{
+				a0 = t[i]; a1 = t[i+1]; a2 = t[i+2]; a3 = t[i+3];
+				all = a0 ^ a1 ^ a2 ^ a3;
+				t[i+0] ^= all ^ AESTimes2(a0 ^ a1);
+				t[i+1] ^= all ^ AESTimes2(a1 ^ a2);
+				t[i+2] ^= all ^ AESTimes2(a2 ^ a3);
+				t[i+3] ^= all ^ AESTimes2(a3 ^ a0);
+			}
+		}
+
+		// AddRoundKey
+		for (i=0;i<16;i++)
+			pState[i] = t[i] ^ pContext->roundKeys[(round*16)+i];
+	}
+}
+
+static void AESCBCEncrypt(AESCBCContext *pContext, UInt8 *pData, UInt32 length)
+{
+	UInt32 i, j;
+
+	for (i=0;i<length;i+=16)
+	{
+		for (j=0;j<16;j++)
+			pData[i+j] ^= pContext->iv[j];
+		AESEncryptBlock(pContext,&pData[i]);
+		memcpy(pContext->iv,&pData[i],16);
+	}
+}
+
+//////////////////////////////////////////////////////
+// The stand-in cipher's callbacks
+//////////////////////////////////////////////////////
+struct CipherState
+{
+	UInt8 key[16];
+	UInt8 iv[16];
+	UInt32 keyDerivationBlocks;
+	UInt64 calls;
+	UInt64 packets;
+};
+
+static void EncryptPackets(CipherState *pCipher, UInt32 tsPacketCount, UInt32 **ppBuf)
+{
+	AESCBCContext context;
+	UInt8 contentKey[16];
+	UInt32 i;
+
+	// The per-call setup cost
+	AESExpandKey(&context,pCipher->key);
+	if (pCipher->keyDerivationBlocks > 0)
+	{
+		memset(context.iv,0,16);
+		memcpy(contentKey,pCipher->iv,16);
+		for (i=0;i<pCipher->keyDerivationBlocks;i++)
+			AESCBCEncrypt(&context,contentKey,16);
+		AESExpandKey(&context,contentKey);
+	}
+	memcpy(context.iv,pCipher->iv,16);
+
+	for (i=0;i<tsPacketCount;i++)
+		AESCBCEncrypt(&context,(UInt8*) ppBuf[i],kBenchCiphertextBytesPerPacket);
+
+	pCipher->calls += 1;
+	pCipher->packets += tsPacketCount;
+}
+
+static IOReturn CycleEncryption(UInt32 tsPacketCount, UInt32 **ppBuf, UInt8 *pSy, void *pRefCon)
+{
+	EncryptPackets((CipherState*) pRefCon,tsPacketCount,ppBuf);
+	return kIOReturnSuccess;
+}
+
+static IOReturn SegmentEncryption(UInt32 cycleCount,
+								  UInt32 *pCyclePacketCounts,
+								  UInt32 tsPacketCount,
+								  UInt32 **ppBuf,
+								  UInt8 *pSy,
+								  void *pRefCon)
+{
+	EncryptPackets((CipherState*) pRefCon,tsPacketCount,ppBuf);
+	return kIOReturnSuccess;
+}
+
+//////////////////////////////////////////////////////
+// CheckAES
+//////////////////////////////////////////////////////
+static bool CheckAES(void)
+{
+	// FIPS-197 appendix C.1
+	static const UInt8 key[16] = {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f};
+	static const UInt8 expected[16] = {0x69,0xc4,0xe0,0xd8,0x6a,0x7b,0x04,0x30,0xd8,0xcd,0xb7,0x80,0x70,0xb4,0xc5,0x5a};
+	UInt8 block[16] = {0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x88,0x99,0xaa,0xbb,0xcc,0xdd,0xee,0xff};
+	AESCBCContext context;
+
+	AESExpandKey(&context,key);
+	AESEncryptBlock(&context,block);
+	return (memcmp(block,expected,16) == 0);
+}
+
+//////////////////////////////////////////////////////
+// RunBenchmark
+//////////////////////////////////////////////////////
+static double RunBenchmark(UInt32 packetsPerCycle, bool perSegment, CipherState *pCipher)
+{
+	UInt8 *pPackets;
+	UInt32 **ppBuf;
+	UInt32 *pCyclePacketCounts;
+	UInt8 *pSy;
+	UInt32 segmentPackets;
+	UInt32 segment, cycle, i;
+	UInt32 numSegments = (kBenchSimulatedSeconds*8000)/kBenchCyclesPerSegment;
+	UInt64 startTime;
+	double elapsed;
+
+	// One segment's worth of source packets, as the transmitter commits them
+	pPackets = new UInt8[kBenchCyclesPerSegment*packetsPerCycle*kMPEG2SourcePacketSize];
+	ppBuf = new UInt32*[kBenchCyclesPerSegment*packetsPerCycle];
+	pCyclePacketCounts = new UInt32[kBenchCyclesPerSegment];
+	pSy = new UInt8[kBenchCyclesPerSegment];
+	for (i=0;i<kBenchCyclesPerSegment*packetsPerCycle*kMPEG2SourcePacketSize;i++)
+		pPackets[i] = (UInt8) i;
+
+	pCipher->calls = 0;
+	pCipher->packets = 0;
+
+	startTime = AVSTestNanoseconds();
+	for (segment=0;segment<numSegments;segment++)
+	{
+		segmentPackets = 0;
+		for (cycle=0;cycle<kBenchCyclesPerSegment;cycle++)
+		{
+			// Skip over each packet's SPH, as FillCycleBuffer does
+			for (i=0;i<packetsPerCycle;i++)
+				ppBuf[segmentPackets+i] = (UInt32*) &pPackets[((segmentPackets+i)*kMPEG2SourcePacketSize)+4];
+			pCyclePacketCounts[cycle] = packetsPerCycle;
+			pSy[cycle] = 0;
+
+			if (perSegment == false)
+				CycleEncryption(packetsPerCycle,&ppBuf[segmentPackets],&pSy[cycle],pCipher);
+
+			segmentPackets += packetsPerCycle;
+		}
+
+		if (perSegment == true)
+			SegmentEncryption(kBenchCyclesPerSegment,pCyclePacketCounts,segmentPackets,ppBuf,pSy,pCipher);
+	}
+	elapsed = (AVSTestNanoseconds() - startTime) / 1000000000.0;
+
+	delete [] pPackets;
+	delete [] ppBuf;
+	delete [] pCyclePacketCounts;
+	delete [] pSy;
+
+	return elapsed;
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	CipherState cipher;
+	UInt32 packetsPerCycle;
+	UInt32 derivation;
+	double perCycleSeconds;
+	double perSegmentSeconds;
+	UInt64 perCycleCalls;
+
+	AESInitSBox();
+	AVSTestCheck(CheckAES());
+
+	memset(cipher.key,0x5A,16);
+	memset(cipher.iv,0xA5,16);
+
+	printf("SegmentEncryptionBench: %u simulated seconds, %u cycles per segment\n",
+		   (unsigned int) kBenchSimulatedSeconds,(unsigned int) kBenchCyclesPerSegment);
+	for (derivation=0;derivation<2;derivation++)
+	{
+		cipher.keyDerivationBlocks = (derivation == 0) ? 0 : kBenchKeyDerivationBlocks;
+		printf("Per-call setup: AES key schedule%s\n",(derivation == 0) ? "" : ", and content key derivation");
+		for (packetsPerCycle=1;packetsPerCycle<=kMaxTSPacketsPerCycle;packetsPerCycle++)
+		{
+			perCycleSeconds = RunBenchmark(packetsPerCycle,false,&cipher);
+			perCycleCalls = cipher.calls;
+			perSegmentSeconds = RunBenchmark(packetsPerCycle,true,&cipher);
+			printf("  %u packets/cycle: per-cycle %.3f s (%llu calls), per-segment %.3f s (%llu calls), %.2fx\n",
+				   (unsigned int) packetsPerCycle,
+				   perCycleSeconds,(unsigned long long) perCycleCalls,
+				   perSegmentSeconds,(unsigned long long) cipher.calls,
+				   perCycleSeconds/perSegmentSeconds);
+		}
+	}
+
+	return AVSTestFinish("SegmentEncryptionBench");
+}
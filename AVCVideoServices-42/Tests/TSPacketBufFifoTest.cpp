@@ -0,0 +1,402 @@
+/*
+	File:		TSPacketBufFifoTest.cpp
+ 
+ Synopsis: Checks that the NuDCL MPEG2Transmitter's packet fifos never allocate memory once the transmitter is set up.
+ 
+	Copyright: 	© Copyright 2001-2003 Apple Computer, Inc. All rights reserved.
+ 
+	Written by: ayanowitz
+ 
+ Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+ ("Apple") in consideration of your agreement to the following terms, and your
+ use, installation, modification or redistribution of this Apple software
+ constitutes acceptance of these terms.  If you do not agree with these terms,
+ please do not use, install, modify or redistribute this Apple software.
+ 
+ In consideration of your agreement to abide by the following terms, and subject
+ to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+ copyrights in this original Apple software (the "Apple Software"), to use,
+ reproduce, modify and redistribute the Apple Software, with or without
+ modifications, in source and/or binary forms; provided that if you redistribute
+ the Apple Software in its entirety and without modifications, you must retain
+ this notice and the following text and disclaimers in all such redistributions of
+ the Apple Software.  Neither the name, trademarks, service marks or logos of
+ Apple Computer, Inc. may be used to endorse or promote products derived from the
+ Apple Software without specific prior written permission from Apple.  Except as
+ expressly stated in this notice, no other rights or licenses, express or implied,
+ are granted by Apple herein, including but not limited to any patent rights that
+ may be infringed by your derivative works or by other works in which the Apple
+ Software may be incorporated.
+ 
+ The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+ WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+ WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+ COMBINATION WITH YOUR PRODUCTS.
+ 
+ IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+ OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+ (INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ */
+
+//
+// The transmit scheduler in MPEG2Transmitter needs a FireWire DCL program, so it
+// can't be run here. Its fifo handling is in TSPacketBufQueues, which this test
+// drives with the same traffic the scheduler generates: AddPacketToTSPacketQueue
+// moves packets from the free fifo to the analysis fifo (parsing each one with
+// TSPacket), FillCycleBuffer commits them to the xmit fifo with their program
+// segment, and each segment's DCL callback releases the ones it sent back to the
+// free fifo. The queues are sized with numTSPacketBufForProgram, as createIsochProgram
+// sizes them, and a DCL overrun restart (releaseAll) is run mid-stream. A counting
+// global operator new/delete checks that nothing is allocated after setup.
+//
+// The counting hook is also shown to catch the allocations std::deque, which the
+// fifos replaced, makes for the same traffic.
+//
+
+#include "AVSTest.h"
+#include <new>
+#include <deque>
+
+using namespace AVS;
+
+//////////////////////////////////////////////////////
+// Allocation counting hook
+//////////////////////////////////////////////////////
+static volatile bool countAllocations = false;
+static UInt32 allocationCount = 0;
+static UInt32 freeCount = 0;
+
+void *operator new(size_t size) throw (std::bad_alloc)
+{
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	if (countAllocations)
+		allocationCount += 1;
+	return p;
+}
+
+void *operator new[](size_t size) throw (std::bad_alloc)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) throw ()
+{
+	if ((p) && (countAllocations))
+		freeCount += 1;
+	free(p);
+}
+
+void operator delete[](void *p) throw ()
+{
+	operator delete(p);
+}
+
+// The transmitter's default geometry, with the most packets per cycle
+enum
+{
+	kTestCyclesPerSegment = kCyclesPerTransmitSegment,
+	kTestSegments = kNumTransmitSegments,
+	kTestPacketsPerCycle = kMaxTSPacketsPerCycle,
+	kTestPacketQueueSize = kTSPacketQueueSizeInPackets,
+	kTestPCRPid = 0x100,
+	kTestSteadyStateSegments = 2000,
+	kTestOverrunSegment = 777
+};
+
+//////////////////////////////////////////////////////
+// TransmitterPacketTraffic
+//////////////////////////////////////////////////////
+class TransmitterPacketTraffic
+{
+public:
+	TransmitterPacketTraffic()
+	{
+		UInt32 i;
+
+		numTSPacketBuf = TSPacketBufQueues::numTSPacketBufForProgram(kTestPacketQueueSize,
+																	 kTestPacketsPerCycle,
+																	 kTestCyclesPerSegment*kTestSegments);
+		pTSPacketBufArray = new TSPacketBuf[numTSPacketBuf];
+		pPacketMemory = new UInt8[numTSPacketBuf*kMPEG2SourcePacketSize];
+		allocateResult = queues.allocate(numTSPacketBuf);
+		for (i=0;i<numTSPacketBuf;i++)
+		{
+			pTSPacketBufArray[i].pBuf = &pPacketMemory[i*kMPEG2SourcePacketSize];
+			queues.addFreePacket(&pTSPacketBufArray[i]);
+		}
+		for (i=0;i<kTestSegments;i++)
+			committedToSegment[i] = 0;
+		nextPacketNumber = 0;
+		nextSentPacketNumber = 0;
+		orderErrors = 0;
+		releaseErrors = 0;
+		underruns = 0;
+		currentSegment = 0;
+		cycleCount = 0;
+	}
+
+	~TransmitterPacketTraffic()
+	{
+		delete [] pTSPacketBufArray;
+		delete [] pPacketMemory;
+	}
+
+	// AddPacketToTSPacketQueue
+	void addPacket(void)
+	{
+		TSPacketBuf *pTSPacketBuf = queues.takeFreePacket();
+		UInt8 *pPacket;
+
+		if (!pTSPacketBuf)
+		{
+			underruns += 1;
+			return;
+		}
+
+		// Make a TS packet, with a PCR every 100 packets, and parse it
+		pPacket = &pTSPacketBuf->pBuf[4];
+		bzero(pPacket,kMPEG2TSPacketSize);
+		pPacket[0] = 0x47;
+		pPacket[1] = (kTestPCRPid >> 8) & 0x1F;
+		pPacket[2] = kTestPCRPid & 0xFF;
+		if ((nextPacketNumber % 100) == 0)
+		{
+			pPacket[3] = 0x30;
+			pPacket[4] = 7;
+			pPacket[5] = 0x10;
+		}
+		else
+			pPacket[3] = 0x10;
+		*((UInt32*) pTSPacketBuf->pBuf) = nextPacketNumber;
+		nextPacketNumber += 1;
+
+		pTSPacketBuf->packetInfo.hasPacketFetchError = false;
+		pTSPacketBuf->packetInfo.update(pPacket);
+		queues.queueForAnalysis(pTSPacketBuf);
+	}
+
+	// Top up the analysis fifo, as prepareForTransmit does
+	void fillAnalysisFifo(void)
+	{
+		UInt32 i;
+
+		for (i=0;i<kTestPacketQueueSize;i++)
+			addPacket();
+	}
+
+	// A DCL overrun restart: everything goes back on the free fifo, and the
+	// packets that were queued are thrown away
+	bool restart(void)
+	{
+		bool allFree = queues.releaseAll();
+		UInt32 i;
+
+		for (i=0;i<kTestSegments;i++)
+			committedToSegment[i] = 0;
+		nextSentPacketNumber = nextPacketNumber;
+		fillAnalysisFifo();
+		return allFree;
+	}
+
+	// The DCL callback for the segment the DCL program just finished (releasing
+	// what it sent), then FillCycleBuffer, for the cycles of the segment
+	void runSegment(void)
+	{
+		UInt32 cycle;
+		UInt32 packets;
+		UInt32 i;
+		TSPacketBuf *pTSPacketBuf;
+
+		if (queues.releaseSegment(currentSegment) != committedToSegment[currentSegment])
+			releaseErrors += 1;
+		committedToSegment[currentSegment] = 0;
+
+		for (cycle=0;cycle<kTestCyclesPerSegment;cycle++)
+		{
+			// Vary the packets per cycle over the allowed range, with some CIP-only cycles
+			packets = (cycleCount*7) % (kTestPacketsPerCycle+1);
+			cycleCount += 1;
+			for (i=0;i<packets;i++)
+			{
+				pTSPacketBuf = queues.takeAnalyzedPacket();
+				if (!pTSPacketBuf)
+				{
+					underruns += 1;
+					break;
+				}
+				if (*((UInt32*) pTSPacketBuf->pBuf) != nextSentPacketNumber)
+					orderErrors += 1;
+				nextSentPacketNumber = *((UInt32*) pTSPacketBuf->pBuf) + 1;
+				queues.commitToSegment(pTSPacketBuf,currentSegment);
+				committedToSegment[currentSegment] += 1;
+				addPacket();
+			}
+		}
+
+		currentSegment = (currentSegment + 1) % kTestSegments;
+	}
+
+	bool balanced(void)
+	{
+		return ((queues.freeDepth() + queues.analysisDepth() + queues.xmitDepth()) == numTSPacketBuf);
+	}
+
+	UInt32 numTSPacketBuf;
+	IOReturn allocateResult;
+	UInt32 orderErrors;
+	UInt32 releaseErrors;
+	UInt32 underruns;
+	TSPacketBufQueues queues;
+
+private:
+	TSPacketBuf *pTSPacketBufArray;
+	UInt8 *pPacketMemory;
+	UInt32 committedToSegment[kTestSegments];
+	UInt32 nextPacketNumber;
+	UInt32 nextSentPacketNumber;
+	UInt32 currentSegment;
+	UInt32 cycleCount;
+};
+
+//////////////////////////////////////////////////////
+// TestTransmitterTraffic
+//////////////////////////////////////////////////////
+static void TestTransmitterTraffic(void)
+{
+	TransmitterPacketTraffic *pTraffic = new TransmitterPacketTraffic;
+	TSPacketBuf *pMissing;
+	bool balanced = true;
+	bool restarted = false;
+	UInt32 i;
+
+	AVSTestCheck(pTraffic->allocateResult == kIOReturnSuccess);
+	AVSTestCheck(pTraffic->numTSPacketBuf == (kTestPacketQueueSize + (kTestPacketsPerCycle*kTestCyclesPerSegment*kTestSegments)));
+
+	// Warm up: one full pass through the DCL program
+	pTraffic->fillAnalysisFifo();
+	for (i=0;i<kTestSegments;i++)
+		pTraffic->runSegment();
+
+	allocationCount = 0;
+	freeCount = 0;
+	countAllocations = true;
+	for (i=0;i<kTestSteadyStateSegments;i++)
+	{
+		if (i == kTestOverrunSegment)
+			restarted = pTraffic->restart();
+		pTraffic->runSegment();
+		if (pTraffic->balanced() == false)
+			balanced = false;
+	}
+	countAllocations = false;
+
+	printf("TSPacketBufQueues: %u allocations and frees in %u steady-state segments\n",
+		   (unsigned int) (allocationCount + freeCount),(unsigned int) kTestSteadyStateSegments);
+	AVSTestCheck((allocationCount + freeCount) == 0);
+	AVSTestCheck(balanced);
+	AVSTestCheck(restarted);
+	AVSTestCheck(pTraffic->orderErrors == 0);
+	AVSTestCheck(pTraffic->releaseErrors == 0);
+	AVSTestCheck(pTraffic->underruns == 0);
+
+	// A TSPacketBuf that never came back is reported on restart
+	pMissing = pTraffic->queues.takeFreePacket();
+	AVSTestCheck(pMissing != nil);
+	AVSTestCheck(pTraffic->queues.releaseAll() == false);
+	pTraffic->queues.addFreePacket(pMissing);
+	AVSTestCheck(pTraffic->queues.releaseAll() == true);
+	AVSTestCheck(pTraffic->queues.freeDepth() == pTraffic->numTSPacketBuf);
+
+	// Nothing to take once everything is free
+	AVSTestCheck(pTraffic->queues.takeAnalyzedPacket() == nil);
+	AVSTestCheck(pTraffic->queues.releaseSegment(0) == 0);
+
+	delete pTraffic;
+}
+
+//////////////////////////////////////////////////////
+// TestDequeAllocates
+//////////////////////////////////////////////////////
+static void TestDequeAllocates(void)
+{
+	std::deque<TSPacketBuf*> fifo;
+	TSPacketBuf buf;
+	UInt32 i;
+
+	allocationCount = 0;
+	freeCount = 0;
+	countAllocations = true;
+	for (i=0;i<(kTestSteadyStateSegments*kTestPacketsPerCycle);i++)
+	{
+		fifo.push_back(&buf);
+		if (fifo.size() > kTestPacketQueueSize)
+			fifo.pop_front();
+	}
+	countAllocations = false;
+
+	printf("std::deque: %u allocations and frees for the same number of packets\n",
+		   (unsigned int) (allocationCount + freeCount));
+	AVSTestCheck((allocationCount + freeCount) > 0);
+}
+
+//////////////////////////////////////////////////////
+// TestFifoWrap
+//////////////////////////////////////////////////////
+static void TestFifoWrap(void)
+{
+	TSPacketBufFifo fifo;
+	TSPacketBuf bufs[8];
+	UInt32 i;
+	UInt32 round;
+	bool inOrder = true;
+
+	// Capacity rounds up to a power of two
+	AVSTestCheck(fifo.allocate(5) == kIOReturnSuccess);
+	AVSTestCheck(fifo.empty());
+
+	// Run the free-running indexes around the ring many times, filling it to capacity
+	for (round=0;round<1000;round++)
+	{
+		for (i=0;i<8;i++)
+			fifo.push_back(&bufs[i]);
+		if (fifo.size() != 8)
+			inOrder = false;
+		for (i=0;i<8;i++)
+		{
+			if (fifo.front() != &bufs[i])
+				inOrder = false;
+			fifo.pop_front();
+		}
+		if (!fifo.empty())
+			inOrder = false;
+
+		// Leave the indexes at a different offset each round
+		fifo.push_back(&bufs[round & 7]);
+		fifo.pop_front();
+	}
+	AVSTestCheck(inOrder);
+
+	fifo.push_back(&bufs[0]);
+	fifo.clear();
+	AVSTestCheck(fifo.empty());
+}
+
+//////////////////////////////////////////////////////
+// main
+//////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	TestFifoWrap();
+	TestTransmitterTraffic();
+	TestDequeAllocates();
+
+	return AVSTestFinish("TSPacketBufFifoTest");
+}
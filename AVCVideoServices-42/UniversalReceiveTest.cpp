@@ -277,15 +277,11 @@ IOReturn DataReceiveCallback(UInt32 CycleDataCount, UniversalReceiveCycleData *p
 					lastFmt = k61883Fmt_DV;
 				}
 				
-				for (sourcePacket=0;sourcePacket<parsedPacket.numSourcePackets;sourcePacket++)
-					result = pParsers->dvFramer->nextDVSourcePacket(parsedPacket.pSourcePacket[sourcePacket], 
-																	parsedPacket.sourcePacketSize, 
-																	parsedPacket.dvMode, 
-																	parsedPacket.syt, 
-																	pCycleData[cycle].fireWireTimeStamp,
-																	pCycleData[cycle].nanoSecondsTimeStamp);
-					if (result != kIOReturnSuccess)
-						printf("DataReceiveCallback: nextTSPacket failed. Result: 0x%08X\n",result);
+				result = pParsers->dvFramer->nextCIPPacket(&parsedPacket,
+														   pCycleData[cycle].fireWireTimeStamp,
+														   pCycleData[cycle].nanoSecondsTimeStamp);
+				if (result != kIOReturnSuccess)
+					printf("DataReceiveCallback: nextTSPacket failed. Result: 0x%08X\n",result);
 			}
 			else
 			{
@@ -78,8 +78,6 @@ static void UniversalReceiveOverrunDCLCallback_Helper(DCLCommandPtr pDCLCommand)
 
 static IOReturn UniversalReceiveFinalizeCallback_Helper( void* refcon ) ;
 
-static UInt32  AddFWCycleTimeToFWCycleTime( UInt32 cycleTime1, UInt32 cycleTime2 );
-
 #ifdef kAVS_Enable_ForceStop_Handler	
 static void	UniversalReceiveForceStopHandler_Helper( IOFireWireLibIsochChannelRef interface, UInt32  stopCondition);
 #endif
@@ -901,20 +899,8 @@ void UniversalReceiver::UniversalReceiveDCLCallback(void)
 	Nanoseconds currentUpTimeInNanoSeconds;
 	UInt64 currentUpTimeInNanoSecondsU64;
 	
-	int currentCycleTimeSecondsLo;	// Low 3-bits
-	int currentCycleTimeSecondsHi;	// High 4-bits
-	int currentCycleTimeSeconds;
-	int currentCycleTimeCycles;
-	
-	int dclTimeStampSecondsLo;		// Low 3-bits
-	int dclTimeStampSecondsHi;		// High 4-bits (we calculate this)
-	int dclTimeStampSeconds;
-	int dclTimeStampCycles;
-	
-	UInt32 currentCycleTimeInCycles;
-	UInt32 dclTimeInCycles;
 	UInt32 deltaCycles;
-	UInt32 deltaNanoSeconds;
+	UInt64 deltaNanoSeconds;
 	UInt64 dclTimeStampTimeInNanoSecondsU64 = 0LL;
 	
 	UInt32 numCycleStructs = 0;
@@ -943,58 +929,27 @@ void UniversalReceiver::UniversalReceiveDCLCallback(void)
 		// Add one cycle to the current cycletime, if we are currently more than half-way
 		// through the cycle. Makes it a little more accurate!
 		if ((outCycleTime & 0x00000FFF) > 1536) 
-			outCycleTime =  AddFWCycleTimeToFWCycleTime( outCycleTime, 0x00001000 );
-		
-		// Process cycle timer, dcl-timestamp, and up-time to determine delta
-		currentCycleTimeSecondsLo = ((outCycleTime & 0x0E000000) >> 25);	
-		currentCycleTimeSecondsHi = ((outCycleTime & 0xF0000000) >> 25);
-		currentCycleTimeSeconds = ((outCycleTime & 0xFE000000) >> 25);
-		currentCycleTimeCycles = ((outCycleTime & 0x01FFF000) >> 12);
-		
-		dclTimeStampCycles = ((dclTimeStamp & 0x01FFF000) >> 12);
-		dclTimeStampSecondsLo = ((dclTimeStamp & 0x0E000000) >> 25);		
-		if (dclTimeStampSecondsLo > currentCycleTimeSecondsLo )
-			dclTimeStampSecondsHi = currentCycleTimeSecondsHi - 8 ;	// Subtract 8 seconds from this value!
-		else
-			dclTimeStampSecondsHi = currentCycleTimeSecondsHi;
-		dclTimeStampSeconds = dclTimeStampSecondsHi + dclTimeStampSecondsLo;
+			outCycleTime =  FWCycleTime::fromRegister(outCycleTime).addCycles(1).getRegister();
 		
+		// Process cycle timer, dcl-timestamp, and up-time to determine delta.
+		// The dcl timestamp only has the low 3 bits of the seconds field, so measure
+		// the delta in cycles since the last 8 second wrap. The dcl timestamp
+		// is always the earlier of the two, so this takes care of any rollover.
 		currentUpTimeInNanoSeconds = AbsoluteToNanoseconds(currentUpTime);
 		currentUpTimeInNanoSecondsU64 = ((UInt64) currentUpTimeInNanoSeconds.hi << 32) | currentUpTimeInNanoSeconds.lo;
 		
+		deltaCycles = FWTimeElapsed(FWTimeStampToCycles(dclTimeStamp), FWTimeStampToCycles(outCycleTime), kFWCyclesPerTimeStampWrap);
+		deltaNanoSeconds = FWCyclesToNanoSeconds(deltaCycles);
+		dclTimeStampTimeInNanoSecondsU64 = currentUpTimeInNanoSecondsU64 - deltaNanoSeconds;
+		
 #if 0
-		printf("CycleTime = 0x%08X (%d:%d:%d)\n",(int) outCycleTime,
-			   currentCycleTimeSeconds,
-			   currentCycleTimeCycles,
-			   (int) (outCycleTime & 0x00000FFF));
+		printf("CycleTime = 0x%08X, DCL TimeStamp = 0x%08X\n",(int) outCycleTime,(int) dclTimeStamp);
 		
 		printf("UpTime= %lld (%10.10f)\n",
 			   currentUpTimeInNanoSecondsU64,
 			   currentUpTimeInNanoSecondsU64/1000000000.0);
 		
-		printf("DCL TimeStamp = 0x%08X (%d:%d:%d)\n",(int) dclTimeStamp,
-			   dclTimeStampSeconds,
-			   dclTimeStampCycles,
-			   (int) (dclTimeStamp & 0x00000FFF));
-#endif
-		
-		// Here we are going to arbitrarily add 8 seconds to both the current cycle timer, and the dcl timestamp, to 
-		// eliminate the possiblity that the dcl timestamp full seconds field is a negative number.
-		// This is OK, since we're only interested in the delta between the two timetstamps, and 
-		// this eliminates any rollover issue!
-		dclTimeStampSeconds += 8;
-		currentCycleTimeSeconds += 8;
-		
-		// Convert the seconds fields and cycles fields of both timestamps to a count of cycles
-		currentCycleTimeInCycles = (currentCycleTimeSeconds * 8000) + currentCycleTimeCycles;
-		dclTimeInCycles = (dclTimeStampSeconds * 8000) + dclTimeStampCycles;
-		
-		deltaCycles = currentCycleTimeInCycles-dclTimeInCycles;
-		deltaNanoSeconds = (deltaCycles*125000);
-		dclTimeStampTimeInNanoSecondsU64 = currentUpTimeInNanoSecondsU64 - deltaNanoSeconds;
-		
-#if 0
-		printf("Delta between dcl timestamp and current cycle time: %d cycles (%d nsec) \n",(int)deltaCycles,(int)deltaNanoSeconds);
+		printf("Delta between dcl timestamp and current cycle time: %d cycles (%lld nsec) \n",(int)deltaCycles,deltaNanoSeconds);
 		
 		printf("DCL TimeStamp UpTime= %lld (%10.10f)\n",
 			   dclTimeStampTimeInNanoSecondsU64,
@@ -1042,7 +997,7 @@ void UniversalReceiver::UniversalReceiveDCLCallback(void)
 		else if (packetPush != nil)
 				packetPush(pPacketPushRefCon,payloadLen,pPayload,pCycleBuf[0],dclTimeStamp);
 		
-		dclTimeStamp =  AddFWCycleTimeToFWCycleTime( dclTimeStamp, 0x00001000 );
+		dclTimeStamp =  FWCycleTime::fromRegister(dclTimeStamp).addCycles(1).getRegister();
 		
 		// Bump the absolute-time for the next cycle
 		// Only if the client has registered a structure-data callback function
@@ -1419,45 +1374,6 @@ static IOReturn UniversalReceiveFinalizeCallback_Helper( void* refcon )
 	return kIOReturnSuccess;
 }
 
-//////////////////////////////////////////////////////////////////////
-// AddFWCycleTimeToFWCycleTime
-//////////////////////////////////////////////////////////////////////
-UInt32  AddFWCycleTimeToFWCycleTime( UInt32 cycleTime1, UInt32 cycleTime2 )
-{
-    UInt32    secondCount,
-	cycleCount,
-	cycleOffset;
-    UInt32    cycleTime;
-	
-    // Add cycle offsets.
-    cycleOffset = (cycleTime1 & 0x0FFF) + (cycleTime2 & 0x0FFF);
-	
-    // Add cycle counts.
-    cycleCount = (cycleTime1 & 0x01FFF000) + (cycleTime2 & 0x01FFF000);
-	
-    // Add any carry over from cycle offset to cycle count.
-    if (cycleOffset > 3071)
-    {
-        cycleCount += 0x1000;
-        cycleOffset -= 3072;
-    }
-	
-    // Add secondCounts.
-    secondCount = (cycleTime1 & 0xFE000000) + (cycleTime2 & 0xFE000000);
-	
-    // Add any carry over from cycle count to secondCount.
-    if (cycleCount > (7999 << 12))
-    {
-        secondCount += 0x02000000;
-        cycleCount -= (8000 << 12);
-    }
-	
-    // Put everything together into cycle time.
-    cycleTime = secondCount | cycleCount | cycleOffset;
-	
-    return (cycleTime);
-}
-
 #ifdef kAVS_Enable_ForceStop_Handler	
 //////////////////////////////////////////////////////////////////////
 // UniversalReceiveForceStopHandler_Helper
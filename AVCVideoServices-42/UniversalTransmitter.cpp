@@ -734,9 +734,7 @@ void
 UniversalTransmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UInt32 segment, UInt32 cycle)
 {
 	UInt32 *pIsochHeaderAndMask = &pIsochHeaders[(segment*isochCyclesPerSegment*4)+(cycle*4)];
-	UInt32 transmitTimeInClocks;
-	UInt32 currentCycleTimeInClocks;
-	int timeStampDeltaInClocks;
+	UInt32 timeStampDeltaInClocks;
 	Boolean badRanges = false;
 	
 	// Determine which cycle info struct is associated with this dcl
@@ -751,7 +749,7 @@ UniversalTransmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UIn
 		// Here, we are being called from prepareForTransmit; expectedTimeStampCycle is correct for this cycle,
 		// but we don't know the actual "seconds" field value
 	
-		pInfo->expectedTransmitCycleTime = ((expectedTimeStampCycle/8000) << 25) + ((expectedTimeStampCycle%8000) << 12);
+		pInfo->expectedTransmitCycleTime = FWCyclesToTimeStamp(expectedTimeStampCycle);
 		pInfo->dclProgramRunning = false;
 	}
 	else
@@ -759,20 +757,17 @@ UniversalTransmitter::FillCycleBuffer(NuDCLSendPacketRef dcl, UInt16 nodeID, UIn
 		// Here, we are being called from the DCL callback; expectedTimeStampCycle is behind by numSegments-2 worth of cycles,
 		// and, at this point the "seconds" field is valid
 		
-		UInt32 bumpedExpectedTimeStampCycle = ((expectedTimeStampCycle + (isochCyclesPerSegment*(isochSegments-1)))%64000);
-		pInfo->expectedTransmitCycleTime = ((bumpedExpectedTimeStampCycle/8000) << 25) + ((bumpedExpectedTimeStampCycle%8000) << 12);
+		pInfo->expectedTransmitCycleTime = FWCyclesToTimeStamp(expectedTimeStampCycle + (isochCyclesPerSegment*(isochSegments-1)));
 		pInfo->dclProgramRunning = true;
 	}
 	
 	if (firstDCLCallbackOccurred)
 	{
-		transmitTimeInClocks = (((pInfo->expectedTransmitCycleTime & 0x01FFF000) >> 12)*3072);
-		currentCycleTimeInClocks = (((currentFireWireCycleTime & 0x01FFF000) >> 12)*3072);
-		timeStampDeltaInClocks = transmitTimeInClocks - currentCycleTimeInClocks;
-		if (timeStampDeltaInClocks < 0)
-			timeStampDeltaInClocks += 24576000;
+		timeStampDeltaInClocks = FWTimeElapsed(FWClocksIntoSecond(currentFireWireCycleTime & 0xFFFFF000),
+											   FWClocksIntoSecond(pInfo->expectedTransmitCycleTime),
+											   kFWClocksPerSecond);
 		
-		pInfo->transmitTimeInNanoSeconds = currentUpTimeInNanoSecondsU64 + (timeStampDeltaInClocks*40.690104167);	// 40.690104167 is nanoseconds per FireWire clock tick!
+		pInfo->transmitTimeInNanoSeconds = currentUpTimeInNanoSecondsU64 + FWClocksToNanoSeconds(timeStampDeltaInClocks);
 	
 	}
 	else
@@ -981,17 +976,14 @@ void UniversalTransmitter::UniversalTransmitterDCLCallback(void)
 	
 	// Get the current end-of-cycle timestamp and convert it to cycles
 	// 8000 cycles per second times 8 seconds gives a cycle number betwen 0 thru 63999
-	actualTimeStampCycle = ((pTimeStamps[currentSegment] & 0x01FFF000) >> 12);
-	actualTimeStampCycle += (((pTimeStamps[currentSegment] & 0x0E000000) >> 25) * 8000);
+	actualTimeStampCycle = FWTimeStampToCycles(pTimeStamps[currentSegment]);
 	
 	// If the actual time stamp is not what we expect, we need to deal with
 	// it here. 
 	if (actualTimeStampCycle != expectedTimeStampCycle)
 	{
 		// Calculate lost cycles (deal with wrap-around condition)
-		lostCycles = actualTimeStampCycle - expectedTimeStampCycle;
-		if (lostCycles < 0)
-			lostCycles += 64000; // based on 8 Seconds worth of cycles
+		lostCycles = FWTimeElapsed(expectedTimeStampCycle, actualTimeStampCycle, kFWCyclesPerTimeStampWrap);
 		
 		// See if the descrepency between actual and expected time-stamps is
 		// only due to the fact that the initial value for the time-stsamp
@@ -1035,7 +1027,7 @@ void UniversalTransmitter::UniversalTransmitterDCLCallback(void)
 	
 	// Reduce currentUpTimeInNanoSecondsU64 to eliminate the FW "offset" value from currentFireWireCycleTime.
 	// Since the expectedTimeStampCycle time we'll be comparing it to doesn't include any "offset" value!
-	currentUpTimeInNanoSecondsU64 -= ((currentFireWireCycleTime&0x00000FFF)*40.690104167);
+	currentUpTimeInNanoSecondsU64 -= FWClocksToNanoSeconds(currentFireWireCycleTime & 0x00000FFF);
 	
 	// Set the flag that tells us if we've handled at least one DCLCallback.
 	firstDCLCallbackOccurred = true;
@@ -1206,7 +1206,6 @@ IOReturn VirtualMPEGTapePlayerRecorder::MpegReceiveCallback(UInt32 tsPacketCount
 	UInt8 currentTransportMode;
 	UInt8 currentTransportState;
 	bool isStable;
-	unsigned int i;
 	UInt32 horizontalResolution;
 	UInt32 verticalResolution;
 	MPEGFrameRate frameRate;
@@ -1233,22 +1232,20 @@ IOReturn VirtualMPEGTapePlayerRecorder::MpegReceiveCallback(UInt32 tsPacketCount
 	if (currentTransportState == kAVCTapeRecordRecordPause)
 		return kIOReturnSuccess;
 	
-	// Write packets to file
-	for (i=0;i<tsPacketCount;i++)
+	// Write packets to file (the writer hands them off to its recording sink,
+	// so we never wait on the disk here)
+	cnt = pPlayerRecorder->pWriter->WriteNextTSPackets(ppBuf,tsPacketCount);
+	if (cnt != tsPacketCount)
 	{
-		cnt = pPlayerRecorder->pWriter->WriteNextTSPackets(ppBuf[i],1);
-		if (cnt != 1)
+		// The file writer had a write error, close it now
+		// TODO: We cannot change the transport state here becuase stopping
+		// the receiver would cause a deadlock. Need to address this problem!
+		if (pPlayerRecorder->pWriter)
 		{
-			// The file writer had a write error, close it now
-			// TODO: We cannot change the transport state here becuase stopping
-			// the receiver would cause a deadlock. Need to address this problem!
-			if (pPlayerRecorder->pWriter)
-			{
-				delete pPlayerRecorder->pWriter;
-				pPlayerRecorder->pWriter = nil;
-			}
-			return kIOReturnSuccess;
+			delete pPlayerRecorder->pWriter;
+			pPlayerRecorder->pWriter = nil;
 		}
+		return kIOReturnSuccess;
 	}
 
 	// Update the current time-code